@@ -0,0 +1,176 @@
+/*
+	Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+/*
+	Automated test of the DecoderEngine and of its loopback front end with a trained model and a data directory
+	(e.g. the monophone model and the test data of the YesNo example). It checks that:
+	- every utterance of wav.scp is decoded;
+	- the results do not depend on the number of workers and clients: the utterances are decoded by one client with
+	  one worker and then by several clients in parallel with several workers, the responses must be the same;
+	- the loopback front end takes the rest of the line as the rxfilename: a wav file in a directory with spaces and
+	  a piped entry give the same result as the original wav file;
+	- wrong requests, missing files and requests after Stop() get an ERROR response.
+	The features are computed without dithering so that the results are reproducible. No user input is needed;
+	returns 0 if all checks passed and -1 otherwise (the failed checks are logged).
+*/
+
+#include "ExamplesUtil.h"
+#include <thread>
+
+//the wav.scp entry of an utterance: the rest of the line after the utterance id
+static std::string WavEntry(const string_vec & row)
+{
+	std::string entry;
+	for (size_t c = 1; c < row.size(); c++) {
+		if (c > 1) entry += " ";
+		entry += row[c];
+	}
+	return entry;
+}
+
+//true if the response is "OK <id> <words>"
+static bool IsOk(const std::string & response, const std::string & id)
+{
+	std::string prefix("OK " + id);
+	return response == prefix || response.compare(0, prefix.size() + 1, prefix + " ") == 0;
+}
+
+//the decoded words of an "OK <id> <words>" response
+static std::string ResponseText(const std::string & response, const std::string & id)
+{
+	if (!IsOk(response, id)) return "";
+	size_t begin = response.find_first_not_of(' ', id.size() + 3);
+	return (begin == std::string::npos ? "" : response.substr(begin));
+}
+
+//decodes all utterances of wav.scp with num_clients client threads; each client sends every num_clients-th utterance
+//and waits for the response
+static void DecodeAll(VoiceBridge::DecoderEngine & engine, const StringTable & t_wav, int num_clients,
+	std::vector<std::string> & responses)
+{
+	VoiceBridge::DecoderEngineLoopback loopback(engine);
+	responses.assign(t_wav.size(), "");
+	std::vector<std::thread> clients;
+	for (int c = 0; c < num_clients; c++) {
+		clients.emplace_back([&, c]() {
+			for (size_t i = c; i < t_wav.size(); i += num_clients) {
+				if (t_wav[i].size() < 2) continue;
+				responses[i] = loopback.Call("DECODE " + t_wav[i][0] + " " + WavEntry(t_wav[i]));
+			}
+		});
+	}
+	for (std::thread & t : clients) t.join();
+}
+
+int TestDecoderEngine(fs::path model, fs::path graph_dir, fs::path mfcc_config, fs::path data_dir, fs::path work_dir)
+{
+	int num_failed = 0;
+	auto check = [&num_failed](bool ok, const std::string & what) {
+		if (!ok) {
+			LOGTW_ERROR << "Decoder engine test failed: " << what;
+			num_failed++;
+		}
+	};
+
+	StringTable t_wav;
+	if (ReadStringTable((data_dir / "wav.scp").string(), t_wav) < 0 || t_wav.empty()) {
+		LOGTW_ERROR << "Could not read " << (data_dir / "wav.scp").string();
+		return -1;
+	}
+	try {
+		if (fs::exists(work_dir)) fs::remove_all(work_dir);
+		fs::create_directories(work_dir / "wav dir with spaces");
+		//the MFCC configuration without dithering
+		fs::path config(work_dir / "mfcc.conf");
+		fs::copy_file(mfcc_config, config);
+		fs::ofstream config_out(config, std::ios::app);
+		config_out << "\n--dither=0\n";
+	}
+	catch (const std::exception & ex) {
+		LOGTW_ERROR << "Could not prepare " << work_dir.string() << ". Reason: " << ex.what();
+		return -1;
+	}
+
+	VoiceBridge::DecoderEngineOptions opts;
+	opts.model = model;
+	opts.graph_dir = graph_dir;
+	opts.mfcc_config = work_dir / "mfcc.conf";
+	VoiceBridge::DecoderEngine engine;
+
+	//reference: one worker and one client
+	opts.num_workers = 1;
+	if (engine.Start(opts) < 0) {
+		LOGTW_ERROR << "Could not start the decoder engine.";
+		return -1;
+	}
+	std::vector<std::string> reference;
+	DecodeAll(engine, t_wav, 1, reference);
+	engine.Stop();
+	for (size_t i = 0; i < t_wav.size(); i++) {
+		if (t_wav[i].size() < 2) continue;
+		check(IsOk(reference[i], t_wav[i][0]), "decoding " + t_wav[i][0] + ": " + reference[i]);
+	}
+
+	//several workers and clients
+	opts.num_workers = std::max(2, concurentThreadsSupported);
+	if (engine.Start(opts) < 0) {
+		LOGTW_ERROR << "Could not start the decoder engine.";
+		return -1;
+	}
+	const int num_clients = 4;
+	std::vector<std::string> responses;
+	DecodeAll(engine, t_wav, num_clients, responses);
+	for (size_t i = 0; i < t_wav.size(); i++)
+		check(responses[i] == reference[i], "parallel decoding gives \"" + responses[i] + "\" instead of \"" + reference[i] + "\"");
+
+	//the rxfilename is the rest of the line: a wav file in a directory with spaces and a piped entry
+	VoiceBridge::DecoderEngineLoopback loopback(engine);
+	size_t first = 0;
+	while (first < t_wav.size() && (t_wav[first].size() != 2 || t_wav[first][1].back() == '|')) first++;
+	if (first < t_wav.size()) {
+		const std::string & utt = t_wav[first][0];
+		std::string text(ResponseText(reference[first], utt));
+		fs::path spaced(work_dir / "wav dir with spaces" / "utterance with spaces.wav");
+		try {
+			fs::copy_file(t_wav[first][1], spaced);
+		}
+		catch (const std::exception & ex) {
+			LOGTW_ERROR << "Could not copy " << t_wav[first][1] << ". Reason: " << ex.what();
+			return -1;
+		}
+		std::string response(loopback.Call("DECODE spaced " + spaced.string()));
+		check(IsOk(response, "spaced") && ResponseText(response, "spaced") == text, "file name with spaces: " + response);
+		//NOTE: the command of a piped entry is run by the shell (cmd.exe)
+		response = loopback.Call("DECODE piped type \"" + spaced.string() + "\" |");
+		check(IsOk(response, "piped") && ResponseText(response, "piped") == text, "piped entry: " + response);
+	}
+	else {
+		LOGTW_WARNING << "There is no wav file in " << (data_dir / "wav.scp").string() << ", the rxfilenames are not tested.";
+	}
+
+	//wrong requests
+	std::string response(loopback.Call("DECODE incomplete"));
+	check(response.compare(0, 17, "ERROR incomplete ") == 0, "request without rxfilename: " + response);
+	response = loopback.Call("UNKNOWN unknown " + t_wav[0].back());
+	check(response.compare(0, 14, "ERROR unknown ") == 0, "unknown request type: " + response);
+	response = loopback.Call("DECODE missing " + (work_dir / "missing.wav").string());
+	check(response.compare(0, 14, "ERROR missing ") == 0, "missing wav file: " + response);
+
+	engine.Stop();
+	response = loopback.Call("DECODE stopped " + WavEntry(t_wav[0]));
+	check(response.compare(0, 14, "ERROR stopped ") == 0, "request after Stop(): " + response);
+
+	try {
+		fs::remove_all(work_dir);
+	}
+	catch (const std::exception&) {}
+
+	LOGTW_INFO << "Decoder engine test: " << t_wav.size() << " utterances decoded with 1 and " << opts.num_workers
+		<< " workers, " << num_failed << " failed checks.";
+	return (num_failed > 0 ? -1 : 0);
+}
@@ -18,3 +18,5 @@ bool NeedToRetrainModel(fs::path project_model_dir,
 	fs::path project_config, //the config file for the model training
 	fs::path project_base_model_dir=""); //the model dir on which the final.mdl in the project_model_dir depends on; if not define then not checked
 bool NeedToDecode(fs::path model_dir, fs::path decode_dir);
+//automated test of the DecoderEngine with a trained model and a data directory (DecoderEngineTest.cpp)
+int TestDecoderEngine(fs::path model, fs::path graph_dir, fs::path mfcc_config, fs::path data_dir, fs::path work_dir);
@@ -257,6 +257,27 @@ int TestYesNo()
 		}
 	}
 
+	//Decoder engine ---------------------------------------------------------------------------------------------------
+
+	/*
+		The DecoderEngine keeps the models in memory and decodes the requests of several clients in parallel with a
+		pool of worker threads. Here each test utterance is sent as a DECODE request (with its wav.scp entry) through
+		the loopback front end (the text protocol of a server), by one client and then by several client threads,
+		and the results are checked (see DecoderEngineTest.cpp).
+	*/
+	if (TestDecoderEngine(
+		training_dir / "mono0a" / "final.mdl",							//model
+		training_dir / "mono0a" / ("graph_" + lms[0]),					//graph_dir
+		voicebridgeParams.pth_project_base / "conf\\mfcc.conf",			//mfcc_config
+		test_dir,														//data_dir
+		training_dir / "mono0a" / "engine_test"							//work_dir (deleted at the end)
+	) < 0)
+	{
+		LOGTW_ERROR << "Decoding with the decoder engine failed.";
+		std::getchar();
+		return -1;
+	}
+
 	//---------------------------------------------------------------------------------------------------------------------------------
 	//NOTE: at this point we have a monophone model working properly with a given accuracy. It is still possible to improve the
 	//		accuracy with 2-5% with a more sophisticated model trained based on the monophone model.
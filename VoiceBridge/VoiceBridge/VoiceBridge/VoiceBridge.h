@@ -12,3 +12,4 @@ Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
 #include "mitlm/mitlm.h"
 #include "phonetisaurus/Phonetisaurus.h"
 #include "kaldi-win/scr/Params.h"
+#include "kaldi-win/scr/DecoderEngine.h"
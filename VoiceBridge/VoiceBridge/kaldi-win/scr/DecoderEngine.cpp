@@ -0,0 +1,659 @@
+/*
+	Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Kaldi (gmm-latgen-faster.cc, compute-mfcc-feats.cc, apply-cmvn.cc, add-deltas.cc, splice-feats.cc,
+		   transform-feats.cc), Phonetisaurus (phonetisaurus-g2pfst.cc)
+*/
+
+#include "DecoderEngine.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "base/timer.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/am-diag-gmm-shortlist.h"
+#include "gmm/am-diag-gmm-packed.h"
+#include "decoder/lattice-faster-decoder.h"
+#include "lat/lattice-functions.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "feat/feature-mfcc.h"
+#include "feat/feature-functions.h"
+#include "feat/wave-reader.h"
+#include "transform/cmvn.h"
+#include "fstext/fstext-lib.h"
+#include "fstext/lookahead-compose.h"
+
+#include <kaldi-win/utility/strvec2arg.h>
+#include "phonetisaurus/PhonetisaurusScript.h"
+
+namespace VoiceBridge {
+
+	//Reads the options of a Kaldi program from the first line of a file in the model directory (e.g. splice_opts).
+	static void ReadOptionsFile(fs::path file, kaldi::ParseOptions & po)
+	{
+		if (!fs::exists(file)) return;
+		string_vec args;
+		kaldi::SplitStringToVector(GetFirstLineFromFile(file.string()), " \t", true, &args);
+		StrVec2Arg sargs(args);
+		po.Read(sargs.argc(), sargs.argv());
+	}
+
+	//Keeps the message of the last Kaldi error of the current thread (the exception thrown by KALDI_ERR has no
+	//message in this Kaldi version); the messages are also written to the global log.
+	class KaldiErrorCapture : public kaldi::LogSink {
+	public:
+		KaldiErrorCapture() { prev_sink_ = kaldi::SetThreadLogSink(this); }
+		~KaldiErrorCapture() { kaldi::SetThreadLogSink(prev_sink_); }
+		bool Log(const kaldi::LogMessageEnvelope &envelope, const char *message) {
+			if (envelope.severity <= kaldi::LogMessageEnvelope::kError) last_error = message;
+			return (prev_sink_ != NULL && prev_sink_->Log(envelope, message));
+		}
+		//the message of the last error or of the exception
+		std::string Message(const std::exception & ex) const {
+			std::string msg(ex.what());
+			return (msg.empty() ? last_error : msg);
+		}
+		std::string last_error;
+	private:
+		kaldi::LogSink * prev_sink_;
+	};
+
+	struct DecoderEngine::Impl {
+		struct Job {
+			DecoderEngineRequest request;
+			bool has_promise = false;
+			std::promise<DecoderEngineResult> promise;
+			std::function<void(DecoderEngineResult &)> callback;
+			kaldi::Timer timer;	//started when the request is submitted
+		};
+
+		//the state of one worker thread: the decoder (and the on the fly composed graph) is reused for all requests
+		struct Worker {
+			std::unique_ptr<fst::StdLookaheadComposeFst> lookahead_fst;
+			std::unique_ptr<kaldi::LatticeFasterDecoder> decoder;
+		};
+
+		DecoderEngineOptions opts;
+		//models (recreated by each Load(): AmDiagGmm::Read() appends to a loaded model)
+		std::unique_ptr<kaldi::TransitionModel> trans_model;
+		std::unique_ptr<kaldi::AmDiagGmm> am_gmm;
+		std::unique_ptr<kaldi::AmDiagGmmShortlist> shortlist;
+		std::unique_ptr<kaldi::AmDiagGmmPacked> packed_gmm;
+		std::unique_ptr<fst::Fst<fst::StdArc>> decode_fst;	//HCLG.fst
+		std::unique_ptr<fst::StdOLabelLookAheadFst> hcl_fst;	//or HCLr.fst + Gr.fst
+		std::unique_ptr<fst::Fst<fst::StdArc>> g_fst;
+		std::unique_ptr<fst::SymbolTable> word_syms;
+		kaldi::LatticeFasterDecoderConfig decoder_config;
+		//features
+		bool use_mfcc = false;
+		kaldi::MfccOptions mfcc_opts;
+		bool norm_means = true, norm_vars = false;
+		bool use_lda = false;
+		kaldi::DeltaFeaturesOptions delta_opts;
+		kaldi::int32 left_context = 4, right_context = 4;
+		kaldi::Matrix<kaldi::BaseFloat> lda_mat;
+		//G2P
+		std::unique_ptr<PhonetisaurusScript> g2p;
+		std::map<std::string, std::string> refdict;
+		//requests
+		std::mutex mutex;
+		std::condition_variable cond;
+		std::deque<Job*> queue;
+		bool running = false, stopping = false;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> num_done;
+
+		Impl() : num_done(0) {}
+
+		int Load(const DecoderEngineOptions & o);
+		void Clear();
+		void Run();
+		void Process(Worker & worker, Job & job, DecoderEngineResult & res);
+		void ComputeFeatures(const DecoderEngineRequest & req, kaldi::Matrix<kaldi::BaseFloat> * feats);
+		void Decode(Worker & worker, const kaldi::Matrix<kaldi::BaseFloat> & feats, DecoderEngineResult & res);
+		void GetPronunciation(const std::string & word, DecoderEngineResult & res);
+		static void Deliver(Job * job, DecoderEngineResult & res);
+	};
+
+	void DecoderEngine::Impl::Clear()
+	{
+		trans_model.reset();
+		am_gmm.reset();
+		shortlist.reset();
+		packed_gmm.reset();
+		decode_fst.reset();
+		g_fst.reset();
+		hcl_fst.reset();
+		word_syms.reset();
+		g2p.reset();
+		refdict.clear();
+		lda_mat.Resize(0, 0);
+		use_mfcc = use_lda = false;
+		//the defaults of the options which are only set if the model directory has them
+		decoder_config = kaldi::LatticeFasterDecoderConfig();
+		mfcc_opts = kaldi::MfccOptions();
+		norm_means = true;
+		norm_vars = false;
+		delta_opts = kaldi::DeltaFeaturesOptions();
+		left_context = right_context = 4;
+	}
+
+	int DecoderEngine::Impl::Load(const DecoderEngineOptions & o)
+	{
+		Clear();
+		opts = o;
+		fs::path srcdir(opts.model.parent_path());
+		fs::path graph_fst, lookahead_g;
+		if (GetDecodingGraph(opts.graph_dir, graph_fst, lookahead_g) < 0) return -1;
+		std::vector<fs::path> required = { opts.model, graph_fst, opts.graph_dir / "words.txt" };
+		if (!opts.mfcc_config.empty()) required.push_back(opts.mfcc_config);
+		if (!opts.g2p_model.empty()) required.push_back(opts.g2p_model);
+		if (!opts.g2p_refdict.empty()) required.push_back(opts.g2p_refdict);
+		for (fs::path p : required) {
+			if (!fs::exists(p)) {
+				LOGTW_ERROR << "Failed to find " << p.string();
+				return -1;
+			}
+		}
+
+		try {
+			//acoustic model
+			{
+				bool binary;
+				kaldi::Input ki(opts.model.string(), &binary);
+				trans_model.reset(new kaldi::TransitionModel());
+				trans_model->Read(ki.Stream(), binary);
+				am_gmm.reset(new kaldi::AmDiagGmm());
+				am_gmm->Read(ki.Stream(), binary);
+			}
+			if (opts.use_shortlist) {
+				fs::path gsl(GetGaussianShortlist(opts.model));
+				if (gsl.empty()) {
+					LOGTW_ERROR << "There is no Gaussian shortlist for " << opts.model.string() << " (see BuildGaussianShortlist()).";
+					return -1;
+				}
+				shortlist.reset(new kaldi::AmDiagGmmShortlist());
+				kaldi::ReadKaldiObject(gsl.string(), shortlist.get());
+				if (!shortlist->IsCompatible(*am_gmm)) {
+					LOGTW_ERROR << "The Gaussian shortlist " << gsl.string() << " does not match the model " << opts.model.string();
+					return -1;
+				}
+				shortlist->Prepare(*am_gmm);
+			}
+			std::string precision_error;
+			if (!kaldi::CheckGmmPrecision(opts.gmm_precision, shortlist != nullptr, &precision_error)) {
+				LOGTW_ERROR << precision_error << ".";
+				return -1;
+			}
+			if (opts.gmm_precision != "float") {
+				kaldi::AmDiagGmmPackedType packed_type;
+				kaldi::GetAmDiagGmmPackedType(opts.gmm_precision, &packed_type);
+				packed_gmm.reset(new kaldi::AmDiagGmmPacked());
+				packed_gmm->Init(*am_gmm, packed_type);
+			}
+			//decoding graph
+			if (!lookahead_g.empty()) {
+				hcl_fst.reset(fst::StdOLabelLookAheadFst::Read(graph_fst.string()));
+				if (!hcl_fst) {
+					LOGTW_ERROR << "Could not read olabel_lookahead FST from " << graph_fst.string();
+					return -1;
+				}
+				g_fst.reset(fst::ReadFstKaldiGeneric(lookahead_g.string()));
+			}
+			else {
+				decode_fst.reset(fst::ReadFstKaldiGeneric(graph_fst.string()));
+			}
+			word_syms.reset(fst::SymbolTable::ReadText((opts.graph_dir / "words.txt").string()));
+			if (!word_syms) {
+				LOGTW_ERROR << "Could not read symbol table from file " << (opts.graph_dir / "words.txt").string();
+				return -1;
+			}
+			decoder_config.max_active = opts.max_active;
+			decoder_config.beam = opts.beam;
+			decoder_config.lattice_beam = opts.lattice_beam;
+
+			//features (as in Decode())
+			if (!opts.mfcc_config.empty()) {
+				kaldi::ReadConfigFromFile(opts.mfcc_config.string(), &mfcc_opts);
+				use_mfcc = true;
+			}
+			{
+				kaldi::ParseOptions po("");
+				po.Register("norm-means", &norm_means, "");
+				po.Register("norm-vars", &norm_vars, "");
+				ReadOptionsFile(srcdir / "cmvn_opts", po);
+			}
+			use_lda = fs::exists(srcdir / "final.mat");
+			if (use_lda) {
+				kaldi::ParseOptions po("");
+				po.Register("left-context", &left_context, "");
+				po.Register("right-context", &right_context, "");
+				ReadOptionsFile(srcdir / "splice_opts", po);
+				kaldi::ReadKaldiObject((srcdir / "final.mat").string(), &lda_mat);
+			}
+			else {
+				kaldi::ParseOptions po("");
+				delta_opts.Register(&po);
+				ReadOptionsFile(srcdir / "delta_opts", po);
+			}
+			LOGTW_INFO << "Feature type is " << (use_lda ? "lda" : "delta");
+
+			//G2P
+			if (!opts.g2p_model.empty())
+				g2p.reset(new PhonetisaurusScript(opts.g2p_model.string()));
+			if (!opts.g2p_refdict.empty()) {
+				StringTable t_dict;
+				if (ReadStringTable(opts.g2p_refdict.string(), t_dict) < 0) return -1;
+				static const boost::regex rexp("\\([0-9]+\\)");
+				for (string_vec & row : t_dict) {
+					if (row.size() < 2 || row[0][0] == '#') continue;
+					std::string word(boost::regex_replace(row[0], rexp, ""));
+					std::stringstream pron;
+					for (size_t i = 1; i < row.size() && row[i][0] != '#'; i++) {
+						if (i > 1) pron << " ";
+						pron << ConvertToCaseUtf8(row[i], true); //NOTE: phonemes upper case!
+					}
+					refdict.emplace(ConvertToCaseUtf8(word, false), pron.str()); //lower case, the first one is kept
+				}
+			}
+		}
+		catch (const std::exception & ex) {
+			LOGTW_ERROR << "Failed to load the models of the decoder engine. Reason: " << ex.what();
+			return -1;
+		}
+		return 0;
+	}
+
+	void DecoderEngine::Impl::ComputeFeatures(const DecoderEngineRequest & req, kaldi::Matrix<kaldi::BaseFloat> * feats)
+	{
+		kaldi::Matrix<kaldi::BaseFloat> raw;
+		if (req.type == DecoderEngineRequest::kPcm) {
+			if (!use_mfcc)
+				KALDI_ERR << "PCM request without an MFCC configuration (DecoderEngineOptions::mfcc_config)";
+			kaldi::Vector<kaldi::BaseFloat> wave(req.pcm.size(), kaldi::kUndefined);
+			for (size_t i = 0; i < req.pcm.size(); i++) wave(i) = req.pcm[i];
+			kaldi::Mfcc mfcc(mfcc_opts);
+			mfcc.ComputeFeatures(wave, req.sample_rate, 1.0, &raw);
+		}
+		else {
+			raw = req.features;
+		}
+		if (raw.NumRows() == 0)
+			KALDI_ERR << "Zero-length utterance";
+
+		//CMVN per utterance (there are no speaker statistics)
+		if (norm_means) {
+			kaldi::Matrix<double> stats;
+			kaldi::InitCmvnStats(raw.NumCols(), &stats);
+			kaldi::AccCmvnStats(raw, NULL, &stats);
+			kaldi::ApplyCmvn(stats, norm_vars, &raw);
+		}
+
+		if (!use_lda) {
+			kaldi::ComputeDeltas(delta_opts, raw, feats);
+			return;
+		}
+		kaldi::Matrix<kaldi::BaseFloat> spliced;
+		kaldi::SpliceFrames(raw, left_context, right_context, &spliced);
+		int32 dim = spliced.NumCols();
+		feats->Resize(spliced.NumRows(), lda_mat.NumRows(), kaldi::kUndefined);
+		if (lda_mat.NumCols() == dim) {
+			feats->AddMatMat(1.0, spliced, kaldi::kNoTrans, lda_mat, kaldi::kTrans, 0.0);
+		}
+		else if (lda_mat.NumCols() == dim + 1) {
+			kaldi::SubMatrix<kaldi::BaseFloat> linear_part(lda_mat, 0, lda_mat.NumRows(), 0, dim);
+			feats->AddMatMat(1.0, spliced, kaldi::kNoTrans, linear_part, kaldi::kTrans, 0.0);
+			kaldi::Vector<kaldi::BaseFloat> offset(lda_mat.NumRows());
+			offset.CopyColFromMat(lda_mat, dim);
+			feats->AddVecToRows(1.0, offset);
+		}
+		else {
+			KALDI_ERR << "Transform matrix has bad dimension " << lda_mat.NumRows() << "x" << lda_mat.NumCols()
+				<< " versus feature dim " << dim;
+		}
+	}
+
+	void DecoderEngine::Impl::Decode(Worker & worker, const kaldi::Matrix<kaldi::BaseFloat> & feats, DecoderEngineResult & res)
+	{
+		if (!worker.decoder) {
+			if (hcl_fst) {
+				//NOTE: the composition caches its states and therefore each worker has its own
+				worker.lookahead_fst.reset(fst::LookaheadComposeFst(*hcl_fst, *g_fst,
+					static_cast<size_t>(opts.lookahead_cache_mb) * 1024 * 1024));
+				worker.decoder.reset(new kaldi::LatticeFasterDecoder(*worker.lookahead_fst, decoder_config));
+			}
+			else {
+				worker.decoder.reset(new kaldi::LatticeFasterDecoder(*decode_fst, decoder_config));
+			}
+		}
+		else if (worker.lookahead_fst) {
+			//the compose state table keeps an entry for every composed state visited by the former requests; when it
+			//is too large the composition is started again (the decoder keeps a reference to the same FST object)
+			worker.lookahead_fst->ResetIfLarge();
+		}
+		kaldi::LatticeFasterDecoder & decoder = *worker.decoder;
+
+		kaldi::DecodableAmDiagGmmScaled gmm_decodable(*am_gmm, *trans_model, feats, opts.acwt);
+		gmm_decodable.SetShortlist(shortlist.get());
+		gmm_decodable.SetPackedModel(packed_gmm.get());
+		if (!decoder.Decode(&gmm_decodable))
+			KALDI_ERR << "Failed to decode";
+		res.reached_final = decoder.ReachedFinal();
+		if (!res.reached_final)
+			KALDI_WARN << "Outputting partial output for utterance " << res.id << " since no final-state reached";
+
+		fst::VectorFst<kaldi::LatticeArc> decoded;
+		if (!decoder.GetBestPath(&decoded))
+			KALDI_ERR << "Failed to get traceback";
+		std::vector<kaldi::int32> alignment, words;
+		kaldi::LatticeWeight weight;
+		fst::GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
+		res.num_frames = feats.NumRows();
+		res.likelihood = -(weight.Value1() + weight.Value2());
+		res.word_ids.assign(words.begin(), words.end());
+		std::stringstream text;
+		for (size_t i = 0; i < words.size(); i++) {
+			if (i > 0) text << " ";
+			text << word_syms->Find(words[i]);
+		}
+		res.text = text.str();
+
+		if (opts.output_lattice) {
+			kaldi::Lattice lat;
+			decoder.GetRawLattice(&lat);
+			fst::Connect(&lat);
+			if (!fst::DeterminizeLatticePhonePrunedWrapper(*trans_model, &lat, decoder_config.lattice_beam,
+				&res.lattice, decoder_config.det_opts))
+				KALDI_WARN << "Determinization finished earlier than the beam for utterance " << res.id;
+			fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / opts.acwt), &res.lattice);
+		}
+	}
+
+	void DecoderEngine::Impl::GetPronunciation(const std::string & word, DecoderEngineResult & res)
+	{
+		std::string w(word);
+		w = ConvertToCaseUtf8(w, false);
+		auto it = refdict.find(w);
+		if (it != refdict.end()) {
+			res.prons.push_back(it->second);
+			return;
+		}
+		if (!g2p)
+			KALDI_ERR << "The word " << word << " is not in the reference dictionary and there is no G2P model";
+		//NOTE: Phoneticize() does not modify the decoder and can be called by all workers at the same time
+		//NOTE: as in phonetisaurus-g2pfst, pmass 99.0 means no probability mass limit
+		std::vector<PathData> paths = g2p->Phoneticize(w, std::max(1, opts.g2p_nbest), 10000, 99.0f, false, false, 99.0);
+		for (const PathData & path : paths) {
+			std::stringstream pron;
+			for (size_t j = 0; j < path.Uniques.size(); j++) {
+				if (j > 0) pron << " ";
+				pron << g2p->osyms_->Find(path.Uniques[j]);
+			}
+			res.prons.push_back(pron.str());
+		}
+	}
+
+	void DecoderEngine::Impl::Process(Worker & worker, Job & job, DecoderEngineResult & res)
+	{
+		const DecoderEngineRequest & req = job.request;
+		res.id = req.id;
+		res.queue_seconds = job.timer.Elapsed();
+		kaldi::Timer timer;
+		KaldiErrorCapture error_capture;
+		try {
+			if (req.type == DecoderEngineRequest::kPronunciation) {
+				GetPronunciation(req.word, res);
+			}
+			else {
+				kaldi::Matrix<kaldi::BaseFloat> feats;
+				ComputeFeatures(req, &feats);
+				Decode(worker, feats, res);
+			}
+		}
+		catch (const std::exception & ex) {
+			res.status = -1;
+			res.error = error_capture.Message(ex);
+		}
+		res.process_seconds = timer.Elapsed();
+	}
+
+	void DecoderEngine::Impl::Deliver(Job * job, DecoderEngineResult & res)
+	{
+		try {
+			if (job->callback) job->callback(res);
+		}
+		catch (const std::exception & ex) {
+			LOGTW_ERROR << "Error in the callback of request " << res.id << ". Reason: " << ex.what();
+		}
+		if (job->has_promise) job->promise.set_value(std::move(res));
+		delete job;
+	}
+
+	//The worker threads take one request at a time from the queue (in the order of submission) and process it with
+	//their own decoder.
+	void DecoderEngine::Impl::Run()
+	{
+		Worker worker;
+		while (true) {
+			Job * job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cond.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (queue.empty()) return; //stopping
+				job = queue.front();
+				queue.pop_front();
+			}
+			DecoderEngineResult res;
+			Process(worker, *job, res);
+			num_done++;
+			Deliver(job, res);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+
+	DecoderEngine::DecoderEngine() : impl_(new Impl()) {}
+
+	DecoderEngine::~DecoderEngine()
+	{
+		Stop();
+		delete impl_;
+	}
+
+	int DecoderEngine::Start(const DecoderEngineOptions & opts)
+	{
+		Stop();
+		if (impl_->Load(opts) < 0) return -1;
+		int num_workers = (opts.num_workers > 0 ? opts.num_workers : std::thread::hardware_concurrency());
+		impl_->num_done = 0;
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			impl_->stopping = false;
+			impl_->running = true;
+		}
+		try {
+			for (int i = 0; i < std::max(1, num_workers); i++)
+				impl_->threads.emplace_back(&Impl::Run, impl_);
+		}
+		catch (const std::exception & ex) {
+			LOGTW_ERROR << "Failed to start the decoder engine. Reason: " << ex.what();
+			Stop();
+			return -1;
+		}
+		LOGTW_INFO << "Decoder engine started with " << impl_->threads.size() << " workers.";
+		return 0;
+	}
+
+	void DecoderEngine::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			if (!impl_->running) return;
+			impl_->running = false;
+			impl_->stopping = true;
+		}
+		impl_->cond.notify_all();
+		for (std::thread & t : impl_->threads) t.join();
+		impl_->threads.clear();
+		LOGTW_INFO << "Decoder engine stopped after " << impl_->num_done << " requests.";
+	}
+
+	bool DecoderEngine::IsRunning() const
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex);
+		return impl_->running;
+	}
+
+	size_t DecoderEngine::NumDone() const
+	{
+		return impl_->num_done;
+	}
+
+	std::future<DecoderEngineResult> DecoderEngine::Submit(DecoderEngineRequest request)
+	{
+		Impl::Job * job = new Impl::Job();
+		job->request = std::move(request);
+		job->has_promise = true;
+		std::future<DecoderEngineResult> f = job->promise.get_future();
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			if (impl_->running) {
+				impl_->queue.push_back(job);
+				job = NULL;
+			}
+		}
+		if (job == NULL) {
+			impl_->cond.notify_one();
+		}
+		else {
+			DecoderEngineResult res;
+			res.id = job->request.id;
+			res.status = -1;
+			res.error = "The decoder engine is not running";
+			Impl::Deliver(job, res);
+		}
+		return f;
+	}
+
+	void DecoderEngine::Submit(DecoderEngineRequest request, std::function<void(DecoderEngineResult &)> callback)
+	{
+		Impl::Job * job = new Impl::Job();
+		job->request = std::move(request);
+		job->callback = callback;
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			if (impl_->running) {
+				impl_->queue.push_back(job);
+				job = NULL;
+			}
+		}
+		if (job == NULL) {
+			impl_->cond.notify_one();
+		}
+		else {
+			DecoderEngineResult res;
+			res.id = job->request.id;
+			res.status = -1;
+			res.error = "The decoder engine is not running";
+			Impl::Deliver(job, res);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+
+	//Splits a request into the type, the id and the argument, which is the rest of the line (without the surrounding
+	//white space) so that it can be an rxfilename with spaces or a piped command as in wav.scp.
+	static bool SplitRequest(const std::string & request, std::string & type, std::string & id, std::string & arg)
+	{
+		static const char * white = " \t\r\n";
+		size_t type_begin = request.find_first_not_of(white);
+		size_t type_end = request.find_first_of(white, type_begin);
+		size_t id_begin = request.find_first_not_of(white, type_end);
+		size_t id_end = request.find_first_of(white, id_begin);
+		size_t arg_begin = request.find_first_not_of(white, id_end);
+		type = (type_begin == std::string::npos ? "" : request.substr(type_begin, type_end - type_begin));
+		id = (id_begin == std::string::npos ? "" : request.substr(id_begin, id_end - id_begin));
+		if (arg_begin == std::string::npos) {
+			arg.clear();
+			return false;
+		}
+		size_t arg_end = request.find_last_not_of(white);
+		arg = request.substr(arg_begin, arg_end + 1 - arg_begin);
+		return true;
+	}
+
+	std::future<std::string> DecoderEngineLoopback::CallAsync(const std::string & request)
+	{
+		std::string type, id, arg;
+		bool complete = SplitRequest(request, type, id, arg);
+		auto error = [&id](const std::string & msg) {
+			std::promise<std::string> p;
+			p.set_value("ERROR " + id + " " + msg);
+			return p.get_future();
+		};
+		if (!complete) return error("Wrong request: " + request);
+
+		DecoderEngineRequest req;
+		req.id = id;
+		KaldiErrorCapture error_capture;
+		try {
+			if (type == "DECODE") {
+				req.type = DecoderEngineRequest::kPcm;
+				kaldi::WaveData wave;
+				kaldi::Input ki(arg);
+				wave.Read(ki.Stream());
+				const kaldi::Matrix<kaldi::BaseFloat> & data = wave.Data();
+				req.pcm.assign(data.RowData(0), data.RowData(0) + data.NumCols()); //the first channel
+				req.sample_rate = wave.SampFreq();
+			}
+			else if (type == "FEATS") {
+				req.type = DecoderEngineRequest::kFeatures;
+				kaldi::ReadKaldiObject(arg, &req.features);
+			}
+			else if (type == "PRON") {
+				req.type = DecoderEngineRequest::kPronunciation;
+				req.word = arg;
+			}
+			else {
+				return error("Unknown request type " + type);
+			}
+		}
+		catch (const std::exception & ex) {
+			return error("Could not read the input of the request. " + error_capture.Message(ex));
+		}
+
+		std::shared_ptr<std::promise<std::string>> p = std::make_shared<std::promise<std::string>>();
+		std::future<std::string> f = p->get_future();
+		engine_.Submit(std::move(req), [p](DecoderEngineResult & res) {
+			std::string response;
+			if (res.status < 0) {
+				response = "ERROR " + res.id + " " + res.error;
+			}
+			else if (!res.prons.empty()) {
+				response = "OK " + res.id;
+				for (size_t i = 0; i < res.prons.size(); i++)
+					response += (i == 0 ? " " : " | ") + res.prons[i];
+			}
+			else {
+				response = "OK " + res.id + " " + res.text;
+			}
+			p->set_value(response);
+		});
+		return f;
+	}
+
+	std::string DecoderEngineLoopback::Call(const std::string & request)
+	{
+		return CallAsync(request).get();
+	}
+}
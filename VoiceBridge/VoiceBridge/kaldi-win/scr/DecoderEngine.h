@@ -0,0 +1,140 @@
+/*
+	Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+#pragma once
+
+#include "kaldi_scr.h"
+#include <functional>
+#include <future>
+#include "matrix/kaldi-matrix.h"
+#include "lat/kaldi-lattice.h"
+
+namespace VoiceBridge {
+
+	/*
+		DecoderEngine is a long-lived decoding service: the models are loaded once by Start() and kept in memory
+		(warm) until Stop(), and the decode and pronunciation requests of any number of client threads are processed
+		by a shared pool of worker threads. This is the in-memory alternative of calling Decode() or GetProns()
+		repeatedly, which load all models from disk and write all results to files for each call.
+		Each worker takes one request at a time from the queue and processes it on its own (the requests are not
+		batched: the frames of different requests are not scored together), so the throughput scales with the number
+		of workers and the latency of a request is that of a single decoding once a worker is free.
+
+		The decoding is speaker independent, with the features of Decode(): MFCC (for PCM requests) + CMN/CMVN per
+		utterance (cmvn_opts) + delta (delta_opts) or splice (splice_opts) + LDA/MLLT (final.mat), all read from the
+		directory of the model. The 1-best word sequence is returned (and the lattice on request).
+
+		Usage:
+			DecoderEngineOptions opts;
+			opts.model = dir / "final.mdl"; opts.graph_dir = dir / "graph"; opts.mfcc_config = conf / "mfcc.conf";
+			DecoderEngine engine;
+			if (engine.Start(opts) < 0) ...
+			DecoderEngineRequest req;
+			req.type = DecoderEngineRequest::kPcm; req.id = "utt1"; req.pcm = ...; req.sample_rate = 8000;
+			std::future<DecoderEngineResult> f = engine.Submit(req);	//or with a callback
+			DecoderEngineResult res = f.get();
+			engine.Stop();
+	*/
+	struct DecoderEngineOptions {
+		fs::path model;						//GMM model e.g. exp/tri2b/final.mdl; the feature options and final.mat are read from its directory
+		fs::path graph_dir;					//HCLG.fst (or HCLr.fst + Gr.fst, see GetDecodingGraph()) and words.txt
+		fs::path mfcc_config;				//MFCC configuration for PCM requests as in MakeMfcc() (empty: only feature requests)
+		fs::path g2p_model;					//Phonetisaurus G2P model for pronunciation requests (optional)
+		fs::path g2p_refdict;				//reference dictionary; words found in it are not decoded by the G2P model (optional)
+		int g2p_nbest = 1;					//number of pronunciations of a word which is not in the reference dictionary
+		int num_workers = 0;				//number of worker threads (0 = number of cores)
+		float acwt = 0.083333f;				//acoustic scale
+		int max_active = 7000;
+		double beam = 13.0;
+		double lattice_beam = 6.0;
+		bool output_lattice = false;		//if true, the determinized lattice is also returned (without acoustic scaling)
+		bool use_shortlist = false;			//see Decode()
+		std::string gmm_precision = "float";//see Decode()
+		int lookahead_cache_mb = 512;		//per worker, with the on the fly composed graph (HCLr.fst + Gr.fst); the
+											//composition is also started again between requests when its state table
+											//exceeds this size
+	};
+
+	struct DecoderEngineRequest {
+		enum Type {
+			kPcm,			//pcm and sample_rate
+			kFeatures,		//features
+			kPronunciation	//word
+		};
+		Type type = kPcm;
+		std::string id;									//returned in the result
+		std::vector<float> pcm;							//samples of one channel in the 16 bit range (as read by Kaldi from wav files)
+		float sample_rate = 16000.0f;
+		kaldi::Matrix<kaldi::BaseFloat> features;		//raw features as in feats.scp (before CMVN and deltas/LDA)
+		std::string word;
+	};
+
+	struct DecoderEngineResult {
+		std::string id;
+		int status = 0;									//0 = OK, -1 = error (see error)
+		std::string error;
+		std::string text;								//decoded words separated by a space
+		std::vector<int> word_ids;
+		int num_frames = 0;
+		double likelihood = 0.0;						//total log-likelihood of the best path
+		bool reached_final = false;						//false: partial result, no final state was reached
+		kaldi::CompactLattice lattice;					//with DecoderEngineOptions::output_lattice
+		std::vector<std::string> prons;					//pronunciation request: phones separated by a space (best first)
+		double queue_seconds = 0.0;						//time spent waiting in the queue
+		double process_seconds = 0.0;					//time spent in processing
+	};
+
+	class VOICEBRIDGE_API DecoderEngine
+	{
+	public:
+		DecoderEngine();
+		~DecoderEngine();
+		//Loads the models and starts the worker threads; returns -1 on error.
+		int Start(const DecoderEngineOptions & opts);
+		//Processes the requests which are already queued and stops the workers; the models stay loaded until the
+		//next Start() or the destruction of the engine.
+		void Stop();
+		bool IsRunning() const;
+		//Thread safe. The result is delivered through the future or by calling the callback in a worker thread
+		//(the callback must not block for long). After Stop() the result is an error.
+		std::future<DecoderEngineResult> Submit(DecoderEngineRequest request);
+		void Submit(DecoderEngineRequest request, std::function<void(DecoderEngineResult &)> callback);
+		//number of requests processed since Start()
+		size_t NumDone() const;
+
+	private:
+		struct Impl;
+		Impl * impl_;
+		DecoderEngine(const DecoderEngine &) = delete;
+		DecoderEngine & operator=(const DecoderEngine &) = delete;
+	};
+
+	/*
+		In-process loopback front end of the DecoderEngine with a line based text protocol, which is the same as a
+		(local) socket front end would use, without a connection. It is meant for testing the engine from several
+		client threads and as the message handler of a server. Requests:
+			DECODE <id> <wav-rxfilename>				(e.g. the entry of the utterance in wav.scp)
+			FEATS <id> <feature-rxfilename>				(e.g. raw_mfcc.1.ark:123 as in feats.scp)
+			PRON <id> <word>							(up to g2p_nbest pronunciations if the word is not in the reference dictionary)
+		The rxfilename is the rest of the line, so it may contain spaces (file names with spaces, piped commands
+		such as "sox a.wav -t wav - |").
+		Responses:
+			OK <id> <words or phones>					(for PRON the pronunciations, best first, separated by " | ")
+			ERROR <id> <message>
+	*/
+	class VOICEBRIDGE_API DecoderEngineLoopback
+	{
+	public:
+		explicit DecoderEngineLoopback(DecoderEngine & engine) : engine_(engine) {}
+		//Thread safe; blocks until the response is ready.
+		std::string Call(const std::string & request);
+		std::future<std::string> CallAsync(const std::string & request);
+
+	private:
+		DecoderEngine & engine_;
+	};
+}
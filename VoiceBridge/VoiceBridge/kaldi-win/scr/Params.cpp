@@ -6,6 +6,7 @@
 	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
 */
 #include "Params.h"
+#include "matrix/matrix-backend.h"
 
 VOICEBRIDGE_API VoiceBridge::Params voicebridgeParams;
 
@@ -13,7 +14,7 @@ VoiceBridge::Params::Params(void) {};
 
 VOICEBRIDGE_API bool VoiceBridge::Params::Init(std::string strain_base_name, std::string stest_base_name,
 	std::string sproject_base_dir, std::string sproject_input_dir,
-	std::string swaves_dir, std::string soov_word)
+	std::string swaves_dir, std::string soov_word, std::string smatrix_backend)
 {
 	//adjustable
 	train_base_name = strain_base_name;
@@ -22,8 +23,10 @@ VOICEBRIDGE_API bool VoiceBridge::Params::Init(std::string strain_base_name, std
 	project_input_dir = sproject_input_dir;
 	waves_dir = swaves_dir;
 	oov_word = soov_word;
+	matrix_backend = smatrix_backend;
 	//fixed
 	task_arpabo_name = "task.arpabo";
+	task_big_arpabo_name = "task_big.arpabo";
 	phones_txt_name = "phones.txt";
 	//init all paths
 	pth_project_base = fs::path(project_base_dir, fs::native);
@@ -53,5 +56,14 @@ VOICEBRIDGE_API bool VoiceBridge::Params::Init(std::string strain_base_name, std
 	//redirect all Kaldi messages to the global twin logging module
 	ReplaceKaldiLogHandlerEx(true);
 
+	//select the implementation of the matrix products for all Kaldi computations (before any thread is started)
+	kaldi::MatrixBackendType backend;
+	if (!kaldi::GetMatrixBackendType(matrix_backend, &backend)) {
+		LOGTW_WARNING << "Unknown matrix backend " << matrix_backend << ", using "
+			<< kaldi::MatrixBackendName(kaldi::kMatrixBackendBlas) << ".";
+		backend = kaldi::kMatrixBackendBlas;
+	}
+	kaldi::SetMatrixBackend(backend);
+
 	return true;
 };
@@ -20,7 +20,7 @@ namespace VoiceBridge {
 		Params(void);
 		VOICEBRIDGE_API bool Init(std::string strain_base_name, std::string stest_base_name,
 			std::string sproject_base_dir, std::string sproject_input_dir,
-			std::string swaves_dir, std::string soov_word = "<SIL>");
+			std::string swaves_dir, std::string soov_word = "<SIL>", std::string smatrix_backend = "blas");
 
 		//publicly accesible paths
 		fs::path pth_project_base;
@@ -44,7 +44,9 @@ namespace VoiceBridge {
 		std::string project_input_dir;
 		std::string waves_dir;
 		std::string oov_word;
+		std::string matrix_backend; //"blas" (the linked MKL or OpenBLAS) or "builtin" for GEMM/SYRK/GEMV (Kaldi matrix-backend.h)
 		std::string task_arpabo_name; //fixed 
+		std::string task_big_arpabo_name; //fixed, optional big LM for lattice rescoring (G.carpa)
 		std::string phones_txt_name; //fixed 
 	};
 }
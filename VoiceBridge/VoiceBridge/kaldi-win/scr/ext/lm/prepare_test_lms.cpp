@@ -63,6 +63,16 @@ VOICEBRIDGE_API int PrepareTestLms(const std::vector<std::string> & lms)
 			//return -1;
 		}
 
+		//Optional big LM for the second pass of a two-pass decoding (see LmRescoreConstArpa()).
+		//The (pruned) task.arpabo is compiled into G.fst and HCLG.fst for the first pass and the big LM
+		//is only converted to ConstArpaLm format (G.carpa) which is used to rescore the lattices.
+		fs::path big_arpa_rxfilename(voicebridgeParams.pth_project_input / voicebridgeParams.task_big_arpabo_name);
+		if (fs::exists(big_arpa_rxfilename)) {
+			LOGTW_INFO << "Building ConstArpaLm from " << big_arpa_rxfilename.string() << "...";
+			if (ArpaToConstArpa(big_arpa_rxfilename.string(), (path_test / "G.carpa").string(),
+				read_syms_filename.string(), "<s>", "</s>", voicebridgeParams.oov_word) < 0) return -1;
+		}
+
 	}
 
 	//DIAGNOSTICS:
@@ -48,6 +48,13 @@ int Sym2Int(StringTable symtab, StringTable input_txt, fs::path output_txt, int
 int Int2Sym(StringTable symtab, StringTable input_txt, fs::path output_txt, int field_begin, int field_end);
 int MakeLexiconFstSilprob(StringTable lexfn, StringTable silprobfile, fs::path output_txt, std::string silphone, std::string sildisambig);
 int MakeLexiconFst(StringTable lexfn, fs::path output_txt, bool pron_probs, double silprob, std::string silphone, std::string sildisambig);
+//in memory versions which write the compiled and sorted L.fst (or L_disambig.fst when the disambiguation symbol files are given)
+int MakeLexiconFstMem(StringTable & lexfn, StringTable & phones_table, StringTable & words_table, fs::path fst_out,
+	bool pron_probs, double silprob, std::string silphone, std::string sildisambig,
+	fs::path disambig_phones_int = "", fs::path disambig_words_int = "", int nj = 0);
+int MakeLexiconFstSilprobMem(StringTable & lexfn, StringTable & silprobfile, StringTable & phones_table, StringTable & words_table,
+	fs::path fst_out, std::string silphone, std::string sildisambig,
+	fs::path disambig_phones_int = "", fs::path disambig_words_int = "", int nj = 0);
 int GenerateTopology(int num_nonsil_states, int num_sil_states, StringTable nonsil_phones, StringTable sil_phones, fs::path path_topo_output);
 int ApplyUnkLM(StringTable input_unk_lm_fst, fs::path lang_dir);
 
@@ -68,12 +75,21 @@ int arpa2fst(std::string arpa_rxfilename, std::string fst_wxfilename,
 	bool keep_symbols = false, // = false;			Store symbol table with FST. Symbols always saved to FST if symbol tables are neither read or written (otherwise symbols would be lost entirely)
 	bool ilabel_sort = true); //= true				Ilabel-sort the output FST
 
+int ArpaToConstArpa(std::string arpa_rxfilename, std::string const_arpa_wxfilename,
+	std::string read_syms_filename,		//e.g. "data/lang_test/words.txt"
+	std::string bos_symbol = "<s>",		//Beginning of sentence symbol
+	std::string eos_symbol = "</s>",	//End of sentence symbol
+	std::string unk_symbol = "");		//Unknown-word symbol, "" if none
+
 VOICEBRIDGE_API int MakeMfcc(
 	fs::path datadir,			//data directory
 	fs::path mfcc_config,		//mfcc config file path
 	int nj=4,						//default: 4, number of parallel jobs
 	bool compress=true,				//default: true, compress mfcc features
-	bool write_utt2num_frames=false	//default: false, if true writes utt2num_frames	
+	bool write_utt2num_frames=false,	//default: false, if true writes utt2num_frames	
+	bool compute_cmvn=false,		//default: false, if true computes the per speaker CMVN stats (cmvn.scp) during feature extraction
+	std::string cmvn_fake_dims="",	//only with compute_cmvn; generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	bool incremental=false			//default: false, if true only the new or changed utterances are extracted (see data_fingerprint.cpp)
 );
 
 int spk2utt_to_utt2spk(StringTable & spk2utt, StringTable & utt2spk);
@@ -90,11 +106,30 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 	bool two_channel = false,	//default: false, is for two-channel telephone data, there must be no segments
 								//file and reco2file_and_channel must be present. It will take only frames 
 								//that are louder than the other channel.
-	std::string fake_dims=""	//Generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	std::string fake_dims="",	//Generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	bool incremental=false		//default: false, if true only the speakers with new, changed or removed utterances get new stats
 );
+int MergeCmvnStats(fs::path datadir, std::vector<fs::path> partial_stats, std::string fake_dims="");
+
+/*incremental data directory processing (data_fingerprint.cpp)*/
+struct IncrementalFeats {
+	int num_reused = 0;				//number of utterances which keep their features
+	int num_extract = 0;			//number of new or changed utterances
+	fs::path scp;					//wav.scp or segments with the utterances to extract
+	std::string suffix;				//appended to the archive names in order not to overwrite the reused archives
+	StringTable reused_feats, reused_num_frames;
+	UMAPSS utt2fingerprint;
+};
+std::string IncrementalSuffix();
+int PrepareIncrementalFeats(fs::path datadir, fs::path old_feats, std::vector<fs::path> configs, IncrementalFeats & inc);
+int FinishIncrementalFeats(fs::path datadir, IncrementalFeats & inc, bool write_utt2num_frames);
+int SpeakerFingerprints(fs::path datadir, std::string mode, UMAPSS & spk2fingerprint);
+int PrepareIncrementalCmvn(fs::path datadir, std::string mode, fs::path affected_spk2utt, StringTable & reused_cmvn, int & num_affected);
+int SaveSpeakerFingerprints(fs::path datadir, std::string mode);
 
 VOICEBRIDGE_API int FixDataDir(fs::path datadir, std::vector<fs::path> spk_extra_files = {}, std::vector<fs::path> utt_extra_files = {});
 int FilterScp(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude=false, int field=0);
+int FilterScpSorted(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude=false, int field=0);
 int FilterScps(int jobstart, int jobend, fs::path idlist, fs::path in_scp, fs::path out_scp, bool no_warn=false, int field=0);
 
 /*training of a Gmm monophone model*/
@@ -121,9 +156,21 @@ int AnalyzePhoneLengthStats(
 
 VOICEBRIDGE_API int MkGraph(fs::path lang_dir, fs::path model_dir, fs::path graph_dir,
 	bool remove_oov=false, //If true, any paths containing the OOV symbol (obtained from oov.int in the lang directory) are removed from the G.fst during compilation.
+	double tscale=1.0,	 //Scaling factor on transition probabilities.
+	double loopscale=0.1, //see: http://kaldi-asr.org/doc/hmm.html#hmm_scale
+	bool packed_graph=false //If true, also writes graph_dir/HCLGp.fst: HCLG.fst with the states reordered for locality
+							//and the arcs stored as separate arrays, which LatticeFasterDecoder traverses faster.
+);
+
+//Decoding graph for on-the-fly composition: graph_dir/HCLr.fst (olabel_lookahead HCL) and graph_dir/Gr.fst.
+//Decode() and DecodeFmllr() use it automatically when there is no HCLG.fst in graph_dir.
+VOICEBRIDGE_API int MkGraphLookahead(fs::path lang_dir, fs::path model_dir, fs::path graph_dir,
 	double tscale=1.0,	 //Scaling factor on transition probabilities.
 	double loopscale=0.1 //see: http://kaldi-asr.org/doc/hmm.html#hmm_scale
 );
+//Replaces graph_dir/Gr.fst with a new G.fst (same words.txt) without rebuilding HCLr.fst.
+VOICEBRIDGE_API int MakeLookaheadG(fs::path g_in, fs::path graph_dir);
+int GetDecodingGraph(fs::path graph_dir, fs::path & graph_fst, fs::path & lookahead_g);
 
 int AnalyzeLats(
 	fs::path lang,				//lang directory
@@ -161,10 +208,36 @@ VOICEBRIDGE_API int Decode(
 	bool stats = true,								//output statistics
 	std::string word_ins_penalty = "0.0,0.5,1.0",	//word insertion penalty
 	int min_lmwt = 7,								//minumum LM-weight for lattice rescoring
-	int max_lmwt = 17								//maximum LM-weight for lattice rescoring
+	int max_lmwt = 17,								//maximum LM-weight for lattice rescoring
+	//latency-bounded decoding: if one of these is > 0 then beam and max_active are upper limits and the decoder
+	//adapts them frame by frame to stay within the target; the adaptation is reported in the decode.JOB.log files.
+	double target_rtf = 0.0,						//target real-time factor of the decoding (per job)
+	int target_active = 0,							//target number of active tokens per frame
+	bool use_shortlist = false,						//if true, only the Gaussians selected by the shortlist of the model (final.gsl, see
+													//BuildGaussianShortlist()) are evaluated; faster at a small loss of accuracy
+	std::string gmm_precision = "float"			//precision of the GMM parameters in the likelihood computation: "float", "float16"
+													//or "int8" (less memory traffic at a small loss of accuracy; not with use_shortlist)
 );
 
 
+VOICEBRIDGE_API int LmRescoreConstArpa(
+	fs::path old_lang_dir,						//lang directory of the small (pruned) LM used for the first pass decoding (G.fst)
+	fs::path new_lang_dir,						//lang directory with the big LM in ConstArpaLm format (G.carpa)
+	fs::path data_dir,							//data
+	fs::path decode_dir_in,						//decode directory of the first pass (lat.*)
+	fs::path decode_dir_out,					//output decode directory for the rescored lattices
+	UMAPSS & wer_ref_filter,					//ref filter NOTE: can be empty but must be defined!
+	UMAPSS & wer_hyp_filter,					//hyp filter NOTE: can be empty but must be defined!
+	int stage = 0,
+	bool skip_scoring = false,
+	//scoring options:
+	bool decode_mbr = false,						//maximum bayes risk decoding (confusion network).
+	bool stats = true,								//output statistics
+	std::string word_ins_penalty = "0.0,0.5,1.0",	//word insertion penalty
+	int min_lmwt = 7,								//minumum LM-weight for lattice rescoring
+	int max_lmwt = 17								//maximum LM-weight for lattice rescoring
+);
+
 int ScoreKaldiWER(
 	fs::path data,
 	fs::path lang_or_graph,
@@ -240,6 +313,16 @@ VOICEBRIDGE_API int AlignSi(
 
 int CheckPhonesCompatible(fs::path table_first, fs::path table_second);
 
+//Writes dir/final.gsl, the Gaussian shortlist of dir/final.mdl (see gmm/am-diag-gmm-shortlist.h); called by
+//TrainDeltas(), TrainLdaMllt() and TrainSat() and used by Decode() and DecodeFmllr() with use_shortlist=true.
+int BuildGaussianShortlist(
+	fs::path dir,				//training directory with final.mdl and final.occs
+	int num_clusters = 256,		//number of clusters (Gaussians of the clustering UBM)
+	int num_top_clusters = 16	//default number of clusters selected per frame
+);
+//Returns the up to date Gaussian shortlist of the model (e.g. final.gsl for final.mdl) or "" if there is none.
+fs::path GetGaussianShortlist(fs::path model);
+
 VOICEBRIDGE_API int TrainDeltas(
 	fs::path data,				//data directory
 	fs::path lang,				//language directory
@@ -301,7 +384,48 @@ VOICEBRIDGE_API int DecodeFmllr(
 	bool stats = true,								//output statistics
 	std::string word_ins_penalty = "0.0,0.5,1.0",	//word insertion penalty
 	int min_lmwt = 7,								//minumum LM-weight for lattice rescoring
-	int max_lmwt = 17								//maximum LM-weight for lattice rescoring
+	int max_lmwt = 17,								//maximum LM-weight for lattice rescoring
+	//latency-bounded decoding: if one of these is > 0 then beam and max_active are upper limits and the decoder
+	//adapts them frame by frame to stay within the target; the adaptation is reported in the decode.JOB.log files.
+	double target_rtf = 0.0,						//target real-time factor of the decoding (per job)
+	int target_active = 0,							//target number of active tokens per frame
+	bool use_shortlist = false,						//if true, only the Gaussians selected by the shortlist of the model (final.gsl, see
+													//BuildGaussianShortlist()) are evaluated; faster at a small loss of accuracy
+	std::string gmm_precision = "float"			//precision of the GMM parameters in the likelihood computation: "float", "float16"
+													//or "int8" (less memory traffic at a small loss of accuracy; not with use_shortlist)
+);
+
+//Single-pass basis fMLLR decoding: a lightweight speaker independent first pass, basis fMLLR transforms per speaker
+//or per utterance (needs srcdir/fmllr.basis, see TrainSat()) and one adapted main search with the final model.
+//Much faster than DecodeFmllr() and better for short utterances of unseen speakers.
+VOICEBRIDGE_API int DecodeBasisFmllr(
+	fs::path graph_dir,								//graphdir
+	fs::path data_dir,								//data
+	fs::path decode_dir,							//dir - is assumed to be a sub-directory of the directory where the model is.
+	fs::path alignment_model = "",					//Model of the first pass (default: final.alimdl or final.mdl)
+	fs::path final_model = "",						//Model to compute the transforms with and to decode with (default: final.mdl)
+	int nj = 4,										//default: 4, number of parallel jobs
+	float acwt = 0.083333,							//acoustic scale used for lattice generation and posteriors
+	int stage = 0,									//
+	int max_active = 7000,							//
+	double beam = 13.0,								//Pruning beam [applied after acoustic scaling]
+	double lattice_beam = 6.0,						//
+	double silence_weight = 0.01,
+	fs::path si_dir = "",							//use this to skip 1st pass of decoding, caution-- must be with same tree
+	bool per_utt = false,							//if true, one transform per utterance instead of per speaker
+	int first_max_active = 1000,					//max-active of the lightweight first pass
+	double first_beam = 8.0,						//beam of the lightweight first pass
+	//scoring options:
+	bool skip_scoring = false,						//
+	bool decode_mbr = false,						//maximum bayes risk decoding (confusion network).
+	bool stats = true,								//output statistics
+	std::string word_ins_penalty = "0.0,0.5,1.0",	//word insertion penalty
+	int min_lmwt = 7,								//minumum LM-weight for lattice rescoring
+	int max_lmwt = 17,								//maximum LM-weight for lattice rescoring
+	double target_rtf = 0.0,						//latency-bounded decoding, see DecodeFmllr()
+	int target_active = 0,							//
+	bool use_shortlist = false,						//see DecodeFmllr()
+	std::string gmm_precision = "float"			//see DecodeFmllr()
 );
 
 VOICEBRIDGE_API int GetProns(
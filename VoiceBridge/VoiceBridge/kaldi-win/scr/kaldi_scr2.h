@@ -23,6 +23,9 @@ VOICEBRIDGE_API int MakeMfccPitch(
 	int nj = 4,								//default: 4, number of parallel jobs
 	bool compress = true,					//default: true, compress mfcc features
 	bool write_utt2num_frames = false,		//default: false, if true writes utt2num_frames	
-	int paste_length_tolerance = 2			//default: 2
+	int paste_length_tolerance = 2,			//default: 2
+	bool compute_cmvn = false,				//default: false, if true computes the per speaker CMVN stats (cmvn.scp) during feature extraction
+	std::string cmvn_fake_dims = "",		//only with compute_cmvn; generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	bool incremental = false				//default: false, if true only the new or changed utterances are extracted (see data_fingerprint.cpp)
 );
 
@@ -17,7 +17,6 @@ static void LaunchJobGmmAlignCompiled(
 	string_vec options_adddeltas,
 	string_vec options_splicefeats,
 	string_vec options_transformfeats,
-	string_vec options_ctgraphs,
 	string_vec options_gmmalignedcomp,
 	bool use_graphs,
 	std::string feat_type,
@@ -33,7 +32,7 @@ static std::vector<int> _ret;
 	Computes training alignments using a model with delta or LDA+MLLT features.
 	It checks if the training graphs exist and compatible with the chosen number of jobs (nj),
 	if yes then it will use the training graphs from the source directory (where the model is).
-	If not then it will generate the training graphs automatically.
+	If not then the training graphs are compiled on demand while aligning (GmmAlign).
 */
 VOICEBRIDGE_API int AlignSi(
 	fs::path data,		//data directory
@@ -158,13 +157,13 @@ VOICEBRIDGE_API int AlignSi(
 	//check compatibility
 	if (nj != nj_orig)
 	{
-		LOGTW_WARNING << "The number of jobs used for the model mismatches alignment destination. Must recreate graphs.";
+		LOGTW_WARNING << "The number of jobs used for the model mismatches alignment destination. The graphs will be compiled while aligning.";
 		use_graphs = false;
 	}
 	//check if all files exist
 	for (int JOBID = 1; JOBID <= nj; JOBID++) {
 		if (!fs::exists(srcdir / ("fsts." + std::to_string(JOBID)))) {
-			LOGTW_WARNING << (srcdir / ("fsts." + std::to_string(JOBID))).string() << " does not exist. Must recreate graphs.";
+			LOGTW_INFO << (srcdir / ("fsts." + std::to_string(JOBID))).string() << " does not exist. The graphs will be compiled while aligning.";
 			use_graphs = false;
 			break;
 		}
@@ -207,7 +206,7 @@ VOICEBRIDGE_API int AlignSi(
 	//
 	//Prepare all parameters for the funcions which will be called in the parallel processing unit
 	//
-	string_vec options_applycmvn, options_adddeltas, options_splicefeats, options_transformfeats, options_ctgraphs;
+	string_vec options_applycmvn, options_adddeltas, options_splicefeats, options_transformfeats;
 	//prepare the options for apply-cmvn			
 	options_applycmvn.push_back("--print-args=false"); //NOTE: do not print arguments
 	//parse and add cmvn_opts (space delimited collection of options on one line)
@@ -242,7 +241,7 @@ VOICEBRIDGE_API int AlignSi(
 		options_transformfeats.push_back("ark:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
 	}
 			
-	//options for compile-train-graphs	
+	//transcripts for the training graphs
 	//Sym2Int
 	std::string symtab((lang / "words.txt").string());
 	std::string input_txt((sdata / "JOBID" / "text").string());
@@ -250,16 +249,8 @@ VOICEBRIDGE_API int AlignSi(
 	//oov is defined above
 	int field_begin = 1; //NOTE: zero based index of fields! 2nd field is index=1
 	int field_end = -1;	
-	//
-	options_ctgraphs.push_back("--print-args=false");
-	options_ctgraphs.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
-	options_ctgraphs.push_back((dir / "tree").string());
-	options_ctgraphs.push_back((dir / "final.mdl").string());
-	options_ctgraphs.push_back((lang / "L.fst").string());
-	options_ctgraphs.push_back((dir / "trnrspec.JOBID.temp").string()); //output from Sym2Int
-	options_ctgraphs.push_back("ark:" + (dir / "fsts.JOBID").string()); //output
-
-	//options GmmAlignCompiled
+
+	//options GmmAlignCompiled (graphs from srcdir) or GmmAlign (graphs compiled on demand from the transcripts)
 	string_vec options_gmmalignedcomp;
 	options_gmmalignedcomp.push_back("--print-args=false");
 	std::string scareful = (careful ? "true" : "false");
@@ -269,15 +260,16 @@ VOICEBRIDGE_API int AlignSi(
 	options_gmmalignedcomp.push_back("--transition-scale=" + std::to_string(transitionscale));
 	options_gmmalignedcomp.push_back("--acoustic-scale=" + std::to_string(acousticscale));
 	options_gmmalignedcomp.push_back("--self-loop-scale=" + std::to_string(selfloopscale));
-	options_gmmalignedcomp.push_back((dir / "final.bs.temp").string()); //output from boost silence!
-
-	//in case we need to make the graphs then make them in 'dir' and use them from there
 	if (!use_graphs) {
-		//use the output from compile-train-graphs
-		options_gmmalignedcomp.push_back("ark:" + (dir / "fsts.JOBID").string());
+		//the graphs are compiled in batches while aligning (no fsts.JOBID archives are written)
+		options_gmmalignedcomp.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
+		options_gmmalignedcomp.push_back((dir / "tree").string());
+		options_gmmalignedcomp.push_back((dir / "final.bs.temp").string()); //output from boost silence!
+		options_gmmalignedcomp.push_back((lang / "L.fst").string());
 	}
 	else {
 		//we have the graphs in the srcdir
+		options_gmmalignedcomp.push_back((dir / "final.bs.temp").string()); //output from boost silence!
 		options_gmmalignedcomp.push_back("ark:" + (srcdir / "fsts.JOBID").string());
 	}
 
@@ -287,6 +279,9 @@ VOICEBRIDGE_API int AlignSi(
 	else {
 		options_gmmalignedcomp.push_back("ark:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
 	}
+	if (!use_graphs) {
+		options_gmmalignedcomp.push_back("ark:" + output_txt); //output from Sym2Int
+	}
 	options_gmmalignedcomp.push_back("ark:" + (dir / "ali.JOBID").string()); //output 
 
 
@@ -306,7 +301,6 @@ VOICEBRIDGE_API int AlignSi(
 			options_adddeltas,
 			options_splicefeats,
 			options_transformfeats,
-			options_ctgraphs,
 			options_gmmalignedcomp,
 			use_graphs,
 			feat_type,
@@ -415,7 +409,6 @@ static void LaunchJobGmmAlignCompiled(
 	string_vec options_adddeltas,
 	string_vec options_splicefeats,
 	string_vec options_transformfeats,
-	string_vec options_ctgraphs,
 	string_vec options_gmmalignedcomp,
 	bool use_graphs,
 	std::string feat_type,
@@ -426,6 +419,7 @@ static void LaunchJobGmmAlignCompiled(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_splicefeats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -510,9 +504,8 @@ static void LaunchJobGmmAlignCompiled(
 
 	//
 	if (!use_graphs)
-	{ //need first to create graphs //NOTE: in the options_gmmalignedcomp the output is set accordingly!
+	{ //need first the transcripts for the graphs //NOTE: in the options_gmmalignedcomp the input is set accordingly!
 
-		//create graphs
 		//Sym2Int
 		StringTable t_symtab, t_input;
 		if (ReadStringTable(symtab, t_symtab) < 0) {
@@ -535,33 +528,17 @@ static void LaunchJobGmmAlignCompiled(
 			_ret.push_back(-1);
 			return;
 		}
-
-		//compile train graphs
-		try {
-			StrVec2Arg args(options_ctgraphs);
-			ret = CompileTrainGraphs(args.argc(), args.argv(), file_log);
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (CompileTrainGraphs). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
-		if (ret < 0) {
-			//do not proceed if failed
-			_ret.push_back(ret);
-			return;
-		}
 	}
 
-	//DO: GmmAlignCompiled
+	//DO: GmmAlignCompiled or GmmAlign
 	try {
 		StrVec2Arg args(options_gmmalignedcomp);
-		ret = GmmAlignCompiled(args.argc(), args.argv(), file_log);
+		if (use_graphs) ret = GmmAlignCompiled(args.argc(), args.argv(), file_log);
+		else ret = GmmAlign(args.argc(), args.argv(), file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (GmmAlignCompiled). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmAlign). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
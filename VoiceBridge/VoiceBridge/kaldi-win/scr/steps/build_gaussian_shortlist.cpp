@@ -0,0 +1,71 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+/*
+ Builds the Gaussian shortlist (dir/final.gsl) of a trained GMM model (dir/final.mdl, dir/final.occs).
+ It is called at the end of the training of the triphone models; Decode() and DecodeFmllr() use it
+ when use_shortlist is true (only the Gaussians of the best clusters are evaluated in each frame).
+*/
+
+#include "kaldi-win/scr/kaldi_scr.h"
+#include "kaldi-win/src/kaldi_src.h"
+#include <kaldi-win/utility/strvec2arg.h>
+
+int BuildGaussianShortlist(
+	fs::path dir,			//training directory
+	int num_clusters,		//number of clusters (Gaussians of the clustering UBM)
+	int num_top_clusters	//default number of clusters selected per frame
+)
+{
+	std::vector<fs::path> _f = { dir / "final.mdl", dir / "final.occs" };
+	for each(fs::path f in _f) {
+		if (!fs::exists(f)) {
+			LOGTW_ERROR << "Expecting file " << f.string() << " to exist.";
+			return -1;
+		}
+	}
+	if (CreateDir(dir / "log", false) < 0) return -1;
+
+	try {
+		string_vec options;
+		options.push_back("--print-args=false");
+		options.push_back("--num-clusters=" + std::to_string(num_clusters));
+		options.push_back("--num-top-clusters=" + std::to_string(num_top_clusters));
+		options.push_back((dir / "final.mdl").string());
+		options.push_back((dir / "final.occs").string());
+		options.push_back((dir / "final.gsl").string());
+		StrVec2Arg args(options);
+		//log
+		fs::ofstream file_log(dir / "log" / "shortlist.log", fs::ofstream::binary | fs::ofstream::out);
+		if (!file_log) LOGTW_WARNING << " log file is not accessible " << (dir / "log" / "shortlist.log").string() << ".";
+		//
+		if (GmmBuildShortlist(args.argc(), args.argv(), file_log) < 0) return -1;
+	}
+	catch (const std::exception& ex)
+	{
+		LOGTW_FATALERROR << " in (GmmBuildShortlist). Reason: " << ex.what();
+		return -1;
+	}
+
+	return 0;
+}
+
+fs::path GetGaussianShortlist(fs::path model)
+{
+	//the shortlist belongs to the .mdl of the same name (not e.g. to final.alimdl of a SAT system)
+	fs::path gsl(model.parent_path() / (model.stem().string() + ".gsl"));
+	if (model.extension() != ".mdl" || !fs::exists(gsl)) {
+		LOGTW_WARNING << "No Gaussian shortlist for " << model.string() << ", evaluating all Gaussians.";
+		return "";
+	}
+	if (fs::last_write_time(gsl) < fs::last_write_time(model)) {
+		LOGTW_WARNING << "The Gaussian shortlist " << gsl.string() << " is older than the model, evaluating all Gaussians.";
+		return "";
+	}
+	return gsl;
+}
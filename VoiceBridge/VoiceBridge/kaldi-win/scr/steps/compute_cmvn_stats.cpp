@@ -19,6 +19,10 @@ Based on : Copyright 2012-2016  Johns Hopkins University (Author: Daniel Povey),
 #include "kaldi-win/scr/kaldi_scr.h"
 #include "kaldi-win/src/kaldi_src.h"
 #include <kaldi-win/utility/strvec2arg.h>
+#include "util/common-utils.h"
+#include "transform/cmvn.h"
+
+static int FinishCmvnStats(fs::path datadir, fs::path cmvn_scp, std::string name, const StringTable & tbl_spk2utt, std::string mode);
 
 VOICEBRIDGE_API int ComputeCmvnStats(
 	fs::path datadir,			//data directory
@@ -26,7 +30,9 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 	bool two_channel,			//default: false, is for two-channel telephone data, there must be no segments
 								//file and reco2file_and_channel must be present. It will take only frames 
 								//that are louder than the other channel.
-	std::string fake_dims		//Generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	std::string fake_dims,		//Generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+	bool incremental			//default: false, if true only the speakers with new, changed or removed utterances get new stats,
+								//the stats of the other speakers are reused from cmvn.scp (not with fake or two_channel)
 )
 {
 	fs::path logdir = datadir / "log";
@@ -53,6 +59,19 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 	StringTable tbl_spk2utt;
 	if (ReadStringTable((datadir / "spk2utt").string(), tbl_spk2utt) < 0) return -1;
 
+	std::string mode = fake ? "fake" : (two_channel ? "two_channel" : "cmvn:" + fake_dims);
+	fs::path spk2utt = datadir / "spk2utt";
+	std::string cmvnname = "cmvn_" + name;
+	StringTable reused_cmvn;
+	int num_affected = (int)tbl_spk2utt.size();
+	if (incremental && !fake && !two_channel) {
+		spk2utt = logdir / ("spk2utt_" + name + ".incremental");
+		if (PrepareIncrementalCmvn(datadir, mode, spk2utt, reused_cmvn, num_affected) < 0) return -1;
+		LOGTW_INFO << "Incremental mode: reusing the CMVN stats of " << reused_cmvn.size() << " speakers, computing " << num_affected << ".";
+		//new archive name in order not to overwrite the reused stats
+		if (reused_cmvn.size() > 0) cmvnname += IncrementalSuffix();
+	}
+
 	if (fake)
 	{
 		//add all options 
@@ -94,7 +113,7 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 		options.clear();
 		options.push_back("--print-args=false"); //NOTE: do not print arguments
 		options.push_back("ark:" + (datadir / "fake.temp").string());
-		options.push_back("ark,scp:" + (cmvndir / ("cmvn_"+name+".ark")).string() + "," + (cmvndir / ("cmvn_"+name+".scp")).string());
+		options.push_back("ark,scp:" + (cmvndir / (cmvnname + ".ark")).string() + "," + (cmvndir / (cmvnname + ".scp")).string());
 		StrVec2Arg args1(options);
 		//redirect logging to the log file:
 		fs::path log(cmvndir / ("cmvn_" + name + ".ark.log"));
@@ -116,7 +135,7 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 		options.push_back("--print-args=false"); //NOTE: do not print arguments
 		options.push_back((datadir / "reco2file_and_channel").string());
 		options.push_back("scp:" + (datadir / "feats.scp").string());
-		options.push_back("ark,scp:" + (cmvndir / ("cmvn_" + name + ".ark")).string() + "," + (cmvndir / ("cmvn_" + name + ".scp")).string());
+		options.push_back("ark,scp:" + (cmvndir / (cmvnname + ".ark")).string() + "," + (cmvndir / (cmvnname + ".scp")).string());
 		StrVec2Arg args(options);
 		fs::path log(cmvndir / ("cmvn_" + name + ".log"));
 		fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
@@ -126,13 +145,17 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 			return -1;
 		}
 	}
+	else if (num_affected == 0)
+	{
+		//incremental: all stats are reused
+	}
 	else if (fake_dims!="")
 	{
 		string_vec options;
 		options.push_back("--print-args=false"); //NOTE: do not print arguments
-		options.push_back("--spk2utt=ark:" + (datadir / "spk2utt").string());
+		options.push_back("--spk2utt=ark:" + spk2utt.string());
 		options.push_back("scp:" + (datadir / "feats.scp").string());
-		options.push_back("ark:" + (cmvndir / ("cmvn_" + name + ".ark.temp")).string()); //NOTE: temp output for as input to modify-cmvn-stats
+		options.push_back("ark:" + (cmvndir / (cmvnname + ".ark.temp")).string()); //NOTE: temp output for as input to modify-cmvn-stats
 		StrVec2Arg args(options);
 		fs::path log(cmvndir / ("cmvn_" + name + ".log"));
 		fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
@@ -146,8 +169,8 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 		options.clear();
 		options.push_back("--print-args=false"); //NOTE: do not print arguments
 		options.push_back(fake_dims);
-		options.push_back("ark:" + (cmvndir / ("cmvn_" + name + ".ark.temp")).string());
-		options.push_back("ark,scp:" + (cmvndir / ("cmvn_" + name + ".ark")).string() + "," + (cmvndir / ("cmvn_" + name + ".scp")).string());
+		options.push_back("ark:" + (cmvndir / (cmvnname + ".ark.temp")).string());
+		options.push_back("ark,scp:" + (cmvndir / (cmvnname + ".ark")).string() + "," + (cmvndir / (cmvnname + ".scp")).string());
 		StrVec2Arg args1(options);
 		fs::ofstream file_log1(log, fs::ofstream::binary | fs::ofstream::app);
 		if (!file_log1) LOGTW_WARNING << " log file is not accessible " << log.string() << ".";
@@ -156,7 +179,7 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 			return -1;
 		}
 		try {
-			fs::remove(cmvndir / ("cmvn_" + name + ".ark.temp"));
+			fs::remove(cmvndir / (cmvnname + ".ark.temp"));
 		}
 		catch (const std::exception&) {}
 	}
@@ -164,9 +187,9 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 	{
 		string_vec options;
 		options.push_back("--print-args=false"); //NOTE: do not print arguments
-		options.push_back("--spk2utt=ark:" + (datadir / "spk2utt").string());
+		options.push_back("--spk2utt=ark:" + spk2utt.string());
 		options.push_back("scp:" + (datadir / "feats.scp").string());
-		options.push_back("ark,scp:" + (cmvndir / ("cmvn_" + name + ".ark")).string() + "," + (cmvndir / ("cmvn_" + name + ".scp")).string());
+		options.push_back("ark,scp:" + (cmvndir / (cmvnname + ".ark")).string() + "," + (cmvndir / (cmvnname + ".scp")).string());
 		StrVec2Arg args(options);
 		fs::path log(cmvndir / ("cmvn_" + name + ".log"));
 		fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
@@ -177,8 +200,100 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 		}
 	}
 
+	if (reused_cmvn.size() > 0) {
+		StringTable t_cmvn;
+		fs::path cmvn_scp(cmvndir / (cmvnname + ".scp"));
+		if (num_affected > 0 && ReadStringTable(cmvn_scp.string(), t_cmvn) < 0) return -1;
+		t_cmvn.insert(t_cmvn.end(), reused_cmvn.begin(), reused_cmvn.end());
+		if (SortStringTable(t_cmvn, 0, 0, "string", "string") < 0) return -1;
+		if (SaveStringTable(cmvn_scp.string(), t_cmvn) < 0) return -1;
+	}
+	if (spk2utt != datadir / "spk2utt") {
+		try {
+			fs::remove(spk2utt);
+		} catch (const std::exception&) {}
+	}
+
+	return FinishCmvnStats(datadir, cmvndir / (cmvnname + ".scp"), name, tbl_spk2utt, mode);
+}
+
+/*
+ Sums the partial per-speaker CMVN stats written by the feature extraction jobs (copy-feats --write-cmvn-stats,
+ see MakeMfcc() and MakeMfccPitch() with compute_cmvn=true) and writes them in the same way as ComputeCmvnStats(),
+ without reading the features again. The utterances of a speaker may be spread over several jobs.
+ The two-channel method needs the features of both channels and is only available in ComputeCmvnStats().
+*/
+int MergeCmvnStats(
+	fs::path datadir,						//data directory
+	std::vector<fs::path> partial_stats,	//per job stats archives (binary ark)
+	std::string fake_dims					//Generate stats that won't cause normalization for these dimensions (e.g. "13:14:15")
+)
+{
+	fs::path cmvndir = datadir / "data";
+	std::string name = datadir.stem().string();
+
+	try	{
+		fs::create_directory(cmvndir);
+	} catch (const std::exception& ex)	{
+		LOGTW_ERROR << " " << ex.what() << ".";
+		return -1;
+	}
+	if (!fs::exists(datadir / "spk2utt")) {
+		LOGTW_ERROR << " " << (datadir / "spk2utt").string() << " is required but can not be found.";
+		return -1;
+	}
+	StringTable tbl_spk2utt;
+	if (ReadStringTable((datadir / "spk2utt").string(), tbl_spk2utt) < 0) return -1;
+
+	std::vector<kaldi::int32> skip_dims;
+	if (!kaldi::SplitStringToIntegers(fake_dims, ":", false, &skip_dims)) {
+		LOGTW_ERROR << "Bad fake dimensions " << fake_dims << " (should be colon-separated list of integers).";
+		return -1;
+	}
+
+	try {
+		std::map<std::string, kaldi::Matrix<double>> stats;
+		for (fs::path p : partial_stats) {
+			kaldi::SequentialDoubleMatrixReader reader("ark:" + p.string());
+			for (; !reader.Done(); reader.Next()) {
+				kaldi::Matrix<double> &spk_stats = stats[reader.Key()];
+				if (spk_stats.NumRows() == 0) spk_stats = reader.Value();
+				else if (!spk_stats.SameDim(reader.Value())) {
+					LOGTW_ERROR << "CMVN stats of speaker " << reader.Key() << " have different dimensions in " << p.string() << ".";
+					return -1;
+				}
+				else spk_stats.AddMat(1.0, reader.Value());
+			}
+		}
+		//write in spk2utt order, the same as compute-cmvn-stats
+		kaldi::DoubleMatrixWriter writer("ark,scp:" + (cmvndir / ("cmvn_" + name + ".ark")).string() + "," + (cmvndir / ("cmvn_" + name + ".scp")).string());
+		for (StringTable::const_iterator it(tbl_spk2utt.begin()), it_end(tbl_spk2utt.end()); it != it_end; ++it)
+		{
+			std::map<std::string, kaldi::Matrix<double>>::iterator its = stats.find((*it)[0]);
+			if (its == stats.end()) {
+				LOGTW_WARNING << "No stats accumulated for speaker " << (*it)[0] << ".";
+				continue;
+			}
+			if (!skip_dims.empty()) kaldi::FakeStatsForSomeDims(skip_dims, &its->second);
+			writer.Write(its->first, its->second);
+		}
+		if (!writer.Close()) {
+			LOGTW_ERROR << "Error writing CMVN stats to " << (cmvndir / ("cmvn_" + name + ".ark")).string() << ".";
+			return -1;
+		}
+	} catch (const std::exception& ex) {
+		LOGTW_ERROR << "Error merging CMVN stats. Reason: " << ex.what();
+		return -1;
+	}
+
+	return FinishCmvnStats(datadir, cmvndir / ("cmvn_" + name + ".scp"), name, tbl_spk2utt, "cmvn:" + fake_dims);
+}
+
+//copies the stats scp into the data directory, checks if all speakers got stats and saves the speaker fingerprints
+static int FinishCmvnStats(fs::path datadir, fs::path cmvn_scp, std::string name, const StringTable & tbl_spk2utt, std::string mode)
+{
 	try	{
-		fs::copy_file(cmvndir / ("cmvn_" + name + ".scp"), datadir / "cmvn.scp", fs::copy_option::overwrite_if_exists);
+		fs::copy_file(cmvn_scp, datadir / "cmvn.scp", fs::copy_option::overwrite_if_exists);
 	} catch (const std::exception& ex) {
 		LOGTW_ERROR << " " << ex.what() << ".";
 		return -1;
@@ -191,9 +306,9 @@ VOICEBRIDGE_API int ComputeCmvnStats(
 	if (nu != nc) {
 		LOGTW_WARNING << "It seems not all of the speakers got cmvn stats (" << nc << " != " << nu << ").";
 	}
+	if (SaveSpeakerFingerprints(datadir, mode) < 0) return -1;
 
 	LOGTW_INFO << "Succeeded creating CMVN stats for " << name << ".";
 
 	return 0;
 }
-
@@ -11,17 +11,15 @@ Based on : Copyright 2012  Johns Hopkins University (Author: Daniel Povey), Apac
 #include "kaldi-win/scr/kaldi_scr.h"
 #include "kaldi-win/src/kaldi_src.h"
 #include <kaldi-win/utility/strvec2arg.h>
+#include "gmm/am-diag-gmm-packed.h"
 
-static void LaunchJobGmmEstFmllrGpost(
+static void LaunchJobGmmEstFmllrSpk(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_adddeltas,
 	string_vec options_splicefeats,
 	string_vec options_transformfeats,
-	string_vec options_l2p,
-	string_vec options_wsp,
-	string_vec options_gp2g,
-	string_vec options_gefg,
+	string_vec options_gefs,
 	std::string feat_type,
 	fs::path sdata,
 	fs::path log
@@ -40,23 +38,6 @@ static void LaunchJobGmmLatgenFaster(
 	fs::path log
 );
 
-static void LaunchJobComposeTransforms(
-	int JOBID,
-	string_vec options_applycmvn,
-	string_vec options_adddeltas,
-	string_vec options_splicefeats,
-	string_vec options_transformfeats,
-	string_vec options_pass1feats,
-	string_vec options_ldp,
-	string_vec options_l2p,
-	string_vec options_wsp,
-	string_vec options_gef,
-	string_vec options_ctr,
-	std::string feat_type,
-	fs::path sdata,
-	fs::path log
-);
-
 static void LaunchJobLaticeDetPruned(
 	int JOBID,
 	string_vec options_applycmvn,
@@ -74,6 +55,77 @@ static void LaunchJobLaticeDetPruned(
 //the return values from each thread/job
 static std::vector<int> _ret;
 
+/*
+	Best path (or MBR) decoding of the final lattices dir/lat.JOB and conversion of the word ids to the final
+	transcriptions dir/transcriptionJOB.trn.
+*/
+static int OutputTranscriptions(fs::path graphdir, fs::path dir, int nj, bool decode_mbr)
+{
+	fs::path symtab = graphdir / "words.txt";		
+	int ret = 0;
+	for (int JOBID = 1; JOBID <= nj; JOBID++) {
+		fs::path log(dir / "log" / ("decode." + std::to_string(JOBID) + ".log"));
+		fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
+		if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+		//use the optimized latices for the decoding
+		if (decode_mbr) {
+			//LatticeMbrDecode
+			string_vec options_lattice_mbr_decode;
+			options_lattice_mbr_decode.push_back("--print-args=false");
+			options_lattice_mbr_decode.push_back("--word-symbol-table=" + symtab.string());
+			options_lattice_mbr_decode.push_back("ark:" + (dir / ("lat." + std::to_string(JOBID))).string()); //input
+			options_lattice_mbr_decode.push_back("ark,t:" + (dir / ("w." + std::to_string(JOBID))).string()); //output
+			try {
+				StrVec2Arg args(options_lattice_mbr_decode);
+				ret = LatticeMbrDecode(args.argc(), args.argv(), file_log);
+			}
+			catch (const std::exception& ex)
+			{
+				LOGTW_ERROR << "Error in (LatticeMbrDecode). Reason: " << ex.what();
+				return -1;
+			}
+		}
+		else {
+			string_vec options_lattice_best_path;
+			//LatticeBestPath
+			options_lattice_best_path.push_back("--print-args=false");
+			options_lattice_best_path.push_back("--word-symbol-table=" + symtab.string());
+			options_lattice_best_path.push_back("ark:" + (dir / ("lat." + std::to_string(JOBID))).string()); //input
+			options_lattice_best_path.push_back("ark,t:" + (dir / ("w." + std::to_string(JOBID))).string()); //output
+			try {
+				StrVec2Arg args(options_lattice_best_path);
+				ret = LatticeBestPath(args.argc(), args.argv(), file_log);
+			}
+			catch (const std::exception& ex)
+			{
+				LOGTW_ERROR << "Error in (LatticeBestPath). Reason: " << ex.what();
+				return -1;
+			}
+		}
+
+		//Output the final transcription
+		// Convert the word ID's to words for the final transcription		
+		//int2sym
+		StringTable t_symtab, t_LMWT;
+		if (ReadStringTable(symtab.string(), t_symtab) < 0)
+		{//symtab
+			LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+			return -1;
+		}
+		if (ReadStringTable((dir / ("w." + std::to_string(JOBID))).string(), t_LMWT) < 0)
+		{ //input
+			LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+			return -1;
+		}
+		fs::path sym_out(dir / ("transcription" + std::to_string(JOBID) + ".trn"));
+		if (Int2Sym(t_symtab, t_LMWT, sym_out, 1, -1) < 0) { //NOTE: fields 2- (zero based index 1- till the end)
+			LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+			return -1;
+		}
+	}
+	return 0;
+}
+
 /*
 	There are 3 models involved potentially in this script, and for a standard, speaker-independent system they will 
 	all be the same. The "alignment model" is for the 1st-pass decoding and to get the Gaussian-level alignments for 
@@ -110,9 +162,18 @@ VOICEBRIDGE_API int DecodeFmllr(
 	bool stats, 								//output statistics
 	std::string word_ins_penalty, 				//word insertion penalty
 	int min_lmwt, 								//minumum LM-weight for lattice rescoring
-	int max_lmwt 								//maximum LM-weight for lattice rescoring
+	int max_lmwt, 								//maximum LM-weight for lattice rescoring
+	double target_rtf,							//if > 0, latency-bounded decoding: beam and max_active adapt to this real-time factor
+	int target_active,							//if > 0, latency-bounded decoding: beam and max_active adapt to this many active tokens per frame
+	bool use_shortlist,							//if true, evaluate only the Gaussians selected by the Gaussian shortlist of the model
+	std::string gmm_precision					//precision of the GMM parameters in the likelihood computation: float, float16 or int8
 )
 {
+	std::string precision_error;
+	if (!kaldi::CheckGmmPrecision(gmm_precision, use_shortlist, &precision_error)) {
+		LOGTW_ERROR << precision_error << ".";
+		return -1;
+	}
 	double first_beam = 10.0; // Beam used in initial, speaker - indep.pass
 	double first_max_active = 2000; // max - active used in initial pass.
 
@@ -158,7 +219,10 @@ VOICEBRIDGE_API int DecodeFmllr(
 
 	//check if all required files exist
 	//NOTE: we don't need srcdir/tree but we expect it should exist. 
-	std::vector<fs::path> required = { graphdir / "HCLG.fst", data / "feats.scp", srcdir / "tree" };
+	//decoding graph: HCLG.fst or HCLr.fst + Gr.fst composed on the fly
+	fs::path graph_fst, lookahead_g;
+	if (GetDecodingGraph(graphdir, graph_fst, lookahead_g) < 0) return -1;
+	std::vector<fs::path> required = { graph_fst, data / "feats.scp", srcdir / "tree" };
 	for (fs::path p : required) {
 		if (!fs::exists(p)) {
 			LOGTW_ERROR << "Failed to find " << p.string();
@@ -225,7 +289,8 @@ VOICEBRIDGE_API int DecodeFmllr(
 				first_beam,
 				6.0,									//default value 6.0
 				//scoring options:
-				skip_scoring, decode_mbr, stats, word_ins_penalty,min_lmwt,max_lmwt
+				skip_scoring, decode_mbr, stats, word_ins_penalty,min_lmwt,max_lmwt,
+				target_rtf, target_active, use_shortlist, gmm_precision
 			) < 0)
 			{
 				LOGTW_ERROR << "First pass speaker-independent decoding failed.";
@@ -310,46 +375,34 @@ VOICEBRIDGE_API int DecodeFmllr(
 		options_transformfeats.push_back("ark:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
 	}
 
+	//fMLLR estimation options (GmmEstFmllrSpk); the speakers of a job are estimated in parallel in memory
+	string_vec options_gefs_common;
+	options_gefs_common.push_back("--print-args=false");
+	options_gefs_common.push_back("--fmllr-update-type=" + fmllr_update_type);
+	options_gefs_common.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
+	options_gefs_common.push_back("--silence-weight=" + std::to_string(silence_weight));
+	options_gefs_common.push_back("--silence-phones=" + silphonelist);
+	options_gefs_common.push_back("--num-threads=" + std::to_string(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / nj)));
+
 	//Getting first-pass fMLLR transforms
 	if (stage <= 1) {
 
 		//Now get the first-pass fMLLR transforms.
 		LOGTW_INFO << "Getting first-pass fMLLR transforms...";
 
-		string_vec options_l2p, options_wsp, options_gp2g, options_gefg;
-		//l2p : lattice-to-post
-		options_l2p.push_back("--print-args=false");
-		options_l2p.push_back("--acoustic-scale=" + std::to_string(acwt));
-		options_l2p.push_back("ark:" + (si_dir / "lat.JOBID").string());
-		options_l2p.push_back("ark:" + (si_dir / "lat.JOBID.temp").string()); //output
-		//wsp : weight-silence-post
-		options_wsp.push_back("--print-args=false");
-		options_wsp.push_back(std::to_string(silence_weight));
-		options_wsp.push_back(silphonelist);
-		options_wsp.push_back(alignment_model.string());
-		options_wsp.push_back("ark:" + (si_dir / "lat.JOBID.temp").string());
-		options_wsp.push_back("ark:" + (si_dir / "wsp.JOBID.temp").string()); //output
-		//gp2g : gmm-post-to-gpost
-		options_gp2g.push_back("--print-args=false");
-		options_gp2g.push_back(alignment_model.string());
-		if (feat_type == "lda")
-			options_gp2g.push_back("ark,s,cs:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
-		else
-			options_gp2g.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas	
-		options_gp2g.push_back("ark:" + (si_dir / "wsp.JOBID.temp").string());
-		options_gp2g.push_back("ark:" + (si_dir / "gp2g.JOBID.temp").string()); //output
-		//gefg : gmm-est-fmllr-gpost
-		options_gefg.push_back("--print-args=false");
-		options_gefg.push_back("--fmllr-update-type=" + fmllr_update_type);
-		options_gefg.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
-		options_gefg.push_back(adapt_model.string());
+		//lattice-to-post | weight-silence-post | gmm-post-to-gpost | gmm-est-fmllr-gpost in memory per speaker
+		//(the Gaussian posteriors are computed with the alignment model)
+		string_vec options_gefs(options_gefs_common);
+		options_gefs.push_back("--lattice-input=true");
+		options_gefs.push_back("--acoustic-scale=" + std::to_string(acwt));
+		options_gefs.push_back("--gpost-model=" + alignment_model.string());
+		options_gefs.push_back(adapt_model.string());
 		if (feat_type == "lda")
-			options_gefg.push_back("ark,s,cs:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
+			options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
 		else
-			options_gefg.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
-
-		options_gefg.push_back("ark,s,cs:" + (si_dir / "gp2g.JOBID.temp").string());
-		options_gefg.push_back("ark:" + (dir / "pre_trans.JOBID").string());
+			options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
+		options_gefs.push_back("ark,s,cs:" + (si_dir / "lat.JOBID").string());
+		options_gefs.push_back("ark:" + (dir / "pre_trans.JOBID").string());
 
 		//---------------------------------------------------------------------
 		//Start parallel processing
@@ -360,10 +413,10 @@ VOICEBRIDGE_API int DecodeFmllr(
 			//logfile
 			fs::path log(dir / "log" / ("fmllr_pass1." + std::to_string(JOBID) + ".log"));
 			_threads.emplace_back(
-				LaunchJobGmmEstFmllrGpost,
+				LaunchJobGmmEstFmllrSpk,
 				JOBID,
 				options_applycmvn, options_adddeltas, options_splicefeats, options_transformfeats,
-				options_l2p, options_wsp, options_gp2g, options_gefg,
+				options_gefs,
 				feat_type,
 				sdata,
 				log);
@@ -380,7 +433,6 @@ VOICEBRIDGE_API int DecodeFmllr(
 		//---------------------------------------------------------------------
 
 		//clean up
-		DeleteAllMatching(si_dir, boost::regex(".*(\\.temp)$"));
 		for (int JOBID = 1; JOBID <= nj; JOBID++)
 			DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
 	}
@@ -434,12 +486,28 @@ VOICEBRIDGE_API int DecodeFmllr(
 		options_gmmlatgen.push_back("--max-active=" + std::to_string(max_active));
 		options_gmmlatgen.push_back("--beam=" + std::to_string(beam));
 		options_gmmlatgen.push_back("--lattice-beam=" + std::to_string(lattice_beam));
+		if (target_rtf > 0)
+			options_gmmlatgen.push_back("--target-rtf=" + std::to_string(target_rtf));
+		if (target_active > 0)
+			options_gmmlatgen.push_back("--target-active=" + std::to_string(target_active));
+		if (use_shortlist) {
+			fs::path gsl(GetGaussianShortlist(adapt_model));
+			if (gsl != "") options_gmmlatgen.push_back("--gselect-shortlist=" + gsl.string());
+		}
+		if (gmm_precision != "float")
+			options_gmmlatgen.push_back("--gmm-precision=" + gmm_precision);
 		options_gmmlatgen.push_back("--acoustic-scale=" + std::to_string(acwt));
 		options_gmmlatgen.push_back("--determinize-lattice=false");
 		options_gmmlatgen.push_back("--allow-partial=true");
 		options_gmmlatgen.push_back("--word-symbol-table=" + (graphdir / "words.txt").string());
+		if (lookahead_g != "")
+			options_gmmlatgen.push_back("--lookahead-g=" + lookahead_g.string());
+		//determinize and write the lattices in separate threads while decoding if there are spare cores
+		int det_threads = std::max(0, std::min(2, static_cast<int>(std::thread::hardware_concurrency()) / nj - 1));
+		if (det_threads > 0)
+			options_gmmlatgen.push_back("--det-threads=" + std::to_string(det_threads));
 		options_gmmlatgen.push_back(adapt_model.string());
-		options_gmmlatgen.push_back((graphdir / "HCLG.fst").string());
+		options_gmmlatgen.push_back(graph_fst.string());
 		options_gmmlatgen.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_pass1feats.temp").string()); //output from pass1feats
 		options_gmmlatgen.push_back("ark:"+(dir / "lat.tmp.JOBID").string()); //output
 
@@ -491,39 +559,20 @@ VOICEBRIDGE_API int DecodeFmllr(
 	if (stage <= 3) {
 		LOGTW_INFO << "Estimating fMLLR transforms a second time...";
 
-		string_vec options_ldp, options_l2p, options_wsp, options_gef, options_ctr;
-		//ldp : lattice-determinize-pruned
-		options_ldp.push_back("--print-args=false");
-		options_ldp.push_back("--acoustic-scale="+std::to_string(acwt));
-		options_ldp.push_back("--beam=" + std::to_string(4.0));
-		options_ldp.push_back("ark:" + (dir / "lat.tmp.JOBID").string());
-		options_ldp.push_back("ark:" + (dir / "ldp.JOBID.temp").string()); //output
-		//l2p : lattice-to-post
-		options_l2p.push_back("--print-args=false");
-		options_l2p.push_back("--acoustic-scale=" + std::to_string(acwt));
-		options_l2p.push_back("ark:" + (dir / "ldp.JOBID.temp").string());
-		options_l2p.push_back("ark:" + (dir / "l2p.JOBID.temp").string()); //output
-		//wsp : weight-silence-post
-		options_wsp.push_back("--print-args=false");
-		options_wsp.push_back(std::to_string(silence_weight));
-		options_wsp.push_back(silphonelist);
-		options_wsp.push_back(adapt_model.string());
-		options_wsp.push_back("ark:" + (dir / "l2p.JOBID.temp").string());
-		options_wsp.push_back("ark:" + (dir / "wsp.JOBID.temp").string()); //output
-		//gef : gmm-est-fmllr 
-		options_gef.push_back("--print-args=false");
-		options_gef.push_back("--fmllr-update-type=" + fmllr_update_type);
-		options_gef.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
-		options_gef.push_back(adapt_model.string());
-		options_gef.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_pass1feats.temp").string()); //output from pass1feats
-		options_gef.push_back("ark,s,cs:" + (dir / "wsp.JOBID.temp").string());
-		options_gef.push_back("ark:"+(dir / "trans_tmp.JOBID").string()); //output
-		//ctr : compose-transforms 
-		options_ctr.push_back("--print-args=false");
-		options_ctr.push_back("--b-is-affine=true");
-		options_ctr.push_back("ark:" + (dir / "trans_tmp.JOBID").string());
-		options_ctr.push_back("ark:" + (dir / "pre_trans.JOBID").string());
-		options_ctr.push_back("ark:" + (dir / "trans.JOBID").string()); //output
+		//lattice-determinize-pruned | lattice-to-post | weight-silence-post | gmm-est-fmllr | compose-transforms in memory
+		//per speaker; the features are transformed with the first-pass transforms on the fly
+		string_vec options_gefs(options_gefs_common);
+		options_gefs.push_back("--lattice-input=true");
+		options_gefs.push_back("--acoustic-scale=" + std::to_string(acwt));
+		options_gefs.push_back("--determinize-beam=" + std::to_string(4.0));
+		options_gefs.push_back("--transforms-in=ark:" + (dir / "pre_trans.JOBID").string());
+		options_gefs.push_back(adapt_model.string());
+		if (feat_type == "lda")
+			options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
+		else
+			options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
+		options_gefs.push_back("ark,s,cs:" + (dir / "lat.tmp.JOBID").string());
+		options_gefs.push_back("ark:" + (dir / "trans.JOBID").string()); //output
 
 		//---------------------------------------------------------------------
 		//Start parallel processing
@@ -534,14 +583,13 @@ VOICEBRIDGE_API int DecodeFmllr(
 			//logfile
 			fs::path log(dir / "log" / ("fmllr_pass2." + std::to_string(JOBID) + ".log"));
 			_threads.emplace_back(
-				LaunchJobComposeTransforms,
+				LaunchJobGmmEstFmllrSpk,
 				JOBID,
 				options_applycmvn,
 				options_adddeltas,
 				options_splicefeats,
 				options_transformfeats,
-				options_pass1feats,
-				options_ldp, options_l2p, options_wsp, options_gef, options_ctr,
+				options_gefs,
 				feat_type,
 				sdata,
 				log);
@@ -586,6 +634,10 @@ VOICEBRIDGE_API int DecodeFmllr(
 		//GmmRescoreLattice
 		string_vec options_ldp, options_grl;
 		options_grl.push_back("--print-args=false");
+		if (use_shortlist) {
+			fs::path gsl(GetGaussianShortlist(final_model));
+			if (gsl != "") options_grl.push_back("--gselect-shortlist=" + gsl.string());
+		}
 		options_grl.push_back(final_model.string());
 		options_grl.push_back("ark:" + (dir / "lat.tmp.JOBID").string());
 		options_grl.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_pass1feats.temp").string()); //output from second transform-feats
@@ -664,79 +716,413 @@ VOICEBRIDGE_API int DecodeFmllr(
 	}
 
 	//decode and output the final transcription
+	if (OutputTranscriptions(graphdir, dir, nj, decode_mbr) < 0) return -1;
+
+	//cleanup
+	for (int JOBID = 1; JOBID <= nj; JOBID++)
+		if (fs::exists(dir / ("pre_trans." + std::to_string(JOBID))))
+			fs::remove(dir / ("pre_trans." + std::to_string(JOBID)));
+
+	return 0;
+}
+
+
+
+/*
+	Single-pass basis fMLLR decoding (Povey & Yao, "A basis representation of constrained MLLR transforms for
+	robust adaptation", 2012; steps/decode_basis_fmllr.sh). DecodeFmllr() decodes twice with the adapted model
+	(main lattice pass and acoustic rescoring) and estimates full fMLLR transforms twice, which needs a lot of
+	data per speaker. Here:
+	  1. a lightweight speaker independent first pass (narrow beam, few active tokens) with the alignment model,
+	  2. basis fMLLR transforms from the posteriors of the first pass lattices (GmmEstFmllrSpk --basis), per
+	     speaker or, for short utterances of unseen speakers, per utterance; the basis (srcdir/fmllr.basis) is
+	     estimated by TrainSat() and with it a few seconds of speech are enough for a useful transform,
+	  3. one main search with the adapted features and the final model, writing the final lattices.
+*/
+VOICEBRIDGE_API int DecodeBasisFmllr(
+	fs::path graphdir,							//graph-dir
+	fs::path data,								//data-dir
+	fs::path dir,								//decode-dir - is assumed to be a sub-directory of the directory where the model is.
+	fs::path alignment_model,					//default: final.alimdl (or final.mdl), model of the first pass
+	fs::path final_model,						//default: final.mdl, model to compute the transforms with and to decode with
+	int nj,										//number of parallel jobs
+	float acwt,									//acoustic scale used for the lattice generation and the posteriors
+	int stage,									//
+	int max_active,								//max-active of the main pass
+	double beam,								//beam of the main pass
+	double lattice_beam,						//lattice beam of the main pass
+	double silence_weight,						//weight of the silence frames in the fMLLR statistics
+	fs::path si_dir,							//use this to skip the first pass, caution-- must be with same tree
+	bool per_utt,								//if true, the transforms are estimated per utterance instead of per speaker
+	int first_max_active,						//max-active of the first pass
+	double first_beam,							//beam of the first pass
+	//scoring options:
+	bool skip_scoring,							//
+	bool decode_mbr, 							//maximum bayes risk decoding (confusion network).
+	bool stats, 								//output statistics
+	std::string word_ins_penalty, 				//word insertion penalty
+	int min_lmwt, 								//minumum LM-weight for lattice rescoring
+	int max_lmwt, 								//maximum LM-weight for lattice rescoring
+	double target_rtf,							//if > 0, latency-bounded decoding: beam and max_active adapt to this real-time factor
+	int target_active,							//if > 0, latency-bounded decoding: beam and max_active adapt to this many active tokens per frame
+	bool use_shortlist,							//if true, evaluate only the Gaussians selected by the Gaussian shortlist of the model
+	std::string gmm_precision					//precision of the GMM parameters in the likelihood computation: float, float16 or int8
+)
+{
+	std::string precision_error;
+	if (!kaldi::CheckGmmPrecision(gmm_precision, use_shortlist, &precision_error)) {
+		LOGTW_ERROR << precision_error << ".";
+		return -1;
+	}
+	fs::path srcdir(dir.parent_path()); //The model directory is one level up from decoding directory.
+	fs::path sdata(data / ("split" + std::to_string(nj)));
+	if (CreateDir(dir / "log", true) < 0) {
+		LOGTW_ERROR << "Failed to create " << (dir / "log").string();
+		return -1;
+	}
+	//
+	if (!(fs::exists(sdata) && fs::last_write_time(data / "feats.scp") < fs::last_write_time(sdata))) {
+		//split data directory
+		if (SplitData(data, nj) < 0) return -1;
+	}
+	//save num_jobs
+	StringTable t_njs;
+	string_vec _njs = { std::to_string(nj) };
+	t_njs.push_back(_njs);
+	if (SaveStringTable((dir / "num_jobs").string(), t_njs) < 0) return -1;
+
+	std::string splice_opts, cmvn_opts, silphonelist;
+
+	try {
+		if (fs::exists(srcdir / "splice_opts")) //frame-splicing options
+			splice_opts = GetFirstLineFromFile((srcdir / "splice_opts").string());
+		if (fs::exists(srcdir / "cmvn_opts"))
+			cmvn_opts = GetFirstLineFromFile((srcdir / "cmvn_opts").string());
+
+		boost::algorithm::trim(splice_opts);
+		boost::algorithm::trim(cmvn_opts);
+
+		if (CheckFileExistsAndNotEmpty(graphdir / "phones" / "silence.csl", true) < 0) return -1;
+		silphonelist = GetFirstLineFromFile((graphdir / "phones" / "silence.csl").string());
+	}
+	catch (const std::exception& ex)
 	{
-		fs::path symtab = graphdir / "words.txt";		
-		int ret = 0;
-		for (int JOBID = 1; JOBID <= nj; JOBID++) {
-			fs::path log(dir / "log" / ("decode." + std::to_string(JOBID) + ".log"));
-			fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
-			if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
-			//use the optimized latices for the decoding
-			if (decode_mbr) {
-				//LatticeMbrDecode
-				string_vec options_lattice_mbr_decode;
-				options_lattice_mbr_decode.push_back("--print-args=false");
-				options_lattice_mbr_decode.push_back("--word-symbol-table=" + symtab.string());
-				options_lattice_mbr_decode.push_back("ark:" + (dir / ("lat." + std::to_string(JOBID))).string()); //input
-				options_lattice_mbr_decode.push_back("ark,t:" + (dir / ("w." + std::to_string(JOBID))).string()); //output
-				try {
-					StrVec2Arg args(options_lattice_mbr_decode);
-					ret = LatticeMbrDecode(args.argc(), args.argv(), file_log);
-				}
-				catch (const std::exception& ex)
-				{
-					LOGTW_ERROR << "Error in (LatticeMbrDecode). Reason: " << ex.what();
-					return -1;
-				}
-			}
-			else {
-				string_vec options_lattice_best_path;
-				//LatticeBestPath
-				options_lattice_best_path.push_back("--print-args=false");
-				options_lattice_best_path.push_back("--word-symbol-table=" + symtab.string());
-				options_lattice_best_path.push_back("ark:" + (dir / ("lat." + std::to_string(JOBID))).string()); //input
-				options_lattice_best_path.push_back("ark,t:" + (dir / ("w." + std::to_string(JOBID))).string()); //output
-				try {
-					StrVec2Arg args(options_lattice_best_path);
-					ret = LatticeBestPath(args.argc(), args.argv(), file_log);
-				}
-				catch (const std::exception& ex)
-				{
-					LOGTW_ERROR << "Error in (LatticeBestPath). Reason: " << ex.what();
-					return -1;
-				}
-			}
+		LOGTW_ERROR << ex.what();
+		return -1;
+	}
 
-			//Output the final transcription
-			// Convert the word ID's to words for the final transcription		
-			//int2sym
-			StringTable t_symtab, t_LMWT;
-			if (ReadStringTable(symtab.string(), t_symtab) < 0)
-			{//symtab
-				LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+	//check if all required files exist
+	fs::path graph_fst, lookahead_g;
+	if (GetDecodingGraph(graphdir, graph_fst, lookahead_g) < 0) return -1;
+	if (final_model == "" || !fs::exists(final_model) || fs::is_empty(final_model)) final_model = srcdir / "final.mdl";
+	std::vector<fs::path> required = { graph_fst, data / "feats.scp", srcdir / "tree", final_model };
+	for (fs::path p : required) {
+		if (!fs::exists(p)) {
+			LOGTW_ERROR << "Failed to find " << p.string();
+			return -1;
+		}
+	}
+	fs::path basis(srcdir / "fmllr.basis");
+	if (!fs::exists(basis)) {
+		LOGTW_ERROR << "Failed to find the fMLLR basis " << basis.string() << " (it is estimated by TrainSat()).";
+		return -1;
+	}
+	if (fs::last_write_time(basis) < fs::last_write_time(final_model))
+		LOGTW_WARNING << "The fMLLR basis " << basis.string() << " is older than the model " << final_model.string() << ".";
+
+	//Work out name of alignment model.
+	if (alignment_model == "" || !fs::exists(alignment_model) || fs::is_empty(alignment_model)) {
+		if (fs::exists(srcdir / "final.alimdl") && !fs::is_empty(srcdir / "final.alimdl"))
+			alignment_model = srcdir / "final.alimdl";
+		else
+			alignment_model = final_model;
+	}
+
+	//check compatibility
+	if (fs::exists(graphdir / "num_pdfs"))
+	{
+		//read the original num_pdfs
+		std::string snpdfs("");
+		try {
+			snpdfs = GetFirstLineFromFile((graphdir / "num_pdfs").string());
+		}
+		catch (const std::exception&) {}
+		int num_pdfs_orig = StringToNumber<int>(snpdfs, -1);
+		if (num_pdfs_orig < 0) {
+			LOGTW_ERROR << "Could not read number of pdf's from file " << (graphdir / "num_pdfs").string() << ".";
+			return -1;
+		}
+		//get number of pfd's from model info
+		int nofphones, num_pdfs, noftransitionids, noftransitionstates;
+		if (AmInfo(final_model.string(), nofphones, num_pdfs, noftransitionids, noftransitionstates) < 0) return -1;
+		if (num_pdfs_orig != num_pdfs) {
+			LOGTW_ERROR << "Mismatch in number of pdfs with model in " << final_model.string();
+			return -1;
+		}
+	}
+
+	//Lightweight speaker independent first pass, if si-dir option is not present; its lattices only provide the
+	//posteriors of the transform estimation.
+	if (si_dir == "" || !fs::exists(si_dir))
+	{
+		si_dir = dir.string() + ".si";
+		if (stage <= 0)
+		{
+			LOGTW_INFO << "Doing the speaker independent first pass...";
+			UMAPSS wer_ref_filter;						//ref filter NOTE: can be empty but must be defined!
+			UMAPSS wer_hyp_filter; 						//hyp filter NOTE: can be empty but must be defined!
+			if (Decode(
+				graphdir,								//graph_dir
+				data,									//data_dir
+				si_dir,									//decode_dir
+				alignment_model,						//model of the first pass
+				"",										//trans_dir
+				wer_ref_filter,							//
+				wer_hyp_filter,							//
+				"",										//iteration of model to test e.g. 'final', if the model is given then this option is not needed
+				nj,										//the number of parallel threads to use in the decoding; must be the same as in the data preparation
+				acwt,
+				0,
+				first_max_active,
+				first_beam,
+				4.0,									//narrow lattice beam, the lattices only give the posteriors
+				true,									//no scoring of the first pass
+				decode_mbr, stats, word_ins_penalty, min_lmwt, max_lmwt,
+				target_rtf, target_active, use_shortlist, gmm_precision
+			) < 0)
+			{
+				LOGTW_ERROR << "First pass speaker-independent decoding failed.";
 				return -1;
 			}
-			if (ReadStringTable((dir / ("w." + std::to_string(JOBID))).string(), t_LMWT) < 0)
-			{ //input
-				LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+		}
+	}
+
+	//Some checks
+	std::string snj("");
+	try {
+		snj = GetFirstLineFromFile((si_dir / "num_jobs").string());
+	}
+	catch (const std::exception&) {}
+	int nj_orig = StringToNumber<int>(snj, -1);
+	if (nj_orig < 1) {
+		LOGTW_ERROR << "Could not read number of jobs from file " << (si_dir / "num_jobs").string() << ".";
+		return -1;
+	}
+	if (nj != nj_orig) {
+		LOGTW_ERROR << "Mismatch in number of jobs with si-dir.";
+		return -1;
+	}
+	if (!fs::exists(si_dir / "lat.1")) {
+		LOGTW_ERROR << "Failed to find " << (si_dir / "lat.1").string();
+		return -1;
+	}
+
+	//feature type:
+	std::string feat_type;
+	if (fs::exists(srcdir / "final.mat"))
+		feat_type = "lda";
+	else feat_type = "delta";
+	LOGTW_INFO << "Feature type is " << feat_type;
+
+	//
+	//Prepare all parameters for the funcions which will be called in the parallel processing unit
+	//
+	string_vec options_applycmvn, options_adddeltas, options_splicefeats, options_transformfeats;
+	//prepare the options for apply-cmvn
+	options_applycmvn.push_back("--print-args=false"); //NOTE: do not print arguments
+	string_vec _cmvn_opts;
+	//NOTE: cmvn_opts must be 1 line of options delimited by " "
+	strtk::parse(cmvn_opts, " ", _cmvn_opts, strtk::split_options::compress_delimiters);
+	for each(std::string s in _cmvn_opts) options_applycmvn.push_back(s);
+	//NOTE: JOBID will need to be replaced later!
+	options_applycmvn.push_back("--utt2spk=ark:" + (sdata / "JOBID" / "utt2spk").string());
+	options_applycmvn.push_back("scp:" + (sdata / "JOBID" / "cmvn.scp").string());
+	options_applycmvn.push_back("scp:" + (sdata / "JOBID" / "feats.scp").string());
+	//IMPORTANT: the next option must be the last option because it is read later as output path!
+	options_applycmvn.push_back("ark:" + (sdata / "JOBID" / "apply_cmvn.temp").string()); //NOTE: this is the output of apply-cmvn!
+	//prepare features
+	if (feat_type == "delta") {
+		options_adddeltas.push_back("--print-args=false");
+		options_adddeltas.push_back("ark:" + (sdata / "JOBID" / "apply_cmvn.temp").string()); //input from apply-cmvn
+		//IMPORTANT: the next option must be the last option because it is read later as output path!
+		options_adddeltas.push_back("ark:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add-deltas
+	}
+	else //if (feat_type == "lda")
+	{
+		string_vec _splice_opts;
+		//NOTE: splice_opts must be 1 line of options delimited by " "
+		strtk::parse(splice_opts, " ", _splice_opts, strtk::split_options::compress_delimiters);
+		for each(std::string s in _splice_opts)
+			options_splicefeats.push_back(s);
+		options_splicefeats.push_back("--print-args=false");
+		options_splicefeats.push_back("ark:" + (sdata / "JOBID" / "apply_cmvn.temp").string()); //input from apply-cmvn
+		options_splicefeats.push_back("ark:" + (sdata / "JOBID" / "splicefeats.temp").string()); //output from splice-feats
+		//
+		options_transformfeats.push_back("--print-args=false");
+		options_transformfeats.push_back((srcdir / "final.mat").string());
+		options_transformfeats.push_back("ark:" + (sdata / "JOBID" / "splicefeats.temp").string()); //input from splice-feats
+		options_transformfeats.push_back("ark:" + (sdata / "JOBID" / "transformfeats.temp").string()); //output from transform-feats
+	}
+	std::string sifeats(feat_type == "lda" ? (sdata / "JOBID" / "transformfeats.temp").string()
+		: (sdata / "JOBID" / "add_deltas.temp").string());
+
+	//Basis fMLLR transforms from the first pass lattices
+	if (stage <= 1) {
+		LOGTW_INFO << "Estimating basis fMLLR transforms " << (per_utt ? "per utterance" : "per speaker") << "...";
+
+		//lattice-to-post | weight-silence-post | gmm-post-to-gpost | gmm-est-basis-fmllr-gpost in memory
+		//(the Gaussian posteriors are computed with the alignment model)
+		string_vec options_gefs;
+		options_gefs.push_back("--print-args=false");
+		options_gefs.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
+		options_gefs.push_back("--silence-weight=" + std::to_string(silence_weight));
+		options_gefs.push_back("--silence-phones=" + silphonelist);
+		options_gefs.push_back("--num-threads=" + std::to_string(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / nj)));
+		options_gefs.push_back("--basis=" + basis.string());
+		options_gefs.push_back(std::string("--per-utt=") + (per_utt ? "true" : "false"));
+		options_gefs.push_back("--lattice-input=true");
+		options_gefs.push_back("--acoustic-scale=" + std::to_string(acwt));
+		options_gefs.push_back("--gpost-model=" + alignment_model.string());
+		options_gefs.push_back(final_model.string());
+		options_gefs.push_back("ark,s,cs:" + sifeats);
+		options_gefs.push_back("ark,s,cs:" + (si_dir / "lat.JOBID").string());
+		options_gefs.push_back("ark:" + (dir / "trans.JOBID").string()); //output
+
+		//---------------------------------------------------------------------
+		//Start parallel processing
+		std::vector<std::thread> _threads;
+		_ret.clear();
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+		{
+			//logfile
+			fs::path log(dir / "log" / ("fmllr_basis." + std::to_string(JOBID) + ".log"));
+			_threads.emplace_back(
+				LaunchJobGmmEstFmllrSpk,
+				JOBID,
+				options_applycmvn, options_adddeltas, options_splicefeats, options_transformfeats,
+				options_gefs,
+				feat_type,
+				sdata,
+				log);
+		}
+		//wait for the threads till they are ready
+		for (auto& t : _threads) {
+			t.join();
+		}
+		//check return values from the threads/jobs
+		for (int JOBID = 1; JOBID <= nj; JOBID++) {
+			if (_ret[JOBID - 1] < 0)
 				return -1;
-			}
-			fs::path sym_out(dir / ("transcription" + std::to_string(JOBID) + ".trn"));
-			if (Int2Sym(t_symtab, t_LMWT, sym_out, 1, -1) < 0) { //NOTE: fields 2- (zero based index 1- till the end)
-				LOGTW_ERROR << "Failed to convert output word indexes to transcription.";
+		}
+		//---------------------------------------------------------------------
+
+		//clean up
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+			DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
+	}
+
+	//transform-feats with the basis fMLLR transforms (keyed by utterance with per_utt)
+	string_vec options_pass1feats;
+	options_pass1feats.push_back("--print-args=false");
+	if (!per_utt)
+		options_pass1feats.push_back("--utt2spk=ark:" + (sdata / "JOBID" / "utt2spk").string());
+	options_pass1feats.push_back("ark:" + (dir / "trans.JOBID").string());
+	options_pass1feats.push_back("ark:" + sifeats);
+	//IMPORTANT: the next option must be the last option because it may be read later as output path!
+	options_pass1feats.push_back("ark:" + (sdata / "JOBID" / "transform_pass1feats.temp").string());
+
+	//The main search with the adapted features and the final model; the lattices are determinized while decoding
+	//and written as the final lattices (there is no acoustic rescoring pass).
+	if (stage <= 2) {
+		LOGTW_INFO << "Doing the adapted decoding...";
+
+		string_vec options_gmmlatgen;
+		options_gmmlatgen.push_back("--print-args=false");
+		options_gmmlatgen.push_back("--max-active=" + std::to_string(max_active));
+		options_gmmlatgen.push_back("--beam=" + std::to_string(beam));
+		options_gmmlatgen.push_back("--lattice-beam=" + std::to_string(lattice_beam));
+		if (target_rtf > 0)
+			options_gmmlatgen.push_back("--target-rtf=" + std::to_string(target_rtf));
+		if (target_active > 0)
+			options_gmmlatgen.push_back("--target-active=" + std::to_string(target_active));
+		if (use_shortlist) {
+			fs::path gsl(GetGaussianShortlist(final_model));
+			if (gsl != "") options_gmmlatgen.push_back("--gselect-shortlist=" + gsl.string());
+		}
+		if (gmm_precision != "float")
+			options_gmmlatgen.push_back("--gmm-precision=" + gmm_precision);
+		options_gmmlatgen.push_back("--acoustic-scale=" + std::to_string(acwt));
+		options_gmmlatgen.push_back("--allow-partial=true");
+		options_gmmlatgen.push_back("--word-symbol-table=" + (graphdir / "words.txt").string());
+		if (lookahead_g != "")
+			options_gmmlatgen.push_back("--lookahead-g=" + lookahead_g.string());
+		//determinize and write the lattices in separate threads while decoding if there are spare cores
+		int det_threads = std::max(0, std::min(2, static_cast<int>(std::thread::hardware_concurrency()) / nj - 1));
+		if (det_threads > 0)
+			options_gmmlatgen.push_back("--det-threads=" + std::to_string(det_threads));
+		options_gmmlatgen.push_back(final_model.string());
+		options_gmmlatgen.push_back(graph_fst.string());
+		options_gmmlatgen.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_pass1feats.temp").string()); //output from pass1feats
+		options_gmmlatgen.push_back("ark:" + (dir / "lat.JOBID").string()); //output
+
+		//make sure that there are no old lat.* files in the output directory beacuse all 'lat.*' will be used later!
+		if (DeleteAllMatching(dir, boost::regex("^(lat\\.).*")) < 0) return -1;
+
+		//---------------------------------------------------------------------
+		//Start parallel processing
+		std::vector<std::thread> _threads;
+		_ret.clear();
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+		{
+			//logfile
+			fs::path log(dir / "log" / ("decode." + std::to_string(JOBID) + ".log"));
+			_threads.emplace_back(
+				LaunchJobGmmLatgenFaster,
+				JOBID,
+				options_applycmvn,
+				options_adddeltas,
+				options_splicefeats,
+				options_transformfeats,
+				options_pass1feats,
+				options_gmmlatgen,
+				feat_type,
+				sdata,
+				log);
+		}
+		//wait for the threads till they are ready
+		for (auto& t : _threads) {
+			t.join();
+		}
+		//check return values from the threads/jobs
+		for (int JOBID = 1; JOBID <= nj; JOBID++) {
+			if (_ret[JOBID - 1] < 0)
 				return -1;
-			}
 		}
+		//---------------------------------------------------------------------
+
+		//clean up
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+			DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
 	}
 
-	//cleanup
-	for (int JOBID = 1; JOBID <= nj; JOBID++)
-		if (fs::exists(dir / ("trans_tmp." + std::to_string(JOBID))))
-			fs::remove(dir / ("trans_tmp." + std::to_string(JOBID)));
+	if (stage <= 3)
+	{
+		if (AnalyzeLats(graphdir, dir) < 0) return -1;
+	}
 
-	for (int JOBID = 1; JOBID <= nj; JOBID++)
-		if (fs::exists(dir / ("pre_trans." + std::to_string(JOBID))))
-			fs::remove(dir / ("pre_trans." + std::to_string(JOBID)));
+	if (!skip_scoring)
+	{
+		UMAPSS wer_ref_filter;						//ref filter NOTE: can be empty but must be defined!
+		UMAPSS wer_hyp_filter; 						//hyp filter NOTE: can be empty but must be defined!
+		if (ScoreKaldiWER(data, graphdir, dir, wer_ref_filter, wer_hyp_filter, nj,
+			stage, decode_mbr, stats, beam, word_ins_penalty, min_lmwt, max_lmwt, "") < 0) {
+			LOGTW_ERROR << "Scoring failed.";
+			return -1;
+		}
+	}
+
+	//decode and output the final transcription
+	if (OutputTranscriptions(graphdir, dir, nj, decode_mbr) < 0) return -1;
 
 	return 0;
 }
@@ -859,6 +1245,7 @@ static void LaunchJobGmmLatgenFaster(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_pass1feats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -928,156 +1315,28 @@ static void LaunchJobGmmLatgenFaster(
 }
 
 
-static void LaunchJobGmmEstFmllrGpost(
+static void LaunchJobGmmEstFmllrSpk(
 	int JOBID,
 	string_vec options_applycmvn, 
 	string_vec options_adddeltas, 
 	string_vec options_splicefeats, 
 	string_vec options_transformfeats, 
-	string_vec options_l2p, 
-	string_vec options_wsp, 
-	string_vec options_gp2g, 
-	string_vec options_gefg,
-	std::string feat_type,
-	fs::path sdata,
-	fs::path log
-)
-{
-	/*
-		lattice-to-post => weight-silence-post  => gmm-post-to-gpost => gmm-est-fmllr-gpost
-	*/
-	//we redirect logging to the log file:
-	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
-	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
-
-	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
-	for (std::string &s : options_l2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_wsp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_gp2g) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_gefg) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-
-	std::string outcmvn;
-	int ret = 0;
-
-	try {
-		ret = ApplyCmvnSequence(JOBID,
-			options_applycmvn,
-			options_adddeltas,
-			options_splicefeats,
-			options_transformfeats,
-			feat_type,
-			sdata, outcmvn, file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (ApplyCmvnSequence). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//lattice-to-post
-	try {
-		StrVec2Arg args(options_l2p);
-		ret = LatticeToPost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (LatticeToPost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//weight-silence-post
-	try {
-		StrVec2Arg args(options_wsp);
-		ret = WeightSilencePost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (WeightSilencePost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//gmm-post-to-gpost
-	try {
-		StrVec2Arg args(options_gp2g);
-		ret = GmmPostToGpost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (GmmPostToGpost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//gmm-est-fmllr-gpost
-	try {
-		StrVec2Arg args(options_gefg);
-		ret = GmmEstFmllrGpost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (GmmEstFmllrGpost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-
-	_ret.push_back(ret);
-}
-
-
-static void LaunchJobComposeTransforms(
-	int JOBID,
-	string_vec options_applycmvn,
-	string_vec options_adddeltas,
-	string_vec options_splicefeats,
-	string_vec options_transformfeats,
-	string_vec options_pass1feats,
-	string_vec options_ldp, 
-	string_vec options_l2p, 
-	string_vec options_wsp, 
-	string_vec options_gef, 
-	string_vec options_ctr,
+	string_vec options_gefs,
 	std::string feat_type,
 	fs::path sdata,
 	fs::path log
 )
 {
 	/*
-		lattice-determinize-pruned => lattice-to-post  => weight-silence-post => gmm-est-fmllr => compose-transforms
+		speaker independent features => gmm-est-fmllr-spk (posteriors from the lattices, estimation and composition in memory)
 	*/
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
-	for (std::string &s : options_ldp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_l2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_wsp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_gef) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_ctr) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_pass1feats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	for (std::string &s : options_gefs) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 
 	std::string outcmvn;
 	int ret = 0;
@@ -1103,94 +1362,14 @@ static void LaunchJobComposeTransforms(
 		return;
 	}
 
-	//DO: transform-feats with options_pass1feats
-	try {
-		StrVec2Arg args(options_pass1feats);
-		ret = TransformFeats(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (TransformFeats). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//lattice-determinize-pruned
-	try {
-		StrVec2Arg args(options_ldp);
-		ret = LatticeDeterminizePruned(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (LatticeDeterminizePruned). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-
-	//lattice-to-post
-	try {
-		StrVec2Arg args(options_l2p);
-		ret = LatticeToPost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (LatticeToPost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//weight-silence-post
-	try {
-		StrVec2Arg args(options_wsp);
-		ret = WeightSilencePost(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (WeightSilencePost). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//gmm-est-fmllr
-	try {
-		StrVec2Arg args(options_gef);
-		ret = GmmEstFmllr(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (GmmEstFmllr). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
-
-	//compose-transforms
+	//gmm-est-fmllr-spk
 	try {
-		StrVec2Arg args(options_ctr);
-		ret = ComposeTransforms(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_gefs);
+		ret = GmmEstFmllrSpk(args.argc(), args.argv(), file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (ComposeTransforms). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmEstFmllrSpk). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
@@ -1219,6 +1398,7 @@ static void LaunchJobLaticeDetPruned(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
 	for (std::string &s : options_ldp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -11,6 +11,7 @@ Based on : Copyright 2012  Johns Hopkins University (Author: Daniel Povey), Apac
 #include "kaldi-win/scr/kaldi_scr.h"
 #include "kaldi-win/src/kaldi_src.h"
 #include <kaldi-win/utility/strvec2arg.h>
+#include "gmm/am-diag-gmm-packed.h"
 
 static void LaunchJobGmmLatgenFaster(
 	int JOBID,
@@ -56,9 +57,18 @@ VOICEBRIDGE_API int Decode(
 	bool stats, 								//output statistics
 	std::string word_ins_penalty, 				//word insertion penalty
 	int min_lmwt, 								//minumum LM-weight for lattice rescoring
-	int max_lmwt 								//maximum LM-weight for lattice rescoring
+	int max_lmwt, 								//maximum LM-weight for lattice rescoring
+	double target_rtf,							//if > 0, latency-bounded decoding: beam and max_active adapt to this real-time factor
+	int target_active,							//if > 0, latency-bounded decoding: beam and max_active adapt to this many active tokens per frame
+	bool use_shortlist,							//if true, evaluate only the Gaussians selected by the Gaussian shortlist of the model
+	std::string gmm_precision					//precision of the GMM parameters in the likelihood computation: float, float16 or int8
 )
 {
+	std::string precision_error;
+	if (!kaldi::CheckGmmPrecision(gmm_precision, use_shortlist, &precision_error)) {
+		LOGTW_ERROR << precision_error << ".";
+		return -1;
+	}
 	fs::path srcdir(decode_dir.parent_path()); //The model directory is one level up from decoding directory.
 	fs::path sdata(data_dir / ("split" + std::to_string(nj)));
 	if (CreateDir(decode_dir / "log", true) < 0) {
@@ -90,8 +100,11 @@ VOICEBRIDGE_API int Decode(
 			LOGTW_WARNING << "Running speaker independent system decoding using a SAT model! This is OK if you know what you are doing...";
 		}
 	}
+	//decoding graph: HCLG.fst or HCLr.fst + Gr.fst composed on the fly
+	fs::path graph_fst, lookahead_g;
+	if (GetDecodingGraph(graph_dir, graph_fst, lookahead_g) < 0) return -1;
 	//check if all required files exist
-	std::vector<fs::path> required = { sdata / "1" / "feats.scp", sdata / "1" / "cmvn.scp", model, graph_dir / "HCLG.fst" };
+	std::vector<fs::path> required = { sdata / "1" / "feats.scp", sdata / "1" / "cmvn.scp", model, graph_fst };
 	for (fs::path p : required) {
 		if(!fs::exists(p)) {
 			LOGTW_ERROR << "Failed to find " << p.string();
@@ -272,11 +285,27 @@ VOICEBRIDGE_API int Decode(
 		options_gmmlatgen.push_back("--max-active=" + std::to_string(max_active));
 		options_gmmlatgen.push_back("--beam=" + std::to_string(beam));
 		options_gmmlatgen.push_back("--lattice-beam=" + std::to_string(lattice_beam));
+		if (target_rtf > 0)
+			options_gmmlatgen.push_back("--target-rtf=" + std::to_string(target_rtf));
+		if (target_active > 0)
+			options_gmmlatgen.push_back("--target-active=" + std::to_string(target_active));
+		if (use_shortlist) {
+			fs::path gsl(GetGaussianShortlist(model));
+			if (gsl != "") options_gmmlatgen.push_back("--gselect-shortlist=" + gsl.string());
+		}
+		if (gmm_precision != "float")
+			options_gmmlatgen.push_back("--gmm-precision=" + gmm_precision);
 		options_gmmlatgen.push_back("--acoustic-scale=" + std::to_string(acwt));
 		options_gmmlatgen.push_back("--allow-partial=true");
 		options_gmmlatgen.push_back("--word-symbol-table=" + (graph_dir / "words.txt").string());
+		if (lookahead_g != "")
+			options_gmmlatgen.push_back("--lookahead-g=" + lookahead_g.string());
+		//determinize and write the lattices in separate threads while decoding if there are spare cores
+		int det_threads = std::max(0, std::min(2, static_cast<int>(std::thread::hardware_concurrency()) / nj - 1));
+		if (det_threads > 0)
+			options_gmmlatgen.push_back("--det-threads=" + std::to_string(det_threads));
 		options_gmmlatgen.push_back(model.string());
-		options_gmmlatgen.push_back((graph_dir / "HCLG.fst").string());
+		options_gmmlatgen.push_back(graph_fst.string());
 		//depending on the former processing the input here can be different 'feats'
 		if (trans_dir != "" && fs::exists(trans_dir)) {
 			options_gmmlatgen.push_back("ark:" + (sdata / "JOBID" / "transformfeats_trans.temp").string()); //output from trans
@@ -471,6 +500,7 @@ static void LaunchJobGmmLatgenFaster(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_splicefeats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -141,6 +141,7 @@ static void LaunchJob(int argc1, char *argv1[], fs::path out, fs::path log)
 	//we redirect Kaldi logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	int ret1 = 0;
 	
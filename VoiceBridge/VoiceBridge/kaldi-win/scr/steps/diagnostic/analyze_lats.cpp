@@ -119,6 +119,7 @@ static void LaunchJob(int JOBID, fs::path dir, fs::path model, float acwt)
 	std::string SJOBID(std::to_string(JOBID));
 	fs::ofstream file_log((dir / "log" / ("lattice_best_path." + SJOBID + ".log")), fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << (dir / "log" / ("lattice_best_path." + SJOBID + ".log")).string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//lattice-depth-per-frame  ------------------------
 	string_vec options;
@@ -228,6 +229,7 @@ static void LaunchJobLatticeDepth(int JOBID, fs::path dir, fs::path model)
 	std::string SJOBID(std::to_string(JOBID));
 	fs::ofstream file_log(dir / "log" / ("lattice_best_path." + SJOBID + ".log"), fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << (dir / "log" / ("lattice_best_path." + SJOBID + ".log")).string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	string_vec options;
 	options.push_back("--print-args=false");
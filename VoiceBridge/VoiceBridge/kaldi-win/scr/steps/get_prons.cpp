@@ -17,11 +17,9 @@
 
 static void LaunchJobLatticeBest(
 	int JOBID,
-	string_vec options_latticealignwords,
+	string_vec options_postprocess,
 	string_vec options,
-	bool bLatticeAlignWords,
 	bool bNbest,
-	fs::path mdl,
 	fs::path dir,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path sdata,
@@ -85,14 +83,14 @@ int GetProns(
 		}
 	}
 
-	//prepare options for lattice-align-words or lattice-align-words-lexicon
-	bool bLatticeAlignWords = true; //if true then will use lattice-align-words, if false will use lattice-align-words-lexicon
-	string_vec options_latticealignwords, options_best;
+	//prepare options for LatticePostprocess: the best path is aligned with the word boundaries (as lattice-align-words
+	//or lattice-align-words-lexicon) and the prons are computed (as nbest-to-prons) in memory
+	string_vec options_postprocess, options_best;
 	options_best.push_back("--print-args=false");
-	options_latticealignwords.push_back("--print-args=false");
+	options_postprocess.push_back("--print-args=false");
+	options_postprocess.push_back("--model=" + mdl.string());
 	if (fs::exists(lang / "phones" / "word_boundary.int")) {
-		options_latticealignwords.push_back((lang / "phones" / "word_boundary.int").string());
-		bLatticeAlignWords = true;
+		options_postprocess.push_back("--word-boundary=" + (lang / "phones" / "word_boundary.int").string());
 	}
 	else {
 		if (!fs::exists(lang / "phones" / "align_lexicon.int")) {
@@ -100,13 +98,9 @@ int GetProns(
 			return -1;
 		}
 		else {
-			options_latticealignwords.push_back((lang / "phones" / "align_lexicon.int").string());
-			bLatticeAlignWords = false;
+			options_postprocess.push_back("--align-lexicon=" + (lang / "phones" / "align_lexicon.int").string());
 		}
 	}
-	options_latticealignwords.push_back(mdl.string());
-	options_latticealignwords.push_back("ark:" + (dir / "best.JOBID.temp").string()); //input
-	options_latticealignwords.push_back("ark:" + (dir / "law.JOBID.temp").string());  //output
 
 	//Sym2Int options
 	std::string symtab((lang / "words.txt").string());
@@ -126,7 +120,7 @@ int GetProns(
 		catch (const std::exception&) {}
 	}
 
-	bool bNbest = true; //if true linear-to-nbest is called, if false lattice-1best is called
+	bool bNbest = true; //if true linear-to-nbest is called, if false the lattices are used directly
 	if (fs::exists(dir / "ali.1")) {
 		LOGTW_INFO << "dir/ali.1 exists, so starting from alignments...";
 		LOGTW_INFO << "dir/ali.1: " << (dir / "ali.1").string();
@@ -137,6 +131,9 @@ int GetProns(
 		options_best.push_back("");	//deliberately empty
 		options_best.push_back("");	//deliberately empty
 		options_best.push_back("ark:" + (dir / "best.JOBID.temp").string()); //output from linear-to-nbest
+		//the linear lattices
+		options_postprocess.push_back("--ops=1best,align-words,prons");
+		options_postprocess.push_back("ark:" + (dir / "best.JOBID.temp").string()); //input
 	}
 	else {
 		if (!fs::exists(dir / "lat.1")) {
@@ -148,11 +145,13 @@ int GetProns(
 		LOGTW_INFO << "dir/lat.1 exists, so starting from lattices...";
 		LOGTW_INFO << "dir/lat.1: " << (dir / "lat.1").string();
 		bNbest = false;
-		//prepare options
-		options_best.push_back("--lm-scale=" + std::to_string(lmwt));
-		options_best.push_back("ark:" + (dir / "lat.JOBID").string());
-		options_best.push_back("ark:" + (dir / "best.JOBID.temp").string()); //output from lattice-1best
+		//prepare options: the best path with the LM weight (as lattice-1best --lm-scale)
+		options_postprocess.push_back("--ops=scale,1best,align-words,prons");
+		options_postprocess.push_back("--inv-acoustic-scales=" + std::to_string(lmwt));
+		options_postprocess.push_back("ark:" + (dir / "lat.JOBID").string()); //input
 	}
+	options_postprocess.push_back(""); //no transcriptions
+	options_postprocess.push_back((dir / "prons.JOBID").string()); //output
 
 	if (stage <= 1) {
 		//call parallel processing
@@ -167,11 +166,9 @@ int GetProns(
 			_threads.emplace_back(
 				LaunchJobLatticeBest,
 				JOBID,
-				options_latticealignwords,
+				options_postprocess,
 				options_best,
-				bLatticeAlignWords,
 				bNbest,
-				mdl,
 				dir,
 				symtab, input_txt, output_txt, field_begin, field_end, oov,	//params for Sym2Int
 				sdata,
@@ -488,11 +485,9 @@ int GetProns(
 
 static void LaunchJobLatticeBest(
 	int JOBID,
-	string_vec options_latticealignwords,
-	string_vec options_best, //options to linear-to-nbest or lattice-1best depending on bNbest
-	bool bLatticeAlignWords,
+	string_vec options_postprocess,
+	string_vec options_best, //options to linear-to-nbest (only if bNbest)
 	bool bNbest,
-	fs::path mdl,
 	fs::path dir,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path sdata,
@@ -502,9 +497,10 @@ static void LaunchJobLatticeBest(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
-	for (std::string &s : options_latticealignwords) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	for (std::string &s : options_postprocess) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	for (std::string &s : options_best) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(input_txt, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(output_txt, "JOBID", std::to_string(JOBID));
@@ -553,77 +549,18 @@ static void LaunchJobLatticeBest(
 			return;
 		}
 	}
-	else {
-		//Lattice 1 best
-		try {
-			StrVec2Arg args(options_best);
-			ret = Lattice1best(args.argc(), args.argv(), file_log);
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (Lattice1best). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
-		if (ret < 0) {
-			//do not proceed if failed
-			_ret.push_back(ret);
-			return;
-		}
-	}
 
-	//align words
-	if (bLatticeAlignWords) {
-		try {
-			StrVec2Arg args(options_latticealignwords);
-			ret = LatticeAlignWords(args.argc(), args.argv(), file_log);
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (LatticeAlignWords). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
-		if (ret < 0) {
-			//do not proceed if failed
-			_ret.push_back(ret);
-			return;
-		}
-	}
-	else {
-		try {
-			StrVec2Arg args(options_latticealignwords);
-			ret = LatticeAlignWordsLexicon(args.argc(), args.argv(), file_log);
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (LatticeAlignWordsLexicon). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
-		if (ret < 0) {
-			//do not proceed if failed
-			_ret.push_back(ret);
-			return;
-		}
-	}
-
-	//Nbest To Prons
+	//best path, align words and prons in memory
 	try {
-		string_vec options;
-		options.push_back("--print-args=false");
-		options.push_back(mdl.string());
-		options.push_back("ark:" + (dir / ("law."+ std::to_string(JOBID) + ".temp")).string());
-		options.push_back((dir / ("prons."+ std::to_string(JOBID))).string());
-		StrVec2Arg args(options);
-		ret = NbestToProns(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_postprocess);
+		ret = LatticePostprocess(args.argc(), args.argv(), file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (NbestToProns). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (LatticePostprocess). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
- 
+
 	_ret.push_back(ret);
 }
@@ -0,0 +1,243 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2014  Guoguo Chen, Apache 2.0
+*/
+
+#include "kaldi-win/scr/kaldi_scr.h"
+#include "kaldi-win/src/kaldi_src.h"
+#include <kaldi-win/utility/strvec2arg.h>
+#include "lm/const-arpa-lm.h"
+
+static void LaunchJobLmRescoreConstArpa(
+	int JOBID,
+	string_vec options_lmrescore,
+	string_vec options_lmrescore_carpa,
+	const kaldi::ConstArpaLm * const_arpa,
+	fs::path log
+);
+
+//the return values from each thread/job
+static std::vector<int> _ret;
+
+/*
+	Second pass of a two-pass decoding: rescores the lattices of a decoding done with a small (pruned) LM
+	(the G.fst in old_lang_dir, which was compiled into HCLG.fst) with a big LM in ConstArpaLm format
+	(the G.carpa in new_lang_dir, see PrepareTestLms()). The old LM scores are subtracted from the lattices
+	and the new LM scores are added. The big LM is never compiled into an FST, therefore it can be much larger
+	than what fits into HCLG.fst.
+
+	The G.carpa is loaded only once and shared (read-only) by all parallel jobs. The number of jobs is the
+	number of jobs used for the first pass decoding (the lattices are rescored per lat.JOBID).
+*/
+VOICEBRIDGE_API int LmRescoreConstArpa(
+	fs::path old_lang_dir,						//lang directory of the small (pruned) LM used for the first pass decoding (G.fst)
+	fs::path new_lang_dir,						//lang directory with the big LM in ConstArpaLm format (G.carpa)
+	fs::path data_dir,							//data
+	fs::path decode_dir_in,						//decode directory of the first pass (lat.*)
+	fs::path decode_dir_out,					//output decode directory for the rescored lattices
+	UMAPSS & wer_ref_filter,					//ref filter NOTE: can be empty but must be defined!
+	UMAPSS & wer_hyp_filter,					//hyp filter NOTE: can be empty but must be defined!
+	int stage,									//
+	bool skip_scoring,							//
+	//scoring options:
+	bool decode_mbr, 							//maximum bayes risk decoding (confusion network).
+	bool stats, 								//output statistics
+	std::string word_ins_penalty, 				//word insertion penalty
+	int min_lmwt, 								//minumum LM-weight for lattice rescoring
+	int max_lmwt 								//maximum LM-weight for lattice rescoring
+)
+{
+	if (CheckFilesExist(std::vector<fs::path> { old_lang_dir / "G.fst", new_lang_dir / "G.carpa",
+		data_dir / "feats.scp", decode_dir_in / "lat.1", decode_dir_in / "num_jobs" }) < 0) return -1;
+	if (decode_dir_in == decode_dir_out) {
+		LOGTW_ERROR << "The input and output decode directories must be different.";
+		return -1;
+	}
+	//NOTE: the model is needed only for scoring (the output directory is treated as a decode directory
+	//		of the same model)
+	fs::path srcdir(decode_dir_in.parent_path());
+	if (!skip_scoring && !fs::exists(srcdir / "final.mdl")) {
+		LOGTW_ERROR << "Failed to find " << (srcdir / "final.mdl").string();
+		return -1;
+	}
+	if (decode_dir_out.parent_path() != srcdir) {
+		LOGTW_WARNING << "The output decode directory is not in the model directory " << srcdir.string() << ".";
+	}
+
+	if (CreateDir(decode_dir_out / "log", true) < 0) {
+		LOGTW_ERROR << "Failed to create " << (decode_dir_out / "log").string();
+		return -1;
+	}
+	//get the number of jobs of the first pass
+	std::string snj("");
+	try {
+		snj = GetFirstLineFromFile((decode_dir_in / "num_jobs").string());
+	}
+	catch (const std::exception&) {}
+	int nj = StringToNumber<int>(snj, -1);
+	if (nj < 1) {
+		LOGTW_ERROR << "Could not read number of jobs from file " << (decode_dir_in / "num_jobs").string() << ".";
+		return -1;
+	}
+	//save num_jobs
+	StringTable t_njs;
+	string_vec _njs = { std::to_string(nj) };
+	t_njs.push_back(_njs);
+	if (SaveStringTable((decode_dir_out / "num_jobs").string(), t_njs) < 0) return -1;
+
+	if (stage <= 0)
+	{
+		//the old LM must be an acceptor on the word labels (fstproject --project_output=true)
+		fs::path oldlm(decode_dir_out / "G_old_project.fst");
+		if (fstproject((old_lang_dir / "G.fst").string(), oldlm.string(), true) < 0) {
+			LOGTW_ERROR << "Failed to project " << (old_lang_dir / "G.fst").string();
+			return -1;
+		}
+
+		//load the big LM once for all jobs
+		kaldi::ConstArpaLm const_arpa;
+		try {
+			kaldi::ReadKaldiObject((new_lang_dir / "G.carpa").string(), &const_arpa);
+		}
+		catch (const std::exception& ex)
+		{
+			LOGTW_ERROR << "Failed to read " << (new_lang_dir / "G.carpa").string() << ". Reason: " << ex.what();
+			return -1;
+		}
+
+		//options LatticeLmrescore (subtract the old LM)
+		string_vec options_lmrescore;
+		options_lmrescore.push_back("--print-args=false");
+		options_lmrescore.push_back("--lm-scale=-1.0");
+		options_lmrescore.push_back("ark:" + (decode_dir_in / "lat.JOBID").string());
+		options_lmrescore.push_back(oldlm.string());
+		options_lmrescore.push_back("ark:" + (decode_dir_out / "lat_nolm.JOBID.temp").string()); //output
+
+		//options LatticeLmrescoreConstArpa (add the new LM)
+		//NOTE: the const-arpa-in argument is not read because the loaded LM is passed to the jobs
+		string_vec options_lmrescore_carpa;
+		options_lmrescore_carpa.push_back("--print-args=false");
+		options_lmrescore_carpa.push_back("--lm-scale=1.0");
+		options_lmrescore_carpa.push_back("ark:" + (decode_dir_out / "lat_nolm.JOBID.temp").string());
+		options_lmrescore_carpa.push_back((new_lang_dir / "G.carpa").string());
+		options_lmrescore_carpa.push_back("ark:" + (decode_dir_out / "lat.JOBID").string()); //output
+
+		//make sure that there are no old lat.* files in the output directory beacuse all 'lat.*' will be used later!
+		if (DeleteAllMatching(decode_dir_out, boost::regex("^(lat\\.).*")) < 0) return -1;
+
+		//---------------------------------------------------------------------
+		//Start parallel processing
+		std::vector<std::thread> _threads;
+		_ret.clear();
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+		{
+			//logfile
+			fs::path log(decode_dir_out / "log" / ("rescorelm." + std::to_string(JOBID) + ".log"));
+			//
+			_threads.emplace_back(
+				LaunchJobLmRescoreConstArpa,
+				JOBID,
+				options_lmrescore,
+				options_lmrescore_carpa,
+				&const_arpa,
+				log);
+		}
+		//wait for the threads till they are ready
+		for (auto& t : _threads) {
+			t.join();
+		}
+		//check return values from the threads/jobs
+		for (int JOBID = 1; JOBID <= nj; JOBID++) {
+			if (_ret[JOBID - 1] < 0)
+				return -1;
+		}
+		//---------------------------------------------------------------------
+
+		//clean up
+		try {
+			if (fs::exists(oldlm)) fs::remove(oldlm);
+			for (int JOBID = 1; JOBID <= nj; JOBID++) {
+				fs::path temppath(decode_dir_out / ("lat_nolm." + std::to_string(JOBID) + ".temp"));
+				if (fs::exists(temppath)) fs::remove(temppath);
+			}
+		}
+		catch (const std::exception&) {}
+	}
+
+	if (!skip_scoring)
+	{
+		if (ScoreKaldiWER(data_dir, new_lang_dir, decode_dir_out, wer_ref_filter, wer_hyp_filter, nj,
+			stage, decode_mbr, stats, 6.0, word_ins_penalty, min_lmwt, max_lmwt) < 0) {
+			LOGTW_ERROR << "Scoring failed.";
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+	parallel job for LmRescoreConstArpa()
+
+	NOTE: the string_vec options must not be passed by reference and make a copy because of the JOBID's!
+*/
+static void LaunchJobLmRescoreConstArpa(
+	int JOBID,
+	string_vec options_lmrescore,
+	string_vec options_lmrescore_carpa,
+	const kaldi::ConstArpaLm * const_arpa,
+	fs::path log
+)
+{
+	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
+	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
+
+	//replace 'JOBID' with the current job ID of the thread
+	for (std::string &s : options_lmrescore) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	for (std::string &s : options_lmrescore_carpa) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	int ret = 0;
+
+	//DO: lattice-lmrescore --lm-scale=-1.0
+	try {
+		StrVec2Arg args(options_lmrescore);
+		ret = LatticeLmrescore(args.argc(), args.argv(), file_log);
+	}
+	catch (const std::exception& ex)
+	{
+		LOGTW_FATALERROR << "Error in (LatticeLmrescore). Reason: " << ex.what();
+		_ret.push_back(-1);
+		return;
+	}
+	if (ret < 0) {
+		//do not proceed if failed
+		_ret.push_back(ret);
+		return;
+	}
+
+	//DO: lattice-lmrescore-const-arpa --lm-scale=1.0
+	try {
+		StrVec2Arg args(options_lmrescore_carpa);
+		ret = LatticeLmrescoreConstArpa(args.argc(), args.argv(), file_log, const_arpa);
+	}
+	catch (const std::exception& ex)
+	{
+		LOGTW_FATALERROR << "Error in (LatticeLmrescoreConstArpa). Reason: " << ex.what();
+		_ret.push_back(-1);
+		return;
+	}
+	if (ret < 0) {
+		//do not proceed if failed
+		_ret.push_back(ret);
+		return;
+	}
+
+	//all OK
+	_ret.push_back(0);
+}
@@ -60,7 +60,12 @@ VOICEBRIDGE_API int MakeMfccPitch(
 	int nj,								//default: 4, number of parallel jobs
 	bool compress,						//default: true, compress mfcc features
 	bool write_utt2num_frames,			//default: false, if true writes utt2num_frames
-	int paste_length_tolerance		//default: 2, length tolerance passed to paste-feats
+	int paste_length_tolerance,		//default: 2, length tolerance passed to paste-feats
+	bool compute_cmvn,					//default: false, if true computes the per speaker CMVN stats (cmvn.scp) during feature extraction
+										//instead of reading all features again in ComputeCmvnStats()
+	std::string cmvn_fake_dims,			//default: "", only with compute_cmvn; generate stats that won't cause normalization for these dimensions
+	bool incremental					//default: false, if true only the new or changed utterances are extracted, the features of the
+										//others are reused through feats.scp (see data_fingerprint.cpp)
 )
 {
 	fs::path logdir = datadir / "log";
@@ -105,10 +110,39 @@ VOICEBRIDGE_API int MakeMfccPitch(
 		vtln_opts.push_back("--vtln-map=ark:" + (datadir / "utt2warp").string());
 	}
 
+	//incremental mode: only the new or changed utterances are extracted
+	IncrementalFeats inc;
+	fs::path segments = datadir / "segments";
+	bool has_segments = fs::exists(segments);
+	std::string arkname = "raw_mfcc_" + name;
+	if (incremental) {
+		if (PrepareIncrementalFeats(datadir, datadir / "backup" / "feats.scp", { mfcc_config, pitch_config, pitch_postprocess_config, datadir / "spk2warp", datadir / "utt2warp" }, inc) < 0) return -1;
+		LOGTW_INFO << "Incremental mode: reusing the features of " << inc.num_reused << " utterances, extracting " << inc.num_extract << ".";
+		if (has_segments) segments = inc.scp;
+		else scp = inc.scp;
+		arkname += inc.suffix;
+		if (inc.num_extract > 0 && inc.num_extract < nj) nj = inc.num_extract;
+	}
+	else if (fs::exists(datadir / "utt2fingerprint")) {
+		//all archives are rewritten; the next incremental run extracts all utterances once to make new fingerprints
+		try {
+			fs::remove(datadir / "utt2fingerprint");
+		} catch (const std::exception&) {}
+	}
+	bool extract = !incremental || inc.num_extract > 0;
+	if (extract && inc.suffix.empty() && fs::exists(datadir / "spk2fingerprint")) {
+		//the archives are rewritten with their former names, the speaker fingerprints could match the old contents
+		try {
+			fs::remove(datadir / "spk2fingerprint");
+		} catch (const std::exception&) {}
+	}
+	//the CMVN stats can only be summed from the jobs if all features are extracted
+	bool merge_cmvn = compute_cmvn && inc.num_reused == 0;
+
 	//setup parallel processing
 	std::vector<fs::path> _fullpaths;
 	for (int i = 1; i <= nj; i++) {
-		fs::path dir(mfccdir / ("raw_mfcc_" + name + "." + std::to_string(i) + ".ark"));
+		fs::path dir(mfccdir / (arkname + "." + std::to_string(i) + ".ark"));
 		_fullpaths.push_back(dir);
 	}
 
@@ -118,19 +152,29 @@ VOICEBRIDGE_API int MakeMfccPitch(
 		//NOTE: "t:" means text mode
 	}
 
+	//the per speaker CMVN stats of each job are accumulated by copy-feats and summed at the end by MergeCmvnStats()
+	if (merge_cmvn) {
+		write_num_frames_opt.push_back("--write-cmvn-stats=ark:" + (logdir / ("cmvn_partial_" + name + ".JOBID.ark")).string());
+		write_num_frames_opt.push_back("--utt2spk=ark:" + (datadir / "utt2spk").string());
+	}
+
 	//this error file could have been made by a former run
 	DeleteAllMatching(logdir, boost::regex("^(\\.error).*"));
 
 	std::vector<std::thread> _threads;
 
-	if (fs::exists(datadir / "segments"))
+	if (!extract)
+	{
+		LOGTW_INFO << "Incremental mode: there are no new or changed utterances.";
+	}
+	else if (has_segments)
 	{
 		LOGTW_INFO << "Segments file exists: using that.";
 		std::vector<fs::path> split_segments;
 		for (int n = 1; n <= nj; n++) {
 			split_segments.push_back((logdir / ("segments." + std::to_string(n))));
 		}
-		if (SplitScp(datadir / "segments", split_segments) < 0) return -1;
+		if (SplitScp(segments, split_segments) < 0) return -1;
 				
 		//parallel section
 		for (int JOBID = 1; JOBID <= nj; JOBID++) 
@@ -182,15 +226,15 @@ VOICEBRIDGE_API int MakeMfccPitch(
 			paste_feats_options.push_back("--length-tolerance=" + std::to_string(paste_length_tolerance));
 			paste_feats_options.push_back("ark:" + ((logdir / ("wav_" + name + ".JOBID.mfctemp")).string())); //output from compute-mfcc-feats
 			paste_feats_options.push_back("ark,s,cs:" + ((logdir / ("procpitch.JOBID.temp")).string())); //output from process-kaldi-pitch-feats
-			paste_feats_options.push_back("ark:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.temp")).string()); //output
+			paste_feats_options.push_back("ark:" + (mfccdir / (arkname + ".JOBID.temp")).string()); //output
 
 			//add all options for copy-feats
 			string_vec copy_feats_options;
 			copy_feats_options.push_back("--print-args=false");
 			copy_feats_options.push_back("--compress=" + bool_as_text(compress));
 			copy_feats_options.insert(copy_feats_options.end(), write_num_frames_opt.begin(), write_num_frames_opt.end());
-			copy_feats_options.push_back("ark:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.temp")).string()); //output from paste-feats
-			copy_feats_options.push_back("ark,scp:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.ark")).string() + "," + (mfccdir / ("raw_mfcc_" + name + ".JOBID.scp")).string());
+			copy_feats_options.push_back("ark:" + (mfccdir / (arkname + ".JOBID.temp")).string()); //output from paste-feats
+			copy_feats_options.push_back("ark,scp:" + (mfccdir / (arkname + ".JOBID.ark")).string() + "," + (mfccdir / (arkname + ".JOBID.scp")).string());
 
 			//logfile 
 			fs::path log(logdir / ("make_mfcc_"+name+"."+ std::to_string(JOBID) +".log"));
@@ -264,14 +308,14 @@ VOICEBRIDGE_API int MakeMfccPitch(
 			paste_feats_options.push_back("--length-tolerance=" + std::to_string(paste_length_tolerance));
 			paste_feats_options.push_back("ark:" + ((logdir / ("wav_" + name + ".JOBID.mfctemp")).string())); //output from compute-mfcc-feats
 			paste_feats_options.push_back("ark,s,cs:" + ((logdir / ("procpitch.JOBID.temp")).string())); //output from process-kaldi-pitch-feats
-			paste_feats_options.push_back("ark:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.temp")).string()); //output
+			paste_feats_options.push_back("ark:" + (mfccdir / (arkname + ".JOBID.temp")).string()); //output
 			//add all options for copy-feats
 			string_vec copy_feats_options;
 			copy_feats_options.push_back("--print-args=false");
 			copy_feats_options.push_back("--compress=" + bool_as_text(compress));
 			copy_feats_options.insert(copy_feats_options.end(), write_num_frames_opt.begin(), write_num_frames_opt.end());
-			copy_feats_options.push_back("ark:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.temp")).string()); //output from paste-feats
-			copy_feats_options.push_back("ark,scp:" + (mfccdir / ("raw_mfcc_" + name + ".JOBID.ark")).string() + "," + (mfccdir / ("raw_mfcc_" + name + ".JOBID.scp")).string());
+			copy_feats_options.push_back("ark:" + (mfccdir / (arkname + ".JOBID.temp")).string()); //output from paste-feats
+			copy_feats_options.push_back("ark,scp:" + (mfccdir / (arkname + ".JOBID.ark")).string() + "," + (mfccdir / (arkname + ".JOBID.scp")).string());
 
 			//logfile 
 			fs::path log(logdir / ("make_mfcc_" + name + "." + std::to_string(JOBID) + ".log"));
@@ -301,22 +345,29 @@ VOICEBRIDGE_API int MakeMfccPitch(
 	std::vector<fs::path> _infeats, _inutt2num;
 	for (int JOBID = 1; JOBID <= nj; JOBID++) {
 		//.scp
-		_infeats.push_back(mfccdir / ("raw_mfcc_"+name+"."+ std::to_string(JOBID) +".scp"));
+		_infeats.push_back(mfccdir / (arkname + "."+ std::to_string(JOBID) +".scp"));
 		//utt2num_frames
 		if (write_utt2num_frames)
 			_inutt2num.push_back(logdir / ("utt2num_frames." + std::to_string(JOBID)));
 	}
 	fs::path feats_scp(datadir / "feats.scp"), utt2num_frames(datadir / "utt2num_frames");
 	//.scp
-	if (MergeFiles(_infeats, feats_scp) < 0) return -1;
+	if (extract && MergeFiles(_infeats, feats_scp) < 0) return -1;
 	//utt2num_frames
-	if (write_utt2num_frames) {
+	if (write_utt2num_frames && !extract) {
+		try {
+			if (fs::exists(utt2num_frames)) fs::remove(utt2num_frames);
+		} catch (const std::exception&) {}
+	}
+	else if (write_utt2num_frames) {
 		if (MergeFiles(_inutt2num, utt2num_frames) < 0) return -1;
 		try {
 			for (int JOBID = 1; JOBID <= nj; JOBID++)
 				fs::remove(logdir / ("utt2num_frames." + std::to_string(JOBID)));
 		} catch (const std::exception&) {}
 	}
+	//add the reused features
+	if (incremental && FinishIncrementalFeats(datadir, inc, write_utt2num_frames) < 0) return -1;
 	//clean up temporary files
 	try {
 		for (int JOBID = 1; JOBID <= nj; JOBID++) {
@@ -357,6 +408,22 @@ VOICEBRIDGE_API int MakeMfccPitch(
 		return -1;
 	}
 
+	if (merge_cmvn) {
+		std::vector<fs::path> _partial_stats;
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+			_partial_stats.push_back(logdir / ("cmvn_partial_" + name + "." + std::to_string(JOBID) + ".ark"));
+		int ret = MergeCmvnStats(datadir, _partial_stats, cmvn_fake_dims);
+		try {
+			for (fs::path p : _partial_stats)
+				if (fs::exists(p)) fs::remove(p);
+		} catch (const std::exception&) {}
+		if (ret < 0) return -1;
+	}
+	else if (compute_cmvn) {
+		//incremental: only the speakers with new or changed utterances get new stats
+		if (ComputeCmvnStats(datadir, false, false, cmvn_fake_dims, true) < 0) return -1;
+	}
+
 	LOGTW_INFO << "Succeeded creating MFCC & Pitch features for " << name << ".";
 
 	return 0;
@@ -376,6 +443,7 @@ static void LaunchJob(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 	//replace JOBID in options
 	for (std::string &s : compute_mfc_options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	for (std::string &s : compute_pitch_options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -438,6 +506,7 @@ static void LaunchJob_segments(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 	//replace JOBID in options
 	for (std::string &s : extract_options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	for (std::string &s : compute_mfc_options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));	
@@ -14,11 +14,9 @@ Based on : Copyright 2012-2014  Johns Hopkins University (Author: Daniel Povey,
 
 static void LaunchJobComputeWer(
 	int JOBID,
-	bool decode_mbr,
 	int minlmwt,
 	int maxlmwt,
 	std::string	wip,
-	double beam,
 	fs::path symtab,
 	UMAPSS wer_hyp_filter,
 	fs::path dir
@@ -26,7 +24,6 @@ static void LaunchJobComputeWer(
 
 //the return values from each thread/job
 static std::vector<int> _ret;
-static std::mutex m_oMutex; //NOTE: needed for locking threads accessing the merged lat.* file! An other option would be to make several copies of the file.
 
 /*
 	Computes the WER (Word Error Rate)
@@ -73,7 +70,7 @@ int ScoreKaldiWER(
 
 	if (stage <= 0) 
 	{
-		//Merge all dir/lat.* files into 1 file for lattice-scale then simply go through all functions
+		//Merge all dir/lat.* files into 1 file for LatticePostprocess
 		std::vector<fs::path> _f;
 		fs::path lat_merged(dir / "lat.merged");
 		GetAllMatchingFiles(_f, dir, boost::regex("^(lat\\.).*")); //lat.*
@@ -86,10 +83,41 @@ int ScoreKaldiWER(
 			return -1;
 		}
 
-		for (std::string wip : _wip) 
-		{
+		//Decode all LMWT's and word insertion penalties at once: each lattice is read once and the lattices are
+		//processed in parallel by LatticePostprocess() (scale, penalty, [prune, mbr] or best path in memory).
+		//The results are written to lat.merged.<wip>.<LMWT>.tra
+		std::string lmwts, wips;
+		for (int LMWT = min_lmwt; LMWT <= max_lmwt; LMWT++)
+			lmwts += (LMWT > min_lmwt ? "," : "") + std::to_string(LMWT);
+		for (std::string wip : _wip) {
+			wips += (wips.empty() ? "" : ",") + wip;
 			if (CreateDir(dir / "scoring_kaldi" / ("penalty_" + wip) / "log") < 0) return -1;
+		}
+		if (CreateDir(dir / "scoring_kaldi" / "log") < 0) return -1;
+		fs::path log_pp(dir / "scoring_kaldi" / "log" / "lattice_postprocess.log");
+		fs::ofstream file_log_pp(log_pp, fs::ofstream::binary | fs::ofstream::out);
+		if (!file_log_pp) LOGTW_WARNING << "Log file is not accessible " << log_pp.string() << ".";
+		string_vec options_lattice_postprocess;
+		options_lattice_postprocess.push_back("--print-args=false");
+		options_lattice_postprocess.push_back(decode_mbr ? "--ops=scale,penalty,prune,mbr" : "--ops=scale,penalty");
+		options_lattice_postprocess.push_back("--inv-acoustic-scales=" + lmwts);
+		options_lattice_postprocess.push_back("--word-ins-penalties=" + wips);
+		options_lattice_postprocess.push_back("--beam=" + std::to_string(beam));
+		options_lattice_postprocess.push_back("--num-threads=" + std::to_string(nj));
+		options_lattice_postprocess.push_back("ark:" + lat_merged.string()); //input
+		options_lattice_postprocess.push_back("ark,t:" + (dir / "lat.merged.{WIP}.{LMWT}.tra").string()); //output
+		try {
+			StrVec2Arg args(options_lattice_postprocess);
+			if (LatticePostprocess(args.argc(), args.argv(), file_log_pp) < 0) return -1;
+		}
+		catch (const std::exception& ex)
+		{
+			LOGTW_FATALERROR << "Error in (LatticePostprocess). Reason: " << ex.what();
+			return -1;
+		}
 
+		for (std::string wip : _wip) 
+		{
 			//Start parallel processing of LMWT's
 			std::vector<std::thread> _threads;
 			_ret.clear();
@@ -110,11 +138,9 @@ int ScoreKaldiWER(
 				_threads.emplace_back(
 					LaunchJobComputeWer,
 					JOBID,
-					decode_mbr,
 					minlmwt,
 					maxlmwt,
 					wip,
-					beam,
 					symtab,
 					wer_hyp_filter,
 					dir);
@@ -255,11 +281,9 @@ int ScoreKaldiWER(
 
 static void LaunchJobComputeWer(
 	int JOBID,
-	bool decode_mbr,
 	int minlmwt,
 	int maxlmwt,
 	std::string	wip,
-	double beam,
 	fs::path symtab,
 	UMAPSS wer_hyp_filter,
 	fs::path dir
@@ -269,100 +293,16 @@ static void LaunchJobComputeWer(
 	fs::path log(dir / "scoring_kaldi" / ("penalty_" + wip) / "log" / ("LMWT." + std::to_string(JOBID) + ".log"));
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 	int ret;
 
 	for (int LMWT = minlmwt; LMWT <= maxlmwt; LMWT++) 
 	{
 		//prepare a file postfix for this thread and LMWT
 		std::string JOBIDLMWT(std::to_string(JOBID) + "." + std::to_string(LMWT));
-		string_vec options_lattice_scale, options_lattice_add_penalty;
-		//LatticeScale
-		options_lattice_scale.push_back("--print-args=false");
-		options_lattice_scale.push_back("--inv-acoustic-scale=" + std::to_string(LMWT));
-		options_lattice_scale.push_back("ark:"+(dir / "lat.merged").string()); //input
-		options_lattice_scale.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT + ".tmp")).string()); //output
-		try {
-			StrVec2Arg args(options_lattice_scale);
-			//NOTE: must take care of reading lat.merged in several threads; try mutex lock/unlock while reading
-			//lat.merged must be locked read because all threads are needing it
-			m_oMutex.lock();
-			ret = LatticeScale(args.argc(), args.argv(), file_log);
-			m_oMutex.unlock();
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (LatticeScale). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
-		//LatticeAddPenalty
-		options_lattice_add_penalty.push_back("--print-args=false");
-		options_lattice_add_penalty.push_back("--word-ins-penalty=" + wip);
-		options_lattice_add_penalty.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT + ".tmp")).string()); //input
-		options_lattice_add_penalty.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT)).string()); //output
-		try {
-			StrVec2Arg args(options_lattice_add_penalty);
-			ret = LatticeAddPenalty(args.argc(), args.argv(), file_log);
-		}
-		catch (const std::exception& ex)
-		{
-			LOGTW_FATALERROR << "Error in (LatticeAddPenalty). Reason: " << ex.what();
-			_ret.push_back(-1);
-			return;
-		}
+		//NOTE: the transcriptions are decoded for all LMWT's by LatticePostprocess() in ScoreKaldiWER()
+		fs::path tra(dir / ("lat.merged." + wip + "." + std::to_string(LMWT) + ".tra"));
 
-		if (decode_mbr) {
-			string_vec options_lattice_prune, options_lattice_mbr_decode;
-			//LatticePrune
-			options_lattice_prune.push_back("--print-args=false");
-			options_lattice_prune.push_back("--beam="+ std::to_string(beam));
-			options_lattice_prune.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT)).string()); //input
-			options_lattice_prune.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT + ".p")).string()); //output
-			try {
-				StrVec2Arg args(options_lattice_prune);
-				ret = LatticePrune(args.argc(), args.argv(), file_log);
-			}
-			catch (const std::exception& ex)
-			{
-				LOGTW_FATALERROR << " in (LatticePrune). Reason: " << ex.what();
-				_ret.push_back(-1);
-				return;
-			}
-			//LatticeMbrDecode
-			options_lattice_mbr_decode.push_back("--print-args=false");
-			options_lattice_mbr_decode.push_back("--word-symbol-table=" + symtab.string());
-			options_lattice_mbr_decode.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT + ".p")).string()); //input
-			options_lattice_mbr_decode.push_back("ark,t:" + (dir / ("lat.merged." + JOBIDLMWT + ".bp")).string()); //output
-			try {
-				StrVec2Arg args(options_lattice_mbr_decode);
-				ret = LatticeMbrDecode(args.argc(), args.argv(), file_log);
-			}
-			catch (const std::exception& ex)
-			{
-				LOGTW_FATALERROR << "Error in (LatticeMbrDecode). Reason: " << ex.what();
-				_ret.push_back(-1);
-				return;
-			}
-		}
-		else {
-			string_vec options_lattice_best_path;
-			//LatticeBestPath
-			options_lattice_best_path.push_back("--print-args=false");
-			options_lattice_best_path.push_back("--word-symbol-table=" + symtab.string());
-			options_lattice_best_path.push_back("ark:" + (dir / ("lat.merged." + JOBIDLMWT)).string()); //input
-			options_lattice_best_path.push_back("ark,t:" + (dir / ("lat.merged." + JOBIDLMWT + ".bp")).string()); //output
-			try {
-				StrVec2Arg args(options_lattice_best_path);
-				ret = LatticeBestPath(args.argc(), args.argv(), file_log);
-			}
-			catch (const std::exception& ex)
-			{
-				LOGTW_FATALERROR << "Error in (LatticeBestPath). Reason: " << ex.what();
-				_ret.push_back(-1);
-				return;
-			}
-		} ///else decode_mbr
-	
 		//int2sym
 		StringTable t_symtab, t_LMWT;
 		if (ReadStringTable(symtab.string(), t_symtab) < 0) 
@@ -370,7 +310,7 @@ static void LaunchJobComputeWer(
 			_ret.push_back(-1);
 			return;
 		}
-		if (ReadStringTable((dir / ("lat.merged." + JOBIDLMWT + ".bp")).string(), t_LMWT) < 0) 
+		if (ReadStringTable(tra.string(), t_LMWT) < 0) 
 		{ //input
 			_ret.push_back(-1);
 			return;
@@ -862,6 +862,7 @@ static void LaunchJobCompileTrainGraphs(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//run sym2int first to have the input for CompileTrainGraphs: traindir / "transcriptions_rspecifier.temp"
 	StringTable t_symtab, t_input;
@@ -912,6 +913,7 @@ static void LaunchJobAlignData(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << " log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	std::string outcmvn;
 	int ret1 = 0;
@@ -970,6 +972,7 @@ static void LaunchJobGmmAlignCompiled(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	std::string outcmvn;
 	int ret1 = 0;
@@ -1012,6 +1015,7 @@ static void LaunchJobGmmAccStatsAli(
 	//we redirect Kaldi logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	std::string outcmvn;
 	int ret1 = 0;
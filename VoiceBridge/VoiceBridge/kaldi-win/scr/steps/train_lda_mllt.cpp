@@ -12,6 +12,7 @@
 #include "kaldi-win/src/kaldi_src.h"
 #include "util/common-utils.h" //for ParseOptions
 #include "kaldi-win/utility/Utility2.h"
+#include "kaldi-win/src/gmmbin/train-graph-cache.h"
 
 static void LaunchJobAccLda(
 	int JOBID,
@@ -41,19 +42,19 @@ static void LaunchJobConvertAli(
 	fs::path log
 );
 
-static void LaunchJobCompileTrainGraphs(
+static void LaunchJobTranscriptsToInt(
 	int JOBID,
-	string_vec options,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path log
 );
 
-static void LaunchJobGmmAlignCompiled(
+static void LaunchJobGmmAlign(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_splice,
 	string_vec options_transformfeats,
-	string_vec options_gmmalignedcomp,
+	string_vec options_gmmalign,
+	kaldi::TrainGraphCache * graph_cache,
 	int iter_id,
 	fs::path sdata,
 	fs::path log
@@ -126,6 +127,8 @@ int TrainLdaMllt(
 	int cluster_thresh = -1;	// for build-tree control final bottom-up clustering of leaves
 	bool norm_vars = false;
 	std::string cmvn_opts, context_opts;
+	int graph_cache_mb = 256;		// memory budget per job (MB) of the training graph cache
+	int acc_num_threads = 0;		// threads per job for the LDA and MLLT statistics accumulation (0 = automatic)
 	po.Register("scale-opts", &scale_opts, "Scale options for gmm-align-compiled.");
 	po.Register("splice-opts", &splice_opts, "Frame-splicing options.");
 	po.Register("num-iters", &num_iters, "Number of iterations of training.");
@@ -145,6 +148,8 @@ int TrainLdaMllt(
 	po.Register("norm-vars", &norm_vars, "Deprecated, prefer --cmvn-opts '--norm - vars = false'.");
 	po.Register("cmvn-opts", &cmvn_opts, "Can be used to add extra options to cmvn.");
 	po.Register("context-opts", &context_opts, "use '--context-width=5 --central-position=2' for quinphone.");
+	po.Register("graph-cache-mb", &graph_cache_mb, "Memory budget per job in MB of the cache of the training graphs.");
+	po.Register("acc-num-threads", &acc_num_threads, "Number of threads per job for the LDA and MLLT statistics accumulation (0 = automatic).");
 	std::vector<std::string> _cmvn_opts, _context_opts;
 	//
 	if (config != "" && fs::exists(config) && !fs::is_empty(config))
@@ -228,6 +233,9 @@ int TrainLdaMllt(
 		LOGTW_WARNING << "The requested number of jobs mismatches alignment data. Resetting nj to " << nj_orig;
 		nj = nj_orig;
 	}
+	//the LDA and MLLT statistics of a job are accumulated by several threads (partial accumulators)
+	if (acc_num_threads <= 0)
+		acc_num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / nj);
 	//save num_jobs
 	StringTable t_njs;
 	string_vec _njs = { std::to_string(nj) };
@@ -325,6 +333,7 @@ int TrainLdaMllt(
 		//
 		options_al.push_back("--print-args=false");
 		options_al.push_back("--rand-prune="+std::to_string(randprune));		
+		options_al.push_back("--num-threads=" + std::to_string(acc_num_threads));
 		options_al.push_back((alidir / "final.mdl").string());
 		options_al.push_back("ark,s,cs:" + (sdata / "JOBID" / "splice.temp").string()); //output from splice-feats
 		options_al.push_back("ark:" + (dir / "wsp.JOBID.temp").string());
@@ -637,27 +646,20 @@ int TrainLdaMllt(
 	} ///stage 1
 
 	//0
-	//Compiling graphs of transcripts
+	//Converting the transcripts to integers
+	//NOTE: the training graphs are not compiled here but on demand by the aligner (GmmAlign) which keeps them in
+	//		a per job graph cache for all realignment passes (see graph_caches below).
 	if (stage <= 0 && _realign_iters.size()>0)
 	{
-		LOGTW_INFO << "Compiling graphs of transcripts...";
+		LOGTW_INFO << "Preparing transcripts for the training graphs...";
 
 		//Sym2Int options
 		std::string symtab((lang / "words.txt").string());
 		std::string input_txt((sdata / "JOBID" / "text").string());
-		std::string output_txt((dir / "trnrspec.JOBID.temp").string()); //output from Sym2Int
+		std::string output_txt((dir / "text.JOBID.int").string()); //output from Sym2Int
 		//oov is defined above
 		int field_begin = 1; //NOTE: zero based index of fields! 2nd field is index=1
 		int field_end = -1;
-		//CompileTrainGraphs options
-		string_vec options;
-		options.push_back("--print-args=false");
-		options.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
-		options.push_back((dir / "tree").string());
-		options.push_back((dir / "1.mdl").string());
-		options.push_back((lang / "L.fst").string());
-		options.push_back("ark:" + output_txt); //output from Sym2Int
-		options.push_back("ark:" + (dir / "fsts.JOBID").string());
 		//---------------------------------------------------------------------
 		//Start parallel processing
 		std::vector<std::thread> _threads;
@@ -668,9 +670,8 @@ int TrainLdaMllt(
 			fs::path log(dir / "log" / ("compile_graphs." + std::to_string(JOBID) + ".log"));
 			//
 			_threads.emplace_back(
-				LaunchJobCompileTrainGraphs,
+				LaunchJobTranscriptsToInt,
 				JOBID,
-				options,
 				symtab, input_txt, output_txt, field_begin, field_end, oov,	//params for Sym2Int
 				log);
 		}
@@ -689,6 +690,11 @@ int TrainLdaMllt(
 	} ///stage 0
 
 
+	//one training graph cache per job, reused by all realignment passes
+	std::vector<std::unique_ptr<kaldi::TrainGraphCache>> graph_caches;
+	for (int JOBID = 1; JOBID <= nj; JOBID++)
+		graph_caches.emplace_back(new kaldi::TrainGraphCache(static_cast<size_t>(graph_cache_mb) * 1024 * 1024));
+
 	//training iterations ----------------------------------------------------->
 	int x = 1;
 	while (x < num_iters) {
@@ -721,19 +727,21 @@ int TrainLdaMllt(
 				StrVec2Arg args(options);
 				if (GmmBoostSilence(args.argc(), args.argv(), file_log) < 0) return -1;
 
-				//2. options for GmmAlignCompiled
-				//options GmmAlignCompiled
-				string_vec options_gmmalignedcomp;
-				options_gmmalignedcomp.push_back("--print-args=false");
+				//2. options for GmmAlign
+				string_vec options_gmmalign;
+				options_gmmalign.push_back("--print-args=false");
 				std::string scareful = (careful ? "true" : "false");
-				options_gmmalignedcomp.push_back("--careful=" + scareful);
-				options_gmmalignedcomp.push_back("--beam=" + std::to_string(beam));
-				options_gmmalignedcomp.push_back("--retry-beam=" + std::to_string(retry_beam));
-				for each(std::string s in _scale_opts) options_gmmalignedcomp.push_back(s);
-				options_gmmalignedcomp.push_back((dir / (sx + ".bs.temp")).string()); //output from boost silence!
-				options_gmmalignedcomp.push_back("ark:" + (dir / "fsts.JOBID").string());
-				options_gmmalignedcomp.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from transform-feats!
-				options_gmmalignedcomp.push_back("ark:" + (dir / "ali.JOBID").string()); //output 
+				options_gmmalign.push_back("--careful=" + scareful);
+				options_gmmalign.push_back("--beam=" + std::to_string(beam));
+				options_gmmalign.push_back("--retry-beam=" + std::to_string(retry_beam));
+				for each(std::string s in _scale_opts) options_gmmalign.push_back(s);
+				options_gmmalign.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
+				options_gmmalign.push_back((dir / "tree").string());
+				options_gmmalign.push_back((dir / (sx + ".bs.temp")).string()); //output from boost silence!
+				options_gmmalign.push_back((lang / "L.fst").string());
+				options_gmmalign.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from transform-feats!
+				options_gmmalign.push_back("ark:" + (dir / "text.JOBID.int").string());
+				options_gmmalign.push_back("ark:" + (dir / "ali.JOBID").string()); //output 
 
 				//---------------------------------------------------------------------
 				//Start parallel processing
@@ -745,12 +753,13 @@ int TrainLdaMllt(
 					fs::path log(dir / "log" / ("align." + sx + "." + std::to_string(JOBID) + ".log"));
 					//
 					_threads.emplace_back(
-						LaunchJobGmmAlignCompiled,
+						LaunchJobGmmAlign,
 						JOBID,
 						options_applycmvn,
 						options_splice,
 						options_transformfeats,
-						options_gmmalignedcomp,
+						options_gmmalign,
+						graph_caches[JOBID - 1].get(),
 						cur_lda_iter,
 						sdata,
 						log);
@@ -789,6 +798,7 @@ int TrainLdaMllt(
 				//
 				options_gam.push_back("--print-args=false");
 				options_gam.push_back("--rand-prune=" + std::to_string(randprune));
+				options_gam.push_back("--num-threads=" + std::to_string(acc_num_threads));
 				options_gam.push_back((dir / (sx + ".mdl")).string());
 				options_gam.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from transform-feats
 				options_gam.push_back("ark:" + (dir / "wsp.JOBID.temp").string());
@@ -1009,6 +1019,9 @@ int TrainLdaMllt(
 		return -1;
 	}
 
+	//Gaussian shortlist for faster decoding (see Decode(), use_shortlist)
+	if (BuildGaussianShortlist(dir) < 0) return -1;
+
 	//diagnostics:
 	if (AnalyzeAlignments(lang, dir) < 0) return -1;
 
@@ -1122,6 +1135,7 @@ static void LaunchJobAccLda(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_a2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -1221,6 +1235,7 @@ static void LaunchJobTreeStats(
 
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_acctreestats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -1282,6 +1297,7 @@ static void LaunchJobConvertAli(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -1301,22 +1317,19 @@ static void LaunchJobConvertAli(
 
 
 /*
-	parallel job for CompileTrainGraphs()
-
-	NOTE: the string_vec options must not be passed by reference and make a copy because of the JOBID's!
+	parallel job for Sym2Int() (transcripts for the training graphs)
 */
-static void LaunchJobCompileTrainGraphs(
+static void LaunchJobTranscriptsToInt(
 	int JOBID,
-	string_vec options,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path log
 )
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
-	for (std::string &s : options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(input_txt, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(output_txt, "JOBID", std::to_string(JOBID));
 
@@ -1341,33 +1354,22 @@ static void LaunchJobCompileTrainGraphs(
 		_ret.push_back(-1);
 		return;
 	}
-
-	int ret;
-	try {
-		StrVec2Arg args(options);
-		ret = CompileTrainGraphs(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (CompileTrainGraphs). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	_ret.push_back(ret);
+	_ret.push_back(0);
 }
 
 
 /*
-	parallel job for GmmAlignCompiled()
+	parallel job for GmmAlign()
 
 	NOTE: the string_vec options must not be passed by reference and make a copy because of the JOBID's!
 */
-static void LaunchJobGmmAlignCompiled(
+static void LaunchJobGmmAlign(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_splice,
 	string_vec options_transformfeats,
-	string_vec options_gmmalignedcomp,
+	string_vec options_gmmalign,
+	kaldi::TrainGraphCache * graph_cache,
 	int iter_id,
 	fs::path sdata,
 	fs::path log
@@ -1378,9 +1380,10 @@ static void LaunchJobGmmAlignCompiled(
 
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
-	for (std::string &s : options_gmmalignedcomp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	for (std::string &s : options_gmmalign) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 
 	int ret = 0;
 	//NOTE: all options (input/output) are distributed already well, therefore we just need to call the functions
@@ -1402,14 +1405,14 @@ static void LaunchJobGmmAlignCompiled(
 		return;
 	}
 
-	//DO: GmmAlignCompiled
+	//DO: GmmAlign
 	try {
-		StrVec2Arg args(options_gmmalignedcomp);
-		ret = GmmAlignCompiled(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_gmmalign);
+		ret = GmmAlign(args.argc(), args.argv(), file_log, graph_cache);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (GmmAlignCompiled). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmAlign). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
@@ -1445,6 +1448,7 @@ static void LaunchJobGmmAccStatsAli(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
 	for (std::string &s : optionsGAC)
@@ -1504,6 +1508,7 @@ static void LaunchJobGmmAccMllt(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
 	for (std::string &s : options_a2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -12,27 +12,31 @@
 #include "kaldi-win/src/kaldi_src.h"
 #include "util/common-utils.h" //for ParseOptions
 #include "kaldi-win/utility/Utility2.h"
+#include "kaldi-win/src/gmmbin/train-graph-cache.h"
 
 
-static void LaunchComposeTransforms(
+static void LaunchJobGmmEstFmllrSpk(
 	int JOBID,
-	string_vec options,
-	fs::path dir,
+	string_vec options_applycmvn,
+	string_vec options_adddeltas,
+	string_vec options_splice,
+	string_vec options_transform_sifeats,
+	string_vec options_transform_feats,
+	string_vec options_gefs,
+	std::string feat_type,
+	fs::path sdata,
 	fs::path log
 );
 
-static void LaunchJobGmmEstFmllr(
+static void LaunchJobGmmBasisFmllrAccsSpk(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_adddeltas,
 	string_vec options_splice,
 	string_vec options_transform_sifeats,
 	string_vec options_transform_feats,
-	string_vec options_a2p,
-	string_vec options_wsp,
-	string_vec options_gef,
+	string_vec options_gbfas,
 	std::string feat_type,
-	bool apply_transform_feats,
 	fs::path sdata,
 	fs::path log
 );
@@ -56,21 +60,21 @@ static void LaunchJobConvertAli(
 	fs::path log
 );
 
-static void LaunchJobCompileTrainGraphs(
+static void LaunchJobTranscriptsToInt(
 	int JOBID,
-	string_vec options,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path log
 );
 
-static void LaunchJobGmmAlignCompiled(
+static void LaunchJobGmmAlign(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_adddeltas,
 	string_vec options_splice,
 	string_vec options_transform_sifeats,
 	string_vec options_transform_feats,
-	string_vec options_gmmalignedcomp,
+	string_vec options_gmmalign,
+	kaldi::TrainGraphCache * graph_cache,
 	std::string feat_type,
 	fs::path sdata,
 	fs::path log
@@ -86,6 +90,7 @@ static void LaunchJobGmmAccStatsAli(
 	string_vec options_transform_feats,
 	std::string feat_type,
 	bool apply_transform_feats,
+	bool feats_ready,
 	fs::path sdata, //params for ApplyCmvnSequence
 	fs::path log);
 
@@ -151,6 +156,9 @@ int TrainSat(
 	bool norm_vars = false;
 	std::string phone_map;
 	std::string context_opts, tree_stats_opts, cluster_phones_opts, compile_questions_opts;
+	int graph_cache_mb = 256;		// memory budget per job (MB) of the training graph cache
+	int fmllr_num_threads = 0;		// threads per job for the per speaker fMLLR estimation (0 = automatic)
+	bool fmllr_basis = true;		// estimate the fMLLR basis (dir/fmllr.basis) for DecodeBasisFmllr()
 	po.Register("num-iters", &num_iters, "Number of iterations of training.");
 	po.Register("exit-stage", &exit_stage, "You can use this to require it to exit at the beginning of a specific stage.Not all values are supported.");	
 	po.Register("fmllr-update-type", &fmllr_update_type, ".");
@@ -171,6 +179,9 @@ int TrainSat(
 	//options
 	po.Register("scale-opts", &scale_opts, "Scale options for gmm-align-compiled.");
 	po.Register("context-opts", &context_opts, "use '--context-width=5 --central-position=2' for quinphone.");
+	po.Register("graph-cache-mb", &graph_cache_mb, "Memory budget per job in MB of the cache of the training graphs.");
+	po.Register("fmllr-num-threads", &fmllr_num_threads, "Number of threads per job for the per speaker fMLLR estimation (0 = automatic).");
+	po.Register("fmllr-basis", &fmllr_basis, "Estimate the fMLLR basis of the final model for basis fMLLR decoding (DecodeBasisFmllr).");
 	po.Register("tree-stats-opts", &tree_stats_opts, "(one line separated by space).");
 	po.Register("cluster-phones-opts", &cluster_phones_opts, "(one line separated by space).");
 	po.Register("compile-questions-opts", &compile_questions_opts, "(one line separated by space).");
@@ -405,6 +416,17 @@ int TrainSat(
 	options_acctreestats.push_back("ark:" + (alidir / "ali.JOBID").string());
 	options_acctreestats.push_back((dir / "JOBID.treeacc").string()); //output 
 
+	//fMLLR estimation options (GmmEstFmllrSpk); the speakers of a job are estimated in parallel in memory
+	if (fmllr_num_threads <= 0)
+		fmllr_num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / nj);
+	string_vec options_gefs_common;
+	options_gefs_common.push_back("--print-args=false");
+	options_gefs_common.push_back("--fmllr-update-type=" + fmllr_update_type);
+	options_gefs_common.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
+	options_gefs_common.push_back("--silence-weight=" + std::to_string(silence_weight));
+	options_gefs_common.push_back("--silence-phones=" + silphonelist);
+	options_gefs_common.push_back("--num-threads=" + std::to_string(fmllr_num_threads));
+
 	//Get initial fMLLR transforms (possibly from alignment dir)
 	if(cur_trans_dir == dir) {
 		//5 ----->
@@ -418,31 +440,14 @@ int TrainSat(
 				return -1;
 			}
 
-			string_vec options_a2p, options_wsp, options_gef;
-			//a2p
-			options_a2p.push_back("--print-args=false");
-			options_a2p.push_back("ark:" + (alidir / "ali.JOBID").string());
-			options_a2p.push_back("ark:" + (alidir / "ali.JOBID.temp").string());
-			//wsp
-			options_wsp.push_back("--print-args=false");
-			options_wsp.push_back(std::to_string(silence_weight));
-			options_wsp.push_back(silphonelist);
-			options_wsp.push_back((alidir / "final.mdl").string());
-			options_wsp.push_back("ark:" + (alidir / "ali.JOBID.temp").string());
-			options_wsp.push_back("ark:" + (alidir / "wsp.JOBID.temp").string());
-			//gef
-			options_gef.push_back("--print-args=false");
-			options_gef.push_back("--fmllr-update-type=" + fmllr_update_type);
-			options_gef.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
-			options_gef.push_back((alidir / "final.mdl").string());
-
+			string_vec options_gefs(options_gefs_common);
+			options_gefs.push_back((alidir / "final.mdl").string());
 			if (feat_type == "lda")
-				options_gef.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_sifeats.temp").string()); //output from first transform-feats
+				options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_sifeats.temp").string()); //output from first transform-feats
 			else
-				options_gef.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
-
-			options_gef.push_back("ark:" + (alidir / "wsp.JOBID.temp").string());
-			options_gef.push_back("ark:" + (dir / "trans.JOBID").string());
+				options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
+			options_gefs.push_back("ark,s,cs:" + (alidir / "ali.JOBID").string());
+			options_gefs.push_back("ark:" + (dir / "trans.JOBID").string());
 			//---------------------------------------------------------------------
 			//Start parallel processing
 			std::vector<std::thread> _threads;
@@ -452,18 +457,15 @@ int TrainSat(
 				//logfile
 				fs::path log(dir / "log" / ("fmllr.0." + std::to_string(JOBID) + ".log"));
 				_threads.emplace_back(
-					LaunchJobGmmEstFmllr,
+					LaunchJobGmmEstFmllrSpk,
 					JOBID,
 					options_applycmvn,
 					options_adddeltas,
 					options_splice,
 					options_transform_sifeats,
 					options_transform_feats,
-					options_a2p,
-					options_wsp,
-					options_gef,
+					options_gefs,
 					feat_type,
-					false,	//!
 					sdata,
 					log);
 			}
@@ -479,7 +481,6 @@ int TrainSat(
 			//---------------------------------------------------------------------
 
 			//clean up
-			DeleteAllMatching(alidir, boost::regex(".*(\\.temp)$"));
 			for (int JOBID = 1; JOBID <= nj; JOBID++)
 				DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
 		}
@@ -743,27 +744,20 @@ int TrainSat(
 	}
 
 	//0
-	//Compiling graphs of transcripts
+	//Converting the transcripts to integers
+	//NOTE: the training graphs are not compiled here but on demand by the aligner (GmmAlign) which keeps them in
+	//		a per job graph cache for all realignment passes (see graph_caches below).
 	if (stage <= 0 && _realign_iters.size()>0)
 	{
-		LOGTW_INFO << "Compiling graphs of transcripts...";
+		LOGTW_INFO << "Preparing transcripts for the training graphs...";
 
 		//Sym2Int options
 		std::string symtab((lang / "words.txt").string());
 		std::string input_txt((sdata / "JOBID" / "text").string());
-		std::string output_txt((dir / "trnrspec.JOBID.temp").string()); //output from Sym2Int
+		std::string output_txt((dir / "text.JOBID.int").string()); //output from Sym2Int
 		//oov is defined above
 		int field_begin = 1; //NOTE: zero based index of fields! 2nd field is index=1
 		int field_end = -1;
-		//CompileTrainGraphs options
-		string_vec options;
-		options.push_back("--print-args=false");
-		options.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
-		options.push_back((dir / "tree").string());
-		options.push_back((dir / "1.mdl").string());
-		options.push_back((lang / "L.fst").string());
-		options.push_back("ark:" + output_txt); //output from Sym2Int
-		options.push_back("ark:" + (dir / "fsts.JOBID").string());
 		//---------------------------------------------------------------------
 		//Start parallel processing
 		std::vector<std::thread> _threads;
@@ -774,9 +768,8 @@ int TrainSat(
 			fs::path log(dir / "log" / ("compile_graphs." + std::to_string(JOBID) + ".log"));
 			//
 			_threads.emplace_back(
-				LaunchJobCompileTrainGraphs,
+				LaunchJobTranscriptsToInt,
 				JOBID,
-				options,
 				symtab, input_txt, output_txt, field_begin, field_end, oov,	//params for Sym2Int
 				log);
 		}
@@ -795,11 +788,17 @@ int TrainSat(
 	} ///stage 0
 
 
+	//one training graph cache per job, reused by all realignment passes
+	std::vector<std::unique_ptr<kaldi::TrainGraphCache>> graph_caches;
+	for (int JOBID = 1; JOBID <= nj; JOBID++)
+		graph_caches.emplace_back(new kaldi::TrainGraphCache(static_cast<size_t>(graph_cache_mb) * 1024 * 1024));
+
 	//training iterations ----------------------------------------------------->
 	int x = 1;
 	while (x < num_iters) {
 		LOGTW_INFO << "Training pass " << x;
 		std::string sx(std::to_string(x));
+		bool fmllr_feats_ready = false;	//the fMLLR pass of this iteration wrote the adapted features
 		if (stage <= x)
 		{
 			if (std::find(_realign_iters.begin(), _realign_iters.end(), x) != _realign_iters.end())
@@ -827,19 +826,21 @@ int TrainSat(
 				StrVec2Arg args(options);
 				if (GmmBoostSilence(args.argc(), args.argv(), file_log) < 0) return -1;
 
-				//2. options for GmmAlignCompiled
-				//options GmmAlignCompiled
-				string_vec options_gmmalignedcomp;
-				options_gmmalignedcomp.push_back("--print-args=false");
+				//2. options for GmmAlign
+				string_vec options_gmmalign;
+				options_gmmalign.push_back("--print-args=false");
 				std::string scareful = (careful ? "true" : "false");
-				options_gmmalignedcomp.push_back("--careful=" + scareful);
-				options_gmmalignedcomp.push_back("--beam=" + std::to_string(beam));
-				options_gmmalignedcomp.push_back("--retry-beam=" + std::to_string(retry_beam));
-				for each(std::string s in _scale_opts) options_gmmalignedcomp.push_back(s);
-				options_gmmalignedcomp.push_back((dir / (sx + ".bs.temp")).string()); //output from boost silence!
-				options_gmmalignedcomp.push_back("ark:" + (dir / "fsts.JOBID").string());
-				options_gmmalignedcomp.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from transform-feats!
-				options_gmmalignedcomp.push_back("ark:" + (dir / "ali.JOBID").string()); //output 
+				options_gmmalign.push_back("--careful=" + scareful);
+				options_gmmalign.push_back("--beam=" + std::to_string(beam));
+				options_gmmalign.push_back("--retry-beam=" + std::to_string(retry_beam));
+				for each(std::string s in _scale_opts) options_gmmalign.push_back(s);
+				options_gmmalign.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
+				options_gmmalign.push_back((dir / "tree").string());
+				options_gmmalign.push_back((dir / (sx + ".bs.temp")).string()); //output from boost silence!
+				options_gmmalign.push_back((lang / "L.fst").string());
+				options_gmmalign.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from transform-feats!
+				options_gmmalign.push_back("ark:" + (dir / "text.JOBID.int").string());
+				options_gmmalign.push_back("ark:" + (dir / "ali.JOBID").string()); //output 
 
 				//---------------------------------------------------------------------
 				//Start parallel processing
@@ -851,14 +852,15 @@ int TrainSat(
 					fs::path log(dir / "log" / ("align." + sx + "." + std::to_string(JOBID) + ".log"));
 					//
 					_threads.emplace_back(
-						LaunchJobGmmAlignCompiled,
+						LaunchJobGmmAlign,
 						JOBID,
 						options_applycmvn,
 						options_adddeltas,
 						options_splice,
 						options_transform_sifeats,
 						options_transform_feats,
-						options_gmmalignedcomp,
+						options_gmmalign,
+						graph_caches[JOBID - 1].get(),
 						feat_type,
 						sdata,
 						log);
@@ -882,28 +884,19 @@ int TrainSat(
 			if (stage <= x)
 			{
 				LOGTW_INFO << "Estimating fMLLR transforms...";
-				/* We estimate a transform that's additional to the previous transform; we'll compose them. */
-
-				string_vec options_a2p, options_wsp, options_gef;
-				//a2p
-				options_a2p.push_back("--print-args=false");
-				options_a2p.push_back("ark:" + (dir / "ali.JOBID").string());
-				options_a2p.push_back("ark:" + (dir / "ali.JOBID.temp").string());
-				//wsp
-				options_wsp.push_back("--print-args=false");
-				options_wsp.push_back(std::to_string(silence_weight));
-				options_wsp.push_back(silphonelist);
-				options_wsp.push_back((dir / (sx + ".mdl")).string());
-				options_wsp.push_back("ark:" + (dir / "ali.JOBID.temp").string());
-				options_wsp.push_back("ark:" + (dir / "wsp.JOBID.temp").string());
-				//gef
-				options_gef.push_back("--print-args=false");
-				options_gef.push_back("--fmllr-update-type=" + fmllr_update_type);
-				options_gef.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
-				options_gef.push_back((dir / (sx + ".mdl")).string());
-				options_gef.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_feats.temp").string()); //output from first transform-feats
-				options_gef.push_back("ark:" + (dir / "wsp.JOBID.temp").string());
-				options_gef.push_back("ark:" + (dir / "tmp_trans.JOBID").string());
+				/*	We estimate a transform that's additional to the previous transform; we'll compose them.
+					The new transforms are estimated, composed with the current ones and applied to the features in
+					memory per speaker; the adapted features are used directly by the accumulation of this iteration. */
+				string_vec options_gefs(options_gefs_common);
+				options_gefs.push_back("--transforms-in=ark:" + (cur_trans_dir / "trans.JOBID").string());
+				options_gefs.push_back("--adapted-feats-out=ark:" + (sdata / "JOBID" / "transform_feats.temp").string());
+				options_gefs.push_back((dir / (sx + ".mdl")).string());
+				if (feat_type == "lda")
+					options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_sifeats.temp").string()); //output from first transform-feats
+				else
+					options_gefs.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
+				options_gefs.push_back("ark,s,cs:" + (dir / "ali.JOBID").string());
+				options_gefs.push_back("ark:" + (dir / "trans.JOBID").string());
 				//---------------------------------------------------------------------
 				{
 					//Start parallel processing
@@ -914,18 +907,15 @@ int TrainSat(
 						//logfile
 						fs::path log(dir / "log" / ("fmllr." + sx + "." + std::to_string(JOBID) + ".log"));
 						_threads.emplace_back(
-							LaunchJobGmmEstFmllr,
+							LaunchJobGmmEstFmllrSpk,
 							JOBID,
 							options_applycmvn,
 							options_adddeltas,
 							options_splice,
 							options_transform_sifeats,
 							options_transform_feats,
-							options_a2p,
-							options_wsp,
-							options_gef,
+							options_gefs,
 							feat_type,
-							true,	//!
 							sdata,
 							log);
 					}
@@ -940,49 +930,12 @@ int TrainSat(
 					}
 				}
 				//---------------------------------------------------------------------
-
-				//clean up
-				DeleteAllMatching(dir, boost::regex(".*(\\.temp)$"));
-				for (int JOBID = 1; JOBID <= nj; JOBID++)
-					DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
-
-				string_vec options;
-				options.push_back("--print-args=false");
-				options.push_back("--b-is-affine=true");
-				options.push_back("ark:" + (dir / "tmp_trans.JOBID").string());
-				options.push_back("ark:" + (cur_trans_dir / "trans.JOBID").string());
-				options.push_back("ark:" + (dir / "composed_trans.JOBID").string());
-				//---------------------------------------------------------------------
-				{
-					//Start parallel processing
-					std::vector<std::thread> _threads;
-					_ret.clear();
-					for (int JOBID = 1; JOBID <= nj; JOBID++)
-					{
-						//logfile
-						fs::path log(dir / "log" / ("compose_transforms." + sx + "." + std::to_string(JOBID) + ".log"));
-						_threads.emplace_back(
-							LaunchComposeTransforms,
-							JOBID,
-							options,
-							dir,
-							log);
-					}
-					//wait for the threads till they are ready
-					for (auto& t : _threads) {
-						t.join();
-					}
-					//check return values from the threads/jobs
-					for (int JOBID = 1; JOBID <= nj; JOBID++) {
-						if (_ret[JOBID - 1] < 0)
-							return -1;
-					}
-				}
-				//---------------------------------------------------------------------
+				fmllr_feats_ready = true;
 			}
 
-			//
+			//the features are transformed with the composed transforms from now on
 			cur_trans_dir = dir;
+			options_transform_feats[2] = "ark,s,cs:" + (cur_trans_dir / "trans.JOBID").string();
 		} ///Estimating MLLT
 
 
@@ -1014,6 +967,7 @@ int TrainSat(
 					options_transform_feats,
 					feat_type,
 					true,	//!
+					fmllr_feats_ready,
 					sdata,
 					log);
 			}
@@ -1195,6 +1149,83 @@ int TrainSat(
 		return -1;
 	}
 
+	//fMLLR basis for single-pass adapted decoding (see DecodeBasisFmllr()); as in steps/get_fmllr_basis.sh the
+	//statistics are accumulated per speaker on the speaker independent features with the final model
+	if (fmllr_basis) {
+		LOGTW_INFO << "Estimating the fMLLR basis...";
+
+		string_vec options_gbfas;
+		options_gbfas.push_back("--print-args=false");
+		options_gbfas.push_back("--spk2utt=ark:" + (sdata / "JOBID" / "spk2utt").string());
+		options_gbfas.push_back("--silence-weight=" + std::to_string(silence_weight));
+		options_gbfas.push_back("--silence-phones=" + silphonelist);
+		options_gbfas.push_back("--num-threads=" + std::to_string(fmllr_num_threads));
+		options_gbfas.push_back((dir / "final.mdl").string());
+		if (feat_type == "lda")
+			options_gbfas.push_back("ark,s,cs:" + (sdata / "JOBID" / "transform_sifeats.temp").string()); //output from first transform-feats
+		else
+			options_gbfas.push_back("ark,s,cs:" + (sdata / "JOBID" / "add_deltas.temp").string()); //output from add_deltas
+		options_gbfas.push_back("ark,s,cs:" + (dir / "ali.JOBID").string());
+		options_gbfas.push_back((dir / "basis.JOBID.acc").string());
+		//---------------------------------------------------------------------
+		//Start parallel processing
+		std::vector<std::thread> _threads;
+		_ret.clear();
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+		{
+			//logfile
+			fs::path log(dir / "log" / ("basis_acc." + std::to_string(JOBID) + ".log"));
+			_threads.emplace_back(
+				LaunchJobGmmBasisFmllrAccsSpk,
+				JOBID,
+				options_applycmvn,
+				options_adddeltas,
+				options_splice,
+				options_transform_sifeats,
+				options_transform_feats,
+				options_gbfas,
+				feat_type,
+				sdata,
+				log);
+		}
+		//wait for the threads till they are ready
+		for (auto& t : _threads) {
+			t.join();
+		}
+		//check return values from the threads/jobs
+		for (int JOBID = 1; JOBID <= nj; JOBID++) {
+			if (_ret[JOBID - 1] < 0)
+				return -1;
+		}
+		//---------------------------------------------------------------------
+		for (int JOBID = 1; JOBID <= nj; JOBID++)
+			DeleteAllMatching(sdata / std::to_string(JOBID), boost::regex(".*(\\.temp)$"));
+
+		//Gmm basis fMLLR training
+		try {
+			fs::ofstream file_log(dir / "log" / "basis_training.log", fs::ofstream::binary | fs::ofstream::out);
+			if (!file_log) LOGTW_WARNING << "Log file is not accessible " << (dir / "log" / "basis_training.log").string() << ".";
+			string_vec options;
+			options.push_back("--print-args=false");
+			options.push_back((dir / "final.mdl").string());
+			options.push_back((dir / "fmllr.basis").string()); //output
+			for (int JOBID = 1; JOBID <= nj; JOBID++)
+				options.push_back((dir / ("basis." + std::to_string(JOBID) + ".acc")).string());
+			StrVec2Arg args(options);
+			if (GmmBasisFmllrTraining(args.argc(), args.argv(), file_log) < 0) return -1;
+		}
+		catch (const std::exception& ex)
+		{
+			LOGTW_FATALERROR << "Error in (GmmBasisFmllrTraining). Reason: " << ex.what();
+			return -1;
+		}
+
+		DeleteAllMatching(dir, boost::regex("^(basis\\.).*(\\.acc)$"));
+	}
+
+	//Gaussian shortlist for faster decoding (see Decode(), use_shortlist)
+	if (BuildGaussianShortlist(dir) < 0) return -1;
+
 	//diagnostics:
 	if (AnalyzeAlignments(lang, dir) < 0) return -1;
 
@@ -1351,6 +1382,7 @@ static void LaunchJobTreeStats(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << " log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options_acctreestats) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -1418,6 +1450,7 @@ static void LaunchJobConvertAli(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
 	for (std::string &s : options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
@@ -1437,22 +1470,19 @@ static void LaunchJobConvertAli(
 
 
 /*
-parallel job for CompileTrainGraphs()
-
-NOTE: the string_vec options must not be passed by reference and make a copy because of the JOBID's!
+parallel job for Sym2Int() (transcripts for the training graphs)
 */
-static void LaunchJobCompileTrainGraphs(
+static void LaunchJobTranscriptsToInt(
 	int JOBID,
-	string_vec options,
 	std::string symtab, std::string input_txt, std::string output_txt, int field_begin, int field_end, std::string oov,	//params for Sym2Int
 	fs::path log
 )
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
-	for (std::string &s : options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(input_txt, "JOBID", std::to_string(JOBID));
 	ReplaceStringInPlace(output_txt, "JOBID", std::to_string(JOBID));
 
@@ -1477,35 +1507,24 @@ static void LaunchJobCompileTrainGraphs(
 		_ret.push_back(-1);
 		return;
 	}
-
-	int ret;
-	try {
-		StrVec2Arg args(options);
-		ret = CompileTrainGraphs(args.argc(), args.argv(), file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (CompileTrainGraphs). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
-	}
-	_ret.push_back(ret);
+	_ret.push_back(0);
 }
 
 
 /*
-parallel job for GmmAlignCompiled()
+parallel job for GmmAlign()
 
 NOTE: the string_vec options must not be passed by reference and make a copy because of the JOBID's!
 */
-static void LaunchJobGmmAlignCompiled(
+static void LaunchJobGmmAlign(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_adddeltas,
 	string_vec options_splice,
 	string_vec options_transform_sifeats,
 	string_vec options_transform_feats,
-	string_vec options_gmmalignedcomp,
+	string_vec options_gmmalign,
+	kaldi::TrainGraphCache * graph_cache,
 	std::string feat_type,
 	fs::path sdata,
 	fs::path log
@@ -1513,9 +1532,10 @@ static void LaunchJobGmmAlignCompiled(
 {
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread
-	for (std::string &s : options_gmmalignedcomp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	for (std::string &s : options_gmmalign) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 
 	int ret = 0;
 	//NOTE: all options (input/output) are distributed already well, therefore we just need to call the functions
@@ -1545,14 +1565,14 @@ static void LaunchJobGmmAlignCompiled(
 		return;
 	}
 
-	//DO: GmmAlignCompiled
+	//DO: GmmAlign
 	try {
-		StrVec2Arg args(options_gmmalignedcomp);
-		ret = GmmAlignCompiled(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_gmmalign);
+		ret = GmmAlign(args.argc(), args.argv(), file_log, graph_cache);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (GmmAlignCompiled). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmAlign). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
@@ -1582,12 +1602,14 @@ static void LaunchJobGmmAccStatsAli(
 	string_vec options_transform_feats,
 	std::string feat_type,
 	bool apply_transform_feats,
+	bool feats_ready, //the adapted features were written by the fMLLR pass (GmmEstFmllrSpk)
 	fs::path sdata, //params for ApplyCmvnSequence
 	fs::path log)
 {
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
 	for (std::string &s : optionsGAC)
@@ -1598,22 +1620,24 @@ static void LaunchJobGmmAccStatsAli(
 	std::string outcmvn;
 	int ret1 = 0;
 
-	try {
-		ret1 = ApplyCmvnSequence(JOBID,
-			options_applycmvn,
-			options_adddeltas,
-			options_splice,
-			options_transform_sifeats,
-			options_transform_feats,
-			feat_type,
-			apply_transform_feats,
-			sdata, outcmvn, file_log);
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (ApplyCmvnSequence). Reason: " << ex.what();
-		_ret.push_back(-1);
-		return;
+	if (!feats_ready) {
+		try {
+			ret1 = ApplyCmvnSequence(JOBID,
+				options_applycmvn,
+				options_adddeltas,
+				options_splice,
+				options_transform_sifeats,
+				options_transform_feats,
+				feat_type,
+				apply_transform_feats,
+				sdata, outcmvn, file_log);
+		}
+		catch (const std::exception& ex)
+		{
+			LOGTW_FATALERROR << "Error in (ApplyCmvnSequence). Reason: " << ex.what();
+			_ret.push_back(-1);
+			return;
+		}
 	}
 	if (ret1 < 0) {
 		//do not proceed if failed
@@ -1636,19 +1660,16 @@ static void LaunchJobGmmAccStatsAli(
 }
 
 
-//LaunchJobGmmEstFmllr
-static void LaunchJobGmmEstFmllr(
+//LaunchJobGmmBasisFmllrAccsSpk
+static void LaunchJobGmmBasisFmllrAccsSpk(
 	int JOBID,
 	string_vec options_applycmvn,
 	string_vec options_adddeltas,
 	string_vec options_splice,
 	string_vec options_transform_sifeats,
 	string_vec options_transform_feats,
-	string_vec options_a2p,
-	string_vec options_wsp,
-	string_vec options_gef,
+	string_vec options_gbfas,
 	std::string feat_type,
-	bool apply_transform_feats,
 	fs::path sdata,
 	fs::path log
 )
@@ -1656,24 +1677,24 @@ static void LaunchJobGmmEstFmllr(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
-	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
-	for (std::string &s : options_a2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_wsp) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-	for (std::string &s : options_gef) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+	//replace 'JOBID' with the current job ID of the thread
+	for (std::string &s : options_gbfas) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
 
 	std::string outcmvn;
 	int ret = 0;
 
+	//NOTE: speaker independent features
 	try {
-		ret = ApplyCmvnSequence(JOBID, 
-			options_applycmvn, 
-			options_adddeltas, 
-			options_splice, 
+		ret = ApplyCmvnSequence(JOBID,
+			options_applycmvn,
+			options_adddeltas,
+			options_splice,
 			options_transform_sifeats,
 			options_transform_feats,
-			feat_type, 
-			apply_transform_feats,
+			feat_type,
+			false,
 			sdata, outcmvn, file_log);
 	}
 	catch (const std::exception& ex)
@@ -1688,31 +1709,61 @@ static void LaunchJobGmmEstFmllr(
 		return;
 	}
 
-	//AliToPost
+	//ali-to-post | weight-silence-post | gmm-basis-fmllr-accs in memory
 	try {
-		StrVec2Arg args(options_a2p);
-		ret = AliToPost(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_gbfas);
+		ret = GmmBasisFmllrAccsSpk(args.argc(), args.argv(), file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (AliToPost). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmBasisFmllrAccsSpk). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
-	if (ret < 0) {
-		//do not proceed if failed
-		_ret.push_back(ret);
-		return;
-	}
 
-	//WeightSilencePost
+	_ret.push_back(ret);
+}
+
+//LaunchJobGmmEstFmllrSpk
+static void LaunchJobGmmEstFmllrSpk(
+	int JOBID,
+	string_vec options_applycmvn,
+	string_vec options_adddeltas,
+	string_vec options_splice,
+	string_vec options_transform_sifeats,
+	string_vec options_transform_feats,
+	string_vec options_gefs,
+	std::string feat_type,
+	fs::path sdata,
+	fs::path log
+)
+{
+	//we redirect logging to the log file:
+	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
+	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
+
+	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
+	for (std::string &s : options_gefs) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
+
+	std::string outcmvn;
+	int ret = 0;
+
+	//NOTE: speaker independent features, the current transforms are applied in memory by GmmEstFmllrSpk
 	try {
-		StrVec2Arg args(options_wsp);
-		ret = WeightSilencePost(args.argc(), args.argv(), file_log);
+		ret = ApplyCmvnSequence(JOBID, 
+			options_applycmvn, 
+			options_adddeltas, 
+			options_splice, 
+			options_transform_sifeats,
+			options_transform_feats,
+			feat_type, 
+			false,
+			sdata, outcmvn, file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (WeightSilencePost). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (ApplyCmvnSequence). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
@@ -1722,13 +1773,14 @@ static void LaunchJobGmmEstFmllr(
 		return;
 	}
 
+	//ali-to-post | weight-silence-post | gmm-est-fmllr | compose-transforms in memory
 	try {
-		StrVec2Arg args(options_gef);
-		ret = GmmEstFmllr(args.argc(), args.argv(), file_log);
+		StrVec2Arg args(options_gefs);
+		ret = GmmEstFmllrSpk(args.argc(), args.argv(), file_log);
 	}
 	catch (const std::exception& ex)
 	{
-		LOGTW_FATALERROR << "Error in (GmmAccMllt). Reason: " << ex.what();
+		LOGTW_FATALERROR << "Error in (GmmEstFmllrSpk). Reason: " << ex.what();
 		_ret.push_back(-1);
 		return;
 	}
@@ -1737,44 +1789,6 @@ static void LaunchJobGmmEstFmllr(
 }
 
 
-static void LaunchComposeTransforms(
-	int JOBID,
-	string_vec options,
-	fs::path dir,
-	fs::path log
-)
-{
-	//we redirect logging to the log file:
-	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
-	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
-
-	for (std::string &s : options) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
-
-	StrVec2Arg args(options);
-
-	try {
-		int ret = ComposeTransforms(args.argc(), args.argv(), file_log);
-		if (ret < 0) {
-			//do not proceed if failed
-			_ret.push_back(ret);
-			return;
-		}
-
-		fs::copy_file(dir / ("composed_trans." + std::to_string(JOBID)), dir / ("trans." + std::to_string(JOBID)), fs::copy_option::overwrite_if_exists);
-		//cleanup
-		if (fs::exists(dir / ("tmp_trans." + std::to_string(JOBID)))) fs::remove(dir / ("tmp_trans." + std::to_string(JOBID)));
-		if (fs::exists(dir / ("composed_trans." + std::to_string(JOBID)))) fs::remove(dir / ("composed_trans." + std::to_string(JOBID)));
-	}
-	catch (const std::exception& ex)
-	{
-		LOGTW_FATALERROR << "Error in (ComposeTransforms). Reason: " << ex.what();
-		_ret.push_back(-1);
-	}
-
-	_ret.push_back(0);
-}
-
-
 //LaunchJobGmmAccStatsTwofeats
 static void LaunchJobGmmAccStatsTwofeats(
 	int JOBID,
@@ -1793,6 +1807,7 @@ static void LaunchJobGmmAccStatsTwofeats(
 	//we redirect logging to the log file:
 	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
 	if (!file_log) LOGTW_WARNING << "Log file is not accessible " << log.string() << ".";
+	KaldiJobLogSink job_log_sink(file_log);
 
 	//replace 'JOBID' with the current job ID of the thread; must do in this way because JOBID is added outside of this loop also!
 	for (std::string &s : options_a2p) ReplaceStringInPlace(s, "JOBID", std::to_string(JOBID));
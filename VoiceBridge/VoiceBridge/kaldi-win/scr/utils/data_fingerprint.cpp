@@ -0,0 +1,361 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+/*
+ Incremental processing of a data directory.
+ Each utterance gets a content fingerprint made of the wav data (the bytes of the wav file, or the command for piped
+ wav.scp entries), the segment (if there is a segments file) and the contents of the feature configuration files.
+ The fingerprints are stored in <datadir>/utt2fingerprint in the format:
+	<utt> <fingerprint> <recording> <wav hash> <wav size> <wav time>
+ The size and time of the wav file are kept so that a wav file is only read and hashed again if it changed.
+ When the features are extracted in incremental mode (e.g. MakeMfcc(..., incremental=true)) the utterances with an
+ unchanged fingerprint keep their entry in feats.scp (pointing into the existing archives) and only the new or changed
+ utterances are extracted, into archives with a new name (suffix) so that the existing archives are not overwritten.
+ ComputeCmvnStats(..., incremental=true) does the same per speaker with <datadir>/spk2fingerprint, which is made of the
+ feats.scp entries and the fingerprints of the utterances of the speaker; only the speakers with new, changed or removed
+ utterances get their stats recomputed. Whenever the feature archives are rewritten with their former names (a
+ non-incremental run, or an incremental run which does not reuse any features) spk2fingerprint is deleted.
+ NOTE: a non-incremental run rewrites everything and overwrites the original archives, the archives made by the
+	   incremental runs are then not used any more and can be deleted.
+*/
+
+#include "kaldi-win/scr/kaldi_scr.h"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+//64 bit FNV-1a hash
+static uint64_t HashBytes(const char * data, size_t size, uint64_t h = FNV_OFFSET)
+{
+	for (size_t i = 0; i < size; i++) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+static uint64_t HashString(const std::string & s, uint64_t h = FNV_OFFSET)
+{
+	//NOTE: the terminating zero is also hashed so that "ab"+"c" and "a"+"bc" are different
+	return HashBytes(s.c_str(), s.size() + 1, h);
+}
+
+static int HashFile(fs::path p, uint64_t & h)
+{
+	fs::ifstream file_in(p, std::ios::binary | std::ios::in);
+	if (!file_in) {
+		LOGTW_ERROR << "Can't open input file: " << p.string() << ".";
+		return -1;
+	}
+	std::vector<char> buffer(1 << 20);
+	h = FNV_OFFSET;
+	while (file_in) {
+		file_in.read(buffer.data(), buffer.size());
+		h = HashBytes(buffer.data(), static_cast<size_t>(file_in.gcount()), h);
+	}
+	return 0;
+}
+
+static std::string FingerprintToString(uint64_t h)
+{
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << h;
+	return ss.str();
+}
+
+static std::string JoinColumns(const string_vec & row, size_t first)
+{
+	std::string s;
+	for (size_t c = first; c < row.size(); c++) {
+		if (c > first) s += " ";
+		s += row[c];
+	}
+	return s;
+}
+
+//returns the archive path of a feats.scp or cmvn.scp entry (e.g. "C:\data\raw_mfcc_train.1.ark:1234")
+static std::string ArchiveOfEntry(const std::string & entry)
+{
+	size_t pos = entry.find_last_of(':');
+	//NOTE: a colon at position 1 is the drive letter
+	if (pos == std::string::npos || pos < 2) return entry;
+	return entry.substr(0, pos);
+}
+
+//reads a table which has the key in the first column and the rest of the line as value
+static int ReadEntries(fs::path p, UMAPSS & entries)
+{
+	if (!fs::exists(p)) return 0;
+	StringTable table;
+	if (ReadStringTable(p.string(), table) < 0) return -1;
+	for (StringTable::const_iterator it(table.begin()), it_end(table.end()); it != it_end; ++it) {
+		if ((*it).size() < 2) continue;
+		entries[(*it)[0]] = JoinColumns(*it, 1);
+	}
+	return 0;
+}
+
+//true if the entry points into an existing archive; the results are cached per archive
+static bool ArchiveExists(const std::string & entry, std::unordered_map<std::string, bool> & cache)
+{
+	std::string ark = ArchiveOfEntry(entry);
+	std::unordered_map<std::string, bool>::const_iterator it = cache.find(ark);
+	if (it != cache.end()) return it->second;
+	bool exists = fs::exists(ark);
+	cache.emplace(ark, exists);
+	return exists;
+}
+
+//makes the suffix for the archives of an incremental run (from the current time)
+std::string IncrementalSuffix()
+{
+	std::stringstream sT;
+	auto t = std::time(nullptr);
+	auto tm = *std::localtime(&t);
+	sT << "_" << std::put_time(&tm, "%Y%m%d-%H%M%S");
+	return sT.str();
+}
+
+/*
+	Computes the fingerprints of the utterances in datadir and determines which utterances can keep their features.
+	old_feats : the feats.scp of the former run (the features must be in existing archives)
+	configs :	all files which influence the features (missing files are skipped)
+*/
+int PrepareIncrementalFeats(fs::path datadir, fs::path old_feats, std::vector<fs::path> configs, IncrementalFeats & inc)
+{
+	fs::path logdir = datadir / "log";
+	std::string name = datadir.stem().string();
+	inc = IncrementalFeats();
+
+	//configuration
+	uint64_t config_hash = FNV_OFFSET;
+	for (fs::path p : configs) {
+		if (p.empty() || !fs::exists(p)) continue;
+		uint64_t h;
+		if (HashFile(p, h) < 0) return -1;
+		config_hash = HashBytes(reinterpret_cast<const char*>(&h), sizeof(h), config_hash);
+	}
+
+	//recordings and segments
+	StringTable t_wavscp, t_segments;
+	if (ReadStringTable((datadir / "wav.scp").string(), t_wavscp) < 0) return -1;
+	bool has_segments = fs::exists(datadir / "segments");
+	if (has_segments && ReadStringTable((datadir / "segments").string(), t_segments) < 0) return -1;
+	UMAPSS rec2wav;
+	for (StringTable::const_iterator it(t_wavscp.begin()), it_end(t_wavscp.end()); it != it_end; ++it) {
+		if ((*it).size() < 2) {
+			LOGTW_ERROR << "Invalid line in " << (datadir / "wav.scp").string() << ".";
+			return -1;
+		}
+		rec2wav[(*it)[0]] = JoinColumns(*it, 1);
+	}
+
+	//the former fingerprints: the wav hash is reused when the size and time of the wav file did not change
+	struct WavInfo { std::string hash, size, time; };
+	std::unordered_map<std::string, WavInfo> old_wav;
+	UMAPSS old_utt2fp;
+	if (fs::exists(datadir / "utt2fingerprint")) {
+		StringTable t_old;
+		if (ReadStringTable((datadir / "utt2fingerprint").string(), t_old) < 0) return -1;
+		for (StringTable::const_iterator it(t_old.begin()), it_end(t_old.end()); it != it_end; ++it) {
+			if ((*it).size() != 6) continue;
+			old_utt2fp[(*it)[0]] = (*it)[1];
+			old_wav[(*it)[2]] = { (*it)[3], (*it)[4], (*it)[5] };
+		}
+	}
+	UMAPSS old_utt2feats, old_utt2num_frames;
+	if (ReadEntries(old_feats, old_utt2feats) < 0) return -1;
+	if (ReadEntries(datadir / "utt2num_frames", old_utt2num_frames) < 0) return -1;
+
+	//hash the wav data of each recording
+	std::unordered_map<std::string, WavInfo> rec_wav;
+	for (UMAPSS::const_iterator it(rec2wav.begin()), it_end(rec2wav.end()); it != it_end; ++it) {
+		const std::string & wav = it->second;
+		WavInfo info = { "", "-", "-" };
+		fs::path p(wav);
+		boost::system::error_code ec;
+		//NOTE: piped entries (ending with '|') are commands, only the command is hashed
+		if (wav.back() != '|' && fs::is_regular_file(p, ec)) {
+			info.size = std::to_string(fs::file_size(p));
+			info.time = std::to_string(static_cast<long long>(fs::last_write_time(p)));
+			std::unordered_map<std::string, WavInfo>::const_iterator ito = old_wav.find(it->first);
+			if (ito != old_wav.end() && ito->second.size == info.size && ito->second.time == info.time) {
+				info.hash = ito->second.hash;
+			} else {
+				uint64_t h;
+				if (HashFile(p, h) < 0) return -1;
+				info.hash = FingerprintToString(h);
+			}
+		} else {
+			info.hash = FingerprintToString(HashString(wav));
+		}
+		rec_wav.emplace(it->first, info);
+	}
+
+	//fingerprint of each utterance
+	std::unordered_map<std::string, bool> ark_exists;
+	StringTable t_utt2fp, t_extract;
+	auto add_utt = [&](const std::string & utt, const std::string & rec, const string_vec & row) -> int
+	{
+		std::unordered_map<std::string, WavInfo>::const_iterator itw = rec_wav.find(rec);
+		if (itw == rec_wav.end()) {
+			LOGTW_ERROR << "Recording " << rec << " of utterance " << utt << " is not in " << (datadir / "wav.scp").string() << ".";
+			return -1;
+		}
+		uint64_t h = HashString(itw->second.hash, config_hash);
+		if (has_segments) h = HashString(JoinColumns(row, 2), h);
+		std::string fp(FingerprintToString(h));
+		t_utt2fp.push_back({ utt, fp, rec, itw->second.hash, itw->second.size, itw->second.time });
+
+		UMAPSS::const_iterator itf = old_utt2fp.find(utt), itfeats = old_utt2feats.find(utt);
+		if (itf != old_utt2fp.end() && itf->second == fp && itfeats != old_utt2feats.end()
+			&& ArchiveExists(itfeats->second, ark_exists))
+		{
+			inc.reused_feats.push_back({ utt, itfeats->second });
+			UMAPSS::const_iterator itn = old_utt2num_frames.find(utt);
+			if (itn != old_utt2num_frames.end()) inc.reused_num_frames.push_back({ utt, itn->second });
+			inc.num_reused++;
+		} else {
+			t_extract.push_back(row);
+			inc.num_extract++;
+		}
+		return 0;
+	};
+	if (has_segments) {
+		for (StringTable::const_iterator it(t_segments.begin()), it_end(t_segments.end()); it != it_end; ++it) {
+			if ((*it).size() < 4) {
+				LOGTW_ERROR << "Invalid line in " << (datadir / "segments").string() << ".";
+				return -1;
+			}
+			if (add_utt((*it)[0], (*it)[1], *it) < 0) return -1;
+		}
+	} else {
+		for (StringTable::const_iterator it(t_wavscp.begin()), it_end(t_wavscp.end()); it != it_end; ++it)
+			if (add_utt((*it)[0], (*it)[0], *it) < 0) return -1;
+	}
+	for (StringTable::const_iterator it(t_utt2fp.begin()), it_end(t_utt2fp.end()); it != it_end; ++it)
+		inc.utt2fingerprint[(*it)[0]] = JoinColumns(*it, 1);
+
+	//the utterances to extract, in wav.scp or segments format
+	inc.scp = logdir / ((has_segments ? "segments_" : "wav_") + name + ".incremental");
+	if (SaveStringTable(inc.scp.string(), t_extract) < 0) return -1;
+	//a new archive name is only needed if existing archives are reused
+	if (inc.num_reused > 0) inc.suffix = IncrementalSuffix();
+
+	return 0;
+}
+
+/*
+	Adds the reused entries to the feats.scp (and utt2num_frames) made from the new or changed utterances and saves
+	the fingerprints of all utterances which have features.
+*/
+int FinishIncrementalFeats(fs::path datadir, IncrementalFeats & inc, bool write_utt2num_frames)
+{
+	StringTable t_feats, t_num_frames;
+	if (fs::exists(datadir / "feats.scp") && ReadStringTable((datadir / "feats.scp").string(), t_feats) < 0) return -1;
+	t_feats.insert(t_feats.end(), inc.reused_feats.begin(), inc.reused_feats.end());
+	if (SortStringTable(t_feats, 0, 0, "string", "string") < 0) return -1;
+	if (SaveStringTable((datadir / "feats.scp").string(), t_feats) < 0) return -1;
+
+	if (write_utt2num_frames) {
+		if (fs::exists(datadir / "utt2num_frames") && ReadStringTable((datadir / "utt2num_frames").string(), t_num_frames) < 0) return -1;
+		t_num_frames.insert(t_num_frames.end(), inc.reused_num_frames.begin(), inc.reused_num_frames.end());
+		if (SortStringTable(t_num_frames, 0, 0, "string", "string") < 0) return -1;
+		if (SaveStringTable((datadir / "utt2num_frames").string(), t_num_frames) < 0) return -1;
+	}
+
+	//NOTE: utterances without features (e.g. bad wav data) do not get a fingerprint and are tried again the next time
+	StringTable t_utt2fp;
+	for (StringTable::const_iterator it(t_feats.begin()), it_end(t_feats.end()); it != it_end; ++it) {
+		if ((*it).size() < 1) continue;
+		UMAPSS::const_iterator itf = inc.utt2fingerprint.find((*it)[0]);
+		if (itf != inc.utt2fingerprint.end())
+			t_utt2fp.push_back({ (*it)[0], itf->second });
+	}
+	if (SaveStringTable((datadir / "utt2fingerprint").string(), t_utt2fp) < 0) return -1;
+
+	try {
+		if (fs::exists(inc.scp)) fs::remove(inc.scp);
+	} catch (const std::exception&) {}
+
+	return 0;
+}
+
+/*
+	Computes the fingerprint of each speaker from the feats.scp entries and the content fingerprints (utt2fingerprint)
+	of its utterances and the mode (the type of the CMVN stats, e.g. fake dimensions).
+	NOTE: the feats.scp entries alone are not enough because an archive can be rewritten with the same name and
+		  offsets (e.g. an incremental run which does not reuse anything).
+*/
+int SpeakerFingerprints(fs::path datadir, std::string mode, UMAPSS & spk2fingerprint)
+{
+	StringTable t_spk2utt, t_utt2fp;
+	UMAPSS utt2feats, utt2fp;
+	if (ReadStringTable((datadir / "spk2utt").string(), t_spk2utt) < 0) return -1;
+	if (ReadEntries(datadir / "feats.scp", utt2feats) < 0) return -1;
+	if (fs::exists(datadir / "utt2fingerprint")) {
+		if (ReadStringTable((datadir / "utt2fingerprint").string(), t_utt2fp) < 0) return -1;
+		for (StringTable::const_iterator it(t_utt2fp.begin()), it_end(t_utt2fp.end()); it != it_end; ++it)
+			if ((*it).size() >= 2) utt2fp[(*it)[0]] = (*it)[1];
+	}
+	spk2fingerprint.clear();
+	for (StringTable::const_iterator it(t_spk2utt.begin()), it_end(t_spk2utt.end()); it != it_end; ++it) {
+		if ((*it).size() < 1) continue;
+		uint64_t h = HashString(mode);
+		for (size_t c = 1; c < (*it).size(); c++) {
+			UMAPSS::const_iterator itf = utt2feats.find((*it)[c]), itp = utt2fp.find((*it)[c]);
+			h = HashString((*it)[c], h);
+			h = HashString(itf == utt2feats.end() ? "" : itf->second, h);
+			h = HashString(itp == utt2fp.end() ? "" : itp->second, h);
+		}
+		spk2fingerprint[(*it)[0]] = FingerprintToString(h);
+	}
+	return 0;
+}
+
+/*
+	Determines which speakers can keep their CMVN stats (from the former cmvn.scp) and writes the spk2utt of the
+	speakers which need new stats into affected_spk2utt.
+*/
+int PrepareIncrementalCmvn(fs::path datadir, std::string mode, fs::path affected_spk2utt, StringTable & reused_cmvn, int & num_affected)
+{
+	UMAPSS spk2fp, old_spk2fp, old_cmvn;
+	if (SpeakerFingerprints(datadir, mode, spk2fp) < 0) return -1;
+	if (ReadEntries(datadir / "spk2fingerprint", old_spk2fp) < 0) return -1;
+	if (ReadEntries(datadir / "cmvn.scp", old_cmvn) < 0) return -1;
+
+	StringTable t_spk2utt, t_affected;
+	if (ReadStringTable((datadir / "spk2utt").string(), t_spk2utt) < 0) return -1;
+	std::unordered_map<std::string, bool> ark_exists;
+	reused_cmvn.clear();
+	for (StringTable::const_iterator it(t_spk2utt.begin()), it_end(t_spk2utt.end()); it != it_end; ++it) {
+		if ((*it).size() < 1) continue;
+		const std::string & spk = (*it)[0];
+		UMAPSS::const_iterator ito = old_spk2fp.find(spk), itc = old_cmvn.find(spk);
+		if (ito != old_spk2fp.end() && ito->second == spk2fp[spk] && itc != old_cmvn.end()
+			&& ArchiveExists(itc->second, ark_exists))
+			reused_cmvn.push_back({ spk, itc->second });
+		else
+			t_affected.push_back(*it);
+	}
+	num_affected = (int)t_affected.size();
+	if (SaveStringTable(affected_spk2utt.string(), t_affected) < 0) return -1;
+	return 0;
+}
+
+//saves the fingerprints of the speakers for the next incremental run
+int SaveSpeakerFingerprints(fs::path datadir, std::string mode)
+{
+	UMAPSS spk2fp;
+	if (SpeakerFingerprints(datadir, mode, spk2fp) < 0) return -1;
+	StringTable t_spk2fp;
+	for (UMAPSS::const_iterator it(spk2fp.begin()), it_end(spk2fp.end()); it != it_end; ++it)
+		t_spk2fp.push_back({ it->first, it->second });
+	if (SortStringTable(t_spk2fp, 0, 0, "string", "string") < 0) return -1;
+	return SaveStringTable((datadir / "spk2fingerprint").string(), t_spk2fp);
+}
@@ -21,7 +21,7 @@ field : zero based index of the fields/columns
 */
 int FilterScp(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude, int field)
 {
-	string_vec seen;
+	std::unordered_set<std::string> seen;
 	StringTable table_idlist, table_in_scp;
 	if (ReadStringTable(idlist.string(), table_idlist) < 0) return -1;
 	if (ReadStringTable(in_scp.string(), table_in_scp) < 0) return -1;
@@ -32,7 +32,7 @@ int FilterScp(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude,
 			LOGTW_ERROR << " Invalid id-list data in " << idlist.string() << " at line " << line << ".";
 			return -1;
 		}
-		seen.push_back((*it)[0]);
+		seen.insert((*it)[0]);
 		line++;
 	}
 
@@ -48,8 +48,7 @@ int FilterScp(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude,
 			LOGTW_ERROR << " Invalid input scp data in " << in_scp.string() << " at line " << line << ".";
 			return -1;
 		}
-		if ((!exclude && std::find(seen.begin(), seen.end(), (*it)[field]) != seen.end() ) 
-			|| (exclude && std::find(seen.begin(), seen.end(), (*it)[field]) == seen.end())) 
+		if ((seen.find((*it)[field]) != seen.end()) != exclude)
 		{
 			int c = 0;
 			for (string_vec::const_iterator itc1(it->begin()), itc1_end(it->end()); itc1 != itc1_end; ++itc1)
@@ -67,3 +66,91 @@ int FilterScp(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude,
 
 	return 0;
 }
+
+/*
+Same as FilterScp() but both files are streamed (merge-join) instead of being read into memory. Both the id-list 
+(on the first field) and in_scp (on the "n-th" field) must be sorted in C/byte order, like the files in a data 
+directory. If unsorted input is found then FilterScp() is used.
+*/
+int FilterScpSorted(fs::path idlist, fs::path in_scp, fs::path out_scp, bool exclude, int field)
+{
+	bool sorted = true;
+	{
+		fs::ifstream file_idlist(idlist, std::ios::binary), file_in_scp(in_scp, std::ios::binary);
+		if (!file_idlist) {
+			LOGTW_FATALERROR << " Error opening file. (Reading file " << idlist.string() << ")";
+			return -1;
+		}
+		if (!file_in_scp) {
+			LOGTW_FATALERROR << " Error opening file. (Reading file " << in_scp.string() << ")";
+			return -1;
+		}
+		fs::ofstream file_out_scp(out_scp, std::ios::binary);
+		if (!file_out_scp) {
+			LOGTW_ERROR << " Can't open output file: " << out_scp.string() << ".";
+			return -1;
+		}
+
+		std::string line, id_line, id, last_key;
+		string_vec row, row_id;
+		bool have_id = false, ids_done = false;
+		int line_id = 0, line_scp = 0;
+		//reads the next id; the ids must be in ascending order
+		auto next_id = [&]() {
+			while (std::getline(file_idlist, id_line)) {
+				line_id++;
+				SplitTableLine(id_line, row_id);
+				if (row_id.size() < 1) {
+					LOGTW_ERROR << " Invalid id-list data in " << idlist.string() << " at line " << line_id << ".";
+					return -1;
+				}
+				if (have_id && row_id[0] < id) {
+					sorted = false;
+					return 0;
+				}
+				id.swap(row_id[0]);
+				have_id = true;
+				return 0;
+			}
+			ids_done = true;
+			return 0;
+		};
+		if (next_id() < 0) return -1;
+		while (sorted && std::getline(file_in_scp, line))
+		{
+			line_scp++;
+			SplitTableLine(line, row);
+			if (!(row.size() >= field + 1)) {
+				LOGTW_ERROR << " Invalid input scp data in " << in_scp.string() << " at line " << line_scp << ".";
+				return -1;
+			}
+			const std::string key(row[field]);
+			if (line_scp > 1 && key < last_key) {
+				sorted = false;
+				break;
+			}
+			while (sorted && !ids_done && id < key) {
+				if (next_id() < 0) return -1;
+			}
+			if (!sorted) break;
+			bool found = !ids_done && id == key;
+			if (found != exclude)
+			{
+				for (size_t c = 0; c < row.size(); c++) {
+					if (c > 0) file_out_scp << " ";
+					file_out_scp << row[c];
+				}
+				file_out_scp << "\n";
+			}
+			last_key = key;
+		}
+		//the rest of the id-list must be checked too because an unsorted id could match an earlier line
+		while (sorted && !ids_done) {
+			if (next_id() < 0) return -1;
+		}
+		file_out_scp.flush(); file_out_scp.close();
+	}
+	if (!sorted) return FilterScp(idlist, in_scp, out_scp, exclude, field);
+
+	return 0;
+}
@@ -45,11 +45,8 @@ VOICEBRIDGE_API int FixDataDir(fs::path datadir, std::vector<fs::path> spk_extra
 			{
 				//sort and make unique if it is not
 				LOGTW_INFO << " file " << f << " is not in sorted order or not unique, fixing file...";
-				StringTable table_;
-				if (ReadStringTable((datadir / f).string(), table_) < 0) return -1;
-				SortStringTable(table_, 0, 0, "string", "string", false);
-				//save the file, overwrite existing (it is backed up before)
-				if (SaveStringTable((datadir / f).string(), table_) < 0) return -1;
+				//sort the file in place, overwrite existing (it is backed up before)
+				if (SortTextFile(datadir / f, datadir / f, 0, 0, "string", "string", false) < 0) return -1;
 			}
 		}
 	}
@@ -88,7 +85,7 @@ int filter_file(fs::path filter, fs::path file_to_filter)
 		return -1;
 	}
 	//
-	if (FilterScp(filter, (file_to_filter.string() + ".tmp"), file_to_filter) < 0) {
+	if (FilterScpSorted(filter, (file_to_filter.string() + ".tmp"), file_to_filter) < 0) {
 		LOGTW_ERROR << " Failed to filter file " << filter.string() << ".";
 		return -1;
 	}
@@ -145,7 +142,7 @@ int filter_recordings(fs::path datadir, fs::path tmpdir)
 		file_recordings.flush(); file_recordings.close();
 		if (CheckFileExistsAndNotEmpty(path_recordings, true) < 0) return -1;
 		//
-		if (FilterScp(path_wav_scp, path_recordings, tmpdir / "recordings.tmp") < 0) {
+		if (FilterScpSorted(path_wav_scp, path_recordings, tmpdir / "recordings.tmp") < 0) {
 			LOGTW_ERROR << "Failed to filter file " << path_wav_scp.string() << ".";
 			return -1;
 		}
@@ -284,7 +281,7 @@ int filter_utts(fs::path datadir, fs::path tmpdir, std::vector<fs::path> utt_ext
 	if (maybe_wav != "") files.push_back(maybe_wav);
 	for each(std::string f in files) {
 		if (fs::exists(datadir / f)) {
-			if (FilterScp(datadir / f, (tmpdir / "utts").string(), (tmpdir / "utts").string() + ".tmp") < 0) {
+			if (FilterScpSorted(datadir / f, (tmpdir / "utts").string(), (tmpdir / "utts").string() + ".tmp") < 0) {
 				LOGTW_ERROR << " Failed to filter file " << (tmpdir / "utts").string() << ".";
 				return -1;
 			}
@@ -325,7 +322,7 @@ int filter_utts(fs::path datadir, fs::path tmpdir, std::vector<fs::path> utt_ext
 			fs::path p(datadir / x);
 			if (fs::exists(p)) {
 				fs::copy_file(p, datadir / "backup" / p.filename(), fs::copy_option::overwrite_if_exists);
-				if (FilterScp(tmpdir / "utts", p, p.string() + ".temp") < 0) {
+				if (FilterScpSorted(tmpdir / "utts", p, p.string() + ".temp") < 0) {
 					LOGTW_ERROR << " Failed to filter file " << p.string() << ".";
 					return -1;
 				}
@@ -334,7 +331,7 @@ int filter_utts(fs::path datadir, fs::path tmpdir, std::vector<fs::path> utt_ext
 				if (ReadStringTable(p.string(), table1) < 0) return -1;
 				if (ReadStringTable(p.string() + ".temp", table2) < 0) return -1;
 				if (!IsTheSame(table1, table2)) {
-					if (FilterScp(tmpdir / "utts", datadir / "backup" / p.filename(), p) < 0) {
+					if (FilterScpSorted(tmpdir / "utts", datadir / "backup" / p.filename(), p) < 0) {
 						LOGTW_ERROR << " Failed to filter file " << (datadir / "backup" / p.filename()).string() << ".";
 						return -1;
 					}
@@ -349,7 +346,7 @@ int filter_utts(fs::path datadir, fs::path tmpdir, std::vector<fs::path> utt_ext
 		for each(fs::path p in utt_extra_files) {
 			if (fs::exists(p)) {
 				fs::copy_file(p, datadir / "backup" / p.filename(), fs::copy_option::overwrite_if_exists);
-				if (FilterScp(tmpdir / "utts", p, p.string() + ".temp") < 0) {
+				if (FilterScpSorted(tmpdir / "utts", p, p.string() + ".temp") < 0) {
 					LOGTW_ERROR << " Failed to filter file " << p.string() << ".";
 					return -1;
 				}
@@ -358,7 +355,7 @@ int filter_utts(fs::path datadir, fs::path tmpdir, std::vector<fs::path> utt_ext
 				if (ReadStringTable(p.string(), table1) < 0) return -1;
 				if (ReadStringTable(p.string() + ".temp", table2) < 0) return -1;
 				if (!IsTheSame(table1, table2)) {
-					if (FilterScp(tmpdir / "utts", datadir / "backup" / p.filename(), p) < 0) {
+					if (FilterScpSorted(tmpdir / "utts", datadir / "backup" / p.filename(), p) < 0) {
 						LOGTW_ERROR << " Failed to filter file " << (datadir / "backup" / p.filename()).string() << ".";
 						return -1;
 					}
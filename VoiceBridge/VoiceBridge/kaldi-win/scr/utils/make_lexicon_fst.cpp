@@ -197,7 +197,7 @@ int MakeLexiconFst(StringTable lexfn, fs::path output_txt,
 					pron_cost = 0.0; // so we only print it the 1st time.
 					s = ns;
 				} 
-				else if(silphone == "" || (*it)[col] == silphone) {
+				else if(silphone == "" || (*it)[col] != silphone) {
 					// This is non - deterministic but relatively compact, and avoids epsilons.
 					double local_nosilcost = nosilcost + pron_cost;
 					double local_silcost = silcost + pron_cost;
@@ -0,0 +1,405 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2010-2012 Microsoft Corporation  | license: Apache 2.0.
+2012  Johns Hopkins University (Author: Daniel Povey),
+*/
+
+/*
+	Makes the lexicon FST (L.fst or L_disambig.fst) directly in memory from the lexicon tables.
+
+	The topology is exactly the same as the one produced by MakeLexiconFst() / MakeLexiconFstSilprob() followed by
+	fstcompile, fstaddselfloops and fstarcsort, but there is no text FST, no symbol table parsing and no temporary
+	files. The words and phones are mapped to integer ids with the phones.txt and words.txt tables and the lexicon
+	lines are converted in parallel (this is the costly part for large lexicons); the states and arcs are then
+	added sequentially because the state numbering depends on the order of the lexicon.
+*/
+
+#include "kaldi-win\scr\kaldi_scr.h"
+#include "fstext/fstext-lib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "util/common-utils.h"
+
+using SYMIDMAP = std::unordered_map<std::string, int>;
+
+//one lexicon line converted to integer ids
+struct LexEntryInt {
+	int word = 0;
+	double pron_cost = 0.0;
+	//only used for the silprob lexicon:
+	double wordsilcost = 0.0, wordnonsilcost = 0.0, silwordcost = 0.0, nonsilwordcost = 0.0;
+	std::vector<int> phones;
+	std::string error; //not empty if the line could not be converted
+};
+
+static int MakeSymbolIdMap(StringTable & table, SYMIDMAP & symids, std::string name)
+{
+	symids.reserve(table.size());
+	for (StringTable::const_iterator it(table.begin()), it_end(table.end()); it != it_end; ++it)
+	{
+		if ((*it).size() < 2) {
+			LOGTW_ERROR << "Bad line in symbol table " << name << ".";
+			return -1;
+		}
+		int id = StringToNumber<int>((*it)[1], -1);
+		if (id < 0) {
+			LOGTW_ERROR << "Bad symbol id " << (*it)[1] << " in symbol table " << name << ".";
+			return -1;
+		}
+		symids.emplace((*it)[0], id);
+	}
+	return 0;
+}
+
+static bool LookupSymbol(const SYMIDMAP & symids, const std::string & sym, int & id)
+{
+	SYMIDMAP::const_iterator it = symids.find(sym);
+	if (it == symids.end()) return false;
+	id = it->second;
+	return true;
+}
+
+//runs f(i) for i in [0, n) on nj threads; each thread gets a contiguous block
+template <typename F>
+static void ParallelForLexicon(size_t n, int nj, F f)
+{
+	if (nj <= 0) nj = std::max(1, (int)std::thread::hardware_concurrency());
+	if (n < 10000 || nj == 1) {
+		for (size_t i = 0; i < n; i++) f(i);
+		return;
+	}
+	std::vector<std::thread> _threads;
+	size_t block = (n + nj - 1) / nj;
+	for (int j = 0; j < nj; j++) {
+		size_t begin = j * block, end = std::min(n, begin + block);
+		if (begin >= end) break;
+		_threads.emplace_back([begin, end, &f]() {
+			for (size_t i = begin; i < end; i++) f(i);
+		});
+	}
+	for (auto& t : _threads) t.join();
+}
+
+//converts the lexicon lines to integer ids; num_prob_cols is the number of probability columns after the word
+static int ConvertLexicon(StringTable & lexfn, const SYMIDMAP & phoneids, const SYMIDMAP & wordids,
+						  int num_prob_cols, std::vector<LexEntryInt> & entries, int nj)
+{
+	entries.resize(lexfn.size());
+	ParallelForLexicon(lexfn.size(), nj, [&](size_t i) {
+		const string_vec & line = lexfn[i];
+		LexEntryInt & e = entries[i];
+		if ((int)line.size() < 1 + num_prob_cols) {
+			e.error = "There is not enough data in line " + std::to_string(i + 1) + ".";
+			return;
+		}
+		if (!LookupSymbol(wordids, line[0], e.word) || line[0] == "<eps>") {
+			e.error = "Bad word " + line[0] + " in line " + std::to_string(i + 1) + ".";
+			return;
+		}
+		if (num_prob_cols > 0) {
+			double pron_prob = StringToNumber<double>(line[1], -1.0);
+			if (!(pron_prob > 0.0 && pron_prob <= 1.0)) {
+				e.error = "Bad pronunciation probability in line " + std::to_string(i + 1) + ".";
+				return;
+			}
+			e.pron_cost = -std::log(pron_prob);
+		}
+		if (num_prob_cols == 4) {
+			double wordsilprob = StringToNumber<double>(line[2], -1.0);
+			double silwordcorrection = StringToNumber<double>(line[3], -1.0);
+			double nonsilwordcorrection = StringToNumber<double>(line[4], -1.0);
+			if (!(wordsilprob > 0.0 && wordsilprob <= 1.0) || !(silwordcorrection > 0.0) || !(nonsilwordcorrection > 0.0)) {
+				e.error = "Bad word pronunciation probability in line " + std::to_string(i + 1) + ".";
+				return;
+			}
+			e.wordsilcost = -std::log(wordsilprob);
+			e.wordnonsilcost = -std::log(1.0 - wordsilprob);
+			e.silwordcost = -std::log(silwordcorrection);
+			e.nonsilwordcost = -std::log(nonsilwordcorrection);
+		}
+		e.phones.resize(line.size() - 1 - num_prob_cols);
+		for (size_t c = 1 + num_prob_cols, k = 0; c < line.size(); c++, k++) {
+			if (!LookupSymbol(phoneids, line[c], e.phones[k]) || line[c] == "<eps>") {
+				e.error = "Bad phone " + line[c] + " in line " + std::to_string(i + 1) + ".";
+				return;
+			}
+		}
+	});
+	for each(const LexEntryInt & e in entries) {
+		if (!e.error.empty()) {
+			LOGTW_ERROR << " " << e.error;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+//adds the disambiguation self-loops (if requested), sorts the arcs on the output labels and writes the FST
+static int FinishLexiconFst(fst::VectorFst<fst::StdArc> & lfst, fs::path fst_out,
+							fs::path disambig_phones_int, fs::path disambig_words_int)
+{
+	try {
+		if (disambig_phones_int != "" || disambig_words_int != "")
+		{
+			std::vector<kaldi::int32> disambig_in, disambig_out;
+			if (!kaldi::ReadIntegerVectorSimple(disambig_phones_int.string(), &disambig_in)) {
+				LOGTW_ERROR << " Could not read disambiguation symbols from " << disambig_phones_int.string();
+				return -1;
+			}
+			if (!kaldi::ReadIntegerVectorSimple(disambig_words_int.string(), &disambig_out)) {
+				LOGTW_ERROR << " Could not read disambiguation symbols from " << disambig_words_int.string();
+				return -1;
+			}
+			if (disambig_in.size() != disambig_out.size()) {
+				LOGTW_ERROR << " mismatch in size of disambiguation symbols. See " << disambig_phones_int.string()
+					<< " and " << disambig_words_int.string();
+				return -1;
+			}
+			fst::AddSelfLoops(&lfst, disambig_in, disambig_out);
+		}
+		fst::ArcSort(&lfst, fst::OLabelCompare<fst::StdArc>());
+		fst::WriteFstKaldi(lfst, fst_out.string());
+	}
+	catch (const std::exception& ex) {
+		LOGTW_ERROR << "Error while writing lexicon fst " << fst_out.string() << ". Reason: " << ex.what();
+		return -1;
+	}
+	return 0;
+}
+
+/*
+	In memory version of MakeLexiconFst() + fstcompile (+ fstaddselfloops) + fstarcsort.
+	phones_table and words_table are the contents of phones.txt and words.txt. If disambig_phones_int and disambig_words_int
+	are given then the disambiguation self-loops are added (L_disambig.fst). nj is the number of threads used for the
+	conversion of the lexicon (0 = number of cores).
+*/
+int MakeLexiconFstMem(StringTable & lexfn, StringTable & phones_table, StringTable & words_table, fs::path fst_out,
+					  bool pron_probs, double silprob, std::string silphone, std::string sildisambig,
+					  fs::path disambig_phones_int, fs::path disambig_words_int, int nj)
+{
+	using fst::StdArc;
+	typedef StdArc::Weight Weight;
+
+	if (silprob < 0 || silprob >= 1.0) {
+		LOGTW_ERROR << " wrong silprob value " << silprob << " detected in lexicon file. ( 1.0 > silprob >=0.0 ).";
+		return -1;
+	}
+	SYMIDMAP phoneids, wordids;
+	if (MakeSymbolIdMap(phones_table, phoneids, "phones.txt") < 0) return -1;
+	if (MakeSymbolIdMap(words_table, wordids, "words.txt") < 0) return -1;
+
+	std::vector<LexEntryInt> entries;
+	if (ConvertLexicon(lexfn, phoneids, wordids, pron_probs ? 1 : 0, entries, nj) < 0) return -1;
+
+	int silphoneid = 0, sildisambigid = 0;
+	if (silprob > 0.0 && !LookupSymbol(phoneids, silphone, silphoneid)) {
+		LOGTW_ERROR << " The silence phone " << silphone << " is not in phones.txt.";
+		return -1;
+	}
+	if (sildisambig != "" && !LookupSymbol(phoneids, sildisambig, sildisambigid)) {
+		LOGTW_ERROR << " The silence disambiguation symbol " << sildisambig << " is not in phones.txt.";
+		return -1;
+	}
+
+	//number of states: every phone except the last one of a pronunciation has its own state
+	size_t num_states = 4;
+	for each(const LexEntryInt & e in entries)
+		if (e.phones.size() > 1) num_states += e.phones.size() - 1;
+
+	fst::VectorFst<StdArc> lfst;
+	lfst.ReserveStates(num_states);
+
+	if (silprob == 0.0) //No optional silences: just have one (loop+final) state which is numbered zero.
+	{
+		int loopstate = lfst.AddState();
+		lfst.SetStart(loopstate);
+		for each(const LexEntryInt & e in entries)
+		{
+			int s = loopstate;
+			int word_or_eps = e.word;
+			float pron_cost = (float)e.pron_cost;
+			for (size_t k = 0; k < e.phones.size(); k++)
+			{
+				int ns = (k + 1 != e.phones.size() ? lfst.AddState() : loopstate);
+				lfst.AddArc(s, StdArc(e.phones[k], word_or_eps, Weight(pron_cost), ns));
+				word_or_eps = 0;
+				pron_cost = 0.0f; // so we only add it on the first arc of the word.
+				s = ns;
+			}
+		}
+		lfst.SetFinal(loopstate, Weight::One());
+	}
+	else
+	{
+		float silcost = (float)-std::log(silprob);
+		float nosilcost = (float)-std::log(1.0 - silprob);
+		int startstate = lfst.AddState();
+		int loopstate = lfst.AddState();
+		int silstate = lfst.AddState(); // state from where we go to loopstate after emitting silence.
+		lfst.SetStart(startstate);
+		//no silence:
+		lfst.AddArc(startstate, StdArc(0, 0, Weight(nosilcost), loopstate));
+		if (sildisambig == "") {
+			//silence.
+			lfst.AddArc(startstate, StdArc(silphoneid, 0, Weight(silcost), loopstate));
+			//no cost.
+			lfst.AddArc(silstate, StdArc(silphoneid, 0, Weight::One(), loopstate));
+		}
+		else {
+			int disambigstate = lfst.AddState();
+			//silence
+			lfst.AddArc(startstate, StdArc(silphoneid, 0, Weight(silcost), disambigstate));
+			//no cost
+			lfst.AddArc(silstate, StdArc(silphoneid, 0, Weight::One(), disambigstate));
+			//silence disambiguation symbol.
+			lfst.AddArc(disambigstate, StdArc(sildisambigid, 0, Weight::One(), loopstate));
+		}
+
+		for each(const LexEntryInt & e in entries)
+		{
+			int s = loopstate;
+			int word_or_eps = e.word;
+			float pron_cost = (float)e.pron_cost;
+			for (size_t k = 0; k < e.phones.size(); k++)
+			{
+				int p = e.phones[k];
+				if (k + 1 != e.phones.size()) {
+					int ns = lfst.AddState();
+					lfst.AddArc(s, StdArc(p, word_or_eps, Weight(pron_cost), ns));
+					word_or_eps = 0;
+					pron_cost = 0.0f; // so we only add it the 1st time.
+					s = ns;
+				}
+				else if (silphone == "" || p != silphoneid) {
+					// This is non - deterministic but relatively compact, and avoids epsilons.
+					lfst.AddArc(s, StdArc(p, word_or_eps, Weight(nosilcost + pron_cost), loopstate));
+					lfst.AddArc(s, StdArc(p, word_or_eps, Weight(silcost + pron_cost), silstate));
+				}
+				else {
+					// no point putting opt - sil after silence word.
+					lfst.AddArc(s, StdArc(p, word_or_eps, Weight(pron_cost), loopstate));
+				}
+			}
+		}
+		lfst.SetFinal(loopstate, Weight::One());
+	}
+
+	return FinishLexiconFst(lfst, fst_out, disambig_phones_int, disambig_words_int);
+}
+
+/*
+	In memory version of MakeLexiconFstSilprob() + fstcompile (+ fstaddselfloops) + fstarcsort.
+	See MakeLexiconFstMem() for the extra parameters.
+*/
+int MakeLexiconFstSilprobMem(StringTable & lexfn, StringTable & silprobfile, StringTable & phones_table, StringTable & words_table,
+							 fs::path fst_out, std::string silphone, std::string sildisambig,
+							 fs::path disambig_phones_int, fs::path disambig_words_int, int nj)
+{
+	using fst::StdArc;
+	typedef StdArc::Weight Weight;
+
+	double silbeginprob = -1.0;
+	double silendcorrection = -1.0;
+	double nonsilendcorrection = -1.0;
+
+	int n = 0;
+	for (StringTable::const_iterator it(silprobfile.begin()), it_end(silprobfile.end()); it != it_end; ++it)
+	{
+		n++;
+		if ((*it).size() < 2) continue;
+		std::string w((*it)[0]);
+		if (w == "<s>") {
+			silbeginprob = StringToNumber<double>((*it)[1], -1.0);
+		}
+		else if (w == "</s>_s") {
+			silendcorrection = StringToNumber<double>((*it)[1], -1.0);
+			if (silendcorrection <= 0) {
+				LOGTW_ERROR << " Bad correction term in file silprob at line " << n << ".";
+				return -1;
+			}
+		}
+		else if (w == "</s>_n") {
+			nonsilendcorrection = StringToNumber<double>((*it)[1], -1.0);
+			if (nonsilendcorrection <= 0) {
+				LOGTW_ERROR << " Bad correction term in file silprob at line " << n << ".";
+				return -1;
+			}
+		}
+	}
+	if (!(silbeginprob > 0.0 && silbeginprob <= 1.0))
+	{
+		LOGTW_ERROR << "Wrong value " << silbeginprob << " detected in lexicon file.";
+		return -1;
+	}
+	if (silendcorrection <= 0 || nonsilendcorrection <= 0) {
+		LOGTW_ERROR << " Missing correction term in file silprob.";
+		return -1;
+	}
+
+	SYMIDMAP phoneids, wordids;
+	if (MakeSymbolIdMap(phones_table, phoneids, "phones.txt") < 0) return -1;
+	if (MakeSymbolIdMap(words_table, wordids, "words.txt") < 0) return -1;
+
+	std::vector<LexEntryInt> entries;
+	if (ConvertLexicon(lexfn, phoneids, wordids, 4, entries, nj) < 0) return -1;
+
+	int silphoneid = 0, sildisambigid = 0;
+	if (!LookupSymbol(phoneids, silphone, silphoneid)) {
+		LOGTW_ERROR << " The silence phone " << silphone << " is not in phones.txt.";
+		return -1;
+	}
+	//NOTE: sildisambig is <eps> (=0) for L.fst
+	if (!LookupSymbol(phoneids, sildisambig, sildisambigid)) {
+		LOGTW_ERROR << " The silence disambiguation symbol " << sildisambig << " is not in phones.txt.";
+		return -1;
+	}
+
+	size_t num_states = 3;
+	for each(const LexEntryInt & e in entries)
+		num_states += e.phones.size();
+
+	fst::VectorFst<StdArc> lfst;
+	lfst.ReserveStates(num_states);
+	int startstate = lfst.AddState();
+	int nonsilstart = lfst.AddState();
+	int silstart = lfst.AddState();
+	lfst.SetStart(startstate);
+
+	lfst.AddArc(startstate, StdArc(silphoneid, 0, Weight((float)-std::log(silbeginprob)), silstart));
+	lfst.AddArc(startstate, StdArc(sildisambigid, 0, Weight((float)-std::log(1.0 - silbeginprob)), nonsilstart));
+
+	for each(const LexEntryInt & e in entries)
+	{
+		int oldstate = -1;
+		for (size_t k = 0; k < e.phones.size(); k++)
+		{
+			int p = e.phones[k];
+			int newstate = lfst.AddState();
+			if (k == 0) {
+				// for nonsil before w
+				lfst.AddArc(nonsilstart, StdArc(p, e.word, Weight((float)(e.nonsilwordcost + e.pron_cost)), newstate));
+				// for sil before w
+				lfst.AddArc(silstart, StdArc(p, e.word, Weight((float)(e.silwordcost + e.pron_cost)), newstate));
+			}
+			else {
+				lfst.AddArc(oldstate, StdArc(p, 0, Weight::One(), newstate));
+			}
+			oldstate = newstate;
+		}
+		if (oldstate >= 0) {
+			// for no sil after w
+			lfst.AddArc(oldstate, StdArc(sildisambigid, 0, Weight((float)e.wordnonsilcost), nonsilstart));
+			// for sil after w
+			lfst.AddArc(oldstate, StdArc(silphoneid, 0, Weight((float)e.wordsilcost), silstart));
+		}
+	}
+
+	lfst.SetFinal(silstart, Weight((float)-std::log(silendcorrection)));
+	lfst.SetFinal(nonsilstart, Weight((float)-std::log(nonsilendcorrection)));
+
+	return FinishLexiconFst(lfst, fst_out, disambig_phones_int, disambig_words_int);
+}
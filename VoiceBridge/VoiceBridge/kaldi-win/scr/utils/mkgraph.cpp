@@ -18,10 +18,36 @@ Based on : Copyright 2010-2012 Microsoft Corporation, Apache 2.0
 #include "kaldi-win\scr\kaldi_scr.h"
 #include "kaldi-win\src\kaldi_src.h"
 
+//Creates graph_dir/HCLGp.fst, the packed version of HCLG.fst with the states reordered for memory
+//locality (see fstext/packed-fst.h), or removes a stale one if it is not needed.
+static int PackGraph(fs::path dir, bool packed_graph)
+{
+	fs::path f_HCLG_fst(dir / "HCLG.fst"), f_HCLGp_fst(dir / "HCLGp.fst");
+	try {
+		if (!packed_graph) {
+			if (fs::exists(f_HCLGp_fst)) fs::remove(f_HCLGp_fst);
+			return 0;
+		}
+		if (fs::exists(f_HCLGp_fst) && fs::last_write_time(f_HCLGp_fst) >= fs::last_write_time(f_HCLG_fst))
+			return 0;
+		if (fs::exists(f_HCLGp_fst)) fs::remove(f_HCLGp_fst);
+	}
+	catch (const std::exception& ex) {
+		LOGTW_ERROR << ex.what();
+		return -1;
+	}
+	if (fstpack(f_HCLG_fst.string(), f_HCLGp_fst.string(), true) < 0) {
+		LOGTW_ERROR << "Failed to create the packed decoding graph " << f_HCLGp_fst.string();
+		return -1;
+	}
+	return 0;
+}
+
 VOICEBRIDGE_API int MkGraph(fs::path lang_dir, fs::path model_dir, fs::path graph_dir,
 	bool remove_oov, //If true, any paths containing the OOV symbol (obtained from oov.int in the lang directory) are removed from the G.fst during compilation.
 	double tscale,	 //Scaling factor on transition probabilities.
-	double loopscale //see: http://kaldi-asr.org/doc/hmm.html#hmm_scale
+	double loopscale, //see: http://kaldi-asr.org/doc/hmm.html#hmm_scale
+	bool packed_graph //If true, also writes graph_dir/HCLGp.fst for faster decoding.
 	)
 {
 	fs::path lang(lang_dir);
@@ -50,7 +76,7 @@ VOICEBRIDGE_API int MkGraph(fs::path lang_dir, fs::path model_dir, fs::path grap
 		}
 		if ( !must_rebuild ) {
 			LOGTW_INFO << f_HCLG_fst.string() << " is up to date.";
-			return 0;
+			return PackGraph(dir, packed_graph);
 		}
 	}
 
@@ -340,6 +366,8 @@ VOICEBRIDGE_API int MkGraph(fs::path lang_dir, fs::path model_dir, fs::path grap
 		return -1;
 	}
 
+	if (PackGraph(dir, packed_graph) < 0) return -1;
+
 	//remove all temp files and intermediate files 
 	std::vector<fs::path> _temps = { (lang / "tmp" / "LGTC.temp"),
 									(lang / "tmp" / "LGDS.temp"),
@@ -0,0 +1,359 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2010-2012 Microsoft Corporation, Apache 2.0
+					 2012-2013 Johns Hopkins University (Author: Daniel Povey)
+
+	This function creates a decoding graph for on-the-fly composition. Instead of the fully expanded HCLG
+	(see MkGraph()) it creates:
+		HCLr.fst : H o C o L_disambig (without G) with self-loops, stored as an 'olabel_lookahead' FST
+		Gr.fst	 : G with its input (word) labels relabeled to match HCLr.fst
+	The decoder composes them lazily (see fstext/lookahead-compose.h). HCLr.fst does not depend on
+	the language model, therefore when only G.fst changes only Gr.fst is rebuilt which is fast; the size of the
+	graph grows only additively with the size of the language model.
+*/
+
+#include "kaldi-win\scr\kaldi_scr.h"
+#include "kaldi-win\src\kaldi_src.h"
+#include "fstext/kaldi-fst-io.h"
+#include "fstext/lookahead-compose.h"
+
+VOICEBRIDGE_API int MkGraphLookahead(fs::path lang_dir, fs::path model_dir, fs::path graph_dir,
+	double tscale,	 //Scaling factor on transition probabilities.
+	double loopscale //see: http://kaldi-asr.org/doc/hmm.html#hmm_scale
+	)
+{
+	fs::path lang(lang_dir);
+	fs::path tree(model_dir / "tree");
+	fs::path model(model_dir / "final.mdl");
+	fs::path dir(graph_dir);
+	fs::path f_HCLr_fst(dir / "HCLr.fst");
+	fs::path f_Gr_fst(dir / "Gr.fst");
+
+	if (CreateDir(graph_dir, true) < 0) return -1;
+
+	std::vector<fs::path> required = { lang_dir / "L_disambig.fst", lang_dir / "G.fst", lang_dir / "phones.txt", lang_dir / "words.txt", lang_dir / "phones" / "silence.csl", lang_dir / "phones" / "disambig.int", model, tree };
+	for (fs::path p : required) {
+		if (!fs::exists(p)) {
+			LOGTW_ERROR << p.string() << "expected to exist.";
+			return -1;
+		}
+	}
+
+	int numpdfs, context_width, central_position;
+	string_vec options;
+	options.push_back("--print-args=false");
+	options.push_back((tree).string());
+	StrVec2Arg args(options);
+	if (TreeInfo(args.argc(), args.argv(), numpdfs, context_width, central_position) < 0) {
+		LOGTW_ERROR << "Error when getting context-width and central-position.";
+		return -1;
+	}
+	int N = context_width;
+	int P = central_position;
+
+	//HCLr.fst does not depend on G.fst
+	bool must_rebuild_hcl = (CheckFileExistsAndNotEmpty(f_HCLr_fst, false) < 0);
+	if (!must_rebuild_hcl) {
+		for (fs::path p : required) {
+			if (p.filename() != "G.fst" && fs::last_write_time(p) > fs::last_write_time(f_HCLr_fst))
+				must_rebuild_hcl = true;
+		}
+	}
+
+	if (CreateDir(lang / "tmp", true) < 0) return -1;
+	fs::path ilabels(lang / "tmp" / ("ilabels_la_" + std::to_string(N) + "_" + std::to_string(P)));
+	fs::path cl(lang / "tmp" / ("CL_" + std::to_string(N) + "_" + std::to_string(P) + ".fst"));
+
+	if (must_rebuild_hcl)
+	{
+		//L_disambig determinized (there is no G to determinize LG on)
+		try {
+			fs::path f_temp1(lang / "tmp" / "LDS.temp");
+			if (fstdeterminizestar((lang / "L_disambig.fst").string(), f_temp1.string(), true) < 0) return -1;
+			fs::path f_temp2(lang / "tmp" / "LME.temp");
+			if (fstminimizeencoded(f_temp1.string(), f_temp2.string()) < 0) return -1;
+			if (fs::exists(lang / "tmp" / "L_disambig_det.fst")) fs::remove(lang / "tmp" / "L_disambig_det.fst");
+			if (fstarcsort("ilabel", f_temp2.string(), (lang / "tmp" / "L_disambig_det.fst").string()) < 0) return -1;
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "failed to determinize L_disambig.fst.";
+			return -1;
+		}
+
+		//CL - Context FST creation
+		try {
+			if (fs::exists(cl)) fs::remove(cl);
+			if (fs::exists(ilabels)) fs::remove(ilabels);
+		}
+		catch (const std::exception& ex) {
+			LOGTW_ERROR << "failed to delete file. " << ex.what();
+			return -1;
+		}
+		string_vec optcc;
+		optcc.push_back("--print-args=false");
+		optcc.push_back("--context-size=" + std::to_string(N));
+		optcc.push_back("--central-position=" + std::to_string(P));
+		optcc.push_back("--read-disambig-syms=" + (lang / "phones" / "disambig.int").string());
+		optcc.push_back("--write-disambig-syms=" + (lang / "tmp" / ("disambig_ilabels_la_" + std::to_string(N) + "_" + std::to_string(P) + ".int")).string());
+		optcc.push_back(ilabels.string());
+		optcc.push_back((lang / "tmp" / "L_disambig_det.fst").string());
+		optcc.push_back((lang / "tmp" / "LCC.temp").string()); //output
+		StrVec2Arg argscc(optcc);
+		try {
+			if (fstcomposecontext(argscc.argc(), argscc.argv()) < 0) {
+				LOGTW_ERROR << "Context FST creation failed.";
+				return -1;
+			}
+			fstarcsort("ilabel", (lang / "tmp" / "LCC.temp").string(), cl.string());
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "Context FST creation failed.";
+			return -1;
+		}
+
+		//H transducer
+		string_vec optmhtd;
+		optmhtd.push_back("--print-args=false");
+		optmhtd.push_back("--disambig-syms-out=" + (dir / "disambig_tid.int").string());
+		optmhtd.push_back("--transition-scale=" + std::to_string(tscale));
+		optmhtd.push_back(ilabels.string());
+		optmhtd.push_back(tree.string());
+		optmhtd.push_back(model.string());
+		optmhtd.push_back((dir / "Ha.fst").string()); //output
+		StrVec2Arg argsmhtd(optmhtd);
+		try {
+			if (fs::exists(dir / "Ha.fst")) fs::remove(dir / "Ha.fst");
+			if (MakeHTransducer(argsmhtd.argc(), argsmhtd.argv()) < 0) {
+				LOGTW_ERROR << "H transducer creation failed.";
+				return -1;
+			}
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "H transducer creation failed.";
+			return -1;
+		}
+
+		//HCLa
+		fs::path f_temp1(dir / "Ha.temp");
+		fsttablecompose((dir / "Ha.fst").string(), cl.string(), f_temp1.string());
+		fs::path f_temp2(dir / "HaDS.temp");
+		fstdeterminizestar(f_temp1.string(), f_temp2.string(), true);
+
+		fs::path f_temp3(dir / "HaRMS.temp");
+		string_vec optrms;
+		optrms.push_back("--print-args=false");
+		optrms.push_back((dir / "disambig_tid.int").string());
+		optrms.push_back(f_temp2.string());
+		optrms.push_back(f_temp3.string()); //output
+		StrVec2Arg argsrms(optrms);
+		try {
+			if (fstrmsymbols(argsrms.argc(), argsrms.argv()) < 0) {
+				LOGTW_ERROR << "Symbols replacement failed.";
+				return -1;
+			}
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "Symbols replacement failed.";
+			return -1;
+		}
+
+		fs::path f_temp4(dir / "HaRMEL.temp");
+		string_vec optrmel;
+		optrmel.push_back("--print-args=false");
+		optrmel.push_back(f_temp3.string());
+		optrmel.push_back(f_temp4.string()); //output
+		StrVec2Arg argsrmel(optrmel);
+		try {
+			if (fstrmepslocal(argsrmel.argc(), argsrmel.argv()) < 0) {
+				LOGTW_ERROR << "Epsilon removal failed.";
+				return -1;
+			}
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "Epsilon removal failed.";
+			return -1;
+		}
+
+		fs::path f_HCLa(dir / "HCLa.temp");
+		fstminimizeencoded(f_temp4.string(), f_HCLa.string());
+
+		//AddSelfLoops
+		fs::path f_tempsl(dir / "HCLaSL.temp");
+		string_vec optasl;
+		optasl.push_back("--print-args=false");
+		optasl.push_back("--self-loop-scale=" + std::to_string(loopscale));
+		optasl.push_back("--reorder=true");
+		optasl.push_back(model.string());
+		optasl.push_back(f_HCLa.string());
+		optasl.push_back(f_tempsl.string()); //output
+		StrVec2Arg argsasl(optasl);
+		try {
+			if (AddSelfLoops(argsasl.argc(), argsasl.argv()) < 0) {
+				LOGTW_ERROR << "Adding self-loops failed.";
+				return -1;
+			}
+		}
+		catch (const std::exception&)
+		{
+			LOGTW_ERROR << "Adding self-loops failed.";
+			return -1;
+		}
+
+		//convert to olabel_lookahead (this relabels the output labels of HCL)
+		try {
+			fst::VectorFst<fst::StdArc> *hcl = fst::ReadFstKaldi(f_tempsl.string());
+			fst::StdOLabelLookAheadFst hcl_la(*hcl);
+			delete hcl;
+			if (fs::exists(f_HCLr_fst)) fs::remove(f_HCLr_fst);
+			if (!hcl_la.Write(f_HCLr_fst.string())) {
+				LOGTW_ERROR << "Failed to write " << f_HCLr_fst.string();
+				return -1;
+			}
+		}
+		catch (const std::exception& ex) {
+			LOGTW_ERROR << "Failed to create lookahead HCL. " << ex.what();
+			return -1;
+		}
+
+		//remove all temp files and intermediate files
+		std::vector<fs::path> _temps = { (lang / "tmp" / "LDS.temp"),
+										(lang / "tmp" / "LME.temp"),
+										(lang / "tmp" / "LCC.temp"),
+										(dir / "Ha.temp"),
+										(dir / "HaDS.temp"),
+										(dir / "HaRMS.temp"),
+										(dir / "HaRMEL.temp"),
+										(dir / "HCLa.temp"),
+										(dir / "HCLaSL.temp"),
+										(dir / "Ha.fst") };
+		try {
+			for (fs::path p : _temps) if (fs::exists(p)) fs::remove(p);
+		}
+		catch (const std::exception&) {
+			LOGTW_WARNING << "Could not remove temporary files.";
+		}
+	}
+	else {
+		LOGTW_INFO << f_HCLr_fst.string() << " is up to date.";
+	}
+
+	//Gr.fst must be rebuilt when G.fst or HCLr.fst changes
+	if (CheckFileExistsAndNotEmpty(f_Gr_fst, false) < 0 || fs::last_write_time(f_Gr_fst) < fs::last_write_time(lang / "G.fst") ||
+		fs::last_write_time(f_Gr_fst) < fs::last_write_time(f_HCLr_fst))
+	{
+		if (MakeLookaheadG(lang / "G.fst", graph_dir) < 0) return -1;
+	}
+
+	//keep a copy of the lexicon and a list of silence phones with the graph
+	try {
+		if (fs::exists(dir / "words.txt")) fs::remove(dir / "words.txt");
+		fs::copy_file(lang / "words.txt", dir / "words.txt");
+		if (CreateDir(dir / "phones", true) < 0) return -1;
+	}
+	catch (const std::exception& ex) {
+		LOGTW_ERROR << ex.what();
+		return -1;
+	}
+	CopyAllMatching(lang / "phones", dir / "phones", boost::regex("^(word_boundary\\.).*")); //might be needed for ctm scoring
+	CopyAllMatching(lang / "phones", dir / "phones", boost::regex("^(align_lexicon\\.).*")); //might be needed for ctm scoring
+	CopyAllMatching(lang / "phones", dir / "phones", boost::regex("^(optional_silence\\.).*")); //might be needed for analyzing alignments
+	try {
+		for (std::string f : { "disambig.txt", "disambig.int", "silence.csl" }) {
+			if (fs::exists(dir / "phones" / f)) fs::remove(dir / "phones" / f);
+			if (fs::exists(lang / "phones" / f))
+				fs::copy_file(lang / "phones" / f, dir / "phones" / f);
+		}
+		if (fs::exists(dir / "phones.txt")) fs::remove(dir / "phones.txt");
+		if (fs::exists(lang / "phones.txt"))
+			fs::copy_file(lang / "phones.txt", dir / "phones.txt");
+	}
+	catch (const std::exception& ex) {
+		LOGTW_ERROR << ex.what();
+		return -1;
+	}
+
+	//get model info
+	int nofphones, nofpdfs, noftransitionids, noftransitionstates;
+	if (AmInfo(model.string(), nofphones, nofpdfs, noftransitionids, noftransitionstates) < 0) return -1;
+
+	fs::ofstream file_num_pdfs(dir / "num_pdfs", std::ios::binary);
+	if (!file_num_pdfs) {
+		LOGTW_ERROR << " can't open output file: " << (dir / "num_pdfs").string();
+		return -1;
+	}
+	file_num_pdfs << nofpdfs << "\n";
+	file_num_pdfs.flush(); file_num_pdfs.close();
+
+	return 0;
+}
+
+/*
+	Relabels G for the lookahead HCL in graph_dir and writes it to graph_dir/Gr.fst. This can also be used to swap
+	the language model of an existing lookahead graph without rebuilding HCLr.fst. The new G.fst must use the same
+	words.txt.
+*/
+VOICEBRIDGE_API int MakeLookaheadG(fs::path g_in, fs::path graph_dir)
+{
+	fs::path hclr(graph_dir / "HCLr.fst"), gr_out(graph_dir / "Gr.fst");
+	if (CheckFilesExist(std::vector<fs::path> { g_in, hclr }) < 0) return -1;
+	try {
+		fst::StdOLabelLookAheadFst *hcl = fst::StdOLabelLookAheadFst::Read(hclr.string());
+		if (hcl == NULL) {
+			LOGTW_ERROR << "Failed to read " << hclr.string();
+			return -1;
+		}
+		fst::VectorFst<fst::StdArc> *g = fst::ReadFstKaldi(g_in.string());
+		fst::RelabelGForLookahead(*hcl, g);
+		delete hcl;
+		fst::ConstFst<fst::StdArc> gr(*g);
+		delete g;
+		if (fs::exists(gr_out)) fs::remove(gr_out);
+		if (!gr.Write(gr_out.string())) {
+			LOGTW_ERROR << "Failed to write " << gr_out.string();
+			return -1;
+		}
+	}
+	catch (const std::exception& ex) {
+		LOGTW_ERROR << "Failed to relabel " << g_in.string() << ". " << ex.what();
+		return -1;
+	}
+	return 0;
+}
+
+/*
+	Returns the decoding graph in graph_dir: HCLG.fst if it exists, otherwise HCLr.fst and Gr.fst (lookahead graph).
+	In the latter case lookahead_g is set to Gr.fst, which must be passed to GmmLatgenFaster as --lookahead-g.
+	If MkGraph() also made the packed graph HCLGp.fst and it is not older than HCLG.fst then that is returned instead.
+*/
+int GetDecodingGraph(fs::path graph_dir, fs::path & graph_fst, fs::path & lookahead_g)
+{
+	lookahead_g = "";
+	if (fs::exists(graph_dir / "HCLG.fst")) {
+		graph_fst = graph_dir / "HCLG.fst";
+		try {
+			if (fs::exists(graph_dir / "HCLGp.fst") &&
+				fs::last_write_time(graph_dir / "HCLGp.fst") >= fs::last_write_time(graph_dir / "HCLG.fst"))
+				graph_fst = graph_dir / "HCLGp.fst";
+		}
+		catch (const std::exception&) {} //fall back to HCLG.fst
+		return 0;
+	}
+	if (fs::exists(graph_dir / "HCLr.fst") && fs::exists(graph_dir / "Gr.fst")) {
+		graph_fst = graph_dir / "HCLr.fst";
+		lookahead_g = graph_dir / "Gr.fst";
+		LOGTW_INFO << "Decoding with on-the-fly composition of " << graph_fst.string() << " and " << lookahead_g.string();
+		return 0;
+	}
+	LOGTW_ERROR << "Failed to find " << (graph_dir / "HCLG.fst").string() << " or " << (graph_dir / "HCLr.fst").string();
+	return -1;
+}
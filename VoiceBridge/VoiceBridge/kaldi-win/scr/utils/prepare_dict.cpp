@@ -68,6 +68,8 @@ VOICEBRIDGE_API int PrepareDict(fs::path refDict,
 			Use the g2p model to develop a special lexicon for our project.
 			-- this will make sure that there are no words in the lexicon which are not needed (less processing time and memory)
 			-- in case of extra words not in the ref lexicon it will estimate the pronounciation
+			NOTE: only the words which are not in the ref lexicon (OOV) are decoded with the model; this is done in 
+				  parallel on all cores and each unique word is decoded only once.
 			*/
 			LOGTW_INFO << "Creating lexicon with trained model...";
 			if (Phonetisaurus::GetPronunciation(refDict, model, in_dict, out_dict, false) < 0) return -1;
@@ -1186,72 +1186,27 @@ VOICEBRIDGE_API int PrepareLang(bool position_dependent_phones, fs::path unk_fst
 
 	//[start] L.fst ---------------------------------------------------------------------------------------------
 	// Create the basic L.fst without disambiguation symbols, for use in training.
+	// NOTE: the fst is built directly in memory with the integer symbol ids (no text fst + fstcompile + fstarcsort).
 	if (silprob)
 	{
-		StringTable table_lexiconp_silprob, table_silprob, table_lexiconfst;
-		//a temporary file:
-		fs::path path_temp_lexiconfst(tmpdir / "lexicon_fst_silprob.temp");
+		StringTable table_lexiconp_silprob, table_silprob;
 		//read input
 		if (ReadStringTable((tmpdir / "lexiconp_silprob.txt").string(), table_lexiconp_silprob) < 0) return -1;
 		if (ReadStringTable((srcdir / "silprob.txt").string(), table_silprob) < 0) return -1;
-		//make temp file
-		if (MakeLexiconFstSilprob(table_lexiconp_silprob, table_silprob, path_temp_lexiconfst, silphone, "<eps>") < 0) return -1;
-		//compile the fst's and save them in the same temp file as above (overwrite)
-		fs::path path_isymbols(dir / "phones.txt");
-		fs::path path_osymbols(dir / "words.txt");
-		//a temporary file:
-		fs::path path_temp_lexiconfst_compiled(tmpdir / "lexicon_fst_compiled.temp");
-
-		try
-		{
-			fstcompile(false, "standard", "vector",
-				path_temp_lexiconfst.string(), path_temp_lexiconfst_compiled.string(),
-				path_isymbols.string(), path_osymbols.string(), "",
-				false, false, false, false);
-
-		}
-		catch (const std::exception& message)
-		{
-			LOGTW_ERROR << "Error while compiling fst's, check file: " << path_temp_lexiconfst.string() << "\nDetail: " << message.what() << ".";
-			return -1;
-		}
-
-		//sort the fst's and write the final output
+		//make the compiled and sorted fst
 		fs::path path_L_FST(dir / "L.fst");
-		fstarcsort("olabel", path_temp_lexiconfst_compiled.string(), path_L_FST.string());
+		if (MakeLexiconFstSilprobMem(table_lexiconp_silprob, table_silprob, table_dir_phones, table_dir_words, 
+									 path_L_FST, silphone, "<eps>") < 0) return -1;
 	}
 	else
 	{
-		StringTable table_lexiconp, table_lexiconfst;
-		//a temporary file:
-		fs::path path_temp_lexiconfst(tmpdir / "lexicon_fst.temp");
+		StringTable table_lexiconp;
 		//read input
 		if (ReadStringTable((tmpdir / "lexiconp.txt").string(), table_lexiconp) < 0) return -1;
-		//make temp file
-		if (MakeLexiconFst(table_lexiconp, path_temp_lexiconfst, true, sil_prob, silphone, "") < 0) return -1;
-		//compile the fst's and save them in the same temp file as above (overwrite)
-		fs::path path_isymbols(dir / "phones.txt");
-		fs::path path_osymbols(dir / "words.txt");
-		//a temporary file:
-		fs::path path_temp_lexiconfst_compiled(tmpdir / "lexicon_fst_compiled.temp");
-		
-		try
-		{
-			fstcompile(false, "standard", "vector",
-				path_temp_lexiconfst.string(), path_temp_lexiconfst_compiled.string(),
-				path_isymbols.string(), path_osymbols.string(), "",
-				false, false, false, false);
-		}
-		catch (const std::exception& message)
-		{
-			LOGTW_ERROR << "Error while compiling fst's, check file: " << path_temp_lexiconfst.string() << "\nDetail: " << message.what() << ".";
-			return -1;
-		}
-
-		//sort the fst's and write the final output
+		//make the compiled and sorted fst
 		fs::path path_L_FST(dir / "L.fst");
-		fstarcsort("olabel", path_temp_lexiconfst_compiled.string(), path_L_FST.string());
-
+		if (MakeLexiconFstMem(table_lexiconp, table_dir_phones, table_dir_words, 
+							  path_L_FST, true, sil_prob, silphone, "") < 0) return -1;
 	}
 	//[end] L.fst ---------------------------------------------------------------------------------------------
 
@@ -1370,87 +1325,32 @@ VOICEBRIDGE_API int PrepareLang(bool position_dependent_phones, fs::path unk_fst
 	 loop to "pass through" the disambiguation symbols from G.fst.
 	*/
 	//[start] L_disambig.fst ---------------------------------------------------------------------------------------------
-	// Create the basic L.fst without disambiguation symbols, for use in training.
+	// Create L_disambig.fst with the disambiguation symbols and the self-loops which pass through the disambiguation
+	// symbols from G.fst. The fst is built directly in memory (see L.fst above).
 	if (silprob)
 	{
-		StringTable table_lexiconp_silprob, table_silprob, table_lexiconfst;
-		//a temporary file:
-		fs::path path_temp_lexiconfst(tmpdir / "lexicon_fst_silprob_disambig.temp");
+		StringTable table_lexiconp_silprob, table_silprob;
 		//read input
 		if (ReadStringTable((tmpdir / "lexiconp_silprob_disambig.txt").string(), table_lexiconp_silprob) < 0) return -1;
 		if (ReadStringTable((srcdir / "silprob.txt").string(), table_silprob) < 0) return -1;
 		std::string sildisambig("#" + std::to_string(ndisambig));
-		//make temp file
-		if (MakeLexiconFstSilprob(table_lexiconp_silprob, table_silprob, path_temp_lexiconfst, silphone, sildisambig) < 0) return -1;
-		//compile the fst's and save them in the same temp file as above (overwrite)
-		fs::path path_isymbols(dir / "phones.txt");
-		fs::path path_osymbols(dir / "words.txt");
-		//a temporary file:
-		fs::path path_temp_lexiconfst_compiled(tmpdir / "lexicon_fst_disambig_compiled.temp");
-
-		try
-		{
-			fstcompile(false, "standard", "vector",
-				path_temp_lexiconfst.string(), path_temp_lexiconfst_compiled.string(),
-				path_isymbols.string(), path_osymbols.string(), "",
-				false, false, false, false);
-
-		}
-		catch (const std::exception& message)
-		{
-			LOGTW_ERROR << "Error while compiling fst's, check file: " << path_temp_lexiconfst.string() << "\nDetail: " << message.what() << ".";
-			return -1;
-		}
-
-		//add self-loops to fst
-		fs::path inp(path_phones / "wdisambig_phones.int");
-		fs::path outw(path_phones / "wdisambig_words.int");
-		fs::path path_temp_lexiconfst_compiledL(tmpdir / "lexicon_fst_disambig_compiledL.temp");
-		if (fstaddselfloops(path_temp_lexiconfst_compiled.string(), path_temp_lexiconfst_compiledL.string(), inp.string(), outw.string()) < 0) return -1;
-
-		//sort the fst's and write the final output
+		//make the compiled fst with self-loops, sorted
 		fs::path path_L_FST(dir / "L_disambig.fst");
-		fstarcsort("olabel", path_temp_lexiconfst_compiledL.string(), path_L_FST.string());
+		if (MakeLexiconFstSilprobMem(table_lexiconp_silprob, table_silprob, table_dir_phones, table_dir_words,
+									 path_L_FST, silphone, sildisambig, 
+									 path_phones / "wdisambig_phones.int", path_phones / "wdisambig_words.int") < 0) return -1;
 	}
 	else
 	{
-		StringTable table_lexiconp, table_lexiconfst;
-		//a temporary file:
-		fs::path path_temp_lexiconfst(tmpdir / "lexicon_fst_disambig.temp");
+		StringTable table_lexiconp;
 		//read input
 		if (ReadStringTable((tmpdir / "lexiconp_disambig.txt").string(), table_lexiconp) < 0) return -1;
 		std::string sildisambig("#" + std::to_string(ndisambig));
-		//make temp file
-		if (MakeLexiconFst(table_lexiconp, path_temp_lexiconfst, true, sil_prob, silphone, sildisambig) < 0) return -1;
-		//compile the fst's and save them in the same temp file as above (overwrite)
-		fs::path path_isymbols(dir / "phones.txt");
-		fs::path path_osymbols(dir / "words.txt");
-		//a temporary file:
-		fs::path path_temp_lexiconfst_compiled(tmpdir / "lexicon_fst_disambig_compiled.temp");
-
-		try
-		{
-			fstcompile(false, "standard", "vector",
-				path_temp_lexiconfst.string(), path_temp_lexiconfst_compiled.string(),
-				path_isymbols.string(), path_osymbols.string(), "",
-				false, false, false, false);
-		}
-		catch (const std::exception& message)
-		{
-			LOGTW_ERROR << "Error while compiling fst's, check file: " << path_temp_lexiconfst.string() << "\nDetail: " << message.what() << ".";
-			return -1;
-		}
-
-		//add self-loops to fst
-		fs::path inp(path_phones / "wdisambig_phones.int");
-		fs::path outw(path_phones / "wdisambig_words.int");
-		fs::path path_temp_lexiconfst_compiledL(tmpdir / "lexicon_fst_disambig_compiledL.temp");
-		if (fstaddselfloops(path_temp_lexiconfst_compiled.string(), path_temp_lexiconfst_compiledL.string(), inp.string(), outw.string()) < 0) return -1;
-
-		//sort the fst's and write the final output
+		//make the compiled fst with self-loops, sorted
 		fs::path path_L_FST(dir / "L_disambig.fst");
-		fstarcsort("olabel", path_temp_lexiconfst_compiledL.string(), path_L_FST.string());
-
+		if (MakeLexiconFstMem(table_lexiconp, table_dir_phones, table_dir_words,
+							  path_L_FST, true, sil_prob, silphone, sildisambig, 
+							  path_phones / "wdisambig_phones.int", path_phones / "wdisambig_words.int") < 0) return -1;
 	}
 	//[end] L_disambig.fst ---------------------------------------------------------------------------------------------
 
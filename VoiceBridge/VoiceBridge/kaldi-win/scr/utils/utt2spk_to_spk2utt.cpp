@@ -24,13 +24,10 @@ int utt2spk_to_spk2utt(StringTable & spk2utt, StringTable & utt2spk)
 			LOGTW_ERROR << " There should be 2 columns in the utt2spk file!";
 			return -1;
 		}
-		if (std::find(speakers.begin(), speakers.end(), (*it)[1]) == speakers.end())
-		{ //not found, add it
-			speakers.push_back((*it)[1]);
-		}
 		spk2utt2_map::iterator itm = hashtable.find((*it)[1]);
 		if (itm == hashtable.end())
-		{//did not find
+		{//did not find; the speakers are output in the order they are first seen
+			speakers.push_back((*it)[1]);
 			std::vector<std::string> uttvec;
 			uttvec.push_back((*it)[0]);
 			hashtable.emplace((*it)[1], uttvec);
@@ -44,12 +41,13 @@ int utt2spk_to_spk2utt(StringTable & spk2utt, StringTable & utt2spk)
 		spk2utt2_map::iterator itm = hashtable.find(*it);
 		if (itm != hashtable.end()) {
 			std::vector<std::string> _s;
+			_s.reserve(itm->second.size() + 1);
 			_s.push_back(*it);
-			for (string_vec::const_iterator itu(itm->second.begin()), itu_end(itm->second.end()); itu != itu_end; ++itu)
+			for (string_vec::iterator itu(itm->second.begin()), itu_end(itm->second.end()); itu != itu_end; ++itu)
 			{
-				_s.push_back(*itu);
+				_s.push_back(std::move(*itu));
 			}
-			spk2utt.push_back(_s);
+			spk2utt.push_back(std::move(_s));
 		}
 	}
 
@@ -26,9 +26,35 @@
 #include "hmm/transition-model.h"
 #include "hmm/posterior.h"
 #include "transform/lda-estimate.h"
+#include "transform/block-accumulators.h"
+
+#include <thread>
 
 #include "kaldi-win/src/kaldi_src.h"
 
+namespace kaldi {
+
+//accumulates the utterances j, j+nj, ... of the chunk into the partial accumulator of thread j
+static void AccLdaChunk(const TransitionModel &trans_model, const std::vector<Matrix<BaseFloat>> &feats,
+	const std::vector<Posterior> &posts, int j, int nj, BaseFloat rand_prune, LdaBlockEstimate *lda) {
+	for (size_t u = j; u < feats.size(); u += nj) {
+		Posterior pdf_post;
+		ConvertPosteriorToPdfs(trans_model, posts[u], &pdf_post);
+		for (int32 i = 0; i < feats[u].NumRows(); i++) {
+			SubVector<BaseFloat> feat(feats[u], i);
+			for (size_t k = 0; k < pdf_post[i].size(); k++) {
+				int32 pdf_id = pdf_post[i][k].first;
+				BaseFloat weight = RandPrune(pdf_post[i][k].second, rand_prune);
+				if (weight != 0.0) {
+					lda->Accumulate(feat, pdf_id, weight);
+				}
+			}
+		}
+	}
+}
+
+}  // namespace kaldi
+
 /** @brief Accumulate LDA statistics based on pdf-ids. Inputs are the
 source models, that serve as the input (and may potentially contain
 the current transformation), the un-transformed features and state
@@ -45,10 +71,14 @@ int AccLda(int argc, char *argv[], fs::ofstream & file_log) {
 
 		bool binary = true;
 		BaseFloat rand_prune = 0.0;
+		int32 num_threads = 1, block_size = 256;
 		ParseOptions po(usage);
 		po.Register("binary", &binary, "Write accumulators in binary mode.");
 		po.Register("rand-prune", &rand_prune,
 			"Randomized pruning threshold for posteriors");
+		po.Register("num-threads", &num_threads, "Number of threads accumulating the statistics "
+			"(each thread has its own partial accumulator).");
+		po.Register("block-size", &block_size, "Number of frames gathered for one rank-k update of the scatter matrix.");
 		po.Read(argc, argv);
 
 		if (po.NumArgs() != 4) {
@@ -71,7 +101,25 @@ int AccLda(int argc, char *argv[], fs::ofstream & file_log) {
 			// discard rest of file.
 		}
 
-		LdaEstimate lda;
+		//VB: the frames are accumulated in blocks with rank-k updates (LdaBlockEstimate) by num_threads threads,
+		//    each with its own partial accumulator; the utterances are read in chunks by this thread.
+		num_threads = std::max(1, num_threads);
+		std::vector<LdaBlockEstimate> lda(num_threads, LdaBlockEstimate(block_size));
+		const size_t chunk_size = 16 * num_threads;
+		std::vector<Matrix<BaseFloat>> chunk_feats;
+		std::vector<Posterior> chunk_posts;
+		auto accumulate_chunk = [&]() {
+			if (num_threads == 1) AccLdaChunk(trans_model, chunk_feats, chunk_posts, 0, 1, rand_prune, &lda[0]);
+			else {
+				std::vector<std::thread> _threads;
+				for (int j = 0; j < num_threads; j++)
+					_threads.emplace_back(kaldi::AccLdaChunk, std::cref(trans_model), std::cref(chunk_feats),
+						std::cref(chunk_posts), j, num_threads, rand_prune, &lda[j]);
+				for (auto& t : _threads) t.join();
+			}
+			chunk_feats.clear();
+			chunk_posts.clear();
+		};
 
 		SequentialBaseFloatMatrixReader feature_reader(features_rspecifier);
 		RandomAccessPosteriorReader posterior_reader(posteriors_rspecifier);
@@ -87,8 +135,8 @@ int AccLda(int argc, char *argv[], fs::ofstream & file_log) {
 			const Posterior &post(posterior_reader.Value(utt));
 			const Matrix<BaseFloat> &feats(feature_reader.Value());
 
-			if (lda.Dim() == 0)
-				lda.Init(trans_model.NumPdfs(), feats.NumCols());
+			if (lda[0].Dim() == 0)
+				for (int j = 0; j < num_threads; j++) lda[j].Init(trans_model.NumPdfs(), feats.NumCols());
 
 			if (feats.NumRows() != static_cast<int32>(post.size())) {
 				KALDI_WARN << "Posterior vs. feats size mismatch "
@@ -96,25 +144,16 @@ int AccLda(int argc, char *argv[], fs::ofstream & file_log) {
 				num_fail++;
 				continue;
 			}
-			if (lda.Dim() != 0 && lda.Dim() != feats.NumCols()) {
-				KALDI_WARN << "Feature dimension mismatch " << lda.Dim()
+			if (lda[0].Dim() != 0 && lda[0].Dim() != feats.NumCols()) {
+				KALDI_WARN << "Feature dimension mismatch " << lda[0].Dim()
 					<< " vs. " << feats.NumCols();
 				num_fail++;
 				continue;
 			}
 
-			Posterior pdf_post;
-			ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-			for (int32 i = 0; i < feats.NumRows(); i++) {
-				SubVector<BaseFloat> feat(feats, i);
-				for (size_t j = 0; j < pdf_post[i].size(); j++) {
-					int32 pdf_id = pdf_post[i][j].first;
-					BaseFloat weight = RandPrune(pdf_post[i][j].second, rand_prune);
-					if (weight != 0.0) {
-						lda.Accumulate(feat, pdf_id, weight);
-					}
-				}
-			}
+			chunk_feats.push_back(feats);
+			chunk_posts.push_back(post);
+			if (chunk_feats.size() == chunk_size) accumulate_chunk();
 			num_done++;
 			if (num_done % 100 == 0) {
 				if (file_log)
@@ -123,12 +162,20 @@ int AccLda(int argc, char *argv[], fs::ofstream & file_log) {
 			}
 		}
 
+		accumulate_chunk();
+		//sum the partial accumulators
+		lda[0].Flush();
+		for (int j = 1; j < num_threads; j++) {
+			lda[j].Flush();
+			lda[0].Add(lda[j]);
+		}
+
 		if (file_log)
 			file_log << "Done " << num_done << " files, failed for " << num_fail << "\n";
 		else KALDI_LOG << "Done " << num_done << " files, failed for " << num_fail;
 
 		Output ko(acc_wxfilename, binary);
-		lda.Write(ko.Stream(), binary);
+		lda[0].Write(ko.Stream(), binary);
 		if (file_log)
 			file_log << "Written statistics.";
 		else KALDI_LOG << "Written statistics.";
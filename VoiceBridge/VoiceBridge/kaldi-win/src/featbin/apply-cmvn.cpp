@@ -14,6 +14,7 @@ Based on : Copyright 2009-2011  Microsoft Corporation, Apache 2.0
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
 #include "transform/cmvn.h"
+#include "util/mapped-feature-reader.h"
 
 #include "kaldi-win/src/kaldi_src.h"
 
@@ -100,8 +101,34 @@ int ApplyCmvn(int argc, char *argv[], fs::ofstream & file_log) {
 
     kaldi::int32 num_done = 0, num_err = 0;
 
-    SequentialBaseFloatMatrixReader feat_reader(feat_rspecifier);
+    //VB: features given by an scp file (the usual data/*/feats.scp) are read from the memory mapped
+    //archives and decompressed directly into 'feat'; other rspecifiers go through the table reader.
+    MappedFeatureReader mapped_reader;
+    std::string feat_scp;
+    bool use_mapped = (ClassifyRspecifier(feat_rspecifier, &feat_scp, NULL) == kScriptRspecifier &&
+                       mapped_reader.Open(feat_scp));
+    SequentialBaseFloatMatrixReader feat_reader;
+    if (!use_mapped) feat_reader.Open(feat_rspecifier);
+    size_t num_read = 0;
+    // Reads the next utterance into 'utt' and 'feat' (which is reused); returns false at the end.
+    auto read_next = [&](std::string *utt, Matrix<BaseFloat> *feat) -> bool {
+      if (use_mapped) {
+        if (num_read == mapped_reader.NumUtterances()) return false;
+        *utt = mapped_reader.Key(num_read);
+        if (!mapped_reader.Read(num_read, feat))
+          KALDI_ERR << "Failed to read features for utterance " << *utt;
+      } else {
+        if (num_read != 0) feat_reader.Next();
+        if (feat_reader.Done()) return false;
+        *utt = feat_reader.Key();
+        *feat = feat_reader.Value();
+      }
+      num_read++;
+      return true;
+    };
     BaseFloatMatrixWriter feat_writer(feat_wspecifier);
+    std::string utt;
+    Matrix<BaseFloat> feat;
 
     if (ClassifyRspecifier(cmvn_rspecifier_or_rxfilename, NULL, NULL)
         != kNoRspecifier) { // reading from a Table: per-speaker or per-utt CMN/CVN.
@@ -110,9 +137,7 @@ int ApplyCmvn(int argc, char *argv[], fs::ofstream & file_log) {
       RandomAccessDoubleMatrixReaderMapped cmvn_reader(cmvn_rspecifier,
                                                        utt2spk_rspecifier);
 
-      for (; !feat_reader.Done(); feat_reader.Next()) {
-        std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
+      while (read_next(&utt, &feat)) {
         if (norm_means) {
           if (!cmvn_reader.HasKey(utt)) {
             KALDI_WARN << "No normalization statistics available for key "
@@ -149,9 +174,7 @@ int ApplyCmvn(int argc, char *argv[], fs::ofstream & file_log) {
       if (!skip_dims.empty())
         FakeStatsForSomeDims(skip_dims, &cmvn_stats);
 
-      for (;!feat_reader.Done(); feat_reader.Next()) {
-        std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
+      while (read_next(&utt, &feat)) {
         if (norm_means) {
           if (reverse) {
             ApplyCmvnReverse(cmvn_stats, norm_vars, &feat);
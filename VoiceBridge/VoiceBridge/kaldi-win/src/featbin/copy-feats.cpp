@@ -15,9 +15,58 @@ Based on :
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
+#include "transform/cmvn.h"
 
 #include "kaldi-win/src/kaldi_src.h"
 
+namespace kaldi {
+
+//VB: accumulates CMVN statistics of the features while they are written (per speaker if utt2spk is given,
+//otherwise per utterance), so that the statistics can be computed without reading all features again.
+//The statistics of several jobs are summed per speaker afterwards.
+class CmvnStatsAccumulator {
+ public:
+  explicit CmvnStatsAccumulator(const std::string &utt2spk_rspecifier):
+      utt2spk_reader_(utt2spk_rspecifier) { }
+
+  void Accumulate(const std::string &utt, const MatrixBase<BaseFloat> &feats) {
+    std::string spk = utt;
+    if (utt2spk_reader_.IsOpen()) {
+      if (!utt2spk_reader_.HasKey(utt)) {
+        KALDI_WARN << "No speaker for utterance " << utt << ", not accumulating CMVN stats.";
+        return;
+      }
+      spk = utt2spk_reader_.Value(utt);
+    }
+    Matrix<double> &stats = stats_[spk];
+    if (stats.NumRows() == 0)
+      InitCmvnStats(feats.NumCols(), &stats);
+    AccCmvnStats(feats, NULL, &stats);
+  }
+
+  // The statistics are accumulated from the features as they will be read back (after compression).
+  void Accumulate(const std::string &utt, const CompressedMatrix &feats) {
+    feats_.Resize(feats.NumRows(), feats.NumCols(), kUndefined);
+    feats.CopyToMat(&feats_);
+    Accumulate(utt, feats_);
+  }
+
+  int32 Write(const std::string &wspecifier) const {
+    DoubleMatrixWriter writer(wspecifier);
+    for (std::map<std::string, Matrix<double> >::const_iterator it = stats_.begin();
+         it != stats_.end(); ++it)
+      writer.Write(it->first, it->second);
+    return static_cast<int32>(stats_.size());
+  }
+
+ private:
+  RandomAccessTokenReader utt2spk_reader_;
+  std::map<std::string, Matrix<double> > stats_;
+  Matrix<BaseFloat> feats_;
+};
+
+}  // namespace kaldi
+
 
 int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
 {
@@ -39,7 +88,7 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
     bool sphinx_in = false;
     bool compress = false;
     int32 compression_method_in = 1;
-    std::string num_frames_wspecifier;
+    std::string num_frames_wspecifier, cmvn_stats_wspecifier, utt2spk_rspecifier;
     po.Register("htk-in", &htk_in, "Read input as HTK features");
     po.Register("sphinx-in", &sphinx_in, "Read input as Sphinx features");
     po.Register("binary", &binary, "Binary-mode output (not relevant if writing "
@@ -56,6 +105,12 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
                 "e.g. 'ark,t:utt2num_frames'.  Only applicable if writing tables, "
                 "not when this program is writing individual files.  See also "
                 "feat-to-len.");
+    po.Register("write-cmvn-stats", &cmvn_stats_wspecifier,
+                "Wspecifier to write CMVN statistics of the output features, per "
+                "speaker if --utt2spk is given, otherwise per utterance (VB). "
+                "Only applicable if writing tables.");
+    po.Register("utt2spk", &utt2spk_rspecifier,
+                "rspecifier for utterance to speaker map, used with --write-cmvn-stats");
 
     po.Read(argc, argv);
 
@@ -76,6 +131,8 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
       std::string rspecifier = po.GetArg(1);
       std::string wspecifier = po.GetArg(2);
       Int32Writer num_frames_writer(num_frames_wspecifier);
+      CmvnStatsAccumulator cmvn_stats(utt2spk_rspecifier);
+      bool write_cmvn = !cmvn_stats_wspecifier.empty();
 
       if (!compress) {
         BaseFloatMatrixWriter kaldi_writer(wspecifier);
@@ -83,6 +140,8 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
           SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
           for (; !htk_reader.Done(); htk_reader.Next(), num_done++) {
             kaldi_writer.Write(htk_reader.Key(), htk_reader.Value().first);
+            if (write_cmvn)
+              cmvn_stats.Accumulate(htk_reader.Key(), htk_reader.Value().first);
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(htk_reader.Key(),
                                       htk_reader.Value().first.NumRows());
@@ -91,6 +150,8 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
           SequentialTableReader<SphinxMatrixHolder<> > sphinx_reader(rspecifier);
           for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++) {
             kaldi_writer.Write(sphinx_reader.Key(), sphinx_reader.Value());
+            if (write_cmvn)
+              cmvn_stats.Accumulate(sphinx_reader.Key(), sphinx_reader.Value());
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(sphinx_reader.Key(),
                                       sphinx_reader.Value().NumRows());
@@ -99,6 +160,8 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
           SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++) {
             kaldi_writer.Write(kaldi_reader.Key(), kaldi_reader.Value());
+            if (write_cmvn)
+              cmvn_stats.Accumulate(kaldi_reader.Key(), kaldi_reader.Value());
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(kaldi_reader.Key(),
                                       kaldi_reader.Value().NumRows());
@@ -109,9 +172,10 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
         if (htk_in) {
           SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
           for (; !htk_reader.Done(); htk_reader.Next(), num_done++) {
-            kaldi_writer.Write(htk_reader.Key(),
-                               CompressedMatrix(htk_reader.Value().first,
-                                                compression_method));
+            CompressedMatrix cmat(htk_reader.Value().first, compression_method);
+            kaldi_writer.Write(htk_reader.Key(), cmat);
+            if (write_cmvn)
+              cmvn_stats.Accumulate(htk_reader.Key(), cmat);
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(htk_reader.Key(),
                                       htk_reader.Value().first.NumRows());
@@ -119,9 +183,10 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
         } else if (sphinx_in) {
           SequentialTableReader<SphinxMatrixHolder<> > sphinx_reader(rspecifier);
           for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++) {
-            kaldi_writer.Write(sphinx_reader.Key(),
-                               CompressedMatrix(sphinx_reader.Value(),
-                                                compression_method));
+            CompressedMatrix cmat(sphinx_reader.Value(), compression_method);
+            kaldi_writer.Write(sphinx_reader.Key(), cmat);
+            if (write_cmvn)
+              cmvn_stats.Accumulate(sphinx_reader.Key(), cmat);
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(sphinx_reader.Key(),
                                       sphinx_reader.Value().NumRows());
@@ -129,14 +194,21 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
         } else {
           SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++) {
-            kaldi_writer.Write(kaldi_reader.Key(),
-                               CompressedMatrix(kaldi_reader.Value(),
-                                                compression_method));
+            CompressedMatrix cmat(kaldi_reader.Value(), compression_method);
+            kaldi_writer.Write(kaldi_reader.Key(), cmat);
+            if (write_cmvn)
+              cmvn_stats.Accumulate(kaldi_reader.Key(), cmat);
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(kaldi_reader.Key(),
                                       kaldi_reader.Value().NumRows());
           }
         }
+      }
+      if (write_cmvn) {
+        int32 num_spk = cmvn_stats.Write(cmvn_stats_wspecifier);
+        if (file_log)
+          file_log << "Wrote CMVN stats for " << num_spk << (utt2spk_rspecifier.empty() ? " utterances." : " speakers.") << "\n";
+        else KALDI_LOG << "Wrote CMVN stats for " << num_spk << (utt2spk_rspecifier.empty() ? " utterances." : " speakers.");
       }
 	  if (file_log)
 		file_log << "Copied " << num_done << " feature matrices." << "\n";
@@ -145,8 +217,8 @@ int CopyFeats(int argc, char *argv[], fs::ofstream & file_log)
       return (num_done != 0 ? 0 : 1);
     } else {
       KALDI_ASSERT(!compress && "Compression not yet supported for single files");
-	  if (!num_frames_wspecifier.empty()) {
-		  KALDI_ERR << "--write-num-frames option not supported when writing/reading "
+	  if (!num_frames_wspecifier.empty() || !cmvn_stats_wspecifier.empty()) {
+		  KALDI_ERR << "--write-num-frames and --write-cmvn-stats options not supported when writing/reading "
 			  << "single files.";
 		  return -1; //VB
 	  }
@@ -87,5 +87,8 @@ int fstrmepslocal(int argc, char *argv[]);
 
 int fstconvert(std::string in_name, std::string out_name, std::string fsttype="");
 
+//Converts a decoding graph to the packed FST type (see fstext/packed-fst.h); optionally reorders the states for locality
+int fstpack(std::string in_name, std::string out_name, bool reorder_states = true);
+
 
 
@@ -0,0 +1,46 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "fstext/packed-fst.h"
+
+#include "fst_ext.h"
+
+/*
+Converts a decoding graph (e.g. HCLG.fst) to the packed FST type of fstext/packed-fst.h, which
+LatticeFasterDecoder can traverse faster (separate label/weight/next-state arrays, epsilon arcs
+of each state stored before the emitting arcs). If reorder_states is true the states are also
+renumbered in breadth-first order from the start state so that the states which are usually
+visited together are close together in memory.
+*/
+int fstpack(std::string in_name, std::string out_name, bool reorder_states)
+{
+	try {
+		using namespace kaldi;
+		using namespace fst;
+
+		Fst<StdArc> *fst = ReadFstKaldiGeneric(in_name);
+		PackedFst packed(*fst, reorder_states);
+		delete fst;
+
+		Output ko(out_name, true);
+		if (!packed.Write(ko.Stream(), FstWriteOptions(out_name))) {
+			LOGTW_ERROR << "Failed to write packed FST to " << out_name;
+			return -1;
+		}
+		ko.Close();
+	}
+	catch (const std::exception &e) {
+		LOGTW_ERROR << e.what();
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Kaldi (gmm-est-fmllr.cc, gmm-est-fmllr-gpost.cc, gmm-post-to-gpost.cc, weight-silence-post.cc,
+		   lattice-to-post.cc, lattice-determinize-pruned.cc, compose-transforms.cc, transform-feats.cc)
+*/
+
+#include "lat/lattice-functions.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "transform/transform-common.h"
+
+#include "fmllr-speaker-estimator.h"
+
+namespace kaldi {
+
+SpeakerFmllrEstimator::SpeakerFmllrEstimator(const TransitionModel &trans_model, const AmDiagGmm &am_gmm,
+	const AmDiagGmm *gpost_gmm, const SpeakerFmllrOptions &opts, const BasisFmllrEstimate *basis)
+	: trans_model_(trans_model), am_gmm_(am_gmm), gpost_gmm_(gpost_gmm), opts_(opts), basis_(basis) {
+	std::vector<int32> silence_phones;
+	if (!SplitStringToIntegers(opts_.silence_phones, ":", false, &silence_phones))
+		KALDI_ERR << "Invalid silence-phones string " << opts_.silence_phones;
+	silence_set_.Init(silence_phones);
+	if (gpost_gmm_ != NULL && gpost_gmm_->NumPdfs() != am_gmm_.NumPdfs())
+		KALDI_ERR << "Mismatch in number of pdfs between the Gaussian posterior model and the model ("
+			<< gpost_gmm_->NumPdfs() << " vs. " << am_gmm_.NumPdfs() << ")";
+	if (basis_ != NULL && basis_->Dim() != am_gmm_.Dim())
+		KALDI_ERR << "Mismatch in dimension between the fMLLR basis and the model ("
+			<< basis_->Dim() << " vs. " << am_gmm_.Dim() << ")";
+}
+
+void SpeakerFmllrEstimator::AlignmentToPost(const std::vector<int32> &ali, Posterior *post) const {
+	kaldi::AlignmentToPosterior(ali, post);
+	if (!silence_set_.empty())
+		WeightSilencePost(trans_model_, silence_set_, opts_.silence_weight, post);
+}
+
+bool SpeakerFmllrEstimator::LatticeToPost(const std::string &utt, Lattice *lat, Posterior *post) const {
+	if (opts_.acoustic_scale == 0.0)
+		KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted).";
+	fst::ScaleLattice(fst::AcousticLatticeScale(opts_.acoustic_scale), lat);
+	if (opts_.determinize_beam > 0.0) {
+		//lattice-determinize-pruned (in the scaled domain, the posteriors are computed from the scaled lattice)
+		fst::DeterminizeLatticePrunedOptions det_opts;
+		det_opts.max_mem = 50000000;
+		det_opts.max_loop = 0;
+		Invert(lat); // so word labels are on the input side.
+		if (!TopSort(lat)) {
+			KALDI_WARN << "Could not topologically sort lattice for utterance " << utt;
+		}
+		fst::ArcSort(lat, fst::ILabelCompare<LatticeArc>());
+		CompactLattice det_clat;
+		if (!DeterminizeLatticePruned(*lat, opts_.determinize_beam, &det_clat, det_opts))
+			KALDI_WARN << "For key " << utt << ", determinization did not succeed"
+			"(partial output will be pruned tighter than the specified beam.)";
+		fst::Connect(&det_clat);
+		if (det_clat.NumStates() == 0) {
+			KALDI_WARN << "For key " << utt << ", determinized and trimmed lattice was empty.";
+			return false;
+		}
+		ConvertLattice(det_clat, lat); // transition-ids on the input side again
+	}
+	uint64 props = lat->Properties(fst::kFstProperties, false);
+	if (!(props & fst::kTopSorted)) {
+		if (fst::TopSort(lat) == false) {
+			KALDI_WARN << "Cycles detected in lattice for utterance " << utt;
+			return false;
+		}
+	}
+	LatticeForwardBackward(*lat, post);
+	if (!silence_set_.empty())
+		WeightSilencePost(trans_model_, silence_set_, opts_.silence_weight, post);
+	return true;
+}
+
+void SpeakerFmllrEstimator::AccumulateForUtterance(const MatrixBase<BaseFloat> &feats, const Posterior &post,
+	FmllrDiagGmmAccs *spk_stats) const {
+	Posterior pdf_post;
+	ConvertPosteriorToPdfs(trans_model_, post, &pdf_post);
+	Vector<BaseFloat> gauss_post;
+	for (size_t i = 0; i < pdf_post.size(); i++) {
+		for (size_t j = 0; j < pdf_post[i].size(); j++) {
+			int32 pdf_id = pdf_post[i][j].first;
+			BaseFloat weight = pdf_post[i][j].second;
+			if (gpost_gmm_ == NULL) {
+				spk_stats->AccumulateForGmm(am_gmm_.GetPdf(pdf_id), feats.Row(i), weight);
+			}
+			else {
+				gpost_gmm_->GetPdf(pdf_id).ComponentPosteriors(feats.Row(i), &gauss_post);
+				gauss_post.Scale(weight);
+				if (!gauss_post.IsZero())
+					spk_stats->AccumulateFromPosteriors(am_gmm_.GetPdf(pdf_id), feats.Row(i), gauss_post);
+			}
+		}
+	}
+}
+
+void SpeakerFmllrEstimator::Accumulate(const std::vector<const Matrix<BaseFloat>*> &feats,
+	const std::vector<const Posterior*> &posts, const Matrix<BaseFloat> &cur_transform,
+	FmllrDiagGmmAccs *spk_stats) const {
+	KALDI_ASSERT(feats.size() == posts.size());
+	Matrix<BaseFloat> xformed;
+	for (size_t i = 0; i < feats.size(); i++) {
+		if (cur_transform.NumRows() != 0) {
+			//the features of the current pass, transformed on the fly
+			ApplyTransform(cur_transform, *feats[i], &xformed);
+			AccumulateForUtterance(xformed, *posts[i], spk_stats);
+		}
+		else {
+			AccumulateForUtterance(*feats[i], *posts[i], spk_stats);
+		}
+	}
+}
+
+void SpeakerFmllrEstimator::Estimate(const std::vector<const Matrix<BaseFloat>*> &feats,
+	const std::vector<const Posterior*> &posts, const Matrix<BaseFloat> &cur_transform,
+	Matrix<BaseFloat> *transform, BaseFloat *impr, BaseFloat *tot_t) const {
+	int32 dim = am_gmm_.Dim();
+	FmllrDiagGmmAccs spk_stats(dim, opts_.fmllr_opts);
+	Accumulate(feats, posts, cur_transform, &spk_stats);
+
+	Matrix<BaseFloat> delta(dim, dim + 1);
+	delta.SetUnit();
+	if (basis_ != NULL) {
+		//gmm-est-basis-fmllr-gpost: the unit transform is kept if the count is below basis-min-count
+		*impr = basis_->ComputeTransform(spk_stats, &delta, NULL, opts_.basis_opts);
+		*tot_t = spk_stats.beta_;
+	}
+	else {
+		spk_stats.Update(opts_.fmllr_opts, &delta, impr, tot_t);
+	}
+	if (cur_transform.NumRows() != 0) {
+		//compose-transforms --b-is-affine=true <new> <current>
+		if (!ComposeTransforms(delta, cur_transform, true, transform))
+			KALDI_ERR << "Error composing the fMLLR transforms.";
+	}
+	else {
+		transform->Swap(&delta);
+	}
+}
+
+void SpeakerFmllrEstimator::ApplyTransform(const Matrix<BaseFloat> &transform, const MatrixBase<BaseFloat> &feats,
+	Matrix<BaseFloat> *out) {
+	int32 transform_rows = transform.NumRows(), transform_cols = transform.NumCols(),
+		feat_dim = feats.NumCols();
+	out->Resize(feats.NumRows(), transform_rows, kUndefined);
+	if (transform_cols == feat_dim) {
+		out->AddMatMat(1.0, feats, kNoTrans, transform, kTrans, 0.0);
+	}
+	else if (transform_cols == feat_dim + 1) {
+		// append the implicit 1.0 to the input features.
+		SubMatrix<BaseFloat> linear_part(transform, 0, transform_rows, 0, feat_dim);
+		out->AddMatMat(1.0, feats, kNoTrans, linear_part, kTrans, 0.0);
+		Vector<BaseFloat> offset(transform_rows);
+		offset.CopyColFromMat(transform, feat_dim);
+		out->AddVecToRows(1.0, offset);
+	}
+	else {
+		KALDI_ERR << "Transform matrix has bad dimension " << transform_rows << " by "
+			<< transform_cols << " versus feat dim " << feat_dim;
+	}
+}
+
+}  // namespace kaldi
@@ -0,0 +1,113 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Kaldi (gmm-est-fmllr.cc, gmm-est-fmllr-gpost.cc, gmm-post-to-gpost.cc, weight-silence-post.cc,
+		   lattice-to-post.cc, lattice-determinize-pruned.cc, compose-transforms.cc, transform-feats.cc)
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "hmm/posterior.h"
+#include "lat/kaldi-lattice.h"
+#include "transform/fmllr-diag-gmm.h"
+#include "transform/basis-fmllr-diag-gmm.h"
+
+/*
+	In memory per speaker fMLLR estimation.
+
+	Replaces the archive pipelines of the SAT training and of the fMLLR decoding:
+		ali-to-post | weight-silence-post | gmm-est-fmllr | compose-transforms
+		lattice-determinize-pruned | lattice-to-post | weight-silence-post | [gmm-post-to-gpost] | gmm-est-fmllr[-gpost]
+	The posteriors are computed from the alignments or lattices of the speaker in memory, the features are
+	transformed with the current transform of the speaker on the fly, the statistics are accumulated per speaker
+	and the new transform is composed with the current one in memory. Only the final transforms (and optionally
+	the features adapted with them) are written. With a basis (see BasisFmllrEstimate, estimated by TrainSat()) the
+	transforms are basis fMLLR transforms (gmm-est-basis-fmllr-gpost), which need much less data per speaker or
+	utterance than full fMLLR. The speakers are independent, the caller runs them in parallel
+	(see GmmEstFmllrSpk()); all methods are const and thread safe.
+*/
+
+namespace kaldi {
+
+struct SpeakerFmllrOptions {
+	FmllrOptions fmllr_opts;
+	BasisFmllrOptions basis_opts;	// only used with a basis
+	BaseFloat silence_weight;		// weight of the silence frames (only if silence_phones is not empty)
+	std::string silence_phones;		// colon separated list of silence phones
+	BaseFloat acoustic_scale;		// for the lattice posteriors
+	BaseFloat determinize_beam;		// if > 0 the lattices are determinized with this beam before computing the posteriors
+
+	SpeakerFmllrOptions() : silence_weight(0.0), acoustic_scale(1.0), determinize_beam(0.0) {}
+
+	void Register(OptionsItf *opts) {
+		fmllr_opts.Register(opts);
+		//NOTE: BasisFmllrOptions::Register() would register fmllr-min-count a second time
+		opts->Register("basis-num-iters", &basis_opts.num_iters, "Number of iterations of the basis fMLLR update");
+		opts->Register("basis-size-scale", &basis_opts.size_scale, "Scale (< 1.0) on the speaker occupancy that "
+			"gives the number of basis elements");
+		opts->Register("basis-min-count", &basis_opts.min_count, "Minimum count required to update the basis fMLLR "
+			"transform");
+		opts->Register("basis-step-size-iters", &basis_opts.step_size_iters, "Number of iterations in computing the "
+			"step size of the basis fMLLR update");
+		opts->Register("silence-weight", &silence_weight, "Weight of the silence frames in the fMLLR statistics");
+		opts->Register("silence-phones", &silence_phones, "Colon separated list of silence phones (e.g. 1:2:3)");
+		opts->Register("acoustic-scale", &acoustic_scale, "Acoustic scale for the lattice posteriors");
+		opts->Register("determinize-beam", &determinize_beam, "If > 0, the lattices are determinized (pruned) "
+			"with this beam before computing the posteriors");
+	}
+};
+
+class SpeakerFmllrEstimator {
+public:
+	// 'am_gmm' is the model the transforms are estimated for. If 'gpost_gmm' is not NULL then the Gaussian
+	// posteriors are computed with it (gmm-post-to-gpost + gmm-est-fmllr-gpost), otherwise with 'am_gmm'.
+	// If 'basis' is not NULL then Estimate() computes basis fMLLR transforms.
+	SpeakerFmllrEstimator(const TransitionModel &trans_model, const AmDiagGmm &am_gmm,
+		const AmDiagGmm *gpost_gmm, const SpeakerFmllrOptions &opts, const BasisFmllrEstimate *basis = NULL);
+
+	int32 Dim() const { return am_gmm_.Dim(); }
+
+	// Silence weighted posteriors from an alignment.
+	void AlignmentToPost(const std::vector<int32> &ali, Posterior *post) const;
+
+	// Silence weighted posteriors from a (state level or compact) lattice. Returns false on error.
+	bool LatticeToPost(const std::string &utt, Lattice *lat, Posterior *post) const;
+
+	// Accumulates the fMLLR statistics of a speaker (features before the current transform, see Estimate()).
+	void Accumulate(const std::vector<const Matrix<BaseFloat>*> &feats, const std::vector<const Posterior*> &posts,
+		const Matrix<BaseFloat> &cur_transform, FmllrDiagGmmAccs *spk_stats) const;
+
+	// Estimates the transform of a speaker from the features (before the current transform) and posteriors of its
+	// utterances. If 'cur_transform' is not empty then the features are transformed with it before the
+	// accumulation and the new transform is composed with it. 'transform' is the resulting (composed) transform.
+	void Estimate(const std::vector<const Matrix<BaseFloat>*> &feats, const std::vector<const Posterior*> &posts,
+		const Matrix<BaseFloat> &cur_transform, Matrix<BaseFloat> *transform,
+		BaseFloat *impr, BaseFloat *tot_t) const;
+
+	// Same as transform-feats: linear (dim x dim) or affine (dim x dim+1) transform.
+	static void ApplyTransform(const Matrix<BaseFloat> &transform, const MatrixBase<BaseFloat> &feats,
+		Matrix<BaseFloat> *out);
+
+private:
+	void AccumulateForUtterance(const MatrixBase<BaseFloat> &feats, const Posterior &post,
+		FmllrDiagGmmAccs *spk_stats) const;
+
+	const TransitionModel &trans_model_;
+	const AmDiagGmm &am_gmm_;
+	const AmDiagGmm *gpost_gmm_;
+	SpeakerFmllrOptions opts_;
+	const BasisFmllrEstimate *basis_;
+	ConstIntegerSet<int32> silence_set_;
+};
+
+}  // namespace kaldi
@@ -26,9 +26,41 @@
 #include "hmm/transition-model.h"
 #include "transform/mllt.h"
 #include "hmm/posterior.h"
+#include "transform/block-accumulators.h"
+
+#include <memory>
+#include <thread>
 
 #include "kaldi-win/src/kaldi_src.h"
 
+namespace kaldi {
+
+//accumulates the utterances j, j+nj, ... of the chunk into the partial accumulator of thread j
+static void GmmAccMlltChunk(const TransitionModel &trans_model, const AmDiagGmm &am_gmm,
+	const std::vector<Matrix<BaseFloat>> &feats, const std::vector<Posterior> &posts, int j, int nj,
+	MlltBlockAccs *mllt_accs, std::vector<BaseFloat> *tot_like, std::vector<BaseFloat> *tot_weight) {
+	for (size_t u = j; u < feats.size(); u += nj) {
+		BaseFloat tot_like_this_file = 0.0, tot_weight_this_file = 0.0;
+		Posterior pdf_posterior;
+		ConvertPosteriorToPdfs(trans_model, posts[u], &pdf_posterior);
+		for (size_t i = 0; i < pdf_posterior.size(); i++) {
+			for (size_t k = 0; k < pdf_posterior[i].size(); k++) {
+				int32 pdf_id = pdf_posterior[i][k].first;
+				BaseFloat weight = pdf_posterior[i][k].second;
+
+				tot_like_this_file += mllt_accs->AccumulateFromGmm(am_gmm.GetPdf(pdf_id),
+					feats[u].Row(i),
+					weight) * weight;
+				tot_weight_this_file += weight;
+			}
+		}
+		(*tot_like)[u] = tot_like_this_file;
+		(*tot_weight)[u] = tot_weight_this_file;
+	}
+}
+
+}  // namespace kaldi
+
 /*
 	GmmAccMllt : Accumulate MLLT (global STC) statistics
 */
@@ -44,9 +76,13 @@ int GmmAccMllt(int argc, char *argv[], fs::ofstream & file_log) {
 		ParseOptions po(usage);
 		bool binary = true;
 		BaseFloat rand_prune = 0.25;
+		int32 num_threads = 1, block_size = 256;
 		po.Register("binary", &binary, "Write output in binary mode");
 		po.Register("rand-prune", &rand_prune, "Randomized pruning parameter to speed up "
 			"accumulation (larger -> more pruning.  May exceed one).");
+		po.Register("num-threads", &num_threads, "Number of threads accumulating the statistics "
+			"(each thread has its own partial accumulator).");
+		po.Register("block-size", &block_size, "Number of Gaussian offsets gathered for one rank-k update of the statistics.");
 		po.Read(argc, argv);
 
 		if (po.NumArgs() != 4) {
@@ -75,6 +111,19 @@ int GmmAccMllt(int argc, char *argv[], fs::ofstream & file_log) {
 
 		MlltAccs mllt_accs(am_gmm.Dim(), rand_prune);
 
+		//VB: the statistics are accumulated in blocks with rank-k updates (MlltBlockAccs) by num_threads threads,
+		//    each with its own partial accumulator; the utterances are read in chunks by this thread.
+		num_threads = std::max(1, num_threads);
+		std::vector<MlltAccs> partial_accs(num_threads - 1, MlltAccs(am_gmm.Dim(), rand_prune));
+		std::vector<std::unique_ptr<MlltBlockAccs>> block_accs;
+		block_accs.emplace_back(new MlltBlockAccs(&mllt_accs, block_size));
+		for (int j = 1; j < num_threads; j++)
+			block_accs.emplace_back(new MlltBlockAccs(&partial_accs[j - 1], block_size));
+		const size_t chunk_size = 16 * num_threads;
+		std::vector<Matrix<BaseFloat>> chunk_feats;
+		std::vector<Posterior> chunk_posts;
+		std::vector<BaseFloat> chunk_like, chunk_weight;
+
 		double tot_like = 0.0;
 		double tot_t = 0.0;
 
@@ -82,37 +131,23 @@ int GmmAccMllt(int argc, char *argv[], fs::ofstream & file_log) {
 		RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
 
 		int32 num_done = 0, num_no_posterior = 0, num_other_error = 0;
-		for (; !feature_reader.Done(); feature_reader.Next()) {
-			std::string key = feature_reader.Key();
-			if (!posteriors_reader.HasKey(key)) {
-				num_no_posterior++;
-			}
+		auto accumulate_chunk = [&]() {
+			chunk_like.resize(chunk_feats.size());
+			chunk_weight.resize(chunk_feats.size());
+			if (num_threads == 1) GmmAccMlltChunk(trans_model, am_gmm, chunk_feats, chunk_posts, 0, 1,
+				block_accs[0].get(), &chunk_like, &chunk_weight);
 			else {
-				const Matrix<BaseFloat> &mat = feature_reader.Value();
-				const Posterior &posterior = posteriors_reader.Value(key);
-
-				if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
-					KALDI_WARN << "Posterior vector has wrong size " << (posterior.size()) << " vs. " << (mat.NumRows());
-					num_other_error++;
-					continue;
-				}
-
+				std::vector<std::thread> _threads;
+				for (int j = 0; j < num_threads; j++)
+					_threads.emplace_back(kaldi::GmmAccMlltChunk, std::cref(trans_model), std::cref(am_gmm),
+						std::cref(chunk_feats), std::cref(chunk_posts), j, num_threads,
+						block_accs[j].get(), &chunk_like, &chunk_weight);
+				for (auto& t : _threads) t.join();
+			}
+			//log in input order
+			for (size_t u = 0; u < chunk_feats.size(); u++) {
+				BaseFloat tot_like_this_file = chunk_like[u], tot_weight = chunk_weight[u];
 				num_done++;
-				BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
-
-				Posterior pdf_posterior;
-				ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-				for (size_t i = 0; i < posterior.size(); i++) {
-					for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-						int32 pdf_id = pdf_posterior[i][j].first;
-						BaseFloat weight = pdf_posterior[i][j].second;
-
-						tot_like_this_file += mllt_accs.AccumulateFromGmm(am_gmm.GetPdf(pdf_id),
-							mat.Row(i),
-							weight) * weight;
-						tot_weight += weight;
-					}
-				}
 				if(file_log)
 					file_log << "Average like for this file is "
 					<< (tot_like_this_file / tot_weight) << " over "
@@ -131,7 +166,35 @@ int GmmAccMllt(int argc, char *argv[], fs::ofstream & file_log) {
 					else KALDI_LOG << "Avg like per frame so far is " << (tot_like / tot_t);
 				}
 			}
+			chunk_feats.clear();
+			chunk_posts.clear();
+		};
+		for (; !feature_reader.Done(); feature_reader.Next()) {
+			std::string key = feature_reader.Key();
+			if (!posteriors_reader.HasKey(key)) {
+				num_no_posterior++;
+			}
+			else {
+				const Matrix<BaseFloat> &mat = feature_reader.Value();
+				const Posterior &posterior = posteriors_reader.Value(key);
+
+				if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
+					KALDI_WARN << "Posterior vector has wrong size " << (posterior.size()) << " vs. " << (mat.NumRows());
+					num_other_error++;
+					continue;
+				}
+
+				chunk_feats.push_back(mat);
+				chunk_posts.push_back(posterior);
+				if (chunk_feats.size() == chunk_size) accumulate_chunk();
+			}
 		}
+		accumulate_chunk();
+		//sum the partial accumulators
+		for (int j = 0; j < num_threads; j++)
+			block_accs[j]->Flush();
+		for (int j = 1; j < num_threads; j++)
+			AddMlltAccs(partial_accs[j - 1], &mllt_accs);
 
 		if (file_log) {
 			file_log << "Done " << num_done << " files, " << num_no_posterior
@@ -17,7 +17,9 @@ Based on :  Copyright 2009-2013  Microsoft Corporation, Apache 2.0
 #include "hmm/hmm-utils.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/decoder-wrappers.h"
+#include "decoder/linear-graph-aligner.h"
 #include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/am-diag-gmm-packed.h"
 #include "lat/kaldi-lattice.h" // for {Compact}LatticeArc
 
 #include "kaldi-win/src/kaldi_src.h"
@@ -46,8 +48,13 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
     BaseFloat transition_scale = 1.0;
     BaseFloat self_loop_scale = 1.0;
     std::string per_frame_acwt_wspecifier;
+    bool use_linear_aligner = true;
+    std::string gmm_precision = "float";
 
     align_config.Register(&po);
+    po.Register("linear-aligner", &use_linear_aligner,
+                "Align left-to-right graphs (HMM chains with optional silence) with the banded "
+                "trellis aligner; other graphs are aligned with the generic decoder");
     po.Register("transition-scale", &transition_scale,
                 "Transition-probability scale [relative to acoustics]");
     po.Register("acoustic-scale", &acoustic_scale,
@@ -57,6 +64,10 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
     po.Register("write-per-frame-acoustic-loglikes", &per_frame_acwt_wspecifier,
                 "Wspecifier for table of vectors containing the acoustic log-likelihoods "
                 "per frame for each utterance. E.g. ark:foo/per_frame_logprobs.1.ark");
+    po.Register("gmm-precision", &gmm_precision,
+                "Precision of the GMM parameters in the likelihood computation of the generic "
+                "aligner: float, float16 or int8 (see gmm/am-diag-gmm-packed.h); the linear "
+                "aligner always uses float");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 5) {
@@ -80,6 +91,17 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    //VB: reduced-precision copy of the model for the generic aligner (--gmm-precision)
+    std::unique_ptr<AmDiagGmmPacked> packed_gmm;
+    if (gmm_precision != "float") {
+      AmDiagGmmPackedType packed_type;
+      if (!GetAmDiagGmmPackedType(gmm_precision, &packed_type)) {
+        KALDI_ERR << "Invalid --gmm-precision=" << gmm_precision;
+        return -1;
+      }
+      packed_gmm.reset(new AmDiagGmmPacked());
+      packed_gmm->Init(am_gmm, packed_type);
+    }
 
     SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_rspecifier);
     RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -87,6 +109,8 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
     BaseFloatWriter scores_writer(scores_wspecifier);
     BaseFloatVectorWriter per_frame_acwt_writer(per_frame_acwt_wspecifier);
 
+    LinearGraphAligner linear_aligner(trans_model, am_gmm);
+    int32 num_linear = 0;
     int num_done = 0, num_err = 0, num_retry = 0;
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
@@ -116,14 +140,27 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
                              &decode_fst);
         }
 
-        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                               acoustic_scale);
-
 		if (file_log)
 			file_log << utt;
 		else
         KALDI_LOG << utt;
 
+        //VB: left-to-right graphs with the trellis aligner, the others with the generic decoder
+        int32 num_done_before = num_done;
+        if (use_linear_aligner &&
+            LinearAlignUtteranceWrapper(align_config, utt,
+                                        acoustic_scale, decode_fst, features, &linear_aligner,
+                                        &alignment_writer, &scores_writer,
+                                        &num_done, &num_err, &num_retry,
+                                        &tot_like, &frame_count, &per_frame_acwt_writer)) {
+          if (num_done > num_done_before) num_linear++;  // not the failed ones
+          continue;
+        }
+
+        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
+                                               acoustic_scale);
+        gmm_decodable.SetPackedModel(packed_gmm.get());
+
         AlignUtteranceWrapper(align_config, utt,
                               acoustic_scale, &decode_fst, &gmm_decodable,
                               &alignment_writer, &scores_writer,
@@ -133,11 +170,13 @@ int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log) {
     }
 	if (file_log) {
 		file_log << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over " << frame_count << " frames." << "\n";
+		file_log << "Aligned " << num_linear << " utterances with the linear graph aligner." << "\n";
 		file_log << "Retried " << num_retry << " out of " << (num_done + num_err) << " utterances." << "\n";
 		file_log << "Done " << num_done << ", errors on " << num_err << "\n";
 	}
 	else {
 		KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over " << frame_count << " frames.";
+		KALDI_LOG << "Aligned " << num_linear << " utterances with the linear graph aligner.";
 		KALDI_LOG << "Retried " << num_retry << " out of " << (num_done + num_err) << " utterances.";
 		KALDI_LOG << "Done " << num_done << ", errors on " << num_err;
 	}
@@ -0,0 +1,226 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on :  Copyright 2009-2011  Microsoft Corporation, Apache 2.0
+			See ../../COPYING for clarification regarding multiple authors
+*/
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "hmm/hmm-utils.h"
+#include "fstext/fstext-utils.h"
+#include "decoder/decoder-wrappers.h"
+#include "decoder/training-graph-compiler.h"
+#include "decoder/linear-graph-aligner.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/am-diag-gmm-packed.h"
+#include "lat/kaldi-lattice.h" // for {Compact}LatticeArc
+
+#include "kaldi-win/src/kaldi_src.h"
+#include "train-graph-cache.h"
+
+//VB: the training graphs are compiled on demand in batches and kept in 'graph_cache' (CompactFst format, byte
+//	  budget) so that they can be reused in the next alignment passes of the same training run (the caller keeps
+//	  one cache per job). If graph_cache is NULL a local cache is used for this call only.
+//	  The graphs are compiled without transition probs, the probs of the current model are added as in
+//	  gmm-align-compiled (--transition-scale, --self-loop-scale).
+int GmmAlign(int argc, char *argv[], fs::ofstream & file_log, kaldi::TrainGraphCache * graph_cache) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    using fst::SymbolTable;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Align features given [GMM-based] models.\n"
+        "Usage:   gmm-align [options] tree-in model-in lexicon-fst-in feature-rspecifier "
+        "transcriptions-rspecifier alignments-wspecifier\n"
+        "e.g.: \n"
+        " gmm-align tree 1.mdl lex.fst scp:train.scp "
+        "'ark:sym2int.pl -f 2- words.txt text|' ark:1.ali\n";
+    ParseOptions po(usage);
+    AlignConfig align_config;
+    BaseFloat acoustic_scale = 1.0;
+    BaseFloat transition_scale = 1.0;
+    BaseFloat self_loop_scale = 1.0;
+    std::string disambig_rxfilename;
+    int32 batch_size = 250;
+    int32 cache_mb = 256;
+    bool use_linear_aligner = true;
+    std::string gmm_precision = "float";
+
+    align_config.Register(&po);
+    po.Register("linear-aligner", &use_linear_aligner,
+                "Align left-to-right graphs (HMM chains with optional silence) with the banded "
+                "trellis aligner; other graphs are aligned with the generic decoder");
+    po.Register("transition-scale", &transition_scale,
+                "Transition-probability scale [relative to acoustics]");
+    po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
+    po.Register("self-loop-scale", &self_loop_scale,
+                "Scale of self-loop versus non-self-loop log probs [relative to acoustics]");
+    po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
+                "list of disambiguation symbols in phone symbol table");
+    po.Register("batch-size", &batch_size,
+                "Number of FSTs to compile at a time (more -> faster but uses "
+                "more memory.  E.g. 500");
+    po.Register("graph-cache-mb", &cache_mb,
+                "Memory budget of the training graph cache in MB (only used if no "
+                "cache is passed by the caller)");
+    po.Register("gmm-precision", &gmm_precision,
+                "Precision of the GMM parameters in the likelihood computation of the generic "
+                "aligner: float, float16 or int8 (see gmm/am-diag-gmm-packed.h); the linear "
+                "aligner always uses float");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 6 || batch_size < 1) {
+		//po.PrintUsage();
+		//exit(1);
+		KALDI_ERR << "Wrong arguments.";
+		return -1;
+    }
+
+    std::string tree_in_filename = po.GetArg(1);
+    std::string model_in_filename = po.GetArg(2);
+    std::string lex_in_filename = po.GetArg(3);
+    std::string feature_rspecifier = po.GetArg(4);
+    std::string transcript_rspecifier = po.GetArg(5);
+    std::string alignment_wspecifier = po.GetArg(6);
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      Input ki(model_in_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+    //VB: reduced-precision copy of the model for the generic aligner (--gmm-precision)
+    std::unique_ptr<AmDiagGmmPacked> packed_gmm;
+    if (gmm_precision != "float") {
+      AmDiagGmmPackedType packed_type;
+      if (!GetAmDiagGmmPackedType(gmm_precision, &packed_type)) {
+        KALDI_ERR << "Invalid --gmm-precision=" << gmm_precision;
+        return -1;
+      }
+      packed_gmm.reset(new AmDiagGmmPacked());
+      packed_gmm->Init(am_gmm, packed_type);
+    }
+
+    std::unique_ptr<TrainGraphCache> local_cache;
+    if (graph_cache == NULL) {
+      local_cache.reset(new TrainGraphCache(static_cast<size_t>(cache_mb) * 1024 * 1024));
+      graph_cache = local_cache.get();
+    }
+    if (!graph_cache->Initialized())
+      graph_cache->Init(tree_in_filename, model_in_filename, lex_in_filename, disambig_rxfilename);
+    int64 num_compiled_before = graph_cache->NumCompiled();
+
+    SequentialInt32VectorReader transcript_reader(transcript_rspecifier);
+    RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    Int32VectorWriter alignment_writer(alignment_wspecifier);
+
+    LinearGraphAligner linear_aligner(trans_model, am_gmm);
+    int32 num_linear = 0;
+    int32 num_done = 0, num_err = 0, num_retry = 0;
+    double tot_like = 0.0;
+    kaldi::int64 frame_count = 0;
+
+    std::vector<std::string> keys;
+    std::vector<std::vector<int32> > transcripts;
+    std::vector<std::shared_ptr<const TrainGraphCache::Graph> > graphs;
+    while (!transcript_reader.Done()) {
+      keys.clear();
+      transcripts.clear();
+      for (; !transcript_reader.Done() &&
+             static_cast<int32>(transcripts.size()) < batch_size;
+           transcript_reader.Next()) {
+        keys.push_back(transcript_reader.Key());
+        transcripts.push_back(transcript_reader.Value());
+      }
+      if (!graph_cache->GetGraphs(keys, transcripts, &graphs)) {
+        KALDI_ERR << "Not expecting CompileGraphs to fail.";
+        return -1; //VB
+      }
+
+      for (size_t i = 0; i < keys.size(); i++) {
+        const std::string &utt = keys[i];
+        if (graphs[i] == NULL) {
+          KALDI_WARN << "Problem creating decoding graph for utterance "
+                     << utt << " [serious error]";
+          num_err++;
+          continue;
+        }
+        if (!feature_reader.HasKey(utt)) {
+          KALDI_WARN << "No features for utterance " << utt;
+          num_err++;
+          continue;
+        }
+        const Matrix<BaseFloat> &features = feature_reader.Value(utt);
+        if (features.NumRows() == 0) {
+          KALDI_WARN << "Zero-length features for utterance: " << utt;
+          num_err++;
+          continue;
+        }
+
+        VectorFst<StdArc> decode_fst;
+        TrainGraphCache::ExpandGraph(*graphs[i], &decode_fst);
+
+        {  // Add transition-probs to the FST.
+          std::vector<int32> disambig_syms;  // empty.
+          AddTransitionProbs(trans_model, disambig_syms,
+                             transition_scale, self_loop_scale,
+                             &decode_fst);
+        }
+
+        //VB: left-to-right graphs with the trellis aligner, the others with the generic decoder
+        int32 num_done_before = num_done;
+        if (use_linear_aligner &&
+            LinearAlignUtteranceWrapper(align_config, utt,
+                                        acoustic_scale, decode_fst, features, &linear_aligner,
+                                        &alignment_writer, NULL,
+                                        &num_done, &num_err, &num_retry,
+                                        &tot_like, &frame_count)) {
+          if (num_done > num_done_before) num_linear++;  // not the failed ones
+          continue;
+        }
+
+        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
+                                               acoustic_scale);
+        gmm_decodable.SetPackedModel(packed_gmm.get());
+
+        AlignUtteranceWrapper(align_config, utt,
+                              acoustic_scale, &decode_fst, &gmm_decodable,
+                              &alignment_writer, NULL,
+                              &num_done, &num_err, &num_retry,
+                              &tot_like, &frame_count);
+      }
+    }
+	if (file_log) {
+		file_log << "Compiled " << (graph_cache->NumCompiled() - num_compiled_before) << " training graphs, graph cache size "
+			<< graph_cache->CacheSize() << " bytes (limit " << graph_cache->CacheLimit() << ")." << "\n";
+		file_log << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over " << frame_count << " frames." << "\n";
+		file_log << "Aligned " << num_linear << " utterances with the linear graph aligner." << "\n";
+		file_log << "Retried " << num_retry << " out of " << (num_done + num_err) << " utterances." << "\n";
+		file_log << "Done " << num_done << ", errors on " << num_err << "\n";
+	}
+	else {
+		KALDI_LOG << "Compiled " << (graph_cache->NumCompiled() - num_compiled_before) << " training graphs, graph cache size "
+			<< graph_cache->CacheSize() << " bytes (limit " << graph_cache->CacheLimit() << ").";
+		KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over " << frame_count << " frames.";
+		KALDI_LOG << "Aligned " << num_linear << " utterances with the linear graph aligner.";
+		KALDI_LOG << "Retried " << num_retry << " out of " << (num_done + num_err) << " utterances.";
+		KALDI_LOG << "Done " << num_done << ", errors on " << num_err;
+	}
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    KALDI_ERR << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,193 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2012  Carnegie Mellon University (author: Yajie Miao)
+		   Copyright 2014  Guoguo Chen
+		   See ../../COPYING for clarification regarding multiple authors
+*/
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "transform/basis-fmllr-diag-gmm.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+#include "fmllr-speaker-estimator.h"
+
+namespace kaldi {
+
+// One speaker: the fMLLR statistics are accumulated in operator() in a worker thread; the destructor adds the
+// gradient scatter of the speaker to the basis statistics (called in the order of the speakers).
+class SpeakerBasisAccsTask {
+public:
+	SpeakerBasisAccsTask(const SpeakerFmllrEstimator &estimator, BasisFmllrAccus *basis_accs,
+		int32 *num_done, int32 *num_other_error)
+		: estimator_(estimator), basis_accs_(basis_accs), num_done_(num_done), num_other_error_(num_other_error),
+		spk_stats_(estimator.Dim()), utt_done_(0), utt_other_error_(0) {}
+
+	void AddUtterance(const std::string &utt, const Matrix<BaseFloat> &feats, const std::vector<int32> &ali) {
+		utts_.push_back(utt);
+		feats_.push_back(feats);
+		alis_.push_back(ali);
+	}
+
+	void operator() () {
+		std::vector<Posterior> posts(utts_.size());
+		std::vector<const Matrix<BaseFloat>*> feats;
+		std::vector<const Posterior*> post_ptrs;
+		for (size_t i = 0; i < utts_.size(); i++) {
+			estimator_.AlignmentToPost(alis_[i], &posts[i]);
+			if (static_cast<int32>(posts[i].size()) != feats_[i].NumRows()) {
+				KALDI_WARN << "Posterior vector has wrong size " << (posts[i].size())
+					<< " vs. " << (feats_[i].NumRows()) << " for utterance " << utts_[i];
+				utt_other_error_++;
+				continue;
+			}
+			feats.push_back(&feats_[i]);
+			post_ptrs.push_back(&posts[i]);
+			utt_done_++;
+		}
+		estimator_.Accumulate(feats, post_ptrs, Matrix<BaseFloat>(), &spk_stats_);
+		feats_.clear();
+		alis_.clear();
+	}
+
+	~SpeakerBasisAccsTask() {
+		if (utt_done_ > 0)
+			basis_accs_->AccuGradientScatter(spk_stats_);
+		*num_done_ += utt_done_;
+		*num_other_error_ += utt_other_error_;
+	}
+
+private:
+	const SpeakerFmllrEstimator &estimator_;
+	BasisFmllrAccus *basis_accs_;
+	int32 *num_done_, *num_other_error_;
+
+	std::vector<std::string> utts_;
+	std::vector<Matrix<BaseFloat> > feats_;
+	std::vector<std::vector<int32> > alis_;
+
+	FmllrDiagGmmAccs spk_stats_;
+	int32 utt_done_, utt_other_error_;
+};
+
+}  // namespace kaldi
+
+/*
+	GmmBasisFmllrAccsSpk : Accumulate the gradient scatter of the fMLLR basis per speaker from alignments.
+
+	//VB: replaces ali-to-post | weight-silence-post | gmm-basis-fmllr-accs --spk2utt (steps/get_fmllr_basis.sh);
+	//	  the posteriors and the fMLLR statistics of the speakers are computed in memory and in parallel
+	//	  (--num-threads) with SpeakerFmllrEstimator. The statistics are summed by GmmBasisFmllrTraining().
+*/
+int GmmBasisFmllrAccsSpk(int argc, char *argv[], fs::ofstream & file_log) {
+	try {
+		typedef kaldi::int32 int32;
+		using namespace kaldi;
+		const char *usage =
+			"Accumulate the gradient scatter of the fMLLR basis from the training set per speaker. The posteriors\n"
+			"are computed from alignments with silence weighting. The features are the speaker independent ones.\n"
+			"Usage: gmm-basis-fmllr-accs-spk [options] <model-in> <feature-rspecifier> "
+			"<alignments-rspecifier> <accs-wxfilename>\n"
+			"e.g.: gmm-basis-fmllr-accs-spk --spk2utt=ark:spk2utt --silence-phones=1:2:3 \\\n"
+			"  final.mdl ark:sifeats.ark ark:ali.1 basis.1.acc\n";
+
+		ParseOptions po(usage);
+		SpeakerFmllrOptions spk_opts;
+		TaskSequencerConfig sequencer_config;
+		std::string spk2utt_rspecifier;
+		bool binary_write = true;
+		po.Register("binary", &binary_write, "Write output in binary mode");
+		po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to utterance-list map");
+		spk_opts.Register(&po);
+		sequencer_config.Register(&po);
+
+		po.Read(argc, argv);
+
+		if (po.NumArgs() != 4 || spk2utt_rspecifier == "") {
+			//po.PrintUsage();
+			//exit(1);
+			KALDI_ERR << "Wrong arguments.";
+			return -1;
+		}
+
+		std::string
+			model_rxfilename = po.GetArg(1),
+			feature_rspecifier = po.GetArg(2),
+			alignments_rspecifier = po.GetArg(3),
+			accs_wxfilename = po.GetArg(4);
+
+		TransitionModel trans_model;
+		AmDiagGmm am_gmm;
+		{
+			bool binary;
+			Input ki(model_rxfilename, &binary);
+			trans_model.Read(ki.Stream(), binary);
+			am_gmm.Read(ki.Stream(), binary);
+		}
+		SpeakerFmllrEstimator estimator(trans_model, am_gmm, NULL, spk_opts);
+
+		SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+		RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+		RandomAccessInt32VectorReader alignment_reader(alignments_rspecifier);
+
+		BasisFmllrAccus basis_accs(am_gmm.Dim());
+		int32 num_spk = 0, num_done = 0, num_no_ali = 0, num_no_feats = 0, num_other_error = 0;
+		{
+			TaskSequencer<SpeakerBasisAccsTask> sequencer(sequencer_config);
+			for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+				const std::vector<std::string> &uttlist = spk2utt_reader.Value();
+				SpeakerBasisAccsTask *task = new SpeakerBasisAccsTask(estimator, &basis_accs, &num_done,
+					&num_other_error);
+				for (size_t i = 0; i < uttlist.size(); i++) {
+					const std::string &utt = uttlist[i];
+					if (!feature_reader.HasKey(utt)) {
+						KALDI_WARN << "Did not find features for utterance " << utt;
+						num_no_feats++;
+						continue;
+					}
+					if (!alignment_reader.HasKey(utt)) {
+						KALDI_WARN << "Did not find alignment for utterance " << utt;
+						num_no_ali++;
+						continue;
+					}
+					task->AddUtterance(utt, feature_reader.Value(utt), alignment_reader.Value(utt));
+				}
+				sequencer.Run(task);
+				num_spk++;
+			}
+			sequencer.Wait();
+		}
+
+		{
+			Output ko(accs_wxfilename, binary_write);
+			basis_accs.Write(ko.Stream(), binary_write);
+		}
+
+		if (file_log) {
+			file_log << "Accumulated the gradient scatter of " << num_spk << " speakers to " << accs_wxfilename << "\n";
+			file_log << "Done " << num_done << " files, " << num_no_ali << " with no alignments, "
+				<< num_no_feats << " with no features, " << num_other_error << " with other errors." << "\n";
+		}
+		else {
+			KALDI_LOG << "Accumulated the gradient scatter of " << num_spk << " speakers to " << accs_wxfilename;
+			KALDI_LOG << "Done " << num_done << " files, " << num_no_ali << " with no alignments, "
+				<< num_no_feats << " with no features, " << num_other_error << " with other errors.";
+		}
+		return (num_done != 0 ? 0 : 1);
+	}
+	catch (const std::exception &e) {
+		KALDI_ERR << e.what();
+		return -1;
+	}
+}
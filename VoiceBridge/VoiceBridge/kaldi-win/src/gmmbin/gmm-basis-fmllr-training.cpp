@@ -0,0 +1,104 @@
+/*
+	Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+	Based on :
+*/
+// Copyright 2012  Carnegie Mellon University (author: Yajie Miao)
+// See ../../COPYING for clarification regarding multiple authors
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+using std::string;
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "transform/fmllr-diag-gmm.h"
+#include "transform/basis-fmllr-diag-gmm.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+
+/*
+	GmmBasisFmllrTraining : Estimate fMLLR basis representation from the summed gradient scatter accumulations.
+*/
+int GmmBasisFmllrTraining(int argc, char *argv[], fs::ofstream & file_log) {
+	try {
+		typedef kaldi::int32 int32;
+		using namespace kaldi;
+		const char *usage =
+			"Estimate fMLLR basis representation. Reads a set of gradient scatter\n"
+			"accumulations. Outputs basis matrices.\n"
+			"Usage: gmm-basis-fmllr-training [options] <model-in> <basis-wspecifier>"
+			"<accs-in1> <accs-in2> ...\n";
+
+		bool binary_write = true;
+		ParseOptions po(usage);
+		po.Register("binary", &binary_write, "Write output in binary mode");
+
+		po.Read(argc, argv);
+		if (po.NumArgs() < 3) {
+			//po.PrintUsage();
+			//exit(1);
+			KALDI_ERR << "Wrong arguments.";
+			return -1;
+		}
+
+		string
+			model_rxfilename = po.GetArg(1),
+			basis_wspecifier = po.GetArg(2);
+
+		TransitionModel trans_model;
+		AmDiagGmm am_gmm;
+		{
+			bool binary;
+			Input ki(model_rxfilename, &binary);
+			trans_model.Read(ki.Stream(), binary);
+			am_gmm.Read(ki.Stream(), binary);
+		}
+
+		BasisFmllrAccus basis_accs(am_gmm.Dim());
+		int num_accs = po.NumArgs() - 2;
+
+		for (int i = 3, max = po.NumArgs(); i <= max; ++i) {
+			std::string accs_in_filename = po.GetArg(i);
+			bool binary_read;
+			kaldi::Input ki(accs_in_filename, &binary_read);
+			basis_accs.Read(ki.Stream(), binary_read, true /* add read values*/);
+		}
+
+		// Estimate the basis matrices
+		BasisFmllrEstimate basis_est(am_gmm.Dim());
+		basis_est.EstimateFmllrBasis(am_gmm, basis_accs);
+		WriteKaldiObject(basis_est, basis_wspecifier, binary_write);
+
+		if (file_log) {
+			file_log << "Summed " << num_accs << " gradient scatter stats" << "\n";
+			file_log << "Generate " << basis_est.BasisSize() << " bases, written to "
+				<< basis_wspecifier << "\n";
+		}
+		else {
+			KALDI_LOG << "Summed " << num_accs << " gradient scatter stats";
+			KALDI_LOG << "Generate " << basis_est.BasisSize() << " bases, written to "
+				<< basis_wspecifier;
+		}
+		return 0;
+	}
+	catch (const std::exception& e) {
+		KALDI_ERR << e.what();
+		return -1;
+	}
+}
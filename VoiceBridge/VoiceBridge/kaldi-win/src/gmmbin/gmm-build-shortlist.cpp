@@ -0,0 +1,87 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-shortlist.h"
+#include "hmm/transition-model.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+
+/*
+	GmmBuildShortlist : builds the Gaussian shortlist of a GMM model (see gmm/am-diag-gmm-shortlist.h).
+	The Gaussians of the model are clustered into a small diagonal GMM and at decoding time only the
+	Gaussians of the best clusters of each frame are evaluated (--gselect-shortlist option of
+	gmm-latgen-faster and gmm-rescore-lattice).
+*/
+int GmmBuildShortlist(int argc, char *argv[], fs::ofstream & file_log) {
+	try {
+		using namespace kaldi;
+		typedef kaldi::int32 int32;
+
+		const char *usage =
+			"Builds the Gaussian shortlist of a GMM model for Gaussian selection in decoding\n"
+			"Usage:  gmm-build-shortlist [options] <model-in> <state-occs-in> <shortlist-out>\n"
+			"e.g.:\n"
+			" gmm-build-shortlist --num-clusters=256 final.mdl final.occs final.gsl\n";
+
+		bool binary_write = true;
+		AmDiagGmmShortlistOptions opts;
+
+		ParseOptions po(usage);
+		po.Register("binary", &binary_write, "Write output in binary mode");
+		opts.Register(&po);
+
+		po.Read(argc, argv);
+
+		if (po.NumArgs() != 3) {
+			//po.PrintUsage();
+			//exit(1);
+			KALDI_ERR << "Wrong arguments.";
+			return -1;
+		}
+
+		std::string model_in_filename = po.GetArg(1),
+			occs_in_filename = po.GetArg(2),
+			shortlist_out_filename = po.GetArg(3);
+
+		AmDiagGmm am_gmm;
+		TransitionModel trans_model;
+		{
+			bool binary_read;
+			Input ki(model_in_filename, &binary_read);
+			trans_model.Read(ki.Stream(), binary_read);
+			am_gmm.Read(ki.Stream(), binary_read);
+		}
+
+		Vector<BaseFloat> occs;
+		ReadKaldiObject(occs_in_filename, &occs);
+		if (occs.Dim() != am_gmm.NumPdfs()) {
+			KALDI_ERR << "Dimension of state occupancies " << occs.Dim()
+				<< " does not match num-pdfs " << am_gmm.NumPdfs();
+			return -1; //VB
+		}
+
+		AmDiagGmmShortlist shortlist;
+		shortlist.Init(am_gmm, occs, opts);
+		WriteKaldiObject(shortlist, shortlist_out_filename, binary_write);
+
+		if (file_log)
+			file_log << "Written Gaussian shortlist with " << shortlist.NumClusters()
+			<< " clusters to " << shortlist_out_filename << "\n";
+		else KALDI_LOG << "Written Gaussian shortlist with " << shortlist.NumClusters()
+			<< " clusters to " << shortlist_out_filename;
+
+		return 0;
+	}
+	catch (const std::exception &e) {
+		KALDI_ERR << e.what() << '\n';
+		return -1;
+	}
+}
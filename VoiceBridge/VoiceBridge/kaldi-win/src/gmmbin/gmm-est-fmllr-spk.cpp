@@ -0,0 +1,304 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2009-2011  Microsoft Corporation, Apache 2.0
+		   Copyright 2013  Johns Hopkins University (author: Daniel Povey)
+		   See ../../COPYING for clarification regarding multiple authors
+*/
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+#include "fmllr-speaker-estimator.h"
+
+namespace kaldi {
+
+// One speaker: the posteriors are computed, the transform is estimated (and the features are adapted) in
+// operator() in a worker thread; the destructor writes the outputs (called in the order of the speakers).
+class SpeakerFmllrTask {
+public:
+	struct Totals {
+		double tot_impr, tot_t;
+		int32 num_done, num_other_error;
+		Totals() : tot_impr(0.0), tot_t(0.0), num_done(0), num_other_error(0) {}
+	};
+
+	SpeakerFmllrTask(const SpeakerFmllrEstimator &estimator, const std::string &spk,
+		const Matrix<BaseFloat> &cur_transform, BaseFloatMatrixWriter *transform_writer,
+		BaseFloatMatrixWriter *feats_writer, Totals *totals)
+		: estimator_(estimator), spk_(spk), cur_transform_(cur_transform), transform_writer_(transform_writer),
+		feats_writer_(feats_writer), totals_(totals), impr_(0.0), tot_t_(0.0), num_done_(0), num_other_error_(0) {}
+
+	void AddUtterance(const std::string &utt, const Matrix<BaseFloat> &feats, const std::vector<int32> *ali,
+		const Lattice *lat) {
+		utts_.push_back(utt);
+		feats_.push_back(feats);
+		alis_.resize(utts_.size());
+		lats_.resize(utts_.size());
+		if (ali != NULL) alis_.back() = *ali;
+		if (lat != NULL) lats_.back() = *lat;
+		use_lattices_ = (lat != NULL);
+	}
+
+	void operator() () {
+		std::vector<Posterior> posts(utts_.size());
+		std::vector<const Matrix<BaseFloat>*> feats;
+		std::vector<const Posterior*> post_ptrs;
+		for (size_t i = 0; i < utts_.size(); i++) {
+			if (use_lattices_) {
+				bool ok = estimator_.LatticeToPost(utts_[i], &lats_[i], &posts[i]);
+				lats_[i].DeleteStates();
+				if (!ok) {
+					num_other_error_++;
+					continue;
+				}
+			}
+			else {
+				estimator_.AlignmentToPost(alis_[i], &posts[i]);
+			}
+			if (static_cast<int32>(posts[i].size()) != feats_[i].NumRows()) {
+				KALDI_WARN << "Posterior vector has wrong size " << (posts[i].size())
+					<< " vs. " << (feats_[i].NumRows()) << " for utterance " << utts_[i];
+				num_other_error_++;
+				continue;
+			}
+			feats.push_back(&feats_[i]);
+			post_ptrs.push_back(&posts[i]);
+			num_done_++;
+		}
+		estimator_.Estimate(feats, post_ptrs, cur_transform_, &transform_, &impr_, &tot_t_);
+
+		if (feats_writer_ != NULL) {
+			//the adapted features for the next pass
+			Matrix<BaseFloat> adapted;
+			for (size_t i = 0; i < feats_.size(); i++) {
+				SpeakerFmllrEstimator::ApplyTransform(transform_, feats_[i], &adapted);
+				feats_[i].Swap(&adapted);
+			}
+		}
+		else {
+			feats_.clear();
+		}
+	}
+
+	~SpeakerFmllrTask() {
+		transform_writer_->Write(spk_, transform_);
+		if (feats_writer_ != NULL)
+			for (size_t i = 0; i < feats_.size(); i++)
+				feats_writer_->Write(utts_[i], feats_[i]);
+		//NOTE: runs in a worker thread; KALDI_LOG goes to the log sink of the job, which serializes the messages
+		KALDI_LOG << "For speaker " << spk_ << ", auxf-impr from fMLLR is "
+			<< (tot_t_ != 0.0 ? impr_ / tot_t_ : 0.0) << ", over " << tot_t_ << " frames.";
+		totals_->tot_impr += impr_;
+		totals_->tot_t += tot_t_;
+		totals_->num_done += num_done_;
+		totals_->num_other_error += num_other_error_;
+	}
+
+private:
+	const SpeakerFmllrEstimator &estimator_;
+	std::string spk_;
+	Matrix<BaseFloat> cur_transform_;
+	BaseFloatMatrixWriter *transform_writer_;
+	BaseFloatMatrixWriter *feats_writer_;
+	Totals *totals_;
+
+	std::vector<std::string> utts_;
+	std::vector<Matrix<BaseFloat> > feats_;
+	std::vector<std::vector<int32> > alis_;
+	std::vector<Lattice> lats_;
+	bool use_lattices_ = false;
+
+	Matrix<BaseFloat> transform_;
+	BaseFloat impr_, tot_t_;
+	int32 num_done_, num_other_error_;
+};
+
+}  // namespace kaldi
+
+/*
+	GmmEstFmllrSpk : Estimate per speaker fMLLR transforms in memory from alignments or lattices.
+
+	//VB: replaces the archive pipelines (ali-to-post | weight-silence-post | gmm-est-fmllr | compose-transforms) and
+	//	  (lattice-determinize-pruned | lattice-to-post | weight-silence-post | gmm-post-to-gpost | gmm-est-fmllr-gpost)
+	//	  of TrainSat() and DecodeFmllr(). The speakers are estimated in parallel (--num-threads) with a TaskSequencer
+	//	  so that the outputs are written in the input order. See fmllr-speaker-estimator.h.
+	//	  With --basis it replaces gmm-est-basis-fmllr[-gpost] (DecodeBasisFmllr()); with --per-utt the transforms
+	//	  are estimated per utterance (keyed by the utterance id) instead of per speaker.
+*/
+int GmmEstFmllrSpk(int argc, char *argv[], fs::ofstream & file_log) {
+	try {
+		typedef kaldi::int32 int32;
+		using namespace kaldi;
+		const char *usage =
+			"Estimate per speaker fMLLR transforms in memory. The posteriors are computed from alignments\n"
+			"(or lattices with --lattice-input) with silence weighting; the features are transformed on the fly\n"
+			"with the current transforms (--transforms-in) and the new transforms are composed with them.\n"
+			"Usage: gmm-est-fmllr-spk [options] <model-in> <feature-rspecifier> "
+			"<alignments-or-lattice-rspecifier> <transform-wspecifier>\n"
+			"e.g.: gmm-est-fmllr-spk --spk2utt=ark:spk2utt --silence-phones=1:2:3 --transforms-in=ark:trans.1 \\\n"
+			"  4.mdl ark:sifeats.ark ark:ali.1 ark:trans.1\n"
+			"or, with an fMLLR basis and per utterance transforms:\n"
+			" gmm-est-fmllr-spk --spk2utt=ark:spk2utt --basis=fmllr.basis --per-utt=true --lattice-input=true \\\n"
+			"  final.mdl ark:sifeats.ark ark:lat.1 ark:trans.1\n";
+
+		ParseOptions po(usage);
+		SpeakerFmllrOptions spk_opts;
+		TaskSequencerConfig sequencer_config;
+		std::string spk2utt_rspecifier, transforms_rspecifier, feats_wspecifier, gpost_model_rxfilename,
+			basis_rxfilename;
+		bool lattice_input = false, per_utt = false;
+		po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to utterance-list map");
+		po.Register("transforms-in", &transforms_rspecifier, "rspecifier of the current transforms per speaker "
+			"(the features are transformed with them and the estimated transforms are composed with them)");
+		po.Register("adapted-feats-out", &feats_wspecifier, "If set, the features adapted with the estimated "
+			"transforms are written to this wspecifier");
+		po.Register("gpost-model", &gpost_model_rxfilename, "If set, the Gaussian posteriors are computed with "
+			"this model (e.g. the speaker independent alignment model) as in gmm-post-to-gpost");
+		po.Register("lattice-input", &lattice_input, "If true, the third argument is a lattice rspecifier");
+		po.Register("basis", &basis_rxfilename, "If set, basis fMLLR transforms are estimated with this basis "
+			"(see gmm-basis-fmllr-training)");
+		po.Register("per-utt", &per_utt, "If true, the transforms are estimated per utterance (the utterances of "
+			"the speakers in --spk2utt) and written with the utterance ids as keys");
+		spk_opts.Register(&po);
+		sequencer_config.Register(&po);
+
+		po.Read(argc, argv);
+
+		if (po.NumArgs() != 4 || spk2utt_rspecifier == "") {
+			//po.PrintUsage();
+			//exit(1);
+			KALDI_ERR << "Wrong arguments.";
+			return -1;
+		}
+
+		std::string
+			model_rxfilename = po.GetArg(1),
+			feature_rspecifier = po.GetArg(2),
+			post_rspecifier = po.GetArg(3),
+			trans_wspecifier = po.GetArg(4);
+
+		TransitionModel trans_model;
+		AmDiagGmm am_gmm;
+		{
+			bool binary;
+			Input ki(model_rxfilename, &binary);
+			trans_model.Read(ki.Stream(), binary);
+			am_gmm.Read(ki.Stream(), binary);
+		}
+		AmDiagGmm gpost_gmm;
+		if (gpost_model_rxfilename != "") {
+			TransitionModel gpost_trans_model;
+			bool binary;
+			Input ki(gpost_model_rxfilename, &binary);
+			gpost_trans_model.Read(ki.Stream(), binary);
+			gpost_gmm.Read(ki.Stream(), binary);
+		}
+		BasisFmllrEstimate basis;
+		if (basis_rxfilename != "")
+			ReadKaldiObject(basis_rxfilename, &basis);
+		SpeakerFmllrEstimator estimator(trans_model, am_gmm,
+			(gpost_model_rxfilename != "" ? &gpost_gmm : NULL), spk_opts,
+			(basis_rxfilename != "" ? &basis : NULL));
+
+		//NOTE: the current transforms are read in completely before opening the writers because the output may be
+		//		the same archive (e.g. dir/trans.JOBID in TrainSat)
+		std::unordered_map<std::string, Matrix<BaseFloat> > cur_transforms;
+		if (transforms_rspecifier != "") {
+			SequentialBaseFloatMatrixReader transform_reader(transforms_rspecifier);
+			for (; !transform_reader.Done(); transform_reader.Next())
+				cur_transforms[transform_reader.Key()] = transform_reader.Value();
+		}
+
+		SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+		RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+		RandomAccessInt32VectorReader alignment_reader(lattice_input ? "" : post_rspecifier);
+		RandomAccessLatticeReader lattice_reader(lattice_input ? post_rspecifier : "");
+
+		BaseFloatMatrixWriter transform_writer(trans_wspecifier);
+		BaseFloatMatrixWriter feats_writer(feats_wspecifier);
+
+		SpeakerFmllrTask::Totals totals;
+		int32 num_no_post = 0, num_no_feats = 0, num_no_transform = 0;
+		const Matrix<BaseFloat> empty_transform;
+		{
+			TaskSequencer<SpeakerFmllrTask> sequencer(sequencer_config);
+			for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+				const std::vector<std::string> &spk_uttlist = spk2utt_reader.Value();
+				//one task per speaker, or per utterance with --per-utt
+				size_t num_tasks = (per_utt ? spk_uttlist.size() : 1);
+				for (size_t n = 0; n < num_tasks; n++) {
+					std::string spk = (per_utt ? spk_uttlist[n] : spk2utt_reader.Key());
+					std::vector<std::string> uttlist;
+					if (per_utt) uttlist.push_back(spk);
+					else uttlist = spk_uttlist;
+
+					const Matrix<BaseFloat> *cur_transform = &empty_transform;
+					if (transforms_rspecifier != "") {
+						auto it = cur_transforms.find(spk);
+						if (it != cur_transforms.end()) cur_transform = &it->second;
+						else {
+							KALDI_WARN << "No current transform for " << (per_utt ? "utterance " : "speaker ") << spk;
+							num_no_transform++;
+						}
+					}
+
+					SpeakerFmllrTask *task = new SpeakerFmllrTask(estimator, spk, *cur_transform, &transform_writer,
+						(feats_writer.IsOpen() ? &feats_writer : NULL), &totals);
+					for (size_t i = 0; i < uttlist.size(); i++) {
+						const std::string &utt = uttlist[i];
+						if (!feature_reader.HasKey(utt)) {
+							KALDI_WARN << "Did not find features for utterance " << utt;
+							num_no_feats++;
+							continue;
+						}
+						if (lattice_input ? !lattice_reader.HasKey(utt) : !alignment_reader.HasKey(utt)) {
+							KALDI_WARN << "Did not find posteriors for utterance " << utt;
+							num_no_post++;
+							continue;
+						}
+						if (lattice_input)
+							task->AddUtterance(utt, feature_reader.Value(utt), NULL, &lattice_reader.Value(utt));
+						else
+							task->AddUtterance(utt, feature_reader.Value(utt), &alignment_reader.Value(utt), NULL);
+					}
+					sequencer.Run(task);
+				}
+			}
+			sequencer.Wait();
+		}
+
+		if (file_log) {
+			file_log << "Overall fMLLR auxf impr per frame is "
+				<< (totals.tot_t != 0.0 ? totals.tot_impr / totals.tot_t : 0.0) << " over " << totals.tot_t << " frames." << "\n";
+			file_log << "Done " << totals.num_done << " files, " << num_no_post << " with no posts, "
+				<< num_no_feats << " with no features, " << totals.num_other_error << " with other errors; "
+				<< num_no_transform << " speakers without current transform." << "\n";
+		}
+		else {
+			KALDI_LOG << "Overall fMLLR auxf impr per frame is "
+				<< (totals.tot_t != 0.0 ? totals.tot_impr / totals.tot_t : 0.0) << " over " << totals.tot_t << " frames.";
+			KALDI_LOG << "Done " << totals.num_done << " files, " << num_no_post << " with no posts, "
+				<< num_no_feats << " with no features, " << totals.num_other_error << " with other errors; "
+				<< num_no_transform << " speakers without current transform.";
+		}
+		return (totals.num_done != 0 ? 0 : 1);
+	}
+	catch (const std::exception &e) {
+		KALDI_ERR << e.what();
+		return -1;
+	}
+}
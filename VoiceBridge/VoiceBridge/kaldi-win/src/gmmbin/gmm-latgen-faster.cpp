@@ -19,11 +19,142 @@ Based on :   Copyright 2009-2012  Microsoft Corporation, Apache 2.0
 #include "fstext/fstext-lib.h"
 #include "decoder/decoder-wrappers.h"
 #include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/am-diag-gmm-shortlist.h"
+#include "gmm/am-diag-gmm-packed.h"
 #include "base/timer.h"
 #include "feat/feature-functions.h"  // feature reversal
+#include "util/kaldi-thread.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "fstext/lookahead-compose.h"
 
 #include "kaldi-win/src/kaldi_src.h"
 
+namespace kaldi {
+
+// Pipelined decoding (--det-threads > 0): the beam search runs on the job thread and only produces the best
+// path and the raw lattice (SearchUtterance()); the lattice is handed to a LatticeDeterminizeTask which is run
+// by a TaskSequencer. operator() determinizes the lattice in a worker thread while the next utterance is
+// searched; the destructor writes the outputs in the order of the utterances. The TaskSequencer blocks the
+// search when --det-queue-size lattices are waiting (backpressure on the raw lattice memory).
+// The output is the same as with DecodeUtteranceLatticeFaster().
+
+// The search part of DecodeUtteranceLatticeFaster(); returns false if no output should be produced.
+static bool SearchUtterance(LatticeFasterDecoder &decoder, DecodableInterface &decodable,
+                            const std::string &utt, bool allow_partial,
+                            std::vector<int32> *alignment, std::vector<int32> *words,
+                            LatticeWeight *weight, Lattice *lat) {
+  if (!decoder.Decode(&decodable)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    return false;
+  }
+  if (!decoder.ReachedFinal()) {
+    if (allow_partial) {
+      KALDI_WARN << "Outputting partial output for utterance " << utt
+                 << " since no final-state reached\n";
+    } else {
+      KALDI_WARN << "Not producing output for utterance " << utt
+                 << " since no final-state reached and "
+                 << "--allow-partial=false.\n";
+      return false;
+    }
+  }
+  fst::VectorFst<LatticeArc> decoded;
+  if (!decoder.GetBestPath(&decoded))
+    KALDI_ERR << "Failed to get traceback for utterance " << utt;
+  GetLinearSymbolSequence(decoded, alignment, words, weight);
+
+  decoder.GetRawLattice(lat);
+  if (lat->NumStates() == 0)
+    KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
+  fst::Connect(lat);
+  return true;
+}
+
+class LatticeDeterminizeTask {
+ public:
+  // Takes the alignment, words and raw lattice (swapped).
+  LatticeDeterminizeTask(const TransitionModel &trans_model, const fst::SymbolTable *word_syms,
+                         const std::string &utt, double acoustic_scale, bool determinize,
+                         BaseFloat lattice_beam,
+                         const fst::DeterminizeLatticePhonePrunedOptions &det_opts,
+                         std::vector<int32> *alignment, std::vector<int32> *words,
+                         const LatticeWeight &weight, Lattice *lat,
+                         Int32VectorWriter *alignment_writer, Int32VectorWriter *words_writer,
+                         CompactLatticeWriter *compact_lattice_writer, LatticeWriter *lattice_writer):
+      trans_model_(trans_model), word_syms_(word_syms), utt_(utt),
+      acoustic_scale_(acoustic_scale), determinize_(determinize),
+      lattice_beam_(lattice_beam), det_opts_(det_opts), weight_(weight),
+      alignment_writer_(alignment_writer), words_writer_(words_writer),
+      compact_lattice_writer_(compact_lattice_writer), lattice_writer_(lattice_writer) {
+    alignment_.swap(*alignment);
+    words_.swap(*words);
+    lat_ = *lat;  // shares the implementation, which is released by the caller
+    lat->DeleteStates();
+  }
+
+  void operator () () {
+    if (determinize_) {
+      if (!DeterminizeLatticePhonePrunedWrapper(
+              trans_model_, &lat_, lattice_beam_, &clat_, det_opts_))
+        KALDI_WARN << "Determinization finished earlier than the beam for "
+                   << "utterance " << utt_;
+      lat_.DeleteStates();
+      // We'll write the lattice without acoustic scaling.
+      if (acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_), &clat_);
+    } else {
+      if (acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_), &lat_);
+    }
+  }
+
+  ~LatticeDeterminizeTask() {
+    if (words_writer_->IsOpen())
+      words_writer_->Write(utt_, words_);
+    if (alignment_writer_->IsOpen())
+      alignment_writer_->Write(utt_, alignment_);
+    if (word_syms_ != NULL) {
+      std::cerr << utt_ << ' ';
+      for (size_t i = 0; i < words_.size(); i++) {
+        std::string s = word_syms_->Find(words_[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << words_[i] << " not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n';
+    }
+    if (determinize_)
+      compact_lattice_writer_->Write(utt_, clat_);
+    else
+      lattice_writer_->Write(utt_, lat_);
+    int32 num_frames = alignment_.size();
+    double likelihood = -(weight_.Value1() + weight_.Value2());
+    KALDI_LOG << "Log-like per frame for utterance " << utt_ << " is "
+              << (likelihood / num_frames) << " over "
+              << num_frames << " frames.";
+    KALDI_VLOG(2) << "Cost for utterance " << utt_ << " is "
+                  << weight_.Value1() << " + " << weight_.Value2();
+  }
+
+ private:
+  const TransitionModel &trans_model_;
+  const fst::SymbolTable *word_syms_;
+  std::string utt_;
+  double acoustic_scale_;
+  bool determinize_;
+  BaseFloat lattice_beam_;
+  fst::DeterminizeLatticePhonePrunedOptions det_opts_;
+  std::vector<int32> alignment_, words_;
+  LatticeWeight weight_;
+  Lattice lat_;
+  CompactLattice clat_;
+  Int32VectorWriter *alignment_writer_, *words_writer_;
+  CompactLatticeWriter *compact_lattice_writer_;
+  LatticeWriter *lattice_writer_;
+};
+
+}  // namespace kaldi
+
 int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
   try {
     using namespace kaldi;
@@ -43,6 +174,15 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
     LatticeFasterDecoderConfig config;
 
     std::string word_syms_filename;
+    //VB: dynamic decoding graph (see MkGraphLookahead())
+    std::string lookahead_g_rxfilename;
+    int32 lookahead_cache_mb = 512;
+    //VB: pipelined decoding, the lattices are determinized and written by separate threads
+    int32 det_threads = 0, det_queue_size = 4;
+    //VB: Gaussian selection (see GmmBuildShortlist())
+    std::string gselect_shortlist_rxfilename;
+    int32 gselect_top_clusters = 0;
+    std::string gmm_precision = "float";
     config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
@@ -50,6 +190,31 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("lookahead-g", &lookahead_g_rxfilename,
+                "If set, fst-in is an olabel_lookahead HCL (HCLr.fst) and this is the "
+                "relabeled G (Gr.fst); they are composed on the fly during decoding.");
+    po.Register("lookahead-cache-mb", &lookahead_cache_mb,
+                "Memory limit (MB) for the cached states of the on the fly composition "
+                "(least recently used states are dropped). The composition is started "
+                "again between utterances when its state table grows beyond this size.");
+    po.Register("det-threads", &det_threads,
+                "If > 0, the lattices are determinized by this many threads while the "
+                "next utterances are decoded (the output is the same; 0 = determinize "
+                "after each utterance on the decoding thread).");
+    po.Register("det-queue-size", &det_queue_size,
+                "Maximum number of raw lattices waiting for determinization or to be "
+                "written with --det-threads > 0; the decoding waits when it is reached.");
+    po.Register("gselect-shortlist", &gselect_shortlist_rxfilename,
+                "If set, the Gaussian shortlist of the model (e.g. final.gsl, see "
+                "gmm-build-shortlist); only the Gaussians of the best clusters are "
+                "evaluated in each frame.");
+    po.Register("gselect-top-clusters", &gselect_top_clusters,
+                "Number of clusters selected per frame with --gselect-shortlist "
+                "(0 = the number stored in the shortlist).");
+    po.Register("gmm-precision", &gmm_precision,
+                "Precision of the GMM parameters in the likelihood computation: float, "
+                "float16 or int8 (see gmm/am-diag-gmm-packed.h for the accuracy); cannot "
+                "be combined with --gselect-shortlist.");
 
     po.Read(argc, argv);
 
@@ -75,6 +240,35 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    AmDiagGmmShortlist *shortlist = NULL;
+    if (gselect_shortlist_rxfilename != "") {
+      shortlist = new AmDiagGmmShortlist();
+      ReadKaldiObject(gselect_shortlist_rxfilename, shortlist);
+      if (!shortlist->IsCompatible(am_gmm)) {
+        KALDI_ERR << "Gaussian shortlist " << gselect_shortlist_rxfilename
+                  << " does not match the model " << model_in_filename;
+        delete shortlist;
+        return -1;
+      }
+      shortlist->Prepare(am_gmm);
+      if (gselect_top_clusters > 0)
+        shortlist->SetNumTopClusters(gselect_top_clusters);
+    }
+    //VB: reduced-precision copy of the model (--gmm-precision)
+    AmDiagGmmPacked *packed_gmm = NULL;
+    std::string precision_error;
+    if (!CheckGmmPrecision(gmm_precision, shortlist != NULL, &precision_error)) {
+      delete shortlist;
+      KALDI_ERR << precision_error;
+      return -1;
+    }
+    if (gmm_precision != "float") {
+      AmDiagGmmPackedType packed_type;
+      GetAmDiagGmmPackedType(gmm_precision, &packed_type);
+      packed_gmm = new AmDiagGmmPacked();
+      packed_gmm->Init(am_gmm, packed_type);
+    }
+    kaldi::int64 num_gauss_evaluated = 0, num_gauss_total = 0;
 
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -98,12 +292,58 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
 		}
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
+    //VB: statistics of the latency-bounded mode (--target-rtf, --target-active)
+    LatticeFasterDecoderAdaptStats adapt_stats;
     int num_done = 0, num_err = 0;
 
+    TaskSequencerConfig sequencer_config;
+    sequencer_config.num_threads = std::max(1, det_threads);
+    sequencer_config.num_threads_total = sequencer_config.num_threads + std::max(0, det_queue_size);
+    TaskSequencer<LatticeDeterminizeTask> sequencer(sequencer_config);
+    // Decodes one utterance; the determinization and the output go to the sequencer with --det-threads > 0.
+    auto decode_utterance = [&](LatticeFasterDecoder &decoder, DecodableInterface &decodable,
+                                const std::string &utt, double *like) -> bool {
+      if (det_threads <= 0)
+        return DecodeUtteranceLatticeFaster(
+            decoder, decodable, trans_model, word_syms, utt,
+            acoustic_scale, determinize, allow_partial, &alignment_writer,
+            &words_writer, &compact_lattice_writer, &lattice_writer, like);
+      std::vector<int32> alignment, words;
+      LatticeWeight weight;
+      Lattice lat;
+      if (!SearchUtterance(decoder, decodable, utt, allow_partial,
+                           &alignment, &words, &weight, &lat))
+        return false;
+      *like = -(weight.Value1() + weight.Value2());
+      sequencer.Run(new LatticeDeterminizeTask(
+          trans_model, word_syms, utt, acoustic_scale, determinize,
+          decoder.GetOptions().lattice_beam, decoder.GetOptions().det_opts,
+          &alignment, &words, weight, &lat, &alignment_writer, &words_writer,
+          &compact_lattice_writer, &lattice_writer));
+      return true;
+    };
+
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      Fst<StdArc> *decode_fst = NULL;
+      //VB: HCL and G composed on the fly
+      fst::StdOLabelLookAheadFst *hcl_fst = NULL;
+      Fst<StdArc> *g_fst = NULL;
+      fst::StdLookaheadComposeFst *lookahead_fst = NULL;
+      if (lookahead_g_rxfilename != "") {
+        hcl_fst = fst::StdOLabelLookAheadFst::Read(fst_in_str);
+        if (hcl_fst == NULL) {
+          KALDI_ERR << "Could not read olabel_lookahead FST from " << fst_in_str;
+          return -1;
+        }
+        g_fst = fst::ReadFstKaldiGeneric(lookahead_g_rxfilename);
+        lookahead_fst = fst::LookaheadComposeFst(*hcl_fst, *g_fst,
+                            static_cast<size_t>(lookahead_cache_mb) * 1024 * 1024);
+        decode_fst = lookahead_fst;
+      } else {
+        decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      }
       timer.Reset();
 
       {
@@ -121,20 +361,26 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
 
           DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                  acoustic_scale);
+          gmm_decodable.SetShortlist(shortlist);
+          gmm_decodable.SetPackedModel(packed_gmm);
 
           double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, gmm_decodable, trans_model, word_syms, utt,
-                  acoustic_scale, determinize, allow_partial, &alignment_writer,
-                  &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &like)) {
+          if (decode_utterance(decoder, gmm_decodable, utt, &like)) {
             tot_like += like;
             frame_count += features.NumRows();
             num_done++;
           } else num_err++;
+          num_gauss_evaluated += gmm_decodable.NumGaussEvaluated();
+          num_gauss_total += gmm_decodable.NumGaussTotal();
+          // the compose state table is not limited by the cache.
+          if (lookahead_fst != NULL) lookahead_fst->ResetIfLarge();
         }
+        adapt_stats.Add(decoder.AdaptStats());
       }
+      sequencer.Wait();  // the pending lattices are part of the timing
       delete decode_fst; // delete this only after decoder goes out of scope.
+      delete g_fst;
+      delete hcl_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -156,17 +402,19 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
         DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                acoustic_scale);
+        gmm_decodable.SetShortlist(shortlist);
+        gmm_decodable.SetPackedModel(packed_gmm);
         double like;
-        if (DecodeUtteranceLatticeFaster(
-                decoder, gmm_decodable, trans_model, word_syms, utt,
-                acoustic_scale, determinize, allow_partial, &alignment_writer,
-                &words_writer, &compact_lattice_writer, &lattice_writer,
-                &like)) {
+        if (decode_utterance(decoder, gmm_decodable, utt, &like)) {
           tot_like += like;
           frame_count += features.NumRows();
           num_done++;
         } else num_err++;
+        num_gauss_evaluated += gmm_decodable.NumGaussEvaluated();
+        num_gauss_total += gmm_decodable.NumGaussTotal();
+        adapt_stats.Add(decoder.AdaptStats());
       }
+      sequencer.Wait();
     }
 
     double elapsed = timer.Elapsed();
@@ -178,6 +426,14 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
 					<< num_err;
 		file_log << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over "
 					<< frame_count << " frames.";
+		if (config.Adaptive()) {
+			adapt_stats.Print(file_log);
+			file_log << "\n";
+		}
+		if (shortlist != NULL)
+			file_log << "Gaussian selection evaluated " << num_gauss_evaluated << " of "
+				<< num_gauss_total << " Gaussians ("
+				<< (100.0 * num_gauss_evaluated / std::max<kaldi::int64>(num_gauss_total, 1)) << "%).\n";
 	}
 	else {
 		KALDI_LOG << "Time taken " << elapsed
@@ -187,8 +443,19 @@ int GmmLatgenFaster(int argc, char *argv[], fs::ofstream & file_log) {
 					<< num_err;
 		KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like / frame_count) << " over "
 					<< frame_count << " frames.";
+		if (config.Adaptive()) {
+			std::ostringstream os;
+			adapt_stats.Print(os);
+			KALDI_LOG << os.str();
+		}
+		if (shortlist != NULL)
+			KALDI_LOG << "Gaussian selection evaluated " << num_gauss_evaluated << " of "
+				<< num_gauss_total << " Gaussians ("
+				<< (100.0 * num_gauss_evaluated / std::max<kaldi::int64>(num_gauss_total, 1)) << "%).";
 	}
     delete word_syms;
+    delete shortlist;
+    delete packed_gmm;
     if (num_done != 0) return 0;
     else return 1;
   } catch(const std::exception &e) {
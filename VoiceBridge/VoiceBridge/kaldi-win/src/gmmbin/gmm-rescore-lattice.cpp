@@ -30,6 +30,7 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
 #include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/am-diag-gmm-shortlist.h"
 
 #include "kaldi-win/src/kaldi_src.h"
 
@@ -52,10 +53,19 @@ int GmmRescoreLattice(int argc, char *argv[], fs::ofstream & file_log) {
 			" e.g.: gmm-rescore-lattice 1.mdl ark:1.lats scp:trn.scp ark:2.lats\n";
 
 		kaldi::BaseFloat old_acoustic_scale = 0.0;
+		//VB: Gaussian selection (see GmmBuildShortlist())
+		std::string gselect_shortlist_rxfilename;
+		int32 gselect_top_clusters = 0;
 		kaldi::ParseOptions po(usage);
 		po.Register("old-acoustic-scale", &old_acoustic_scale,
 			"Add in the scores in the input lattices with this scale, rather "
 			"than discarding them.");
+		po.Register("gselect-shortlist", &gselect_shortlist_rxfilename,
+			"If set, the Gaussian shortlist of the model (e.g. final.gsl); only the "
+			"Gaussians of the best clusters are evaluated in each frame.");
+		po.Register("gselect-top-clusters", &gselect_top_clusters,
+			"Number of clusters selected per frame with --gselect-shortlist "
+			"(0 = the number stored in the shortlist).");
 		po.Read(argc, argv);
 
 		if (po.NumArgs() != 4) {
@@ -78,6 +88,20 @@ int GmmRescoreLattice(int argc, char *argv[], fs::ofstream & file_log) {
 			trans_model.Read(ki.Stream(), binary);
 			am_gmm.Read(ki.Stream(), binary);
 		}
+		AmDiagGmmShortlist shortlist;
+		bool use_shortlist = (gselect_shortlist_rxfilename != "");
+		if (use_shortlist) {
+			ReadKaldiObject(gselect_shortlist_rxfilename, &shortlist);
+			if (!shortlist.IsCompatible(am_gmm)) {
+				KALDI_ERR << "Gaussian shortlist " << gselect_shortlist_rxfilename
+					<< " does not match the model " << model_filename;
+				return -1;
+			}
+			shortlist.Prepare(am_gmm);
+			if (gselect_top_clusters > 0)
+				shortlist.SetNumTopClusters(gselect_top_clusters);
+		}
+		int64 num_gauss_evaluated = 0, num_gauss_total = 0;
 
 		RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
 		// Read as regular lattice
@@ -103,12 +127,15 @@ int GmmRescoreLattice(int argc, char *argv[], fs::ofstream & file_log) {
 			const Matrix<BaseFloat> &feats = feature_reader.Value(key);
 
 			DecodableAmDiagGmm gmm_decodable(am_gmm, trans_model, feats);
+			if (use_shortlist) gmm_decodable.SetShortlist(&shortlist);
 			if (kaldi::RescoreCompactLattice(&gmm_decodable, &clat)) {
 				compact_lattice_writer.Write(key, clat);
 				num_done++;
 				num_frames += feats.NumRows();
 			}
 			else num_err++;
+			num_gauss_evaluated += gmm_decodable.NumGaussEvaluated();
+			num_gauss_total += gmm_decodable.NumGaussTotal();
 		}
 
 		if (file_log)
@@ -117,6 +144,14 @@ int GmmRescoreLattice(int argc, char *argv[], fs::ofstream & file_log) {
 		else 
 			KALDI_LOG << "Done " << num_done << " lattices with errors on "
 			<< num_err << ", #frames is " << num_frames;
+		if (use_shortlist) {
+			if (file_log)
+				file_log << "Gaussian selection evaluated " << num_gauss_evaluated << " of "
+				<< num_gauss_total << " Gaussians.\n";
+			else
+				KALDI_LOG << "Gaussian selection evaluated " << num_gauss_evaluated << " of "
+				<< num_gauss_total << " Gaussians.";
+		}
 		return (num_done != 0 ? 0 : 1);
 	}
 	catch (const std::exception &e) {
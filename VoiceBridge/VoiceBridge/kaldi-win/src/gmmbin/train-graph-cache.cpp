@@ -0,0 +1,161 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : openfst (compact-fst.h), Kaldi (compile-train-graphs.cc, gmm-align.cc)
+*/
+
+#include "util/common-utils.h"
+#include "fstext/fstext-lib.h"
+
+#include "train-graph-cache.h"
+
+namespace kaldi {
+
+TrainGraphCache::TrainGraphCache(size_t cache_limit_bytes)
+	: gc_(NULL), cache_limit_(cache_limit_bytes), cache_size_(0), num_hits_(0), num_compiled_(0) {}
+
+TrainGraphCache::~TrainGraphCache() {
+	Clear();
+	delete gc_;
+}
+
+void TrainGraphCache::Init(const std::string &tree_rxfilename, const std::string &model_rxfilename,
+	const std::string &lex_rxfilename, const std::string &disambig_rxfilename) {
+	KALDI_ASSERT(gc_ == NULL);
+	ReadKaldiObject(tree_rxfilename, &ctx_dep_);
+	ReadKaldiObject(model_rxfilename, &trans_model_);
+
+	// need VectorFst because the compiler will change it by adding subseq symbol.
+	fst::VectorFst<fst::StdArc> *lex_fst = fst::ReadFstKaldi(lex_rxfilename);
+
+	std::vector<int32> disambig_syms;
+	if (disambig_rxfilename != "")
+		if (!ReadIntegerVectorSimple(disambig_rxfilename, &disambig_syms)) {
+			delete lex_fst;
+			KALDI_ERR << "Could not read disambiguation symbols from " << disambig_rxfilename;
+		}
+
+	//NOTE: the transition probs are added by the aligner at each pass (they change with the model)
+	TrainingGraphCompilerOptions gopts;
+	gopts.transition_scale = 0.0;
+	gopts.self_loop_scale = 0.0;
+	gc_ = new TrainingGraphCompiler(trans_model_, ctx_dep_, lex_fst, disambig_syms, gopts); //takes ownership of lex_fst
+}
+
+bool TrainGraphCache::GetGraphs(const std::vector<std::string> &keys,
+	const std::vector<std::vector<int32> > &transcripts,
+	std::vector<std::shared_ptr<const Graph> > *graphs) {
+	KALDI_ASSERT(gc_ != NULL && keys.size() == transcripts.size());
+	graphs->clear();
+	graphs->resize(keys.size());
+
+	//collect the missing graphs
+	std::vector<size_t> missing;
+	std::vector<std::vector<int32> > missing_transcripts;
+	for (size_t i = 0; i < keys.size(); i++) {
+		auto it = graphs_.find(keys[i]);
+		if (it != graphs_.end()) {
+			(*graphs)[i] = it->second.graph;
+			Touch(&it->second);
+			num_hits_++;
+		}
+		else {
+			missing.push_back(i);
+			missing_transcripts.push_back(transcripts[i]);
+		}
+	}
+	if (missing.empty()) return true;
+
+	std::vector<fst::VectorFst<fst::StdArc>*> fsts;
+	if (!gc_->CompileGraphsFromText(missing_transcripts, &fsts)) {
+		DeletePointers(&fsts);
+		return false;
+	}
+	KALDI_ASSERT(fsts.size() == missing.size());
+	for (size_t j = 0; j < fsts.size(); j++) {
+		size_t i = missing[j];
+		std::shared_ptr<const Graph> graph;
+		size_t bytes = 0;
+		if (fsts[j]->Start() != fst::kNoStateId) {
+			graph = std::make_shared<const Graph>(*fsts[j]);
+			bytes = GraphBytes(*fsts[j]);
+		}
+		num_compiled_++;
+		(*graphs)[i] = graph;
+		//NOTE: failed graphs are also remembered (NULL) so that they are not recompiled at each pass
+		Insert(keys[i], graph, bytes);
+	}
+	DeletePointers(&fsts);
+	Evict();
+	return true;
+}
+
+void TrainGraphCache::ExpandGraph(const Graph &graph, fst::VectorFst<fst::StdArc> *ofst) {
+	typedef fst::StdArc::StateId StateId;
+	ofst->DeleteStates();
+	StateId num_states = graph.NumStates();
+	ofst->ReserveStates(num_states);
+	for (StateId s = 0; s < num_states; s++) ofst->AddState();
+	//NOTE: the CompactFst iterators read the compact elements directly and never fill the cache of the FST
+	for (fst::StateIterator<Graph> siter(graph); !siter.Done(); siter.Next()) {
+		StateId s = siter.Value();
+		ofst->SetFinal(s, graph.Final(s));
+		ofst->ReserveArcs(s, graph.NumArcs(s));
+		for (fst::ArcIterator<Graph> aiter(graph, s); !aiter.Done(); aiter.Next())
+			ofst->AddArc(s, aiter.Value());
+	}
+	ofst->SetStart(graph.Start());
+}
+
+void TrainGraphCache::Clear() {
+	graphs_.clear();
+	lru_.clear();
+	cache_size_ = 0;
+}
+
+void TrainGraphCache::Insert(const std::string &key, std::shared_ptr<const Graph> graph, size_t bytes) {
+	bytes += sizeof(Entry) + key.size();
+	lru_.push_front(key);
+	Entry &entry = graphs_[key];
+	entry.graph = graph;
+	entry.bytes = bytes;
+	entry.lru_pos = lru_.begin();
+	cache_size_ += bytes;
+}
+
+void TrainGraphCache::Touch(Entry *entry) {
+	lru_.splice(lru_.begin(), lru_, entry->lru_pos);
+	entry->lru_pos = lru_.begin();
+}
+
+void TrainGraphCache::Evict() {
+	if (cache_size_ <= cache_limit_) return;
+	size_t num_evicted = 0;
+	while (cache_size_ > cache_limit_ && !lru_.empty()) {
+		auto it = graphs_.find(lru_.back());
+		cache_size_ -= it->second.bytes;
+		graphs_.erase(it);
+		lru_.pop_back();
+		num_evicted++;
+	}
+	KALDI_VLOG(1) << "TrainGraphCache: evicted " << num_evicted << " graphs, cache size = "
+		<< cache_size_ << ", cache limit = " << cache_limit_;
+}
+
+// Size of the compact representation: one offset per state and one element per arc and final state.
+size_t TrainGraphCache::GraphBytes(const fst::VectorFst<fst::StdArc> &fst) {
+	typedef fst::StdArc::StateId StateId;
+	size_t num_elements = 0;
+	for (StateId s = 0; s < fst.NumStates(); s++) {
+		num_elements += fst.NumArcs(s);
+		if (fst.Final(s) != fst::StdArc::Weight::Zero()) num_elements++;
+	}
+	return sizeof(Graph) + (fst.NumStates() + 1) * sizeof(uint32) +
+		num_elements * sizeof(fst::TrainGraphCompactor<fst::StdArc>::Element);
+}
+
+}  // namespace kaldi
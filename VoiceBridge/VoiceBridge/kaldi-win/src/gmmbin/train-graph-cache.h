@@ -0,0 +1,146 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : openfst (compact-fst.h), Kaldi (compile-train-graphs.cc, gmm-align.cc)
+*/
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "tree/context-dep.h"
+#include "hmm/transition-model.h"
+#include "decoder/training-graph-compiler.h"
+#include <fst/compact-fst.h>
+
+/*
+	Cache of compiled training graphs for the aligner (see GmmAlign()).
+
+	Instead of compiling all training graphs up front into fsts.JOBID archives (CompileTrainGraphs()), the graphs
+	are compiled on demand in batches (TrainingGraphCompiler::CompileGraphsFromText) when the aligner first needs
+	them, and are kept in memory in CompactFst format for the next alignment passes of the same training run.
+	The graphs are compiled without transition probabilities (transition-scale and self-loop-scale 0), the probs
+	are added at each pass from the current model, therefore a cached graph stays valid as long as the tree and
+	the lexicon do not change.
+
+	The cache has a byte budget; when it is exceeded the least recently used graphs are dropped (they are
+	recompiled if they are needed again). One cache per job, it is not thread safe.
+*/
+
+namespace fst {
+
+// ArcCompactor for weighted transducers (training graphs). Each arc is stored in one flat element (no per state
+// allocations as in VectorFst), the final weights are stored as an element with kNoLabel.
+template <class A>
+class TrainGraphCompactor {
+public:
+	using Arc = A;
+	using Label = typename Arc::Label;
+	using StateId = typename Arc::StateId;
+	using Weight = typename Arc::Weight;
+
+	using Element = std::pair<std::pair<std::pair<Label, Label>, Weight>, StateId>;
+
+	Element Compact(StateId s, const Arc &arc) const {
+		return std::make_pair(std::make_pair(std::make_pair(arc.ilabel, arc.olabel), arc.weight), arc.nextstate);
+	}
+
+	Arc Expand(StateId s, const Element &p, uint32 f = kArcValueFlags) const {
+		return Arc(p.first.first.first, p.first.first.second, p.first.second, p.second);
+	}
+
+	constexpr ssize_t Size() const { return -1; }
+
+	constexpr uint64 Properties() const { return 0ULL; }
+
+	bool Compatible(const Fst<Arc> &fst) const { return true; }
+
+	static const string &Type() {
+		static const string *const type = new string("train_graph");
+		return *type;
+	}
+
+	bool Write(std::ostream &strm) const { return true; }
+
+	static TrainGraphCompactor *Read(std::istream &strm) {
+		return new TrainGraphCompactor;
+	}
+};
+
+using StdCompactTrainGraphFst = CompactFst<StdArc, TrainGraphCompactor<StdArc>, uint32>;
+
+}  // namespace fst
+
+namespace kaldi {
+
+class TrainGraphCache {
+public:
+	typedef fst::StdCompactTrainGraphFst Graph;
+
+	// default byte budget per job
+	static const size_t kDefaultCacheLimit = 256 * 1024 * 1024;
+
+	explicit TrainGraphCache(size_t cache_limit_bytes = kDefaultCacheLimit);
+
+	~TrainGraphCache();
+
+	bool Initialized() const { return gc_ != NULL; }
+
+	// Reads the tree, the transition model (only the topology is used), the lexicon and the disambiguation
+	// symbols and creates the graph compiler. Must be called once before GetGraphs().
+	void Init(const std::string &tree_rxfilename, const std::string &model_rxfilename,
+		const std::string &lex_rxfilename, const std::string &disambig_rxfilename);
+
+	// Returns the graphs of the utterances in 'keys'. The graphs which are not in the cache are compiled
+	// with one call of CompileGraphsFromText(). The graph of an utterance which failed to compile is NULL.
+	// NOTE: the returned pointers stay valid also when the graphs are evicted from the cache.
+	bool GetGraphs(const std::vector<std::string> &keys,
+		const std::vector<std::vector<int32> > &transcripts,
+		std::vector<std::shared_ptr<const Graph> > *graphs);
+
+	// Copies a cached graph into a mutable FST (for adding the transition probs and aligning).
+	static void ExpandGraph(const Graph &graph, fst::VectorFst<fst::StdArc> *ofst);
+
+	void Clear();
+
+	size_t CacheSize() const { return cache_size_; }
+	size_t CacheLimit() const { return cache_limit_; }
+	int64 NumHits() const { return num_hits_; }
+	int64 NumCompiled() const { return num_compiled_; }
+
+private:
+	struct Entry {
+		std::shared_ptr<const Graph> graph;
+		size_t bytes;
+		std::list<std::string>::iterator lru_pos;
+	};
+
+	void Insert(const std::string &key, std::shared_ptr<const Graph> graph, size_t bytes);
+	void Touch(Entry *entry);
+	void Evict();
+
+	static size_t GraphBytes(const fst::VectorFst<fst::StdArc> &fst);
+
+	ContextDependency ctx_dep_;
+	TransitionModel trans_model_;
+	TrainingGraphCompiler *gc_;
+
+	std::unordered_map<std::string, Entry> graphs_;
+	std::list<std::string> lru_;				// most recently used at the front
+	size_t cache_limit_;						// number of bytes allowed
+	size_t cache_size_;							// number of bytes cached
+	int64 num_hits_;
+	int64 num_compiled_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(TrainGraphCache);
+};
+
+}  // namespace kaldi
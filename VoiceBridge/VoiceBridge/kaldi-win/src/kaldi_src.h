@@ -14,6 +14,8 @@
 #include "kaldi-win/utility/Utility.h"
 #include "kaldi-win/src/fstbin/fst_ext.h"
 
+namespace kaldi { class ConstArpaLm; class TrainGraphCache; }
+
 //featbin
 int ComputeMFCCFeats(int argc, char *argv[], fs::ofstream & file_log);
 int CopyFeats(int argc, char *argv[], fs::ofstream & file_log);
@@ -41,6 +43,7 @@ int GmmInfo(int argc, char *argv[]);
 int GmmInitMono(int argc, char *argv[]);
 int GmmEst(int argc, char *argv[], fs::ofstream & file_log);
 int GmmAlignCompiled(int argc, char *argv[], fs::ofstream & file_log);
+int GmmAlign(int argc, char *argv[], fs::ofstream & file_log, kaldi::TrainGraphCache * graph_cache = NULL);
 int GmmAccStatsAli(int argc, char *argv[], fs::ofstream & file_log);
 int GmmBoostSilence(int argc, char *argv[], fs::ofstream & file_log);
 int GmmSumAccs(int argc, char *argv[], fs::ofstream & file_log);
@@ -53,7 +56,11 @@ int GmmEstFmllr(int argc, char *argv[], fs::ofstream & file_log);
 int GmmAccStatsTwofeats(int argc, char *argv[], fs::ofstream & file_log);
 int GmmPostToGpost(int argc, char *argv[], fs::ofstream & file_log);
 int GmmEstFmllrGpost(int argc, char *argv[], fs::ofstream & file_log);
+int GmmEstFmllrSpk(int argc, char *argv[], fs::ofstream & file_log);
 int GmmRescoreLattice(int argc, char *argv[], fs::ofstream & file_log);
+int GmmBuildShortlist(int argc, char *argv[], fs::ofstream & file_log);
+int GmmBasisFmllrAccsSpk(int argc, char *argv[], fs::ofstream & file_log);
+int GmmBasisFmllrTraining(int argc, char *argv[], fs::ofstream & file_log);
 
 //bin
 int AlignEqualCompiled(int argc, char *argv[], fs::ofstream & file_log);
@@ -99,3 +106,6 @@ int LatticeAlignWords(int argc, char *argv[], fs::ofstream & file_log);
 int LatticeAlignWordsLexicon(int argc, char *argv[], fs::ofstream & file_log);
 int LinearToNbest(int argc, char *argv[], fs::ofstream & file_log);
 int NbestToProns(int argc, char *argv[], fs::ofstream & file_log);
+int LatticePostprocess(int argc, char *argv[], fs::ofstream & file_log);
+int LatticeLmrescore(int argc, char *argv[], fs::ofstream & file_log);
+int LatticeLmrescoreConstArpa(int argc, char *argv[], fs::ofstream & file_log, const kaldi::ConstArpaLm * const_arpa_in = NULL);
@@ -0,0 +1,128 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on :
+ Copyright 2014  Guoguo Chen
+See ../../COPYING for clarification regarding multiple authors
+*/
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lm/const-arpa-lm.h"
+#include "util/common-utils.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+
+//VB: if const_arpa_in is not NULL then that (already loaded) language model is used and the const-arpa-in
+//	argument is ignored. This makes it possible to load a big ConstArpaLm only once and share it between
+//	the parallel jobs; ConstArpaLm is read-only after loading and each job wraps it in its own
+//	ConstArpaLmDeterministicFst.
+int LatticeLmrescoreConstArpa(int argc, char *argv[], fs::ofstream & file_log, const kaldi::ConstArpaLm * const_arpa_in) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Rescores lattice with the ConstArpaLm format language model. The LM\n"
+        "will be wrapped into the DeterministicOnDemandFst interface and the\n"
+        "rescoring is done by composing with the wrapped LM using a special\n"
+        "type of composition algorithm. Determinization will be applied on\n"
+        "the composed lattice.\n"
+        "\n"
+        "Usage: lattice-lmrescore-const-arpa [options] lattice-rspecifier \\\n"
+        "                                   const-arpa-in lattice-wspecifier\n"
+        " e.g.: lattice-lmrescore-const-arpa --lm-scale=-1.0 ark:in.lats \\\n"
+        "                                   const_arpa ark:out.lats\n";
+
+    ParseOptions po(usage);
+    BaseFloat lm_scale = 1.0;
+
+    po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
+                "costs; frequently 1.0 or -1.0");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+		//po.PrintUsage();
+		//exit(1);
+		KALDI_ERR << "Wrong arguments.";
+		return -1;
+    }
+
+    std::string lats_rspecifier = po.GetArg(1),
+        lm_rxfilename = po.GetArg(2),
+        lats_wspecifier = po.GetArg(3);
+
+    // Reads the language model in ConstArpaLm format (unless it is shared by the caller).
+    ConstArpaLm const_arpa_own;
+    if (const_arpa_in == NULL)
+      ReadKaldiObject(lm_rxfilename, &const_arpa_own);
+    const ConstArpaLm &const_arpa = (const_arpa_in != NULL ? *const_arpa_in : const_arpa_own);
+
+    // Reads and writes as compact lattice.
+    SequentialCompactLatticeReader compact_lattice_reader(lats_rspecifier);
+    CompactLatticeWriter compact_lattice_writer(lats_wspecifier);
+
+    int32 n_done = 0, n_fail = 0;
+    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
+      std::string key = compact_lattice_reader.Key();
+      CompactLattice clat = compact_lattice_reader.Value();
+      compact_lattice_reader.FreeCurrent();
+
+      if (lm_scale != 0.0) {
+        // Before composing with the LM FST, we scale the lattice weights
+        // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
+        // We do it this way so we can determinize and it will give the
+        // right effect (taking the "best path" through the LM) regardless
+        // of the sign of lm_scale.
+        fst::ScaleLattice(fst::GraphLatticeScale(1.0/lm_scale), &clat);
+        ArcSort(&clat, fst::OLabelCompare<CompactLatticeArc>());
+
+        // Wraps the ConstArpaLm format language model into FST. We re-create it
+        // for each lattice to prevent memory usage increasing with time.
+        ConstArpaLmDeterministicFst const_arpa_fst(const_arpa);
+
+        // Composes lattice with language model.
+        CompactLattice composed_clat;
+        ComposeCompactLatticeDeterministic(clat,
+                                           &const_arpa_fst, &composed_clat);
+
+        // Determinizes the composed lattice.
+        Lattice composed_lat;
+        ConvertLattice(composed_clat, &composed_lat);
+        Invert(&composed_lat);
+        CompactLattice determinized_clat;
+        DeterminizeLattice(composed_lat, &determinized_clat);
+        fst::ScaleLattice(fst::GraphLatticeScale(lm_scale), &determinized_clat);
+        if (determinized_clat.Start() == fst::kNoStateId) {
+          KALDI_WARN << "Empty lattice for utterance " << key
+              << " (incompatible LM?)";
+          n_fail++;
+        } else {
+          compact_lattice_writer.Write(key, determinized_clat);
+          n_done++;
+        }
+      } else {
+        // Zero scale so nothing to do.
+        n_done++;
+        compact_lattice_writer.Write(key, clat);
+      }
+    }
+
+	if (file_log)
+		file_log << "Done " << n_done << " lattices, failed for " << n_fail << "\n";
+	else
+		KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+	  KALDI_ERR << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,230 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2012  Johns Hopkins University (Author: Daniel Povey)
+		   See ../../COPYING for clarification regarding multiple authors
+*/
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+
+#include "kaldi-win/src/kaldi_src.h"
+#include "lat/lattice-postprocessor.h"
+
+namespace kaldi {
+
+// The totals of all utterances per setting.
+struct LatticePostprocessStats {
+	std::vector<int32> num_done, num_err, num_words;
+	std::vector<double> tot_bayes_risk;
+
+	explicit LatticePostprocessStats(int32 num_settings) : num_done(num_settings, 0), num_err(num_settings, 0),
+		num_words(num_settings, 0), tot_bayes_risk(num_settings, 0.0) {}
+};
+
+// One utterance: the chain is run for all settings in operator() in a worker thread; the destructor writes the
+// results (called in the order of the utterances).
+class LatticePostprocessTask {
+public:
+	LatticePostprocessTask(const LatticePostprocessor &processor, const std::string &utt, const CompactLattice &clat,
+		std::vector<Int32VectorWriter*> *trans_writers, std::vector<Output*> *prons_outputs,
+		LatticePostprocessStats *stats)
+		: processor_(processor), utt_(utt), clat_(clat), trans_writers_(trans_writers),
+		prons_outputs_(prons_outputs), stats_(stats) {}
+
+	void operator() () {
+		processor_.Process(utt_, clat_, &results_);
+		clat_.DeleteStates();
+	}
+
+	~LatticePostprocessTask() {
+		for (size_t s = 0; s < results_.size(); s++) {
+			const LatticePostprocessResult &r = results_[s];
+			if (!r.ok) {
+				stats_->num_err[s]++;
+				continue;
+			}
+			if (!trans_writers_->empty())
+				(*trans_writers_)[s]->Write(utt_, r.words);
+			if (!prons_outputs_->empty()) {
+				std::ostream &os = (*prons_outputs_)[s]->Stream();
+				for (size_t i = 0; i < r.pron_words.size(); i++) {
+					os << utt_ << ' ' << r.pron_times[i] << ' ' << r.pron_lengths[i] << ' ' << r.pron_words[i];
+					for (size_t j = 0; j < r.prons[i].size(); j++)
+						os << ' ' << r.prons[i][j];
+					os << '\n';
+				}
+			}
+			stats_->num_done[s]++;
+			stats_->num_words[s] += r.words.size();
+			stats_->tot_bayes_risk[s] += r.bayes_risk;
+		}
+	}
+
+private:
+	const LatticePostprocessor &processor_;
+	std::string utt_;
+	CompactLattice clat_;
+	std::vector<Int32VectorWriter*> *trans_writers_;
+	std::vector<Output*> *prons_outputs_;
+	LatticePostprocessStats *stats_;
+	std::vector<LatticePostprocessResult> results_;
+};
+
+}  // namespace kaldi
+
+/*
+	LatticePostprocess : Runs a chain of lattice operations in memory for a set of LM weights and word insertion
+	penalties and writes the word sequences and/or the word pronunciations per setting.
+
+	//VB: replaces lattice-scale | lattice-add-penalty | [lattice-prune | lattice-mbr-decode] | lattice-best-path
+	//	  per LMWT (ScoreKaldiWER) and lattice-1best | lattice-align-words[-lexicon] | nbest-to-prons (GetProns);
+	//	  each lattice is read once and the utterances are processed in parallel (--num-threads) with
+	//	  LatticePostprocessor.
+*/
+int LatticePostprocess(int argc, char *argv[], fs::ofstream & file_log) {
+	try {
+		using namespace kaldi;
+		typedef kaldi::int32 int32;
+
+		const char *usage =
+			"Runs a chain of lattice operations (--ops) in memory on each lattice for every combination of the\n"
+			"LM weights (--inv-acoustic-scales) and word insertion penalties (--word-ins-penalties), and writes\n"
+			"the word sequences (the MBR hypothesis after mbr, otherwise the best path) and, after prons, the\n"
+			"word pronunciations in the format of nbest-to-prons. {LMWT} and {WIP} in the output names are\n"
+			"replaced with the LM weight and the word insertion penalty; they are required if there are several\n"
+			"LM weights or penalties. Use the empty string for unwanted outputs.\n"
+			"Operations: scale, penalty, prune, mbr, 1best, align-words, prons\n"
+			"Usage: lattice-postprocess [options] <lattice-rspecifier> <transcriptions-wspecifier> "
+			"[<prons-wxfilename>]\n"
+			" e.g.: lattice-postprocess --ops=scale,penalty,prune,mbr --inv-acoustic-scales=7,8,9 \\\n"
+			"   --word-ins-penalties=0.0,0.5 ark:lat.merged ark,t:penalty_{WIP}/{LMWT}.tra\n"
+			" e.g.: lattice-postprocess --ops=scale,1best,align-words,prons --inv-acoustic-scales=10 \\\n"
+			"   --model=final.mdl --word-boundary=word_boundary.int ark:lat.1 \"\" prons.1\n";
+
+		ParseOptions po(usage);
+		LatticePostprocessOptions opts;
+		TaskSequencerConfig sequencer_config;
+		std::string model_rxfilename, word_boundary_rxfilename, align_lexicon_rxfilename;
+		po.Register("model", &model_rxfilename, "Model (only the transition model is read), needed by "
+			"align-words and prons");
+		po.Register("word-boundary", &word_boundary_rxfilename, "Word boundary file for align-words "
+			"(as lattice-align-words)");
+		po.Register("align-lexicon", &align_lexicon_rxfilename, "Alignment lexicon for align-words if there is "
+			"no word boundary file (as lattice-align-words-lexicon)");
+		opts.Register(&po);
+		sequencer_config.Register(&po);
+
+		po.Read(argc, argv);
+
+		if (po.NumArgs() < 2 || po.NumArgs() > 3) {
+			//po.PrintUsage();
+			//exit(1);
+			KALDI_ERR << "Wrong arguments.";
+			return -1;
+		}
+
+		std::string lats_rspecifier = po.GetArg(1),
+			trans_wspecifier = po.GetArg(2),
+			prons_wxfilename = po.GetOptArg(3);
+
+		TransitionModel *trans_model = NULL;
+		if (model_rxfilename != "") {
+			trans_model = new TransitionModel();
+			ReadKaldiObject(model_rxfilename, trans_model);
+		}
+		WordBoundaryInfo *word_boundary = NULL;
+		WordAlignLatticeLexiconInfo *lexicon_info = NULL;
+		if (word_boundary_rxfilename != "") {
+			word_boundary = new WordBoundaryInfo(opts.word_boundary_opts, word_boundary_rxfilename);
+		}
+		else if (align_lexicon_rxfilename != "") {
+			std::vector<std::vector<int32> > lexicon;
+			bool binary_in;
+			Input ki(align_lexicon_rxfilename, &binary_in);
+			KALDI_ASSERT(!binary_in && "Not expecting binary file for lexicon");
+			if (!ReadLexiconForWordAlign(ki.Stream(), &lexicon)) {
+				KALDI_ERR << "Error reading alignment lexicon from " << align_lexicon_rxfilename;
+				delete trans_model;
+				return -1; //VB
+			}
+			lexicon_info = new WordAlignLatticeLexiconInfo(lexicon);
+		}
+
+		LatticePostprocessor processor(opts, trans_model, word_boundary, lexicon_info);
+		if (prons_wxfilename != "" && !processor.HasOp(kLatOpProns)) {
+			KALDI_ERR << "A prons output needs the prons operation (--ops=" << opts.ops << ")";
+			return -1;
+		}
+
+		int32 num_settings = processor.NumSettings();
+		if ((trans_wspecifier != "" && !processor.SettingsDistinct(trans_wspecifier)) ||
+			(prons_wxfilename != "" && !processor.SettingsDistinct(prons_wxfilename))) {
+			KALDI_ERR << "With several LM weights or word insertion penalties the output names must contain "
+				"{LMWT} and {WIP} respectively.";
+			return -1;
+		}
+		std::vector<Int32VectorWriter*> trans_writers;
+		std::vector<Output*> prons_outputs;
+		for (int32 s = 0; s < num_settings; s++) {
+			if (trans_wspecifier != "")
+				trans_writers.push_back(new Int32VectorWriter(processor.SettingName(trans_wspecifier, s)));
+			if (prons_wxfilename != "")
+				prons_outputs.push_back(new Output(processor.SettingName(prons_wxfilename, s), false));
+		}
+
+		LatticePostprocessStats stats(num_settings);
+		int32 num_lats = 0;
+		{
+			SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+			TaskSequencer<LatticePostprocessTask> sequencer(sequencer_config);
+			for (; !clat_reader.Done(); clat_reader.Next()) {
+				sequencer.Run(new LatticePostprocessTask(processor, clat_reader.Key(), clat_reader.Value(),
+					&trans_writers, &prons_outputs, &stats));
+				clat_reader.FreeCurrent();
+				num_lats++;
+			}
+			sequencer.Wait();
+		}
+
+		for (size_t i = 0; i < trans_writers.size(); i++)
+			delete trans_writers[i];
+		for (size_t i = 0; i < prons_outputs.size(); i++) {
+			prons_outputs[i]->Close();
+			delete prons_outputs[i];
+		}
+		delete trans_model;
+		delete word_boundary;
+		delete lexicon_info;
+
+		int32 num_done = 0;
+		for (int32 s = 0; s < num_settings; s++) {
+			num_done += stats.num_done[s];
+			std::ostringstream msg;
+			msg << "Setting " << processor.SettingName("{LMWT}/{WIP}", s) << ": done " << stats.num_done[s]
+				<< " lattices, " << stats.num_err[s] << " with errors";
+			if (processor.HasOp(kLatOpMbr) && stats.num_done[s] > 0)
+				msg << "; average Bayes Risk per sentence is " << (stats.tot_bayes_risk[s] / stats.num_done[s])
+				<< " and per word, " << (stats.tot_bayes_risk[s] / std::max(stats.num_words[s], 1));
+			if (file_log) file_log << msg.str() << "\n";
+			else KALDI_LOG << msg.str();
+		}
+		if (file_log)
+			file_log << "Processed " << num_lats << " lattices with " << num_settings << " settings." << "\n";
+		else KALDI_LOG << "Processed " << num_lats << " lattices with " << num_settings << " settings.";
+
+		return (num_done != 0 ? 0 : 1);
+	}
+	catch (const std::exception &e) {
+		KALDI_ERR << e.what();
+		return -1;
+	}
+}
@@ -0,0 +1,92 @@
+/*
+Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+
+Based on : Copyright 2014  Guoguo Chen, Apache 2.0.
+*/
+// lmbin/arpa-to-const-arpa.cc
+//
+// Copyright 2014  Guoguo Chen
+//
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABILITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "lm/const-arpa-lm.h"
+#include "util/kaldi-io.h"
+#include "util/parse-options.h"
+
+#include "kaldi-win/utility/Utility.h"
+
+using namespace kaldi;
+
+//Converts an ARPA format language model into ConstArpaLm format (e.g. G.carpa), which is an in-memory
+//representation of the pre-built ARPA language model used for lattice rescoring with a big LM.
+//NOTE: in Kaldi the words in the ARPA file must first be mapped to integers with utils/map_arpa_lm.pl.
+//		Here the words are mapped while reading through the symbol table (words.txt) of the lang directory,
+//		n-grams containing words which are not in the symbol table are skipped (same as map_arpa_lm.pl).
+int ArpaToConstArpa(std::string arpa_rxfilename, std::string const_arpa_wxfilename,
+	std::string read_syms_filename, //e.g. "data/lang_test/words.txt"
+	std::string bos_symbol,			//= "<s>"	Beginning of sentence symbol
+	std::string eos_symbol,			//= "</s>"	End of sentence symbol
+	std::string unk_symbol			//= ""		Unknown-word symbol in the language model (e.g. the OOV word), "" if none
+	)
+{
+	try {
+		ArpaParseOptions options;
+		options.oov_handling = ArpaParseOptions::kSkipNGram;
+
+		fst::SymbolTable* symbols;
+		{
+			kaldi::Input kisym(read_syms_filename);
+			symbols = fst::SymbolTable::ReadText(kisym.Stream(), PrintableWxfilename(read_syms_filename));
+			if (symbols == NULL) {
+				LOGTW_ERROR << " Could not read symbol table from file " << read_syms_filename;
+				return -1;
+			}
+		}
+
+		options.bos_symbol = symbols->Find(bos_symbol);
+		options.eos_symbol = symbols->Find(eos_symbol);
+		if (options.bos_symbol == fst::SymbolTable::kNoSymbol || options.eos_symbol == fst::SymbolTable::kNoSymbol) {
+			LOGTW_ERROR << " Symbol table " << read_syms_filename << " has no symbol for " << bos_symbol << " or " << eos_symbol;
+			delete symbols;
+			return -1;
+		}
+		if (!unk_symbol.empty()) {
+			int64 unk = symbols->Find(unk_symbol);
+			if (unk == fst::SymbolTable::kNoSymbol) {
+				LOGTW_WARNING << " Symbol table " << read_syms_filename << " has no symbol for " << unk_symbol << ", the ConstArpaLm will have no unknown-word symbol.";
+			}
+			else options.unk_symbol = unk;
+		}
+
+		bool ans = BuildConstArpaLm(options, arpa_rxfilename, const_arpa_wxfilename, symbols);
+		delete symbols;
+		if (!ans) {
+			LOGTW_ERROR << " Failed to build ConstArpaLm from " << arpa_rxfilename;
+			return -1;
+		}
+	}
+	catch (const std::exception &e) {
+		LOGTW_ERROR << " " << e.what();
+		return -1;
+	}
+	return 0;
+}
@@ -26,6 +26,7 @@
 #include <algorithm>  
 #include <regex>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/range/numeric.hpp>
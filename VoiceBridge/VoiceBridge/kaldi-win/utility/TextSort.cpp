@@ -0,0 +1,452 @@
+/*
+	Copyright 2017-present Zoltan Somogyi (AI-TOOLKIT), All Rights Reserved
+	You may use this file only if you agree to the software license:
+	AI-TOOLKIT Open Source Software License - Version 2.1 - February 22, 2018:
+	https://ai-toolkit.blogspot.com/p/ai-toolkit-open-source-software-license.html.
+	Also included with the source code distribution in AI-TOOLKIT-LICENSE.txt.
+*/
+
+/*
+	Sorting of data directory text files (StringTable and files with one record per line).
+	 - The sort keys are extracted once per line (in parallel) into fixed width keys: the first 8 bytes of a "string"
+	   column (big endian, so that comparing the keys gives the same order as comparing the std::string's) or the order
+	   preserving bits of a "number" column, which is parsed once instead of in each comparison. The rest of the
+	   strings is only compared if the keys are equal.
+	 - SortStringTable() sorts chunks of the table in parallel and merges them. Equal lines keep their order.
+	 - SortTextFile() sorts a file within a memory budget: sorted runs are written to temporary files and merged.
+	 - is_sortedonfield_and_uniqe() streams through the file.
+	See also FilterScpSorted() (merge-join of sorted files).
+*/
+
+#include "Utility.h"
+#include <queue>
+
+namespace {
+
+struct SortColumn {
+	int col;
+	bool number;
+	bool ascend;
+};
+
+struct SortRecord {
+	uint64_t key1, key2;
+	const string_vec * row;
+	size_t index;		//position in the input; equal lines keep their order
+};
+
+uint64_t StringKey(const std::string & s)
+{
+	uint64_t k = 0;
+	for (size_t i = 0; i < 8; i++) {
+		k <<= 8;
+		if (i < s.size()) k |= static_cast<unsigned char>(s[i]);
+	}
+	return k;
+}
+
+//the same characters are used as in StringToNumber()
+double ParseNumber(const std::string & s)
+{
+	char buffer[64];
+	size_t n = 0;
+	for (std::string::const_iterator i = s.begin(); i != s.end() && n < sizeof(buffer) - 1; ++i)
+		if (isdigit(static_cast<unsigned char>(*i)) || *i == 'e' || *i == '-' || *i == '+' || *i == '.')
+			buffer[n++] = *i;
+	buffer[n] = 0;
+	return std::strtod(buffer, nullptr);
+}
+
+//order preserving unsigned representation of a double
+uint64_t NumberKey(double d)
+{
+	if (d == 0.0) d = 0.0; //-0 == +0
+	uint64_t b;
+	std::memcpy(&b, &d, sizeof(b));
+	return (b >> 63) ? ~b : (b | (1ULL << 63));
+}
+
+uint64_t ColumnKey(const string_vec & row, const SortColumn & c)
+{
+	uint64_t k = c.number ? NumberKey(ParseNumber(row[c.col])) : StringKey(row[c.col]);
+	return c.ascend ? k : ~k;
+}
+
+class RecordCompare
+{
+public:
+	RecordCompare(SortColumn c1, SortColumn c2) : m_c1(c1), m_c2(c2) {}
+
+	//<0, 0, >0; only the columns are compared
+	int Compare(const SortRecord & a, const SortRecord & b) const
+	{
+		if (a.key1 != b.key1) return a.key1 < b.key1 ? -1 : 1;
+		int r = CompareRest(*a.row, *b.row, m_c1);
+		if (r != 0) return r;
+		if (m_c1.col == m_c2.col && m_c1.number == m_c2.number) return 0;
+		if (a.key2 != b.key2) return a.key2 < b.key2 ? -1 : 1;
+		return CompareRest(*a.row, *b.row, m_c2);
+	}
+
+	bool operator()(const SortRecord & a, const SortRecord & b) const
+	{
+		int r = Compare(a, b);
+		return r != 0 ? r < 0 : a.index < b.index;
+	}
+
+private:
+	//compares the part of the strings which is not in the key
+	static int CompareRest(const string_vec & a, const string_vec & b, const SortColumn & c)
+	{
+		if (c.number) return 0;
+		const std::string & sa = a[c.col], & sb = b[c.col];
+		//NOTE: if one of the strings is shorter than 8 bytes then equal keys mean equal strings (no 0 bytes in text)
+		if (sa.size() < 8 || sb.size() < 8) return 0;
+		int r = sa.compare(8, std::string::npos, sb, 8, std::string::npos);
+		return c.ascend ? r : -r;
+	}
+
+	SortColumn m_c1, m_c2;
+};
+
+//sorts the records of table in parallel; the records point to the rows of the table
+void SortRecords(const StringTable & table, SortColumn c1, SortColumn c2, std::vector<SortRecord> & records)
+{
+	size_t n = table.size();
+	records.resize(n);
+	RecordCompare compare(c1, c2);
+
+	int nt = std::thread::hardware_concurrency();
+	if (nt < 1) nt = 1;
+	if (n < 65536) nt = 1;
+	std::vector<size_t> bounds;
+	for (int t = 0; t <= nt; t++) bounds.push_back(n * t / nt);
+
+	//key extraction and sorting of the chunks
+	auto sort_chunk = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			records[i].key1 = ColumnKey(table[i], c1);
+			records[i].key2 = ColumnKey(table[i], c2);
+			records[i].row = &table[i];
+			records[i].index = i;
+		}
+		std::sort(records.begin() + begin, records.begin() + end, compare);
+	};
+	if (nt == 1) {
+		sort_chunk(0, n);
+		return;
+	}
+	std::vector<std::thread> _threads;
+	for (int t = 0; t < nt; t++)
+		_threads.emplace_back(sort_chunk, bounds[t], bounds[t + 1]);
+	for (auto & t : _threads) t.join();
+
+	//merge the neighbouring chunks in parallel until one is left
+	while (bounds.size() > 2) {
+		std::vector<size_t> merged;
+		_threads.clear();
+		for (size_t c = 0; c + 1 < bounds.size(); c += 2) {
+			merged.push_back(bounds[c]);
+			if (c + 2 < bounds.size()) {
+				size_t b = bounds[c], m = bounds[c + 1], e = bounds[c + 2];
+				_threads.emplace_back([&records, &compare, b, m, e]() {
+					std::inplace_merge(records.begin() + b, records.begin() + m, records.begin() + e, compare);
+				});
+			}
+		}
+		merged.push_back(n);
+		for (auto & t : _threads) t.join();
+		bounds.swap(merged);
+	}
+}
+
+int GetSortColumns(int col1, int col2, std::string type1, std::string type2, bool ascend1, bool ascend2, SortColumn & c1, SortColumn & c2)
+{
+	if (col1 < 0 || col2 < 0) {
+		LOGTW_ERROR << " Invalid sort column index.";
+		return -1;
+	}
+	c1 = { col1, type1 == "number", ascend1 };
+	c2 = { col2, type2 == "number", ascend2 };
+	return 0;
+}
+
+int CheckColumns(const string_vec & row, int col1, int col2)
+{
+	if (row.size() < (size_t)col1 + 1 || row.size() < (size_t)col2 + 1)
+	{
+		LOGTW_ERROR << " The string table size does not much the requested sort column index.";
+		return -1;
+	}
+	return 0;
+}
+
+//estimated memory use of a row in a StringTable
+size_t RowBytes(const string_vec & row)
+{
+	size_t bytes = sizeof(string_vec);
+	for (const std::string & s : row) bytes += sizeof(std::string) + s.capacity();
+	return bytes;
+}
+
+int SaveRows(fs::ofstream & file_, const StringTable & table)
+{
+	for (StringTable::const_iterator it(table.begin()), it_end(table.end()); it != it_end; ++it)
+	{
+		for (size_t c = 0; c < it->size(); c++) {
+			if (c > 0) file_ << " "; //Separator!
+			file_ << (*it)[c];
+		}
+		file_ << '\n';
+	}
+	return file_ ? 0 : -1;
+}
+
+//reads the rows of a sorted run one by one during the merge
+struct RunReader {
+	fs::ifstream file_;
+	string_vec row;
+	SortRecord rec;
+
+	bool Next(const SortColumn & c1, const SortColumn & c2, size_t index)
+	{
+		std::string line;
+		while (std::getline(file_, line)) {
+			SplitTableLine(line, row);
+			if (row.empty()) continue;
+			rec.key1 = ColumnKey(row, c1);
+			rec.key2 = ColumnKey(row, c2);
+			rec.row = &row;
+			rec.index = index;
+			return true;
+		}
+		return false;
+	}
+};
+
+} // namespace
+
+//splits a line in the same way as ReadStringTable()
+VOICEBRIDGE_API void SplitTableLine(std::string & line, string_vec & row, const std::string & delimiter)
+{
+	row.clear();
+	boost::algorithm::trim(line);
+	strtk::parse(line, delimiter, row, strtk::split_options::compress_delimiters);
+}
+
+/*
+	In place short of a StringTable by col1 and then by col2; col1 can be = col2.
+	When requested bMakeUnique makes the table unique (erashes duplicate) by the first column (unique first column!)
+*/
+VOICEBRIDGE_API int SortStringTable(StringTable & table,
+	int col1, int col2,
+	std::string type1, std::string type2, bool bMakeUnique,
+	bool ascend1, bool ascend2)
+{
+	if (table.size() == 0) return 0;
+	SortColumn c1, c2;
+	if (GetSortColumns(col1, col2, type1, type2, ascend1, ascend2, c1, c2) < 0) return -1;
+	for (StringTable::const_iterator it(table.begin()), it_end(table.end()); it != it_end; ++it)
+		if (CheckColumns(*it, col1, col2) < 0) return -1;
+
+	std::vector<SortRecord> records;
+	SortRecords(table, c1, c2, records);
+
+	StringTable sorted;
+	sorted.reserve(table.size());
+	for (size_t i = 0; i < records.size(); i++) {
+		string_vec & row = table[records[i].index];
+		//IMPORTANT NOTE: when unique is requested we always mean unique by the first supplied column (columns[0])
+		//				  and not the whole line! The first line is kept.
+		if (bMakeUnique && !sorted.empty() && sorted.back()[col1] == row[col1]) continue;
+		sorted.push_back(std::move(row));
+	}
+	table.swap(sorted);
+	return 0;
+}
+
+/*
+	Sorts a text file in the same way as SortStringTable() but without reading the whole file into memory when it is
+	larger than max_memory_mb: the sorted parts are written to temporary files (next to the output) and merged.
+	The input and the output file can be the same.
+*/
+VOICEBRIDGE_API int SortTextFile(fs::path in, fs::path out,
+	int col1, int col2,
+	std::string type1, std::string type2, bool bMakeUnique,
+	bool ascend1, bool ascend2, size_t max_memory_mb)
+{
+	SortColumn c1, c2;
+	if (GetSortColumns(col1, col2, type1, type2, ascend1, ascend2, c1, c2) < 0) return -1;
+	const size_t max_bytes = max_memory_mb * 1024 * 1024;
+
+	std::vector<fs::path> runs;
+	auto remove_runs = [&runs]() {
+		for (fs::path p : runs) {
+			try {
+				fs::remove(p);
+			} catch (const std::exception&) {}
+		}
+	};
+	StringTable chunk;
+	try {
+		fs::ifstream file_in(in, std::ios::binary);
+		if (!file_in) {
+			LOGTW_ERROR << " can't open input file: " << in.string() << ".";
+			return -1;
+		}
+		size_t bytes = 0;
+		std::string line;
+		string_vec row;
+		while (std::getline(file_in, line)) {
+			SplitTableLine(line, row);
+			if (CheckColumns(row, col1, col2) < 0) {
+				remove_runs();
+				return -1;
+			}
+			bytes += RowBytes(row);
+			chunk.push_back(std::move(row));
+			if (bytes > max_bytes) {
+				//write a sorted run
+				if (SortStringTable(chunk, col1, col2, type1, type2, false, ascend1, ascend2) < 0) {
+					remove_runs();
+					return -1;
+				}
+				fs::path run(out.string() + ".run" + std::to_string(runs.size()));
+				runs.push_back(run);
+				fs::ofstream file_run(run, std::ios::binary | std::ios::out);
+				if (!file_run || SaveRows(file_run, chunk) < 0) {
+					LOGTW_ERROR << " can't write temporary file: " << run.string() << ".";
+					remove_runs();
+					return -1;
+				}
+				chunk.clear();
+				bytes = 0;
+			}
+		}
+	}
+	catch (std::exception const& e) {
+		LOGTW_FATALERROR << " " << e.what() << ". (Sorting file " << in.string() << ")";
+		remove_runs();
+		return -1;
+	}
+
+	//everything fits into memory
+	if (runs.empty()) {
+		if (SortStringTable(chunk, col1, col2, type1, type2, bMakeUnique, ascend1, ascend2) < 0) return -1;
+		return SaveStringTable(out.string(), chunk);
+	}
+
+	//merge the runs; the last part is merged from memory
+	int ret = 0;
+	try {
+		if (SortStringTable(chunk, col1, col2, type1, type2, false, ascend1, ascend2) < 0) {
+			remove_runs();
+			return -1;
+		}
+		RecordCompare compare(c1, c2);
+		std::vector<std::unique_ptr<RunReader>> readers;
+		for (fs::path p : runs) {
+			readers.emplace_back(new RunReader());
+			readers.back()->file_.open(p, std::ios::binary);
+			if (!readers.back()->file_) {
+				LOGTW_ERROR << " can't open temporary file: " << p.string() << ".";
+				remove_runs();
+				return -1;
+			}
+		}
+		//the heap holds the current record of each run (the records of the memory part have the index runs.size())
+		auto greater = [&compare](const SortRecord & a, const SortRecord & b) { return compare(b, a); };
+		std::priority_queue<SortRecord, std::vector<SortRecord>, decltype(greater)> heap(greater);
+		for (size_t r = 0; r < readers.size(); r++)
+			if (readers[r]->Next(c1, c2, r)) heap.push(readers[r]->rec);
+		size_t chunk_pos = 0;
+		SortRecord chunk_rec;
+		auto next_chunk = [&]() {
+			if (chunk_pos >= chunk.size()) return false;
+			chunk_rec.key1 = ColumnKey(chunk[chunk_pos], c1);
+			chunk_rec.key2 = ColumnKey(chunk[chunk_pos], c2);
+			chunk_rec.row = &chunk[chunk_pos];
+			chunk_rec.index = runs.size();
+			chunk_pos++;
+			return true;
+		};
+		if (next_chunk()) heap.push(chunk_rec);
+
+		fs::ofstream file_out(out, std::ios::binary | std::ios::out);
+		if (!file_out) {
+			LOGTW_ERROR << " can't open output file: " << out.string() << ".";
+			remove_runs();
+			return -1;
+		}
+		std::string last;
+		bool first = true;
+		while (!heap.empty()) {
+			SortRecord rec = heap.top();
+			heap.pop();
+			const string_vec & row = *rec.row;
+			if (!bMakeUnique || first || row[col1] != last) {
+				for (size_t c = 0; c < row.size(); c++) {
+					if (c > 0) file_out << " ";
+					file_out << row[c];
+				}
+				file_out << '\n';
+			}
+			if (bMakeUnique) last = row[col1];
+			first = false;
+			//NOTE: the row of a run is overwritten by Next() therefore it must be written out before
+			if (rec.index < readers.size()) {
+				if (readers[rec.index]->Next(c1, c2, rec.index)) heap.push(readers[rec.index]->rec);
+			} else if (next_chunk()) {
+				heap.push(chunk_rec);
+			}
+		}
+		file_out.flush();
+		if (!file_out) {
+			LOGTW_ERROR << " error writing output file: " << out.string() << ".";
+			ret = -1;
+		}
+	}
+	catch (std::exception const& e) {
+		LOGTW_FATALERROR << " " << e.what() << ". (Sorting file " << in.string() << ")";
+		ret = -1;
+	}
+	remove_runs();
+	return ret;
+}
+
+//fieldnr: zero based index of the columns!
+VOICEBRIDGE_API int is_sortedonfield_and_uniqe(fs::path file, int fieldnr, bool bCheckunique, bool bShowError)
+{
+	fs::ifstream file_in(file, std::ios::binary);
+	if (!file_in) {
+		LOGTW_ERROR << " fail to open: " << file.string() << ".";
+		return -3;
+	}
+	bool sorted = true, unique = true, first = true;
+	std::string line, last;
+	string_vec row;
+	while (std::getline(file_in, line)) {
+		SplitTableLine(line, row);
+		if (row.size() < (size_t)(fieldnr + 1)) return -1;
+		if (!first) {
+			int r = row[fieldnr].compare(last);
+			if (r < 0) sorted = false;
+			else if (r == 0) unique = false;
+		}
+		last.swap(row[fieldnr]);
+		first = false;
+	}
+
+	if (!sorted) {
+		if(bShowError)
+			LOGTW_ERROR << " the file is not sorted on field nr " << (fieldnr + 1) << " in file " << file.string() << ".";
+		return -2;
+	}
+	if (bCheckunique && !unique) {
+		if (bShowError)
+			LOGTW_ERROR << " the file contains duplicate elements: " << file.string() << ".";
+		return -1;
+	}
+
+	return 0;
+}
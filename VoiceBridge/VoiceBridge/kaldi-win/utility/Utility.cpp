@@ -44,6 +44,42 @@ VOICEBRIDGE_API void ReplaceKaldiLogHandlerEx(bool reset)
 	}
 }
 
+KaldiJobLogSink::KaldiJobLogSink(fs::ofstream & file_log)
+	: file_log_(&file_log), prev_sink_(NULL), attached_(file_log.is_open())
+{
+	if (attached_) prev_sink_ = kaldi::SetThreadLogSink(this);
+}
+
+KaldiJobLogSink::~KaldiJobLogSink()
+{
+	if (attached_) kaldi::SetThreadLogSink(prev_sink_);
+}
+
+bool KaldiJobLogSink::Log(const kaldi::LogMessageEnvelope &envelope, const char *message)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::ostream & os = *file_log_;
+	switch (envelope.severity) {
+	case kaldi::LogMessageEnvelope::kInfo:
+		os << "LOG";
+		break;
+	case kaldi::LogMessageEnvelope::kWarning:
+		os << "WARNING";
+		break;
+	case kaldi::LogMessageEnvelope::kError:
+		os << "ERROR";
+		break;
+	case kaldi::LogMessageEnvelope::kAssertFailed:
+		os << "ASSERTION_FAILED";
+		break;
+	default:
+		os << "VLOG[" << envelope.severity << "]";
+	}
+	os << " (" << envelope.func << "():" << envelope.file << ':' << envelope.line << ") " << message << "\n";
+	//errors are also reported in the global log
+	return envelope.severity > kaldi::LogMessageEnvelope::kError;
+}
+
 //<------------------- Logging override for Windows version of Kaldi
 
 
@@ -85,9 +121,8 @@ VOICEBRIDGE_API StringTable readData(std::string const path, std::string delimit
 	std::string line;
 	while (std::getline(ifs, line))	{
 		std::vector<std::string> _w;
-		boost::algorithm::trim(line);
-		strtk::parse(line, delimiter, _w, strtk::split_options::compress_delimiters);
-		table.emplace_back(_w);
+		SplitTableLine(line, _w, delimiter);
+		table.emplace_back(std::move(_w));
 	}
 	return table;
 }
@@ -145,125 +180,7 @@ catch (...) {
 }
 }
 
-//comparer function for StringTable short : max 2 columns sort
-class StringTableSortCompare2
-{
-public:
-	//fCol and sCol are "string" or "number"
-	explicit StringTableSortCompare2(int column1, int column2, std::string fCol, std::string sCol, bool ascend1, bool ascend2)
-		: m_column1(column1), m_column2(column2), fColType(fCol), sColType(sCol), m_ascend1(ascend1), m_ascend2(ascend2){}
-	bool operator()(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs)
-	{
-		//sort by column2 after sorting by column1; if column1 == column2 then makes no difference
-		if (lhs[m_column1] == rhs[m_column1]) {
-			if (m_ascend2) {
-				if (sColType.compare("string") == 0)
-					return lhs[m_column2] < rhs[m_column2];
-				else if (sColType.compare("number") == 0)
-					return StringToNumber<double>(lhs[m_column2].c_str()) < StringToNumber<double>(rhs[m_column2].c_str());
-				else return lhs[m_column2] < rhs[m_column2];
-			}
-			else {
-				if (sColType.compare("string") == 0)
-					return lhs[m_column2] > rhs[m_column2];
-				else if (sColType.compare("number") == 0)
-					return StringToNumber<double>(lhs[m_column2].c_str()) > StringToNumber<double>(rhs[m_column2].c_str());
-				else return lhs[m_column2] > rhs[m_column2];
-			}
-		}
-		else {
-			if (m_ascend1) {
-				if (fColType.compare("string") == 0)
-					return lhs[m_column1] < rhs[m_column1];
-				else  if (fColType.compare("number") == 0)
-					return StringToNumber<double>(lhs[m_column1].c_str()) < StringToNumber<double>(rhs[m_column1].c_str());
-				else return lhs[m_column1] < rhs[m_column1];
-			}
-			else {
-				if (fColType.compare("string") == 0)
-					return lhs[m_column1] > rhs[m_column1];
-				else  if (fColType.compare("number") == 0)
-					return StringToNumber<double>(lhs[m_column1].c_str()) > StringToNumber<double>(rhs[m_column1].c_str());
-				else return lhs[m_column1] > rhs[m_column1];
-			}
-		}
-	}
-private:
-	int m_column1;
-	int m_column2;
-	std::string fColType;
-	std::string sColType;
-	bool m_ascend1;
-	bool m_ascend2;
-};
-
-/*
-	In place short of a StringTable by col1 and then by col2; col1 can be = col2.
-	When requested bMakeUnique makes the table unique (erashes duplicate) by the first column (unique first column!)
-*/
-VOICEBRIDGE_API int SortStringTable(StringTable & table, 
-	int col1, int col2, 
-	std::string type1, std::string type2, bool bMakeUnique,
-	bool ascend1, bool ascend2)
-{
-	if (table[0].size() < col1 + 1 || table[0].size() < col2 + 1)
-	{
-		LOGTW_ERROR << " The string table size does not much the requested sort column index.";
-		return -1;
-	}
-	StringTableSortCompare2 sort_compare(col1, col2, type1, type2, ascend1, ascend2);
-	std::sort(table.begin(), table.end(), sort_compare);
-
-	if (bMakeUnique) 
-	{
-		//IMPORTANT NOTE: when unique is requested we always mean unique by the first supplied column (columns[0]) 
-		//				  and not the whole line! The whole line will be removed from the StringTable.
-		int line = 0;
-		StringTable::const_iterator it = table.begin();
-		while ( it != table.end() ) {
-			if (line == 0) { line++; ++it; continue; }
-			if ((*it)[col1] == (*(it - 1))[col1]) {
-				//cout << "deleting line: " << (*it)[0] << "\n";
-				it = table.erase(it); 
-			}
-			else {
-				++it;
-			}
-		}
-		//NOTE: erase() invalidates the current iterator but returns a new one to the next element 
-		//		which can be used further! However, if erase() is not used the iterator must be incremented!
-	}
-
-	return 0;
-}
-
-//fieldnr: zero based index of the columns!
-VOICEBRIDGE_API int is_sortedonfield_and_uniqe(fs::path file, int fieldnr, bool bCheckunique, bool bShowError)
-{
-	StringTable table_;
-	std::vector<std::string> _v;
-	if (ReadStringTable(file.string(), table_) < 0) {
-		LOGTW_ERROR << " fail to open: " << file.string() << ".";
-		return -3;
-	}
-	for (StringTable::const_iterator it(table_.begin()), it_end(table_.end()); it != it_end; ++it) {
-		if ((*it).size() < (fieldnr + 1)) return -1;
-		_v.push_back((*it)[fieldnr]);
-	}
-
-	if (!std::is_sorted(_v.begin(), _v.end())) {
-		if(bShowError)
-			LOGTW_ERROR << " the file is not sorted on field nr " << (fieldnr + 1) << " in file " << file.string() << ".";
-		return -2;
-	}
-	if (bCheckunique && !(std::unique(_v.begin(), _v.end()) == _v.end())) {
-		if (bShowError)
-			LOGTW_ERROR << " the file contains duplicate elements: " << file.string() << ".";
-		return -1;
-	}
-
-	return 0;
-}
+//NOTE: SortStringTable(), SortTextFile() and is_sortedonfield_and_uniqe() are in TextSort.cpp
 
 //checks the whole table if the string s is present; 
 //in case bExactword is true it checks for the whole field instead of contents
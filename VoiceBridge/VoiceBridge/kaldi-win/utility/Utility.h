@@ -10,6 +10,7 @@
 #include "stdafx.h"
 #include <kaldi-win/stdafx.h>
 #include <ctime>
+#include <mutex>
 #include "base/kaldi-error.h"
 #include "kaldi-win/utility/TwinLoggerMT.h"
 
@@ -25,6 +26,27 @@ extern VOICEBRIDGE_API twinLogger::TwinLoggerMT oTwinLog;
 
 VOICEBRIDGE_API void ReplaceKaldiLogHandlerEx(bool reset = false);
 
+//Sends the Kaldi messages (KALDI_LOG, KALDI_VLOG, KALDI_WARN, KALDI_ERR) of the calling thread to the log file of a
+//job while it exists instead of the global log, i.e. without the lock of TwinLoggerMT. Errors also go to the global
+//log. The file must be open, otherwise nothing changes. The worker threads which the job starts with TaskSequencer or
+//MultiThreader inherit the sink, therefore the messages are serialized with a lock of the sink (one per job, not
+//contended by the other jobs). Create it in the thread of the job, after the log file:
+//	fs::ofstream file_log(log, fs::ofstream::binary | fs::ofstream::out);
+//	KaldiJobLogSink job_log_sink(file_log);
+class VOICEBRIDGE_API KaldiJobLogSink : public kaldi::LogSink
+{
+public:
+	explicit KaldiJobLogSink(fs::ofstream & file_log);
+	~KaldiJobLogSink();
+	bool Log(const kaldi::LogMessageEnvelope &envelope, const char *message);
+
+private:
+	fs::ofstream * file_log_;
+	std::mutex mutex_;
+	kaldi::LogSink * prev_sink_;
+	bool attached_;
+};
+
 //--------------------------------------------------
 
 //write to the output window of VS makro
@@ -47,6 +69,8 @@ VOICEBRIDGE_API StringTable readData(std::string const path, std::string delimit
 VOICEBRIDGE_API int ReadStringTable(std::string const path, StringTable & table, std::string delimiter = " \t");
 VOICEBRIDGE_API int SaveStringTable(std::string const& path, StringTable & table);
 VOICEBRIDGE_API int SortStringTable(StringTable & table, int col1, int col2, std::string type1 = "string", std::string type2 = "string", bool bMakeUnique=false, bool ascend1=true, bool ascend2=true);
+VOICEBRIDGE_API int SortTextFile(fs::path in, fs::path out, int col1, int col2, std::string type1 = "string", std::string type2 = "string", bool bMakeUnique = false, bool ascend1 = true, bool ascend2 = true, size_t max_memory_mb = 512);
+VOICEBRIDGE_API void SplitTableLine(std::string & line, string_vec & row, const std::string & delimiter = " \t");
 VOICEBRIDGE_API std::string GetFirstLineFromFile(std::string path);
 VOICEBRIDGE_API bool IsTheSame(StringTable table1, StringTable table2);
 
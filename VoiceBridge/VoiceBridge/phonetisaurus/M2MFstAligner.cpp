@@ -149,44 +149,69 @@ void M2MFstAligner::expectation() {
 	/*
 	  Here we compute the arc posteriors.  This routine is almost
 	  fun to implement in the FST paradigm.
+
+	  Every thread accumulates into its own dense label indexed array and
+	  total; the partial sums are reduced at the end, so there is no lock
+	  in the arc loop.
 	*/
-	#pragma omp parallel for //num_threads (4)
-	for (signed long long i = 0; i < fsas.size(); i++) {
-		//Compute Forward and Backward probabilities
+	const size_t nlabels = (size_t)isyms->AvailableKey();
+	const int nthreads = omp_get_max_threads();
+	//pre-sized here because OpenMP may run the team with fewer threads
+	vector<vector<LogWeight> > partial_counts(nthreads,
+		vector<LogWeight>(nlabels, LogWeight::Zero()));
+	vector<LogWeight> partial_totals(nthreads, LogWeight::Zero());
+
+	#pragma omp parallel num_threads(nthreads)
+	{
+		const int t = omp_get_thread_num();
+		vector<LogWeight>& counts = partial_counts[t];
+		LogWeight tot = LogWeight::Zero();
 		vector<LogWeight> alpha, beta;
-		ShortestDistance(fsas.at(i), &alpha);
-		ShortestDistance(fsas.at(i), &beta, true);
 
-		//Compute the normalized Gamma probabilities and
-		// update our running tally
-		for (StateIterator<VectorFst<LogArc> > siter(fsas.at(i));
-			!siter.Done(); siter.Next()) {
-			const LogArc::StateId q = siter.Value();
-			for (ArcIterator<VectorFst<LogArc> > aiter(fsas.at(i), q); !aiter.Done(); aiter.Next()) 
-			{
-				const LogArc& arc = aiter.Value();
-				const LogWeight& gamma = Divide(
-					Times(Times(alpha[q], arc.weight), beta[arc.nextstate]), beta[0]
-				);
-				// Check for any BadValue results, otherwise add to the tally.
-				// We call this 'prev_alignment_model' which may seem misleading, but
-				// this conventions leads to 'alignment_model' being the final version.
-				#pragma omp critical
+		#pragma omp for schedule(dynamic, 64)
+		for (signed long long i = 0; i < (signed long long)fsas.size(); i++) {
+			const VectorFst<LogArc>& fsa = fsas[i];
+			//Compute Forward and Backward probabilities
+			alpha.clear();
+			beta.clear();
+			ShortestDistance(fsa, &alpha);
+			ShortestDistance(fsa, &beta, true);
+
+			//Compute the normalized Gamma probabilities and
+			// update our running tally
+			for (StateIterator<VectorFst<LogArc> > siter(fsa);
+				!siter.Done(); siter.Next()) {
+				const LogArc::StateId q = siter.Value();
+				for (ArcIterator<VectorFst<LogArc> > aiter(fsa, q); !aiter.Done(); aiter.Next())
 				{
-					//@-zso if (gamma.Value() == gamma.Value()) 
-					if(gamma.Value() != LogWeight::NoWeight()) //@+zso
-					{
-						prev_alignment_model[arc.ilabel] = Plus(prev_alignment_model[arc.ilabel], gamma);
-						total = Plus(total, gamma);
+					const LogArc& arc = aiter.Value();
+					const LogWeight& gamma = Divide(
+						Times(Times(alpha[q], arc.weight), beta[arc.nextstate]), beta[0]
+					);
+					// Check for any BadValue results, otherwise add to the tally.
+					// We call this 'prev_alignment_model' which may seem misleading, but
+					// this conventions leads to 'alignment_model' being the final version.
+					if (gamma.Member()) {
+						counts[arc.ilabel] = Plus(counts[arc.ilabel], gamma);
+						tot = Plus(tot, gamma);
 					}
 				}
 			}
 		}
+		partial_totals[t] = tot;
+	}
 
-		alpha.clear();
-		beta.clear();
+	//reduce the partial sums
+	em_counts.assign(nlabels, LogWeight::Zero());
+	#pragma omp parallel for
+	for (signed long long l = 0; l < (signed long long)nlabels; l++) {
+		LogWeight sum = LogWeight::Zero();
+		for (int t = 0; t < nthreads; t++)
+			sum = Plus(sum, partial_counts[t][l]);
+		em_counts[l] = sum;
 	}
-	
+	for (int t = 0; t < nthreads; t++)
+		total = Plus(total, partial_totals[t]);
 }
 
 
@@ -302,24 +327,47 @@ float M2MFstAligner::maximization(bool lastiter) {
 	// distinguishing between gaps and insertions, etc.
 	bool cond = false;
 	float change = abs(total.Value() - prevTotal.Value());
+	const size_t nlabels = (size_t)isyms->AvailableKey();
+	map<LogArc::Label, LogWeight>::iterator it;
+
+	//The first call comes directly after the initialization which tallies
+	// into prev_alignment_model (see Sequences2FST).
+	if (em_counts.empty()) {
+		em_counts.assign(nlabels, LogWeight::Zero());
+		for (it = prev_alignment_model.begin();
+			it != prev_alignment_model.end(); it++)
+			em_counts[(*it).first] = (*it).second;
+	}
+
 	if (cond == false) {
-		map<LogArc::Label, LogWeight>::iterator it;
 		prevTotal = total;
 
 		//Normalize and iterate to the next model.  We apply it dynamically
 		// during the expectation step.
+		em_model.assign(nlabels, LogWeight::Zero());
+		#pragma omp parallel for
+		for (signed long long l = 0; l < (signed long long)nlabels; l++)
+			em_model[l] = Divide(em_counts[l], total);
+
 		for (it = prev_alignment_model.begin();
 			it != prev_alignment_model.end(); it++) {
-			alignment_model[(*it).first] = Divide((*it).second, total);
+			alignment_model[(*it).first] = em_model[(*it).first];
 			(*it).second = LogWeight::Zero();
 		}
 	}
 	else {
+		for (it = prev_alignment_model.begin();
+			it != prev_alignment_model.end(); it++)
+			(*it).second = em_counts[(*it).first];
 		_conditional_max(true);
+		em_model.assign(nlabels, LogWeight::Zero());
+		for (it = alignment_model.begin(); it != alignment_model.end(); it++)
+			if ((size_t)(*it).first < nlabels) em_model[(*it).first] = (*it).second;
 	}
+	em_counts.assign(nlabels, LogWeight::Zero());
 
-
-	for (unsigned int i = 0; i < fsas.size(); i++) {
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (signed long long i = 0; i < (signed long long)fsas.size(); i++) {
 		for (StateIterator<VectorFst<LogArc> > siter(fsas[i]);
 			!siter.Done(); siter.Next()) {
 			LogArc::StateId q = siter.Value();
@@ -328,12 +376,16 @@ float M2MFstAligner::maximization(bool lastiter) {
 				LogArc arc = aiter.Value();
 
 				if (penalize_em == true) {
-					LabelDatum* ld = &penalties[arc.ilabel];
-					if (ld->lhs > 1 && ld->rhs > 1) {
-						arc.weight = 99;
-					}
-					else if (ld->lhsE == false && ld->rhsE == false) {
-						arc.weight = arc.weight.Value() * ld->tot;
+					//NOTE: find() because operator[] would insert (not thread safe)
+					LabelData::const_iterator pit = penalties.find(arc.ilabel);
+					if (pit != penalties.end()) {
+						const LabelDatum* ld = &pit->second;
+						if (ld->lhs > 1 && ld->rhs > 1) {
+							arc.weight = 99;
+						}
+						else if (ld->lhsE == false && ld->rhsE == false) {
+							arc.weight = arc.weight.Value() * ld->tot;
+						}
 					}
 					/*
 					  else{
@@ -344,7 +396,7 @@ float M2MFstAligner::maximization(bool lastiter) {
 						arc.weight = 99;
 				}
 				else {
-					arc.weight = alignment_model[arc.ilabel];
+					arc.weight = em_model[arc.ilabel];
 				}
 				aiter.SetValue(arc);
 			}
@@ -94,6 +94,11 @@ class M2MFstAligner {
   LabelData penalties;
   LogWeight total;
   LogWeight prevTotal;
+  // Dense, label indexed (isyms ids) versions of prev_alignment_model and
+  //  alignment_model which are used by the EM iterations. The maps are
+  //  only kept in sync for the model writer and the conditional maximization.
+  vector<LogWeight> em_counts;
+  vector<LogWeight> em_model;
 
   // Constructors
   M2MFstAligner ();
@@ -149,8 +149,9 @@ namespace Phonetisaurus {
 		outtxtfile: output text file
 		forceModel: if true the model will be used for getting the pronunciation; if false the reference dictionary
 					will be used for existing words for getting the pronunciation.
+		nj: number of threads used for the G2P of the word list (0 = number of cores)
 	*/
-	VOICEBRIDGE_API int GetPronunciation(fs::path refDictionary, fs::path model, fs::path intxtfile, fs::path outtxtfile, bool forceModel)
+	VOICEBRIDGE_API int GetPronunciation(fs::path refDictionary, fs::path model, fs::path intxtfile, fs::path outtxtfile, bool forceModel, int nj)
 	{
 		/*
 			Apply the G2P model to a word list
@@ -160,7 +161,8 @@ namespace Phonetisaurus {
 		"--refdict_P=" + refDictionary.string(),
 		"--forcemodel_P=" + bool_as_text(forceModel),
 		"--wordlist_P=" + intxtfile.string(),
-		"--outfile_P=" + outtxtfile.string()
+		"--outfile_P=" + outtxtfile.string(),
+		"--nj_P=" + std::to_string(nj)
 		//Could adjust but not used at the moment: ,"pmass_P=99" ,"nbest_P=3" ,"beam_P=5000"
 		//DEBUG: ,"--write_fsts_P=true"
 		};
@@ -14,6 +14,6 @@
 namespace Phonetisaurus 
 {
 	VOICEBRIDGE_API int TrainModel(fs::path refDictionary, fs::path outModel, int ngramOrder=6);
-	VOICEBRIDGE_API int GetPronunciation(fs::path refDictionary, fs::path model, fs::path intxtfile, fs::path outtxtfile, bool forceModel=true);
+	VOICEBRIDGE_API int GetPronunciation(fs::path refDictionary, fs::path model, fs::path intxtfile, fs::path outtxtfile, bool forceModel=true, int nj=0);
 }
 
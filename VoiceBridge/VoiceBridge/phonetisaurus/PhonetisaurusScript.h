@@ -116,6 +116,8 @@ class PhonetisaurusScript {
   }
 
   // The actual phoneticizer routine
+  // NOTE: the decoder is not modified (all scratch data is local to the call) therefore
+  //       the same decoder and model can be used by several threads at the same time.
   vector<PathData> Phoneticize (const string& word, int nbest = 1,
                       int beam = 10000, float threshold = 99,
                       bool write_fsts = false,
@@ -39,6 +39,8 @@ Based on : Phonetisaurus: Copyright (c) [2012-], Josef Robert Novak, All rights
 #include "PhonetisaurusScript.h"
 #include "utilp.h"
 //#include "iomanip"
+#include <atomic>
+#include <thread>
 
 
 using namespace fst;
@@ -99,19 +101,71 @@ static int PrintPathData(const vector<PathData>& results, string FLAGS_word,
 	}
 }
 
+/*
+	Batch G2P of a word list on a pool of threads.
+	The decoder (and its arc-sorted model) is shared by all threads because Phoneticize() does not modify it; every call
+	builds its own input FSA, lattice and path filter. Duplicate words are decoded only once and words which will be
+	taken from the reference dictionary (forceModel == false) are not decoded at all. The results are written in the
+	order of the input word list.
+*/
 static int EvaluateWordlist(PhonetisaurusScript& decoder, vector<string> corpus,
 	int FLAGS_beam, int FLAGS_nbest, bool FLAGS_reverse,
 	string FLAGS_skip, double FLAGS_thresh, string FLAGS_gsep,
 	bool FLAGS_write_fsts, bool FLAGS_print_scores,
 	bool FLAGS_accumulate, double FLAGS_pmass,
-	bool FLAGS_nlog_probs, fs::ofstream & ofs, bool forceModel, MAPSS & _refdict)
+	bool FLAGS_nlog_probs, fs::ofstream & ofs, bool forceModel, MAPSS & _refdict, int nj)
 {
-	for (int i = 0; i < corpus.size(); i++) {
-		vector<PathData> results = decoder.Phoneticize(corpus[i], FLAGS_nbest,
-			FLAGS_beam, FLAGS_thresh,
-			FLAGS_write_fsts,
-			FLAGS_accumulate, FLAGS_pmass);
-		int ret = PrintPathData(results, corpus[i],
+	//memoize: one decoding per unique word
+	std::unordered_map<std::string, size_t> word2unique;
+	std::vector<std::string> _unique;
+	std::vector<size_t> _corpus2unique(corpus.size());
+	word2unique.reserve(corpus.size());
+	for (size_t i = 0; i < corpus.size(); i++) {
+		auto ins = word2unique.emplace(corpus[i], _unique.size());
+		if (ins.second) _unique.push_back(corpus[i]);
+		_corpus2unique[i] = ins.first->second;
+	}
+	//words which are in the reference dictionary do not need the model
+	std::vector<bool> _needmodel(_unique.size(), true);
+	if (!forceModel && _refdict.size() > 0) {
+		for (size_t u = 0; u < _unique.size(); u++)
+			if (_refdict.find(_unique[u]) != _refdict.end()) _needmodel[u] = false;
+	}
+
+	std::vector<vector<PathData>> _results(_unique.size());
+	std::atomic<size_t> next(0);
+	std::atomic<bool> failed(false);
+	auto worker = [&]() {
+		//NOTE: dynamic scheduling because the decoding time depends a lot on the length of the word
+		for (size_t u = next++; u < _unique.size() && !failed; u = next++) {
+			if (!_needmodel[u]) continue;
+			try {
+				_results[u] = decoder.Phoneticize(_unique[u], FLAGS_nbest,
+					FLAGS_beam, FLAGS_thresh,
+					FLAGS_write_fsts,
+					FLAGS_accumulate, FLAGS_pmass);
+			}
+			catch (const std::exception& e) {
+				LOGTW_ERROR << "Failed to phoneticize '" << _unique[u] << "'. Reason: " << e.what();
+				failed = true;
+			}
+		}
+	};
+	if (nj <= 0) nj = std::max(1, (int)std::thread::hardware_concurrency());
+	//NOTE: writing the debug fst's is not thread safe (file names may collide)
+	if (FLAGS_write_fsts) nj = 1;
+	nj = (int)std::min<size_t>(nj, std::max<size_t>(1, _unique.size()));
+	if (nj == 1) worker();
+	else {
+		std::vector<std::thread> _threads;
+		for (int j = 0; j < nj; j++) _threads.emplace_back(worker);
+		for (auto& t : _threads) t.join();
+	}
+	if (failed) return -1;
+
+	//output in input order
+	for (size_t i = 0; i < corpus.size(); i++) {
+		int ret = PrintPathData(_results[_corpus2unique[i]], corpus[i],
 			decoder.osyms_,
 			ofs,
 			_refdict,
@@ -141,6 +195,7 @@ DEFINE_bool (reverse_P, false, "Reverse input word.");
 DEFINE_bool (print_scores_P, false, "Print scores in output.");
 DEFINE_bool (accumulate_P, false, "Accumulate weights for unique output prons.");
 DEFINE_bool (nlog_probs_P, true, "Default scores vals are negative logs. Otherwise exp (-val).");
+DEFINE_int32 (nj_P, 0, "Number of threads used for a word list (0 = number of cores).");
 
 /*
 	Returns the pronunciation for a word or for a list of words when a trained model and a reference dictionary 
@@ -254,7 +309,7 @@ int G2Pfst(int argc, char* argv[])
 			decoder, corpus, FLAGS_beam_P, FLAGS_nbest_P, FLAGS_reverse_P,
 			FLAGS_skip_P, FLAGS_thresh_P, FLAGS_gsep_P, FLAGS_write_fsts_P,
 			FLAGS_print_scores_P, FLAGS_accumulate_P, FLAGS_pmass_P,
-			FLAGS_nlog_probs_P, ofs, FLAGS_forcemodel_P, _refdict) < 0) return -1;
+			FLAGS_nlog_probs_P, ofs, FLAGS_forcemodel_P, _refdict, FLAGS_nj_P) < 0) return -1;
 	}
 	else {
 		PhonetisaurusScript decoder(FLAGS_model_P, FLAGS_gsep_P);
@@ -18,6 +18,8 @@
 // limitations under the License.
 
 
+#include <thread>
+
 #include "base/kaldi-common.h"
 
 // testing that we get the stack trace.
@@ -38,11 +40,50 @@ void UnitTestError() {
   }
 }
 
+// Collects the messages of its thread; errors are passed on.
+class TestLogSink: public LogSink {
+ public:
+  TestLogSink(): prev_(SetThreadLogSink(this)) { }
+  ~TestLogSink() { SetThreadLogSink(prev_); }
+  virtual bool Log(const LogMessageEnvelope &envelope, const char *message) {
+    messages_.push_back(message);
+    return envelope.severity > LogMessageEnvelope::kError;
+  }
+  std::vector<std::string> messages_;
+ private:
+  LogSink *prev_;
+};
+
+void UnitTestThreadLogSink() {
+  TestLogSink sink;
+  KALDI_LOG << "message 1";
+  KALDI_WARN << "message 2";
+  // the messages of another thread do not go to this sink.
+  std::thread other([]() { KALDI_LOG << "Ignore this message"; });
+  other.join();
+  {
+    TestLogSink inner_sink;
+    KALDI_LOG << "message 3";
+    KALDI_ASSERT(inner_sink.messages_.size() == 1);
+  }
+  bool thrown = false;
+  try {
+    KALDI_ERR << "Ignore this error (message 4)";
+  } catch(std::runtime_error &r) {
+    thrown = true;
+  }
+  KALDI_ASSERT(thrown);
+  KALDI_ASSERT(sink.messages_.size() == 3 &&
+               sink.messages_[0] == "message 1" &&
+               sink.messages_[1] == "message 2" &&
+               sink.messages_[2] == "Ignore this error (message 4)");
+}
 
 }  // end namespace kaldi.
 
 int main() {
   kaldi::g_program_name = "/foo/bar/kaldi-error-test";
+  kaldi::UnitTestThreadLogSink();
   try {
     kaldi::UnitTestError();
     KALDI_ASSERT(0);  // should not happen.
@@ -43,6 +43,8 @@ std::string g_program_name; //@+zso
 
 static LogHandler g_log_handler = NULL;
 
+static thread_local LogSink *g_thread_log_sink = NULL; //@+zso
+
 // If the program name was set (g_program_name != ""), GetProgramName
 // returns the program name (without the path), e.g. "gmm-align".
 // Otherwise it returns the empty string "".
@@ -164,8 +166,12 @@ MessageLogger::~MessageLogger() KALDI_NOEXCEPT(false) {
 
 void MessageLogger::HandleMessage(const LogMessageEnvelope &envelope,
                                   const char *message) {
-  // Send to a logging handler if provided.
-  if (g_log_handler != NULL) {
+  // Send to the sink of this thread if provided, and to the logging handler
+  // if the sink does not consume the message. //@+zso
+  if (g_thread_log_sink != NULL &&
+      g_thread_log_sink->Log(envelope, message)) {
+    // consumed by the sink of this thread.
+  } else if (g_log_handler != NULL) {
     g_log_handler(envelope, message);
   } else {
     // Otherwise, we use the default Kaldi logging.
@@ -246,4 +252,14 @@ LogHandler SetLogHandler(LogHandler new_handler) {
   return old_handler;
 }
 
+LogSink *SetThreadLogSink(LogSink *new_sink) { //@+zso
+  LogSink *old_sink = g_thread_log_sink;
+  g_thread_log_sink = new_sink;
+  return old_sink;
+}
+
+LogSink *GetThreadLogSink() { //@+zso
+  return g_thread_log_sink;
+}
+
 }  // end namespace kaldi
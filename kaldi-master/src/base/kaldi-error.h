@@ -196,6 +196,29 @@ typedef void (*LogHandler)(const LogMessageEnvelope &envelope,
 /// stderr.  SetLogHandler is obviously not thread safe.
 LogHandler SetLogHandler(LogHandler);
 
+/***** THREAD-LOCAL LOG SINK *****/ //@+zso
+
+/// Per-thread destination of the log messages, e.g. the log file of a job
+/// which runs in a thread of its own.  Unlike the log handler it is only used
+/// by the thread which set it and by the worker threads which that thread
+/// starts with TaskSequencer or MultiThreader (util/kaldi-thread.h), which
+/// inherit it; a sink which is used with those must therefore be thread safe.
+class LogSink {
+ public:
+  /// Returns true if the message is consumed; otherwise it is passed on to the
+  /// log handler (SetLogHandler) or printed to stderr as usual.  Errors are
+  /// thrown (and failed asserts abort) after this in both cases.
+  virtual bool Log(const LogMessageEnvelope &envelope, const char *message) = 0;
+  virtual ~LogSink() { }
+};
+
+/// Sets the sink of the calling thread (NULL for none) and returns the
+/// previous one, which should be restored when the sink is destroyed.
+LogSink *SetThreadLogSink(LogSink *sink);
+
+/// Returns the sink of the calling thread (NULL if none).
+LogSink *GetThreadLogSink();
+
 /// @} end "addtogroup error_group"
 
 }  // namespace kaldi
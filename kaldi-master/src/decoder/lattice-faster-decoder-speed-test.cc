@@ -0,0 +1,181 @@
+// decoder/lattice-faster-decoder-speed-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "base/timer.h"
+
+// Counts the heap allocations of the whole program, so that we can see how
+// many of them the decoder makes per frame.  The replacements are kept out of
+// line: if the compiler inlines them it sees std::free() called on memory from
+// operator new and warns (-Wmismatched-new-delete).
+static std::atomic<size_t> g_num_allocations(0);
+
+#if defined(__GNUC__)
+#define SPEED_TEST_NOINLINE __attribute__((noinline))
+#else
+#define SPEED_TEST_NOINLINE
+#endif
+
+SPEED_TEST_NOINLINE void *operator new(size_t size) {
+  g_num_allocations++;
+  void *p = std::malloc(size > 0 ? size : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+SPEED_TEST_NOINLINE void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+namespace kaldi {
+
+static void CsvResult(std::string test, int dim, BaseFloat measure, std::string units) {
+  std::cout << test << "," << dim << "," << measure << "," << units << "\n";
+}
+
+// A random looping graph without epsilon cycles (the epsilon arcs always go to
+// a higher numbered state).
+static fst::VectorFst<fst::StdArc> *RandomDecodingGraph(int32 num_states,
+                                                        int32 num_arcs,
+                                                        int32 num_pdfs) {
+  typedef fst::StdArc Arc;
+  fst::VectorFst<Arc> *fst = new fst::VectorFst<Arc>();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 a = 0; a < num_arcs; a++)
+      fst->AddArc(s, Arc(RandInt(1, num_pdfs), RandInt(0, 100),
+                         3.0 * RandUniform(), RandInt(0, num_states - 1)));
+    if (s + 1 < num_states && RandInt(0, 4) == 0)
+      fst->AddArc(s, Arc(0, RandInt(1, 100), 2.0 * RandUniform(),
+                         RandInt(s + 1, num_states - 1)));
+    if (RandInt(0, 9) == 0)
+      fst->SetFinal(s, RandUniform());
+  }
+  return fst;
+}
+
+// Decodes 3 utterances with "fst" and returns the best path of the first one;
+// checks that the others give the same best path.
+static Lattice DecodeUtterances(const fst::Fst<fst::StdArc> &fst,
+                                const LatticeFasterDecoderConfig &config,
+                                const Matrix<BaseFloat> &loglikes,
+                                const std::string &name) {
+  LatticeFasterDecoder decoder(fst, config);
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  int32 num_frames = loglikes.NumRows();
+
+  Lattice first_best_path;
+  for (int32 utt = 0; utt < 3; utt++) {
+    // the first utterance grows the token and link pools; the next ones
+    // should only allocate for the hash and the lattice.
+    size_t num_allocations = g_num_allocations;
+    Timer timer;
+    KALDI_ASSERT(decoder.Decode(&decodable));
+    double elapsed = timer.Elapsed();
+    num_allocations = g_num_allocations - num_allocations;
+    std::string utt_name = name + " utt " + std::to_string(utt);
+    CsvResult(utt_name + " frames/sec", num_frames, num_frames / elapsed, "frames/second");
+    CsvResult(utt_name + " allocations/frame", num_frames,
+              static_cast<BaseFloat>(num_allocations) / num_frames, "allocations");
+
+    // the reuse of the pools must not change the result.  [note: the raw
+    // lattices may differ slightly because the size of the hash is kept from
+    // the previous utterance, but the best path must be the same.]
+    Lattice best_path;
+    KALDI_ASSERT(decoder.GetBestPath(&best_path));
+    if (utt == 0)
+      first_best_path = best_path;
+    else if (!config.Adaptive())  // the adaptive mode depends on the timing.
+      KALDI_ASSERT(fst::Equal(best_path, first_best_path));
+  }
+  if (config.Adaptive()) {
+    const LatticeFasterDecoderAdaptStats &stats = decoder.AdaptStats();
+    KALDI_ASSERT(stats.num_frames == 3 * num_frames);
+    KALDI_ASSERT(stats.min_beam >= config.min_beam &&
+                 stats.tot_beam <= stats.num_frames * config.beam + 0.01);
+    std::ostringstream os;
+    stats.Print(os);
+    KALDI_LOG << name << ": " << os.str();
+    CsvResult(name + " average beam", num_frames,
+              stats.tot_beam / stats.num_frames, "beam");
+  }
+  return first_best_path;
+}
+
+// Compares the best path of two graphs which differ only in the numbering of
+// the states: the word and transition-id sequences and the cost must match.
+static void AssertSameBestPath(const Lattice &a, const Lattice &b) {
+  std::vector<int32> alignment_a, words_a, alignment_b, words_b;
+  LatticeWeight weight_a, weight_b;
+  KALDI_ASSERT(fst::GetLinearSymbolSequence(a, &alignment_a, &words_a, &weight_a));
+  KALDI_ASSERT(fst::GetLinearSymbolSequence(b, &alignment_b, &words_b, &weight_b));
+  KALDI_ASSERT(alignment_a == alignment_b && words_a == words_b);
+  KALDI_ASSERT(ApproxEqual(weight_a.Value1() + weight_a.Value2(),
+                           weight_b.Value1() + weight_b.Value2()));
+}
+
+static void UnitTestLatticeFasterDecoderSpeed() {
+  int32 num_states = 5000, num_arcs = 10, num_pdfs = 500, num_frames = 300;
+  fst::VectorFst<fst::StdArc> *fst = RandomDecodingGraph(num_states, num_arcs,
+                                                         num_pdfs);
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+  loglikes.SetRandn();
+  loglikes.Scale(2.0);
+
+  fst::ConstFst<fst::StdArc> const_fst(*fst);
+  fst::PackedFst packed_fst(*fst, true);
+  delete fst;
+
+  LatticeFasterDecoderConfig config;
+  config.beam = 13.0;
+  config.max_active = 7000;
+  config.lattice_beam = 8.0;
+  Lattice const_best_path = DecodeUtterances(const_fst, config, loglikes,
+                                             "LatticeFasterDecoder const"),
+      packed_best_path = DecodeUtterances(packed_fst, config, loglikes,
+                                          "LatticeFasterDecoder packed");
+  AssertSameBestPath(const_best_path, packed_best_path);
+
+  // latency-bounded mode: a token budget, and a real-time factor target.
+  LatticeFasterDecoderConfig adaptive_config(config);
+  adaptive_config.target_active = 1000;
+  adaptive_config.min_beam = 6.0;
+  DecodeUtterances(packed_fst, adaptive_config, loglikes,
+                   "LatticeFasterDecoder target-active=1000");
+  adaptive_config.target_active = 0;
+  adaptive_config.target_rtf = 0.5;
+  DecodeUtterances(packed_fst, adaptive_config, loglikes,
+                   "LatticeFasterDecoder target-rtf=0.5");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  Timer t;
+  UnitTestLatticeFasterDecoderSpeed();
+  KALDI_LOG << "Tests succeeded, total duration " << t.Elapsed() << " seconds.";
+}
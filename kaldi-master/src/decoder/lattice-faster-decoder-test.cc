@@ -0,0 +1,119 @@
+// decoder/lattice-faster-decoder-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/lattice-faster-online-decoder.h"
+#include "decoder/decodable-matrix.h"
+
+namespace kaldi {
+
+// A random looping graph without epsilon cycles (the epsilon arcs always go to
+// a higher numbered state).
+static fst::VectorFst<fst::StdArc> *RandomDecodingGraph(int32 num_states,
+                                                        int32 num_arcs,
+                                                        int32 num_pdfs,
+                                                        int32 num_words) {
+  typedef fst::StdArc Arc;
+  fst::VectorFst<Arc> *fst = new fst::VectorFst<Arc>();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 a = 0; a < num_arcs; a++)
+      fst->AddArc(s, Arc(RandInt(1, num_pdfs), RandInt(0, num_words),
+                         3.0 * RandUniform(), RandInt(0, num_states - 1)));
+    if (s + 1 < num_states && RandInt(0, 2) == 0)
+      fst->AddArc(s, Arc(0, RandInt(1, num_words), 2.0 * RandUniform(),
+                         RandInt(s + 1, num_states - 1)));
+    if (RandInt(0, 4) == 0)
+      fst->SetFinal(s, RandUniform());
+  }
+  fst->SetFinal(num_states - 1, 0.0);
+  return fst;
+}
+
+template<class Decoder>
+static void DecodeBestPath(const fst::Fst<fst::StdArc> &fst,
+                           const Matrix<BaseFloat> &loglikes,
+                           Lattice *best_path) {
+  LatticeFasterDecoderConfig config;
+  config.beam = 12.0;
+  config.lattice_beam = 6.0;
+  Decoder decoder(fst, config);
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  KALDI_ASSERT(decoder.Decode(&decodable));
+  KALDI_ASSERT(decoder.GetBestPath(best_path));
+}
+
+static void AssertSameBestPath(const Lattice &a, const Lattice &b) {
+  std::vector<int32> alignment_a, words_a, alignment_b, words_b;
+  LatticeWeight weight_a, weight_b;
+  KALDI_ASSERT(fst::GetLinearSymbolSequence(a, &alignment_a, &words_a, &weight_a));
+  KALDI_ASSERT(fst::GetLinearSymbolSequence(b, &alignment_b, &words_b, &weight_b));
+  KALDI_ASSERT(!alignment_a.empty());
+  KALDI_ASSERT(alignment_a == alignment_b && words_a == words_b);
+  KALDI_ASSERT(ApproxEqual(weight_a.Value1() + weight_a.Value2(),
+                           weight_b.Value1() + weight_b.Value2()));
+}
+
+// Decodes through a lazy ComposeFst, as gmm-latgen-faster does with
+// --lookahead-g, and checks the result against the expanded graph.  The right
+// hand side of the composition is a single state word loop, so the composed
+// graph is equivalent to the left hand side.  This exercises the generic
+// Fst<Arc> branch of the decoders, which must not assume a ConstFst.
+template<class Decoder>
+static void UnitTestDecodeComposeFst() {
+  typedef fst::StdArc Arc;
+  int32 num_states = RandInt(20, 200), num_pdfs = 30, num_words = 20,
+      num_frames = RandInt(10, 50);
+  fst::VectorFst<Arc> *hcl = RandomDecodingGraph(num_states, RandInt(2, 6),
+                                                 num_pdfs, num_words);
+  fst::ArcSort(hcl, fst::OLabelCompare<Arc>());
+
+  fst::VectorFst<Arc> g;
+  g.AddState();
+  g.SetStart(0);
+  g.SetFinal(0, Arc::Weight::One());
+  for (int32 w = 1; w <= num_words; w++)
+    g.AddArc(0, Arc(w, w, Arc::Weight::One(), 0));
+
+  fst::ComposeFst<Arc> hclg(*hcl, g);
+  KALDI_ASSERT(hclg.Type() != "const" && hclg.Type() != "vector");
+  fst::ConstFst<Arc> const_hcl(*hcl);
+  delete hcl;
+
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+  loglikes.SetRandn();
+
+  Lattice compose_best_path, const_best_path;
+  DecodeBestPath<Decoder>(hclg, loglikes, &compose_best_path);
+  DecodeBestPath<Decoder>(const_hcl, loglikes, &const_best_path);
+  AssertSameBestPath(compose_best_path, const_best_path);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestDecodeComposeFst<LatticeFasterDecoder>();
+    UnitTestDecodeComposeFst<LatticeFasterOnlineDecoder>();
+  }
+  KALDI_LOG << "Tests succeeded.";
+}
@@ -33,7 +33,10 @@ namespace kaldi {
 // instantiate this class once for each thing you have to decode.
 LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
                                            const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(fst), delete_fst_(false), config_(config), num_toks_(0),
+    cur_beam_(config.beam), cur_max_active_(config.max_active),
+    last_tok_count_(0), last_max_active_limited_(false),
+    last_adaptive_beam_(config.beam), sec_per_token_(0.0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -41,7 +44,10 @@ LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
 
 LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &config,
                                            fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0),
+    cur_beam_(config.beam), cur_max_active_(config.max_active),
+    last_tok_count_(0), last_max_active_limited_(false),
+    last_adaptive_beam_(config.beam), sec_per_token_(0.0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -62,10 +68,14 @@ void LatticeFasterDecoder::InitDecoding() {
   num_toks_ = 0;
   decoding_finalized_ = false;
   final_costs_.clear();
+  // each utterance starts with the full beam; in the adaptive mode the
+  // max-active follows from the time per token measured so far.
+  cur_beam_ = config_.beam;
+  cur_max_active_ = config_.Adaptive() ? TokenBudget() : config_.max_active;
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL);
+  Token *start_tok = token_pool_.New(Token(0.0, 0.0, NULL, NULL));
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -85,8 +95,7 @@ bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
   while (!decodable->IsLastFrame(NumFramesDecoded() - 1)) {
     if (NumFramesDecoded() % config_.prune_interval == 0)
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
-    BaseFloat cost_cutoff = ProcessEmittingWrapper(decodable);
-    ProcessNonemittingWrapper(cost_cutoff);
+    DecodeFrame(decodable);
   }
   FinalizeDecoding();
 
@@ -268,7 +277,7 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks);
+    Token *new_tok = token_pool_.New(Token(tot_cost, extra_cost, NULL, toks));
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -341,7 +350,7 @@ void LatticeFasterDecoder::PruneForwardLinks(
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Delete(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -428,7 +437,7 @@ void LatticeFasterDecoder::PruneForwardLinksFinal() {
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Delete(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -487,7 +496,7 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame_plus_one) {
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      token_pool_.Delete(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -589,11 +598,86 @@ void LatticeFasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
     if (NumFramesDecoded() % config_.prune_interval == 0) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     }
-    BaseFloat cost_cutoff = ProcessEmittingWrapper(decodable);
-    ProcessNonemittingWrapper(cost_cutoff);
+    DecodeFrame(decodable);
   }
 }
 
+void LatticeFasterDecoder::DecodeFrame(DecodableInterface *decodable) {
+  bool adaptive = config_.Adaptive();
+  if (adaptive) frame_timer_.Reset();
+  BaseFloat cost_cutoff = ProcessEmittingWrapper(decodable);
+  ProcessNonemittingWrapper(cost_cutoff);
+  if (adaptive) AdaptPruning(frame_timer_.Elapsed());
+}
+
+int32 LatticeFasterDecoder::TokenBudget() const {
+  double budget = config_.max_active;
+  if (config_.target_active > 0)
+    budget = std::min(budget, static_cast<double>(config_.target_active));
+  if (config_.target_rtf > 0.0 && sec_per_token_ > 0.0)  // 100 frames/sec.
+    budget = std::min(budget, config_.target_rtf * 0.01 / sec_per_token_);
+  // max-active must stay above min-active (and above 1, see Check()).
+  return static_cast<int32>(std::max(budget,
+                                     std::max(config_.min_active, 2) + 1.0));
+}
+
+void LatticeFasterDecoder::AdaptPruning(double frame_seconds) {
+  LatticeFasterDecoderAdaptStats &stats = adapt_stats_;
+  stats.num_frames++;
+  stats.tot_beam += cur_beam_;
+  stats.min_beam = std::min(stats.min_beam, cur_beam_);
+  stats.tot_max_active += cur_max_active_;
+  stats.min_max_active = std::min(stats.min_max_active, cur_max_active_);
+  stats.tot_tokens += last_tok_count_;
+  stats.max_tokens = std::max(stats.max_tokens,
+                              static_cast<int64>(last_tok_count_));
+  stats.tot_seconds += frame_seconds;
+
+  // The tokens beyond max-active were pruned without expanding them, so they
+  // cost next to nothing; the time is attributed to the others.
+  size_t num_expanded = std::min(last_tok_count_,
+                                 static_cast<size_t>(cur_max_active_));
+  if (config_.target_rtf > 0.0 && num_expanded > 0) {
+    double sec_per_token = frame_seconds / num_expanded;
+    sec_per_token_ = (sec_per_token_ == 0.0 ? sec_per_token :
+                      0.9 * sec_per_token_ + 0.1 * sec_per_token);
+  }
+  cur_max_active_ = TokenBudget();
+
+  if (last_max_active_limited_) {
+    // the budget was reached: continue with the beam which max-active implied
+    // on this frame, so the next frames expand fewer tokens to begin with.
+    stats.num_limited_frames++;
+    BaseFloat beam = std::max(std::min(config_.min_beam, config_.beam),
+                              last_adaptive_beam_);
+    if (beam < cur_beam_) {
+      cur_beam_ = beam;
+      stats.num_beam_decreases++;
+    }
+  } else if (cur_beam_ < config_.beam &&
+             last_tok_count_ < static_cast<size_t>(cur_max_active_ / 2)) {
+    cur_beam_ = std::min(config_.beam, cur_beam_ + config_.beam_delta);
+    stats.num_beam_increases++;
+  }
+  KALDI_VLOG(6) << "Adapted beam on frame " << NumFramesDecoded() << " is "
+                << cur_beam_ << ", max-active " << cur_max_active_;
+}
+
+void LatticeFasterDecoderAdaptStats::Print(std::ostream &os) const {
+  if (num_frames == 0) {
+    os << "Adaptive beam: no frames decoded.";
+    return;
+  }
+  os << "Adaptive beam: over " << num_frames << " frames, average beam "
+     << (tot_beam / num_frames) << " (min " << min_beam << "), average max-active "
+     << (tot_max_active / num_frames) << " (min " << min_max_active
+     << "), average active tokens " << (tot_tokens / num_frames) << " (max "
+     << max_tokens << "); token budget reached on " << num_limited_frames
+     << " frames, beam decreased " << num_beam_decreases << " and increased "
+     << num_beam_increases << " times; real-time factor assuming 100 frames/sec "
+     << (tot_seconds * 100.0 / num_frames) << ".";
+}
+
 // FinalizeDecoding() is a version of PruneActiveTokens that we call
 // (optionally) on the final frame.  Takes into account the final-prob of
 // tokens.  This function used to be called PruneActiveTokensFinal().
@@ -620,7 +704,8 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
   // positive == high cost == bad.
   size_t count = 0;
-  if (config_.max_active == std::numeric_limits<int32>::max() &&
+  last_max_active_limited_ = false;
+  if (cur_max_active_ == std::numeric_limits<int32>::max() &&
       config_.min_active == 0) {
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       BaseFloat w = static_cast<BaseFloat>(e->val->tot_cost);
@@ -630,8 +715,9 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
-    return best_weight + config_.beam;
+    last_tok_count_ = count;
+    if (adaptive_beam != NULL) *adaptive_beam = cur_beam_;
+    return best_weight + cur_beam_;
   } else {
     tmp_array_.clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
@@ -643,23 +729,26 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       }
     }
     if (tok_count != NULL) *tok_count = count;
+    last_tok_count_ = count;
 
-    BaseFloat beam_cutoff = best_weight + config_.beam,
+    BaseFloat beam_cutoff = best_weight + cur_beam_,
         min_active_cutoff = std::numeric_limits<BaseFloat>::infinity(),
         max_active_cutoff = std::numeric_limits<BaseFloat>::infinity();
 
     KALDI_VLOG(6) << "Number of tokens active on frame " << NumFramesDecoded()
                   << " is " << tmp_array_.size();
 
-    if (tmp_array_.size() > static_cast<size_t>(config_.max_active)) {
+    if (tmp_array_.size() > static_cast<size_t>(cur_max_active_)) {
       std::nth_element(tmp_array_.begin(),
-                       tmp_array_.begin() + config_.max_active,
+                       tmp_array_.begin() + cur_max_active_,
                        tmp_array_.end());
-      max_active_cutoff = tmp_array_[config_.max_active];
+      max_active_cutoff = tmp_array_[cur_max_active_];
     }
     if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
+      last_max_active_limited_ = true;
+      last_adaptive_beam_ = max_active_cutoff - best_weight + config_.beam_delta;
       if (adaptive_beam)
-        *adaptive_beam = max_active_cutoff - best_weight + config_.beam_delta;
+        *adaptive_beam = last_adaptive_beam_;
       return max_active_cutoff;
     }
     if (tmp_array_.size() > static_cast<size_t>(config_.min_active)) {
@@ -667,8 +756,8 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       else {
         std::nth_element(tmp_array_.begin(),
                          tmp_array_.begin() + config_.min_active,
-                         tmp_array_.size() > static_cast<size_t>(config_.max_active) ?
-                         tmp_array_.begin() + config_.max_active :
+                         tmp_array_.size() > static_cast<size_t>(cur_max_active_) ?
+                         tmp_array_.begin() + cur_max_active_ :
                          tmp_array_.end());
         min_active_cutoff = tmp_array_[config_.min_active];
       }
@@ -678,12 +767,76 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
         *adaptive_beam = min_active_cutoff - best_weight + config_.beam_delta;
       return min_active_cutoff;
     } else {
-      *adaptive_beam = config_.beam;
+      if (adaptive_beam)
+        *adaptive_beam = cur_beam_;
       return beam_cutoff;
     }
   }
 }
 
+// Arc iteration for ProcessEmitting() and ProcessNonemitting(): calls
+// f(ilabel, olabel, graph_cost, nextstate) for each emitting (ilabel != 0) or
+// each input-epsilon arc of "state".  The generic version uses the arc
+// iterator of FstType and skips the other kind of arcs.
+template <typename FstType>
+struct DecoderArcs {
+  typedef typename FstType::Arc Arc;
+  typedef typename Arc::StateId StateId;
+
+  template <typename F>
+  static inline void ForEachEmitting(const FstType &fst, StateId state, F f) {
+    for (fst::ArcIterator<FstType> aiter(fst, state);
+         !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0)
+        f(arc.ilabel, arc.olabel, arc.weight.Value(), arc.nextstate);
+    }
+  }
+
+  template <typename F>
+  static inline void ForEachNonemitting(const FstType &fst, StateId state, F f) {
+    for (fst::ArcIterator<FstType> aiter(fst, state);
+         !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel == 0)
+        f(arc.ilabel, arc.olabel, arc.weight.Value(), arc.nextstate);
+    }
+  }
+};
+
+// The packed decoding graph (fstext/packed-fst.h) stores the input-epsilon
+// arcs of a state before its emitting arcs, so each kind is a contiguous range
+// of the arc arrays and we loop over it directly.
+template <>
+struct DecoderArcs<fst::PackedFst> {
+  typedef fst::PackedFst::StateId StateId;
+
+  template <typename F>
+  static inline void ForEachEmitting(const fst::PackedFst &fst, StateId state,
+                                     F f) {
+    const fst::PackedFst::Label *ilabels = fst.ILabels(),
+        *olabels = fst.OLabels();
+    const float *weights = fst.Weights();
+    const StateId *nextstates = fst.NextStates();
+    for (size_t a = fst.EmittingArcsBegin(state), end = fst.ArcsEnd(state);
+         a < end; a++)
+      f(ilabels[a], olabels[a], weights[a], nextstates[a]);
+  }
+
+  template <typename F>
+  static inline void ForEachNonemitting(const fst::PackedFst &fst,
+                                        StateId state, F f) {
+    const fst::PackedFst::Label *olabels = fst.OLabels();
+    const float *weights = fst.Weights();
+    const StateId *nextstates = fst.NextStates();
+    for (size_t a = fst.ArcsBegin(state), end = fst.EmittingArcsBegin(state);
+         a < end; a++)
+      f(0, olabels[a], weights[a], nextstates[a]);
+  }
+};
+
 template <typename FstType>
 BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   KALDI_ASSERT(active_toks_.size() > 0);
@@ -718,17 +871,14 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
     cost_offset = - tok->tot_cost;
-    for (fst::ArcIterator<FstType> aiter(fst, state);
-         !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      if (arc.ilabel != 0) {  // propagate..
-        BaseFloat new_weight = arc.weight.Value() + cost_offset - 
-            decodable->LogLikelihood(frame, arc.ilabel) + tok->tot_cost;
-        if (new_weight + adaptive_beam < next_cutoff)
-          next_cutoff = new_weight + adaptive_beam;
-      }
-    }
+    DecoderArcs<FstType>::ForEachEmitting(fst, state,
+        [&](Label ilabel, Label olabel, BaseFloat graph_cost,
+            StateId nextstate) {
+      BaseFloat new_weight = graph_cost + cost_offset -
+          decodable->LogLikelihood(frame, ilabel) + tok->tot_cost;
+      if (new_weight + adaptive_beam < next_cutoff)
+        next_cutoff = new_weight + adaptive_beam;
+    });
   }
 
   // Store the offset on the acoustic likelihoods that we're applying.
@@ -745,30 +895,25 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <= cur_cutoff) {
-      for (fst::ArcIterator<FstType> aiter(fst, state);
-           !aiter.Done();
-           aiter.Next()) {
-        const Arc &arc = aiter.Value();
-        if (arc.ilabel != 0) {  // propagate..
-          BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame, arc.ilabel),
-              graph_cost = arc.weight.Value(),
-              cur_cost = tok->tot_cost,
-              tot_cost = cur_cost + ac_cost + graph_cost;
-          if (tot_cost > next_cutoff) continue;
-          else if (tot_cost + adaptive_beam < next_cutoff)
-            next_cutoff = tot_cost + adaptive_beam; // prune by best current token
-          // Note: the frame indexes into active_toks_ are one-based,
-          // hence the + 1.
-          Token *next_tok = FindOrAddToken(arc.nextstate,
-                                           frame + 1, tot_cost, NULL);
-          // NULL: no change indicator needed
-
-          // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLink(next_tok, arc.ilabel, arc.olabel,
-                                       graph_cost, ac_cost, tok->links);
-        }
-      } // for all arcs
+      DecoderArcs<FstType>::ForEachEmitting(fst, state,
+          [&](Label ilabel, Label olabel, BaseFloat graph_cost,
+              StateId nextstate) {  // propagate..
+        BaseFloat ac_cost = cost_offset -
+            decodable->LogLikelihood(frame, ilabel),
+            cur_cost = tok->tot_cost,
+            tot_cost = cur_cost + ac_cost + graph_cost;
+        if (tot_cost > next_cutoff) return;
+        else if (tot_cost + adaptive_beam < next_cutoff)
+          next_cutoff = tot_cost + adaptive_beam; // prune by best current token
+        // Note: the frame indexes into active_toks_ are one-based,
+        // hence the + 1.
+        Token *next_tok = FindOrAddToken(nextstate, frame + 1, tot_cost, NULL);
+        // NULL: no change indicator needed
+
+        // Add ForwardLink from tok to next_tok (put on head of list tok->links)
+        tok->links = link_pool_.New(ForwardLink(next_tok, ilabel, olabel,
+                                                graph_cost, ac_cost, tok->links));
+      });  // for all emitting arcs
     }
     e_tail = e->tail;
     toks_.Delete(e); // delete Elem
@@ -783,11 +928,16 @@ template BaseFloat LatticeFasterDecoder::ProcessEmitting<fst::VectorFst<fst::Std
 template BaseFloat LatticeFasterDecoder::ProcessEmitting<fst::Fst<fst::StdArc>>(
         DecodableInterface *decodable);
 
+template BaseFloat LatticeFasterDecoder::ProcessEmitting<fst::PackedFst>(
+        DecodableInterface *decodable);
+
 BaseFloat LatticeFasterDecoder::ProcessEmittingWrapper(DecodableInterface *decodable) {
   if (fst_.Type() == "const") {
     return LatticeFasterDecoder::ProcessEmitting<fst::ConstFst<Arc>>(decodable);
   } else if (fst_.Type() == "vector") {
     return LatticeFasterDecoder::ProcessEmitting<fst::VectorFst<Arc>>(decodable);
+  } else if (fst_.Type() == "packed") {
+    return LatticeFasterDecoder::ProcessEmitting<fst::PackedFst>(decodable);
   } else {
     return LatticeFasterDecoder::ProcessEmitting<fst::Fst<Arc>>(decodable);
   }
@@ -830,30 +980,26 @@ void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
     // but since most states are emitting it's not a huge issue.
-    tok->DeleteForwardLinks(); // necessary when re-visiting
+    tok->DeleteForwardLinks(&link_pool_); // necessary when re-visiting
     tok->links = NULL;
-    for (fst::ArcIterator<FstType> aiter(fst, state);
-         !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      if (arc.ilabel == 0) {  // propagate nonemitting only...
-        BaseFloat graph_cost = arc.weight.Value(),
-            tot_cost = cur_cost + graph_cost;
-        if (tot_cost < cutoff) {
-          bool changed;
-
-          Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
-                                          &changed);
-
-          tok->links = new ForwardLink(new_tok, 0, arc.olabel,
-                                       graph_cost, 0, tok->links);
-
-          // "changed" tells us whether the new token has a different
-          // cost from before, or is new [if so, add into queue].
-          if (changed) queue_.push_back(arc.nextstate);
-        }
+    DecoderArcs<FstType>::ForEachNonemitting(fst, state,
+        [&](Label ilabel, Label olabel, BaseFloat graph_cost,
+            StateId nextstate) {  // propagate nonemitting only...
+      BaseFloat tot_cost = cur_cost + graph_cost;
+      if (tot_cost < cutoff) {
+        bool changed;
+
+        Token *new_tok = FindOrAddToken(nextstate, frame + 1, tot_cost,
+                                        &changed);
+
+        tok->links = link_pool_.New(ForwardLink(new_tok, 0, olabel,
+                                                graph_cost, 0, tok->links));
+
+        // "changed" tells us whether the new token has a different
+        // cost from before, or is new [if so, add into queue].
+        if (changed) queue_.push_back(nextstate);
       }
-    } // for all arcs
+    });  // for all nonemitting arcs
   } // while queue not empty
 }
 
@@ -864,13 +1010,18 @@ template void LatticeFasterDecoder::ProcessNonemitting<fst::VectorFst<fst::StdAr
 template void LatticeFasterDecoder::ProcessNonemitting<fst::Fst<fst::StdArc>>(
         BaseFloat cutoff);
 
+template void LatticeFasterDecoder::ProcessNonemitting<fst::PackedFst>(
+        BaseFloat cutoff);
+
 void LatticeFasterDecoder::ProcessNonemittingWrapper(BaseFloat cost_cutoff) {
   if (fst_.Type() == "const") {
     return LatticeFasterDecoder::ProcessNonemitting<fst::ConstFst<Arc>>(cost_cutoff);
   } else if (fst_.Type() == "vector") {
     return LatticeFasterDecoder::ProcessNonemitting<fst::VectorFst<Arc>>(cost_cutoff);
+  } else if (fst_.Type() == "packed") {
+    return LatticeFasterDecoder::ProcessNonemitting<fst::PackedFst>(cost_cutoff);
   } else {
-    return LatticeFasterDecoder::ProcessNonemitting<fst::ConstFst<Arc>>(cost_cutoff);
+    return LatticeFasterDecoder::ProcessNonemitting<fst::Fst<Arc>>(cost_cutoff);
   }
 }
 
@@ -882,19 +1033,13 @@ void LatticeFasterDecoder::DeleteElems(Elem *list) {
 }
 
 void LatticeFasterDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      tok->DeleteForwardLinks();
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
-  }
+  // All tokens alive on any frame, and their forward links, are owned by the
+  // pools, so we release them at once instead of deleting them one by one.
+  KALDI_ASSERT(token_pool_.NumInUse() == num_toks_);
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
+  token_pool_.Clear();
+  link_pool_.Clear();
+  num_toks_ = 0;
 }
 
 // static
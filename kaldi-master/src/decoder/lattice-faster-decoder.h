@@ -30,11 +30,13 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/slab-allocator.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
+#include "base/timer.h"
 
 namespace kaldi {
 
@@ -51,6 +53,12 @@ struct LatticeFasterDecoderConfig {
   BaseFloat prune_scale;   // Note: we don't make this configurable on the command line,
                            // it's not a very important parameter.  It affects the
                            // algorithm that prunes the tokens as we go.
+  // Latency-bounded (adaptive) mode: if target_rtf or target_active is set,
+  // "beam" and "max_active" are upper limits and the decoder adapts the
+  // values it uses frame by frame (see LatticeFasterDecoder::AdaptPruning()).
+  BaseFloat target_rtf;
+  int32 target_active;
+  BaseFloat min_beam;
   // Most of the options inside det_opts are not actually queried by the
   // LatticeFasterDecoder class itself, but by the code that calls it, for
   // example in the function DecodeUtteranceLatticeFaster.
@@ -64,7 +72,10 @@ struct LatticeFasterDecoderConfig {
                                 determinize_lattice(true),
                                 beam_delta(0.5),
                                 hash_ratio(2.0),
-                                prune_scale(0.1) { }
+                                prune_scale(0.1),
+                                target_rtf(0.0),
+                                target_active(0),
+                                min_beam(6.0) { }
   void Register(OptionsItf *opts) {
     det_opts.Register(opts);
     opts->Register("beam", &beam, "Decoding beam.  Larger->slower, more accurate.");
@@ -83,14 +94,66 @@ struct LatticeFasterDecoderConfig {
                    "max-active constraint is applied.  Larger is more accurate.");
     opts->Register("hash-ratio", &hash_ratio, "Setting used in decoder to "
                    "control hash behavior");
+    opts->Register("target-rtf", &target_rtf, "If > 0, adapt the beam and "
+                   "max-active frame by frame so that the decoding time per frame "
+                   "stays within this real-time factor (assuming 100 frames/sec); "
+                   "--beam and --max-active are then upper limits.");
+    opts->Register("target-active", &target_active, "If > 0, adapt the beam and "
+                   "max-active frame by frame so that about this many tokens are "
+                   "active per frame (--max-active is then an upper limit).");
+    opts->Register("min-beam", &min_beam, "Lower limit of the beam in the "
+                   "adaptive mode (--target-rtf or --target-active).");
   }
+  bool Adaptive() const { return target_rtf > 0.0 || target_active > 0; }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0
                  && prune_interval > 0 && beam_delta > 0.0 && hash_ratio >= 1.0
-                 && prune_scale > 0.0 && prune_scale < 1.0);
+                 && prune_scale > 0.0 && prune_scale < 1.0
+                 && target_rtf >= 0.0 && target_active >= 0 && min_beam > 0.0);
   }
 };
 
+/// Statistics of the adaptive mode of LatticeFasterDecoder (see
+/// LatticeFasterDecoderConfig::target_rtf); accumulated over all utterances
+/// decoded by the decoder object.
+struct LatticeFasterDecoderAdaptStats {
+  int64 num_frames;
+  int64 num_limited_frames;  // frames on which the token budget was reached
+  int64 num_beam_decreases;
+  int64 num_beam_increases;
+  double tot_beam;  // sum of the beams used, for the average
+  BaseFloat min_beam;  // smallest beam used
+  double tot_max_active;
+  int32 min_max_active;  // smallest max-active used
+  double tot_tokens;  // sum of the active tokens per frame
+  int64 max_tokens;
+  double tot_seconds;  // time spent on the frames
+
+  LatticeFasterDecoderAdaptStats() { Reset(); }
+  void Reset() {
+    num_frames = num_limited_frames = num_beam_decreases = num_beam_increases = 0;
+    tot_beam = tot_max_active = tot_tokens = tot_seconds = 0.0;
+    min_beam = std::numeric_limits<BaseFloat>::infinity();
+    min_max_active = std::numeric_limits<int32>::max();
+    max_tokens = 0;
+  }
+  void Add(const LatticeFasterDecoderAdaptStats &other) {
+    num_frames += other.num_frames;
+    num_limited_frames += other.num_limited_frames;
+    num_beam_decreases += other.num_beam_decreases;
+    num_beam_increases += other.num_beam_increases;
+    tot_beam += other.tot_beam;
+    min_beam = std::min(min_beam, other.min_beam);
+    tot_max_active += other.tot_max_active;
+    min_max_active = std::min(min_max_active, other.min_max_active);
+    tot_tokens += other.tot_tokens;
+    max_tokens = std::max(max_tokens, other.max_tokens);
+    tot_seconds += other.tot_seconds;
+  }
+  /// Prints a one-line summary.
+  void Print(std::ostream &os) const;
+};
+
 
 /** A bit more optimized version of the lattice decoder.
    See \ref lattices_generation \ref decoders_faster and \ref decoders_simple
@@ -121,6 +184,12 @@ class LatticeFasterDecoder {
     return config_;
   }
 
+  /// Statistics of the adaptive mode (only accumulated if
+  /// GetOptions().Adaptive()).
+  const LatticeFasterDecoderAdaptStats &AdaptStats() const {
+    return adapt_stats_;
+  }
+
   ~LatticeFasterDecoder();
 
   /// Decodes until there are no more frames left in the "decodable" object..
@@ -244,11 +313,11 @@ class LatticeFasterDecoder {
     inline Token(BaseFloat tot_cost, BaseFloat extra_cost, ForwardLink *links,
                  Token *next):
         tot_cost(tot_cost), extra_cost(extra_cost), links(links), next(next) { }
-    inline void DeleteForwardLinks() {
+    inline void DeleteForwardLinks(SlabAllocator<ForwardLink> *link_pool) {
       ForwardLink *l = links, *m;
       while (l != NULL) {
         m = l->next;
-        delete l;
+        link_pool->Delete(l);
         l = m;
       }
       links = NULL;
@@ -353,6 +422,22 @@ class LatticeFasterDecoder {
 
   void ProcessNonemittingWrapper(BaseFloat cost_cutoff);
 
+  /// Decodes one frame: ProcessEmitting() and ProcessNonemitting(), and in the
+  /// adaptive mode measures the frame and calls AdaptPruning().
+  void DecodeFrame(DecodableInterface *decodable);
+
+  /// Adaptive mode: sets cur_beam_ and cur_max_active_ for the next frame from
+  /// the token count and the pruning of GetCutoff() on this frame and from the
+  /// measured time per token.  The token budget is target_active and/or the
+  /// number of tokens which can be processed within target_rtf; max-active is
+  /// set to the budget and, when the budget was reached, the beam is narrowed
+  /// to the beam that max-active implied.  Otherwise the beam is widened again
+  /// by beam_delta per frame, up to the configured beam.
+  void AdaptPruning(double frame_seconds);
+
+  /// Token budget of the adaptive mode (see AdaptPruning()).
+  int32 TokenBudget() const;
+
   // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.  It is indexed by frame-index
@@ -362,6 +447,11 @@ class LatticeFasterDecoder {
   // the graph.
   HashList<StateId, Token*> toks_;
 
+  // All Tokens and ForwardLinks are allocated from these per-decoder pools
+  // instead of the heap; ClearActiveTokens() releases them at once.
+  SlabAllocator<Token> token_pool_;
+  SlabAllocator<ForwardLink> link_pool_;
+
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
@@ -376,6 +466,20 @@ class LatticeFasterDecoder {
   // zero, to reduce roundoff errors.
   LatticeFasterDecoderConfig config_;
   int32 num_toks_; // current total #toks allocated...
+
+  // The beam and max-active used by GetCutoff(); equal to config_.beam and
+  // config_.max_active unless config_.Adaptive().
+  BaseFloat cur_beam_;
+  int32 cur_max_active_;
+  // Adaptive mode: results of the last GetCutoff() (number of tokens, whether
+  // max-active was tighter than the beam, and the beam it implied) and the
+  // smoothed decoding time per token, which is kept across utterances.
+  size_t last_tok_count_;
+  bool last_max_active_limited_;
+  BaseFloat last_adaptive_beam_;
+  double sec_per_token_;
+  Timer frame_timer_;
+  LatticeFasterDecoderAdaptStats adapt_stats_;
   bool warned_;
 
   /// decoding_finalized_ is true if someone called FinalizeDecoding().  [note,
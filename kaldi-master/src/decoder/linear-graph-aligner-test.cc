@@ -0,0 +1,147 @@
+// decoder/linear-graph-aligner-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/linear-graph-aligner.h"
+#include "decoder/faster-decoder.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/model-test-common.h"
+#include "hmm/hmm-test-utils.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+// A chain of states with a self-loop and a forward arc per state and a few
+// skip arcs (like optional silence), labeled with random transition-ids.
+static void RandomLinearGraph(const TransitionModel &trans_model,
+                              int32 num_states,
+                              fst::VectorFst<fst::StdArc> *fst) {
+  typedef fst::StdArc Arc;
+  int32 num_tids = trans_model.NumTransitionIds();
+  fst->DeleteStates();
+  for (int32 s = 0; s <= num_states; s++) fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    fst->AddArc(s, Arc(RandInt(1, num_tids), 0, 2.0 * RandUniform(), s));
+    fst->AddArc(s, Arc(RandInt(1, num_tids), RandInt(0, 1),
+                       2.0 * RandUniform(), s + 1));
+    if (s + 2 <= num_states && RandInt(0, 3) == 0)
+      fst->AddArc(s, Arc(RandInt(1, num_tids), 0, 2.0 * RandUniform(), s + 2));
+  }
+  fst->SetFinal(num_states, Arc::Weight::One());
+}
+
+// The generic alignment, as in AlignUtteranceWrapper().
+static bool GenericAlign(const fst::VectorFst<fst::StdArc> &fst,
+                         DecodableInterface *decodable, BaseFloat beam,
+                         std::vector<int32> *alignment, BaseFloat *score) {
+  FasterDecoderOptions decode_opts;
+  decode_opts.beam = beam;
+  FasterDecoder decoder(fst, decode_opts);
+  decoder.Decode(decodable);
+  if (!decoder.ReachedFinal()) return false;
+  fst::VectorFst<LatticeArc> decoded;
+  decoder.GetBestPath(&decoded);
+  std::vector<int32> words;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(decoded, alignment, &words, &weight);
+  *score = -(weight.Value1() + weight.Value2());
+  return true;
+}
+
+static void UnitTestLinearGraphAligner() {
+  TransitionModel *trans_model = GenRandTransitionModel(NULL);
+  int32 dim = RandInt(5, 20);
+  AmDiagGmm am_gmm;
+  for (int32 pdf = 0; pdf < trans_model->NumPdfs(); pdf++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, RandInt(1, 8), &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+
+  AlignConfig config;
+  config.beam = 200.0;  // wide enough for both to find the best path.
+  config.retry_beam = 0.0;
+  BaseFloat acoustic_scale = 0.1;
+  LinearGraphAligner aligner(*trans_model, am_gmm, RandInt(1, 16));
+  for (int32 u = 0; u < 10; u++) {
+    int32 num_states = RandInt(1, 30);
+    fst::VectorFst<fst::StdArc> fst;
+    RandomLinearGraph(*trans_model, num_states, &fst);
+    Matrix<BaseFloat> features(num_states + RandInt(0, 2 * num_states), dim);
+    features.SetRandn();
+
+    KALDI_ASSERT(aligner.Init(fst));
+    aligner.ComputeLogLikes(features, acoustic_scale);
+    KALDI_ASSERT(aligner.NumFrames() == features.NumRows());
+    std::vector<int32> alignment;
+    BaseFloat score = 0.0;
+    Vector<BaseFloat> per_frame_loglikes;
+    KALDI_ASSERT(aligner.Align(config.beam, &alignment, &score,
+                               &per_frame_loglikes));
+
+    DecodableAmDiagGmmScaled decodable(am_gmm, *trans_model, features,
+                                       acoustic_scale);
+    std::vector<int32> generic_alignment;
+    BaseFloat generic_score = 0.0;
+    KALDI_ASSERT(GenericAlign(fst, &decodable, config.beam,
+                              &generic_alignment, &generic_score));
+    KALDI_ASSERT(alignment == generic_alignment);
+    KALDI_ASSERT(ApproxEqual(score, generic_score, 1.0e-03));
+    // the per-frame log-likelihoods are those of the aligned pdfs.
+    for (int32 t = 0; t < features.NumRows(); t++)
+      KALDI_ASSERT(ApproxEqual(per_frame_loglikes(t),
+                               decodable.LogLikelihood(t, alignment[t]),
+                               1.0e-03));
+
+    // the wrapper counts the utterance like AlignUtteranceWrapper().
+    int32 num_done = 0, num_err = 0;
+    double tot_like = 0.0;
+    int64 frame_count = 0;
+    KALDI_ASSERT(LinearAlignUtteranceWrapper(
+        config, "utt", acoustic_scale, fst, features, &aligner, NULL, NULL,
+        &num_done, &num_err, NULL, &tot_like, &frame_count));
+    KALDI_ASSERT(num_done == 1 && num_err == 0 &&
+                 frame_count == features.NumRows());
+    KALDI_ASSERT(ApproxEqual(tot_like, generic_score / acoustic_scale,
+                             1.0e-03));
+  }
+
+  // graphs with input epsilons are left to the generic aligner.
+  fst::VectorFst<fst::StdArc> fst;
+  RandomLinearGraph(*trans_model, 3, &fst);
+  fst.AddArc(0, fst::StdArc(0, 0, 1.0, 1));
+  KALDI_ASSERT(!aligner.Init(fst));
+  Matrix<BaseFloat> features(5, dim);
+  int32 num_done = 0, num_err = 0;
+  KALDI_ASSERT(!LinearAlignUtteranceWrapper(
+      config, "utt", acoustic_scale, fst, features, &aligner, NULL, NULL,
+      &num_done, &num_err, NULL, NULL, NULL));
+  KALDI_ASSERT(num_done == 0 && num_err == 0);
+  delete trans_model;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++)
+    UnitTestLinearGraphAligner();
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
@@ -0,0 +1,439 @@
+// decoder/linear-graph-aligner.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "decoder/linear-graph-aligner.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LINEAR_GRAPH_ALIGNER_SSE2
+#endif
+
+namespace kaldi {
+
+static const BaseFloat kNegInf = -std::numeric_limits<BaseFloat>::infinity();
+static const int32 kNoFrames = std::numeric_limits<int32>::max() / 2;
+
+// cur[i] = max(prev[i] + self_w[i] + es[i], pp[i] + prim_w[i] + ep[i]),
+// code[i] = 1 if the primary arc is better.
+static void MaxPlusSelfPrimary(int32 len, const BaseFloat *prev,
+                               const BaseFloat *self_w, const BaseFloat *es,
+                               const BaseFloat *pp, const BaseFloat *prim_w,
+                               const BaseFloat *ep, BaseFloat *cur,
+                               int32 *code) {
+  int32 i = 0;
+#ifdef LINEAR_GRAPH_ALIGNER_SSE2
+  const __m128i one = _mm_set1_epi32(1);
+  for (; i + 4 <= len; i += 4) {
+    __m128 a = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(prev + i),
+                                     _mm_loadu_ps(self_w + i)),
+                          _mm_loadu_ps(es + i));
+    __m128 b = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pp + i),
+                                     _mm_loadu_ps(prim_w + i)),
+                          _mm_loadu_ps(ep + i));
+    _mm_storeu_ps(cur + i, _mm_max_ps(a, b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(code + i),
+                     _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(b, a)), one));
+  }
+#endif
+  for (; i < len; i++) {
+    BaseFloat a = prev[i] + self_w[i] + es[i], b = pp[i] + prim_w[i] + ep[i];
+    if (b > a) { cur[i] = b; code[i] = 1; }
+    else       { cur[i] = a; code[i] = 0; }
+  }
+}
+
+LinearGraphAligner::LinearGraphAligner(const TransitionModel &trans_model,
+                                       const AmDiagGmm &am_gmm,
+                                       int32 block_size)
+    : trans_model_(trans_model), am_gmm_(am_gmm),
+      block_size_(block_size > 0 ? block_size : 64),
+      pdf2col_(am_gmm.NumPdfs(), -1), num_states_(0), start_(0) {}
+
+int32 LinearGraphAligner::PdfColumn(int32 tid) {
+  int32 pdf = trans_model_.TransitionIdToPdf(tid);
+  if (pdf2col_[pdf] < 0) {
+    pdf2col_[pdf] = static_cast<int32>(col2pdf_.size());
+    col2pdf_.push_back(pdf);
+  }
+  return pdf2col_[pdf];
+}
+
+bool LinearGraphAligner::Init(const fst::VectorFst<fst::StdArc> &fst) {
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+
+  for (size_t j = 0; j < col2pdf_.size(); j++) pdf2col_[col2pdf_[j]] = -1;
+  col2pdf_.clear();
+
+  StateId num_states = fst.NumStates();
+  if (fst.Start() == fst::kNoStateId || num_states == 0) return false;
+
+  // every arc must consume a frame and the graph must be acyclic apart from
+  // the self-loops.
+  std::vector<int32> indegree(num_states, 0);
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, s);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel == 0) return false;
+      if (arc.nextstate != s) indegree[arc.nextstate]++;
+    }
+  }
+  std::vector<StateId> order;
+  order.reserve(num_states);
+  for (StateId s = 0; s < num_states; s++)
+    if (indegree[s] == 0) order.push_back(s);
+  for (size_t i = 0; i < order.size(); i++) {
+    StateId s = order[i];
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, s);
+         !aiter.Done(); aiter.Next()) {
+      StateId n = aiter.Value().nextstate;
+      if (n != s && --indegree[n] == 0) order.push_back(n);
+    }
+  }
+  if (static_cast<StateId>(order.size()) != num_states) return false;
+  std::vector<int32> pos(num_states);
+  for (StateId i = 0; i < num_states; i++) pos[order[i]] = i;
+
+  num_states_ = num_states;
+  start_ = pos[fst.Start()];
+  self_w_.assign(num_states_, kNegInf);
+  self_tid_.assign(num_states_, 0);
+  self_col_.assign(num_states_, 0);
+  prim_w_.assign(num_states_, kNegInf);
+  prim_tid_.assign(num_states_, 0);
+  prim_col_.assign(num_states_, 0);
+  prim_src_.assign(num_states_, -1);
+  final_w_.resize(num_states_);
+
+  max_next_.resize(num_states_);
+  for (int32 n = 0; n < num_states_; n++) max_next_[n] = n;
+
+  // incoming arcs per state
+  std::vector<std::vector<ExtraArc> > incoming(num_states_);
+  for (StateId s = 0; s < num_states; s++) {
+    int32 p = pos[s];
+    final_w_[p] = -fst.Final(s).Value();
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, s);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      ExtraArc e;
+      e.src = p;
+      e.tid = arc.ilabel;
+      e.col = PdfColumn(arc.ilabel);
+      e.w = -arc.weight.Value();
+      int32 n = pos[arc.nextstate];
+      max_next_[p] = std::max(max_next_[p], n);
+      if (n == p && self_w_[p] == kNegInf) {
+        self_w_[p] = e.w;
+        self_tid_[p] = e.tid;
+        self_col_[p] = e.col;
+      } else {
+        incoming[n].push_back(e);
+      }
+    }
+  }
+  if (col2pdf_.empty()) return false;
+
+  // the primary arc is the one from the previous state if there is one
+  // (chain), the others are extra arcs.
+  extra_begin_.resize(num_states_ + 1);
+  extra_.clear();
+  for (int32 n = 0; n < num_states_; n++) {
+    extra_begin_[n] = static_cast<int32>(extra_.size());
+    std::vector<ExtraArc> &in = incoming[n];
+    if (in.empty()) continue;
+    size_t prim = 0;
+    for (size_t k = 0; k < in.size(); k++)
+      if (in[k].src == n - 1) { prim = k; break; }
+    prim_src_[n] = in[prim].src;
+    prim_tid_[n] = in[prim].tid;
+    prim_col_[n] = in[prim].col;
+    prim_w_[n] = in[prim].w;
+    for (size_t k = 0; k < in.size(); k++)
+      if (k != prim) extra_.push_back(in[k]);
+  }
+  extra_begin_[num_states_] = static_cast<int32>(extra_.size());
+
+  // minimum number of frames from the start state and to a final state
+  fwd_min_.assign(num_states_, kNoFrames);
+  fwd_min_[start_] = 0;
+  for (int32 n = 0; n < num_states_; n++) {
+    if (prim_src_[n] >= 0 && prim_src_[n] != n)
+      fwd_min_[n] = std::min(fwd_min_[n], fwd_min_[prim_src_[n]] + 1);
+    for (int32 k = extra_begin_[n]; k < extra_begin_[n + 1]; k++)
+      if (extra_[k].src != n)
+        fwd_min_[n] = std::min(fwd_min_[n], fwd_min_[extra_[k].src] + 1);
+  }
+  bwd_min_.assign(num_states_, kNoFrames);
+  for (int32 n = num_states_ - 1; n >= 0; n--) {
+    if (final_w_[n] != kNegInf) bwd_min_[n] = 0;
+    if (bwd_min_[n] == kNoFrames) continue;
+    if (prim_src_[n] >= 0 && prim_src_[n] != n)
+      bwd_min_[prim_src_[n]] = std::min(bwd_min_[prim_src_[n]],
+                                        bwd_min_[n] + 1);
+    for (int32 k = extra_begin_[n]; k < extra_begin_[n + 1]; k++)
+      if (extra_[k].src != n)
+        bwd_min_[extra_[k].src] = std::min(bwd_min_[extra_[k].src],
+                                           bwd_min_[n] + 1);
+  }
+  return true;
+}
+
+// band_hi_[t]: last state reachable from the start in t frames; band_lo_[t]:
+// first state from which a final state is reachable in the remaining frames.
+// Both are monotone in t.
+void LinearGraphAligner::ComputeBand(int32 num_frames) {
+  band_hi_.assign(num_frames + 1, -1);
+  band_lo_.assign(num_frames + 1, num_states_);
+  for (int32 n = 0; n < num_states_; n++) {
+    if (fwd_min_[n] <= num_frames)
+      band_hi_[fwd_min_[n]] = std::max(band_hi_[fwd_min_[n]], n);
+    if (bwd_min_[n] <= num_frames)
+      band_lo_[bwd_min_[n]] = std::min(band_lo_[bwd_min_[n]], n);
+  }
+  for (int32 k = 1; k <= num_frames; k++) {
+    band_hi_[k] = std::max(band_hi_[k], band_hi_[k - 1]);
+    band_lo_[k] = std::min(band_lo_[k], band_lo_[k - 1]);
+  }
+  // band_lo_ is indexed by the number of remaining frames; turn it around
+  std::reverse(band_lo_.begin(), band_lo_.end());
+}
+
+void LinearGraphAligner::ComputeLogLikes(const MatrixBase<BaseFloat> &features,
+                                         BaseFloat acoustic_scale) {
+  int32 num_frames = features.NumRows(), dim = features.NumCols(),
+      num_cols = static_cast<int32>(col2pdf_.size());
+  if (dim != am_gmm_.Dim()) {
+    KALDI_ERR << "Dimension mismatch: model dim " << am_gmm_.Dim()
+              << " vs. features dim " << dim;
+  }
+  loglikes_.Resize(num_frames, num_cols, kUndefined);
+
+  int32 max_gauss = 0;
+  for (int32 j = 0; j < num_cols; j++) {
+    const DiagGmm &gmm = am_gmm_.GetPdf(col2pdf_[j]);
+    if (!gmm.valid_gconsts())
+      KALDI_ERR << "Must call ComputeGconsts() before computing likelihood";
+    max_gauss = std::max(max_gauss, gmm.NumGauss());
+  }
+  Matrix<BaseFloat> data_sq(block_size_, dim, kUndefined),
+      gauss_loglikes(block_size_, max_gauss, kUndefined);
+
+  // a block of frames is scored against all gaussians of a pdf with two matrix
+  // multiplications.
+  for (int32 t0 = 0; t0 < num_frames; t0 += block_size_) {
+    int32 num_block = std::min(block_size_, num_frames - t0);
+    SubMatrix<BaseFloat> data(features, t0, num_block, 0, dim);
+    SubMatrix<BaseFloat> sq(data_sq, 0, num_block, 0, dim);
+    sq.CopyFromMat(data);
+    sq.ApplyPow(2.0);
+    for (int32 j = 0; j < num_cols; j++) {
+      const DiagGmm &gmm = am_gmm_.GetPdf(col2pdf_[j]);
+      SubMatrix<BaseFloat> ll(gauss_loglikes, 0, num_block, 0, gmm.NumGauss());
+      ll.CopyRowsFromVec(gmm.gconsts());
+      ll.AddMatMat(1.0, data, kNoTrans, gmm.means_invvars(), kTrans, 1.0);
+      ll.AddMatMat(-0.5, sq, kNoTrans, gmm.inv_vars(), kTrans, 1.0);
+      for (int32 b = 0; b < num_block; b++)
+        loglikes_(t0 + b, j) = acoustic_scale * ll.Row(b).LogSumExp();
+    }
+  }
+  ComputeBand(num_frames);
+}
+
+bool LinearGraphAligner::Align(BaseFloat beam, std::vector<int32> *alignment,
+                               BaseFloat *score,
+                               Vector<BaseFloat> *per_frame_loglikes) {
+  int32 num_frames = NumFrames();
+  if (num_frames == 0 || band_lo_[0] > start_ || band_hi_[0] < start_)
+    return false;
+
+  prev_.assign(num_states_, kNegInf);
+  cur_.assign(num_states_, kNegInf);
+  pp_.resize(num_states_);
+  es_.resize(num_states_);
+  ep_.resize(num_states_);
+  codes_.clear();
+  row_off_.resize(num_frames + 1);
+  row_lo_.resize(num_frames + 1);
+
+  prev_[start_] = 0.0;
+  int32 prev_lo = start_, prev_hi = start_, prev_reach = max_next_[start_];
+  for (int32 t = 1; t <= num_frames; t++) {
+    // the arcs never go backwards in the topological order, and only the
+    // states reachable from the survivors of the previous frame can be active.
+    int32 lo = std::max(band_lo_[t], prev_lo),
+        hi = std::min(band_hi_[t], prev_reach);
+    if (lo > hi) return false;
+    const BaseFloat *llrow = loglikes_.RowData(t - 1);
+    for (int32 n = lo; n <= hi; n++) {
+      int32 src = prim_src_[n];
+      pp_[n] = (src >= 0 ? prev_[src] : kNegInf);
+      es_[n] = llrow[self_col_[n]];
+      ep_[n] = llrow[prim_col_[n]];
+    }
+    row_off_[t] = static_cast<int32>(codes_.size());
+    row_lo_[t] = lo;
+    codes_.resize(codes_.size() + (hi - lo + 1));
+    int32 *code = &codes_[row_off_[t]];
+    MaxPlusSelfPrimary(hi - lo + 1, &prev_[lo], &self_w_[lo], &es_[lo],
+                       &pp_[lo], &prim_w_[lo], &ep_[lo], &cur_[lo], code);
+    for (int32 n = lo; n <= hi; n++) {
+      for (int32 k = extra_begin_[n]; k < extra_begin_[n + 1]; k++) {
+        const ExtraArc &e = extra_[k];
+        BaseFloat c = prev_[e.src] + e.w + llrow[e.col];
+        if (c > cur_[n]) {
+          cur_[n] = c;
+          code[n - lo] = 2 + k;
+        }
+      }
+    }
+
+    // beam pruning
+    BaseFloat best = kNegInf;
+    for (int32 n = lo; n <= hi; n++) best = std::max(best, cur_[n]);
+    if (best == kNegInf) return false;
+    BaseFloat thresh = best - beam;
+    int32 new_lo = hi, new_hi = lo, new_reach = lo;
+    for (int32 n = lo; n <= hi; n++) {
+      if (cur_[n] < thresh) cur_[n] = kNegInf;
+      else {
+        new_lo = std::min(new_lo, n);
+        new_hi = n;
+        new_reach = std::max(new_reach, max_next_[n]);
+      }
+    }
+
+    // clear the previous frame (it becomes the next frame) and swap
+    std::fill(prev_.begin() + prev_lo, prev_.begin() + prev_hi + 1, kNegInf);
+    prev_.swap(cur_);
+    prev_lo = new_lo;
+    prev_hi = new_hi;
+    prev_reach = new_reach;
+  }
+
+  // best final state
+  int32 best_n = -1;
+  BaseFloat best_score = kNegInf;
+  for (int32 n = prev_lo; n <= prev_hi; n++) {
+    BaseFloat c = prev_[n] + final_w_[n];
+    if (c > best_score) {
+      best_score = c;
+      best_n = n;
+    }
+  }
+  if (best_n < 0) return false;
+
+  // trace back
+  alignment->resize(num_frames);
+  if (per_frame_loglikes != NULL) per_frame_loglikes->Resize(num_frames);
+  int32 n = best_n;
+  for (int32 t = num_frames; t >= 1; t--) {
+    int32 c = codes_[row_off_[t] + n - row_lo_[t]];
+    int32 tid, col, src;
+    if (c == 0) {
+      tid = self_tid_[n]; col = self_col_[n]; src = n;
+    } else if (c == 1) {
+      tid = prim_tid_[n]; col = prim_col_[n]; src = prim_src_[n];
+    } else {
+      tid = extra_[c - 2].tid; col = extra_[c - 2].col; src = extra_[c - 2].src;
+    }
+    (*alignment)[t - 1] = tid;
+    if (per_frame_loglikes != NULL)
+      (*per_frame_loglikes)(t - 1) = loglikes_(t - 1, col);
+    n = src;
+  }
+  KALDI_ASSERT(n == start_);
+  *score = best_score;
+  return true;
+}
+
+bool LinearAlignUtteranceWrapper(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,
+    const fst::VectorFst<fst::StdArc> &fst,
+    const MatrixBase<BaseFloat> &features,
+    LinearGraphAligner *aligner,
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer) {
+
+  if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
+      config.beam <= 0.0) {
+    KALDI_ERR << "Beams do not make sense: beam " << config.beam
+              << ", retry-beam " << config.retry_beam;
+  }
+  // the careful alignment modifies the graph (non left-to-right), the generic
+  // aligner handles the empty graphs.
+  if (config.careful || fst.Start() == fst::kNoStateId) return false;
+  if (!aligner->Init(fst)) return false;
+
+  aligner->ComputeLogLikes(features, acoustic_scale);
+
+  bool write_per_frame = (per_frame_acwt_writer != NULL &&
+                          per_frame_acwt_writer->IsOpen());
+  std::vector<int32> alignment;
+  BaseFloat score;
+  Vector<BaseFloat> per_frame_loglikes;
+  bool ans = aligner->Align(config.beam, &alignment, &score,
+                            write_per_frame ? &per_frame_loglikes : NULL);
+
+  if (!ans && config.retry_beam != 0.0) {
+    if (num_retried != NULL) (*num_retried)++;
+    KALDI_WARN << "Retrying utterance " << utt << " with beam "
+               << config.retry_beam;
+    ans = aligner->Align(config.retry_beam, &alignment, &score,
+                         write_per_frame ? &per_frame_loglikes : NULL);
+  }
+
+  if (!ans) {  // Still did not reach final state.
+    KALDI_WARN << "Did not successfully decode file " << utt << ", len = "
+               << features.NumRows();
+    if (num_error != NULL) (*num_error)++;
+    return true;
+  }
+
+  BaseFloat like = score / acoustic_scale;
+  if (num_done != NULL) (*num_done)++;
+  if (tot_like != NULL) (*tot_like) += like;
+  if (frame_count != NULL) (*frame_count) += features.NumRows();
+
+  if (alignment_writer != NULL && alignment_writer->IsOpen())
+    alignment_writer->Write(utt, alignment);
+
+  if (scores_writer != NULL && scores_writer->IsOpen())
+    scores_writer->Write(utt, score);
+
+  if (write_per_frame) {
+    per_frame_loglikes.Scale(1.0 / acoustic_scale);
+    per_frame_acwt_writer->Write(utt, per_frame_loglikes);
+  }
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,148 @@
+// decoder/linear-graph-aligner.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Based on: decoder-wrappers.cc (AlignUtteranceWrapper), diag-gmm.cc
+// (LogLikelihoods)
+
+#ifndef KALDI_DECODER_LINEAR_GRAPH_ALIGNER_H_
+#define KALDI_DECODER_LINEAR_GRAPH_ALIGNER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "decoder/decoder-wrappers.h"
+#include "fstext/fstext-lib.h"
+
+namespace kaldi {
+
+/// Forced aligner for left-to-right training graphs.
+///
+/// The training graphs are HMM chains with optional silence: apart from the
+/// self-loops they are acyclic and every arc consumes a frame.  Such a graph
+/// is turned into a dense state trellis: the states are sorted topologically
+/// and each state gets its self-loop, one "primary" incoming arc (in a chain
+/// the arc from the previous state) and a short list of extra incoming arcs
+/// (branches, e.g. optional silence).  The Viterbi recursion is then run over
+/// a band of states per frame:
+///  - the structural band contains only the states which are reachable from
+///    the start state in t frames and from which a final state is reachable
+///    in the remaining frames;
+///  - within the band the states outside the beam are pruned (the retry beam
+///    is used as in the generic aligner if no final state is reached) and the
+///    band of the next frame is clipped to the states which can be reached
+///    from the surviving states, so the cost per frame is the width of the
+///    beam and not the length of the graph.
+/// The self-loop/primary arc max-plus update runs with SSE over the band, the
+/// extra arcs are added in a scalar pass.  The GMM log-likelihoods of the pdfs
+/// in the graph are computed in blocks of frames with matrix multiplications
+/// (instead of one frame and one pdf at a time).
+///
+/// Graphs with input epsilons or with cycles other than self-loops are not
+/// handled (Init() returns false); the caller must use the generic decoder
+/// (AlignUtteranceWrapper()) for them.  The careful alignment mode also needs
+/// the generic decoder.
+class LinearGraphAligner {
+ public:
+  LinearGraphAligner(const TransitionModel &trans_model,
+                     const AmDiagGmm &am_gmm, int32 block_size = 64);
+
+  /// Builds the trellis of the graph.  Returns false if the graph is not a
+  /// left-to-right graph.
+  bool Init(const fst::VectorFst<fst::StdArc> &fst);
+
+  /// Computes the scaled log-likelihoods of the pdfs of the graph for all
+  /// frames.  Call after Init().
+  void ComputeLogLikes(const MatrixBase<BaseFloat> &features,
+                       BaseFloat acoustic_scale);
+
+  /// Viterbi alignment with beam pruning.  "score" is the negated total
+  /// (graph + scaled acoustic) cost.  Returns false if no final state was
+  /// reached.
+  bool Align(BaseFloat beam, std::vector<int32> *alignment, BaseFloat *score,
+             Vector<BaseFloat> *per_frame_loglikes = NULL);
+
+  int32 NumFrames() const { return loglikes_.NumRows(); }
+
+ private:
+  struct ExtraArc {
+    int32 src;  // position of the source state
+    int32 tid;  // transition-id
+    int32 col;  // column in loglikes_
+    BaseFloat w;  // negated graph cost
+  };
+
+  int32 PdfColumn(int32 tid);
+  void ComputeBand(int32 num_frames);
+
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  int32 block_size_;
+
+  // pdfs of the current graph.
+  std::vector<int32> pdf2col_;  // -1 if the pdf is not in the graph.
+  std::vector<int32> col2pdf_;
+  Matrix<BaseFloat> loglikes_;  // frames x pdfs of the graph (scaled).
+
+  // trellis; all arrays are indexed by the topological position of the state.
+  int32 num_states_;
+  int32 start_;
+  std::vector<BaseFloat> self_w_, prim_w_, final_w_;
+  std::vector<int32> self_tid_, self_col_, prim_tid_, prim_col_, prim_src_;
+  // extra arcs of state n: [extra_begin_[n], extra_begin_[n+1]).
+  std::vector<int32> extra_begin_;
+  std::vector<ExtraArc> extra_;
+  // minimum number of frames from the start / to a final state.
+  std::vector<int32> fwd_min_, bwd_min_;
+  // furthest state reachable from a state with one arc.
+  std::vector<int32> max_next_;
+  std::vector<int32> band_lo_, band_hi_;  // structural band per frame.
+
+  // work space.
+  std::vector<BaseFloat> prev_, cur_, pp_, es_, ep_;
+  std::vector<int32> codes_;  // back pointers per frame, band compressed.
+  std::vector<int32> row_off_, row_lo_;
+};
+
+/// Same as AlignUtteranceWrapper() in decoder-wrappers.h but with the
+/// LinearGraphAligner.  Returns false (and does not count anything) if the
+/// graph can not be aligned with the LinearGraphAligner; the caller must then
+/// use AlignUtteranceWrapper().
+bool LinearAlignUtteranceWrapper(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,
+    const fst::VectorFst<fst::StdArc> &fst,
+    const MatrixBase<BaseFloat> &features,
+    LinearGraphAligner *aligner,
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_LINEAR_GRAPH_ALIGNER_H_
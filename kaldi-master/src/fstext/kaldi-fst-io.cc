@@ -20,6 +20,7 @@
 // limitations under the License.
 
 #include "fstext/kaldi-fst-io.h"
+#include "fstext/packed-fst.h"
 #include "base/kaldi-error.h"
 #include "base/kaldi-math.h"
 #include "util/kaldi-io.h"
@@ -76,6 +77,8 @@ Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename, bool throw_on_err) {
     fst = ConstFst<StdArc>::Read(ki.Stream(), ropts);
   } else if (hdr.FstType() == "vector") {
     fst = VectorFst<StdArc>::Read(ki.Stream(), ropts);
+  } else if (hdr.FstType() == "packed") {
+    fst = PackedFst::Read(ki.Stream(), ropts);
   }
   if (!fst) {
     if(throw_on_err) {
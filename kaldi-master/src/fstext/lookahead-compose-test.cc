@@ -0,0 +1,118 @@
+// fstext/lookahead-compose-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/lookahead-compose.h"
+#include "fstext/rand-fst.h"
+#include "base/kaldi-math.h"
+
+namespace fst {
+
+// Adds a state with "num_arcs" arcs the way CacheImpl does.
+static void AddCachedState(StdLruCacheStore *store, StdArc::StateId s,
+                           int32 num_arcs) {
+  CacheState<StdArc> *state = store->GetMutableState(s);
+  for (int32 i = 0; i < num_arcs; i++)
+    state->PushArc(StdArc(i + 1, i + 1, TropicalWeight::One(), s));
+  store->SetArcs(state);
+}
+
+// The cache stays within its limit by dropping the least recently used
+// states, but never a state which is referenced by an arc iterator.
+static void TestLruCacheStoreEviction() {
+  StdLruCacheStore store(CacheOptions(true, 0));  // the minimum limit.
+  size_t limit = store.CacheLimit();
+  int32 num_states = 200, num_arcs = 10;
+  AddCachedState(&store, 0, num_arcs);
+  store.GetMutableState(0)->IncrRefCount();
+  for (int32 s = 1; s < num_states; s++) {
+    AddCachedState(&store, s, num_arcs);
+    KALDI_ASSERT(store.GetState(1) != NULL);  // keeps state 1 recent.
+    KALDI_ASSERT(store.CacheSize() <= store.CacheLimit());
+    KALDI_ASSERT(store.CacheLimit() == limit);
+  }
+  KALDI_ASSERT(store.GetState(0) != NULL);  // referenced.
+  KALDI_ASSERT(store.GetState(2) == NULL);  // the oldest ones are dropped,
+  KALDI_ASSERT(store.GetState(num_states - 1) != NULL);  // the newest kept.
+  int32 num_kept = 0;
+  for (store.Reset(); !store.Done(); store.Next()) num_kept++;
+  KALDI_ASSERT(num_kept > 2 && num_kept < num_states);
+  // the kept states are the most recently used ones.
+  for (int32 s = 2; s < num_states - num_kept + 2; s++)
+    KALDI_ASSERT(store.GetState(s) == NULL);
+  store.GetMutableState(0)->DecrRefCount();
+}
+
+// If every state is in use the limit is widened instead.
+static void TestLruCacheStoreWiden() {
+  StdLruCacheStore store(CacheOptions(true, 0));
+  size_t limit = store.CacheLimit();
+  int32 num_states = 100, num_arcs = 10;
+  for (int32 s = 0; s < num_states; s++) {
+    AddCachedState(&store, s, num_arcs);
+    store.GetMutableState(s)->IncrRefCount();
+  }
+  KALDI_ASSERT(store.CacheLimit() > limit);
+  KALDI_ASSERT(store.CacheSize() <= store.CacheLimit());
+  for (int32 s = 0; s < num_states; s++)
+    KALDI_ASSERT(store.GetState(s) != NULL);
+}
+
+// With a cache which is much smaller than the composition the lazy lookahead
+// composition gives the same FST as with the default cache, also after
+// ResetIfLarge() started it again.
+static void TestLookaheadComposeFst() {
+  RandFstOptions opts;
+  opts.n_states = 30 + kaldi::Rand() % 30;
+  opts.n_arcs = 150 + kaldi::Rand() % 150;
+  opts.allow_empty = false;
+  VectorFst<StdArc> *fst1 = RandFst<StdArc>(opts);
+  opts.n_states = 3 + kaldi::Rand() % 5;
+  opts.n_arcs = 5 + kaldi::Rand() % 20;
+  VectorFst<StdArc> *fst2 = RandFst<StdArc>(opts);
+  ArcSort(fst1, OLabelCompare<StdArc>());
+
+  StdOLabelLookAheadFst hcl(*fst1);
+  VectorFst<StdArc> g(*fst2);
+  RelabelGForLookahead(hcl, &g);
+  VectorFst<StdArc> expected(ComposeFst<StdArc>(hcl, g));
+
+  StdLookaheadComposeFst *composed = LookaheadComposeFst(hcl, g, 0);
+  for (int32 i = 0; i < 2; i++) {
+    VectorFst<StdArc> expanded(*composed);
+    KALDI_ASSERT(Equal(expected, expanded));
+    KALDI_ASSERT(composed->NumKnownStates() == expanded.NumStates());
+    KALDI_ASSERT(!composed->ResetIfLarge(composed->StateTableBytes()));
+    KALDI_ASSERT(composed->ResetIfLarge(0));
+    KALDI_ASSERT(composed->NumKnownStates() == 0);
+  }
+  delete composed;
+  delete fst1;
+  delete fst2;
+}
+
+}  // namespace fst
+
+int main() {
+  using namespace fst;
+  TestLruCacheStoreEviction();
+  TestLruCacheStoreWiden();
+  for (int i = 0; i < 10; i++)
+    TestLookaheadComposeFst();
+  std::cout << "Test OK\n";
+}
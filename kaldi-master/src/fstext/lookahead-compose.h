@@ -0,0 +1,282 @@
+// fstext/lookahead-compose.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Based on: openfst (cache.h GCCacheStore, lookahead-matcher.h)
+
+#ifndef KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
+#define KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "fst/fstlib.h"
+#include "fst/matcher-fst.h"
+#include "fst/lookahead-matcher.h"
+#include "fst/lookahead-filter.h"
+
+// Dynamic (on-the-fly) decoding graph: HCL and G are kept separate and
+// composed lazily during the search.
+//
+// HCL is stored as an "olabel_lookahead" FST (StdOLabelLookAheadFst) and the
+// input labels of G are relabeled with the relabeling of HCL's output labels
+// (see RelabelGForLookahead()).  ComposeFst detects the lookahead matcher on
+// HCL and uses the label-lookahead compose filter with weight and label
+// pushing, so only those composed states are created which the decoder
+// actually visits.
+//
+// The composed states are cached in an LruCacheStore which holds at most about
+// "cache_limit" bytes of states and arcs.  When the limit is exceeded the
+// least recently used states are dropped (they are recomputed if they are
+// visited again).  The compose state table (state tuple -> state id) is not
+// limited by the cache; see StdLookaheadComposeFst::ResetIfLarge().
+
+namespace fst {
+
+/// Cache store with a byte budget and least-recently-used eviction.  It has
+/// the same interface as GCCacheStore (which it replaces) and wraps a
+/// VectorCacheStore.  Each access of a state stamps it with a counter; at GC
+/// the unreferenced states are dropped in LRU order until the cache is at
+/// "cache_fraction" of the limit.  States which are referenced by an arc
+/// iterator (RefCount() > 0) and the state being expanded are never dropped.
+/// If nothing more can be dropped then the limit is widened (as in
+/// GCCacheStore).  Not thread safe; each decoder must have its own ComposeFst.
+template <class CacheStore>
+class LruCacheStore {
+ public:
+  typedef typename CacheStore::State State;
+  typedef typename State::Arc Arc;
+  typedef typename Arc::StateId StateId;
+
+  // The underlying store must keep its state list for iteration, therefore
+  // gc is always on.
+  explicit LruCacheStore(const CacheOptions &opts)
+      : store_(CacheOptions(true, opts.gc_limit)),
+        cache_limit_(opts.gc_limit > kMinCacheLimit ? opts.gc_limit :
+                     kMinCacheLimit),
+        cache_size_(0),
+        clock_(0) {}
+
+  // Returns NULL if state is not stored.
+  const State *GetState(StateId s) const {
+    const State *state = store_.GetState(s);
+    if (state != NULL) Touch(s);
+    return state;
+  }
+
+  // Creates state if state is not stored.
+  State *GetMutableState(StateId s) {
+    State *state = store_.GetMutableState(s);
+    Touch(s);
+    if (!(state->Flags() & kCacheInit)) {
+      state->SetFlags(kCacheInit, kCacheInit);
+      cache_size_ += sizeof(State) + state->NumArcs() * sizeof(Arc);
+      if (cache_size_ > cache_limit_) GC(state);
+    }
+    return state;
+  }
+
+  void AddArc(State *state, const Arc &arc) {
+    store_.AddArc(state, arc);
+    cache_size_ += sizeof(Arc);
+    if (cache_size_ > cache_limit_) GC(state);
+  }
+
+  // Call only once per state.
+  void SetArcs(State *state) {
+    store_.SetArcs(state);
+    cache_size_ += state->NumArcs() * sizeof(Arc);
+    if (cache_size_ > cache_limit_) GC(state);
+  }
+
+  void DeleteArcs(State *state) {
+    cache_size_ -= state->NumArcs() * sizeof(Arc);
+    store_.DeleteArcs(state);
+  }
+
+  void DeleteArcs(State *state, size_t n) {
+    cache_size_ -= n * sizeof(Arc);
+    store_.DeleteArcs(state, n);
+  }
+
+  void Clear() {
+    store_.Clear();
+    stamp_.clear();
+    cache_size_ = 0;
+  }
+
+  bool Done() const { return store_.Done(); }
+
+  StateId Value() const { return store_.Value(); }
+
+  void Next() { store_.Next(); }
+
+  void Reset() { store_.Reset(); }
+
+  // Deletes current state and advances to next.
+  void Delete() {
+    const State *state = store_.GetState(Value());
+    size_t size = sizeof(State) + state->NumArcs() * sizeof(Arc);
+    cache_size_ -= (size < cache_size_ ? size : cache_size_);
+    store_.Delete();
+  }
+
+  void GC(const State *current, float cache_fraction = 0.666);
+
+  size_t CacheSize() const { return cache_size_; }
+
+  size_t CacheLimit() const { return cache_limit_; }
+
+ private:
+  static const size_t kMinCacheLimit = 8096;
+
+  void Touch(StateId s) const {
+    if (s >= static_cast<StateId>(stamp_.size())) stamp_.resize(s + 1, 0);
+    stamp_[s] = ++clock_;
+  }
+
+  CacheStore store_;
+  size_t cache_limit_;  // Number of bytes allowed before GC.
+  size_t cache_size_;  // Number of bytes cached.
+  mutable std::vector<uint64> stamp_;  // Last access per state.
+  mutable uint64 clock_;
+};
+
+template <class CacheStore>
+void LruCacheStore<CacheStore>::GC(const State *current,
+                                   float cache_fraction) {
+  size_t cache_target = cache_fraction * cache_limit_;
+  // collect the states which can be dropped, oldest first.
+  std::vector<std::pair<uint64, StateId> > candidates;
+  for (store_.Reset(); !store_.Done(); store_.Next()) {
+    StateId s = store_.Value();
+    const State *state = store_.GetState(s);
+    if (state->RefCount() == 0 && state != current)
+      candidates.push_back(std::make_pair(
+          s < static_cast<StateId>(stamp_.size()) ? stamp_[s] : 0, s));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  std::unordered_set<StateId> victims;
+  size_t size = cache_size_;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (size <= cache_target) break;
+    const State *state = store_.GetState(candidates[i].second);
+    size_t ssize = sizeof(State) + state->NumArcs() * sizeof(Arc);
+    size -= (ssize < size ? ssize : size);
+    victims.insert(candidates[i].second);
+  }
+  // the underlying store can only delete while iterating.
+  if (!victims.empty()) {
+    store_.Reset();
+    while (!store_.Done()) {
+      if (victims.count(store_.Value()) > 0) Delete();
+      else store_.Next();
+    }
+  }
+  // widen the limit if not enough could be freed (everything left is in use).
+  if (cache_target > 0) {
+    while (cache_size_ > cache_target) {
+      cache_limit_ *= 2;
+      cache_target *= 2;
+    }
+  }
+  VLOG(2) << "LruCacheStore: GC: dropped " << victims.size()
+          << " states, cache size = " << cache_size_ << ", cache limit = "
+          << cache_limit_;
+}
+
+template <class CacheStore>
+const size_t LruCacheStore<CacheStore>::kMinCacheLimit;
+
+typedef LruCacheStore<VectorCacheStore<CacheState<StdArc> > > StdLruCacheStore;
+
+/// Lazily composed HCL o G.  The composed states are held by a StdLruCacheStore,
+/// but the compose state table (state tuple -> state id) and the per-state
+/// bookkeeping of the cache (expanded flags, LRU stamps) keep an entry for
+/// every composed state ever visited, also after the state itself was dropped
+/// from the cache.  They grow with the number of distinct states visited, so
+/// a long-lived instance calls ResetIfLarge() between utterances; it drops
+/// the composition and starts a new one in place (the decoders keep a
+/// reference to the FST, not to its implementation).
+class StdLookaheadComposeFst : public ComposeFst<StdArc, StdLruCacheStore> {
+ public:
+  typedef ComposeFst<StdArc, StdLruCacheStore> Base;
+
+  /// "hcl" and "g" must outlive this object (the lookahead matcher points into
+  /// HCL, and ResetIfLarge() composes them again).
+  StdLookaheadComposeFst(const Fst<StdArc> &hcl, const Fst<StdArc> &g,
+                         const CacheOptions &opts)
+      : Base(hcl, g, opts), hcl_(hcl), g_(g), opts_(opts) {}
+
+  /// The number of composed states created so far, i.e. the number of entries
+  /// of the compose state table.
+  StateId NumKnownStates() const { return GetImpl()->NumKnownStates(); }
+
+  /// Approximate memory of the compose state table and of the per-state
+  /// bookkeeping, in bytes [the arcs and states themselves are in the cache].
+  size_t StateTableBytes() const {
+    return static_cast<size_t>(NumKnownStates()) * kBytesPerKnownState;
+  }
+
+  /// Starts a new composition if StateTableBytes() exceeds "max_bytes"; returns
+  /// true if it did.  Must not be called while a search is using the FST (call
+  /// it between utterances).
+  bool ResetIfLarge(size_t max_bytes) {
+    if (StateTableBytes() <= max_bytes) return false;
+    VLOG(1) << "StdLookaheadComposeFst: " << NumKnownStates()
+            << " composed states, starting a new composition.";
+    SetImpl(CreateBase(hcl_, g_, opts_));
+    return true;
+  }
+
+  /// As above with the byte budget of the cache.
+  bool ResetIfLarge() { return ResetIfLarge(opts_.gc_limit); }
+
+ private:
+  // a state tuple with its hash table node, the expanded flag and LRU stamp.
+  static const size_t kBytesPerKnownState = 64;
+
+  const Fst<StdArc> &hcl_;
+  const Fst<StdArc> &g_;
+  CacheOptions opts_;
+};
+
+/// Creates the lazy composition of an olabel lookahead HCL and a relabeled G.
+/// The caller owns the result.  "hcl" and "g" must not be deleted before the
+/// result.
+inline StdLookaheadComposeFst *LookaheadComposeFst(
+    const StdOLabelLookAheadFst &hcl, const Fst<StdArc> &g,
+    size_t cache_limit_bytes) {
+  CacheOptions opts(true, cache_limit_bytes);
+  return new StdLookaheadComposeFst(hcl, g, opts);
+}
+
+/// Relabels the input (word) labels of G so that they are compatible with the
+/// lookahead HCL and sorts G on the input labels.  This is all that is needed
+/// to use a new G with an existing HCL.
+inline void RelabelGForLookahead(const StdOLabelLookAheadFst &hcl,
+                                 MutableFst<StdArc> *g) {
+  LabelLookAheadRelabeler<StdArc>::Relabel(g, hcl, true);
+  ArcSort(g, ILabelCompare<StdArc>());
+}
+
+}  // namespace fst
+
+#endif  // KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
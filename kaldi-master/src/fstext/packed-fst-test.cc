@@ -0,0 +1,97 @@
+// fstext/packed-fst-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "fstext/packed-fst.h"
+#include "fstext/rand-fst.h"
+#include "base/kaldi-math.h"
+
+namespace fst {
+
+// Checks the layout which the decoders rely on.
+static void CheckLayout(const PackedFst &fst) {
+  for (StateIterator<PackedFst> siter(fst); !siter.Done(); siter.Next()) {
+    StdArc::StateId s = siter.Value();
+    KALDI_ASSERT(fst.ArcsBegin(s) <= fst.EmittingArcsBegin(s) &&
+                 fst.EmittingArcsBegin(s) <= fst.ArcsEnd(s));
+    KALDI_ASSERT(fst.NumArcs(s) == fst.ArcsEnd(s) - fst.ArcsBegin(s));
+    size_t a = fst.ArcsBegin(s);
+    for (ArcIterator<PackedFst> aiter(fst, s); !aiter.Done(); aiter.Next(), a++) {
+      const StdArc &arc = aiter.Value();
+      KALDI_ASSERT((arc.ilabel == 0) == (a < fst.EmittingArcsBegin(s)));
+      KALDI_ASSERT(arc.ilabel == fst.ILabels()[a] &&
+                   arc.olabel == fst.OLabels()[a] &&
+                   arc.weight.Value() == fst.Weights()[a] &&
+                   arc.nextstate == fst.NextStates()[a]);
+    }
+  }
+}
+
+static void TestPackedFst() {
+  VectorFst<StdArc> *fst = RandFst<StdArc>();
+
+  for (int32 reorder = 0; reorder < 2; reorder++) {
+    PackedFst packed(*fst, reorder != 0);
+    KALDI_ASSERT(packed.NumStates() == fst->NumStates());
+    CheckLayout(packed);
+    if (fst->Start() != kNoStateId && reorder != 0)
+      KALDI_ASSERT(packed.Start() == 0);
+    // the renumbering and the order of the arcs must not change the paths.
+    KALDI_ASSERT(RandEquivalent(*fst, packed, 5/*paths*/, 0.01/*delta*/,
+                                kaldi::Rand()/*seed*/, 100/*path length*/));
+
+    // write and read it back.
+    std::ostringstream os;
+    KALDI_ASSERT(packed.Write(os, FstWriteOptions("<test>")));
+    std::istringstream is(os.str());
+    PackedFst *packed2 = PackedFst::Read(is, FstReadOptions("<test>"));
+    KALDI_ASSERT(packed2 != NULL);
+    KALDI_ASSERT(Equal(packed, *packed2));
+    CheckLayout(*packed2);
+    delete packed2;
+  }
+  delete fst;
+}
+
+// A graph without arcs has empty arc arrays.
+static void TestPackedFstNoArcs() {
+  VectorFst<StdArc> fst;
+  fst.AddState();
+  fst.SetStart(0);
+  fst.SetFinal(0, TropicalWeight::One());
+  PackedFst packed(fst, true);
+  KALDI_ASSERT(packed.NumStates() == 1 && packed.NumArcs(0) == 0);
+  CheckLayout(packed);
+  std::ostringstream os;
+  KALDI_ASSERT(packed.Write(os, FstWriteOptions("<test>")));
+  std::istringstream is(os.str());
+  PackedFst *packed2 = PackedFst::Read(is, FstReadOptions("<test>"));
+  KALDI_ASSERT(packed2 != NULL && Equal(packed, *packed2));
+  delete packed2;
+}
+
+} // namespace fst
+
+int main() {
+  using namespace fst;
+  for (int i = 0; i < 25; i++)
+    TestPackedFst();
+  TestPackedFstNoArcs();
+  std::cout << "Test OK.\n";
+}
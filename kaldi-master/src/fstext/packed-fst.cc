@@ -0,0 +1,280 @@
+// fstext/packed-fst.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <deque>
+#include "fstext/packed-fst.h"
+
+namespace fst {
+
+// Assembles the arcs from the arrays; used by the generic Fst interface only,
+// the decoders read the arrays directly.
+class PackedFst::PackedArcIterator: public ArcIteratorBase<StdArc> {
+ public:
+  PackedArcIterator(const Data *data, StateId s):
+      data_(data), begin_(data->arcs_begin[s]), end_(data->arcs_begin[s + 1]),
+      pos_(begin_) { }
+
+  bool Done() const override { return pos_ >= end_; }
+  const StdArc &Value() const override {
+    arc_.ilabel = data_->ilabels[pos_];
+    arc_.olabel = data_->olabels[pos_];
+    arc_.weight = Weight(data_->weights[pos_]);
+    arc_.nextstate = data_->nextstates[pos_];
+    return arc_;
+  }
+  void Next() override { ++pos_; }
+  size_t Position() const override { return pos_ - begin_; }
+  void Reset() override { pos_ = begin_; }
+  void Seek(size_t a) override { pos_ = begin_ + a; }
+  uint32 Flags() const override { return kArcValueFlags; }
+  void SetFlags(uint32, uint32) override { }
+
+ private:
+  const Data *data_;
+  uint64 begin_;
+  uint64 end_;
+  uint64 pos_;
+  mutable StdArc arc_;
+};
+
+// The properties which depend on the numbering of the states or on the order
+// of the arcs; these are not kept from the source FST.
+static const uint64 kPackedOrderProperties =
+    kILabelSorted | kNotILabelSorted | kOLabelSorted | kNotOLabelSorted |
+    kTopSorted | kNotTopSorted;
+
+PackedFst::PackedFst(const Fst<Arc> &fst, bool reorder_states):
+    data_(std::make_shared<Data>()), properties_(0) {
+  StateId num_states = CountStates(fst);
+  Data &data = *data_;
+
+  // order[i] is the original state which gets the new number i.
+  std::vector<StateId> order;
+  order.reserve(num_states);
+  if (reorder_states && fst.Start() != kNoStateId) {
+    // Breadth-first search from the start state.  From each state we go to
+    // the destinations of the input-epsilon arcs first, and then to the others
+    // in order of increasing cost, as an approximation of the order in which
+    // the decoder typically reaches them.
+    std::vector<bool> seen(num_states, false);
+    std::vector<Arc> arcs;
+    std::deque<StateId> queue;
+    queue.push_back(fst.Start());
+    seen[fst.Start()] = true;
+    while (!queue.empty()) {
+      StateId s = queue.front();
+      queue.pop_front();
+      order.push_back(s);
+      arcs.clear();
+      for (ArcIterator<Fst<Arc> > aiter(fst, s); !aiter.Done(); aiter.Next())
+        arcs.push_back(aiter.Value());
+      std::stable_sort(arcs.begin(), arcs.end(),
+                       [](const Arc &a, const Arc &b) {
+        if ((a.ilabel == 0) != (b.ilabel == 0)) return a.ilabel == 0;
+        return a.weight.Value() < b.weight.Value();
+      });
+      for (size_t i = 0; i < arcs.size(); i++) {
+        if (!seen[arcs[i].nextstate]) {
+          seen[arcs[i].nextstate] = true;
+          queue.push_back(arcs[i].nextstate);
+        }
+      }
+    }
+    for (StateId s = 0; s < num_states; s++)  // the unreachable states.
+      if (!seen[s]) order.push_back(s);
+  } else {
+    for (StateId s = 0; s < num_states; s++)
+      order.push_back(s);
+  }
+  std::vector<StateId> new_id(num_states);
+  for (StateId i = 0; i < num_states; i++)
+    new_id[order[i]] = i;
+
+  size_t num_arcs = 0;
+  for (StateId s = 0; s < num_states; s++)
+    num_arcs += fst.NumArcs(s);
+  data.start = (fst.Start() == kNoStateId ? kNoStateId : new_id[fst.Start()]);
+  data.final_costs.resize(num_states);
+  data.arcs_begin.resize(num_states + 1);
+  data.emitting_begin.resize(num_states);
+  data.ilabels.reserve(num_arcs);
+  data.olabels.reserve(num_arcs);
+  data.weights.reserve(num_arcs);
+  data.nextstates.reserve(num_arcs);
+  for (StateId i = 0; i < num_states; i++) {
+    StateId s = order[i];
+    data.final_costs[i] = fst.Final(s).Value();
+    data.arcs_begin[i] = data.ilabels.size();
+    // the input-epsilon arcs first, then the emitting arcs, each in their
+    // original order.
+    for (int32 pass = 0; pass < 2; pass++) {
+      if (pass == 1) data.emitting_begin[i] = data.ilabels.size();
+      for (ArcIterator<Fst<Arc> > aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if ((arc.ilabel == 0) != (pass == 0)) continue;
+        data.ilabels.push_back(arc.ilabel);
+        data.olabels.push_back(arc.olabel);
+        data.weights.push_back(arc.weight.Value());
+        data.nextstates.push_back(new_id[arc.nextstate]);
+      }
+    }
+  }
+  data.arcs_begin[num_states] = data.ilabels.size();
+
+  properties_ = (fst.Properties(kCopyProperties, false) &
+                 ~kPackedOrderProperties) | kExpanded;
+}
+
+size_t PackedFst::NumOutputEpsilons(StateId s) const {
+  size_t ans = 0;
+  for (uint64 a = data_->arcs_begin[s]; a < data_->arcs_begin[s + 1]; a++)
+    if (data_->olabels[a] == 0) ans++;
+  return ans;
+}
+
+uint64 PackedFst::Properties(uint64 mask, bool test) const {
+  if (test) {
+    uint64 known, props = TestProperties(*this, mask, &known);
+    properties_ = (properties_ & ~known) | (props & known);
+    return props & mask;
+  }
+  return properties_ & mask;
+}
+
+const string &PackedFst::Type() const {
+  static const string type = "packed";
+  return type;
+}
+
+void PackedFst::InitStateIterator(StateIteratorData<Arc> *data) const {
+  data->base = NULL;
+  data->nstates = NumStates();
+}
+
+void PackedFst::InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+  data->base = new PackedArcIterator(data_.get(), s);
+}
+
+template<class T>
+static void WriteArray(std::ostream &strm, const std::vector<T> &v) {
+  int64 size = v.size();
+  WriteType(strm, size);
+  if (size > 0)
+    strm.write(reinterpret_cast<const char*>(&(v[0])), sizeof(T) * size);
+}
+
+template<class T>
+static bool ReadArray(std::istream &strm, std::vector<T> *v) {
+  int64 size = -1;
+  ReadType(strm, &size);
+  if (!strm || size < 0) return false;
+  v->resize(size);
+  if (size > 0)
+    strm.read(reinterpret_cast<char*>(&((*v)[0])), sizeof(T) * size);
+  return static_cast<bool>(strm);
+}
+
+bool PackedFst::Write(std::ostream &strm, const FstWriteOptions &opts) const {
+  if (opts.write_header) {
+    FstHeader hdr;
+    hdr.SetFstType(Type());
+    hdr.SetArcType(Arc::Type());
+    hdr.SetVersion(kFileVersion);
+    hdr.SetFlags(0);
+    hdr.SetProperties(properties_);
+    hdr.SetStart(data_->start);
+    hdr.SetNumStates(NumStates());
+    hdr.SetNumArcs(data_->ilabels.size());
+    hdr.Write(strm, opts.source);
+  }
+  WriteArray(strm, data_->final_costs);
+  WriteArray(strm, data_->arcs_begin);
+  WriteArray(strm, data_->emitting_begin);
+  WriteArray(strm, data_->ilabels);
+  WriteArray(strm, data_->olabels);
+  WriteArray(strm, data_->weights);
+  WriteArray(strm, data_->nextstates);
+  strm.flush();
+  if (!strm) {
+    LOG(ERROR) << "PackedFst::Write: Write failed: " << opts.source;
+    return false;
+  }
+  return true;
+}
+
+PackedFst *PackedFst::Read(std::istream &strm, const FstReadOptions &opts) {
+  FstHeader hdr;
+  if (opts.header != NULL) {
+    hdr = *opts.header;
+  } else if (!hdr.Read(strm, opts.source)) {
+    return NULL;
+  }
+  if (hdr.FstType() != "packed" || hdr.ArcType() != Arc::Type() ||
+      hdr.Version() != kFileVersion) {
+    LOG(ERROR) << "PackedFst::Read: Unsupported FST type/arc type/version "
+               << hdr.FstType() << "/" << hdr.ArcType() << "/"
+               << hdr.Version() << ": " << opts.source;
+    return NULL;
+  }
+  PackedFst *fst = new PackedFst();
+  Data &data = *(fst->data_);
+  if (!ReadArray(strm, &data.final_costs) ||
+      !ReadArray(strm, &data.arcs_begin) ||
+      !ReadArray(strm, &data.emitting_begin) ||
+      !ReadArray(strm, &data.ilabels) || !ReadArray(strm, &data.olabels) ||
+      !ReadArray(strm, &data.weights) || !ReadArray(strm, &data.nextstates)) {
+    LOG(ERROR) << "PackedFst::Read: Read failed: " << opts.source;
+    delete fst;
+    return NULL;
+  }
+  // Check the consistency of the arrays, so that the decoders can index them
+  // without checks.
+  uint64 num_states = data.final_costs.size(),
+      num_arcs = data.ilabels.size();
+  bool ok = (hdr.NumStates() == static_cast<int64>(num_states) &&
+             hdr.NumArcs() == static_cast<int64>(num_arcs) &&
+             data.arcs_begin.size() == num_states + 1 &&
+             data.emitting_begin.size() == num_states &&
+             data.olabels.size() == num_arcs &&
+             data.weights.size() == num_arcs &&
+             data.nextstates.size() == num_arcs &&
+             data.arcs_begin[0] == 0 && data.arcs_begin[num_states] == num_arcs &&
+             (hdr.Start() == kNoStateId ||
+              (hdr.Start() >= 0 && hdr.Start() < static_cast<int64>(num_states))));
+  for (uint64 s = 0; ok && s < num_states; s++) {
+    uint64 begin = data.arcs_begin[s], emitting = data.emitting_begin[s],
+        end = data.arcs_begin[s + 1];
+    ok = (begin <= emitting && emitting <= end);
+    for (uint64 a = begin; ok && a < end; a++)
+      ok = ((data.ilabels[a] == 0) == (a < emitting) &&
+            data.nextstates[a] >= 0 &&
+            static_cast<uint64>(data.nextstates[a]) < num_states);
+  }
+  if (!ok) {
+    LOG(ERROR) << "PackedFst::Read: Corrupt FST: " << opts.source;
+    delete fst;
+    return NULL;
+  }
+  data.start = hdr.Start();
+  fst->properties_ = hdr.Properties();
+  return fst;
+}
+
+}  // namespace fst
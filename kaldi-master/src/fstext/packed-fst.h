@@ -0,0 +1,128 @@
+// fstext/packed-fst.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_PACKED_FST_H_
+#define KALDI_FSTEXT_PACKED_FST_H_
+
+#include <memory>
+#include <vector>
+#include "fst/fstlib.h"
+#include "base/kaldi-common.h"
+
+namespace fst {
+
+/// PackedFst is a read-only FST type (type "packed") for decoding graphs, laid
+/// out for the access pattern of the decoders:
+///  - the arcs are stored as separate arrays of ilabels, olabels, weights and
+///    next-states ("struct of arrays") instead of an array of StdArc;
+///  - the input-epsilon arcs of each state are stored before its emitting
+///    arcs, so ProcessEmitting() and ProcessNonemitting() of the decoder only
+///    visit the arcs they need;
+///  - optionally the states are renumbered in breadth-first order from the
+///    start state, following the input-epsilon arcs and then the cheapest
+///    arcs first, so that the states which are typically traversed together
+///    are also close together in memory.
+/// The normal Fst interface works too (the arc iterator assembles the arcs),
+/// and the file can be read with ReadFstKaldiGeneric(), so the graph can be
+/// used wherever a ConstFst HCLG is read; LatticeFasterDecoder accesses the
+/// arrays directly.
+class PackedFst: public ExpandedFst<StdArc> {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Label Label;
+  typedef Arc::Weight Weight;
+
+  /// Copies "fst".  If reorder_states == true, the states are renumbered for
+  /// locality (see above); states not reachable from the start state are
+  /// put at the end.
+  explicit PackedFst(const Fst<Arc> &fst, bool reorder_states = true);
+
+  PackedFst(const PackedFst &other, bool safe = false):
+      data_(other.data_), properties_(other.properties_) { }
+
+  StateId Start() const override { return data_->start; }
+  Weight Final(StateId s) const override {
+    return Weight(data_->final_costs[s]);
+  }
+  StateId NumStates() const override { return data_->final_costs.size(); }
+  size_t NumArcs(StateId s) const override {
+    return data_->arcs_begin[s + 1] - data_->arcs_begin[s];
+  }
+  size_t NumInputEpsilons(StateId s) const override {
+    return data_->emitting_begin[s] - data_->arcs_begin[s];
+  }
+  size_t NumOutputEpsilons(StateId s) const override;
+  uint64 Properties(uint64 mask, bool test) const override;
+  const string &Type() const override;
+  PackedFst *Copy(bool safe = false) const override {
+    return new PackedFst(*this, safe);
+  }
+  const SymbolTable *InputSymbols() const override { return NULL; }
+  const SymbolTable *OutputSymbols() const override { return NULL; }
+  void InitStateIterator(StateIteratorData<Arc> *data) const override;
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override;
+
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const override;
+  bool Write(const string &filename) const override {
+    return Fst<Arc>::WriteFile(filename);
+  }
+  /// Reads the FST; the header may have been read already (opts.header),
+  /// as in ReadFstKaldiGeneric().  Returns NULL on error.
+  static PackedFst *Read(std::istream &strm, const FstReadOptions &opts);
+
+  // Direct access for the decoders.  The arcs of state s are the positions
+  // [ArcsBegin(s), ArcsEnd(s)) of the arrays; the input-epsilon arcs are
+  // [ArcsBegin(s), EmittingArcsBegin(s)) and the emitting arcs are
+  // [EmittingArcsBegin(s), ArcsEnd(s)).
+  inline size_t ArcsBegin(StateId s) const { return data_->arcs_begin[s]; }
+  inline size_t EmittingArcsBegin(StateId s) const {
+    return data_->emitting_begin[s];
+  }
+  inline size_t ArcsEnd(StateId s) const { return data_->arcs_begin[s + 1]; }
+  inline const Label *ILabels() const { return data_->ilabels.data(); }
+  inline const Label *OLabels() const { return data_->olabels.data(); }
+  inline const float *Weights() const { return data_->weights.data(); }
+  inline const StateId *NextStates() const { return data_->nextstates.data(); }
+
+ private:
+  struct Data {
+    StateId start;
+    std::vector<float> final_costs;  // indexed by state (infinity: not final)
+    std::vector<uint64> arcs_begin;  // indexed by state; size NumStates() + 1
+    std::vector<uint64> emitting_begin;  // indexed by state
+    std::vector<Label> ilabels;
+    std::vector<Label> olabels;
+    std::vector<float> weights;
+    std::vector<StateId> nextstates;
+    Data(): start(kNoStateId) { }
+  };
+  class PackedArcIterator;
+
+  PackedFst(): data_(std::make_shared<Data>()), properties_(0) { }
+
+  static const int32 kFileVersion = 1;
+
+  std::shared_ptr<Data> data_;  // shared by the copies
+  mutable uint64 properties_;
+};
+
+}  // namespace fst
+
+#endif  // KALDI_FSTEXT_PACKED_FST_H_
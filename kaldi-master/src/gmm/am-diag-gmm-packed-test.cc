@@ -0,0 +1,202 @@
+// gmm/am-diag-gmm-packed-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "base/timer.h"
+#include "gmm/am-diag-gmm-packed.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/model-test-common.h"
+
+namespace kaldi {
+
+static void CsvResult(std::string test, int dim, BaseFloat measure, std::string units) {
+  std::cout << test << "," << dim << "," << measure << "," << units << "\n";
+}
+
+static void InitRandAmDiagGmm(int32 dim, int32 num_pdfs, int32 max_comp,
+                              AmDiagGmm *am) {
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + RandInt(0, max_comp - 1), &gmm);
+    am->AddPdf(gmm);
+  }
+}
+
+// Features drawn from randomly chosen Gaussians of the model.
+static void RandFeatures(const AmDiagGmm &am, int32 num_frames,
+                         Matrix<BaseFloat> *feats) {
+  int32 dim = am.Dim();
+  feats->Resize(num_frames, dim);
+  Vector<BaseFloat> mean(dim), var(dim);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 pdf = RandInt(0, am.NumPdfs() - 1),
+        g = RandInt(0, am.NumGaussInPdf(pdf) - 1);
+    am.GetGaussianMean(pdf, g, &mean);
+    am.GetGaussianVariance(pdf, g, &var);
+    var.ApplyPow(0.5);
+    SubMatrix<BaseFloat> row(*feats, t, 1, 0, dim);
+    unittest::RandDiagGaussFeatures(1, mean, var, &row);
+  }
+}
+
+// Upper bound of the error of the log-likelihood of the pdf: the error of a
+// Gaussian is at most sum_e err_e |x_e|, with [x, -0.5 x^2] as x, and the
+// error of the log-sum-exp is at most the largest error of the Gaussians.
+static double ErrorBound(const DiagGmm &pdf, const VectorBase<BaseFloat> &data,
+                         AmDiagGmmPackedType type,
+                         const Vector<BaseFloat> &max_abs_means_invvars,
+                         const Vector<BaseFloat> &max_abs_inv_vars) {
+  double ans = 0.0;
+  for (int32 g = 0; g < pdf.NumGauss(); g++) {
+    double err = 0.0;
+    for (int32 d = 0; d < data.Dim(); d++) {
+      double x = std::abs(data(d)), x2 = 0.5 * data(d) * data(d);
+      if (type == kPackedFloat16) {
+        err += std::abs(pdf.means_invvars()(g, d)) * x / 2048.0 +
+            std::abs(pdf.inv_vars()(g, d)) * x2 / 2048.0;
+      } else {
+        err += 0.5 * max_abs_means_invvars(d) / 127.0 * x +
+            0.5 * max_abs_inv_vars(d) / 127.0 * x2;
+      }
+    }
+    ans = std::max(ans, err);
+  }
+  return ans;
+}
+
+static void UnitTestAmDiagGmmPacked() {
+  int32 dim = 1 + RandInt(0, 40), num_pdfs = 1 + RandInt(0, 20);
+  AmDiagGmm am;
+  InitRandAmDiagGmm(dim, num_pdfs, 10, &am);
+  Vector<BaseFloat> max_abs_means_invvars(dim), max_abs_inv_vars(dim);
+  for (int32 i = 0; i < num_pdfs; i++) {
+    const DiagGmm &pdf = am.GetPdf(i);
+    for (int32 g = 0; g < pdf.NumGauss(); g++) {
+      for (int32 d = 0; d < dim; d++) {
+        max_abs_means_invvars(d) = std::max(max_abs_means_invvars(d),
+            std::abs(pdf.means_invvars()(g, d)));
+        max_abs_inv_vars(d) = std::max(max_abs_inv_vars(d),
+            std::abs(pdf.inv_vars()(g, d)));
+      }
+    }
+  }
+  Matrix<BaseFloat> feats;
+  RandFeatures(am, 10, &feats);
+
+  for (int32 i = 0; i < 2; i++) {
+    AmDiagGmmPackedType type = (i == 0 ? kPackedFloat16 : kPackedInt8);
+    AmDiagGmmPacked packed;
+    packed.Init(am, type);
+    KALDI_ASSERT(packed.IsCompatible(am) && packed.NumGauss() == am.NumGauss());
+
+    DecodableAmDiagGmmUnmapped full(am, feats), decodable(am, feats);
+    decodable.SetPackedModel(&packed);
+    for (int32 t = 0; t < feats.NumRows(); t++) {
+      for (int32 j = 0; j < num_pdfs; j++) {
+        BaseFloat f = full.LogLikelihood(t, j + 1),
+            p = decodable.LogLikelihood(t, j + 1);
+        double bound = ErrorBound(am.GetPdf(j), feats.Row(t), type,
+                                  max_abs_means_invvars, max_abs_inv_vars);
+        // the bound plus float roundoff.
+        KALDI_ASSERT(std::abs(f - p) <= bound + 1.0e-04 * (1.0 + std::abs(f)));
+      }
+    }
+  }
+}
+
+static void UnitTestCheckGmmPrecision() {
+  std::string error;
+  KALDI_ASSERT(CheckGmmPrecision("float", false, &error));
+  KALDI_ASSERT(CheckGmmPrecision("float", true, &error));
+  KALDI_ASSERT(CheckGmmPrecision("float16", false, &error));
+  KALDI_ASSERT(CheckGmmPrecision("int8", false, &error));
+  KALDI_ASSERT(error.empty());
+  KALDI_ASSERT(!CheckGmmPrecision("int8", true, &error) && !error.empty());
+  KALDI_ASSERT(!CheckGmmPrecision("double", false, &error));
+}
+
+// Speed and accuracy on a model which does not fit in the cache.
+static void UnitTestAmDiagGmmPackedSpeed() {
+  int32 dim = 40, num_pdfs = 2000, num_frames = 50;
+  AmDiagGmm am;
+  InitRandAmDiagGmm(dim, num_pdfs, 32, &am);
+  Matrix<BaseFloat> feats;
+  RandFeatures(am, num_frames, &feats);
+
+  Matrix<BaseFloat> full_loglikes(num_frames, num_pdfs);
+  {
+    DecodableAmDiagGmmUnmapped decodable(am, feats);
+    Timer timer;
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 i = 0; i < num_pdfs; i++)
+        full_loglikes(t, i) = decodable.LogLikelihood(t, i + 1);
+    CsvResult("AmDiagGmm float (per frame)", dim,
+              timer.Elapsed() / num_frames, "seconds");
+  }
+  for (int32 n = 0; n < 2; n++) {
+    AmDiagGmmPackedType type = (n == 0 ? kPackedFloat16 : kPackedInt8);
+    std::string name = (n == 0 ? "AmDiagGmmPacked float16" :
+                        "AmDiagGmmPacked int8");
+    AmDiagGmmPacked packed;
+    packed.Init(am, type);
+    DecodableAmDiagGmmUnmapped decodable(am, feats);
+    decodable.SetPackedModel(&packed);
+    Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+    Timer timer;
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 i = 0; i < num_pdfs; i++)
+        loglikes(t, i) = decodable.LogLikelihood(t, i + 1);
+    double elapsed = timer.Elapsed();
+
+    double tot_error = 0.0, max_error = 0.0;
+    int32 num_same_best = 0;
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 best_full, best;
+      full_loglikes.Row(t).Max(&best_full);
+      loglikes.Row(t).Max(&best);
+      if (best == best_full) num_same_best++;
+      for (int32 i = 0; i < num_pdfs; i++) {
+        double error = std::abs(full_loglikes(t, i) - loglikes(t, i));
+        tot_error += error;
+        max_error = std::max(max_error, error);
+      }
+    }
+    CsvResult(name + " (per frame)", dim, elapsed / num_frames, "seconds");
+    CsvResult(name + ": model size", dim, packed.SizeInBytes() / 1.0e+06,
+              "MB");
+    CsvResult(name + ": average log-likelihood error", dim,
+              tot_error / (num_frames * num_pdfs), "nats");
+    CsvResult(name + ": max log-likelihood error", dim, max_error, "nats");
+    CsvResult(name + ": same best pdf", dim,
+              num_same_best / static_cast<BaseFloat>(num_frames), "fraction");
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 20; i++)
+    UnitTestAmDiagGmmPacked();
+  UnitTestCheckGmmPrecision();
+  UnitTestAmDiagGmmPackedSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
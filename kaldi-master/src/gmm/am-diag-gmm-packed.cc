@@ -0,0 +1,309 @@
+// gmm/am-diag-gmm-packed.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+
+#include "gmm/am-diag-gmm-packed.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KALDI_AM_DIAG_GMM_PACKED_SSE2
+#endif
+// The conversion instruction of F16C (with AVX2 on all the processors which
+// have it; MSVC defines only __AVX2__ for /arch:AVX2).
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define KALDI_AM_DIAG_GMM_PACKED_F16C
+#endif
+
+namespace kaldi {
+
+bool GetAmDiagGmmPackedType(const std::string &name, AmDiagGmmPackedType *type) {
+  if (name == "float16") *type = kPackedFloat16;
+  else if (name == "int8") *type = kPackedInt8;
+  else return false;
+  return true;
+}
+
+bool CheckGmmPrecision(const std::string &gmm_precision, bool use_shortlist,
+                       std::string *error) {
+  if (gmm_precision == "float") return true;
+  AmDiagGmmPackedType type;
+  if (!GetAmDiagGmmPackedType(gmm_precision, &type)) {
+    *error = "Invalid gmm precision " + gmm_precision +
+        " (expecting float, float16 or int8)";
+    return false;
+  }
+  if (use_shortlist) {
+    *error = "The gmm precision " + gmm_precision + " can not be combined "
+        "with the Gaussian shortlist (the shortlist evaluates the float model)";
+    return false;
+  }
+  return true;
+}
+
+// Round to nearest; values too large for half precision are clamped to the
+// largest finite value (there are no infinities or NaNs in a valid model).
+static uint16 FloatToHalf(float f) {
+  uint32 x;
+  memcpy(&x, &f, sizeof(x));
+  uint32 sign = (x >> 16) & 0x8000, absx = x & 0x7fffffff;
+  if (absx >= 0x477fe000)  // >= 65520, would round to infinity.
+    return static_cast<uint16>(sign | 0x7bff);
+  if (absx < 0x38800000) {  // < 2^-14: subnormal in half precision.
+    float a;
+    memcpy(&a, &absx, sizeof(a));
+    return static_cast<uint16>(sign | static_cast<uint32>(a * 16777216.0f + 0.5f));
+  }
+  // rebias the exponent (127 -> 15) and round the mantissa to 10 bits.
+  uint32 h = ((absx - 0x38000000) + 0x0fff + ((absx >> 13) & 1)) >> 13;
+  return static_cast<uint16>(sign | h);
+}
+
+// Shifting the exponent and mantissa into place and multiplying by 2^112
+// rebiases the exponent and handles the subnormals too.
+static const uint32 kHalfToFloatMagic = 0x77800000;  // 2^112
+
+static inline float HalfToFloat(uint16 h) {
+  uint32 mag = static_cast<uint32>(h & 0x7fff) << 13, magic = kHalfToFloatMagic;
+  float f, m;
+  memcpy(&f, &mag, sizeof(f));
+  memcpy(&m, &magic, sizeof(m));
+  return (h & 0x8000) ? -(f * m) : f * m;
+}
+
+// The kernels below return dot(row, x) for n elements, n a multiple of 8
+// (float16) or 16 (int8); "row" is 16-byte aligned.
+static inline float DotHalf(const uint16 *row, const float *x, int32 n) {
+  int32 j = 0;
+  float sum = 0.0;
+#if defined(KALDI_AM_DIAG_GMM_PACKED_F16C)
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  for (; j + 8 <= n; j += 8) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(row + j));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtph_ps(v), _mm_loadu_ps(x + j)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtph_ps(_mm_unpackhi_epi64(v, v)),
+                                       _mm_loadu_ps(x + j + 4)));
+  }
+  float partial[4];
+  _mm_storeu_ps(partial, _mm_add_ps(acc0, acc1));
+  sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#elif defined(KALDI_AM_DIAG_GMM_PACKED_SSE2)
+  const __m128i zero = _mm_setzero_si128(),
+      mag_mask = _mm_set1_epi32(0x7fff), sign_mask = _mm_set1_epi32(0x8000);
+  const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(kHalfToFloatMagic));
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  for (; j + 8 <= n; j += 8) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(row + j));
+    __m128i lo = _mm_unpacklo_epi16(v, zero), hi = _mm_unpackhi_epi16(v, zero);
+    __m128 f0 = _mm_mul_ps(_mm_castsi128_ps(
+        _mm_slli_epi32(_mm_and_si128(lo, mag_mask), 13)), magic);
+    f0 = _mm_or_ps(f0, _mm_castsi128_ps(
+        _mm_slli_epi32(_mm_and_si128(lo, sign_mask), 16)));
+    __m128 f1 = _mm_mul_ps(_mm_castsi128_ps(
+        _mm_slli_epi32(_mm_and_si128(hi, mag_mask), 13)), magic);
+    f1 = _mm_or_ps(f1, _mm_castsi128_ps(
+        _mm_slli_epi32(_mm_and_si128(hi, sign_mask), 16)));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(f0, _mm_loadu_ps(x + j)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(f1, _mm_loadu_ps(x + j + 4)));
+  }
+  float partial[4];
+  _mm_storeu_ps(partial, _mm_add_ps(acc0, acc1));
+  sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#endif
+  for (; j < n; j++)
+    sum += HalfToFloat(row[j]) * x[j];
+  return sum;
+}
+
+static inline float DotInt8(const int8 *row, const float *x, int32 n) {
+  int32 j = 0;
+  float sum = 0.0;
+#ifdef KALDI_AM_DIAG_GMM_PACKED_SSE2
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  for (; j + 16 <= n; j += 16) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(row + j));
+    // sign-extend to 16 and then to 32 bits.
+    __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8),
+        hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+    __m128 f0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)),
+        f1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)),
+        f2 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)),
+        f3 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(f0, _mm_loadu_ps(x + j)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(f1, _mm_loadu_ps(x + j + 4)));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(f2, _mm_loadu_ps(x + j + 8)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(f3, _mm_loadu_ps(x + j + 12)));
+  }
+  float partial[4];
+  _mm_storeu_ps(partial, _mm_add_ps(acc0, acc1));
+  sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#endif
+  for (; j < n; j++)
+    sum += row[j] * x[j];
+  return sum;
+}
+
+AmDiagGmmPacked::AmDiagGmmPacked():
+    type_(kPackedFloat16), dim_(0), padded_dim_(0), num_gauss_(0),
+    gauss_begin_(1, 0), buffer_(NULL), buffer_size_(0), gconsts_(NULL),
+    rows_(NULL), row_bytes_(0) { }
+
+AmDiagGmmPacked::~AmDiagGmmPacked() { Destroy(); }
+
+void AmDiagGmmPacked::Destroy() {
+  if (buffer_ != NULL) KALDI_MEMALIGN_FREE(buffer_);
+  buffer_ = NULL;
+  buffer_size_ = 0;
+  gconsts_ = NULL;
+  rows_ = NULL;
+}
+
+void AmDiagGmmPacked::Init(const AmDiagGmm &am, AmDiagGmmPackedType type) {
+  Destroy();
+  type_ = type;
+  dim_ = am.Dim();
+  // rows of whole 16-byte blocks: 8 float16 or 16 int8 elements.
+  int32 block = (type_ == kPackedFloat16 ? 8 : 16);
+  padded_dim_ = (dim_ + block - 1) / block * block;
+  num_gauss_ = am.NumGauss();
+  int32 num_pdfs = am.NumPdfs(), row_size = 2 * padded_dim_;
+  gauss_begin_.resize(num_pdfs + 1);
+  gauss_begin_[0] = 0;
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++) {
+    const DiagGmm &pdf = am.GetPdf(pdf_index);
+    if (!pdf.valid_gconsts())
+      KALDI_ERR << "State " << pdf_index << ": Must call ComputeGconsts() "
+          "before packing the model.";
+    gauss_begin_[pdf_index + 1] = gauss_begin_[pdf_index] + pdf.NumGauss();
+  }
+
+  size_t elem_bytes = (type_ == kPackedFloat16 ? sizeof(uint16) : sizeof(int8)),
+      gconst_bytes = (sizeof(float) * num_gauss_ + 31) / 32 * 32;
+  row_bytes_ = elem_bytes * row_size;  // a multiple of 16
+  buffer_size_ = gconst_bytes + row_bytes_ * num_gauss_;
+  void *buffer;
+  if (KALDI_MEMALIGN(32, std::max<size_t>(buffer_size_, 32), &buffer) == NULL)
+    KALDI_ERR << "Could not allocate " << buffer_size_
+              << " bytes for the packed model.";
+  buffer_ = buffer;
+  memset(buffer_, 0, buffer_size_);
+  float *gconsts = static_cast<float*>(buffer_);
+  char *rows = static_cast<char*>(buffer_) + gconst_bytes;
+  gconsts_ = gconsts;
+  rows_ = rows;
+
+  if (type_ == kPackedInt8) {
+    // one scale per element of the row: the largest absolute value of the
+    // parameter over all Gaussians maps to 127.
+    scales_.Resize(row_size);
+    for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++) {
+      const DiagGmm &pdf = am.GetPdf(pdf_index);
+      for (int32 g = 0; g < pdf.NumGauss(); g++) {
+        for (int32 d = 0; d < dim_; d++) {
+          scales_(d) = std::max(scales_(d),
+                                std::abs(pdf.means_invvars()(g, d)));
+          scales_(padded_dim_ + d) = std::max(scales_(padded_dim_ + d),
+                                              std::abs(pdf.inv_vars()(g, d)));
+        }
+      }
+    }
+    for (int32 e = 0; e < row_size; e++)
+      scales_(e) = (scales_(e) > 0.0 ? scales_(e) / 127.0 : 1.0);
+  } else {
+    scales_.Resize(0);
+  }
+
+  int32 i = 0;
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++) {
+    const DiagGmm &pdf = am.GetPdf(pdf_index);
+    for (int32 g = 0; g < pdf.NumGauss(); g++, i++) {
+      gconsts[i] = pdf.gconsts()(g);
+      char *row = rows + i * row_bytes_;
+      for (int32 part = 0; part < 2; part++) {
+        SubVector<BaseFloat> params(part == 0 ? pdf.means_invvars().Row(g) :
+                                    pdf.inv_vars().Row(g));
+        int32 offset = part * padded_dim_;
+        for (int32 d = 0; d < dim_; d++) {
+          if (type_ == kPackedFloat16) {
+            reinterpret_cast<uint16*>(row)[offset + d] =
+                FloatToHalf(params(d));
+          } else {
+            float q = params(d) / scales_(offset + d);
+            q = std::max(-127.0f, std::min(127.0f, q));
+            reinterpret_cast<int8*>(row)[offset + d] =
+                static_cast<int8>(q < 0 ? q - 0.5f : q + 0.5f);
+          }
+        }
+      }
+    }
+  }
+}
+
+bool AmDiagGmmPacked::IsCompatible(const AmDiagGmm &am) const {
+  if (am.Dim() != dim_ || am.NumPdfs() != NumPdfs()) return false;
+  for (int32 pdf_index = 0; pdf_index < am.NumPdfs(); pdf_index++)
+    if (am.NumGaussInPdf(pdf_index) !=
+        gauss_begin_[pdf_index + 1] - gauss_begin_[pdf_index])
+      return false;
+  return true;
+}
+
+void AmDiagGmmPacked::ComputeFrameData(const VectorBase<BaseFloat> &data,
+                                       FrameData *frame) const {
+  KALDI_ASSERT(data.Dim() == dim_);
+  if (frame->Dim() != 2 * padded_dim_)
+    frame->Resize(2 * padded_dim_);  // the padding stays zero.
+  BaseFloat *x = frame->Data();
+  for (int32 d = 0; d < dim_; d++) {
+    x[d] = data(d);
+    x[padded_dim_ + d] = -0.5 * data(d) * data(d);
+  }
+  if (type_ == kPackedInt8)
+    frame->MulElements(scales_);
+}
+
+BaseFloat AmDiagGmmPacked::LogLikelihood(int32 pdf_index,
+                                         const FrameData &frame,
+                                         BaseFloat log_sum_exp_prune,
+                                         Vector<BaseFloat> *tmp) const {
+  KALDI_ASSERT(frame.Dim() == 2 * padded_dim_);
+  int32 begin = gauss_begin_[pdf_index],
+      num_gauss = gauss_begin_[pdf_index + 1] - begin,
+      row_size = 2 * padded_dim_;
+  if (tmp->Dim() < num_gauss)
+    tmp->Resize(num_gauss, kUndefined);
+  const float *x = frame.Data();
+  const char *row = rows_ + begin * row_bytes_;
+  BaseFloat *loglikes = tmp->Data();
+  if (type_ == kPackedFloat16) {
+    for (int32 g = 0; g < num_gauss; g++, row += row_bytes_)
+      loglikes[g] = gconsts_[begin + g] +
+          DotHalf(reinterpret_cast<const uint16*>(row), x, row_size);
+  } else {
+    for (int32 g = 0; g < num_gauss; g++, row += row_bytes_)
+      loglikes[g] = gconsts_[begin + g] +
+          DotInt8(reinterpret_cast<const int8*>(row), x, row_size);
+  }
+  SubVector<BaseFloat> ans(*tmp, 0, num_gauss);
+  return ans.LogSumExp(log_sum_exp_prune);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,122 @@
+// gmm/am-diag-gmm-packed.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_AM_DIAG_GMM_PACKED_H_
+#define KALDI_GMM_AM_DIAG_GMM_PACKED_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+
+namespace kaldi {
+
+enum AmDiagGmmPackedType {
+  kPackedFloat16 = 1,  // IEEE half precision parameters
+  kPackedInt8 = 2      // 8-bit parameters with a scale per dimension
+};
+
+/// Converts "float16" / "int8" to the type; returns false for other strings.
+bool GetAmDiagGmmPackedType(const std::string &name, AmDiagGmmPackedType *type);
+
+/// Checks a --gmm-precision value: "float" (the model itself) or one of the
+/// packed types, which can not be combined with the Gaussian shortlist (the
+/// shortlist evaluates the float model).  Returns false and sets "error" if
+/// the value is invalid.
+bool CheckGmmPrecision(const std::string &gmm_precision, bool use_shortlist,
+                       std::string *error);
+
+/// AmDiagGmmPacked is a read-only copy of the likelihood parameters of an
+/// AmDiagGmm (gconsts, means_invvars and inv_vars of all pdfs) in one
+/// contiguous aligned buffer with the means_invvars and inv_vars in reduced
+/// precision, for scoring when the model does not fit in the cache and the
+/// computation is limited by the memory bandwidth.  The parameters of each
+/// Gaussian are stored in one row [means_invvars, inv_vars] (padded to a
+/// multiple of 16 bytes) and the log-likelihood of a Gaussian is
+/// gconst + dot(row, [x, -0.5 x^2]), computed with SSE2 (or F16C) kernels
+/// which convert the parameters to float on the fly.
+/// Accuracy (am-diag-gmm-packed-test checks the bounds and reports the
+/// errors on a random model of 2000 pdfs):
+///  - kPackedFloat16 halves the memory of the parameters; the relative error
+///    of each parameter is below 2^-11; the log-likelihood errors are about
+///    0.001 on average and below 0.05.
+///  - kPackedInt8 quarters it; each dimension has one scale for all the
+///    Gaussians (the largest absolute value maps to 127), so the absolute
+///    error of a parameter is below half of its dimension's step; the
+///    log-likelihood errors are about 0.1 on average and up to 2 for the
+///    Gaussians with the smallest variances, so use it when the speed matters
+///    more than the last fraction of accuracy.
+/// The gconsts are kept in float.
+class AmDiagGmmPacked {
+ public:
+  /// The features of a frame as used by LogLikelihood(): [x, -0.5 x^2], both
+  /// parts padded and, for kPackedInt8, multiplied by the scales.
+  typedef Vector<BaseFloat> FrameData;
+
+  AmDiagGmmPacked();
+  ~AmDiagGmmPacked();
+
+  void Init(const AmDiagGmm &am, AmDiagGmmPackedType type);
+
+  int32 NumPdfs() const { return static_cast<int32>(gauss_begin_.size()) - 1; }
+  int32 NumGauss() const { return num_gauss_; }
+  int32 Dim() const { return dim_; }
+  AmDiagGmmPackedType Type() const { return type_; }
+  /// Bytes used by the parameters.
+  size_t SizeInBytes() const { return buffer_size_; }
+
+  /// Returns true if "am" has the same number of pdfs, Gaussians per pdf and
+  /// dimension (so a decodable of "am" can use this model).
+  bool IsCompatible(const AmDiagGmm &am) const;
+
+  /// Computes the features of the frame; call it once per frame.
+  void ComputeFrameData(const VectorBase<BaseFloat> &data,
+                        FrameData *frame) const;
+
+  /// Log-likelihood of the pdf; "tmp" is a work vector, log_sum_exp_prune is
+  /// as in DecodableAmDiagGmmUnmapped.
+  BaseFloat LogLikelihood(int32 pdf_index, const FrameData &frame,
+                          BaseFloat log_sum_exp_prune,
+                          Vector<BaseFloat> *tmp) const;
+
+ private:
+  void Destroy();
+
+  AmDiagGmmPackedType type_;
+  int32 dim_;
+  int32 padded_dim_;  // dim_ rounded up to whole 16-byte blocks
+  int32 num_gauss_;
+  std::vector<int32> gauss_begin_;  // index of the first Gaussian of each pdf
+  Vector<BaseFloat> scales_;  // kPackedInt8: scale per element of the row
+
+  // The buffer: num_gauss_ gconsts (float), then the rows of the Gaussians
+  // (2 * padded_dim_ elements of uint16 or int8 each); 32-byte aligned.
+  void *buffer_;
+  size_t buffer_size_;
+  const float *gconsts_;
+  const char *rows_;
+  size_t row_bytes_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AmDiagGmmPacked);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_AM_DIAG_GMM_PACKED_H_
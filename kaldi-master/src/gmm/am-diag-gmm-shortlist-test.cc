@@ -0,0 +1,257 @@
+// gmm/am-diag-gmm-shortlist-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <sstream>
+
+#include "base/timer.h"
+#include "gmm/am-diag-gmm-shortlist.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "gmm/model-test-common.h"
+
+namespace kaldi {
+
+static void CsvResult(std::string test, int dim, BaseFloat measure, std::string units) {
+  std::cout << test << "," << dim << "," << measure << "," << units << "\n";
+}
+
+static void InitRandAmDiagGmm(int32 dim, int32 num_pdfs, int32 max_comp,
+                              AmDiagGmm *am, Vector<BaseFloat> *occs) {
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + RandInt(0, max_comp - 1), &gmm);
+    am->AddPdf(gmm);
+  }
+  occs->Resize(num_pdfs);
+  for (int32 i = 0; i < num_pdfs; i++)
+    (*occs)(i) = std::fabs(RandGauss()) * (RandUniform() + 1) * 4;
+}
+
+// Features drawn from randomly chosen Gaussians of the model, so that they
+// look like the data the model was trained on.
+static void RandFeatures(const AmDiagGmm &am, int32 num_frames,
+                         Matrix<BaseFloat> *feats) {
+  int32 dim = am.Dim();
+  feats->Resize(num_frames, dim);
+  Vector<BaseFloat> mean(dim), var(dim);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 pdf = RandInt(0, am.NumPdfs() - 1),
+        g = RandInt(0, am.NumGaussInPdf(pdf) - 1);
+    am.GetGaussianMean(pdf, g, &mean);
+    am.GetGaussianVariance(pdf, g, &var);
+    var.ApplyPow(0.5);
+    SubMatrix<BaseFloat> row(*feats, t, 1, 0, dim);
+    unittest::RandDiagGaussFeatures(1, mean, var, &row);
+  }
+}
+
+static void UnitTestAmDiagGmmShortlist() {
+  int32 dim = 1 + RandInt(0, 9), num_pdfs = 5 + RandInt(0, 20);
+  AmDiagGmm am;
+  Vector<BaseFloat> occs;
+  InitRandAmDiagGmm(dim, num_pdfs, 10, &am, &occs);
+
+  AmDiagGmmShortlistOptions opts;
+  opts.num_clusters = 1 + RandInt(0, am.NumGauss() / 2);
+  opts.num_top_clusters = 1 + RandInt(0, opts.num_clusters - 1);
+  AmDiagGmmShortlist shortlist;
+  shortlist.Init(am, occs, opts);
+  KALDI_ASSERT(shortlist.IsCompatible(am));
+  KALDI_ASSERT(shortlist.NumClusters() <= opts.num_clusters);
+
+  Matrix<BaseFloat> feats;
+  RandFeatures(am, 20, &feats);
+  DecodableAmDiagGmmUnmapped full(am, feats), pruned(am, feats);
+  pruned.SetShortlist(&shortlist);
+  for (int32 t = 0; t < feats.NumRows(); t++) {
+    for (int32 i = 1; i <= num_pdfs; i++) {
+      BaseFloat f = full.LogLikelihood(t, i), p = pruned.LogLikelihood(t, i);
+      // dropping Gaussians can only decrease the likelihood.
+      KALDI_ASSERT(KALDI_ISFINITE(p) && p <= f + 1.0e-03 * std::fabs(f) + 1.0e-03);
+    }
+  }
+  KALDI_ASSERT(pruned.NumGaussTotal() == full.NumGaussTotal() &&
+               pruned.NumGaussEvaluated() <= pruned.NumGaussTotal());
+
+  // With all clusters selected the result is exact.
+  shortlist.SetNumTopClusters(shortlist.NumClusters());
+  DecodableAmDiagGmmUnmapped all(am, feats);
+  all.SetShortlist(&shortlist);
+  for (int32 t = 0; t < feats.NumRows(); t++)
+    for (int32 i = 1; i <= num_pdfs; i++)
+      AssertEqual(full.LogLikelihood(t, i), all.LogLikelihood(t, i), 1.0e-04);
+  KALDI_ASSERT(all.NumGaussEvaluated() == all.NumGaussTotal());
+
+  // Write and read back.
+  shortlist.SetNumTopClusters(opts.num_top_clusters);
+  for (int32 binary = 0; binary < 2; binary++) {
+    std::ostringstream os;
+    shortlist.Write(os, binary != 0);
+    AmDiagGmmShortlist shortlist2;
+    std::istringstream is(os.str());
+    shortlist2.Read(is, binary != 0);
+    shortlist2.Prepare(am);
+    KALDI_ASSERT(shortlist2.NumClusters() == shortlist.NumClusters() &&
+                 shortlist2.NumTopClusters() == shortlist.NumTopClusters() &&
+                 shortlist2.IsCompatible(am));
+    DecodableAmDiagGmmUnmapped pruned2(am, feats);
+    pruned2.SetShortlist(&shortlist2);
+    DecodableAmDiagGmmUnmapped pruned3(am, feats);
+    pruned3.SetShortlist(&shortlist);
+    for (int32 t = 0; t < feats.NumRows(); t++)
+      for (int32 i = 1; i <= num_pdfs; i++)
+        AssertEqual(pruned3.LogLikelihood(t, i), pruned2.LogLikelihood(t, i),
+                    1.0e-03);
+  }
+}
+
+// A model with the structure of a real one: the pdfs belong to "phones", and
+// the means of the Gaussians of a phone are close to each other compared to
+// the distances between the phones.
+static void InitStructuredAmDiagGmm(int32 dim, int32 num_pdfs,
+                                    int32 num_phones, int32 max_comp,
+                                    AmDiagGmm *am, Vector<BaseFloat> *occs) {
+  Matrix<BaseFloat> phone_means(num_phones, dim);
+  phone_means.SetRandn();
+  phone_means.Scale(3.0);
+  for (int32 i = 0; i < num_pdfs; i++) {
+    int32 num_comp = 1 + RandInt(0, max_comp - 1);
+    SubVector<BaseFloat> phone_mean(phone_means, RandInt(0, num_phones - 1));
+    Matrix<BaseFloat> means(num_comp, dim), inv_vars(num_comp, dim);
+    Vector<BaseFloat> weights(num_comp);
+    means.SetRandn();
+    means.AddVecToRows(1.0, phone_mean);
+    inv_vars.SetRandn();
+    inv_vars.Scale(0.3);
+    inv_vars.ApplyExp();
+    for (int32 m = 0; m < num_comp; m++)
+      weights(m) = RandUniform() + 0.1;
+    weights.Scale(1.0 / weights.Sum());
+    DiagGmm gmm(num_comp, dim);
+    gmm.SetWeights(weights);
+    gmm.SetInvVarsAndMeans(inv_vars, means);
+    gmm.ComputeGconsts();
+    am->AddPdf(gmm);
+  }
+  occs->Resize(num_pdfs);
+  for (int32 i = 0; i < num_pdfs; i++)
+    (*occs)(i) = std::fabs(RandGauss()) * (RandUniform() + 1) * 4;
+}
+
+// Times scoring all pdfs in all frames; the best of 3 runs.
+static double ScoreAllPdfs(const AmDiagGmm &am, const Matrix<BaseFloat> &feats,
+                           const AmDiagGmmShortlist *shortlist,
+                           Matrix<BaseFloat> *loglikes, BaseFloat *fraction) {
+  int32 num_frames = feats.NumRows(), num_pdfs = am.NumPdfs();
+  loglikes->Resize(num_frames, num_pdfs);
+  double best_time = std::numeric_limits<double>::infinity();
+  for (int32 run = 0; run < 3; run++) {
+    DecodableAmDiagGmmUnmapped decodable(am, feats);
+    decodable.SetShortlist(shortlist);
+    Timer timer;
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 i = 0; i < num_pdfs; i++)
+        (*loglikes)(t, i) = decodable.LogLikelihood(t, i + 1);
+    best_time = std::min(best_time, timer.Elapsed());
+    *fraction = decodable.NumGaussEvaluated() /
+        static_cast<BaseFloat>(decodable.NumGaussTotal());
+  }
+  return best_time;
+}
+
+// Speed and accuracy of the shortlist on a model of realistic size; the
+// clusters must be balanced and the shortlist must be faster.
+static void UnitTestAmDiagGmmShortlistSpeed() {
+  int32 dim = 39, num_pdfs = 300, num_frames = 100;
+  AmDiagGmm am;
+  Vector<BaseFloat> occs;
+  InitStructuredAmDiagGmm(dim, num_pdfs, 40, 32, &am, &occs);
+  Matrix<BaseFloat> feats;
+  RandFeatures(am, num_frames, &feats);
+
+  AmDiagGmmShortlistOptions opts;
+  opts.num_clusters = 128;
+  AmDiagGmmShortlist shortlist;
+  shortlist.Init(am, occs, opts);
+  int32 max_size = 0;
+  for (int32 c = 0; c < shortlist.NumClusters(); c++) {
+    KALDI_ASSERT(shortlist.ClusterSize(c) > 0);
+    max_size = std::max(max_size, shortlist.ClusterSize(c));
+  }
+  KALDI_ASSERT(max_size <= 4 * am.NumGauss() / shortlist.NumClusters());
+
+  Matrix<BaseFloat> full_loglikes;
+  BaseFloat fraction;
+  double full_time = ScoreAllPdfs(am, feats, NULL, &full_loglikes, &fraction);
+  CsvResult("AmDiagGmm all Gaussians (per frame)", dim,
+            full_time / num_frames, "seconds");
+  int32 top_clusters[] = { 32, 16, 8 };
+  for (int32 n = 0; n < 3; n++) {
+    shortlist.SetNumTopClusters(top_clusters[n]);
+    Matrix<BaseFloat> loglikes;
+    double elapsed = ScoreAllPdfs(am, feats, &shortlist, &loglikes, &fraction);
+
+    // average error of the log-likelihoods of the pdfs within 10 nats of the
+    // best one (the others are pruned by the decoder anyway), and how often
+    // the best pdf of the frame is the same.
+    double tot_error = 0.0;
+    int32 num_same_best = 0, num_close = 0;
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 best_full, best;
+      BaseFloat best_loglike = full_loglikes.Row(t).Max(&best_full);
+      loglikes.Row(t).Max(&best);
+      if (best == best_full) num_same_best++;
+      for (int32 i = 0; i < num_pdfs; i++) {
+        if (full_loglikes(t, i) > best_loglike - 10.0) {
+          tot_error += full_loglikes(t, i) - loglikes(t, i);
+          num_close++;
+        }
+      }
+    }
+    std::ostringstream name;
+    name << "AmDiagGmm shortlist, top " << top_clusters[n] << " of "
+         << shortlist.NumClusters() << " clusters";
+    CsvResult(name.str() + " (per frame)", dim, elapsed / num_frames,
+              "seconds");
+    CsvResult(name.str() + ": Gaussians evaluated", dim, fraction, "fraction");
+    CsvResult(name.str() + ": log-likelihood error", dim,
+              tot_error / num_close, "nats");
+    CsvResult(name.str() + ": same best pdf", dim,
+              num_same_best / static_cast<BaseFloat>(num_frames), "fraction");
+    CsvResult(name.str() + ": speed-up", dim, full_time / elapsed, "times");
+    // at most twice the share of the selected clusters is evaluated, plus one
+    // Gaussian per pdf for the backoff.  The timings depend on the machine and
+    // its load, so they are only printed.
+    KALDI_ASSERT(fraction <= 2.0 * top_clusters[n] / shortlist.NumClusters() +
+                 num_pdfs / static_cast<BaseFloat>(am.NumGauss()));
+    KALDI_ASSERT(num_same_best >= 0.9 * num_frames &&
+                 tot_error / num_close < 0.5);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 10; i++)
+    UnitTestAmDiagGmmShortlist();
+  UnitTestAmDiagGmmShortlistSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
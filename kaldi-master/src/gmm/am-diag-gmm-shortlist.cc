@@ -0,0 +1,360 @@
+// gmm/am-diag-gmm-shortlist.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "gmm/am-diag-gmm-shortlist.h"
+
+namespace kaldi {
+
+// Squared distances of the rows of "points" to the rows of "centers", up to
+// the norm of the point (which does not change the nearest center).
+static void CenterDistances(const MatrixBase<BaseFloat> &points,
+                            const MatrixBase<BaseFloat> &centers,
+                            Matrix<BaseFloat> *dists) {
+  Vector<BaseFloat> center_norms(centers.NumRows());
+  center_norms.AddDiagMat2(1.0, centers, kNoTrans, 0.0);
+  dists->Resize(points.NumRows(), centers.NumRows(), kUndefined);
+  dists->CopyRowsFromVec(center_norms);
+  dists->AddMatMat(-2.0, points, kNoTrans, centers, kTrans, 1.0);
+}
+
+void AmDiagGmmShortlist::Init(const AmDiagGmm &am,
+                              const Vector<BaseFloat> &state_occs,
+                              const AmDiagGmmShortlistOptions &opts) {
+  KALDI_ASSERT(am.NumPdfs() > 0 && state_occs.Dim() == am.NumPdfs());
+  KALDI_ASSERT(opts.num_clusters > 0 && opts.num_top_clusters > 0);
+  int32 dim = am.Dim(), num_pdfs = am.NumPdfs(), num_gauss = am.NumGauss(),
+      num_clusters = std::min(opts.num_clusters, num_gauss);
+  num_top_clusters_ = opts.num_top_clusters;
+
+  // The means and variances of all Gaussians, and their weights (pdf
+  // occupancy times mixture weight; a small floor keeps unseen pdfs).
+  Matrix<BaseFloat> means(num_gauss, dim, kUndefined),
+      vars(num_gauss, dim, kUndefined);
+  Vector<BaseFloat> weights(num_gauss, kUndefined);
+  gauss_cluster_.resize(num_pdfs);
+  for (int32 pdf_index = 0, i = 0; pdf_index < num_pdfs; pdf_index++) {
+    const DiagGmm &pdf = am.GetPdf(pdf_index);
+    gauss_cluster_[pdf_index].resize(pdf.NumGauss());
+    for (int32 g = 0; g < pdf.NumGauss(); g++, i++) {
+      SubVector<BaseFloat> mean(means, i), var(vars, i);
+      pdf.GetComponentMean(g, &mean);
+      var.CopyFromVec(pdf.inv_vars().Row(g));
+      var.InvertElements();
+      weights(i) = (std::max(state_occs(pdf_index), BaseFloat(0.0)) + 1.0e-03) *
+          pdf.weights()(g);
+    }
+  }
+
+  // k-means on the means, normalized to unit variance per dimension.  The
+  // Gaussians are assigned by distance and not by likelihood, so the broad
+  // clusters do not swallow the others.
+  Matrix<BaseFloat> points(means);
+  {
+    Vector<BaseFloat> offset(dim), scale(dim);
+    offset.AddRowSumMat(1.0 / num_gauss, means, 0.0);
+    scale.AddDiagMat2(1.0 / num_gauss, means, kTrans, 0.0);
+    scale.AddVec2(-1.0, offset);
+    scale.ApplyFloor(1.0e-10);
+    scale.ApplyPow(-0.5);
+    points.AddVecToRows(-1.0, offset);
+    points.MulColsVec(scale);
+  }
+  // k-means++ initialization.
+  Matrix<BaseFloat> centers(num_clusters, dim, kUndefined);
+  {
+    std::vector<double> min_dists(num_gauss,
+                                  std::numeric_limits<double>::infinity());
+    Vector<BaseFloat> diff(dim);
+    int32 next = RandInt(0, num_gauss - 1);
+    for (int32 c = 0; c < num_clusters; c++) {
+      centers.Row(c).CopyFromVec(points.Row(next));
+      double tot = 0.0;
+      for (int32 i = 0; i < num_gauss; i++) {
+        diff.CopyFromVec(points.Row(i));
+        diff.AddVec(-1.0, centers.Row(c));
+        min_dists[i] = std::min(min_dists[i], static_cast<double>(VecVec(diff, diff)));
+        tot += min_dists[i];
+      }
+      double r = RandUniform() * tot;
+      next = 0;
+      for (; next + 1 < num_gauss && (r -= min_dists[next]) > 0.0; next++);
+    }
+  }
+  std::vector<int32> assignment(num_gauss, -1), cluster_sizes(num_clusters);
+  Matrix<BaseFloat> dists;
+  for (int32 iter = 0; iter < 20; iter++) {
+    CenterDistances(points, centers, &dists);
+    int32 num_changed = 0;
+    std::fill(cluster_sizes.begin(), cluster_sizes.end(), 0);
+    std::vector<BaseFloat> own_dists(num_gauss);
+    for (int32 i = 0; i < num_gauss; i++) {
+      int32 c;
+      own_dists[i] = dists.Row(i).Min(&c);
+      if (c != assignment[i]) num_changed++;
+      assignment[i] = c;
+      cluster_sizes[c]++;
+    }
+    // An empty cluster takes the point which is furthest from its center.
+    for (int32 c = 0; c < num_clusters; c++) {
+      if (cluster_sizes[c] > 0) continue;
+      int32 worst = -1;
+      for (int32 i = 0; i < num_gauss; i++)
+        if (cluster_sizes[assignment[i]] > 1 &&
+            (worst < 0 || own_dists[i] > own_dists[worst]))
+          worst = i;
+      KALDI_ASSERT(worst >= 0);
+      cluster_sizes[assignment[worst]]--;
+      assignment[worst] = c;
+      cluster_sizes[c] = 1;
+      own_dists[worst] = 0.0;
+      num_changed++;
+    }
+    centers.SetZero();
+    for (int32 i = 0; i < num_gauss; i++)
+      centers.Row(assignment[i]).AddVec(1.0, points.Row(i));
+    for (int32 c = 0; c < num_clusters; c++)
+      centers.Row(c).Scale(1.0 / cluster_sizes[c]);
+    if (num_changed == 0) break;
+  }
+
+  // The cluster Gaussians: the weighted moments of the members.
+  Vector<double> cluster_weights(num_clusters);
+  Matrix<double> cluster_means(num_clusters, dim), cluster_vars(num_clusters, dim),
+      cluster_sq(num_clusters, dim);
+  for (int32 i = 0; i < num_gauss; i++) {
+    int32 c = assignment[i];
+    Vector<double> mean(means.Row(i)), var(vars.Row(i));
+    cluster_weights(c) += weights(i);
+    cluster_means.Row(c).AddVec(weights(i), mean);
+    cluster_vars.Row(c).AddVec(weights(i), var);
+    cluster_sq.Row(c).AddVec2(weights(i), mean);
+  }
+  Matrix<BaseFloat> ubm_inv_vars(num_clusters, dim), ubm_means(num_clusters, dim);
+  for (int32 c = 0; c < num_clusters; c++) {
+    double w = cluster_weights(c);
+    for (int32 d = 0; d < dim; d++) {
+      double mean = cluster_means(c, d) / w,
+          spread = std::max(cluster_sq(c, d) / w - mean * mean, 0.0);
+      ubm_means(c, d) = mean;
+      ubm_inv_vars(c, d) = 1.0 / (cluster_vars(c, d) / w + spread);
+    }
+  }
+  cluster_weights.Scale(1.0 / cluster_weights.Sum());
+  ubm_.Resize(num_clusters, dim);
+  ubm_.SetWeights(Vector<BaseFloat>(cluster_weights));
+  ubm_.SetInvVarsAndMeans(ubm_inv_vars, ubm_means);
+  ubm_.ComputeGconsts();
+
+  for (int32 pdf_index = 0, i = 0; pdf_index < num_pdfs; pdf_index++)
+    for (size_t g = 0; g < gauss_cluster_[pdf_index].size(); g++, i++)
+      gauss_cluster_[pdf_index][g] = assignment[i];
+  int32 max_size = *std::max_element(cluster_sizes.begin(), cluster_sizes.end());
+  KALDI_LOG << "Built Gaussian shortlist with " << num_clusters
+            << " clusters for " << num_gauss << " Gaussians, average "
+            << (num_gauss / static_cast<BaseFloat>(num_clusters))
+            << " Gaussians per cluster, largest cluster " << max_size << ".";
+  Prepare(am);
+}
+
+void AmDiagGmmShortlist::Prepare(const AmDiagGmm &am) {
+  if (!IsCompatible(am))
+    KALDI_ERR << "The Gaussian shortlist does not match the model.";
+  int32 dim = am.Dim(), num_pdfs = am.NumPdfs(), num_clusters = NumClusters();
+  cluster_begin_.assign(num_clusters + 1, 0);
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++)
+    for (size_t g = 0; g < gauss_cluster_[pdf_index].size(); g++)
+      cluster_begin_[gauss_cluster_[pdf_index][g] + 1]++;
+  for (int32 c = 0; c < num_clusters; c++)
+    cluster_begin_[c + 1] += cluster_begin_[c];
+
+  std::vector<int32> next_row(cluster_begin_.begin(), cluster_begin_.end() - 1);
+  params_.Resize(am.NumGauss(), 2 * dim, kUndefined);
+  gconsts_.Resize(am.NumGauss(), kUndefined);
+  pdf_begin_.resize(num_pdfs + 1);
+  ranges_.clear();
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++) {
+    const DiagGmm &pdf = am.GetPdf(pdf_index);
+    if (!pdf.valid_gconsts())
+      KALDI_ERR << "State "  << pdf_index << ": Must call ComputeGconsts() "
+          "before computing likelihood.";
+    // sorted by cluster, then by decreasing weight.
+    std::vector<std::pair<std::pair<int32, BaseFloat>, int32> > order;
+    for (int32 g = 0; g < pdf.NumGauss(); g++)
+      order.push_back(std::make_pair(std::make_pair(
+          gauss_cluster_[pdf_index][g], -pdf.weights()(g)), g));
+    std::sort(order.begin(), order.end());
+    pdf_begin_[pdf_index] = ranges_.size();
+    for (size_t k = 0; k < order.size(); k++) {
+      int32 c = order[k].first.first, g = order[k].second, r = next_row[c]++;
+      if (k == 0 || c != ranges_.back().cluster) {
+        ClusterRange range;
+        range.cluster = c;
+        range.row = r;
+        range.num_rows = 0;
+        ranges_.push_back(range);
+      }
+      ranges_.back().num_rows++;
+      SubVector<BaseFloat>(params_, r).Range(0, dim).CopyFromVec(
+          pdf.means_invvars().Row(g));
+      SubVector<BaseFloat>(params_, r).Range(dim, dim).CopyFromVec(
+          pdf.inv_vars().Row(g));
+      gconsts_(r) = pdf.gconsts()(g);
+    }
+  }
+  pdf_begin_[num_pdfs] = ranges_.size();
+}
+
+int32 AmDiagGmmShortlist::ClusterSize(int32 c) const {
+  KALDI_ASSERT(c >= 0 && c + 1 < static_cast<int32>(cluster_begin_.size()));
+  return cluster_begin_[c + 1] - cluster_begin_[c];
+}
+
+bool AmDiagGmmShortlist::IsCompatible(const AmDiagGmm &am) const {
+  if (am.Dim() != ubm_.Dim() ||
+      am.NumPdfs() != static_cast<int32>(gauss_cluster_.size()))
+    return false;
+  for (int32 pdf_index = 0; pdf_index < am.NumPdfs(); pdf_index++)
+    if (am.NumGaussInPdf(pdf_index) !=
+        static_cast<int32>(gauss_cluster_[pdf_index].size()))
+      return false;
+  return true;
+}
+
+void AmDiagGmmShortlist::SelectClusters(const VectorBase<BaseFloat> &data,
+                                        FrameInfo *info) const {
+  int32 num_clusters = ubm_.NumGauss(), dim = data.Dim();
+  if (cluster_begin_.empty())
+    KALDI_ERR << "Gaussian shortlist: Prepare() was not called.";
+  info->data.Resize(2 * dim, kUndefined);
+  info->data.Range(0, dim).CopyFromVec(data);
+  info->data.Range(dim, dim).CopyFromVec(data);
+  info->data.Range(dim, dim).ApplyPow(2.0);
+  info->data.Range(dim, dim).Scale(-0.5);
+  info->evaluated.assign(num_clusters, 0);
+  if (info->gauss_loglikes.Dim() != params_.NumRows())
+    info->gauss_loglikes.Resize(params_.NumRows(), kUndefined);
+
+  ubm_.LogLikelihoods(data, &(info->cluster_loglikes));
+  if (num_top_clusters_ >= num_clusters) {
+    info->selected.assign(num_clusters, 1);
+    return;
+  }
+  std::vector<BaseFloat> loglikes(info->cluster_loglikes.Data(),
+                                  info->cluster_loglikes.Data() + num_clusters);
+  std::nth_element(loglikes.begin(), loglikes.begin() + num_top_clusters_ - 1,
+                   loglikes.end(), std::greater<BaseFloat>());
+  BaseFloat threshold = loglikes[num_top_clusters_ - 1];
+  info->selected.resize(num_clusters);
+  for (int32 c = 0; c < num_clusters; c++)
+    info->selected[c] = (info->cluster_loglikes(c) >= threshold);
+}
+
+void AmDiagGmmShortlist::EvaluateCluster(int32 c, FrameInfo *info,
+                                         int64 *num_evaluated) const {
+  int32 begin = cluster_begin_[c], size = cluster_begin_[c + 1] - begin;
+  info->evaluated[c] = 1;
+  if (size == 0) return;
+  SubVector<BaseFloat> loglikes(info->gauss_loglikes, begin, size);
+  loglikes.CopyFromVec(gconsts_.Range(begin, size));
+  loglikes.AddMatVec(1.0, params_.RowRange(begin, size), kNoTrans,
+                     info->data, 1.0);
+  if (num_evaluated != NULL) *num_evaluated += size;
+}
+
+BaseFloat AmDiagGmmShortlist::LogLikelihood(int32 pdf_index, FrameInfo *info,
+                                            BaseFloat log_sum_exp_prune,
+                                            Vector<BaseFloat> *tmp,
+                                            int64 *num_evaluated) const {
+  const ClusterRange *begin = &(ranges_[pdf_begin_[pdf_index]]),
+      *end = &(ranges_[0]) + pdf_begin_[pdf_index + 1];
+  const char *selected = &(info->selected[0]);
+  int32 n = 0;
+  for (const ClusterRange *range = begin; range != end; ++range) {
+    if (selected[range->cluster]) {
+      if (!info->evaluated[range->cluster])
+        EvaluateCluster(range->cluster, info, num_evaluated);
+      if (tmp->Dim() < n + range->num_rows)
+        tmp->Resize(n + range->num_rows, kCopyData);
+      std::copy(info->gauss_loglikes.Data() + range->row,
+                info->gauss_loglikes.Data() + range->row + range->num_rows,
+                tmp->Data() + n);
+      n += range->num_rows;
+    }
+  }
+  if (n == 0) {
+    // Back off to the Gaussian with the largest weight in the best-scoring
+    // cluster of this pdf.
+    const BaseFloat *cluster_loglikes = info->cluster_loglikes.Data();
+    const ClusterRange *best = begin;
+    for (const ClusterRange *range = begin + 1; range != end; ++range)
+      if (cluster_loglikes[range->cluster] > cluster_loglikes[best->cluster])
+        best = range;
+    if (num_evaluated != NULL) (*num_evaluated)++;
+    return gconsts_(best->row) + VecVec(params_.Row(best->row), info->data);
+  }
+  SubVector<BaseFloat> loglikes(*tmp, 0, n);
+  return loglikes.LogSumExp(log_sum_exp_prune);
+}
+
+void AmDiagGmmShortlist::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<AmDiagGmmShortlist>");
+  WriteToken(os, binary, "<NumTopClusters>");
+  WriteBasicType(os, binary, num_top_clusters_);
+  WriteToken(os, binary, "<Ubm>");
+  ubm_.Write(os, binary);
+  WriteToken(os, binary, "<GaussClusters>");
+  int32 num_pdfs = gauss_cluster_.size();
+  WriteBasicType(os, binary, num_pdfs);
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++)
+    WriteIntegerVector(os, binary, gauss_cluster_[pdf_index]);
+  WriteToken(os, binary, "</AmDiagGmmShortlist>");
+}
+
+void AmDiagGmmShortlist::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<AmDiagGmmShortlist>");
+  ExpectToken(is, binary, "<NumTopClusters>");
+  ReadBasicType(is, binary, &num_top_clusters_);
+  ExpectToken(is, binary, "<Ubm>");
+  ubm_.Read(is, binary);
+  ExpectToken(is, binary, "<GaussClusters>");
+  int32 num_pdfs;
+  ReadBasicType(is, binary, &num_pdfs);
+  if (num_pdfs < 0 || num_top_clusters_ <= 0)
+    KALDI_ERR << "Invalid Gaussian shortlist.";
+  gauss_cluster_.resize(num_pdfs);
+  for (int32 pdf_index = 0; pdf_index < num_pdfs; pdf_index++) {
+    ReadIntegerVector(is, binary, &(gauss_cluster_[pdf_index]));
+    for (size_t g = 0; g < gauss_cluster_[pdf_index].size(); g++)
+      if (gauss_cluster_[pdf_index][g] < 0 ||
+          gauss_cluster_[pdf_index][g] >= ubm_.NumGauss())
+        KALDI_ERR << "Invalid cluster index in Gaussian shortlist.";
+  }
+  ExpectToken(is, binary, "</AmDiagGmmShortlist>");
+  cluster_begin_.clear();  // Prepare() must be called with the model.
+  pdf_begin_.clear();
+  ranges_.clear();
+}
+
+}  // namespace kaldi
@@ -0,0 +1,150 @@
+// gmm/am-diag-gmm-shortlist.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_AM_DIAG_GMM_SHORTLIST_H_
+#define KALDI_GMM_AM_DIAG_GMM_SHORTLIST_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/diag-gmm.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct AmDiagGmmShortlistOptions {
+  int32 num_clusters;
+  int32 num_top_clusters;
+
+  AmDiagGmmShortlistOptions(): num_clusters(256), num_top_clusters(16) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("num-clusters", &num_clusters, "Number of k-means clusters "
+                   "of the acoustic-model Gaussians (each cluster is one "
+                   "Gaussian of the selection UBM).");
+    opts->Register("num-top-clusters", &num_top_clusters, "Default number of "
+                   "best-scoring clusters selected per frame; only the "
+                   "Gaussians of these clusters are evaluated.");
+  }
+};
+
+/// AmDiagGmmShortlist is a Gaussian shortlist (Gaussian selection) for the
+/// acoustic scoring of an AmDiagGmm.  The Gaussians of the acoustic model are
+/// clustered with k-means on their means (normalized by the global variance of
+/// the means), which gives clusters of similar size, and each cluster is
+/// represented by one diagonal Gaussian (the moment-matched union of its
+/// members; together they form the "UBM").  For each frame the UBM is
+/// evaluated, the NumTopClusters() best components are selected and only the
+/// member Gaussians of those clusters are evaluated in each pdf; the others
+/// are treated as having zero likelihood.  If none of the Gaussians of a pdf
+/// is in a selected cluster, its Gaussian with the largest weight in its
+/// best-scoring cluster is used instead, so every pdf gets a finite
+/// likelihood at the cost of a single Gaussian.
+/// Prepare() copies the parameters of the Gaussians ordered by cluster, and the
+/// members of a selected cluster (of all pdfs) are evaluated together with one
+/// matrix-vector product the first time a pdf needs them in a frame.
+/// With NumTopClusters() >= NumClusters() the result equals
+/// AmDiagGmm::LogLikelihood().
+class AmDiagGmmShortlist {
+ public:
+  /// The per-frame selection and the log-likelihoods of the Gaussians of the
+  /// selected clusters; computed by SelectClusters() and LogLikelihood().
+  struct FrameInfo {
+    Vector<BaseFloat> cluster_loglikes;  // UBM log-likelihoods, per cluster
+    std::vector<char> selected;  // per cluster
+    Vector<BaseFloat> data;  // [x, -0.5 x^2]
+    std::vector<char> evaluated;  // per cluster: gauss_loglikes is valid
+    Vector<BaseFloat> gauss_loglikes;  // in the order of Prepare()
+  };
+
+  AmDiagGmmShortlist(): num_top_clusters_(0) { }
+
+  /// Builds the shortlist for "am"; "state_occs" are the pdf occupancies
+  /// (as in final.occs), used to weight the Gaussians in the cluster
+  /// Gaussians.  Also calls Prepare(am).
+  void Init(const AmDiagGmm &am, const Vector<BaseFloat> &state_occs,
+            const AmDiagGmmShortlistOptions &opts);
+
+  /// Copies the likelihood parameters of "am" (which must be compatible)
+  /// ordered by cluster; must be called after Read() before the shortlist is
+  /// used, and again if the parameters of the model change.
+  void Prepare(const AmDiagGmm &am);
+
+  int32 NumClusters() const { return ubm_.NumGauss(); }
+  int32 NumTopClusters() const { return num_top_clusters_; }
+  void SetNumTopClusters(int32 num_top_clusters) {
+    KALDI_ASSERT(num_top_clusters > 0);
+    num_top_clusters_ = num_top_clusters;
+  }
+  const DiagGmm &Ubm() const { return ubm_; }
+  /// The number of Gaussians in cluster c.
+  int32 ClusterSize(int32 c) const;
+
+  /// Returns true if the shortlist was built for a model with the same
+  /// number of pdfs, Gaussians per pdf and dimension as "am".
+  bool IsCompatible(const AmDiagGmm &am) const;
+
+  /// Computes the UBM log-likelihoods of "data" and selects the best
+  /// NumTopClusters() clusters.
+  void SelectClusters(const VectorBase<BaseFloat> &data, FrameInfo *info) const;
+
+  /// Log-likelihood of pdf "pdf_index" computed over the selected Gaussians
+  /// only, for the frame of the last SelectClusters() on "info".  "tmp" is a
+  /// work vector; if num_evaluated != NULL the number of Gaussians evaluated
+  /// (the sizes of the clusters evaluated for this call) is added to it.
+  /// log_sum_exp_prune is as in DecodableAmDiagGmmUnmapped.
+  BaseFloat LogLikelihood(int32 pdf_index, FrameInfo *info,
+                          BaseFloat log_sum_exp_prune,
+                          Vector<BaseFloat> *tmp,
+                          int64 *num_evaluated) const;
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+ private:
+  void EvaluateCluster(int32 c, FrameInfo *info, int64 *num_evaluated) const;
+
+  DiagGmm ubm_;
+  int32 num_top_clusters_;
+  // gauss_cluster_[pdf][gauss] is the cluster (UBM component) of the Gaussian.
+  std::vector<std::vector<int32> > gauss_cluster_;
+
+  // Set by Prepare(): the Gaussians ordered by cluster; the members of cluster
+  // c are the rows [cluster_begin_[c], cluster_begin_[c + 1]).
+  // The Gaussians of a pdf in one cluster have consecutive rows (by
+  // decreasing weight), a ClusterRange; the ranges of pdf p are
+  // ranges_[pdf_begin_[p] .. pdf_begin_[p + 1] - 1].
+  struct ClusterRange {
+    int32 cluster;
+    int32 row;
+    int32 num_rows;
+  };
+  std::vector<int32> cluster_begin_;
+  std::vector<int32> pdf_begin_;
+  std::vector<ClusterRange> ranges_;
+  Matrix<BaseFloat> params_;  // rows [means_invvars, inv_vars]
+  Vector<BaseFloat> gconsts_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AmDiagGmmShortlist);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_AM_DIAG_GMM_SHORTLIST_H_
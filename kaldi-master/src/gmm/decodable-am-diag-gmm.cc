@@ -39,6 +39,10 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
   if (frame != previous_frame_) {  // cache the squared stats.
     data_squared_.CopyFromVec(feature_matrix_.Row(frame));
     data_squared_.ApplyPow(2.0);
+    if (shortlist_ != NULL)
+      shortlist_->SelectClusters(feature_matrix_.Row(frame), &shortlist_info_);
+    if (packed_ != NULL)
+      packed_->ComputeFrameData(feature_matrix_.Row(frame), &packed_frame_);
     previous_frame_ = frame;
   }
 
@@ -55,13 +59,25 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
         "before computing likelihood.";
   }
 
-  Vector<BaseFloat> loglikes(pdf.gconsts());  // need to recreate for each pdf
-  // loglikes +=  means * inv(vars) * data.
-  loglikes.AddMatVec(1.0, pdf.means_invvars(), kNoTrans, data, 1.0);
-  // loglikes += -0.5 * inv(vars) * data_sq.
-  loglikes.AddMatVec(-0.5, pdf.inv_vars(), kNoTrans, data_squared_, 1.0);
-
-  BaseFloat log_sum = loglikes.LogSumExp(log_sum_exp_prune_);
+  num_gauss_total_ += pdf.NumGauss();
+  BaseFloat log_sum;
+  if (shortlist_ != NULL) {
+    log_sum = shortlist_->LogLikelihood(state, &shortlist_info_,
+                                        log_sum_exp_prune_, &loglikes_tmp_,
+                                        &num_gauss_evaluated_);
+  } else if (packed_ != NULL) {
+    log_sum = packed_->LogLikelihood(state, packed_frame_, log_sum_exp_prune_,
+                                     &loglikes_tmp_);
+    num_gauss_evaluated_ += pdf.NumGauss();
+  } else {
+    Vector<BaseFloat> loglikes(pdf.gconsts());  // need to recreate for each pdf
+    // loglikes +=  means * inv(vars) * data.
+    loglikes.AddMatVec(1.0, pdf.means_invvars(), kNoTrans, data, 1.0);
+    // loglikes += -0.5 * inv(vars) * data_sq.
+    loglikes.AddMatVec(-0.5, pdf.inv_vars(), kNoTrans, data_squared_, 1.0);
+    log_sum = loglikes.LogSumExp(log_sum_exp_prune_);
+    num_gauss_evaluated_ += pdf.NumGauss();
+  }
   if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
     KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
 
@@ -26,6 +26,8 @@
 
 #include "base/kaldi-common.h"
 #include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-packed.h"
+#include "gmm/am-diag-gmm-shortlist.h"
 #include "hmm/transition-model.h"
 #include "itf/decodable-itf.h"
 #include "transform/regression-tree.h"
@@ -53,10 +55,42 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
                              BaseFloat log_sum_exp_prune = -1.0):
     acoustic_model_(am), feature_matrix_(feats),
     previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune), 
+    shortlist_(NULL), packed_(NULL), num_gauss_evaluated_(0),
+    num_gauss_total_(0),
     data_squared_(feats.NumCols()) {
     ResetLogLikeCache();
   }
 
+  /// Makes the likelihood computation evaluate only the Gaussians selected by
+  /// "shortlist" in each frame (see AmDiagGmmShortlist); NULL (the default)
+  /// evaluates all Gaussians.  The shortlist is not owned and must be
+  /// compatible with the model and prepared for it (see
+  /// AmDiagGmmShortlist::Prepare()).  Call it before the first LogLikelihood().
+  void SetShortlist(const AmDiagGmmShortlist *shortlist) {
+    KALDI_ASSERT(shortlist == NULL || shortlist->IsCompatible(acoustic_model_));
+    KALDI_ASSERT(shortlist == NULL || packed_ == NULL);
+    shortlist_ = shortlist;
+    previous_frame_ = -1;
+    ResetLogLikeCache();
+  }
+  /// Makes the likelihood computation use the reduced-precision copy of the
+  /// model in "packed" (see AmDiagGmmPacked); NULL (the default) uses the
+  /// float parameters of the model.  Not owned; cannot be combined with
+  /// SetShortlist().  Call it before the first LogLikelihood().
+  void SetPackedModel(const AmDiagGmmPacked *packed) {
+    KALDI_ASSERT(packed == NULL || packed->IsCompatible(acoustic_model_));
+    KALDI_ASSERT(packed == NULL || shortlist_ == NULL);
+    packed_ = packed;
+    previous_frame_ = -1;
+    ResetLogLikeCache();
+  }
+  /// The number of Gaussians evaluated so far, and the number that would
+  /// have been evaluated without the shortlist.  [With the shortlist the
+  /// selected clusters are evaluated for all pdfs at once, so if only a few
+  /// pdfs are requested per frame the first can exceed the second.]
+  int64 NumGaussEvaluated() const { return num_gauss_evaluated_; }
+  int64 NumGaussTotal() const { return num_gauss_total_; }
+
   // Note, frames are numbered from zero.  But state_index is numbered
   // from one (this routine is called by FSTs).
   virtual BaseFloat LogLikelihood(int32 frame, int32 state_index) {
@@ -87,8 +121,16 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
     int32 hit_time;     ///< Frame for which this value is relevant
   };
   std::vector<LikelihoodCacheRecord> log_like_cache_;
+
+  const AmDiagGmmShortlist *shortlist_;  ///< Not owned; may be NULL
+  AmDiagGmmShortlist::FrameInfo shortlist_info_;  ///< For previous_frame_
+  const AmDiagGmmPacked *packed_;  ///< Not owned; may be NULL
+  AmDiagGmmPacked::FrameData packed_frame_;  ///< For previous_frame_
+  int64 num_gauss_evaluated_;
+  int64 num_gauss_total_;
  private:
   Vector<BaseFloat> data_squared_;  ///< Cache for fast likelihood calculation
+  Vector<BaseFloat> loglikes_tmp_;  ///< Work space of shortlist_, packed_
 
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmDiagGmmUnmapped);
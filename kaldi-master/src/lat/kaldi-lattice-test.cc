@@ -95,6 +95,85 @@ void TestCompactLatticeTableCross(bool binary) {
   }
 }
 
+// CompactLattice in indexed archive, exact (precision -1) or quantized.
+void TestCompactLatticeIndexed(int32 precision) {
+  std::string wspecifier = "idx:tmpf.idx";
+  if (precision >= 0)
+    wspecifier = "q" + std::to_string(precision) + "," + wspecifier;
+  CompactLatticeWriter writer(wspecifier);
+  int N = 10;
+  std::vector<CompactLattice*> lat_vec(N);
+  for (int i = 0; i < N; i++) {
+    std::string key = "key" + std::to_string(i);
+    lat_vec[i] = RandCompactLattice();
+    writer.Write(key, *(lat_vec[i]));
+  }
+  writer.Close();
+
+  float delta = (precision >= 0 ? std::pow(10.0, -precision) : 0.0);
+  SequentialCompactLatticeReader seq_reader("idx:tmpf.idx");
+  for (int i = 0; i < N; i++, seq_reader.Next()) {
+    KALDI_ASSERT(!seq_reader.Done() &&
+                 seq_reader.Key() == "key" + std::to_string(i));
+    KALDI_ASSERT(fst::Equal(seq_reader.Value(), *(lat_vec[i]), delta));
+  }
+  KALDI_ASSERT(seq_reader.Done());
+
+  RandomAccessCompactLatticeReader reader("idx:tmpf.idx");
+  for (int i = N - 1; i >= 0; i--) {
+    std::string key = "key" + std::to_string(i);
+    KALDI_ASSERT(reader.HasKey(key));
+    KALDI_ASSERT(fst::Equal(reader.Value(key), *(lat_vec[i]), delta));
+    delete lat_vec[i];
+  }
+}
+
+// Indexed archive written as CompactLattice and read as Lattice, and the
+// other way round.
+void TestLatticeIndexedCross() {
+  int N = 10;
+  std::vector<CompactLattice*> clat_vec(N);
+  std::vector<Lattice*> lat_vec(N);
+  {
+    CompactLatticeWriter clat_writer("idx:tmpf.idx");
+    LatticeWriter lat_writer("idx:tmpf2.idx");
+    for (int i = 0; i < N; i++) {
+      std::string key = "key" + std::to_string(i);
+      clat_vec[i] = RandCompactLattice();
+      clat_writer.Write(key, *(clat_vec[i]));
+      lat_vec[i] = RandLattice();
+      lat_writer.Write(key, *(lat_vec[i]));
+    }
+  }
+
+  SequentialLatticeReader seq_reader("idx:tmpf.idx");
+  RandomAccessLatticeReader reader("idx:tmpf.idx");
+  for (int i = 0; i < N; i++, seq_reader.Next()) {
+    std::string key = "key" + std::to_string(i);
+    KALDI_ASSERT(!seq_reader.Done() && seq_reader.Key() == key);
+    CompactLattice clat;
+    ConvertLattice(seq_reader.Value(), &clat);
+    KALDI_ASSERT(fst::Equal(clat, *(clat_vec[i])));
+    KALDI_ASSERT(reader.HasKey(key));
+    ConvertLattice(reader.Value(key), &clat);
+    KALDI_ASSERT(fst::Equal(clat, *(clat_vec[i])));
+  }
+  KALDI_ASSERT(seq_reader.Done());
+
+  RandomAccessCompactLatticeReader clat_reader("idx:tmpf2.idx");
+  RandomAccessLatticeReader lat_reader("idx:tmpf2.idx");
+  for (int i = 0; i < N; i++) {
+    std::string key = "key" + std::to_string(i);
+    Lattice lat;
+    ConvertLattice(clat_reader.Value(key), &lat);
+    KALDI_ASSERT(fst::RandEquivalent(lat, *(lat_vec[i]), 5, 0.01, Rand(), 10));
+    KALDI_ASSERT(fst::RandEquivalent(lat_reader.Value(key), *(lat_vec[i]), 5,
+                                     0.01, Rand(), 10));
+    delete clat_vec[i];
+    delete lat_vec[i];
+  }
+}
+
 // Lattice, binary.
 void TestLatticeTable(bool binary) {
   LatticeWriter writer(binary ? "ark:tmpf" : "ark,t:tmpf");
@@ -167,7 +246,12 @@ int main() {
     TestLatticeTable(binary);
     TestLatticeTableCross(binary);
   }
+  TestCompactLatticeIndexed(-1);
+  TestCompactLatticeIndexed(3);
+  TestLatticeIndexedCross();
   std::cout << "Test OK\n";
   
   unlink("tmpf");
+  unlink("tmpf.idx");
+  unlink("tmpf2.idx");
 }
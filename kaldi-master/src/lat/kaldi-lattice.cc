@@ -385,6 +385,199 @@ bool CompactLatticeHolder::Read(std::istream &is) {
   }
 }
 
+// Writes a weight value for IndexedArchiveCodec<CompactLatticeHolder>: either
+// (rounded value << 1) as a zigzag varint, or 1 followed by the raw float.
+static void EncodeLatticeFloat(float value, double scale, std::string *bytes) {
+  if (scale > 0.0) {
+    double scaled = value * scale;
+    if (KALDI_ISFINITE(scaled) && std::abs(scaled) < 1.0e15) {
+      int64 rounded = static_cast<int64>(std::floor(scaled + 0.5));
+      WriteVarint(ZigZagEncode(rounded) << 1, bytes);
+      return;
+    }
+    bytes->push_back(1);  // the varint 1: raw float follows.
+  }
+  bytes->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static bool DecodeLatticeFloat(const char **data, const char *end,
+                               double scale, float *value) {
+  if (scale > 0.0) {
+    uint64 code;
+    if (!ReadVarint(data, end, &code)) return false;
+    if ((code & 1) == 0) {
+      *value = static_cast<float>(ZigZagDecode(code >> 1) / scale);
+      return true;
+    }
+  }
+  if (end - *data < static_cast<ptrdiff_t>(sizeof(float))) return false;
+  memcpy(value, *data, sizeof(float));
+  *data += sizeof(float);
+  return true;
+}
+
+static void EncodeCompactLatticeWeight(const CompactLatticeWeight &w,
+                                       double scale, std::string *bytes) {
+  EncodeLatticeFloat(w.Weight().Value1(), scale, bytes);
+  EncodeLatticeFloat(w.Weight().Value2(), scale, bytes);
+  const std::vector<int32> &str = w.String();
+  WriteVarint(str.size(), bytes);
+  int32 prev = 0;
+  for (size_t i = 0; i < str.size(); i++) {
+    WriteVarint(ZigZagEncode(static_cast<int64>(str[i]) - prev), bytes);
+    prev = str[i];
+  }
+}
+
+static bool DecodeCompactLatticeWeight(const char **data, const char *end,
+                                       double scale, CompactLatticeWeight *w) {
+  float value1, value2;
+  uint64 size, delta;
+  if (!DecodeLatticeFloat(data, end, scale, &value1) ||
+      !DecodeLatticeFloat(data, end, scale, &value2) ||
+      !ReadVarint(data, end, &size) ||
+      size > static_cast<uint64>(end - *data))  // each element is >= 1 byte.
+    return false;
+  std::vector<int32> str(size);
+  int64 prev = 0;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (!ReadVarint(data, end, &delta)) return false;
+    prev += ZigZagDecode(delta);
+    str[i] = static_cast<int32>(prev);
+  }
+  *w = CompactLatticeWeight(LatticeWeight(value1, value2), str);
+  return true;
+}
+
+bool IndexedArchiveCodec<CompactLatticeHolder>::Encode(
+    const CompactLattice &clat, bool binary, int32 precision,
+    std::string *bytes) {
+  typedef CompactLattice::StateId StateId;
+  bytes->clear();
+  double scale = 0.0;  // 0.0 means exact.
+  if (precision >= 0) {
+    bytes->push_back(1);
+    WriteVarint(precision, bytes);
+    scale = std::pow(10.0, precision);
+  } else {
+    bytes->push_back(0);
+  }
+  StateId num_states = clat.NumStates();
+  WriteVarint(num_states, bytes);
+  WriteVarint(clat.Start() + 1, bytes);  // kNoStateId is -1.
+  for (StateId s = 0; s < num_states; s++) {
+    WriteVarint(clat.NumArcs(s), bytes);
+    CompactLatticeWeight final_weight = clat.Final(s);
+    if (final_weight == CompactLatticeWeight::Zero()) {
+      bytes->push_back(0);
+    } else {
+      bytes->push_back(1);
+      EncodeCompactLatticeWeight(final_weight, scale, bytes);
+    }
+    int64 prev_ilabel = 0;
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      WriteVarint(ZigZagEncode(arc.ilabel - prev_ilabel), bytes);
+      WriteVarint(ZigZagEncode(static_cast<int64>(arc.olabel) - arc.ilabel),
+                  bytes);
+      WriteVarint(ZigZagEncode(static_cast<int64>(arc.nextstate) - s), bytes);
+      EncodeCompactLatticeWeight(arc.weight, scale, bytes);
+      prev_ilabel = arc.ilabel;
+    }
+  }
+  return true;
+}
+
+bool IndexedArchiveCodec<CompactLatticeHolder>::Decode(
+    const char *data, size_t size, CompactLatticeHolder *holder) {
+  typedef CompactLattice::StateId StateId;
+  holder->Clear();
+  const char *end = data + size;
+  if (size == 0) return false;
+  double scale = 0.0;
+  uint64 precision, num_states, start;
+  if (*data++ != 0) {
+    if (!ReadVarint(&data, end, &precision) || precision > 15) return false;
+    scale = std::pow(10.0, static_cast<double>(precision));
+  }
+  if (!ReadVarint(&data, end, &num_states) ||
+      num_states > static_cast<uint64>(end - data) ||  // >= 2 bytes per state.
+      !ReadVarint(&data, end, &start) || start > num_states)
+    return false;
+  CompactLattice *clat = new CompactLattice();
+  for (uint64 s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(static_cast<StateId>(start) - 1);
+  bool ok = true;
+  for (StateId s = 0; ok && s < static_cast<StateId>(num_states); s++) {
+    uint64 num_arcs, ilabel_delta, olabel_delta, nextstate_delta;
+    if (!ReadVarint(&data, end, &num_arcs) || data == end ||
+        num_arcs > static_cast<uint64>(end - data)) {
+      ok = false;
+      break;
+    }
+    if (*data++ != 0) {
+      CompactLatticeWeight final_weight;
+      if (!DecodeCompactLatticeWeight(&data, end, scale, &final_weight)) {
+        ok = false;
+        break;
+      }
+      clat->SetFinal(s, final_weight);
+    }
+    clat->ReserveArcs(s, num_arcs);
+    int64 ilabel = 0;
+    for (uint64 a = 0; a < num_arcs; a++) {
+      CompactLatticeArc arc;
+      if (!ReadVarint(&data, end, &ilabel_delta) ||
+          !ReadVarint(&data, end, &olabel_delta) ||
+          !ReadVarint(&data, end, &nextstate_delta) ||
+          !DecodeCompactLatticeWeight(&data, end, scale, &arc.weight)) {
+        ok = false;
+        break;
+      }
+      ilabel += ZigZagDecode(ilabel_delta);
+      int64 nextstate = s + ZigZagDecode(nextstate_delta);
+      if (nextstate < 0 || nextstate >= static_cast<int64>(num_states)) {
+        ok = false;
+        break;
+      }
+      arc.ilabel = static_cast<int32>(ilabel);
+      arc.olabel = static_cast<int32>(ilabel + ZigZagDecode(olabel_delta));
+      arc.nextstate = static_cast<StateId>(nextstate);
+      clat->AddArc(s, arc);
+    }
+  }
+  if (!ok || data != end) {
+    KALDI_WARN << "Corrupted compact lattice in indexed archive.";
+    delete clat;
+    return false;
+  }
+  holder->t_ = clat;
+  return true;
+}
+
+bool IndexedArchiveCodec<LatticeHolder>::Encode(
+    const Lattice &lat, bool binary, int32 precision, std::string *bytes) {
+  CompactLattice clat;
+  ConvertLattice(lat, &clat);
+  return IndexedArchiveCodec<CompactLatticeHolder>::Encode(clat, binary,
+                                                           precision, bytes);
+}
+
+bool IndexedArchiveCodec<LatticeHolder>::Decode(
+    const char *data, size_t size, LatticeHolder *holder) {
+  holder->Clear();
+  CompactLatticeHolder compact_holder;
+  if (!IndexedArchiveCodec<CompactLatticeHolder>::Decode(data, size,
+                                                         &compact_holder))
+    return false;
+  Lattice *lat = new Lattice();
+  ConvertLattice(compact_holder.Value(), lat);
+  holder->t_ = lat;
+  return true;
+}
+
 bool WriteLattice(std::ostream &os, bool binary, const Lattice &t) {
   if (binary) {
     fst::FstWriteOptions opts;
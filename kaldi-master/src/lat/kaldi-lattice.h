@@ -66,6 +66,11 @@ bool ReadLattice(std::istream &is, bool binary,
                  Lattice **lat);
 
 
+class CompactLatticeHolder;
+template<> class IndexedArchiveCodec<CompactLatticeHolder>;
+class LatticeHolder;
+template<> class IndexedArchiveCodec<LatticeHolder>;
+
 class CompactLatticeHolder {
  public:
   typedef CompactLattice T;
@@ -101,9 +106,27 @@ class CompactLatticeHolder {
 
   ~CompactLatticeHolder() { Clear(); }
  private:
+  friend class IndexedArchiveCodec<CompactLatticeHolder>;
   T *t_;
 };
 
+/// The encoding of compact lattices in indexed archives ("idx:", see
+/// util/indexed-archive.h).  States and arcs are written as varints, with the
+/// input labels as deltas from the previous arc of the state, the output labels
+/// relative to the input labels, the next states relative to the state and the
+/// transition-id strings as deltas; this is typically several times smaller
+/// than the OpenFst binary format.  The weights are written as floats, or, if
+/// the "q<n>" option was given in the wspecifier, rounded to n decimals and
+/// written as varints (infinities are kept exactly).  The 't' option is
+/// ignored.
+template<> class IndexedArchiveCodec<CompactLatticeHolder> {
+ public:
+  static bool Encode(const CompactLattice &clat, bool binary, int32 precision,
+                     std::string *bytes);
+  static bool Decode(const char *data, size_t size,
+                     CompactLatticeHolder *holder);
+};
+
 class LatticeHolder {
  public:
   typedef Lattice T;
@@ -139,9 +162,23 @@ class LatticeHolder {
 
   ~LatticeHolder() { Clear(); }
  private:
+  friend class IndexedArchiveCodec<LatticeHolder>;
   T *t_;
 };
 
+/// Lattices are stored in indexed archives in the encoding of compact lattices
+/// (see above), so that, as with "ark:", an archive written as Lattice can be
+/// read as CompactLattice and vice versa.  Encode() converts the lattice to a
+/// CompactLattice and Decode() converts it back, as LatticeHolder::Read() does
+/// with a CompactLattice in an archive; the paths and their weights are kept
+/// but not necessarily the state numbering.
+template<> class IndexedArchiveCodec<LatticeHolder> {
+ public:
+  static bool Encode(const Lattice &lat, bool binary, int32 precision,
+                     std::string *bytes);
+  static bool Decode(const char *data, size_t size, LatticeHolder *holder);
+};
+
 typedef TableWriter<LatticeHolder> LatticeWriter;
 typedef SequentialTableReader<LatticeHolder> SequentialLatticeReader;
 typedef RandomAccessTableReader<LatticeHolder> RandomAccessLatticeReader;
@@ -0,0 +1,213 @@
+// lat/lattice-postprocessor-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <set>
+
+#include "lat/lattice-postprocessor.h"
+#include "lat/lattice-functions.h"
+#include "lat/sausages.h"
+
+namespace kaldi {
+
+// A random word lattice whose states are at increasing times, with arcs
+// between states whose length is the time difference, so that all paths have
+// the same length (as in a real lattice; MinimumBayesRisk needs this).
+static CompactLattice *RandCompactLattice() {
+  CompactLattice *clat = new CompactLattice;
+  int32 num_states = RandInt(2, 8), num_words = RandInt(2, 6);
+  std::vector<int32> times(num_states);
+  times[0] = 0;
+  for (int32 s = 0; s < num_states; s++) {
+    clat->AddState();
+    if (s > 0) times[s] = times[s - 1] + RandInt(1, 3);
+  }
+  clat->SetStart(0);
+  for (int32 s = 0; s + 1 < num_states; s++) {
+    // an arc to the next state, so that every state is on a successful path,
+    // and a few arcs which skip states.
+    int32 num_arcs = RandInt(1, 3);
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 next = (a == 0 ? s + 1 : RandInt(s + 1, num_states - 1));
+      std::vector<int32> string(times[next] - times[s]);
+      for (size_t i = 0; i < string.size(); i++) string[i] = RandInt(1, 20);
+      LatticeWeight weight(5.0 * RandUniform(), 20.0 * RandUniform());
+      int32 word = (RandInt(0, 4) == 0 ? 0 : RandInt(1, num_words));
+      clat->AddArc(s, CompactLatticeArc(word, word,
+                                        CompactLatticeWeight(weight, string),
+                                        next));
+    }
+  }
+  clat->SetFinal(num_states - 1, CompactLatticeWeight::One());
+  return clat;
+}
+
+// lattice-scale --inv-acoustic-scale=lmwt | lattice-add-penalty
+static void OldScaleAndPenalty(BaseFloat lmwt, BaseFloat penalty,
+                               CompactLattice *clat) {
+  std::vector<std::vector<double> > scale(2);
+  scale[0].resize(2);
+  scale[1].resize(2);
+  scale[0][0] = 1.0;
+  scale[0][1] = 0.0;
+  scale[1][0] = 0.0;
+  scale[1][1] = 1.0 / lmwt;
+  ScaleLattice(scale, clat);
+  AddWordInsPenToCompactLattice(penalty, clat);
+}
+
+// lattice-best-path; returns false if it failed.
+static bool OldBestPath(const CompactLattice &clat, std::vector<int32> *words) {
+  CompactLattice clat_best_path;
+  CompactLatticeShortestPath(clat, &clat_best_path);
+  Lattice best_path;
+  ConvertLattice(clat_best_path, &best_path);
+  if (best_path.Start() == fst::kNoStateId) return false;
+  std::vector<int32> alignment;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, &alignment, words, &weight);
+  return true;
+}
+
+// scale, penalty and 1best give the same words as the archive pipeline
+// lattice-scale | lattice-add-penalty | lattice-best-path.
+static void TestScalePenaltyOneBest() {
+  LatticePostprocessOptions opts;
+  opts.ops = "scale,penalty,1best";
+  opts.inv_acoustic_scales = "7,10,13.5";
+  opts.word_ins_penalties = "0.0,0.5,1.0";
+  std::vector<BaseFloat> lmwts, penalties;
+  lmwts.push_back(7.0);
+  lmwts.push_back(10.0);
+  lmwts.push_back(13.5);
+  penalties.push_back(0.0);
+  penalties.push_back(0.5);
+  penalties.push_back(1.0);
+  LatticePostprocessor processor(opts, NULL, NULL, NULL);
+  KALDI_ASSERT(processor.NumSettings() == 9);
+  KALDI_ASSERT(!processor.HasOp(kLatOpMbr));
+
+  for (int32 n = 0; n < 10; n++) {
+    CompactLattice *clat = RandCompactLattice();
+    std::vector<LatticePostprocessResult> results;
+    processor.Process("utt", *clat, &results);
+    KALDI_ASSERT(results.size() == 9);
+    for (int32 s = 0; s < 9; s++) {
+      CompactLattice old_clat(*clat);
+      OldScaleAndPenalty(lmwts[s / 3], penalties[s % 3], &old_clat);
+      std::vector<int32> old_words;
+      bool old_ok = OldBestPath(old_clat, &old_words);
+      KALDI_ASSERT(results[s].ok == old_ok);
+      if (old_ok) KALDI_ASSERT(results[s].words == old_words);
+    }
+    delete clat;
+  }
+}
+
+// prune and mbr give the same hypothesis and Bayes risk as the archive
+// pipeline lattice-scale | lattice-add-penalty | lattice-prune |
+// lattice-mbr-decode.
+static void TestPruneMbr() {
+  LatticePostprocessOptions opts;
+  opts.ops = "scale,penalty,prune,mbr";
+  opts.inv_acoustic_scales = "8,12";
+  opts.word_ins_penalties = "0.5";
+  opts.beam = 4.0;
+  std::vector<BaseFloat> lmwts;
+  lmwts.push_back(8.0);
+  lmwts.push_back(12.0);
+  LatticePostprocessor processor(opts, NULL, NULL, NULL);
+  KALDI_ASSERT(processor.NumSettings() == 2);
+  KALDI_ASSERT(processor.HasOp(kLatOpPrune) && processor.HasOp(kLatOpMbr));
+
+  for (int32 n = 0; n < 10; n++) {
+    CompactLattice *clat = RandCompactLattice();
+    std::vector<LatticePostprocessResult> results;
+    processor.Process("utt", *clat, &results);
+    KALDI_ASSERT(results.size() == 2);
+    for (int32 s = 0; s < 2; s++) {
+      CompactLattice old_clat(*clat);
+      OldScaleAndPenalty(lmwts[s], 0.5, &old_clat);
+      // lattice-prune with the default --acoustic-scale=1.0.
+      KALDI_ASSERT(PruneLattice(opts.beam, &old_clat));
+      MinimumBayesRisk mbr(old_clat);
+      KALDI_ASSERT(results[s].ok);
+      KALDI_ASSERT(results[s].words == mbr.GetOneBest());
+      KALDI_ASSERT(ApproxEqual(results[s].bayes_risk, mbr.GetBayesRisk()));
+    }
+    delete clat;
+  }
+}
+
+static void TestSettingNames() {
+  LatticePostprocessOptions opts;
+  opts.ops = "scale,penalty,1best";
+  opts.inv_acoustic_scales = "7,10";
+  opts.word_ins_penalties = "0.0,0.5";
+  LatticePostprocessor processor(opts, NULL, NULL, NULL);
+  KALDI_ASSERT(processor.NumSettings() == 4);
+  // the names are the values as given in the options, the penalties vary
+  // fastest.
+  KALDI_ASSERT(processor.SettingName("penalty_{WIP}/{LMWT}.tra", 0) ==
+               "penalty_0.0/7.tra");
+  KALDI_ASSERT(processor.SettingName("penalty_{WIP}/{LMWT}.tra", 1) ==
+               "penalty_0.5/7.tra");
+  KALDI_ASSERT(processor.SettingName("penalty_{WIP}/{LMWT}.tra", 3) ==
+               "penalty_0.5/10.tra");
+  KALDI_ASSERT(processor.SettingName("ark:{LMWT}_{LMWT}.tra", 2) ==
+               "ark:10_10.tra");
+  KALDI_ASSERT(processor.SettingName("ark:best.tra", 3) == "ark:best.tra");
+  KALDI_ASSERT(processor.SettingsDistinct("penalty_{WIP}/{LMWT}.tra"));
+  KALDI_ASSERT(!processor.SettingsDistinct("{LMWT}.tra"));
+  KALDI_ASSERT(!processor.SettingsDistinct("penalty_{WIP}.tra"));
+  KALDI_ASSERT(!processor.SettingsDistinct("best.tra"));
+  std::set<std::string> names;
+  for (int32 s = 0; s < processor.NumSettings(); s++)
+    names.insert(processor.SettingName("{WIP}/{LMWT}", s));
+  KALDI_ASSERT(names.size() == 4);
+
+  // without 'penalty' there is one unnamed penalty, {WIP} is not needed.
+  opts.ops = "scale,mbr";
+  LatticePostprocessor scale_only(opts, NULL, NULL, NULL);
+  KALDI_ASSERT(scale_only.NumSettings() == 2);
+  KALDI_ASSERT(scale_only.SettingName("{WIP}{LMWT}.tra", 1) == "10.tra");
+  KALDI_ASSERT(scale_only.SettingsDistinct("{LMWT}.tra"));
+  KALDI_ASSERT(!scale_only.SettingsDistinct("{WIP}.tra"));
+
+  // a single value needs no placeholder.
+  opts.ops = "scale,penalty,1best";
+  opts.inv_acoustic_scales = "10";
+  opts.word_ins_penalties = "0.5";
+  LatticePostprocessor single(opts, NULL, NULL, NULL);
+  KALDI_ASSERT(single.NumSettings() == 1);
+  KALDI_ASSERT(single.SettingsDistinct("best.tra"));
+  KALDI_ASSERT(single.SettingName("{WIP}_{LMWT}", 0) == "0.5_10");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestSettingNames();
+  for (int32 i = 0; i < 5; i++) {
+    TestScalePenaltyOneBest();
+    TestPruneMbr();
+  }
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
@@ -0,0 +1,243 @@
+// lat/lattice-postprocessor.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "lat/lattice-postprocessor.h"
+#include "lat/lattice-functions.h"
+#include "lat/sausages.h"
+
+namespace kaldi {
+
+// Parses a comma separated list of numbers; keeps the strings as given for the
+// names of the settings.
+static void ParseSettingList(const std::string &list, const char *name,
+                             std::vector<std::string> *names,
+                             std::vector<BaseFloat> *values) {
+  SplitStringToVector(list, ",", true, names);
+  if (names->empty())
+    KALDI_ERR << "Empty list for --" << name;
+  values->resize(names->size());
+  for (size_t i = 0; i < names->size(); i++) {
+    if (!ConvertStringToReal((*names)[i], &(*values)[i]))
+      KALDI_ERR << "Invalid value " << (*names)[i] << " in --" << name;
+  }
+}
+
+LatticePostprocessor::LatticePostprocessor(
+    const LatticePostprocessOptions &opts,
+    const TransitionModel *trans_model,
+    const WordBoundaryInfo *word_boundary,
+    const WordAlignLatticeLexiconInfo *lexicon):
+    opts_(opts), trans_model_(trans_model), word_boundary_(word_boundary),
+    lexicon_(lexicon) {
+  std::vector<std::string> ops;
+  SplitStringToVector(opts_.ops, ",", true, &ops);
+  if (ops.empty())
+    KALDI_ERR << "No lattice operations given (--ops)";
+  bool one_best = false, aligned = false;
+  for (size_t i = 0; i < ops.size(); i++) {
+    LatticePostprocessOp op = kLatOpScale;
+    if (ops[i] == "scale") op = kLatOpScale;
+    else if (ops[i] == "penalty") op = kLatOpPenalty;
+    else if (ops[i] == "prune") op = kLatOpPrune;
+    else if (ops[i] == "mbr") op = kLatOpMbr;
+    else if (ops[i] == "1best") op = kLatOpOneBest;
+    else if (ops[i] == "align-words") op = kLatOpAlignWords;
+    else if (ops[i] == "prons") op = kLatOpProns;
+    else KALDI_ERR << "Unknown lattice operation " << ops[i] << " in --ops="
+                   << opts_.ops;
+
+    if ((op == kLatOpMbr || op == kLatOpProns) && i + 1 != ops.size())
+      KALDI_ERR << "The lattice operation " << ops[i]
+                << " must be the last one (--ops=" << opts_.ops << ")";
+    if (op == kLatOpOneBest) one_best = true;
+    if (op == kLatOpAlignWords) {
+      if (trans_model_ == NULL || (word_boundary_ == NULL && lexicon_ == NULL))
+        KALDI_ERR << "align-words needs the model and the word boundary or "
+                  << "alignment lexicon";
+      aligned = true;
+    }
+    // nbest-to-prons needs a linear lattice aligned with the word boundaries.
+    if (op == kLatOpProns && (!one_best || !aligned || trans_model_ == NULL))
+      KALDI_ERR << "prons needs the model and must follow 1best and "
+                << "align-words (--ops=" << opts_.ops << ")";
+    ops_.push_back(op);
+  }
+
+  // an operation which is not in the chain has one setting without a name.
+  if (HasOp(kLatOpScale)) {
+    ParseSettingList(opts_.inv_acoustic_scales, "inv-acoustic-scales",
+                     &scale_names_, &scales_);
+    for (size_t i = 0; i < scales_.size(); i++)
+      if (scales_[i] <= 0.0)
+        KALDI_ERR << "Invalid LM weight " << scale_names_[i]
+                  << " (must be > 0)";
+  } else {
+    scale_names_.push_back("");
+    scales_.push_back(1.0);
+  }
+  if (HasOp(kLatOpPenalty)) {
+    ParseSettingList(opts_.word_ins_penalties, "word-ins-penalties",
+                     &penalty_names_, &penalties_);
+  } else {
+    penalty_names_.push_back("");
+    penalties_.push_back(0.0);
+  }
+
+  lexicon_opts_.partial_word_label =
+      opts_.word_boundary_opts.partial_word_label;
+  lexicon_opts_.reorder = opts_.word_boundary_opts.reorder;
+  lexicon_opts_.max_expand = (opts_.max_expand > 0.0 ? opts_.max_expand :
+                              -1.0);
+}
+
+bool LatticePostprocessor::HasOp(LatticePostprocessOp op) const {
+  return std::find(ops_.begin(), ops_.end(), op) != ops_.end();
+}
+
+std::string LatticePostprocessor::SettingName(const std::string &pattern,
+                                              int32 setting) const {
+  std::string name(pattern);
+  const std::string keys[2] = { "{LMWT}", "{WIP}" };
+  const std::string *values[2] = { &ScaleName(setting),
+                                   &PenaltyName(setting) };
+  for (int32 k = 0; k < 2; k++) {
+    size_t pos;
+    while ((pos = name.find(keys[k])) != std::string::npos)
+      name.replace(pos, keys[k].size(), *values[k]);
+  }
+  return name;
+}
+
+bool LatticePostprocessor::SettingsDistinct(const std::string &pattern) const {
+  return (scale_names_.size() < 2 ||
+          pattern.find("{LMWT}") != std::string::npos) &&
+      (penalty_names_.size() < 2 ||
+       pattern.find("{WIP}") != std::string::npos);
+}
+
+void LatticePostprocessor::Process(
+    const std::string &utt, const CompactLattice &clat,
+    std::vector<LatticePostprocessResult> *results) const {
+  results->clear();
+  results->resize(NumSettings());
+  for (int32 s = 0; s < NumSettings(); s++)
+    ProcessSetting(utt, clat, scales_[s / penalties_.size()],
+                   penalties_[s % penalties_.size()], &(*results)[s]);
+}
+
+bool LatticePostprocessor::AlignWords(const std::string &utt,
+                                      const CompactLattice &clat,
+                                      CompactLattice *aligned_clat) const {
+  bool ok;
+  if (word_boundary_ != NULL) {
+    int32 max_states = (opts_.max_expand > 0.0 ?
+                        1000 + opts_.max_expand * clat.NumStates() : 0);
+    ok = WordAlignLattice(clat, *trans_model_, *word_boundary_, max_states,
+                          aligned_clat);
+  } else {
+    ok = WordAlignLatticeLexicon(clat, *trans_model_, *lexicon_,
+                                 lexicon_opts_, aligned_clat);
+  }
+  // as lattice-align-words with --output-error-lats=true, a partial lattice
+  // is used.
+  if (aligned_clat->Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty aligned lattice for " << utt;
+    return false;
+  }
+  if (!ok)
+    KALDI_WARN << "Lattice for " << utt << " did not align correctly, using "
+               << "the partial lattice";
+  TopSortCompactLatticeIfNeeded(aligned_clat);
+  return true;
+}
+
+void LatticePostprocessor::ProcessSetting(
+    const std::string &utt, const CompactLattice &clat_in, BaseFloat lmwt,
+    BaseFloat penalty, LatticePostprocessResult *result) const {
+  CompactLattice clat(clat_in);
+  for (size_t i = 0; i < ops_.size(); i++) {
+    switch (ops_[i]) {
+      case kLatOpScale:
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / lmwt), &clat);
+        break;
+      case kLatOpPenalty:
+        AddWordInsPenToCompactLattice(penalty, &clat);
+        break;
+      case kLatOpPrune:
+        if (!PruneLattice(opts_.beam, &clat))
+          KALDI_WARN << "Error pruning lattice for utterance " << utt;
+        break;
+      case kLatOpMbr: {
+        MinimumBayesRisk mbr(clat);
+        result->words = mbr.GetOneBest();
+        result->bayes_risk = mbr.GetBayesRisk();
+        result->ok = true;
+        return;
+      }
+      case kLatOpOneBest: {
+        CompactLattice best_path;
+        CompactLatticeShortestPath(clat, &best_path);
+        if (best_path.Start() == fst::kNoStateId) {
+          KALDI_WARN << "Best-path failed for key " << utt;
+          return;
+        }
+        clat = best_path;
+        break;
+      }
+      case kLatOpAlignWords: {
+        CompactLattice aligned_clat;
+        if (!AlignWords(utt, clat, &aligned_clat))
+          return;
+        clat = aligned_clat;
+        break;
+      }
+      case kLatOpProns: {
+        std::vector<std::vector<int32> > phone_lengths;
+        if (!CompactLatticeToWordProns(*trans_model_, clat,
+                                       &result->pron_words,
+                                       &result->pron_times,
+                                       &result->pron_lengths, &result->prons,
+                                       &phone_lengths)) {
+          KALDI_WARN << "Format conversion failed for utterance " << utt;
+          return;
+        }
+        break;
+      }
+    }
+  }
+
+  // the word sequence of the best path of the final lattice
+  // (lattice-best-path).
+  CompactLattice clat_best_path;
+  CompactLatticeShortestPath(clat, &clat_best_path);
+  Lattice best_path;
+  ConvertLattice(clat_best_path, &best_path);
+  if (best_path.Start() == fst::kNoStateId) {
+    KALDI_WARN << "Best-path failed for key " << utt;
+    return;
+  }
+  std::vector<int32> alignment;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, &alignment, &result->words, &weight);
+  result->ok = true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,172 @@
+// lat/lattice-postprocessor.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Based on: lattice-scale.cc, lattice-add-penalty.cc, lattice-prune.cc,
+// lattice-mbr-decode.cc, lattice-1best.cc, lattice-best-path.cc,
+// lattice-align-words.cc, lattice-align-words-lexicon.cc, nbest-to-prons.cc
+
+#ifndef KALDI_LAT_LATTICE_POSTPROCESSOR_H_
+#define KALDI_LAT_LATTICE_POSTPROCESSOR_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/word-align-lattice.h"
+#include "lat/word-align-lattice-lexicon.h"
+
+namespace kaldi {
+
+enum LatticePostprocessOp {
+  kLatOpScale,       // acoustic scale 1/LMWT (lattice-scale
+                     // --inv-acoustic-scale)
+  kLatOpPenalty,     // word insertion penalty (lattice-add-penalty)
+  kLatOpPrune,       // prune with --beam (lattice-prune)
+  kLatOpMbr,         // MBR decoding from the sausages (lattice-mbr-decode),
+                     // must be the last operation
+  kLatOpOneBest,     // keep only the best path (lattice-1best)
+  kLatOpAlignWords,  // align the arcs with the word boundaries
+                     // (lattice-align-words[-lexicon])
+  kLatOpProns        // word pronunciations of the aligned best path
+                     // (nbest-to-prons), must be the last operation
+};
+
+struct LatticePostprocessOptions {
+  std::string ops;  // comma separated list of operations, e.g.
+                    // scale,penalty,prune,mbr
+  std::string inv_acoustic_scales;  // comma separated LM weights for 'scale'
+  std::string word_ins_penalties;  // comma separated penalties for 'penalty'
+  BaseFloat beam;  // for 'prune'
+  BaseFloat max_expand;  // for 'align-words', if > 0 limits the expansion of
+                         // the lattice
+  WordBoundaryInfoNewOpts word_boundary_opts;  // for 'align-words'
+
+  LatticePostprocessOptions(): ops("scale,penalty,1best"),
+                               inv_acoustic_scales("10"),
+                               word_ins_penalties("0.0"),
+                               beam(6.0), max_expand(0.0) {}
+
+  void Register(OptionsItf *opts) {
+    opts->Register("ops", &ops, "Comma separated chain of operations: scale, "
+                   "penalty, prune, mbr, 1best, align-words, prons (mbr and "
+                   "prons must be the last)");
+    opts->Register("inv-acoustic-scales", &inv_acoustic_scales, "Comma "
+                   "separated list of LM weights, the lattices are scaled "
+                   "with the acoustic scale 1/LMWT by 'scale'");
+    opts->Register("word-ins-penalties", &word_ins_penalties, "Comma "
+                   "separated list of word insertion penalties for 'penalty'");
+    opts->Register("beam", &beam, "Pruning beam for 'prune' [applied after "
+                   "the scaling]");
+    opts->Register("max-expand", &max_expand, "If > 0, the maximum ratio by "
+                   "which 'align-words' may expand the lattice before "
+                   "refusing to continue");
+    word_boundary_opts.Register(opts);
+  }
+};
+
+/// The result of the chain for one utterance and one setting.
+struct LatticePostprocessResult {
+  bool ok;
+  std::vector<int32> words;
+  BaseFloat bayes_risk;  // only after 'mbr'
+  // only after 'prons': the output of nbest-to-prons per word.
+  std::vector<int32> pron_words, pron_times, pron_lengths;
+  std::vector<std::vector<int32> > prons;
+
+  LatticePostprocessResult(): ok(false), bayes_risk(0.0) {}
+};
+
+/// In memory lattice post-processing.
+///
+/// Replaces the archive pipelines of the scoring and of the pronunciation
+/// statistics:
+///   lattice-scale | lattice-add-penalty | [lattice-prune |
+///       lattice-mbr-decode] | lattice-best-path
+///   lattice-1best | lattice-align-words[-lexicon] | nbest-to-prons
+/// Each lattice is read once and the chain of operations (--ops) is run on a
+/// copy of it in memory for every setting, i.e. for every combination of the
+/// LM weights (--inv-acoustic-scales, used by 'scale') and of the word
+/// insertion penalties (--word-ins-penalties, used by 'penalty').  The result
+/// of a setting is the word sequence (the MBR hypothesis after 'mbr',
+/// otherwise the best path of the final lattice) and, after 'prons', the
+/// pronunciations of the words.  The utterances are independent; the caller
+/// may run them in parallel, all methods are const and thread safe.
+class LatticePostprocessor {
+ public:
+  /// "trans_model" is needed by 'align-words' and 'prons'.  'align-words' uses
+  /// the word boundary information (lattice-align-words) if "word_boundary" is
+  /// not NULL, otherwise the lexicon (lattice-align-words-lexicon).
+  LatticePostprocessor(const LatticePostprocessOptions &opts,
+                       const TransitionModel *trans_model,
+                       const WordBoundaryInfo *word_boundary,
+                       const WordAlignLatticeLexiconInfo *lexicon);
+
+  bool HasOp(LatticePostprocessOp op) const;
+
+  /// The settings are the combinations of the LM weights and of the word
+  /// insertion penalties.
+  int32 NumSettings() const {
+    return static_cast<int32>(scale_names_.size() * penalty_names_.size());
+  }
+  const std::string &ScaleName(int32 setting) const {
+    return scale_names_[setting / penalty_names_.size()];
+  }
+  const std::string &PenaltyName(int32 setting) const {
+    return penalty_names_[setting % penalty_names_.size()];
+  }
+
+  /// Replaces {LMWT} and {WIP} in "pattern" (a file name or specifier) with
+  /// the names of the setting as given in the options (e.g.
+  /// penalty_{WIP}/{LMWT}.tra -> penalty_0.5/10.tra).
+  std::string SettingName(const std::string &pattern, int32 setting) const;
+
+  /// True if SettingName() gives a different name for each setting, i.e.
+  /// "pattern" contains {LMWT} if there are several LM weights and {WIP} if
+  /// there are several word insertion penalties.
+  bool SettingsDistinct(const std::string &pattern) const;
+
+  /// Runs the chain on "clat" for all settings; "results" gets NumSettings()
+  /// elements.
+  void Process(const std::string &utt, const CompactLattice &clat,
+               std::vector<LatticePostprocessResult> *results) const;
+
+ private:
+  void ProcessSetting(const std::string &utt, const CompactLattice &clat,
+                      BaseFloat lmwt, BaseFloat penalty,
+                      LatticePostprocessResult *result) const;
+  bool AlignWords(const std::string &utt, const CompactLattice &clat,
+                  CompactLattice *aligned_clat) const;
+
+  LatticePostprocessOptions opts_;
+  const TransitionModel *trans_model_;
+  const WordBoundaryInfo *word_boundary_;
+  const WordAlignLatticeLexiconInfo *lexicon_;
+  WordAlignLatticeLexiconOpts lexicon_opts_;
+
+  std::vector<LatticePostprocessOp> ops_;
+  std::vector<std::string> scale_names_, penalty_names_;
+  std::vector<BaseFloat> scales_, penalties_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_LATTICE_POSTPROCESSOR_H_
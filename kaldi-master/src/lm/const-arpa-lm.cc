@@ -176,8 +176,12 @@ class LmState {
 // auxiliary class LmState above.
 class ConstArpaLmBuilder : public ArpaFileParser {
  public:
-  explicit ConstArpaLmBuilder(ArpaParseOptions options)
-      : ArpaFileParser(options, NULL) {
+  // If "symbols" is not NULL the words in the ARPA file are mapped to integers
+  // through the symbol table, otherwise the ARPA file must already be integer
+  // mapped (utils/map_arpa_lm.pl).
+  explicit ConstArpaLmBuilder(ArpaParseOptions options,
+                              fst::SymbolTable* symbols = NULL)
+      : ArpaFileParser(options, symbols) {
     ngram_order_ = 0;
     num_words_ = 0;
     overflow_buffer_size_ = 0;
@@ -1082,4 +1086,17 @@ bool BuildConstArpaLm(const ArpaParseOptions& options,
   return true;
 }
 
+bool BuildConstArpaLm(const ArpaParseOptions& options,
+                      const std::string& arpa_rxfilename,
+                      const std::string& const_arpa_wxfilename,
+                      fst::SymbolTable* symbols) {
+  KALDI_ASSERT(symbols != NULL);
+  ConstArpaLmBuilder lm_builder(options, symbols);
+  KALDI_LOG << "Reading " << arpa_rxfilename;
+  Input ki(arpa_rxfilename);
+  lm_builder.Read(ki.Stream());
+  WriteKaldiObject(lm_builder, const_arpa_wxfilename, true);
+  return true;
+}
+
 }  // namespace kaldi
@@ -423,6 +423,15 @@ bool BuildConstArpaLm(const ArpaParseOptions& options,
                       const std::string& arpa_rxfilename,
                       const std::string& const_arpa_wxfilename);
 
+// Same as above, but the words in the ARPA file are text and are mapped to
+// integers through "symbols" while reading, so there is no need to run
+// utils/map_arpa_lm.pl first. N-grams with words missing from "symbols" are
+// handled as specified by options.oov_handling.
+bool BuildConstArpaLm(const ArpaParseOptions& options,
+                      const std::string& arpa_rxfilename,
+                      const std::string& const_arpa_wxfilename,
+                      fst::SymbolTable* symbols);
+
 }  // namespace kaldi
 
 #endif  // KALDI_LM_CONST_ARPA_LM_H_
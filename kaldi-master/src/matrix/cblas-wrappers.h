@@ -26,6 +26,7 @@
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/matrix-functions.h"
+#include "matrix/matrix-backend.h"
 
 // Do not include this file directly.  It is to be included
 // by .cc files in this directory.
@@ -162,6 +163,11 @@ inline void cblas_Xgemv(MatrixTransposeType trans, MatrixIndexT num_rows,
                         MatrixIndexT num_cols, float alpha, const float *Mdata,
                         MatrixIndexT stride, const float *xdata,
                         MatrixIndexT incX, float beta, float *ydata, MatrixIndexT incY) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinGemv(trans, num_rows, num_cols, alpha, Mdata, stride, xdata, incX,
+                beta, ydata, incY);
+    return;
+  }
   cblas_sgemv(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(trans), num_rows,
               num_cols, alpha, Mdata, stride, xdata, incX, beta, ydata, incY);
 }
@@ -169,6 +175,11 @@ inline void cblas_Xgemv(MatrixTransposeType trans, MatrixIndexT num_rows,
                         MatrixIndexT num_cols, double alpha, const double *Mdata,
                         MatrixIndexT stride, const double *xdata,
                         MatrixIndexT incX, double beta, double *ydata, MatrixIndexT incY) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinGemv(trans, num_rows, num_cols, alpha, Mdata, stride, xdata, incX,
+                beta, ydata, incY);
+    return;
+  }
   cblas_dgemv(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(trans), num_rows,
               num_cols, alpha, Mdata, stride, xdata, incX, beta, ydata, incY);
 }
@@ -229,6 +240,12 @@ inline void cblas_Xgemm(const float alpha,
                         const float beta,
                         float *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinGemm(transA, transB, num_rows, num_cols,
+                transA == kNoTrans ? a_num_cols : a_num_rows, alpha, Adata,
+                a_stride, Bdata, b_stride, beta, Mdata, stride);
+    return;
+  }
   cblas_sgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
               num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
@@ -244,6 +261,12 @@ inline void cblas_Xgemm(const double alpha,
                         const double beta,
                         double *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinGemm(transA, transB, num_rows, num_cols,
+                transA == kNoTrans ? a_num_cols : a_num_rows, alpha, Adata,
+                a_stride, Bdata, b_stride, beta, Mdata, stride);
+    return;
+  }
   cblas_dgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
               num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
@@ -296,6 +319,11 @@ inline void cblas_Xsyrk (
     const MatrixIndexT other_dim_a, const float alpha, const float *A,
     const MatrixIndexT a_stride, const float beta, float *C,
     const MatrixIndexT c_stride) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinSyrk(trans, dim_c, other_dim_a, alpha, A, a_stride, beta, C,
+                c_stride);
+    return;
+  }
   cblas_ssyrk(CblasRowMajor, CblasLower, static_cast<CBLAS_TRANSPOSE>(trans),
               dim_c, other_dim_a, alpha, A, a_stride, beta, C, c_stride);
 }
@@ -305,6 +333,11 @@ inline void cblas_Xsyrk(
     const MatrixIndexT other_dim_a, const double alpha, const double *A,
     const MatrixIndexT a_stride, const double beta, double *C,
     const MatrixIndexT c_stride) {
+  if (UseBuiltinMatrixBackend()) {
+    BuiltinSyrk(trans, dim_c, other_dim_a, alpha, A, a_stride, beta, C,
+                c_stride);
+    return;
+  }
   cblas_dsyrk(CblasRowMajor, CblasLower, static_cast<CBLAS_TRANSPOSE>(trans),
               dim_c, other_dim_a, alpha, A, a_stride, beta, C, c_stride);
 }
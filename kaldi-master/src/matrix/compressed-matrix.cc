@@ -21,6 +21,12 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KALDI_COMPRESSED_MATRIX_SSE2
+#endif
 
 namespace kaldi {
 
@@ -500,6 +506,19 @@ inline float CompressedMatrix::CharToFloat(
 }
 
 
+// static
+void CompressedMatrix::CharToFloatTable(float p0, float p25, float p75,
+                                        float p100, float *table) {
+  // The same expressions as in CharToFloat(), one loop per range.
+  for (int32 value = 0; value <= 64; value++)
+    table[value] = p0 + (p25 - p0) * value * (1/64.0);
+  for (int32 value = 65; value <= 192; value++)
+    table[value] = p25 + (p75 - p25) * (value - 64) * (1/128.0);
+  for (int32 value = 193; value < 256; value++)
+    table[value] = p75 + (p100 - p75) * (value - 192) * (1/63.0);
+}
+
+
 template<typename Real>  // static
 void CompressedMatrix::CompressColumn(
     const GlobalHeader &global_header,
@@ -626,49 +645,167 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
     return;
   }
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-  int32 num_cols = h->num_cols, num_rows = h->num_rows;
-  KALDI_ASSERT(mat->NumRows() == num_rows);
-  KALDI_ASSERT(mat->NumCols() == num_cols);
+  KALDI_ASSERT(mat->NumRows() == h->num_rows);
+  KALDI_ASSERT(mat->NumCols() == h->num_cols);
+  DecompressToMat(*h, reinterpret_cast<const char*>(h + 1), mat);
+}
 
-  DataFormat format = static_cast<DataFormat>(h->format);
+// The kernels below compute out[j] = min_value + in[j] * increment for the
+// kTwoByte and kOneByte formats; the SSE2 versions give the same results as
+// the scalar code.  'in' need not be aligned.
+static inline void Uint16ToRealRow(const char *in, int32 n, float min_value,
+                                   float increment, float *out) {
+  int32 j = 0;
+#ifdef KALDI_COMPRESSED_MATRIX_SSE2
+  const __m128 min_v = _mm_set1_ps(min_value), inc_v = _mm_set1_ps(increment);
+  const __m128i zero = _mm_setzero_si128();
+  for (; j + 8 <= n; j += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * j));
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)),
+        hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+    _mm_storeu_ps(out + j, _mm_add_ps(min_v, _mm_mul_ps(lo, inc_v)));
+    _mm_storeu_ps(out + j + 4, _mm_add_ps(min_v, _mm_mul_ps(hi, inc_v)));
+  }
+#endif
+  for (; j < n; j++) {
+    uint16 value;
+    memcpy(&value, in + 2 * j, sizeof(value));
+    out[j] = min_value + value * increment;
+  }
+}
+
+static inline void Uint16ToRealRow(const char *in, int32 n, float min_value,
+                                   float increment, double *out) {
+  for (int32 j = 0; j < n; j++) {
+    uint16 value;
+    memcpy(&value, in + 2 * j, sizeof(value));
+    out[j] = min_value + value * increment;
+  }
+}
+
+static inline void Uint8ToRealRow(const uint8 *in, int32 n, float min_value,
+                                  float increment, float *out) {
+  int32 j = 0;
+#ifdef KALDI_COMPRESSED_MATRIX_SSE2
+  const __m128 min_v = _mm_set1_ps(min_value), inc_v = _mm_set1_ps(increment);
+  const __m128i zero = _mm_setzero_si128();
+  for (; j + 16 <= n; j += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + j));
+    __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+    __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)),
+        f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+        f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)),
+        f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+    _mm_storeu_ps(out + j, _mm_add_ps(min_v, _mm_mul_ps(f0, inc_v)));
+    _mm_storeu_ps(out + j + 4, _mm_add_ps(min_v, _mm_mul_ps(f1, inc_v)));
+    _mm_storeu_ps(out + j + 8, _mm_add_ps(min_v, _mm_mul_ps(f2, inc_v)));
+    _mm_storeu_ps(out + j + 12, _mm_add_ps(min_v, _mm_mul_ps(f3, inc_v)));
+  }
+#endif
+  for (; j < n; j++)
+    out[j] = min_value + in[j] * increment;
+}
+
+static inline void Uint8ToRealRow(const uint8 *in, int32 n, float min_value,
+                                  float increment, double *out) {
+  for (int32 j = 0; j < n; j++)
+    out[j] = min_value + in[j] * increment;
+}
+
+template<typename Real>  // static
+void CompressedMatrix::DecompressToMat(const GlobalHeader &h,
+                                       const char *data,
+                                       MatrixBase<Real> *mat) {
+  int32 num_cols = h.num_cols, num_rows = h.num_rows;
+  DataFormat format = static_cast<DataFormat>(h.format);
   if (format == kOneByteWithColHeaders) {
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    uint8 *byte_data = reinterpret_cast<uint8*>(per_col_header +
-                                                h->num_cols);
-    for (int32 i = 0; i < num_cols; i++, per_col_header++) {
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < num_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*mat)(j, i) = f;
+    const uint8 *byte_data = reinterpret_cast<const uint8*>(data) +
+        num_cols * sizeof(PerColHeader);
+    // Each column has its own piecewise linear mapping of the bytes; we
+    // tabulate it so that the decompression is a table lookup without the
+    // branches of CharToFloat().  For a few rows this is not worth it.
+    float table[256];
+    Real *mat_data = mat->Data();
+    MatrixIndexT stride = mat->Stride();
+    for (int32 i = 0; i < num_cols; i++) {
+      PerColHeader per_col_header;
+      memcpy(&per_col_header, data + i * sizeof(PerColHeader),
+             sizeof(PerColHeader));
+      float p0 = Uint16ToFloat(h, per_col_header.percentile_0),
+          p25 = Uint16ToFloat(h, per_col_header.percentile_25),
+          p75 = Uint16ToFloat(h, per_col_header.percentile_75),
+          p100 = Uint16ToFloat(h, per_col_header.percentile_100);
+      Real *out = mat_data + i;
+      if (num_rows < 64) {
+        for (int32 j = 0; j < num_rows; j++, byte_data++, out += stride)
+          *out = CharToFloat(p0, p25, p75, p100, *byte_data);
+      } else {
+        CharToFloatTable(p0, p25, p75, p100, table);
+        for (int32 j = 0; j < num_rows; j++, byte_data++, out += stride)
+          *out = table[*byte_data];
       }
     }
   } else if (format == kTwoByte) {
-    const uint16 *data = reinterpret_cast<const uint16*>(h + 1);
-    float min_value = h->min_value,
-        increment = h->range * (1.0 / 65535.0);
+    float min_value = h.min_value,
+        increment = h.range * (1.0 / 65535.0);
     for (int32 i = 0; i < num_rows; i++) {
-      Real *row_data = mat->RowData(i);
-      for (int32 j = 0; j < num_cols; j++)
-        row_data[j] = min_value + data[j] * increment;
-      data += num_cols;
+      Uint16ToRealRow(data, num_cols, min_value, increment, mat->RowData(i));
+      data += 2 * num_cols;
     }
   } else {
     KALDI_ASSERT(format == kOneByte);
-    float min_value = h->min_value, increment = h->range * (1.0 / 255.0);
-
-    const uint8 *data = reinterpret_cast<const uint8*>(h + 1);
+    float min_value = h.min_value, increment = h.range * (1.0 / 255.0);
+    const uint8 *byte_data = reinterpret_cast<const uint8*>(data);
     for (int32 i = 0; i < num_rows; i++) {
-      Real *row_data = mat->RowData(i);
-      for (int32 j = 0; j < num_cols; j++)
-        row_data[j] = min_value + data[j] * increment;
-      data += num_cols;
+      Uint8ToRealRow(byte_data, num_cols, min_value, increment,
+                     mat->RowData(i));
+      byte_data += num_cols;
     }
   }
 }
 
+template<typename Real>  // static
+size_t CompressedMatrix::CopyToMatFromMemory(const char *data, size_t size,
+                                             Matrix<Real> *mat) {
+  // The token ("CM ", "CM2 " or "CM3 ") and the GlobalHeader without the
+  // format, as written by Write().
+  GlobalHeader h;
+  size_t pos;
+  if (size >= 3 && memcmp(data, "CM ", 3) == 0) {
+    h.format = kOneByteWithColHeaders;
+    pos = 3;
+  } else if (size >= 4 && memcmp(data, "CM2 ", 4) == 0) {
+    h.format = kTwoByte;
+    pos = 4;
+  } else if (size >= 4 && memcmp(data, "CM3 ", 4) == 0) {
+    h.format = kOneByte;
+    pos = 4;
+  } else {
+    return 0;
+  }
+  if (size < pos + sizeof(h) - 4) return 0;
+  memcpy(reinterpret_cast<char*>(&h) + 4, data + pos, sizeof(h) - 4);
+  pos += sizeof(h) - 4;
+  if (h.num_rows < 0 || h.num_cols < 0) return 0;
+  if (h.num_cols == 0) {  // empty matrix.
+    mat->Resize(0, 0);
+    return pos;
+  }
+  size_t data_size = DataSize(h) - sizeof(GlobalHeader);
+  if (size < pos + data_size) return 0;
+  if (mat->NumRows() != h.num_rows || mat->NumCols() != h.num_cols)
+    mat->Resize(h.num_rows, h.num_cols, kUndefined);
+  DecompressToMat(h, data + pos, mat);
+  return pos + data_size;
+}
+
+template
+size_t CompressedMatrix::CopyToMatFromMemory(const char *data, size_t size,
+                                             Matrix<float> *mat);
+template
+size_t CompressedMatrix::CopyToMatFromMemory(const char *data, size_t size,
+                                             Matrix<double> *mat);
+
 // Instantiate the template for float and double.
 template
 void CompressedMatrix::CopyToMat(MatrixBase<float> *mat,
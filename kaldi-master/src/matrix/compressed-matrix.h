@@ -142,6 +142,15 @@ class CompressedMatrix {
 
   void Read(std::istream &is, bool binary);
 
+  /// Decompresses a matrix in the binary format of Write() (i.e. starting with
+  /// the token "CM", "CM2" or "CM3") directly from memory, e.g. from a memory
+  /// mapped archive, without copying it into a CompressedMatrix.  *mat is
+  /// resized only if its size differs.  Returns the number of bytes used, or 0
+  /// if the data is not a compressed matrix or is truncated.
+  template<typename Real>
+  static size_t CopyToMatFromMemory(const char *data, size_t size,
+                                    Matrix<Real> *mat);
+
   /// Returns number of rows (or zero for emtpy matrix).
   inline MatrixIndexT NumRows() const { return (data_ == NULL) ? 0 :
       (*reinterpret_cast<GlobalHeader*>(data_)).num_rows; }
@@ -258,6 +267,12 @@ class CompressedMatrix {
   static inline float Uint16ToFloat(const GlobalHeader &global_header,
                                     uint16 value);
 
+  // Decompresses the data following the GlobalHeader 'h' (which need not be
+  // aligned) into 'mat', which must have the right size.
+  template<typename Real>
+  static void DecompressToMat(const GlobalHeader &h, const char *data,
+                              MatrixBase<Real> *mat);
+
   // this is used only in the kOneByteWithColHeaders compression format.
   static inline uint8 FloatToChar(float p0, float p25,
                                           float p75, float p100,
@@ -268,6 +283,10 @@ class CompressedMatrix {
                                   float p75, float p100,
                                   uint8 value);
 
+  // Sets table[v] = CharToFloat(p0, p25, p75, p100, v) for v = 0..255.
+  static void CharToFloatTable(float p0, float p25, float p75, float p100,
+                               float *table);
+
   void *data_; // first GlobalHeader, then PerColHeader (repeated), then
   // the byte data for each column (repeated).  Note: don't intersperse
   // the byte data with the PerColHeaders, because of alignment issues.
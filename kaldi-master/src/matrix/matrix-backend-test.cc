@@ -0,0 +1,160 @@
+// matrix/matrix-backend-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+// Sizes around the block sizes of the built-in kernels.
+static MatrixIndexT RandBackendDim() {
+  switch (Rand() % 4) {
+    case 0: return 1 + Rand() % 10;
+    case 1: return 90 + Rand() % 20;
+    case 2: return 250 + Rand() % 20;
+    default: return 1 + Rand() % 300;
+  }
+}
+
+// The matrices are sub-matrices of larger ones so that stride != num-cols.
+template<typename Real>
+static void UnitTestBackendAddMatMat() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT m = RandBackendDim(), n = RandBackendDim(),
+        k = RandBackendDim();
+    MatrixTransposeType trans_a = (Rand() % 2 ? kTrans : kNoTrans),
+        trans_b = (Rand() % 2 ? kTrans : kNoTrans);
+    Matrix<Real> A_big(trans_a == kNoTrans ? m : k,
+                       (trans_a == kNoTrans ? k : m) + 3),
+        B_big(trans_b == kNoTrans ? k : n, (trans_b == kNoTrans ? n : k) + 5);
+    A_big.SetRandn();
+    B_big.SetRandn();
+    SubMatrix<Real> A(A_big, 0, A_big.NumRows(), 1, A_big.NumCols() - 3),
+        B(B_big, 0, B_big.NumRows(), 2, B_big.NumCols() - 5);
+    Matrix<Real> C_big(m, n + 7);
+    C_big.SetRandn();
+    SubMatrix<Real> C(C_big, 0, m, 0, n);
+    Real alpha = RandGauss(), beta = (Rand() % 3 == 0 ? 0.0 : RandGauss());
+
+    Matrix<Real> C_blas(C), C_builtin(C);
+    if (beta == 0.0)  // must not be read.
+      C.Set(std::numeric_limits<Real>::quiet_NaN());
+    SetMatrixBackend(kMatrixBackendBlas);
+    C_blas.AddMatMat(alpha, A, trans_a, B, trans_b, beta);
+    SetMatrixBackend(kMatrixBackendBuiltin);
+    C.AddMatMat(alpha, A, trans_a, B, trans_b, beta);
+    C_builtin.CopyFromMat(C);
+    SetMatrixBackend(kMatrixBackendBlas);
+    AssertEqual(C_blas, C_builtin, 1.0e-04);
+  }
+}
+
+template<typename Real>
+static void UnitTestBackendSymAddMat2() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT n = RandBackendDim(), k = RandBackendDim();
+    MatrixTransposeType trans = (Rand() % 2 ? kTrans : kNoTrans);
+    Matrix<Real> A(trans == kNoTrans ? n : k, trans == kNoTrans ? k : n);
+    A.SetRandn();
+    Real alpha = RandGauss(), beta = (Rand() % 3 == 0 ? 0.0 : RandGauss());
+    SpMatrix<Real> S(n);
+    S.SetRandn();
+    SpMatrix<Real> S_blas(S), S_builtin(S);
+    Matrix<Real> C(n, n);
+    C.SetRandn();
+    Matrix<Real> C_blas(C), C_builtin(C);
+
+    SetMatrixBackend(kMatrixBackendBlas);
+    S_blas.AddMat2(alpha, A, trans, beta);
+    C_blas.SymAddMat2(alpha, A, trans, beta);
+    SetMatrixBackend(kMatrixBackendBuiltin);
+    S_builtin.AddMat2(alpha, A, trans, beta);
+    C_builtin.SymAddMat2(alpha, A, trans, beta);
+    SetMatrixBackend(kMatrixBackendBlas);
+    AssertEqual(S_blas, S_builtin, static_cast<Real>(1.0e-04));
+    AssertEqual(C_blas, C_builtin, 1.0e-04);
+  }
+}
+
+template<typename Real>
+static void UnitTestBackendAddMatVec() {
+  for (int32 i = 0; i < 40; i++) {
+    MatrixIndexT m = RandBackendDim(), n = RandBackendDim();
+    MatrixTransposeType trans = (Rand() % 2 ? kTrans : kNoTrans);
+    Matrix<Real> M_big(m, n + 3);
+    M_big.SetRandn();
+    SubMatrix<Real> M(M_big, 0, m, 0, n);
+    Vector<Real> x(trans == kNoTrans ? n : m),
+        y(trans == kNoTrans ? m : n);
+    x.SetRandn();
+    y.SetRandn();
+    Real alpha = RandGauss(), beta = (Rand() % 3 == 0 ? 0.0 : RandGauss());
+
+    Vector<Real> y_blas(y), y_builtin(y);
+    SetMatrixBackend(kMatrixBackendBlas);
+    y_blas.AddMatVec(alpha, M, trans, x, beta);
+    SetMatrixBackend(kMatrixBackendBuiltin);
+    if (beta == 0.0)
+      y_builtin.Set(std::numeric_limits<Real>::quiet_NaN());
+    y_builtin.AddMatVec(alpha, M, trans, x, beta);
+    SetMatrixBackend(kMatrixBackendBlas);
+    AssertEqual(y_blas, y_builtin, 1.0e-04);
+
+    // strided x and y (a column of a matrix).
+    Matrix<Real> X(x.Dim(), 2), Y(y.Dim(), 3);
+    X.CopyColFromVec(x, 1);
+    Y.CopyColFromVec(y, 2);
+    Real *y_data = Y.Data() + 2;
+    BuiltinGemv(trans, m, n, alpha, M.Data(), M.Stride(), X.Data() + 1,
+                X.Stride(), beta, y_data, Y.Stride());
+    Vector<Real> y_strided(y.Dim());
+    y_strided.CopyColFromMat(Y, 2);
+    AssertEqual(y_blas, y_strided, 1.0e-04);
+  }
+}
+
+template<typename Real>
+static void UnitTestBackendNames() {
+  MatrixBackendType type;
+  KALDI_ASSERT(GetMatrixBackendType("builtin", &type) &&
+               type == kMatrixBackendBuiltin);
+  KALDI_ASSERT(GetMatrixBackendType("blas", &type) &&
+               type == kMatrixBackendBlas);
+  KALDI_ASSERT(GetMatrixBackendType(MatrixBackendName(kMatrixBackendBlas),
+                                    &type) && type == kMatrixBackendBlas);
+  KALDI_ASSERT(!GetMatrixBackendType("foo", &type));
+}
+
+template<typename Real>
+static void MatrixBackendUnitTest() {
+  UnitTestBackendNames<Real>();
+  UnitTestBackendAddMatMat<Real>();
+  UnitTestBackendSymAddMat2<Real>();
+  UnitTestBackendAddMatVec<Real>();
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::MatrixBackendUnitTest<float>();
+  kaldi::MatrixBackendUnitTest<double>();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
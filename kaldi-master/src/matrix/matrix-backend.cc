@@ -0,0 +1,406 @@
+// matrix/matrix-backend.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-backend.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KALDI_MATRIX_BACKEND_SSE2
+#endif
+
+namespace kaldi {
+
+namespace internal {
+MatrixBackendType g_matrix_backend = kMatrixBackendBlas;
+}
+
+void SetMatrixBackend(MatrixBackendType type) {
+  internal::g_matrix_backend = type;
+}
+
+MatrixBackendType GetMatrixBackend() {
+  return internal::g_matrix_backend;
+}
+
+std::string MatrixBackendName(MatrixBackendType type) {
+  if (type == kMatrixBackendBuiltin) return "builtin";
+#if defined(HAVE_MKL)
+  return "mkl";
+#elif defined(HAVE_OPENBLAS)
+  return "openblas";
+#elif defined(HAVE_ATLAS)
+  return "atlas";
+#else
+  return "clapack";
+#endif
+}
+
+bool GetMatrixBackendType(const std::string &name, MatrixBackendType *type) {
+  if (name == "blas" || name == MatrixBackendName(kMatrixBackendBlas)) {
+    *type = kMatrixBackendBlas;
+  } else if (name == "builtin") {
+    *type = kMatrixBackendBuiltin;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+// A vector of SIMD width: the kernels below are written once for float and
+// double in terms of these operations.
+template<typename Real> struct SimdOps;
+
+#ifdef KALDI_MATRIX_BACKEND_SSE2
+template<> struct SimdOps<float> {
+  typedef __m128 V;
+  static const int kWidth = 4;
+  static V Zero() { return _mm_setzero_ps(); }
+  static V Set1(float a) { return _mm_set1_ps(a); }
+  static V Load(const float *p) { return _mm_loadu_ps(p); }
+  static void Store(float *p, V v) { _mm_storeu_ps(p, v); }
+  static V Add(V a, V b) { return _mm_add_ps(a, b); }
+  static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static float Sum(V v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+  }
+};
+template<> struct SimdOps<double> {
+  typedef __m128d V;
+  static const int kWidth = 2;
+  static V Zero() { return _mm_setzero_pd(); }
+  static V Set1(double a) { return _mm_set1_pd(a); }
+  static V Load(const double *p) { return _mm_loadu_pd(p); }
+  static void Store(double *p, V v) { _mm_storeu_pd(p, v); }
+  static V Add(V a, V b) { return _mm_add_pd(a, b); }
+  static V Mul(V a, V b) { return _mm_mul_pd(a, b); }
+  static double Sum(V v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+  }
+};
+#else
+template<typename Real> struct SimdOps {
+  typedef Real V;
+  static const int kWidth = 1;
+  static V Zero() { return 0; }
+  static V Set1(Real a) { return a; }
+  static V Load(const Real *p) { return *p; }
+  static void Store(Real *p, V v) { *p = v; }
+  static V Add(V a, V b) { return a + b; }
+  static V Mul(V a, V b) { return a * b; }
+  static Real Sum(V v) { return v; }
+};
+#endif
+
+// The register tile of the GEMM micro-kernel is kMr x kNr (kNr = two SIMD
+// vectors); the packed blocks of op(A) (kMc x kKc) and op(B) (kKc x kNc) are
+// sized for the L2 and L3 caches.
+const MatrixIndexT kMr = 4;
+const MatrixIndexT kKc = 256;
+const MatrixIndexT kMc = 96;
+const MatrixIndexT kNc = 2048;
+
+template<typename Real> struct GemmKernel {
+  typedef SimdOps<Real> S;
+  typedef typename S::V V;
+  static const MatrixIndexT kNr = 2 * S::kWidth;
+
+  // tile[kMr][kNr] = sum_p a[p][0..kMr) * b[p][0..kNr), where a and b are
+  // the packed panels.
+  static void MicroKernel(MatrixIndexT kc, const Real *a, const Real *b,
+                          Real *tile) {
+    V c00 = S::Zero(), c01 = S::Zero(), c10 = S::Zero(), c11 = S::Zero(),
+      c20 = S::Zero(), c21 = S::Zero(), c30 = S::Zero(), c31 = S::Zero();
+    for (MatrixIndexT p = 0; p < kc; p++, a += kMr, b += kNr) {
+      V b0 = S::Load(b), b1 = S::Load(b + S::kWidth);
+      V a0 = S::Set1(a[0]), a1 = S::Set1(a[1]),
+        a2 = S::Set1(a[2]), a3 = S::Set1(a[3]);
+      c00 = S::Add(c00, S::Mul(a0, b0)); c01 = S::Add(c01, S::Mul(a0, b1));
+      c10 = S::Add(c10, S::Mul(a1, b0)); c11 = S::Add(c11, S::Mul(a1, b1));
+      c20 = S::Add(c20, S::Mul(a2, b0)); c21 = S::Add(c21, S::Mul(a2, b1));
+      c30 = S::Add(c30, S::Mul(a3, b0)); c31 = S::Add(c31, S::Mul(a3, b1));
+    }
+    const MatrixIndexT w = S::kWidth;
+    S::Store(tile, c00); S::Store(tile + w, c01);
+    S::Store(tile + kNr, c10); S::Store(tile + kNr + w, c11);
+    S::Store(tile + 2 * kNr, c20); S::Store(tile + 2 * kNr + w, c21);
+    S::Store(tile + 3 * kNr, c30); S::Store(tile + 3 * kNr + w, c31);
+  }
+
+  // Packs rows [i0, i0 + mc) and columns [p0, p0 + kc) of alpha op(A) into
+  // panels of kMr rows, stored column by column; the last panel is padded
+  // with zeros.
+  static void PackA(MatrixTransposeType trans, const Real *A, MatrixIndexT lda,
+                    MatrixIndexT i0, MatrixIndexT mc, MatrixIndexT p0,
+                    MatrixIndexT kc, Real alpha, Real *packed) {
+    for (MatrixIndexT ir = 0; ir < mc; ir += kMr) {
+      MatrixIndexT mr = std::min(kMr, mc - ir);
+      for (MatrixIndexT p = 0; p < kc; p++, packed += kMr) {
+        for (MatrixIndexT i = 0; i < mr; i++) {
+          MatrixIndexT row = i0 + ir + i, col = p0 + p;
+          packed[i] = alpha * (trans == kNoTrans ? A[row * lda + col] :
+                                                   A[col * lda + row]);
+        }
+        for (MatrixIndexT i = mr; i < kMr; i++) packed[i] = 0;
+      }
+    }
+  }
+
+  // Packs rows [p0, p0 + kc) and columns [j0, j0 + nc) of op(B) into panels
+  // of kNr columns, stored row by row; the last panel is padded with zeros.
+  static void PackB(MatrixTransposeType trans, const Real *B, MatrixIndexT ldb,
+                    MatrixIndexT p0, MatrixIndexT kc, MatrixIndexT j0,
+                    MatrixIndexT nc, Real *packed) {
+    for (MatrixIndexT jr = 0; jr < nc; jr += kNr) {
+      MatrixIndexT nr = std::min(kNr, nc - jr);
+      for (MatrixIndexT p = 0; p < kc; p++, packed += kNr) {
+        MatrixIndexT row = p0 + p, col = j0 + jr;
+        if (trans == kNoTrans) {
+          const Real *src = B + row * ldb + col;
+          for (MatrixIndexT j = 0; j < nr; j++) packed[j] = src[j];
+        } else {
+          const Real *src = B + col * ldb + row;
+          for (MatrixIndexT j = 0; j < nr; j++) packed[j] = src[j * ldb];
+        }
+        for (MatrixIndexT j = nr; j < kNr; j++) packed[j] = 0;
+      }
+    }
+  }
+};
+
+// C = beta C; does not read C if beta == 0.
+template<typename Real>
+void ScaleMatrix(MatrixIndexT m, MatrixIndexT n, Real beta, Real *C,
+                 MatrixIndexT ldc) {
+  if (beta == 1.0) return;
+  for (MatrixIndexT i = 0; i < m; i++) {
+    Real *row = C + i * ldc;
+    if (beta == 0.0) std::fill(row, row + n, Real(0));
+    else for (MatrixIndexT j = 0; j < n; j++) row[j] *= beta;
+  }
+}
+
+// The work buffers of the calls of this thread: they only grow, so that the
+// small products which are called per frame do not allocate memory.  Each
+// use has its own buffer (BuiltinSyrk() keeps its diagonal block while it
+// calls BuiltinGemm()); the packing buffers are bounded by the block sizes.
+enum WorkBufferId {
+  kBufPackedA, kBufPackedB, kBufSyrkDiag, kBufGemvX, kBufGemvY, kNumWorkBuffers
+};
+
+template<typename Real>
+Real *GetWorkBuffer(WorkBufferId id, size_t size) {
+  static thread_local std::vector<Real> buffers[kNumWorkBuffers];
+  std::vector<Real> &buf = buffers[id];
+  if (buf.size() < size) buf.resize(size);
+  return buf.data();
+}
+
+}  // namespace
+
+template<typename Real>
+void BuiltinGemm(MatrixTransposeType trans_a, MatrixTransposeType trans_b,
+                 MatrixIndexT m, MatrixIndexT n, MatrixIndexT k, Real alpha,
+                 const Real *A, MatrixIndexT lda, const Real *B,
+                 MatrixIndexT ldb, Real beta, Real *C, MatrixIndexT ldc) {
+  typedef GemmKernel<Real> K;
+  const MatrixIndexT kNr = K::kNr;
+  if (m <= 0 || n <= 0) return;
+  ScaleMatrix(m, n, beta, C, ldc);
+  if (k <= 0 || alpha == 0.0) return;
+
+  MatrixIndexT nc_max = std::min(kNc, n), kc_max = std::min(kKc, k),
+      mc_max = std::min(kMc, m);
+  Real *packed_b = GetWorkBuffer<Real>(
+      kBufPackedB, ((nc_max + kNr - 1) / kNr) * kNr * kc_max),
+      *packed_a = GetWorkBuffer<Real>(
+          kBufPackedA, ((mc_max + kMr - 1) / kMr) * kMr * kc_max);
+  Real tile[kMr * kNr];
+
+  for (MatrixIndexT jc = 0; jc < n; jc += kNc) {
+    MatrixIndexT nc = std::min(kNc, n - jc);
+    for (MatrixIndexT pc = 0; pc < k; pc += kKc) {
+      MatrixIndexT kc = std::min(kKc, k - pc);
+      K::PackB(trans_b, B, ldb, pc, kc, jc, nc, packed_b);
+      for (MatrixIndexT ic = 0; ic < m; ic += kMc) {
+        MatrixIndexT mc = std::min(kMc, m - ic);
+        K::PackA(trans_a, A, lda, ic, mc, pc, kc, alpha, packed_a);
+        for (MatrixIndexT jr = 0; jr < nc; jr += kNr) {
+          MatrixIndexT nr = std::min(kNr, nc - jr);
+          const Real *b = packed_b + jr * kc;
+          for (MatrixIndexT ir = 0; ir < mc; ir += kMr) {
+            MatrixIndexT mr = std::min(kMr, mc - ir);
+            K::MicroKernel(kc, packed_a + ir * kc, b, tile);
+            Real *c = C + (ic + ir) * ldc + jc + jr;
+            for (MatrixIndexT i = 0; i < mr; i++)
+              for (MatrixIndexT j = 0; j < nr; j++)
+                c[i * ldc + j] += tile[i * kNr + j];
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename Real>
+void BuiltinSyrk(MatrixTransposeType trans, MatrixIndexT n, MatrixIndexT k,
+                 Real alpha, const Real *A, MatrixIndexT lda, Real beta,
+                 Real *C, MatrixIndexT ldc) {
+  // Blocks of kMc rows: the blocks below the diagonal are plain GEMMs, the
+  // diagonal blocks are computed in full and only their lower triangle is
+  // added.
+  const MatrixIndexT nb = kMc;
+  Real *diag = GetWorkBuffer<Real>(kBufSyrkDiag, nb * nb);
+  for (MatrixIndexT ib = 0; ib < n; ib += nb) {
+    MatrixIndexT mb = std::min(nb, n - ib);
+    // rows [ib, ib + mb) of op(A) and the matrix they start at.
+    const Real *a_i = (trans == kNoTrans ? A + ib * lda : A + ib);
+    for (MatrixIndexT jb = 0; jb < ib; jb += nb) {
+      const Real *a_j = (trans == kNoTrans ? A + jb * lda : A + jb);
+      BuiltinGemm(trans, trans == kNoTrans ? kTrans : kNoTrans, mb, nb, k,
+                  alpha, a_i, lda, a_j, lda, beta, C + ib * ldc + jb, ldc);
+    }
+    BuiltinGemm(trans, trans == kNoTrans ? kTrans : kNoTrans, mb, mb, k,
+                alpha, a_i, lda, a_i, lda, Real(0), diag, nb);
+    for (MatrixIndexT i = 0; i < mb; i++) {
+      Real *c = C + (ib + i) * ldc + ib;
+      const Real *d = diag + i * nb;
+      for (MatrixIndexT j = 0; j <= i; j++)
+        c[j] = (beta == 0.0 ? d[j] : beta * c[j] + d[j]);
+    }
+  }
+}
+
+template<typename Real>
+void BuiltinGemv(MatrixTransposeType trans, MatrixIndexT m, MatrixIndexT n,
+                 Real alpha, const Real *A, MatrixIndexT lda, const Real *x,
+                 MatrixIndexT incx, Real beta, Real *y, MatrixIndexT incy) {
+  typedef SimdOps<Real> S;
+  typedef typename S::V V;
+  const MatrixIndexT w = S::kWidth;
+  MatrixIndexT x_dim = (trans == kNoTrans ? n : m),
+      y_dim = (trans == kNoTrans ? m : n);
+  if (y_dim <= 0) return;
+  // contiguous copies of x and of the result.
+  if (incx != 1) {
+    Real *x_copy = GetWorkBuffer<Real>(kBufGemvX, x_dim);
+    for (MatrixIndexT i = 0; i < x_dim; i++) x_copy[i] = x[i * incx];
+    x = x_copy;
+  }
+  Real *t = GetWorkBuffer<Real>(kBufGemvY, y_dim);
+  std::fill(t, t + y_dim, Real(0));
+
+  if (trans == kNoTrans) {
+    // t_i = dot(row i, x), 4 rows at a time.
+    MatrixIndexT i = 0;
+    for (; i + 4 <= m; i += 4) {
+      const Real *r0 = A + i * lda, *r1 = r0 + lda, *r2 = r1 + lda,
+          *r3 = r2 + lda;
+      V s0 = S::Zero(), s1 = S::Zero(), s2 = S::Zero(), s3 = S::Zero();
+      MatrixIndexT j = 0;
+      for (; j + w <= n; j += w) {
+        V xv = S::Load(x + j);
+        s0 = S::Add(s0, S::Mul(S::Load(r0 + j), xv));
+        s1 = S::Add(s1, S::Mul(S::Load(r1 + j), xv));
+        s2 = S::Add(s2, S::Mul(S::Load(r2 + j), xv));
+        s3 = S::Add(s3, S::Mul(S::Load(r3 + j), xv));
+      }
+      Real d0 = S::Sum(s0), d1 = S::Sum(s1), d2 = S::Sum(s2), d3 = S::Sum(s3);
+      for (; j < n; j++) {
+        d0 += r0[j] * x[j]; d1 += r1[j] * x[j];
+        d2 += r2[j] * x[j]; d3 += r3[j] * x[j];
+      }
+      t[i] = d0; t[i + 1] = d1; t[i + 2] = d2; t[i + 3] = d3;
+    }
+    for (; i < m; i++) {
+      const Real *r = A + i * lda;
+      Real d = 0;
+      for (MatrixIndexT j = 0; j < n; j++) d += r[j] * x[j];
+      t[i] = d;
+    }
+  } else {
+    // t += x_i * row i, 4 rows at a time.
+    MatrixIndexT i = 0;
+    for (; i + 4 <= m; i += 4) {
+      const Real *r0 = A + i * lda, *r1 = r0 + lda, *r2 = r1 + lda,
+          *r3 = r2 + lda;
+      Real x0 = x[i], x1 = x[i + 1], x2 = x[i + 2], x3 = x[i + 3];
+      V xv0 = S::Set1(x0), xv1 = S::Set1(x1), xv2 = S::Set1(x2),
+          xv3 = S::Set1(x3);
+      MatrixIndexT j = 0;
+      for (; j + w <= n; j += w) {
+        V s = S::Add(S::Add(S::Mul(S::Load(r0 + j), xv0),
+                            S::Mul(S::Load(r1 + j), xv1)),
+                     S::Add(S::Mul(S::Load(r2 + j), xv2),
+                            S::Mul(S::Load(r3 + j), xv3)));
+        S::Store(t + j, S::Add(S::Load(t + j), s));
+      }
+      for (; j < n; j++)
+        t[j] += r0[j] * x0 + r1[j] * x1 + r2[j] * x2 + r3[j] * x3;
+    }
+    for (; i < m; i++) {
+      const Real *r = A + i * lda;
+      Real xi = x[i];
+      for (MatrixIndexT j = 0; j < n; j++) t[j] += r[j] * xi;
+    }
+  }
+
+  for (MatrixIndexT i = 0; i < y_dim; i++) {
+    Real &yi = y[i * incy];
+    yi = (beta == 0.0 ? alpha * t[i] : beta * yi + alpha * t[i]);
+  }
+}
+
+template
+void BuiltinGemm(MatrixTransposeType trans_a, MatrixTransposeType trans_b,
+                 MatrixIndexT m, MatrixIndexT n, MatrixIndexT k, float alpha,
+                 const float *A, MatrixIndexT lda, const float *B,
+                 MatrixIndexT ldb, float beta, float *C, MatrixIndexT ldc);
+template
+void BuiltinGemm(MatrixTransposeType trans_a, MatrixTransposeType trans_b,
+                 MatrixIndexT m, MatrixIndexT n, MatrixIndexT k, double alpha,
+                 const double *A, MatrixIndexT lda, const double *B,
+                 MatrixIndexT ldb, double beta, double *C, MatrixIndexT ldc);
+template
+void BuiltinSyrk(MatrixTransposeType trans, MatrixIndexT n, MatrixIndexT k,
+                 float alpha, const float *A, MatrixIndexT lda, float beta,
+                 float *C, MatrixIndexT ldc);
+template
+void BuiltinSyrk(MatrixTransposeType trans, MatrixIndexT n, MatrixIndexT k,
+                 double alpha, const double *A, MatrixIndexT lda, double beta,
+                 double *C, MatrixIndexT ldc);
+template
+void BuiltinGemv(MatrixTransposeType trans, MatrixIndexT m, MatrixIndexT n,
+                 float alpha, const float *A, MatrixIndexT lda, const float *x,
+                 MatrixIndexT incx, float beta, float *y, MatrixIndexT incy);
+template
+void BuiltinGemv(MatrixTransposeType trans, MatrixIndexT m, MatrixIndexT n,
+                 double alpha, const double *A, MatrixIndexT lda,
+                 const double *x, MatrixIndexT incx, double beta, double *y,
+                 MatrixIndexT incy);
+
+}  // namespace kaldi
@@ -0,0 +1,91 @@
+// matrix/matrix-backend.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_MATRIX_BACKEND_H_
+#define KALDI_MATRIX_MATRIX_BACKEND_H_
+
+#include <string>
+
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// The implementation of the matrix products GEMM (AddMatMat), SYRK
+/// (SymAddMat2, AddMat2) and GEMV (AddMatVec) used by the wrappers in
+/// cblas-wrappers.h.  The BLAS library itself (MKL, OpenBLAS, ATLAS or
+/// CLAPACK) is chosen when building (HAVE_MKL etc., kaldiwin_mkl.props or
+/// kaldiwin_openblas.props on Windows); the built-in backend is a portable
+/// cache-blocked SSE2 implementation which does not depend on the library,
+/// e.g. for comparing the speed of the library or when the library is a slow
+/// reference BLAS.  All the other routines (LAPACK, level 1 BLAS) always use
+/// the library.
+enum MatrixBackendType {
+  kMatrixBackendBlas = 0,    // the BLAS library linked in
+  kMatrixBackendBuiltin = 1  // BuiltinGemm(), BuiltinSyrk(), BuiltinGemv()
+};
+
+/// Selects the backend of the whole process.  Set it at start-up, before the
+/// threads doing matrix computations are started.
+void SetMatrixBackend(MatrixBackendType type);
+
+MatrixBackendType GetMatrixBackend();
+
+/// Converts "blas", "builtin" or the name of the linked library (see
+/// MatrixBackendName()) to the type; returns false for other strings,
+/// including the name of a library which is not linked in.
+bool GetMatrixBackendType(const std::string &name, MatrixBackendType *type);
+
+/// "mkl", "openblas", "atlas" or "clapack" for kMatrixBackendBlas (the linked
+/// library), "builtin" for kMatrixBackendBuiltin.
+std::string MatrixBackendName(MatrixBackendType type);
+
+namespace internal {
+extern MatrixBackendType g_matrix_backend;
+}
+
+inline bool UseBuiltinMatrixBackend() {
+  return internal::g_matrix_backend == kMatrixBackendBuiltin;
+}
+
+/// The built-in kernels.  The matrices are row-major and the arguments are as
+/// for the row-major CBLAS functions: C = alpha op(A) op(B) + beta C, where C
+/// is m x n and op(A) is m x k; if beta == 0 then C is not read.
+template<typename Real>
+void BuiltinGemm(MatrixTransposeType trans_a, MatrixTransposeType trans_b,
+                 MatrixIndexT m, MatrixIndexT n, MatrixIndexT k, Real alpha,
+                 const Real *A, MatrixIndexT lda, const Real *B,
+                 MatrixIndexT ldb, Real beta, Real *C, MatrixIndexT ldc);
+
+/// Lower triangle of C = alpha op(A) op(A)^T + beta C, where C is n x n and
+/// op(A) is n x k (op(A) = A if trans == kNoTrans, A^T otherwise).  The upper
+/// triangle of C is not referenced.
+template<typename Real>
+void BuiltinSyrk(MatrixTransposeType trans, MatrixIndexT n, MatrixIndexT k,
+                 Real alpha, const Real *A, MatrixIndexT lda, Real beta,
+                 Real *C, MatrixIndexT ldc);
+
+/// y = alpha op(A) x + beta y, where A is m x n.
+template<typename Real>
+void BuiltinGemv(MatrixTransposeType trans, MatrixIndexT m, MatrixIndexT n,
+                 Real alpha, const Real *A, MatrixIndexT lda, const Real *x,
+                 MatrixIndexT incx, Real beta, Real *y, MatrixIndexT incy);
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_MATRIX_BACKEND_H_
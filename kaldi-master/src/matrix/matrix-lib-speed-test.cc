@@ -254,6 +254,53 @@ static void UnitTestAddVecToColsSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+template<typename Real>
+static void UnitTestBackendSpeed() {
+  Timer t;
+  std::vector<MatrixIndexT> sizes;
+  sizes.push_back(40);
+  sizes.push_back(256);
+  sizes.push_back(1024);
+  MatrixBackendType backend = GetMatrixBackend();
+  for (int32 b = 0; b < 2; b++) {
+    MatrixBackendType type = (b == 0 ? kMatrixBackendBlas :
+                              kMatrixBackendBuiltin);
+    SetMatrixBackend(type);
+    std::string name = MatrixBackendName(type);
+    for (size_t i = 0; i < sizes.size(); i++) {
+      MatrixIndexT size = sizes[i];
+      Matrix<Real> A(size, size), B(size, size), C(size, size);
+      A.SetRandn();
+      B.SetRandn();
+      Vector<Real> x(size), y(size);
+      x.SetRandn();
+      BaseFloat time_in_secs = 0.1, fdim = size;
+
+      int32 iter = 0;
+      Timer t1;
+      for (; t1.Elapsed() < time_in_secs; iter++)
+        C.AddMatMat(1.0, A, kNoTrans, B, kTrans, 0.0);
+      BaseFloat gflops = (2.0 * fdim * fdim * fdim * iter) /
+          (t1.Elapsed() * 1.0e+09);
+      CsvResult<Real>("AddMatMat[" + name + "]", size, gflops, "gigaflops");
+
+      Timer t2;
+      for (iter = 0; t2.Elapsed() < time_in_secs; iter++)
+        C.SymAddMat2(1.0, A, kNoTrans, 0.0);
+      gflops = (fdim * fdim * fdim * iter) / (t2.Elapsed() * 1.0e+09);
+      CsvResult<Real>("SymAddMat2[" + name + "]", size, gflops, "gigaflops");
+
+      Timer t3;
+      for (iter = 0; t3.Elapsed() < time_in_secs; iter++)
+        y.AddMatVec(1.0, A, kNoTrans, x, 0.0);
+      gflops = (2.0 * fdim * fdim * iter) / (t3.Elapsed() * 1.0e+09);
+      CsvResult<Real>("AddMatVec[" + name + "]", size, gflops, "gigaflops");
+    }
+  }
+  SetMatrixBackend(backend);
+  CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
+}
+
 template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestRealFftSpeed<Real>();
   UnitTestSplitRadixRealFftSpeed<Real>();
@@ -263,6 +310,7 @@ template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestAddColSumMatSpeed<Real>();
   UnitTestAddVecToRowsSpeed<Real>();
   UnitTestAddVecToColsSpeed<Real>();
+  UnitTestBackendSpeed<Real>();
 }
 
 } // namespace kaldi
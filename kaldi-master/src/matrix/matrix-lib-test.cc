@@ -4036,6 +4036,38 @@ template<typename Real> static void UnitTestCompressedMatrix2() {
 }
 
 
+template<typename Real> static void UnitTestCompressedMatrixFromMemory() {
+  // Tests CopyToMatFromMemory() (and the decompression of CopyToMat(), which
+  // shares the code) against CopyRowToVec(), for all formats.
+  CompressionMethod methods[] = { kSpeechFeature, kTwoByteAuto, kOneByteAuto };
+  for (int32 i = 0; i < 30; i++) {
+    int32 num_rows = RandInt(1, 200), num_cols = RandInt(1, 40);
+    Matrix<Real> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressedMatrix cmat(mat, methods[i % 3]);
+    std::ostringstream os;
+    os << 'x';  // so that the data is not aligned.
+    cmat.Write(os, true);
+    std::string bytes = os.str();
+
+    Matrix<Real> mat2(1, 1);
+    size_t size = CompressedMatrix::CopyToMatFromMemory(bytes.data() + 1,
+                                                        bytes.size() - 1,
+                                                        &mat2);
+    KALDI_ASSERT(size == bytes.size() - 1);
+    KALDI_ASSERT(CompressedMatrix::CopyToMatFromMemory(bytes.data() + 1,
+                                                       size - 1, &mat2) == 0);
+    Matrix<Real> mat3(num_rows, num_cols);
+    cmat.CopyToMat(&mat3);
+    Vector<Real> row(num_cols);
+    for (int32 r = 0; r < num_rows; r++) {
+      cmat.CopyRowToVec(r, &row);
+      for (int32 c = 0; c < num_cols; c++)
+        KALDI_ASSERT(mat2(r, c) == row(c) && mat3(r, c) == row(c));
+    }
+  }
+}
+
 template<typename Real> static void UnitTestCompressedMatrix() {
   // This is the basic test.
 
@@ -4584,6 +4616,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   // UnitTestSvdBad<Real>(); // test bug in Jama SVD code.
   UnitTestCompressedMatrix<Real>();
   UnitTestCompressedMatrix2<Real>();
+  UnitTestCompressedMatrixFromMemory<Real>();
   UnitTestExtractCompressedMatrix<Real>();
   UnitTestResize<Real>();
   UnitTestResizeCopyDataDifferentStrideType<Real>();
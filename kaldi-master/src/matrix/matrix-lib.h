@@ -33,6 +33,7 @@
 #include "matrix/compressed-matrix.h"
 #include "matrix/sparse-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/matrix-backend.h"
 
 #endif
 
@@ -0,0 +1,117 @@
+// transform/block-accumulators-speed-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transform/block-accumulators.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+static void CsvResult(std::string test, int dim, BaseFloat measure, std::string units) {
+  std::cout << test << "," << dim << "," << measure << "," << units << "\n";
+}
+
+// Gives access to the statistics for the comparison; the per-frame path is
+// LdaEstimate::Accumulate(), which is hidden by LdaBlockEstimate.
+class LdaTestEstimate: public LdaBlockEstimate {
+ public:
+  explicit LdaTestEstimate(int32 block_size): LdaBlockEstimate(block_size) { }
+  const Vector<double> &ZeroAcc() const { return zero_acc_; }
+  const Matrix<double> &FirstAcc() const { return first_acc_; }
+  const SpMatrix<double> &SecondAcc() const { return total_second_acc_; }
+};
+
+static void UnitTestLdaAccumulateSpeed() {
+  int32 dim = 40 * 9, num_classes = 200, num_frames = 20000;  // spliced MFCCs
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  std::vector<int32> classes(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    classes[t] = RandInt(0, num_classes - 1);
+
+  LdaTestEstimate frame_est(1), block_est(256);
+  frame_est.Init(num_classes, dim);
+  block_est.Init(num_classes, dim);
+  {
+    Timer t1;
+    for (int32 t = 0; t < num_frames; t++)
+      frame_est.LdaEstimate::Accumulate(feats.Row(t), classes[t], 1.0);
+    CsvResult("LdaEstimate::Accumulate (per frame)", dim, t1.Elapsed(), "seconds");
+  }
+  {
+    Timer t1;
+    for (int32 t = 0; t < num_frames; t++)
+      block_est.Accumulate(feats.Row(t), classes[t], 1.0);
+    block_est.Flush();
+    CsvResult("LdaBlockEstimate::Accumulate (block)", dim, t1.Elapsed(), "seconds");
+  }
+  KALDI_ASSERT(frame_est.ZeroAcc().ApproxEqual(block_est.ZeroAcc()));
+  AssertEqual(frame_est.FirstAcc(), block_est.FirstAcc());
+  AssertEqual(frame_est.SecondAcc(), block_est.SecondAcc());
+}
+
+static void UnitTestMlltAccumulateSpeed() {
+  int32 dim = 40, num_gauss = 16, num_frames = 20000;
+  DiagGmm gmm(num_gauss, dim);
+  Matrix<BaseFloat> means(num_gauss, dim), inv_vars(num_gauss, dim);
+  means.SetRandn();
+  inv_vars.SetRandn();
+  inv_vars.ApplyPow(2.0);
+  inv_vars.Add(0.5);
+  Vector<BaseFloat> weights(num_gauss);
+  weights.Set(1.0 / num_gauss);
+  gmm.SetWeights(weights);
+  gmm.SetInvVarsAndMeans(inv_vars, means);
+  gmm.ComputeGconsts();
+
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  // a few negative weights, which do not go through the rank-k update.
+  std::vector<BaseFloat> frame_weights(num_frames, 1.0);
+  for (int32 t = 0; t < num_frames; t += 100)
+    frame_weights[t] = -0.5;
+
+  MlltAccs frame_accs(dim, 0.0), block_accs(dim, 0.0);  // no pruning (random)
+  {
+    Timer t1;
+    for (int32 t = 0; t < num_frames; t++)
+      frame_accs.AccumulateFromGmm(gmm, feats.Row(t), frame_weights[t]);
+    CsvResult("MlltAccs::AccumulateFromGmm (per frame)", dim, t1.Elapsed(), "seconds");
+  }
+  {
+    Timer t1;
+    MlltBlockAccs block(&block_accs, 256);
+    for (int32 t = 0; t < num_frames; t++)
+      block.AccumulateFromGmm(gmm, feats.Row(t), frame_weights[t]);
+    block.Flush();
+    CsvResult("MlltBlockAccs::AccumulateFromGmm (block)", dim, t1.Elapsed(), "seconds");
+  }
+  AssertEqual(frame_accs.beta_, block_accs.beta_);
+  for (int32 j = 0; j < dim; j++)
+    AssertEqual(frame_accs.G_[j], block_accs.G_[j]);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  Timer t;
+  UnitTestLdaAccumulateSpeed();
+  UnitTestMlltAccumulateSpeed();
+  KALDI_LOG << "Tests succeeded, total duration " << t.Elapsed() << " seconds.";
+}
@@ -0,0 +1,127 @@
+// transform/block-accumulators-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transform/block-accumulators.h"
+
+namespace kaldi {
+
+// Gives access to the statistics for the comparison; the per-frame path is
+// LdaEstimate::Accumulate(), which is hidden by LdaBlockEstimate.
+class LdaTestEstimate: public LdaBlockEstimate {
+ public:
+  explicit LdaTestEstimate(int32 block_size): LdaBlockEstimate(block_size) { }
+  const Vector<double> &ZeroAcc() const { return zero_acc_; }
+  const Matrix<double> &FirstAcc() const { return first_acc_; }
+  const SpMatrix<double> &SecondAcc() const { return total_second_acc_; }
+};
+
+// Frame weights with a few negative ones (which are not part of the rank-k
+// update) and zeros.
+static void RandFrameWeights(int32 num_frames, std::vector<BaseFloat> *weights) {
+  weights->resize(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 r = RandInt(0, 9);
+    (*weights)[t] = (r == 0 ? -0.5 * RandUniform() :
+                     (r == 1 ? 0.0 : 2.0 * RandUniform()));
+  }
+}
+
+// The block accumulation gives the same statistics as
+// LdaEstimate::Accumulate(), also when the last block is only partially
+// filled and when the statistics are split over two accumulators.
+static void UnitTestLdaBlockEstimate() {
+  int32 dim = RandInt(1, 20), num_classes = RandInt(1, 5),
+      block_size = RandInt(2, 16),
+      num_frames = RandInt(0, 5) * block_size + RandInt(1, block_size - 1);
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  std::vector<BaseFloat> weights;
+  RandFrameWeights(num_frames, &weights);
+  std::vector<int32> classes(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    classes[t] = RandInt(0, num_classes - 1);
+
+  LdaTestEstimate frame_est(1), block_est(block_size), part_est(block_size);
+  frame_est.Init(num_classes, dim);
+  block_est.Init(num_classes, dim);
+  part_est.Init(num_classes, dim);
+  int32 split = RandInt(0, num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    frame_est.LdaEstimate::Accumulate(feats.Row(t), classes[t], weights[t]);
+    if (t < split)
+      block_est.Accumulate(feats.Row(t), classes[t], weights[t]);
+    else
+      part_est.Accumulate(feats.Row(t), classes[t], weights[t]);
+  }
+  block_est.Flush();
+  part_est.Flush();
+  block_est.Add(part_est);
+  KALDI_ASSERT(frame_est.ZeroAcc().ApproxEqual(block_est.ZeroAcc()));
+  AssertEqual(frame_est.FirstAcc(), block_est.FirstAcc());
+  AssertEqual(frame_est.SecondAcc(), block_est.SecondAcc());
+}
+
+// MlltBlockAccs gives the same statistics as MlltAccs, with negative
+// posteriors and a partially filled last block.
+static void UnitTestMlltBlockAccs() {
+  int32 dim = RandInt(1, 10), num_gauss = RandInt(1, 4),
+      block_size = RandInt(2, 16), num_frames = RandInt(1, 40);
+  DiagGmm gmm(num_gauss, dim);
+  Matrix<BaseFloat> means(num_gauss, dim), inv_vars(num_gauss, dim);
+  means.SetRandn();
+  inv_vars.SetRandn();
+  inv_vars.ApplyPow(2.0);
+  inv_vars.Add(0.5);
+  Vector<BaseFloat> gauss_weights(num_gauss);
+  gauss_weights.Set(1.0 / num_gauss);
+  gmm.SetWeights(gauss_weights);
+  gmm.SetInvVarsAndMeans(inv_vars, means);
+  gmm.ComputeGconsts();
+
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  std::vector<BaseFloat> weights;
+  RandFrameWeights(num_frames, &weights);
+
+  MlltAccs frame_accs(dim, 0.0), block_accs(dim, 0.0);  // no pruning (random)
+  BaseFloat frame_like = 0.0, block_like = 0.0;
+  {
+    MlltBlockAccs block(&block_accs, block_size);
+    for (int32 t = 0; t < num_frames; t++) {
+      frame_like += frame_accs.AccumulateFromGmm(gmm, feats.Row(t), weights[t]);
+      block_like += block.AccumulateFromGmm(gmm, feats.Row(t), weights[t]);
+    }
+  }  // the destructor flushes the last block.
+  AssertEqual(frame_like, block_like);
+  AssertEqual(frame_accs.beta_, block_accs.beta_);
+  for (int32 j = 0; j < dim; j++)
+    AssertEqual(frame_accs.G_[j], block_accs.G_[j]);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 20; i++) {
+    UnitTestLdaBlockEstimate();
+    UnitTestMlltBlockAccs();
+  }
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
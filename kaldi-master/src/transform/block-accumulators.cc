@@ -0,0 +1,184 @@
+// transform/block-accumulators.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transform/block-accumulators.h"
+
+namespace kaldi {
+
+// Adds the lower triangle of 'full' to 'sp' and zeroes 'full'.
+static void AddLowerToSp(Matrix<double> *full, SpMatrix<double> *sp) {
+  int32 dim = full->NumRows();
+  double *sp_data = sp->Data();
+  for (int32 r = 0; r < dim; r++) {
+    const double *row = full->RowData(r);
+    for (int32 c = 0; c <= r; c++)
+      *(sp_data++) += row[c];
+  }
+  full->SetZero();
+}
+
+void LdaBlockEstimate::Init(int32 num_classes, int32 dimension) {
+  LdaEstimate::Init(num_classes, dimension);
+  KALDI_ASSERT(block_size_ > 0);
+  block_.Resize(block_size_, dimension);
+  second_full_.Resize(dimension, dimension);
+  num_pending_ = 0;
+}
+
+void LdaBlockEstimate::Accumulate(const VectorBase<BaseFloat> &data,
+                                  int32 class_id, BaseFloat weight) {
+  KALDI_ASSERT(class_id >= 0);
+  KALDI_ASSERT(class_id < NumClasses() && data.Dim() == Dim());
+
+  zero_acc_(class_id) += weight;
+  double *first_row = first_acc_.RowData(class_id);
+  const BaseFloat *x = data.Data();
+  int32 dim = Dim();
+  for (int32 d = 0; d < dim; d++)
+    first_row[d] += weight * x[d];
+
+  if (weight < 0.0) {  // can not be written as a rank-k update with sqrt(weight)
+    Vector<double> data_d(data);
+    total_second_acc_.AddVec2(weight, data_d);
+    return;
+  }
+  double scale = std::sqrt(static_cast<double>(weight));
+  double *row = block_.RowData(num_pending_);
+  for (int32 d = 0; d < dim; d++)
+    row[d] = scale * x[d];
+  if (++num_pending_ == block_size_)
+    FlushBlock();
+}
+
+void LdaBlockEstimate::FlushBlock() {
+  if (num_pending_ == 0) return;
+  // second_full_ += block_(0:n)^T block_(0:n), lower triangle.
+  second_full_.SymAddMat2(1.0, block_.RowRange(0, num_pending_), kTrans, 1.0);
+  num_pending_ = 0;
+}
+
+void LdaBlockEstimate::Flush() {
+  if (Dim() == 0) return;
+  FlushBlock();
+  AddLowerToSp(&second_full_, &total_second_acc_);
+}
+
+void LdaBlockEstimate::Add(const LdaBlockEstimate &other) {
+  KALDI_ASSERT(other.num_pending_ == 0);
+  if (other.Dim() == 0) return;
+  if (Dim() == 0) Init(other.NumClasses(), other.Dim());
+  KALDI_ASSERT(NumClasses() == other.NumClasses() && Dim() == other.Dim());
+  zero_acc_.AddVec(1.0, other.zero_acc_);
+  first_acc_.AddMat(1.0, other.first_acc_);
+  total_second_acc_.AddSp(1.0, other.total_second_acc_);
+}
+
+
+MlltBlockAccs::MlltBlockAccs(MlltAccs *accs, int32 block_size):
+    accs_(accs), block_size_(block_size), num_pending_(0), beta_(0.0) {
+  int32 dim = accs_->Dim();
+  KALDI_ASSERT(dim > 0 && block_size_ > 0);
+  offsets_.Resize(block_size_, dim);
+  weights_.Resize(block_size_, dim);
+  scaled_.Resize(block_size_, dim);
+  mean_.Resize(dim);
+  G_full_.resize(dim);
+  for (int32 j = 0; j < dim; j++)
+    G_full_[j].Resize(dim, dim);
+}
+
+void MlltBlockAccs::AccumulateFromPosteriors(const DiagGmm &gmm,
+                                             const VectorBase<BaseFloat> &data,
+                                             const VectorBase<BaseFloat> &posteriors) {
+  int32 dim = data.Dim();
+  KALDI_ASSERT(dim == gmm.Dim() && dim == accs_->Dim());
+  KALDI_ASSERT(posteriors.Dim() == gmm.NumGauss());
+  KALDI_ASSERT(accs_->rand_prune_ >= 0.0);
+  const Matrix<BaseFloat> &means_invvars = gmm.means_invvars();
+  const Matrix<BaseFloat> &inv_vars = gmm.inv_vars();
+  for (int32 i = 0; i < posteriors.Dim(); i++) {  // for each mixcomp..
+    BaseFloat posterior = RandPrune(posteriors(i), accs_->rand_prune_);
+    if (posterior == 0.0) continue;
+    SubVector<BaseFloat> mean_invvar(means_invvars, i);
+    SubVector<BaseFloat> inv_var(inv_vars, i);
+    mean_.AddVecDivVec(1.0, mean_invvar, inv_var, 0.0);  // get mean.
+    if (posterior < 0.0) {  // can not be written as a rank-k update with sqrt(weight)
+      Vector<double> offset_dbl(dim);
+      for (int32 d = 0; d < dim; d++)
+        offset_dbl(d) = mean_(d) - data(d);
+      for (int32 j = 0; j < dim; j++)
+        G_full_[j].AddVecVec(inv_var(j) * posterior, offset_dbl, offset_dbl);
+      beta_ += posterior;
+      continue;
+    }
+    double *offset = offsets_.RowData(num_pending_),
+        *weight = weights_.RowData(num_pending_);
+    for (int32 d = 0; d < dim; d++) {
+      offset[d] = mean_(d) - data(d);
+      weight[d] = inv_var(d) * posterior;
+    }
+    beta_ += posterior;
+    if (++num_pending_ == block_size_)
+      FlushBlock();
+  }
+}
+
+BaseFloat MlltBlockAccs::AccumulateFromGmm(const DiagGmm &gmm,
+                                           const VectorBase<BaseFloat> &data,
+                                           BaseFloat weight) {
+  posteriors_.Resize(gmm.NumGauss(), kUndefined);
+  BaseFloat ans = gmm.ComponentPosteriors(data, &posteriors_);
+  posteriors_.Scale(weight);
+  AccumulateFromPosteriors(gmm, data, posteriors_);
+  return ans;
+}
+
+void MlltBlockAccs::FlushBlock() {
+  if (num_pending_ == 0) return;
+  int32 dim = accs_->Dim();
+  for (int32 j = 0; j < dim; j++) {
+    // scaled_ = diag(sqrt(weights_(:, j))) offsets_, then G_j += scaled_^T scaled_.
+    for (int32 k = 0; k < num_pending_; k++) {
+      double scale = std::sqrt(weights_(k, j));
+      const double *offset = offsets_.RowData(k);
+      double *row = scaled_.RowData(k);
+      for (int32 d = 0; d < dim; d++)
+        row[d] = scale * offset[d];
+    }
+    G_full_[j].SymAddMat2(1.0, scaled_.RowRange(0, num_pending_), kTrans, 1.0);
+  }
+  num_pending_ = 0;
+}
+
+void MlltBlockAccs::Flush() {
+  FlushBlock();
+  for (size_t j = 0; j < G_full_.size(); j++)
+    AddLowerToSp(&G_full_[j], &(accs_->G_[j]));
+  accs_->beta_ += beta_;
+  beta_ = 0.0;
+}
+
+void AddMlltAccs(const MlltAccs &other, MlltAccs *accs) {
+  KALDI_ASSERT(other.G_.size() == accs->G_.size());
+  for (size_t j = 0; j < accs->G_.size(); j++)
+    accs->G_[j].AddSp(1.0, other.G_[j]);
+  accs->beta_ += other.beta_;
+}
+
+}  // namespace kaldi
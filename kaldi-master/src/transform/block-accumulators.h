@@ -0,0 +1,124 @@
+// transform/block-accumulators.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_TRANSFORM_BLOCK_ACCUMULATORS_H_
+#define KALDI_TRANSFORM_BLOCK_ACCUMULATORS_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/diag-gmm.h"
+#include "matrix/matrix-lib.h"
+#include "transform/lda-estimate.h"
+#include "transform/mllt.h"
+
+namespace kaldi {
+
+/// Block versions of the LDA and MLLT accumulators.
+///
+/// LdaEstimate::Accumulate() and MlltAccs::AccumulateFromPosteriors() update
+/// the second order statistics with one rank-1 update (SpMatrix::AddVec2) per
+/// frame (and per Gaussian for MLLT), which is memory bound.  The classes below
+/// gather the weighted frames into a block of rows and update the statistics
+/// with one rank-k update (MatrixBase::SymAddMat2) per block.  The
+/// statistics are kept in the lower triangle of full matrices and folded into
+/// the packed matrices of the original accumulators by Flush(), so the output
+/// (Write()) is identical to the per-frame accumulation up to rounding.
+/// Several instances can be used as per-thread partial accumulators and summed
+/// with Add() at the end.
+
+/// LDA statistics; Flush() must be called before Estimate(), Write() or Add().
+class LdaBlockEstimate: public LdaEstimate {
+ public:
+  explicit LdaBlockEstimate(int32 block_size = 256):
+      block_size_(block_size), num_pending_(0) { }
+
+  /// Allocates memory for accumulators
+  void Init(int32 num_classes, int32 dimension);
+
+  /// Accumulates data (the weight must be >= 0, negative weights are added
+  /// directly).
+  void Accumulate(const VectorBase<BaseFloat> &data, int32 class_id,
+                  BaseFloat weight = 1.0);
+
+  /// Adds the pending block and the full matrix statistics to the packed
+  /// statistics of LdaEstimate.
+  void Flush();
+
+  /// Adds the statistics of another (flushed) accumulator.
+  void Add(const LdaBlockEstimate &other);
+
+ private:
+  void FlushBlock();
+
+  int32 block_size_;
+  Matrix<double> block_;        // pending frames, scaled by sqrt(weight)
+  int32 num_pending_;
+  Matrix<double> second_full_;  // lower triangle of the scatter since the last Flush()
+};
+
+/// MLLT statistics, accumulated into an MlltAccs object (which is updated by
+/// Flush()).  G_j += sum_t,i p_ti inv_var_i(j) (mu_i - x_t)(mu_i - x_t)^T:
+/// the offsets (mu_i - x_t) are gathered into a block and for each dimension j
+/// the rows are scaled by sqrt(p_ti inv_var_i(j)) before the rank-k update.
+/// Negative posteriors are added directly with a rank-1 update.
+class MlltBlockAccs {
+ public:
+  /// 'accs' must be initialized (MlltAccs::Init()); its rand_prune_ is used.
+  explicit MlltBlockAccs(MlltAccs *accs, int32 block_size = 256);
+
+  ~MlltBlockAccs() { Flush(); }
+
+  /// Same as MlltAccs::AccumulateFromPosteriors().
+  void AccumulateFromPosteriors(const DiagGmm &gmm,
+                                const VectorBase<BaseFloat> &data,
+                                const VectorBase<BaseFloat> &posteriors);
+
+  /// Same as MlltAccs::AccumulateFromGmm(); returns GMM likelihood.
+  BaseFloat AccumulateFromGmm(const DiagGmm &gmm,
+                              const VectorBase<BaseFloat> &data,
+                              BaseFloat weight);
+
+  /// Adds the pending statistics to the MlltAccs object.
+  void Flush();
+
+ private:
+  void FlushBlock();
+
+  MlltAccs *accs_;
+  int32 block_size_;
+  Matrix<double> offsets_;   // pending offsets (mu_i - x_t)
+  Matrix<double> weights_;   // pending weights p_ti inv_var_i(j)
+  int32 num_pending_;
+  double beta_;
+  Matrix<double> scaled_;    // work space
+  Vector<BaseFloat> posteriors_, mean_;
+  std::vector<Matrix<double> > G_full_;  // lower triangles since the last Flush()
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MlltBlockAccs);
+};
+
+/// Adds the statistics of 'other' to 'accs' (e.g. per-thread partial
+/// accumulators).
+void AddMlltAccs(const MlltAccs &other, MlltAccs *accs);
+
+}  // namespace kaldi
+
+#endif  // KALDI_TRANSFORM_BLOCK_ACCUMULATORS_H_
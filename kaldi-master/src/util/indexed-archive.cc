@@ -0,0 +1,191 @@
+// util/indexed-archive.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "util/indexed-archive.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+static const char kIndexedArchiveMagic[] = "KALDIIDX";
+static const size_t kIndexedArchiveMagicSize = 8;
+
+void WriteVarint(uint64 value, std::string *out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const char **data, const char *end, uint64 *value) {
+  uint64 ans = 0;
+  for (int32 shift = 0; shift < 64 && *data < end; shift += 7) {
+    uint64 byte = static_cast<unsigned char>(**data);
+    (*data)++;
+    ans |= (byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = ans;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IndexedArchiveWriter::Open(const std::string &wxfilename) {
+  if (output_.IsOpen() && !Close())
+    KALDI_ERR << "Error closing previous indexed archive " << wxfilename_;
+  wxfilename_ = wxfilename;
+  offset_ = 0;
+  num_entries_ = 0;
+  index_.clear();
+  if (!output_.Open(wxfilename, true, false)) {  // binary, no header.
+    KALDI_WARN << "Failed to open indexed archive "
+               << PrintableWxfilename(wxfilename);
+    return false;
+  }
+  output_.Stream().write(kIndexedArchiveMagic, kIndexedArchiveMagicSize);
+  offset_ = kIndexedArchiveMagicSize;
+  return output_.Stream().good();
+}
+
+bool IndexedArchiveWriter::Write(const std::string &key, const std::string &bytes) {
+  if (!IsToken(key)) {
+    KALDI_WARN << "Using invalid key " << key;
+    return false;
+  }
+  std::ostream &os = output_.Stream();
+  os.write(bytes.data(), bytes.size());
+  if (!os.good()) {
+    KALDI_WARN << "Write failure to indexed archive "
+               << PrintableWxfilename(wxfilename_);
+    return false;
+  }
+  WriteVarint(key.size(), &index_);
+  index_.append(key);
+  WriteVarint(offset_, &index_);
+  WriteVarint(bytes.size(), &index_);
+  offset_ += bytes.size();
+  num_entries_++;
+  return true;
+}
+
+bool IndexedArchiveWriter::Close() {
+  if (!output_.IsOpen()) return true;
+  std::string footer;
+  WriteVarint(num_entries_, &footer);
+  footer.append(index_);
+  uint64 index_offset = offset_;
+  for (int32 i = 0; i < 8; i++)
+    footer.push_back(static_cast<char>((index_offset >> (8 * i)) & 0xFF));
+  footer.append(kIndexedArchiveMagic, kIndexedArchiveMagicSize);
+  output_.Stream().write(footer.data(), footer.size());
+  bool ans = output_.Stream().good();
+  ans = output_.Close() && ans;
+  index_.clear();
+  if (!ans)
+    KALDI_WARN << "Error closing indexed archive "
+               << PrintableWxfilename(wxfilename_);
+  return ans;
+}
+
+IndexedArchiveWriter::~IndexedArchiveWriter() {
+  if (output_.IsOpen() && !Close())
+    KALDI_ERR << "Error closing indexed archive "
+              << PrintableWxfilename(wxfilename_);
+}
+
+bool IndexedArchiveReader::Open(const std::string &rxfilename) {
+  Close();
+  if (ClassifyRxfilename(rxfilename) != kFileInput) {
+    KALDI_WARN << "Indexed archives can only be read from files, not from "
+               << PrintableRxfilename(rxfilename);
+    return false;
+  }
+  if (!file_.Open(rxfilename)) return false;
+  const char *data = file_.Data();
+  size_t size = file_.Size();
+  size_t trailer_size = 8 + kIndexedArchiveMagicSize;
+  if (size < kIndexedArchiveMagicSize + trailer_size ||
+      memcmp(data, kIndexedArchiveMagic, kIndexedArchiveMagicSize) != 0 ||
+      memcmp(data + size - kIndexedArchiveMagicSize, kIndexedArchiveMagic,
+             kIndexedArchiveMagicSize) != 0) {
+    KALDI_WARN << "Not an indexed archive (or truncated): " << rxfilename;
+    Close();
+    return false;
+  }
+  uint64 index_offset = 0;
+  const char *p = data + size - trailer_size;
+  for (int32 i = 0; i < 8; i++)
+    index_offset |= static_cast<uint64>(static_cast<unsigned char>(p[i])) << (8 * i);
+  if (index_offset < kIndexedArchiveMagicSize || index_offset > size - trailer_size) {
+    KALDI_WARN << "Bad index offset in indexed archive " << rxfilename;
+    Close();
+    return false;
+  }
+  const char *cur = data + index_offset, *end = data + size - trailer_size;
+  uint64 num_entries;
+  if (!ReadVarint(&cur, end, &num_entries)) {
+    KALDI_WARN << "Bad index in indexed archive " << rxfilename;
+    Close();
+    return false;
+  }
+  for (uint64 i = 0; i < num_entries; i++) {
+    uint64 key_size, offset, entry_size;
+    if (!ReadVarint(&cur, end, &key_size) ||
+        key_size > static_cast<uint64>(end - cur)) {
+      KALDI_WARN << "Bad index in indexed archive " << rxfilename;
+      Close();
+      return false;
+    }
+    std::string key(cur, key_size);
+    cur += key_size;
+    if (!ReadVarint(&cur, end, &offset) || !ReadVarint(&cur, end, &entry_size) ||
+        offset < kIndexedArchiveMagicSize || offset > index_offset ||
+        entry_size > index_offset - offset) {
+      KALDI_WARN << "Bad index in indexed archive " << rxfilename;
+      Close();
+      return false;
+    }
+    if (!key_to_entry_.insert(std::make_pair(key, keys_.size())).second)
+      KALDI_WARN << "Duplicate key " << key << " in indexed archive "
+                 << rxfilename << " (using the first one)";
+    keys_.push_back(key);
+    entries_.push_back(std::make_pair(offset, entry_size));
+  }
+  return true;
+}
+
+void IndexedArchiveReader::Close() {
+  file_.Close();
+  keys_.clear();
+  entries_.clear();
+  key_to_entry_.clear();
+}
+
+bool IndexedArchiveReader::Find(const std::string &key, size_t *i) const {
+  std::unordered_map<std::string, size_t, StringHasher>::const_iterator
+      iter = key_to_entry_.find(key);
+  if (iter == key_to_entry_.end()) return false;
+  *i = iter->second;
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,149 @@
+// util/indexed-archive.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_INDEXED_ARCHIVE_H_
+#define KALDI_UTIL_INDEXED_ARCHIVE_H_
+
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+#include "util/stl-utils.h"
+
+namespace kaldi {
+
+/// \addtogroup table_group
+/// @{
+
+/// Indexed archives ("idx:filename" rspecifiers and wspecifiers, see
+/// kaldi-table.h) store the objects of a table one after the other, followed
+/// by an index of (key, offset, size) entries.  The file is memory mapped for
+/// reading, so any object can be accessed by its key without reading the
+/// archive up to it.  The format is:
+///
+///   "KALDIIDX"  entry entry ...  index  index-offset "KALDIIDX"
+///
+/// where an entry is the object encoded by IndexedArchiveCodec<Holder>, the
+/// index is the varint number of entries followed by (varint key length, key,
+/// varint offset, varint size) per entry, in the order of writing, and
+/// index-offset is the 8 byte little endian offset of the index.
+
+/// Appends the LEB128 (varint) encoding of 'value' to 'out'.
+void WriteVarint(uint64 value, std::string *out);
+
+/// Reads a varint at *data (not past 'end') and advances *data; returns false
+/// if the data is truncated.
+bool ReadVarint(const char **data, const char *end, uint64 *value);
+
+/// Maps signed values with small magnitude to small unsigned values
+/// (0, -1, 1, -2, ... to 0, 1, 2, 3, ...), for varint encoding of deltas.
+inline uint64 ZigZagEncode(int64 value) {
+  return (static_cast<uint64>(value) << 1) ^ static_cast<uint64>(value >> 63);
+}
+inline int64 ZigZagDecode(uint64 value) {
+  return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+}
+
+class IndexedArchiveWriter {
+ public:
+  IndexedArchiveWriter(): offset_(0), num_entries_(0) { }
+
+  /// The wxfilename may also be a pipe or stdout (the reader needs a file).
+  bool Open(const std::string &wxfilename);
+
+  bool IsOpen() { return output_.IsOpen(); }
+
+  /// Writes one encoded object.
+  bool Write(const std::string &key, const std::string &bytes);
+
+  void Flush() { if (output_.IsOpen()) output_.Stream().flush(); }
+
+  /// Writes the index and closes the file.
+  bool Close();
+
+  ~IndexedArchiveWriter();
+
+ private:
+  Output output_;
+  std::string wxfilename_;
+  uint64 offset_;
+  std::string index_;  // the index entries, encoded
+  uint64 num_entries_;
+};
+
+class IndexedArchiveReader {
+ public:
+  /// The rxfilename must be a file (it is memory mapped).
+  bool Open(const std::string &rxfilename);
+
+  bool IsOpen() const { return file_.IsOpen(); }
+
+  void Close();
+
+  size_t NumEntries() const { return keys_.size(); }
+
+  const std::string &Key(size_t i) const { return keys_[i]; }
+
+  const char *EntryData(size_t i) const { return file_.Data() + entries_[i].first; }
+
+  size_t EntrySize(size_t i) const { return entries_[i].second; }
+
+  /// Finds the entry of a key; returns false if not present.
+  bool Find(const std::string &key, size_t *i) const;
+
+ private:
+  MemoryMappedFile file_;
+  std::vector<std::string> keys_;
+  std::vector<std::pair<uint64, uint64> > entries_;  // (offset, size)
+  std::unordered_map<std::string, size_t, StringHasher> key_to_entry_;
+};
+
+/// Encodes and decodes the objects of a Holder for indexed archives.  The
+/// default uses the Holder's own (binary, unless "t" is given) format; it may
+/// be specialized for types with a more compact encoding (see
+/// IndexedArchiveCodec<CompactLatticeHolder> in lat/kaldi-lattice.h).
+/// 'precision' is the "q" option of the wspecifier (number of decimals kept
+/// of the quantized floating point values; -1 means exact), it may be ignored.
+template<class Holder> class IndexedArchiveCodec {
+ public:
+  static bool Encode(const typename Holder::T &t, bool binary, int32 precision,
+                     std::string *bytes) {
+    std::ostringstream os;
+    if (!Holder::Write(os, binary, t)) return false;
+    *bytes = os.str();
+    return true;
+  }
+
+  static bool Decode(const char *data, size_t size, Holder *holder) {
+    std::istringstream is(std::string(data, size));
+    return holder->Read(is);
+  }
+};
+
+/// @} end "addtogroup table_group"
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_INDEXED_ARCHIVE_H_
@@ -0,0 +1,121 @@
+// util/kaldi-mmap.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+
+#ifdef _MSC_VER
+
+MemoryMappedFile::MemoryMappedFile(): data_(NULL), size_(0), is_open_(false),
+    file_(INVALID_HANDLE_VALUE), mapping_(NULL) { }
+
+bool MemoryMappedFile::Open(const std::string &filename) {
+  Close();
+  file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    KALDI_WARN << "Could not open file " << filename << " for mapping.";
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size)) {
+    KALDI_WARN << "Could not get the size of file " << filename;
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  is_open_ = true;
+  if (size_ == 0) return true;  // an empty file can not be mapped.
+  mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping_ == NULL) {
+    KALDI_WARN << "Could not map file " << filename;
+    Close();
+    return false;
+  }
+  data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == NULL) {
+    KALDI_WARN << "Could not map file " << filename;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MemoryMappedFile::Close() {
+  if (data_ != NULL) UnmapViewOfFile(data_);
+  if (mapping_ != NULL) CloseHandle(mapping_);
+  if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+  data_ = NULL;
+  mapping_ = NULL;
+  file_ = INVALID_HANDLE_VALUE;
+  size_ = 0;
+  is_open_ = false;
+}
+
+#else  // _MSC_VER
+
+MemoryMappedFile::MemoryMappedFile(): data_(NULL), size_(0), is_open_(false),
+    fd_(-1) { }
+
+bool MemoryMappedFile::Open(const std::string &filename) {
+  Close();
+  fd_ = open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    KALDI_WARN << "Could not open file " << filename << " for mapping.";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    KALDI_WARN << "Could not get the size of file " << filename;
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  is_open_ = true;
+  if (size_ == 0) return true;  // an empty file can not be mapped.
+  void *data = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    KALDI_WARN << "Could not map file " << filename;
+    Close();
+    return false;
+  }
+  data_ = static_cast<const char*>(data);
+  return true;
+}
+
+void MemoryMappedFile::Close() {
+  if (data_ != NULL) munmap(const_cast<char*>(data_), size_);
+  if (fd_ >= 0) close(fd_);
+  data_ = NULL;
+  fd_ = -1;
+  size_ = 0;
+  is_open_ = false;
+}
+
+#endif  // _MSC_VER
+
+}  // namespace kaldi
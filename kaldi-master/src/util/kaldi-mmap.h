@@ -0,0 +1,67 @@
+// util/kaldi-mmap.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <string>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap
+/// elsewhere).  Used for the random access to indexed archives and by
+/// MappedFeatureReader; the pages are
+/// read by the OS on demand and shared between the processes reading the same
+/// file.
+class MemoryMappedFile {
+ public:
+  MemoryMappedFile();
+
+  /// Maps the file (a real file, not a pipe or stdin); returns false on error.
+  bool Open(const std::string &filename);
+
+  void Close();
+
+  bool IsOpen() const { return is_open_; }
+
+  const char *Data() const { return data_; }
+
+  size_t Size() const { return size_; }
+
+  ~MemoryMappedFile() { Close(); }
+
+ private:
+  const char *data_;
+  size_t size_;
+  bool is_open_;
+#ifdef _MSC_VER
+  HANDLE file_, mapping_;
+#else
+  int fd_;
+#endif
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
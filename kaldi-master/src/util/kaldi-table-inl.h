@@ -34,6 +34,7 @@
 #include "util/text-utils.h"
 #include "util/stl-utils.h"  // for StringHasher.
 #include "util/kaldi-semaphore.h"
+#include "util/indexed-archive.h"
 
 
 namespace kaldi {
@@ -696,6 +697,160 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   } state_;
 };
 
+// This is the implementation for SequentialTableReader when it is an indexed
+// archive ("idx:", see indexed-archive.h).  The entries are read in the order
+// of the index (which is the order of writing) from the memory mapped file.
+template<class Holder>  class SequentialTableReaderIndexedImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderIndexedImpl(): state_(kUninitialized), next_entry_(0) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (state_ != kUninitialized) {
+      if (!Close()) {  // call Close() yourself to suppress this exception.
+        if (opts_.permissive)
+          KALDI_WARN << "Error closing previous input "
+              "(only warning, since permissive mode).";
+        else
+          KALDI_ERR << "Error closing previous input.";
+      }
+    }
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier,
+                                           &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kIndexedArchiveRspecifier);
+    if (!reader_.Open(archive_rxfilename_)) {
+      KALDI_WARN << "Failed to open indexed archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      state_ = kUninitialized;
+      return false;
+    }
+    next_entry_ = 0;
+    state_ = kFileStart;
+    Next();
+    if (state_ == kError) {
+      reader_.Close();
+      state_ = kUninitialized;
+      return false;
+    }
+    return true;
+  }
+
+  virtual void Next() {
+    switch (state_) {
+      case kHaveObject:
+        holder_.Clear();
+        break;
+      case kFileStart: case kFreedObject:
+        break;
+      default:
+        KALDI_ERR << "Next() called wrongly.";
+    }
+    while (next_entry_ < reader_.NumEntries()) {
+      size_t i = next_entry_++;
+      key_ = reader_.Key(i);
+      if (IndexedArchiveCodec<Holder>::Decode(reader_.EntryData(i),
+                                              reader_.EntrySize(i), &holder_)) {
+        state_ = kHaveObject;
+        return;
+      }
+      KALDI_WARN << "Object read failed for key " << key_
+                 << ", reading indexed archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      if (!opts_.permissive) {
+        state_ = kError;
+        return;
+      }
+      holder_.Clear();  // skip the entry in permissive mode.
+    }
+    state_ = kEof;
+  }
+
+  virtual bool IsOpen() const {
+    switch (state_) {
+      case kEof: case kError: case kHaveObject: case kFreedObject: return true;
+      case kUninitialized: return false;
+      default: KALDI_ERR << "IsOpen() called on invalid object.";
+        return false;
+    }
+  }
+
+  virtual bool Done() const {
+    switch (state_) {
+      case kHaveObject:
+        return false;
+      case kEof: case kError:
+        return true;
+      default:
+        KALDI_ERR << "Done() called on TableReader object at the wrong time.";
+        return false;
+    }
+  }
+
+  virtual std::string Key() {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return key_;
+  }
+
+  T &Value() {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    return holder_.Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (state_ == kHaveObject) {
+      holder_.Clear();
+      state_ = kFreedObject;
+    } else {
+      KALDI_WARN << "FreeCurrent called at the wrong time.";
+    }
+  }
+
+  void SwapHolder(Holder *other_holder) {
+    (void) Value();
+    holder_.Swap(other_holder);
+    state_ = kFreedObject;
+  }
+
+  virtual bool Close() {
+    if (!this->IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    reader_.Close();
+    if (state_ == kHaveObject)
+      holder_.Clear();
+    StateType old_state = state_;
+    state_ = kUninitialized;
+    return (old_state != kError);
+  }
+
+  virtual ~SequentialTableReaderIndexedImpl() {
+    if (this->IsOpen() && !Close())
+      KALDI_ERR << "TableReader: error detected closing indexed archive "
+                << PrintableRxfilename(archive_rxfilename_);
+  }
+ private:
+  IndexedArchiveReader reader_;
+  Holder holder_;
+  std::string key_;
+  std::string rspecifier_;
+  std::string archive_rxfilename_;
+  RspecifierOptions opts_;
+  enum StateType {
+    kUninitialized,  // Uninitialized or closed.
+    kFileStart,      // [state we use internally: just opened.]
+    kEof,            // No more entries.
+    kError,          // An entry could not be decoded.
+    kHaveObject,     // holder_ has the object of key_.
+    kFreedObject,    // The user called FreeCurrent().
+  } state_;
+  size_t next_entry_;
+};
+
 // this is for when someone adds the 'th' modifier; it wraps around the basic
 // implementation and allows it to do the reading in a background thread.
 template<class Holder>
@@ -876,6 +1031,9 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
     case kScriptRspecifier:
       impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
+    case kIndexedArchiveRspecifier:
+      impl_ = new SequentialTableReaderIndexedImpl<Holder>();
+      break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier " << rspecifier;
       return false;
@@ -1476,6 +1634,114 @@ bool TableWriter<Holder>::IsOpen() const {
 }
 
 
+// The implementation of TableWriter we use when writing an indexed archive
+// ("idx:", see indexed-archive.h).
+template<class Holder>
+class TableWriterIndexedImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  virtual bool Open(const std::string &wspecifier) {
+    switch (state_) {
+      case kUninitialized:
+        break;
+      case kWriteError:
+        KALDI_ERR << "Opening stream, already open with write error.";
+      case kOpen: default:
+        if (!Close())
+          KALDI_ERR << "Opening stream, error closing previously open stream.";
+    }
+    wspecifier_ = wspecifier;
+    WspecifierType ws = ClassifyWspecifier(wspecifier,
+                                           &archive_wxfilename_,
+                                           NULL,
+                                           &opts_);
+    KALDI_ASSERT(ws == kIndexedArchiveWspecifier);  // or wrongly called.
+    if (writer_.Open(archive_wxfilename_)) {
+      state_ = kOpen;
+      return true;
+    } else {
+      state_ = kUninitialized;
+      return false;
+    }
+  }
+
+  virtual bool IsOpen() const {
+    switch (state_) {
+      case kUninitialized: return false;
+      case kOpen: case kWriteError: return true;
+      default: KALDI_ERR << "IsOpen() called on TableWriter in invalid state.";
+    }
+    return false;
+  }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    switch (state_) {
+      case kOpen: break;
+      case kWriteError:
+        KALDI_WARN << "Attempting to write to invalid stream.";
+        return false;
+      case kUninitialized: default:
+        KALDI_ERR << "Write called on invalid stream";
+    }
+    if (!IsToken(key))  // e.g. empty string or has spaces...
+      KALDI_ERR << "Using invalid key " << key;
+    if (!IndexedArchiveCodec<Holder>::Encode(value, opts_.binary,
+                                             opts_.precision, &bytes_) ||
+        !writer_.Write(key, bytes_)) {
+      KALDI_WARN << "Write failure to "
+                 << PrintableWxfilename(archive_wxfilename_);
+      state_ = kWriteError;
+      return false;
+    }
+    if (opts_.flush)
+      Flush();
+    return true;
+  }
+
+  virtual void Flush() {
+    if (state_ == kOpen || state_ == kWriteError)
+      writer_.Flush();
+    else
+      KALDI_WARN << "Flush called on not-open writer.";
+  }
+
+  virtual bool Close() {
+    if (!this->IsOpen())
+      KALDI_ERR << "Close called on a stream that was not open.";
+    bool close_success = writer_.Close();
+    bool write_error = (state_ == kWriteError);
+    state_ = kUninitialized;
+    if (!close_success || write_error) {
+      KALDI_WARN << "Error closing indexed archive: wspecifier is "
+                 << wspecifier_;
+      return false;
+    }
+    return true;
+  }
+
+  TableWriterIndexedImpl(): state_(kUninitialized) {}
+
+  virtual ~TableWriterIndexedImpl() {
+    if (!IsOpen()) return;
+    else if (!Close())
+      KALDI_ERR << "At TableWriter destructor: Write failed or stream close "
+                << "failed: wspecifier is "<<  wspecifier_;
+  }
+
+ private:
+  IndexedArchiveWriter writer_;
+  WspecifierOptions opts_;
+  std::string wspecifier_;
+  std::string archive_wxfilename_;
+  std::string bytes_;  // the encoded object.
+  enum {
+    kUninitialized,
+    kOpen,
+    kWriteError,
+  } state_;
+};
+
 template<class Holder>
 bool TableWriter<Holder>::Open(const std::string &wspecifier) {
   if (IsOpen()) {
@@ -1494,6 +1760,9 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
     case kScriptWspecifier:
       impl_ = new TableWriterScriptImpl<Holder>();
       break;
+    case kIndexedArchiveWspecifier:
+      impl_ = new TableWriterIndexedImpl<Holder>();
+      break;
     case kNoWspecifier: default:
       KALDI_WARN << "ClassifyWspecifier: invalid wspecifier " << wspecifier;
       return false;
@@ -2513,6 +2782,87 @@ RandomAccessTableReader<Holder>::RandomAccessTableReader(const
         " (rspecifier is: " << rspecifier << ")";
 }
 
+// The implementation of RandomAccessTableReader for indexed archives ("idx:",
+// see indexed-archive.h): the index is read on Open() and the objects are
+// decoded from the memory mapped file when they are asked for, so the
+// "s", "cs" and "o" options make no difference.
+template<class Holder>
+class RandomAccessTableReaderIndexedImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderIndexedImpl(): have_object_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kIndexedArchiveRspecifier);
+    if (!reader_.Open(archive_rxfilename_)) {
+      KALDI_WARN << "Failed to open indexed archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    size_t i;
+    if (!reader_.Find(key, &i)) return false;
+    // In permissive mode, entries that can not be decoded count as absent.
+    return (!opts_.permissive || Decode(key, i));
+  }
+
+  virtual const T &Value(const std::string &key) {
+    size_t i;
+    if (!reader_.Find(key, &i))
+      KALDI_ERR << "Value() called but no such key " << key
+                << " in indexed archive "
+                << PrintableRxfilename(archive_rxfilename_);
+    if (!Decode(key, i))
+      KALDI_ERR << "Failed to read object for key " << key
+                << " from indexed archive "
+                << PrintableRxfilename(archive_rxfilename_);
+    return holder_.Value();
+  }
+
+  virtual bool Close() {
+    if (!reader_.IsOpen())
+      KALDI_ERR << "Close() called on RandomAccessTableReader that was not open.";
+    reader_.Close();
+    holder_.Clear();
+    have_object_ = false;
+    return true;
+  }
+
+  virtual ~RandomAccessTableReaderIndexedImpl() { }
+
+ private:
+  // Decodes entry i into holder_ unless it already holds it.
+  bool Decode(const std::string &key, size_t i) {
+    if (have_object_ && key == key_) return true;
+    holder_.Clear();
+    have_object_ = IndexedArchiveCodec<Holder>::Decode(reader_.EntryData(i),
+                                                       reader_.EntrySize(i),
+                                                       &holder_);
+    if (!have_object_) {
+      KALDI_WARN << "Object read failed for key " << key
+                 << ", reading indexed archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      holder_.Clear();
+    }
+    key_ = key;
+    return have_object_;
+  }
+
+  IndexedArchiveReader reader_;
+  Holder holder_;
+  std::string key_;  // the key of the object in holder_.
+  bool have_object_;
+  std::string archive_rxfilename_;
+  RspecifierOptions opts_;
+};
+
 template<class Holder>
 bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
   if (IsOpen())
@@ -2533,6 +2883,9 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
         impl_ = new RandomAccessTableReaderUnsortedArchiveImpl<Holder>();
       }
       break;
+    case kIndexedArchiveRspecifier:
+      impl_ = new RandomAccessTableReaderIndexedImpl<Holder>();
+      break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier: "
                  << rspecifier;
@@ -177,6 +177,33 @@ void UnitTestClassifyWspecifier() {
     KALDI_ASSERT(ans == kBothWspecifier && ark == "" && scp == "" &&
                  opts.binary == true && opts.flush == false);
   }
+
+  {
+    std::string a = "q2,idx:foo.idx";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kIndexedArchiveWspecifier && ark == "foo.idx" &&
+                 scp == "" && opts.precision == 2);
+  }
+
+  {
+    std::string a = "idx,ark:foo";  // invalid as combined.
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
+
+  {
+    std::string a = "qx,idx:foo";  // invalid precision.
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
+
+  {
+    std::string a = "q16,idx:foo";  // too many decimals to read back.
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
 }
 
 
@@ -189,6 +216,15 @@ void UnitTestClassifyRspecifier() {
     KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo|");
   }
 
+  {
+    std::string a = "p,idx:foo.idx";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kIndexedArchiveRspecifier && fname == "foo.idx" &&
+                 opts.permissive);
+  }
+
 
   {
     std::string a = "b,ark:foo|";  // b, is ignored.
@@ -843,6 +879,48 @@ void UnitTestTableRandomBothDouble(bool binary, bool read_scp,
 
 
 
+void UnitTestTableIndexed(bool binary) {
+  int32 sz = Rand() % 10;
+  std::vector<std::string> k;
+  std::vector<std::vector<int32> > v;
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+    v.push_back(std::vector<int32>(Rand() % 5));
+    for (size_t j = 0; j < v.back().size(); j++)
+      v.back()[j] = Rand() % 100;
+  }
+  RandomizeVector(&k);  // the order of writing is kept, keys need not be sorted.
+
+  Int32VectorWriter bw(binary ? "b,idx:tmpf.idx" : "t,f,idx:tmpf.idx");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  bool ans = bw.Close();
+  KALDI_ASSERT(ans);
+
+  SequentialInt32VectorReader sbr("idx:tmpf.idx");
+  std::vector<std::string> k2;
+  std::vector<std::vector<int32> > v2;
+  for (; !sbr.Done(); sbr.Next()) {
+    k2.push_back(sbr.Key());
+    v2.push_back(sbr.Value());
+  }
+  ans = sbr.Close();
+  KALDI_ASSERT(ans);
+  KALDI_ASSERT(k2 == k && v2 == v);
+
+  RandomAccessInt32VectorReader rbr("idx:tmpf.idx");
+  KALDI_ASSERT(!rbr.HasKey("nokey"));
+  for (int32 n = 0; n < 2 * sz; n++) {
+    int32 i = Rand() % sz;
+    if (Rand() % 2 == 0)
+      KALDI_ASSERT(rbr.HasKey(k[i]));
+    KALDI_ASSERT(rbr.Value(k[i]) == v[i]);
+  }
+  ans = rbr.Close();
+  KALDI_ASSERT(ans);
+}
+
+
 void UnitTestRangesMatrix(bool binary) {
   int32 archive_size = RandInt(1, 10);
   std::vector<std::pair<std::string, Matrix<BaseFloat> > > archive_contents(
@@ -1064,6 +1142,7 @@ int main() {
     UnitTestTableSequentialInt32Script(b);
     UnitTestTableSequentialDouble(b);
     UnitTestRangesMatrix(b);
+    UnitTestTableIndexed(b);
     for (int j = 0; j < 2; j++) {
       bool c = (j == 0);
       UnitTestTableSequentialDoubleBoth(b, c);
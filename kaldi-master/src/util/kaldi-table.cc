@@ -183,6 +183,20 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
       if (opts) opts->permissive = true;
+    } else if (c[0] == 'q' && c[1] != '\0') {
+      int32 precision;
+      if (!ConvertStringToInteger(str.substr(1), &precision) || precision < 0)
+        return kNoWspecifier;
+      if (precision > 15) {  // the archives could not be read back.
+        KALDI_WARN << "Invalid wspecifier option " << str
+                   << ": at most 15 decimals are supported.";
+        return kNoWspecifier;
+      }
+      if (opts) opts->precision = precision;
+    } else if (!strcmp(c, "idx")) {
+      if (ws == kNoWspecifier) ws = kIndexedArchiveWspecifier;
+      else
+        return kNoWspecifier;  // Can not be combined with "ark" or "scp".
     } else if (!strcmp(c, "ark")) {
       if (ws == kNoWspecifier) ws = kArchiveWspecifier;
       else
@@ -199,7 +213,7 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
   }
 
   switch (ws) {
-    case kArchiveWspecifier:
+    case kArchiveWspecifier: case kIndexedArchiveWspecifier:
       if (archive_wxfilename)
         *archive_wxfilename = after_colon;
       break;
@@ -303,12 +317,16 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       else
         return kNoRspecifier;  // Repeated or combined ark and scp options
       // invalid.
+    } else if (!strcmp(c, "idx")) {
+      if (rs == kNoRspecifier) rs = kIndexedArchiveRspecifier;
+      else
+        return kNoRspecifier;
     } else {
       return kNoRspecifier;  // Could not interpret this option.
     }
   }
-  if ((rs == kArchiveRspecifier || rs == kScriptRspecifier)
-     && wxfilename != NULL)
+  if ((rs == kArchiveRspecifier || rs == kScriptRspecifier ||
+       rs == kIndexedArchiveRspecifier) && wxfilename != NULL)
     *wxfilename = after_colon;
   return rs;
 }
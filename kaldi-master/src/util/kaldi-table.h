@@ -61,6 +61,7 @@ typedef std::vector<std::string> KeyList;
 //  scp:rxfilename
 //  ark,scp:filename,wxfilename
 //  ark,scp:filename,wxfilename
+//  idx:wxfilename
 //
 //
 //  We also allow the following modifiers:
@@ -71,6 +72,9 @@ typedef std::vector<std::string> KeyList;
 //  p means permissive mode, when writing to an "scp" file only: will ignore
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
+//  q<n> (e.g. q3), for "idx" only: keep n decimals (0 to 15) of the quantized
+//     weights (types with a compact indexed archive encoding, e.g. lattices;
+//     the default is to store them exactly).
 //
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
@@ -102,19 +106,29 @@ typedef std::vector<std::string> KeyList;
 //  In this case we restrict the archive-filename to be an actual filename,
 //  as we can't see a situtation where an extended filename would make sense
 //  for this (we can't fseek() in pipes).
+//
+//  The type idx:wxfilename writes an indexed archive (see indexed-archive.h):
+//  the objects followed by an index of keys and offsets, which allows random
+//  access by key through a memory mapping of the file when reading it with
+//  idx:rxfilename (which must be a file).  Compact lattices are stored in a
+//  compact delta/varint encoding.
 
 enum WspecifierType  {
   kNoWspecifier,
   kArchiveWspecifier,
   kScriptWspecifier,
-  kBothWspecifier
+  kBothWspecifier,
+  kIndexedArchiveWspecifier
 };
 
 struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive;  // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  int32 precision;  // decimals of the quantized weights in indexed archives
+                    // (-1 = exact).
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       precision(-1) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -167,6 +181,7 @@ bool WriteScriptFile(std::ostream &os,
 //
 // ark:rxfilename
 // scp:rxfilename
+// idx:rxfilename  (indexed archive, see above; must be a file)
 //
 // We also allow various modifiers:
 //   o   means the program will only ask for each key once, which enables
@@ -219,7 +234,8 @@ struct  RspecifierOptions {
 enum RspecifierType  {
   kNoRspecifier,
   kArchiveRspecifier,
-  kScriptRspecifier
+  kScriptRspecifier,
+  kIndexedArchiveRspecifier
 };
 
 RspecifierType ClassifyRspecifier(const std::string &rspecifier,
@@ -20,6 +20,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <atomic>
 #include "base/kaldi-common.h"
 #include "util/kaldi-thread.h"
 
@@ -123,6 +124,49 @@ void TestTaskSequencer() {
 }
 
 
+// Collects the messages of the threads which use it.
+class CountingLogSink: public LogSink {
+ public:
+  CountingLogSink(): num_messages_(0), prev_(SetThreadLogSink(this)) { }
+  ~CountingLogSink() { SetThreadLogSink(prev_); }
+  virtual bool Log(const LogMessageEnvelope &envelope, const char *message) {
+    num_messages_++;
+    return true;
+  }
+  std::atomic<int32> num_messages_;
+ private:
+  LogSink *prev_;
+};
+
+class LoggingTaskClass {
+ public:
+  void operator() () { KALDI_VLOG(-1) << "operator ()"; }
+  ~LoggingTaskClass() { KALDI_VLOG(-1) << "destructor"; }
+};
+
+class LoggingThreadClass : public MultiThreadable {
+ public:
+  void operator() () { KALDI_VLOG(-1) << "thread " << thread_id_; }
+};
+
+// The worker threads log to the sink of the thread which started them.
+void TestThreadLogSink() {
+  CountingLogSink sink;
+  int32 num_tasks = 10;
+  {
+    TaskSequencerConfig config;
+    config.num_threads = 4;
+    TaskSequencer<LoggingTaskClass> sequencer(config);
+    for (int32 i = 0; i < num_tasks; i++)
+      sequencer.Run(new LoggingTaskClass());
+  }
+  KALDI_ASSERT(sink.num_messages_ == 2 * num_tasks);
+  {
+    MultiThreader<LoggingThreadClass> m(4, LoggingThreadClass());
+  }  // waits for the threads.
+  KALDI_ASSERT(sink.num_messages_ == 2 * num_tasks + 4);
+}
+
 }  // end namespace kaldi.
 
 int main() {
@@ -130,4 +174,5 @@ int main() {
   TestThreads();
   for (int32 i = 0; i < 1000; i++)
     TestTaskSequencer();
+  TestThreadLogSink();
 }
@@ -23,6 +23,7 @@
 #define KALDI_THREAD_KALDI_THREAD_H_ 1
 
 #include <thread>
+#include "base/kaldi-error.h"
 #include "itf/options-itf.h"
 #include "util/kaldi-semaphore.h"
 
@@ -52,6 +53,10 @@
 // destructor to have side effects such as outputting data.
 // Note: the destructor of TaskSequencer will wait for any remaining jobs that
 // are still running and will call the destructors.
+//
+// The threads started by MultiThreader and TaskSequencer log to the log sink
+// of the thread which started them (see SetThreadLogSink() in
+// base/kaldi-error.h), so the sink must outlive them and be thread safe.
 
 
 namespace kaldi {
@@ -126,10 +131,12 @@ class MultiThreader {
       cvec_[0].num_threads_ = 1;
       (cvec_[0])();
     } else {
+      LogSink *log_sink = GetThreadLogSink();
       for (int32 i = 0; i < threads_.size(); i++) {
         cvec_[i].thread_id_ = i;
         cvec_[i].num_threads_ = threads_.size();
-        threads_[i] = std::thread(std::ref(cvec_[i]));
+        threads_[i] = std::thread(MultiThreader<C>::RunThread, &(cvec_[i]),
+                                  log_sink);
       }
     }
   }
@@ -139,6 +146,11 @@ class MultiThreader {
         threads_[i].join();
   }
  private:
+  static void RunThread(C *c, LogSink *log_sink) {
+    SetThreadLogSink(log_sink);
+    (*c)();
+  }
+
   std::vector<std::thread> threads_;
   std::vector<C> cvec_;
 };
@@ -192,7 +204,8 @@ class TaskSequencer {
 
     // put the new RunTaskArgsList object at head of the singly
     // linked list thread_list_.
-    thread_list_ = new RunTaskArgsList(this, c, thread_list_);
+    thread_list_ = new RunTaskArgsList(this, c, thread_list_,
+                                       GetThreadLogSink());
     thread_list_->thread = std::thread(TaskSequencer<C>::RunTask,
                                        thread_list_);
   }
@@ -218,11 +231,14 @@ class TaskSequencer {
     C *c; // Clist element of the task we're expected
     std::thread thread;
     RunTaskArgsList *tail;
-    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail):
-        me(me), c(c), tail(tail) {}
+    LogSink *log_sink; // the log sink of the thread which called Run().
+    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail,
+                    LogSink *log_sink):
+        me(me), c(c), tail(tail), log_sink(log_sink) {}
   };
   // This static function gets run in the threads that we create.
   static void RunTask(RunTaskArgsList *args) {
+    SetThreadLogSink(args->log_sink);
     // (1) run the job.
     (*(args->c))(); // call operator () on args->c, which does the computation.
     args->me->threads_avail_.Signal(); // Signal that the compute-intensive
@@ -0,0 +1,134 @@
+// util/mapped-feature-reader-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/timer.h"
+#include "util/kaldi-table.h"
+#include "util/mapped-feature-reader.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+// Writes features of all kinds (compressed in the three formats, float, double)
+// and checks that MappedFeatureReader gives the same as the table readers.
+void UnitTestMappedFeatureReader() {
+  int32 num_utts = 20;
+  std::vector<std::string> keys;
+  {
+    BaseFloatMatrixWriter float_writer("ark,scp:tmpf.1.ark,tmpf.1.scp");
+    DoubleMatrixWriter double_writer("ark,scp:tmpf.2.ark,tmpf.2.scp");
+    CompressedMatrixWriter compressed_writer("ark,scp:tmpf.3.ark,tmpf.3.scp");
+    CompressionMethod methods[] = { kSpeechFeature, kTwoByteAuto,
+                                    kOneByteAuto };
+    for (int32 i = 0; i < num_utts; i++) {
+      std::string key = "utt" + std::to_string(i);
+      keys.push_back(key);
+      // one empty utterance per writer; Matrix(0, n) is not allowed.
+      int32 num_rows = (i < 15 ? RandInt(1, 300) : 0);
+      Matrix<BaseFloat> feats(num_rows, num_rows > 0 ? RandInt(1, 40) : 0);
+      feats.SetRandn();
+      if (i % 5 == 0) float_writer.Write(key, feats);
+      else if (i % 5 == 1) double_writer.Write(key, Matrix<double>(feats));
+      else compressed_writer.Write(key, CompressedMatrix(feats, methods[i % 3]));
+    }
+  }
+  std::ofstream os("tmpf.scp");
+  for (int32 f = 1; f <= 3; f++) {
+    std::ifstream is(("tmpf." + std::to_string(f) + ".scp").c_str());
+    os << is.rdbuf();
+  }
+  os.close();
+
+  MappedFeatureReader mapped_reader;
+  KALDI_ASSERT(mapped_reader.Open("tmpf.scp"));
+  KALDI_ASSERT(mapped_reader.NumUtterances() == keys.size());
+  RandomAccessBaseFloatMatrixReader table_reader("scp:tmpf.scp");
+  Matrix<BaseFloat> feats;
+  for (size_t i = 0; i < mapped_reader.NumUtterances(); i++) {
+    const std::string &key = mapped_reader.Key(i);
+    size_t j;
+    KALDI_ASSERT(mapped_reader.Find(key, &j) && j == i);
+    KALDI_ASSERT(mapped_reader.Read(i, &feats));
+    const Matrix<BaseFloat> &ref = table_reader.Value(key);
+    KALDI_ASSERT(feats.NumRows() == ref.NumRows() &&
+                 feats.NumCols() == ref.NumCols());
+    for (int32 r = 0; r < ref.NumRows(); r++)
+      for (int32 c = 0; c < ref.NumCols(); c++)
+        KALDI_ASSERT(feats(r, c) == ref(r, c));
+  }
+  size_t j;
+  KALDI_ASSERT(!mapped_reader.Find("nokey", &j));
+
+  {  // ranges are not supported.
+    std::ofstream os("tmpf.scp");
+    os << "utt0 tmpf.1.ark:5[0:1]\n";
+  }
+  KALDI_ASSERT(!mapped_reader.Open("tmpf.scp"));
+  unlink("tmpf.scp");
+  for (int32 f = 1; f <= 3; f++) {
+    unlink(("tmpf." + std::to_string(f) + ".scp").c_str());
+    unlink(("tmpf." + std::to_string(f) + ".ark").c_str());
+  }
+}
+
+// Compares the time of reading compressed features through "scp:" and through
+// MappedFeatureReader.
+void UnitTestMappedFeatureReaderSpeed() {
+  int32 num_utts = 2000;
+  {
+    CompressedMatrixWriter writer("ark,scp:tmpf.ark,tmpf.scp");
+    Matrix<BaseFloat> feats(500, 13);
+    for (int32 i = 0; i < num_utts; i++) {
+      feats.SetRandn();
+      writer.Write("utt" + std::to_string(i), CompressedMatrix(feats));
+    }
+  }
+  double sum1 = 0.0, sum2 = 0.0;
+  Timer timer1;
+  for (SequentialBaseFloatMatrixReader reader("scp:tmpf.scp"); !reader.Done();
+       reader.Next())
+    sum1 += reader.Value().Sum();
+  double time1 = timer1.Elapsed();
+  Timer timer2;
+  MappedFeatureReader mapped_reader;
+  KALDI_ASSERT(mapped_reader.Open("tmpf.scp"));
+  Matrix<BaseFloat> feats;
+  for (size_t i = 0; i < mapped_reader.NumUtterances(); i++) {
+    mapped_reader.Read(i, &feats);
+    sum2 += feats.Sum();
+  }
+  double time2 = timer2.Elapsed();
+  KALDI_ASSERT(sum1 == sum2);
+  KALDI_LOG << "Reading " << num_utts << " compressed utterances: scp: "
+            << time1 << " seconds, MappedFeatureReader " << time2
+            << " seconds.";
+  unlink("tmpf.ark");
+  unlink("tmpf.scp");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMappedFeatureReader();
+  UnitTestMappedFeatureReaderSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,164 @@
+// util/mapped-feature-reader.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstring>
+
+#include "util/kaldi-io.h"
+#include "util/kaldi-table.h"
+#include "util/mapped-feature-reader.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+bool MappedFeatureReader::Open(const std::string &scp_rxfilename) {
+  Close();
+  std::vector<std::pair<std::string, std::string> > script;
+  if (!ReadScriptFile(scp_rxfilename, true, &script))
+    return false;
+  std::unordered_map<std::string, int32, StringHasher> filename_to_file;
+  keys_.reserve(script.size());
+  entries_.reserve(script.size());
+  for (size_t i = 0; i < script.size(); i++) {
+    const std::string &rxfilename = script[i].second;
+    std::string filename;
+    Entry entry;
+    entry.offset = 0;
+    InputType type = ClassifyRxfilename(rxfilename);
+    if (type == kOffsetFileInput) {
+      size_t pos = rxfilename.find_last_of(':');
+      filename = rxfilename.substr(0, pos);
+      if (!ConvertStringToInteger(rxfilename.substr(pos + 1), &entry.offset)) {
+        Close();
+        return false;
+      }
+    } else if (type == kFileInput && *rxfilename.rbegin() != ']') {
+      filename = rxfilename;  // a single matrix; ranges are not supported.
+    } else {
+      Close();
+      return false;
+    }
+    std::unordered_map<std::string, int32, StringHasher>::iterator iter =
+        filename_to_file.find(filename);
+    if (iter != filename_to_file.end()) {
+      entry.file = iter->second;
+    } else {
+      MemoryMappedFile *file = new MemoryMappedFile();
+      if (!file->Open(filename)) {
+        KALDI_WARN << "Failed to map feature archive " << filename;
+        delete file;
+        Close();
+        return false;
+      }
+      entry.file = files_.size();
+      files_.push_back(file);
+      filenames_.push_back(filename);
+      filename_to_file[filename] = entry.file;
+    }
+    if (entry.offset >= files_[entry.file]->Size()) {
+      KALDI_WARN << "Offset out of range in " << rxfilename;
+      Close();
+      return false;
+    }
+    key_to_entry_[script[i].first] = keys_.size();
+    keys_.push_back(script[i].first);
+    entries_.push_back(entry);
+  }
+  return true;
+}
+
+bool MappedFeatureReader::Find(const std::string &key, size_t *i) const {
+  std::unordered_map<std::string, size_t, StringHasher>::const_iterator
+      iter = key_to_entry_.find(key);
+  if (iter == key_to_entry_.end()) return false;
+  *i = iter->second;
+  return true;
+}
+
+// Reads the binary int32 of WriteBasicType() (a size byte, then the value).
+static bool ReadInt32FromMemory(const char **data, const char *end,
+                                int32 *value) {
+  if (end - *data < 5 || **data != static_cast<char>(sizeof(int32)))
+    return false;
+  memcpy(value, *data + 1, sizeof(int32));
+  *data += 5;
+  return true;
+}
+
+bool MappedFeatureReader::Read(size_t i, Matrix<BaseFloat> *feats) const {
+  KALDI_ASSERT(i < entries_.size());
+  const Entry &entry = entries_[i];
+  const MemoryMappedFile &file = *(files_[entry.file]);
+  const char *data = file.Data() + entry.offset,
+      *end = file.Data() + file.Size();
+  // The binary mode header "\0B" (see InitKaldiInputStream()).
+  if (end - data < 2 || data[0] != '\0' || data[1] != 'B') {
+    KALDI_WARN << "Not a binary object at " << filenames_[entry.file] << ":"
+               << entry.offset << " (text mode archives are not supported)";
+    return false;
+  }
+  data += 2;
+  if (*data == 'C') {
+    if (CompressedMatrix::CopyToMatFromMemory(data, end - data, feats) != 0)
+      return true;
+  } else if (end - data >= 3 && (memcmp(data, "FM ", 3) == 0 ||
+                                 memcmp(data, "DM ", 3) == 0)) {
+    bool is_double = (data[0] == 'D');
+    int32 num_rows, num_cols;
+    data += 3;
+    if (ReadInt32FromMemory(&data, end, &num_rows) &&
+        ReadInt32FromMemory(&data, end, &num_cols) &&
+        num_rows >= 0 && num_cols >= 0) {
+      size_t elem_size = (is_double ? sizeof(double) : sizeof(float)),
+          row_size = elem_size * num_cols;
+      if (static_cast<size_t>(end - data) >= row_size * num_rows) {
+        if (feats->NumRows() != num_rows || feats->NumCols() != num_cols)
+          feats->Resize(num_rows, num_cols, kUndefined);
+        for (int32 r = 0; r < num_rows; r++, data += row_size) {
+          if (is_double) {
+            BaseFloat *row_data = feats->RowData(r);
+            for (int32 c = 0; c < num_cols; c++) {
+              double value;
+              memcpy(&value, data + c * sizeof(double), sizeof(double));
+              row_data[c] = value;
+            }
+          } else {
+            memcpy(feats->RowData(r), data, row_size);
+          }
+        }
+        return true;
+      }
+    }
+  }
+  KALDI_WARN << "Failed to read matrix at " << filenames_[entry.file] << ":"
+             << entry.offset;
+  return false;
+}
+
+void MappedFeatureReader::Close() {
+  for (size_t i = 0; i < files_.size(); i++)
+    delete files_[i];
+  files_.clear();
+  filenames_.clear();
+  keys_.clear();
+  entries_.clear();
+  key_to_entry_.clear();
+}
+
+}  // namespace kaldi
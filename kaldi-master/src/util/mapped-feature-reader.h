@@ -0,0 +1,93 @@
+// util/mapped-feature-reader.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MAPPED_FEATURE_READER_H_
+#define KALDI_UTIL_MAPPED_FEATURE_READER_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+#include "util/kaldi-mmap.h"
+#include "util/stl-utils.h"
+
+namespace kaldi {
+
+/// \addtogroup table_group
+/// @{
+
+/// Reads the feature matrices of an scp file (e.g. data/train/feats.scp, with
+/// lines like "utt1 raw_mfcc_train.1.ark:1234") from memory mapped archives.
+/// Each archive is mapped once and the utterances are located through the
+/// offsets of the scp file, so unlike the "scp:" table readers no file is
+/// opened, seeked and read per utterance.  Compressed matrices are
+/// decompressed directly from the mapped data into the caller's matrix (see
+/// CompressedMatrix::CopyToMatFromMemory()).  Only binary archive entries
+/// (Matrix, CompressedMatrix) are supported; Open() fails for scp files with
+/// pipes, ranges or other inputs, so the caller can use the table readers
+/// instead.
+class MappedFeatureReader {
+ public:
+  MappedFeatureReader() { }
+
+  /// Reads the scp file and maps the archives it refers to.  Returns false
+  /// (without warning, if the scp file is valid) if an entry is not a
+  /// "filename" or "filename:offset" entry.
+  bool Open(const std::string &scp_rxfilename);
+
+  /// The number of utterances, in the order of the scp file.
+  size_t NumUtterances() const { return keys_.size(); }
+
+  const std::string &Key(size_t i) const { return keys_[i]; }
+
+  /// Finds an utterance; returns false if not present.
+  bool Find(const std::string &key, size_t *i) const;
+
+  /// Reads the features of utterance i into *feats, which is resized only if
+  /// its size differs.  Returns false (with a warning) if the data is not a
+  /// binary matrix.
+  bool Read(size_t i, Matrix<BaseFloat> *feats) const;
+
+  void Close();
+
+  ~MappedFeatureReader() { Close(); }
+
+ private:
+  struct Entry {
+    int32 file;     // index into files_
+    uint64 offset;  // offset of the object in the archive
+  };
+  std::vector<MemoryMappedFile*> files_;
+  std::vector<std::string> filenames_;
+  std::vector<std::string> keys_;
+  std::vector<Entry> entries_;
+  std::unordered_map<std::string, size_t, StringHasher> key_to_entry_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFeatureReader);
+};
+
+/// @} end "addtogroup table_group"
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_MAPPED_FEATURE_READER_H_
@@ -0,0 +1,82 @@
+// util/slab-allocator-test.cc
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/slab-allocator.h"
+#include "base/kaldi-math.h"
+#include <set>
+
+namespace kaldi {
+
+struct TestObject {
+  int32 a;
+  double b;
+  TestObject *next;
+  TestObject(int32 a, double b, TestObject *next): a(a), b(b), next(next) { }
+};
+
+void TestSlabAllocator() {
+  size_t block_size = 1 + Rand() % 20;
+  SlabAllocator<TestObject> pool(block_size);
+  std::vector<TestObject*> live;
+  std::set<TestObject*> distinct;
+  for (int32 iter = 0; iter < 5; iter++) {
+    for (int32 i = 0; i < 1000; i++) {
+      if (live.empty() || Rand() % 3 != 0) {
+        TestObject *t = pool.New(TestObject(i, 0.5 * i,
+                                            live.empty() ? NULL : live.back()));
+        KALDI_ASSERT(t->a == i && t->b == 0.5 * i);
+        live.push_back(t);
+      } else {
+        size_t k = Rand() % live.size();
+        pool.Delete(live[k]);
+        live[k] = live.back();
+        live.pop_back();
+      }
+      KALDI_ASSERT(pool.NumInUse() == live.size());
+    }
+    // the live objects must not overlap and must keep their values.
+    distinct.clear();
+    for (size_t i = 0; i < live.size(); i++) {
+      live[i]->a = i;
+      KALDI_ASSERT(distinct.insert(live[i]).second);
+    }
+    for (size_t i = 0; i < live.size(); i++)
+      KALDI_ASSERT(live[i]->a == static_cast<int32>(i));
+    size_t num_blocks = pool.NumBlocks();
+    KALDI_ASSERT(num_blocks * block_size >= live.size());
+
+    // after Clear() the same memory is reused.
+    size_t num_live = live.size();
+    pool.Clear();
+    live.clear();
+    KALDI_ASSERT(pool.NumInUse() == 0);
+    for (size_t i = 0; i < num_live; i++)
+      live.push_back(pool.New(TestObject(i, 0.0, NULL)));
+    KALDI_ASSERT(pool.NumBlocks() == num_blocks);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    TestSlabAllocator();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,117 @@
+// util/slab-allocator.h
+
+// Copyright 2017-present  Zoltan Somogyi (AI-TOOLKIT)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_SLAB_ALLOCATOR_H_
+#define KALDI_UTIL_SLAB_ALLOCATOR_H_
+
+#include <new>
+#include <vector>
+#include <type_traits>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// SlabAllocator hands out objects of type T from large blocks ("slabs") and
+/// keeps the deleted ones on a free list for reuse, in the same way as
+/// HashList does for its Elems.  It is meant for the many small, short-lived
+/// objects of the decoders (tokens and links), which would otherwise go
+/// through the global heap one by one; that is slow, and it is a contention
+/// point when several decoders run in parallel threads.  The allocator is not
+/// thread-safe: each decoder owns its own allocators.
+///
+/// Clear() releases all objects at once (e.g. at the end of an utterance)
+/// without walking through them; the blocks are kept for reuse.  T must be
+/// trivially destructible because Clear() does not call the destructors.
+template<class T>
+class SlabAllocator {
+ public:
+  explicit SlabAllocator(size_t block_size = 1024):
+      block_size_(block_size), freed_head_(NULL), cur_block_(0), cur_pos_(0),
+      num_in_use_(0) {
+    KALDI_ASSERT(block_size_ > 0);
+  }
+
+  ~SlabAllocator() {
+    for (size_t i = 0; i < blocks_.size(); i++)
+      ::operator delete(blocks_[i]);
+  }
+
+  /// Returns a new object, copy-constructed from "value".
+  inline T *New(const T &value) {
+    void *mem;
+    if (freed_head_ != NULL) {
+      mem = freed_head_;
+      freed_head_ = freed_head_->next;
+    } else {
+      if (cur_block_ == blocks_.size())
+        blocks_.push_back(static_cast<char*>(::operator new(sizeof(T) * block_size_)));
+      mem = blocks_[cur_block_] + sizeof(T) * cur_pos_;
+      if (++cur_pos_ == block_size_) {
+        cur_block_++;
+        cur_pos_ = 0;
+      }
+    }
+    num_in_use_++;
+    return new (mem) T(value);
+  }
+
+  /// Returns the object to the free list.
+  inline void Delete(T *t) {
+    t->~T();
+    FreeElem *e = reinterpret_cast<FreeElem*>(t);
+    e->next = freed_head_;
+    freed_head_ = e;
+    num_in_use_--;
+  }
+
+  /// Releases all objects at once.  The pointers returned by New() become
+  /// invalid; the memory is kept for reuse.
+  void Clear() {
+    freed_head_ = NULL;
+    cur_block_ = 0;
+    cur_pos_ = 0;
+    num_in_use_ = 0;
+  }
+
+  /// Number of objects currently allocated (New() minus Delete()).
+  size_t NumInUse() const { return num_in_use_; }
+
+  /// Number of blocks allocated from the heap so far.
+  size_t NumBlocks() const { return blocks_.size(); }
+
+ private:
+  struct FreeElem { FreeElem *next; };
+  static_assert(sizeof(T) >= sizeof(FreeElem),
+                "SlabAllocator: the objects must be at least pointer size");
+  static_assert(std::is_trivially_destructible<T>::value,
+                "SlabAllocator: Clear() does not call the destructors");
+
+  size_t block_size_;  // number of objects in a block
+  FreeElem *freed_head_;  // head of the list of deleted objects
+  std::vector<char*> blocks_;  // the allocated blocks
+  size_t cur_block_;  // block from which new objects are taken when the
+  size_t cur_pos_;    // free list is empty, and position in it.
+  size_t num_in_use_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SlabAllocator);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_SLAB_ALLOCATOR_H_